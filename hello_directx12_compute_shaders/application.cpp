@@ -1,160 +1,258 @@
 // Liam Wynn, 11/22/2024, Hello DirectX 12: Compute Shader Edition
 
 #include "application.h"
+#include "gpu_bench_backend.h"
+#include "gpu_upload.h"
+#include "gpu_tile_backend.h"
+#include "gpu_split_device.h"
+#include "gpu_job_backend.h"
+#include "gpu_compute_graph.h"
+#include "parallel_recorder.h"
+#include "gpu_indirect.h"
+#include "gpu_permutations.h"
+#include "gpu_dxil.h"
 #include "utils.h"
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <iostream>
+#include <chrono>
+#include <cmath>
+#include <thread>
 
 using namespace std;
 using namespace DirectX;
 
-void initialize_application(application* app) {
+void default_app_options(app_options* options) {
+	options->print_mode = RESULT_PRINT_ALL;
+	options->frames_in_flight = DEFAULT_FRAMES_IN_FLIGHT;
+	options->iterations = 1;
+	options->async_queues = false;
+	options->clear_shader_cache = false;
+	options->output_format = CPU_TEXEL_R32G32B32A32_FLOAT;
+	options->trace_path = NULL;
+	options->adapter_index = 0;
+	options->probes = NULL;
+	options->tuning = NULL;
+	options->use_dxil = true;
+}
+
+void default_tiled_options(tiled_options* options) {
+	options->image_width = 0;
+	options->image_height = 0;
+	options->max_tile = 4096;
+	options->halo = 0;
+	options->tiles_in_flight = 2;
+	options->out_path = "tiled.raw";
+}
+
+void default_split_options(split_options* options) {
+	options->image_width = 0;
+	options->image_height = 0;
+	options->iterations = 8;
+	options->cpu_slowdowns.clear();
+}
+
+void initialize_application(application* app, const app_options* options) {
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> startup_time;
+	vector<unsigned char> bytecode;
+	shader_cache_key shader_key;
+	shader_defines defines;
+	tuning_entry tuned;
+
+	start = chrono::steady_clock::now();
+
+	app->profile = NULL;
+	app->gpu_profile = NULL;
+	app->trace_path = options->trace_path;
+
+	if (options->trace_path != NULL) {
+		app->profile = new profiler;
+		initialize_profiler(app->profile);
+	}
+
+	profile_scope scope(app->profile, "initialize_application");
 
 	//
 	// Initialize DirectX 12.
 	//
 
 	app->dx12 = new dx12_handler;
-	initialize_dx12_handler(app->dx12);
+	initialize_dx12_handler(
+		app->dx12,
+		options->frames_in_flight,
+		options->async_queues,
+		options->adapter_index,
+		options->probes
+	);
 
 	//
-	// Initialize the root signature.
+	// Without a hardware adapter there is no device to build a
+	// pipeline on. Run the kernel on the CPU instead.
 	//
 
-	app->root_signature = create_root_signature(app);
+	app->cpu = NULL;
+	app->pipelines = NULL;
+	app->root_signatures = NULL;
+	app->print_mode = options->print_mode;
+	app->output_format = options->output_format;
+	app->buffer = new compute_buffer;
+	app->buffers[0] = app->buffer;
+	app->num_buffers = 1;
+	app->next_buffer = 0;
+	app->group_size = { 8, 8 };
+	app->group_size_tuned = false;
+	app->use_dxil = options->use_dxil;
+
+	query_shader_model_support(app->dx12, &app->shader_support);
+
+	if (app->dx12->device == NULL) {
+		app->cpu = new cpu_executor;
+		initialize_cpu_executor(app->cpu, 0);
+
+		cout << "No hardware adapter found. Using the CPU executor ("
+			<< app->cpu->num_threads << " threads, "
+			<< cpu_simd_level_name(app->cpu->simd_level) << ")." << endl;
+
+		initialize_cpu_compute_buffer(
+			app->buffer,
+			256,
+			256,
+			cpu_texel_format_to_dxgi(app->output_format)
+		);
+
+		return;
+	}
 
 	//
-	// Initialize the pipeline state.
+	// Open the shader and pipeline caches. Clearing them first gives
+	// us a cold start to compare against.
 	//
 
-	app->pipeline_state = initialize_pipeline_state(app);
-
-	//
-	// Initialize the compute buffer.
-	//
+	if (options->clear_shader_cache) {
+		clear_pipeline_cache(SHADER_CACHE_DIRECTORY);
+	}
 
-	app->buffer = new compute_buffer;
-	initialize_compute_buffer(
-		app->buffer,
-		app->dx12,
-		256,
-		256,
-		DXGI_FORMAT_R32G32B32A32_FLOAT
-	);
-}
+	app->pipelines = new pipeline_cache;
+	initialize_pipeline_cache(app->pipelines, app->dx12, SHADER_CACHE_DIRECTORY);
 
-// TODO: When integrating into hello_directx_12, I should abstract out
-// the code to set up a root signature and pipeline. Otherwise the code
-// will quickly become gross and repetitive.
-ComPtr<ID3D12RootSignature> create_root_signature(application* app) {
-	ComPtr<ID3D12Device5> dev;
-	ComPtr<ID3D12RootSignature> root_signature;
-	CD3DX12_DESCRIPTOR_RANGE1 ranges[1];
-	CD3DX12_ROOT_PARAMETER1 pipeline_parameters[1];
-	D3D12_ROOT_SIGNATURE_FLAGS flags;
-	D3D12_FEATURE_DATA_ROOT_SIGNATURE feature_data;
-	CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC root_signature_desc;
-	ComPtr<ID3DBlob> root_signature_blob;
-	ComPtr<ID3DBlob> err_blob;
-	string err_msg;
-	HRESULT result;
+	cout << "Shader model " << describe_shader_model_support(&app->shader_support)
+		<< (app->use_dxil ? "" : "; embedded DXIL turned off") << "." << endl;
 
-	dev = app->dx12->device;
+	if (app->profile != NULL) {
+		app->gpu_profile = new gpu_profiler;
+		initialize_gpu_profiler(app->gpu_profile, app->dx12, GPU_PROFILER_MAX_MARKERS);
+	}
 
 	//
-	// Essentially saying "we have a single parameter that is a UAV buffer.
-	// It is the 0th register of the 0th register range.
+	// Compile the kernel and reflect it. If it has been tuned on this
+	// adapter, it is built with the group size that won. The root
+	// signature and the dispatch sizes come from what it declares.
 	//
 
-	ranges[0] = {};
-	ranges[0].Init(
-		D3D12_DESCRIPTOR_RANGE_TYPE_UAV,
-		1,
-		0,
-		0
-	);
+	if (options->tuning != NULL && find_tuning_entry(options->tuning, hello_compute_tuning_key(app), &tuned)) {
+		app->group_size = tuned.shape;
+		app->group_size_tuned = true;
+
+		defines.push_back(make_pair(string("GROUP_SIZE_X"), to_string(tuned.shape.x)));
+		defines.push_back(make_pair(string("GROUP_SIZE_Y"), to_string(tuned.shape.y)));
 
-	pipeline_parameters[0] = {};
-	pipeline_parameters[0].InitAsDescriptorTable(1, &(ranges[0]));
+		cout << "Using the tuned group size " << tuned.shape.x << "x" << tuned.shape.y << "." << endl;
+	}
+
+	bytecode = compile_kernel(app, defines, &shader_key);
 
-	flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+	if (!reflect_compute_shader(bytecode, &app->kernel)) {
+		cerr << "Could not reflect hello_compute.hlsl." << endl;
+		throw std::exception();
+	}
 
 	//
-	// Attempt to get version 1.1 support. Fall back on 1.0 if that
-	// fails.
+	// Initialize the root signature.
 	//
 
-	feature_data.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
-	result = dev->CheckFeatureSupport(
-		D3D12_FEATURE_ROOT_SIGNATURE,
-		&feature_data,
-		sizeof(feature_data)
-	);
-
-	if (result != S_OK) {
-		feature_data.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
-	}
+	app->root_signatures = new root_signature_cache;
+	initialize_root_signature_cache(app->root_signatures);
+	app->root_signature = create_root_signature(app);
 
 	//
-	// Create the root signature itself.
+	// Initialize the pipeline state.
 	//
 
-	// TODO: Omitting creation of a sampler here. I want to see what happens
-	// when we don't include it. I suspect we'll be ok because our shader
-	// doesn't use it. Code does not explain why it is neccessary.
+	app->pipeline_state = initialize_pipeline_state(app, bytecode, &shader_key);
 
-	root_signature_desc.Init_1_1(
-		1,
-		pipeline_parameters,
-		0,
-		NULL,
-		flags
-	);
+	//
+	// Initialize the compute buffer. With async queues there is a
+	// second one, so one buffer can be copied while the other is
+	// being written.
+	//
 
-	result = D3DX12SerializeVersionedRootSignature(
-		&root_signature_desc,
-		feature_data.HighestVersion,
-		&root_signature_blob,
-		&err_blob
-	);
+	if (options->async_queues) {
+		app->buffers[1] = new compute_buffer;
+		app->num_buffers = 2;
+	}
 
-	if (err_blob != NULL) {
-		err_msg = string((char*)err_blob->GetBufferPointer());
-		cerr << "Failed to load root signature: " << err_msg << endl;
-		throw_if_failed(result);
+	for (unsigned int i = 0; i < app->num_buffers; i++) {
+		initialize_compute_buffer(
+			app->buffers[i],
+			app->dx12,
+			256,
+			256,
+			cpu_texel_format_to_dxgi(app->output_format)
+		);
 	}
 
-	result = dev->CreateRootSignature(
-		0,
-		root_signature_blob->GetBufferPointer(),
-		root_signature_blob->GetBufferSize(),
-		IID_PPV_ARGS(&root_signature)
-	);
+	startup_time = chrono::steady_clock::now() - start;
 
-	throw_if_failed(result);
+	cerr << "Startup: " << startup_time.count() * 1000.0 << " ms ("
+		<< (app->pipelines->shaders.hits > 0 ? "warm" : "cold")
+		<< ": shader cache " << app->pipelines->shaders.hits << " hits, "
+		<< app->pipelines->shaders.misses << " misses; pipeline library "
+		<< app->pipelines->pipeline_hits << " hits, "
+		<< app->pipelines->pipeline_misses << " misses)" << endl;
+}
 
-	return root_signature;
+vector<unsigned char> compile_kernel(
+	application* app,
+	const shader_defines& defines,
+	shader_cache_key* key
+) {
+	return compile_kernel_file(app, "./hello_compute.hlsl", "main", defines, key);
 }
 
-// TODO: Just like root signature initialization, I want to abstract this
-// code too.
-ComPtr<ID3D12PipelineState> initialize_pipeline_state(application* app) {
-	ComPtr<ID3D12PipelineState> pipeline_state;
-	ComPtr<ID3D12Device5> dev;
-	ComPtr<ID3D12RootSignature> root_signature;
+vector<unsigned char> compile_kernel_file(
+	application* app,
+	const string& source_path,
+	const string& entry_point,
+	const shader_defines& defines,
+	shader_cache_key* key
+) {
+	const embedded_shader* embedded;
+	string reason;
 	UINT compile_flags;
-	ComPtr<ID3DBlob> compute_blob;
-	ComPtr<ID3DBlob> err_blob;
-	char* err_msg;
-	D3D12_PIPELINE_STATE_STREAM_DESC pipeline_state_stream_desc;
-	pipeline_state_stream pss;
-	HRESULT result;
 
-	dev = app->dx12->device;
-	root_signature = app->root_signature;
+	//
+	// DXIL built into the binary needs no compiling at all. It is keyed
+	// on its bytes, so a rebuilt binary gets new pipelines.
+	//
+
+	embedded = find_runnable_dxil(app, source_path, entry_point, defines, &reason);
+
+	if (embedded != NULL) {
+		key->hash = hash_bytes(embedded->data, embedded->size, SHADER_CACHE_VERSION);
+		key->name = hash_to_name(key->hash);
+
+		return vector<unsigned char>(embedded->data, embedded->data + embedded->size);
+	}
+
+	if (find_embedded_shader(source_path, entry_point, defines) != NULL && app->use_dxil) {
+		cout << "Compiling " << source_path << " with FXC: its DXIL " << reason << "." << endl;
+	}
 
 	//
-	// Compile the shader source code.
+	// Compile the shader source code, or pull the bytecode out of the
+	// shader cache if this exact build was done before.
 	//
 
 	compile_flags = 0;
@@ -162,136 +260,342 @@ ComPtr<ID3D12PipelineState> initialize_pipeline_state(application* app) {
 	compile_flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
 
-	result = D3DCompileFromFile(
-		L"./hello_compute.hlsl",
-		NULL,
-		NULL,
-		"main",
+	return compile_shader_cached(
+		app->pipelines,
+		source_path,
+		defines,
+		entry_point,
 		"cs_5_1",
 		compile_flags,
-		0,
-		&compute_blob,
-		&err_blob
+		key
 	);
+}
+
+const embedded_shader* find_runnable_dxil(
+	application* app,
+	const string& source_path,
+	const string& entry_point,
+	const shader_defines& defines,
+	string* reason
+) {
+	const embedded_shader* embedded;
+	dxil_shader_info info;
+
+	if (!app->use_dxil) {
+		*reason = "is turned off";
+		return NULL;
+	}
+
+	embedded = find_embedded_shader(source_path, entry_point, defines);
+
+	if (embedded == NULL) {
+		*reason = "isn't built into this binary";
+		return NULL;
+	}
 
-	if (FAILED(result) && err_blob != NULL) {
-		err_msg = (char*)err_blob->GetBufferPointer();
-		cerr << err_msg << endl;
+	if (!read_dxil_shader(embedded->data, embedded->size, &info, reason)) {
+		*reason = "doesn't read: " + *reason;
+		return NULL;
 	}
 
-	throw_if_failed(result);
+	if (!can_run_dxil(&app->shader_support, &info, reason)) {
+		*reason = "can't run here: " + *reason;
+		return NULL;
+	}
+
+	return embedded;
+}
+
+ComPtr<ID3D12RootSignature> create_root_signature(application* app) {
+	unsigned int table_offset;
 
 	//
-	// Now create our pipeline state description.
+	// Build the smallest root signature that covers what the kernel
+	// binds. For hello_compute that is one table with the u0 texture.
 	//
 
-	pss.root_sig = root_signature.Get();
-	pss.bytecode = CD3DX12_SHADER_BYTECODE(compute_blob.Get());
-	pipeline_state_stream_desc = { sizeof(pss), &pss };
+	if (!build_root_layout(&app->kernel, &app->layout)) {
+		cerr << "hello_compute.hlsl binds more than a root signature can hold." << endl;
+		throw std::exception();
+	}
+
+	if (!find_root_binding(&app->layout, SHADER_BINDING_UAV, 0, 0, &app->buffer_parameter, &table_offset)) {
+		cerr << "hello_compute.hlsl doesn't bind u0." << endl;
+		throw std::exception();
+	}
 
 	//
-	// Finally, create the pipeline state.
+	// Kernels with the same layout share the root signature, and so
+	// the hash the pipeline cache keys on.
 	//
 
-	result = dev->CreatePipelineState(
-		&pipeline_state_stream_desc,
-		IID_PPV_ARGS(&pipeline_state)
+	return get_root_signature(
+		app->root_signatures,
+		app->dx12,
+		&app->layout,
+		&app->root_signature_hash
 	);
+}
 
-	throw_if_failed(result);
+// TODO: When integrating into hello_directx_12, I want to abstract this
+// code too.
+ComPtr<ID3D12PipelineState> initialize_pipeline_state(
+	application* app,
+	const vector<unsigned char>& bytecode,
+	const shader_cache_key* key
+) {
+	//
+	// Create the pipeline state. On a warm start the driver hands it
+	// back from the pipeline library.
+	//
 
-	return pipeline_state;
+	return load_or_create_compute_pipeline(
+		app->pipelines,
+		app->dx12,
+		app->root_signature.Get(),
+		app->root_signature_hash,
+		bytecode,
+		key
+	);
 }
 
 void run_compute(application* app) {
 	ComPtr<ID3D12GraphicsCommandList> command_list;
-	ComPtr<ID3D12CommandAllocator> command_allocator;
-	ComPtr<ID3D12CommandQueue> command_queue;
-	descriptor_heap* desc_heap;
-	CD3DX12_GPU_DESCRIPTOR_HANDLE gpu_handle;
-	D3D12_RESOURCE_BARRIER barrier;
-	D3D12_TEXTURE_COPY_LOCATION src_location;
-	D3D12_TEXTURE_COPY_LOCATION dst_location;
-	HRESULT result;
+	compute_buffer* cb;
+	dx12_queue* queue;
+	resource_state_tracker* states;
+	queue_ticket copy_done;
+	unsigned int marker;
 
-	command_list = app->dx12->command_list;
-	command_allocator = app->dx12->command_allocator;
-	command_queue = app->dx12->command_queue;
-	desc_heap = app->dx12->cbv_srv_uav_heap;
+	profile_scope scope(app->profile, "run_compute");
+
+	if (app->cpu != NULL) {
+		run_compute_on_cpu(app);
+		return;
+	}
+
+	if (app->dx12->compute_queue != NULL) {
+		run_compute_async(app);
+		return;
+	}
+
+	cb = app->buffer;
+	queue = app->dx12->direct_queue;
+	states = &app->dx12->resource_states;
+
+	//
+	// Grab the next command list in the ring. This only waits if the
+	// GPU hasn't finished the batch that last used it.
+	//
+
+	command_list = begin_command_batch(queue, app->pipeline_state.Get());
 
 	//
-	// Reset the command list.
+	// The dispatch writes the buffer as a UAV. Whatever state the last
+	// run left it in, the tracker transitions it from there.
 	//
 
-	result = command_allocator->Reset();
-	throw_if_failed(result);
+	marker = begin_gpu_marker(app->gpu_profile, queue, command_list.Get(), "barrier: to UAV");
+	require_resource_state(states, cb->buffer.Get(), ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+	record_resource_barriers(app->dx12, command_list.Get());
+	end_gpu_marker(app->gpu_profile, command_list.Get(), marker);
 
-	result = command_list->Reset(command_allocator.Get(), app->pipeline_state.Get());
-	throw_if_failed(result);
+	marker = begin_gpu_marker(app->gpu_profile, queue, command_list.Get(), "dispatch");
+	record_dispatch(app, command_list, cb);
+	end_gpu_marker(app->gpu_profile, command_list.Get(), marker);
 
 	//
-	// Bind the root signature and pipeline.
+	// Now the copy reads it. It stays in COPY_SOURCE until the next run
+	// needs it again.
 	//
 
-	command_list->SetComputeRootSignature(app->root_signature.Get());
-	command_list->SetPipelineState(app->pipeline_state.Get());
+	marker = begin_gpu_marker(app->gpu_profile, queue, command_list.Get(), "barrier: to COPY_SOURCE");
+	require_resource_state(states, cb->buffer.Get(), ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_COPY_SOURCE, false);
+	record_resource_barriers(app->dx12, command_list.Get());
+	end_gpu_marker(app->gpu_profile, command_list.Get(), marker);
+
+	marker = begin_gpu_marker(app->gpu_profile, queue, command_list.Get(), "copy");
+	record_readback_copy(command_list, cb);
+	end_gpu_marker(app->gpu_profile, command_list.Get(), marker);
+
+	//
+	// Submit without waiting. The CPU only synchronizes with the GPU
+	// when the ring wraps or when we read the results back.
+	//
+
+	copy_done = submit_command_batch(app->dx12, queue, NULL, 0);
+	commit_readback_copy(cb, app->dx12, &copy_done);
+}
+
+void run_compute_async(application* app) {
+	ComPtr<ID3D12GraphicsCommandList> command_list;
+	dx12_handler* dx12;
+	compute_buffer* cb;
+	resource_state_tracker* states;
+	queue_ticket dispatch_done;
+	unsigned int marker;
+
+	dx12 = app->dx12;
+	states = &dx12->resource_states;
 
 	//
-	// Transition the buffer to UNORDERED_ACCESS before
-	// dispatch.
+	// Alternate between the buffers so the dispatch of this batch
+	// doesn't have to wait for the copy of the last one.
 	//
 
-	barrier = {};
-	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-	barrier.Transition.pResource = app->buffer->buffer.Get();
-	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COMMON;
-	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	cb = app->buffers[app->next_buffer];
+	app->next_buffer = (app->next_buffer + 1) % app->num_buffers;
+
+	//
+	// Dispatch on the compute queue. The buffer ends in COMMON, which
+	// is the state the copy queue needs it in. The transition is
+	// recorded when the batch is submitted.
+	//
+
+	command_list = begin_command_batch(dx12->compute_queue, app->pipeline_state.Get());
+
+	marker = begin_gpu_marker(app->gpu_profile, dx12->compute_queue, command_list.Get(), "barrier: to UAV");
+	require_resource_state(states, cb->buffer.Get(), ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+	record_resource_barriers(dx12, command_list.Get());
+	end_gpu_marker(app->gpu_profile, command_list.Get(), marker);
+
+	marker = begin_gpu_marker(app->gpu_profile, dx12->compute_queue, command_list.Get(), "dispatch");
+	record_dispatch(app, command_list, cb);
+	end_gpu_marker(app->gpu_profile, command_list.Get(), marker);
+
+	require_resource_state(states, cb->buffer.Get(), ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_COMMON, false);
+
+	//
+	// The dispatch overwrites the buffer, so it has to wait for the
+	// last copy that read it.
+	//
+
+	dispatch_done = submit_command_batch(dx12, dx12->compute_queue, &cb->last_read, 1);
+
+	//
+	// Copy on the copy queue once the dispatch is done. The buffer is
+	// implicitly promoted from COMMON to COPY_SOURCE and decays back
+	// afterwards, so as far as the tracker knows it stays in COMMON.
+	//
+
+	command_list = begin_command_batch(dx12->copy_queue, NULL);
+
+	marker = begin_gpu_marker(app->gpu_profile, dx12->copy_queue, command_list.Get(), "copy");
+	record_readback_copy(command_list, cb);
+	end_gpu_marker(app->gpu_profile, command_list.Get(), marker);
+	cb->last_read = submit_command_batch(dx12, dx12->copy_queue, &dispatch_done, 1);
+	commit_readback_copy(cb, dx12, &cb->last_read);
 
-	command_list->ResourceBarrier(1, &barrier);
+	app->buffer = cb;
+}
+
+void record_dispatch(
+	application* app,
+	ComPtr<ID3D12GraphicsCommandList> command_list,
+	compute_buffer* cb
+) {
+	descriptor_heap* desc_heap;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE gpu_handle;
+	dispatch_group_count groups;
+	unsigned int uav_index;
+
+	desc_heap = app->dx12->cbv_srv_uav_heap;
+
+	//
+	// Bind the root signature and pipeline.
+	//
+
+	command_list->SetComputeRootSignature(app->root_signature.Get());
+	command_list->SetPipelineState(app->pipeline_state.Get());
 
 	//
 	// Bind the back buffer.
 	//
 
-	ID3D12DescriptorHeap* heaps[] = { app->dx12->cbv_srv_uav_heap->heap.Get() };
+	ID3D12DescriptorHeap* heaps[] = { desc_heap->heap.Get() };
 	command_list->SetDescriptorHeaps(1, heaps);
 
-	gpu_handle = heap_gpu_handle(desc_heap, app->buffer->uav_index);
-	command_list->SetComputeRootDescriptorTable(0, gpu_handle);
-
 	//
-	// Dispatch the compute shader
+	// Lists on the direct queue bind a copy of the staged view from the
+	// transient ring, which is reclaimed against the direct queue's
+	// fence. Lists on the other queues bind the persistent slot.
 	//
 
-	command_list->Dispatch(32, 32, 1);
+	uav_index = cb->uav_index;
+	if (command_list->GetType() == D3D12_COMMAND_LIST_TYPE_DIRECT) {
+		uav_index = copy_staged_descriptors_to_transient(app->dx12, cb->staging_uav_index, 1);
+	}
+
+	gpu_handle = heap_gpu_handle(desc_heap, uav_index);
+	command_list->SetComputeRootDescriptorTable(app->buffer_parameter, gpu_handle);
 
 	//
-	// Now transition the buffer to copy source.
+	// Dispatch the compute shader, with enough groups of the kernel's
+	// numthreads to cover the buffer.
 	//
 
-	barrier = {};
-	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-	barrier.Transition.pResource = app->buffer->buffer.Get();
-	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_SOURCE;
-	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	groups = dispatch_size_for(&app->kernel, cb->width, cb->height, 1);
+	command_list->Dispatch(groups.x, groups.y, groups.z);
+}
+
+void record_readback_copy(
+	ComPtr<ID3D12GraphicsCommandList> command_list,
+	compute_buffer* cb
+) {
+	record_readback_region(command_list, cb, cb->width, cb->height);
+}
+
+void record_readback_region(
+	ComPtr<ID3D12GraphicsCommandList> command_list,
+	compute_buffer* cb,
+	const unsigned int width,
+	const unsigned int height
+) {
+	D3D12_TEXTURE_COPY_LOCATION src_location;
+	D3D12_TEXTURE_COPY_LOCATION dst_location;
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT slot;
+	D3D12_BOX region;
+
+	//
+	// Copy the GPU buffer into the next readback slot. The caller
+	// commits it with commit_readback_copy once it is submitted.
+	//
 
-	command_list->ResourceBarrier(1, &barrier);
+	slot = begin_readback_copy(cb);
 
 	//
-	// Now copy the GPU buffer into the readback buffer.
+	// Structured and raw buffers have no rows to pad, so they go
+	// straight across.
 	//
 
+	if (is_linear_compute_buffer(cb)) {
+		command_list->CopyBufferRegion(
+			cb->readback_buffer.Get(),
+			slot.Offset,
+			cb->buffer.Get(),
+			0,
+			(uint64_t)min(width, cb->width) * cb->element_size
+		);
+
+		return;
+	}
+
+	region = {};
+	region.right = min(width, cb->width);
+	region.bottom = min(height, cb->height);
+	region.back = 1;
+
 	src_location = {};
-	src_location.pResource = app->buffer->buffer.Get();
+	src_location.pResource = cb->buffer.Get();
 	src_location.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
 	src_location.SubresourceIndex = 0;
 
 	dst_location = {};
-	dst_location.pResource = app->buffer->readback_buffer.Get();
+	dst_location.pResource = cb->readback_buffer.Get();
 	dst_location.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-	dst_location.PlacedFootprint = app->buffer->footprint_for_readback;
+	dst_location.PlacedFootprint = slot;
+	dst_location.PlacedFootprint.Footprint.Width = region.right;
+	dst_location.PlacedFootprint.Footprint.Height = region.bottom;
 
 	command_list->CopyTextureRegion(
 		&dst_location,
@@ -299,84 +603,1714 @@ void run_compute(application* app) {
 		0,
 		0,
 		&src_location,
-		NULL
+		&region
 	);
+}
 
-	result = command_list->Close();
-	throw_if_failed(result);
-	ID3D12CommandList* commands[] = { command_list.Get() };
-	command_queue->ExecuteCommandLists(
-		_countof(commands),
-		commands
-	);
+void run_compute_on_cpu(application* app) {
+	compute_buffer* cb;
+	cpu_texture target;
+	cpu_dispatch_desc dispatch;
+	cpu_dispatch_stats stats;
+
+	profile_scope scope(app->profile, "cpu dispatch");
+
+	cb = app->buffer;
 
 	//
-	// Synchronize the GPU and CPU.
+	// Write straight into the host copy of the readback buffer, using
+	// the same row pitch the GPU copy would.
 	//
 
-	wait_for_previous_frame(app->dx12);
+	target.data = cb->cpu_readback_data;
+	target.width = cb->width;
+	target.height = cb->height;
+	target.row_pitch = cb->footprint_for_readback.Footprint.RowPitch;
+	target.format = app->output_format;
+
+	dispatch = cpu_hello_compute_dispatch(cb->width, cb->height);
+	stats = cpu_dispatch_hello_compute(app->cpu, &target, &dispatch);
+
+	cerr << "CPU dispatch (" << dispatch.group_count_x << ", "
+		<< dispatch.group_count_y << ", 1): " << stats.seconds * 1000.0
+		<< " ms, " << stats.mpixels_per_second << " Mpixel/s" << endl;
 }
 
 void read_back_data(application* app) {
 	compute_buffer* cb;
-	ComPtr<ID3D12Resource> readback_buffer;
-	void* mapped_data;
-	BYTE* row_data;
-	UINT num_rows;
-	UINT num_cols;
-	UINT row_pitch;
-	XMFLOAT4* next_row_float;
-	HRESULT result;
-
-	mapped_data = NULL;
+	const unsigned char* data;
+	unsigned int slot;
+	float4_rows rows;
+	texel_rows texels;
+
+	profile_scope scope(app->profile, "read_back_data");
+
 	cb = app->buffer;
-	readback_buffer = cb->readback_buffer;
+	slot = INVALID_READBACK_SLOT;
 
 	//
-	// Map the readback buffer.
+	// The CPU executor already wrote its results to host memory with
+	// the same layout.
 	//
 
-	result = readback_buffer->Map(
-		0,
-		NULL,
-		&mapped_data
-	);
+	if (app->cpu != NULL) {
+		data = cb->readback_data;
+	}
+	else {
+		//
+		// Only the newest copy matters. Waiting for it waits for every
+		// batch before it too: earlier ones on its queue ran first, and
+		// with async queues the copy waited for its dispatch.
+		//
+
+		{
+			profile_scope wait_scope(app->profile, "wait for gpu");
+			slot = begin_latest_readback(&cb->readback_slots);
+		}
+
+		if (slot == INVALID_READBACK_SLOT) {
+			throw std::exception();
+		}
+
+		// Every marker recorded so far has been written.
+		collect_gpu_markers(app->gpu_profile, app->profile);
+
+		data = readback_slot_data(cb, slot);
+	}
 
-	throw_if_failed(result);
+	rows.data = data;
+	rows.width = cb->width;
+	rows.height = cb->height;
+	rows.row_pitch = cb->footprint_for_readback.Footprint.RowPitch;
 
 	//
-	// Print the data
+	// A narrower format is decoded to packed float4 rows first.
 	//
 
-	row_data = reinterpret_cast<BYTE*>(mapped_data);
-	num_rows = cb->height;
-	num_cols = cb->width;
-	row_pitch = cb->footprint_for_readback.Footprint.RowPitch;
+	if (app->output_format != CPU_TEXEL_R32G32B32A32_FLOAT) {
+		profile_scope decode_scope(app->profile, "decode");
 
-	for (UINT row = 0; row < num_rows; row++) {
-		next_row_float = reinterpret_cast<XMFLOAT4*>(row_data);
-		for (UINT col = 0; col < num_cols; col++) {
-			printf(
-				"Element (%u, %u): (%f, %f, %f, %f)\n",
-				row,
-				col,
-				next_row_float[col].x,
-				next_row_float[col].y,
-				next_row_float[col].z,
-				next_row_float[col].w
-			);
+		texels.data = data;
+		texels.width = cb->width;
+		texels.height = cb->height;
+		texels.row_pitch = cb->footprint_for_readback.Footprint.RowPitch;
+		texels.format = app->output_format;
+
+		app->decoded.resize((size_t)cb->width * cb->height * 4);
+		decode_texel_rows(&texels, app->decoded.data(), detect_cpu_simd_level());
+
+		rows.data = (const unsigned char*)app->decoded.data();
+		rows.row_pitch = cb->width * CPU_FLOAT4_SIZE;
+	}
+
+	//
+	// Print the data. The formatter splits the rows across all cores
+	// and writes the text in a few large chunks.
+	//
+
+	{
+		profile_scope print_scope(app->profile, "print_results");
+		print_results(&rows, app->print_mode, 0, stdout);
+	}
+
+	//
+	// Hand the slot back for the next copy. It stays mapped.
+	//
+
+	if (slot != INVALID_READBACK_SLOT) {
+		end_readback(&cb->readback_slots, slot);
+	}
+}
+
+void print_batch_stats(application* app) {
+	dx12_queue* queues[3];
+	frame_ring_stats stats;
+
+	if (app->cpu != NULL) {
+		return;
+	}
+
+	cerr << "GPU memory: " << app->dx12->memory->heaps_created << " heaps for "
+		<< app->dx12->memory->resources_placed << " placed resources" << endl;
+
+	queues[0] = app->dx12->direct_queue;
+	queues[1] = app->dx12->compute_queue;
+	queues[2] = app->dx12->copy_queue;
+
+	for (dx12_queue* queue : queues) {
+		if (queue == NULL) {
+			continue;
+		}
+
+		stats = get_frame_ring_stats(queue->frames);
+		if (stats.batches == 0) {
+			continue;
 		}
 
-		row_data += row_pitch;
+		cerr << queue_kind_name(queue->kind) << " queue: "
+			<< "batches: " << stats.batches
+			<< ", frames in flight: " << app->dx12->frames_in_flight
+			<< ", batches/sec: " << stats.batches_per_second
+			<< ", overlap: " << stats.overlap * 100.0 << "%"
+			<< " (" << stats.blocking_begins << " blocking waits, "
+			<< stats.cpu_wait_seconds * 1000.0 << " ms)" << endl;
+	}
+}
+
+void write_profile(application* app) {
+	if (app->profile == NULL) {
+		return;
+	}
+
+	if (!write_chrome_trace_file(app->profile, app->trace_path)) {
+		cerr << "Could not write the trace to " << app->trace_path << endl;
+	}
+	else {
+		cerr << "Wrote trace to " << app->trace_path << endl;
+	}
+
+	print_profile_summary(app->profile, stderr);
+
+	if (app->gpu_profile != NULL && app->gpu_profile->dropped_markers > 0) {
+		cerr << app->gpu_profile->dropped_markers
+			<< " GPU markers were dropped. Read back more often to keep them." << endl;
+	}
+}
+
+void benchmark_dispatch_batching(
+	application* app,
+	const unsigned int num_dispatches,
+	FILE* out
+) {
+	const unsigned int num_targets = 16;
+	const unsigned int rounds = 3;
+	dx12_handler* dx12;
+	dx12_queue* queue;
+	vector<compute_buffer*> targets;
+	ComPtr<ID3D12PipelineState> pipelines[2];
+	vector<unsigned char> bytecode;
+	shader_cache_key shader_key;
+	ComPtr<ID3D12GraphicsCommandList> command_list;
+	compute_batch batch;
+	compute_binding binding;
+	dispatch_resource_use use;
+	dispatch_group_count groups;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> one_at_a_time;
+	chrono::duration<double> batched;
+
+	benchmark_dispatch_planner(out);
+
+	if (app->cpu != NULL) {
+		fprintf(out, "No hardware adapter, skipping the GPU part.\n");
+		return;
+	}
+
+	dx12 = app->dx12;
+	queue = dx12->direct_queue;
+
+	//
+	// A second pipeline, so the batch has something to sort. The
+	// define doesn't change the shader, only the cache key.
+	//
+
+	pipelines[0] = app->pipeline_state;
+
+	bytecode = compile_kernel(app, { { "HELLO_VARIANT", "1" } }, &shader_key);
+
+	pipelines[1] = load_or_create_compute_pipeline(
+		app->pipelines,
+		dx12,
+		app->root_signature.Get(),
+		app->root_signature_hash,
+		bytecode,
+		&shader_key
+	);
+
+	for (unsigned int i = 0; i < num_targets; i++) {
+		targets.push_back(new compute_buffer);
+		initialize_compute_buffer(targets[i], dx12, 256, 256, DXGI_FORMAT_R32G32B32A32_FLOAT);
 	}
 
+	groups = dispatch_size_for(&app->kernel, 256, 256, 1);
+
+	initialize_compute_batch(&batch);
+
 	//
-	// Finally, unmap the data.
+	// The first round warms things up and isn't counted.
 	//
 
-	readback_buffer->Unmap(0, NULL);
+	one_at_a_time = chrono::duration<double>::zero();
+	batched = chrono::duration<double>::zero();
+
+	for (unsigned int r = 0; r <= rounds; r++) {
+		//
+		// One dispatch per command list, the way run_compute does it.
+		//
+
+		start = chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < num_dispatches; i++) {
+			compute_buffer* cb = targets[i % num_targets];
+
+			command_list = begin_command_batch(queue, pipelines[i % 2].Get());
+
+			require_resource_state(
+				&dx12->resource_states,
+				cb->buffer.Get(),
+				ALL_TRACKED_SUBRESOURCES,
+				D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+				true
+			);
+			record_resource_barriers(dx12, command_list.Get());
+
+			ID3D12DescriptorHeap* heaps[] = { dx12->cbv_srv_uav_heap->heap.Get() };
+			command_list->SetDescriptorHeaps(1, heaps);
+			command_list->SetComputeRootSignature(app->root_signature.Get());
+			command_list->SetComputeRootDescriptorTable(
+				app->buffer_parameter,
+				heap_gpu_handle(dx12->cbv_srv_uav_heap, cb->uav_index)
+			);
+			command_list->Dispatch(groups.x, groups.y, groups.z);
+
+			submit_command_batch(dx12, queue, NULL, 0);
+		}
+
+		flush_command_batches(queue);
+
+		if (r > 0) {
+			one_at_a_time += chrono::steady_clock::now() - start;
+		}
+
+		//
+		// The same dispatches through one batch.
+		//
+
+		start = chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < num_dispatches; i++) {
+			compute_buffer* cb = targets[i % num_targets];
+
+			binding.root_parameter = app->buffer_parameter;
+			binding.table = heap_gpu_handle(dx12->cbv_srv_uav_heap, cb->uav_index);
+
+			use.resource = cb->buffer.Get();
+			use.writes = true;
+
+			add_compute_dispatch(
+				&batch,
+				app->root_signature.Get(),
+				pipelines[i % 2].Get(),
+				&binding,
+				1,
+				&use,
+				1,
+				groups.x,
+				groups.y,
+				groups.z
+			);
+		}
+
+		submit_compute_batch(&batch, dx12, queue, NULL, 0);
+		flush_command_batches(queue);
+
+		if (r > 0) {
+			batched += chrono::steady_clock::now() - start;
+		}
+	}
+
+	fprintf(out, "%u dispatches over %u buffers, 2 pipelines, %u rounds\n", num_dispatches, num_targets, rounds);
+	fprintf(
+		out,
+		"  one at a time: %.0f dispatches/s\n",
+		num_dispatches * rounds / one_at_a_time.count()
+	);
+	fprintf(
+		out,
+		"  batched:       %.0f dispatches/s (%u pipeline changes, %u UAV barriers)\n",
+		num_dispatches * rounds / batched.count(),
+		batch.plan.pipeline_changes,
+		batch.plan.uav_barriers
+	);
+
+	for (compute_buffer* cb : targets) {
+		shutdown_compute_buffer(cb, dx12);
+		delete cb;
+	}
 }
 
-void shutdown_app(application* app) {
+/*
+	Small dispatches over a few buffers. A chunk starts with a UAV
+	barrier, since the chunk before may have written the same buffers,
+	and has another each time it comes back round to the first buffer.
+*/
+struct hello_dispatch_job : parallel_record_job {
+	application* app;
+	ID3D12PipelineState* pipeline;
+	vector<compute_buffer*>* targets;
+
+	void record_chunk(
+		ID3D12GraphicsCommandList* command_list,
+		const recording_chunk* chunk
+	) override {
+		dx12_handler* dx12 = app->dx12;
+		D3D12_RESOURCE_BARRIER uav_barrier = CD3DX12_RESOURCE_BARRIER::UAV(NULL);
+
+		ID3D12DescriptorHeap* heaps[] = { dx12->cbv_srv_uav_heap->heap.Get() };
+		command_list->SetDescriptorHeaps(1, heaps);
+		command_list->SetComputeRootSignature(app->root_signature.Get());
+		command_list->SetPipelineState(pipeline);
+
+		for (unsigned int i = 0; i < chunk->num_items; i++) {
+			unsigned int item = chunk->first_item + i;
+			compute_buffer* cb = (*targets)[item % targets->size()];
+
+			if (i == 0 || item % targets->size() == 0) {
+				command_list->ResourceBarrier(1, &uav_barrier);
+			}
+
+			command_list->SetComputeRootDescriptorTable(
+				app->buffer_parameter,
+				heap_gpu_handle(dx12->cbv_srv_uav_heap, cb->uav_index)
+			);
+			command_list->Dispatch(1, 1, 1);
+		}
+	}
+};
+
+void benchmark_parallel_recording(
+	application* app,
+	const unsigned int num_dispatches,
+	FILE* out
+) {
+	const unsigned int num_targets = 16;
+	const unsigned int rounds = 3;
+	dx12_handler* dx12;
+	dx12_queue* queue;
+	vector<compute_buffer*> targets;
+	hello_dispatch_job job;
+	double one_thread;
+
+	benchmark_recording_pool(out);
+
+	if (app->cpu != NULL) {
+		fprintf(out, "No hardware adapter, skipping the GPU part.\n");
+		return;
+	}
+
+	dx12 = app->dx12;
+	queue = dx12->direct_queue;
+
+	for (unsigned int i = 0; i < num_targets; i++) {
+		targets.push_back(new compute_buffer);
+		initialize_compute_buffer(targets[i], dx12, 256, 256, DXGI_FORMAT_R32G32B32A32_FLOAT);
+	}
+
+	job.app = app;
+	job.pipeline = app->pipeline_state.Get();
+	job.targets = &targets;
+
+	fprintf(out, "%u dispatches per batch over %u buffers, %u rounds\n", num_dispatches, num_targets, rounds);
+	fprintf(out, "  %7s %14s %8s %8s %8s %8s\n", "threads", "dispatches/s", "speedup", "lists", "made", "waits");
+
+	one_thread = 0.0;
+
+	for (unsigned int threads : { 1u, 2u, 4u, 8u }) {
+		parallel_recorder recorder;
+		chrono::duration<double> recording;
+		recording_pool_stats stats;
+		double rate;
+
+		initialize_parallel_recorder(&recorder, dx12, queue, threads);
+		recording = chrono::duration<double>::zero();
+
+		//
+		// The first round makes the allocators and isn't counted. Only
+		// the CPU side is timed: recording and submitting, not the GPU.
+		//
+
+		for (unsigned int r = 0; r <= rounds; r++) {
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+			begin_command_batch(queue, NULL);
+
+			for (compute_buffer* cb : targets) {
+				require_resource_state(
+					&dx12->resource_states,
+					cb->buffer.Get(),
+					ALL_TRACKED_SUBRESOURCES,
+					D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+					true
+				);
+			}
+
+			submit_parallel_batch(&recorder, &job, num_dispatches, NULL, 0);
+
+			if (r > 0) {
+				recording += chrono::steady_clock::now() - start;
+			}
+
+			flush_command_batches(queue);
+		}
+
+		stats = get_recording_pool_stats(&recorder.pool);
+		rate = num_dispatches * rounds / recording.count();
+
+		if (threads == 1) {
+			one_thread = rate;
+		}
+
+		fprintf(
+			out,
+			"  %7u %14.0f %7.2fx %8u %8llu %8llu\n",
+			threads,
+			rate,
+			rate / one_thread,
+			(unsigned int)plan_recording_chunks(num_dispatches, threads, recorder.min_chunk_items).size(),
+			(unsigned long long)stats.created,
+			(unsigned long long)stats.blocking_waits
+		);
+
+		shutdown_parallel_recorder(&recorder);
+	}
+
+	for (compute_buffer* cb : targets) {
+		shutdown_compute_buffer(cb, dx12);
+		delete cb;
+	}
+}
+
+void benchmark_suite(
+	application* app,
+	const bench_suite_options* options,
+	const char* out_path
+) {
+	cpu_bench_backend cpu;
+	gpu_bench_backend gpu;
+	vector<bench_result> results;
+
+	if (app == NULL || app->cpu != NULL) {
+		initialize_cpu_bench_backend(&cpu, 0);
+		results = run_bench_suite(&cpu, options, stderr);
+	}
+	else {
+		initialize_gpu_bench_backend(&gpu, app);
+		results = run_bench_suite(&gpu, options, stderr);
+		shutdown_gpu_bench_backend(&gpu);
+	}
+
+	print_bench_results(results, stdout);
+
+	if (out_path == NULL) {
+		return;
+	}
+
+	if (!write_bench_results(results, out_path)) {
+		cerr << "Could not write the benchmark results to " << out_path << endl;
+	}
+	else {
+		cerr << "Wrote benchmark results to " << out_path << endl;
+	}
+}
+
+void benchmark_uploads(application* app, FILE* out) {
+	const unsigned int sizes[] = { 64, 256, 512 };
+	const unsigned int uploads_per_size = 64;
+	dx12_handler* dx12;
+	dx12_queue* queue;
+	gpu_upload_ring* ring;
+	compute_buffer cb;
+	vector<unsigned char> source;
+	uint64_t row_pitch;
+	uint64_t bytes_before;
+	uint64_t waits_before;
+	ComPtr<ID3D12GraphicsCommandList> command_list;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+
+	fprintf(out, "Upload ring on a mock fence:\n");
+	benchmark_upload_ring(out);
+
+	if (app == NULL || app->cpu != NULL) {
+		fprintf(out, "No hardware adapter, skipping the GPU part.\n");
+		return;
+	}
+
+	dx12 = app->dx12;
+	queue = dx12->direct_queue;
+	ring = queue->uploads;
+
+	fprintf(out, "Uploads into a compute_buffer, one batch each:\n");
+
+	for (unsigned int size : sizes) {
+		initialize_compute_buffer(&cb, dx12, size, size, DXGI_FORMAT_R32G32B32A32_FLOAT);
+
+		//
+		// Tightly packed float4 rows, so every row has to be moved to
+		// the copy's padded pitch.
+		//
+
+		row_pitch = (uint64_t)size * 16;
+		source.assign((size_t)(row_pitch * size), 0x3F);
+
+		bytes_before = ring->bytes_uploaded;
+		waits_before = ring->ring.blocking_waits;
+		start = chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < uploads_per_size; i++) {
+			command_list = begin_command_batch(queue, NULL);
+			record_compute_buffer_upload(dx12, queue, command_list.Get(), &cb, source.data(), row_pitch);
+			submit_command_batch(dx12, queue, NULL, 0);
+		}
+
+		flush_command_batches(queue);
+		elapsed = chrono::steady_clock::now() - start;
+
+		fprintf(
+			out,
+			"  %4ux%-4u %.2f GB/s, %llu blocking waits\n",
+			size,
+			size,
+			(ring->bytes_uploaded - bytes_before) / elapsed.count() / 1.0e9,
+			(unsigned long long)(ring->ring.blocking_waits - waits_before)
+		);
+
+		shutdown_compute_buffer(&cb, dx12);
+	}
+}
+
+bool run_tiled(application* app, const tiled_options* options) {
+	tile_grid grid;
+	cpu_tile_backend cpu;
+	gpu_tile_backend gpu;
+	tile_backend* backend;
+	file_tile_output output;
+	tiled_job_stats stats;
+	uint64_t region_size;
+	uint64_t tile_memory;
+
+	if (!plan_tile_grid(
+		options->image_width,
+		options->image_height,
+		options->max_tile,
+		options->max_tile,
+		options->halo,
+		&grid
+	)) {
+		cerr << "A halo of " << options->halo << " leaves no room in a "
+			<< options->max_tile << " texel tile." << endl;
+		return false;
+	}
+
+	if (!open_file_tile_output(&output, options->out_path, &grid, CPU_FLOAT4_SIZE)) {
+		cerr << "Could not open " << options->out_path << endl;
+		return false;
+	}
+
+	//
+	// What a slot takes. The GPU also keeps readback slots for it.
+	//
+
+	region_size = cpu_readback_footprint(grid.max_region_width, grid.max_region_height, CPU_FLOAT4_SIZE).total_size;
+
+	if (app->cpu != NULL) {
+		initialize_cpu_tile_backend(&cpu, &grid, options->tiles_in_flight, 0);
+		backend = &cpu;
+		tile_memory = region_size * cpu.slots.size();
+	}
+	else {
+		try {
+			initialize_gpu_tile_backend(&gpu, app, &grid, options->tiles_in_flight);
+		}
+		catch (const exception&) {
+			shutdown_gpu_tile_backend(&gpu);
+			close_file_tile_output(&output);
+			cerr << "Could not set up the tiles on the device." << endl;
+			return false;
+		}
+
+		backend = &gpu;
+		tile_memory = region_size * gpu.slots.size() * (1 + READBACK_SLOT_COUNT);
+	}
+
+	stats = run_tiled_job(&grid, backend, NULL, &output, options->tiles_in_flight);
+
+	if (backend == &gpu) {
+		shutdown_gpu_tile_backend(&gpu);
+	}
+
+	close_file_tile_output(&output);
+
+	cout << "Tiled " << grid.image_width << "x" << grid.image_height << " on the "
+		<< backend->name() << ": " << stats.tiles << " tiles of up to "
+		<< grid.max_region_width << "x" << grid.max_region_height << " (halo "
+		<< grid.halo << "), " << stats.max_in_flight << " in flight, "
+		<< tile_memory / (1024.0 * 1024.0) << " MiB of tiles, "
+		<< stats.seconds << " s, " << stats.mpixels_per_second << " Mpixel/s" << endl;
+
+	if (!stats.written) {
+		cerr << "Could not write " << options->out_path << endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool run_split(
+	application* app,
+	const app_options* options,
+	const split_options* split
+) {
+	vector<application*> others;
+	vector<gpu_split_device*> gpus;
+	vector<cpu_compute_device*> cpus;
+	vector<compute_device*> devices;
+	app_options other_options;
+	application* other;
+	unsigned int num_adapters;
+	gpu_split_device* gpu;
+	unsigned int cpu_threads;
+	device_set set;
+	split_dispatch_stats stats;
+	cpu_dispatch_desc dispatch;
+	cpu_footprint footprint;
+	vector<unsigned char> pixels;
+	vector<unsigned char> expected;
+	cpu_texture output;
+	cpu_texture reference;
+	cpu_executor reference_cpu;
+	const float* got;
+	const float* want;
+	float max_error;
+
+	if (split->image_width == 0 || split->image_height == 0) {
+		cerr << "A split job needs an image size." << endl;
+		return false;
+	}
+
+	//
+	// app's adapter, then every other usable adapter, before or after
+	// it, each with an application of its own. One that comes up
+	// without a device is left out; the ones after it are still tried.
+	//
+
+	if (app->cpu == NULL) {
+		others.push_back(app);
+
+		num_adapters = (unsigned int)get_usable_adapters(create_dx12_factory(), options->probes).size();
+
+		for (unsigned int index = 0; index < num_adapters; index++) {
+			if (index == options->adapter_index) {
+				continue;
+			}
+
+			other_options = *options;
+			other_options.adapter_index = index;
+			other_options.trace_path = NULL;
+
+			other = new application;
+			initialize_application(other, &other_options);
+
+			if (other->cpu != NULL) {
+				cerr << "Adapter " << index << " has no device, leaving it out of the split." << endl;
+				shutdown_app(other);
+				delete other;
+				continue;
+			}
+
+			others.push_back(other);
+		}
+	}
+
+	for (application* adapter_app : others) {
+		gpu = new gpu_split_device;
+
+		try {
+			initialize_gpu_split_device(gpu, adapter_app, split->image_width, split->image_height);
+		}
+		catch (const exception&) {
+			shutdown_gpu_split_device(gpu);
+			delete gpu;
+			cerr << "Could not set up " << adapter_app->dx12->adapter_key << " for the split." << endl;
+			continue;
+		}
+
+		gpus.push_back(gpu);
+		devices.push_back(gpu);
+	}
+
+	//
+	// The CPU devices share the cores between them.
+	//
+
+	cpu_threads = thread::hardware_concurrency();
+
+	if (!split->cpu_slowdowns.empty()) {
+		cpu_threads /= (unsigned int)split->cpu_slowdowns.size();
+	}
+
+	for (double slowdown : split->cpu_slowdowns) {
+		cpus.push_back(new cpu_compute_device);
+		initialize_cpu_compute_device(cpus.back(), cpu_threads == 0 ? 1 : cpu_threads, slowdown);
+		devices.push_back(cpus.back());
+	}
+
+	if (devices.empty()) {
+		cerr << "Nothing to split the job between. Add CPU devices with --split-cpu-speeds." << endl;
+
+		for (size_t i = 1; i < others.size(); i++) {
+			shutdown_app(others[i]);
+			delete others[i];
+		}
+
+		return false;
+	}
+
+	//
+	// The whole image, and what one dispatch of it on the CPU gives to
+	// check the gathered bands against.
+	//
+
+	footprint = cpu_readback_footprint(split->image_width, split->image_height, CPU_FLOAT4_SIZE);
+	dispatch = cpu_hello_compute_dispatch(split->image_width, split->image_height);
+
+	pixels.assign((size_t)footprint.total_size, 0);
+	output = { pixels.data(), split->image_width, split->image_height, footprint.row_pitch, CPU_TEXEL_R32G32B32A32_FLOAT };
+
+	expected.assign((size_t)footprint.total_size, 0);
+	reference = { expected.data(), split->image_width, split->image_height, footprint.row_pitch, CPU_TEXEL_R32G32B32A32_FLOAT };
+
+	initialize_cpu_executor(&reference_cpu, 0);
+	cpu_dispatch_hello_compute(&reference_cpu, &reference, &dispatch);
+
+	initialize_device_set(&set, devices, options->probes);
+
+	for (unsigned int i = 0; i < (split->iterations == 0 ? 1 : split->iterations); i++) {
+		stats = run_split_dispatch(&set, &dispatch, &output);
+
+		cout << "Dispatch " << i << ": " << stats.makespan * 1000.0 << " ms, imbalance "
+			<< stats.imbalance << endl;
+
+		for (size_t d = 0; d < devices.size(); d++) {
+			cout << "\t" << devices[d]->name() << ": group rows "
+				<< stats.bands[d].first_group_y << "+" << stats.bands[d].group_count_y
+				<< ", " << stats.seconds[d] * 1000.0 << " ms, "
+				<< set.throughput[d] << " rows/s" << endl;
+		}
+	}
+
+	//
+	// The GPU's divide isn't exact, so the bands are checked to within
+	// a few ulps of the CPU's.
+	//
+
+	max_error = 0.0f;
+
+	for (unsigned int y = 0; y < split->image_height; y++) {
+		got = (const float*)(pixels.data() + (size_t)y * footprint.row_pitch);
+		want = (const float*)(expected.data() + (size_t)y * footprint.row_pitch);
+
+		for (unsigned int x = 0; x < split->image_width * 4; x++) {
+			if (fabsf(got[x] - want[x]) > max_error) {
+				max_error = fabsf(got[x] - want[x]);
+			}
+		}
+	}
+
+	cout << "Split " << split->image_width << "x" << split->image_height << " between "
+		<< devices.size() << " devices, max error " << max_error << endl;
+
+	if (options->probes != NULL) {
+		store_device_set_probes(&set, options->probes);
+	}
+
+	for (gpu_split_device* device : gpus) {
+		shutdown_gpu_split_device(device);
+		delete device;
+	}
+
+	for (cpu_compute_device* device : cpus) {
+		delete device;
+	}
+
+	for (size_t i = 1; i < others.size(); i++) {
+		shutdown_app(others[i]);
+		delete others[i];
+	}
+
+	return max_error <= 1.0e-5f;
+}
+
+bool run_manifest(application* app, const char* path) {
+	vector<job_desc> jobs;
+	vector<job_result> results;
+	string error;
+	cpu_job_backend cpu;
+	gpu_job_backend gpu;
+
+	if (!load_job_manifest(path, &jobs, &error)) {
+		cerr << "Bad manifest " << path << ": " << error << endl;
+		return false;
+	}
+
+	if (app == NULL || app->cpu != NULL) {
+		initialize_cpu_job_backend(&cpu, 0);
+		results = run_jobs(&cpu, jobs, stderr);
+	}
+	else {
+		initialize_gpu_job_backend(&gpu, app);
+		results = run_jobs(&gpu, jobs, stderr);
+		shutdown_gpu_job_backend(&gpu);
+	}
+
+	print_job_results(results, stdout);
+
+	for (const job_result& result : results) {
+		if (!result.ok) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+	Records run_compute_graph's two passes.
+*/
+struct hello_graph_recorder : graph_pass_recorder {
+	application* app;
+	compute_buffer* cb;
+	unsigned int dispatch;
+	unsigned int copy;
+
+	void record_pass(
+		gpu_compute_graph* executor,
+		const unsigned int pass,
+		ID3D12GraphicsCommandList* command_list
+	) override {
+		if (pass == dispatch) {
+			record_dispatch(app, command_list, cb);
+		}
+		else if (pass == copy) {
+			record_readback_copy(command_list, cb);
+		}
+	}
+};
+
+bool run_compute_graph(
+	application* app,
+	const unsigned int iterations,
+	const char* dot_path
+) {
+	compute_graph graph;
+	gpu_compute_graph executor;
+	hello_graph_recorder recorder;
+	compute_buffer* cb;
+	unsigned int buffer;
+	unsigned int readback;
+	string error;
+	queue_ticket copy_done;
+	FILE* dot;
+
+	if (app->cpu != NULL) {
+		cerr << "--graph needs a device." << endl;
+		return false;
+	}
+
+	cb = app->buffer;
+
+	//
+	// The buffer starts wherever the tracker has it. The readback buffer
+	// is always a copy destination.
+	//
+
+	initialize_gpu_compute_graph(&executor, app->dx12, &graph);
+
+	buffer = import_gpu_graph_resource(&executor, "buffer", cb->buffer.Get(), D3D12_RESOURCE_STATE_COMMON, false);
+	readback = import_gpu_graph_resource(&executor, "readback", cb->readback_buffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, true);
+	mark_graph_output(&graph, readback);
+
+	recorder.app = app;
+	recorder.cb = cb;
+
+	recorder.dispatch = add_graph_pass(&graph, "dispatch", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, recorder.dispatch, buffer, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	recorder.copy = add_graph_pass(&graph, "copy to readback", GRAPH_PASS_COPY, 1.0);
+	add_graph_access(&graph, recorder.copy, buffer, GRAPH_USAGE_COPY_SOURCE);
+	add_graph_access(&graph, recorder.copy, readback, GRAPH_USAGE_COPY_DEST);
+
+	if (!compile_gpu_compute_graph(&executor, &error)) {
+		cerr << "The compute graph didn't compile: " << error << endl;
+		return false;
+	}
+
+	cout << "Compute graph: " << executor.compiled.steps.size() << " steps in "
+		<< executor.compiled.batches.size() << " batches, "
+		<< executor.compiled.stats.transitions << " transitions, "
+		<< executor.compiled.stats.waits << " cross-queue waits" << endl;
+
+	if (dot_path != NULL) {
+#if defined(_MSC_VER)
+		if (fopen_s(&dot, dot_path, "w") != 0) {
+			dot = NULL;
+		}
+#else
+		dot = fopen(dot_path, "w");
+#endif
+
+		if (dot == NULL) {
+			cerr << "Could not write " << dot_path << endl;
+		}
+		else {
+			write_compute_graph_dot(&graph, &executor.compiled, dot);
+			fclose(dot);
+		}
+	}
+
+	//
+	// The copy's batch is the one the readback waits for.
+	//
+
+	for (unsigned int i = 0; i < iterations; i++) {
+		run_gpu_compute_graph(&executor, &recorder);
+
+		copy_done = gpu_graph_pass_ticket(&executor, recorder.copy);
+		commit_readback_copy(cb, app->dx12, &copy_done);
+	}
+
+	shutdown_gpu_compute_graph(&executor);
+
+	return true;
+}
+
+/*
+	One kernel, with what it binds and the root signature and pipeline
+	built for it. The indirect chain's raw buffers are root UAVs and its
+	constant buffers root constants; the layout rules make them so for a
+	kernel that small.
+*/
+struct kernel_pipeline {
+	shader_reflection kernel;
+	root_layout layout;
+	ComPtr<ID3D12RootSignature> root_signature;
+	ComPtr<ID3D12PipelineState> pipeline_state;
+};
+
+static kernel_pipeline build_kernel_pipeline(
+	application* app,
+	const char* source_path,
+	const char* entry_point,
+	const shader_defines& defines
+) {
+	kernel_pipeline pipeline;
+	vector<unsigned char> bytecode;
+	shader_cache_key shader_key;
+	uint64_t root_signature_hash;
+
+	bytecode = compile_kernel_file(app, source_path, entry_point, defines, &shader_key);
+
+	if (!reflect_compute_shader(bytecode, &pipeline.kernel) || !build_root_layout(&pipeline.kernel, &pipeline.layout)) {
+		throw exception();
+	}
+
+	pipeline.root_signature = get_root_signature(app->root_signatures, app->dx12, &pipeline.layout, &root_signature_hash);
+
+	pipeline.pipeline_state = load_or_create_compute_pipeline(
+		app->pipelines,
+		app->dx12,
+		pipeline.root_signature.Get(),
+		root_signature_hash,
+		bytecode,
+		&shader_key
+	);
+
+	return pipeline;
+}
+
+/*
+	Binds u0 to u4 to buffers and b0 to constants, whichever of them
+	the kernel uses, with every buffer it uses in UAV. b1 is left to
+	the caller.
+*/
+static void bind_chain_pipeline(
+	dx12_handler* dx12,
+	ID3D12GraphicsCommandList* command_list,
+	const kernel_pipeline* pipeline,
+	compute_buffer* const* buffers,
+	const uint32_t constants[4]
+) {
+	unsigned int parameter;
+	unsigned int table_offset;
+
+	command_list->SetComputeRootSignature(pipeline->root_signature.Get());
+	command_list->SetPipelineState(pipeline->pipeline_state.Get());
+
+	for (const shader_binding& binding : pipeline->kernel.bindings) {
+		if (!find_root_binding(&pipeline->layout, binding.kind, binding.shader_register, binding.space, &parameter, &table_offset)) {
+			throw exception();
+		}
+
+		if (binding.kind == SHADER_BINDING_UAV) {
+			if (pipeline->layout.parameters[parameter].kind != ROOT_PARAMETER_UAV) {
+				throw exception();
+			}
+
+			require_resource_state(
+				&dx12->resource_states,
+				buffers[binding.shader_register]->buffer.Get(),
+				ALL_TRACKED_SUBRESOURCES,
+				D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+				true
+			);
+
+			command_list->SetComputeRootUnorderedAccessView(parameter, buffers[binding.shader_register]->buffer->GetGPUVirtualAddress());
+		}
+		else if (binding.kind == SHADER_BINDING_CBV && binding.shader_register == 0) {
+			if (pipeline->layout.parameters[parameter].kind != ROOT_PARAMETER_CONSTANTS) {
+				throw exception();
+			}
+
+			command_list->SetComputeRoot32BitConstants(parameter, 4, constants, 0);
+		}
+	}
+
+	record_resource_barriers(dx12, command_list);
+}
+
+/*
+	Records the chain. With indirect, process is one ExecuteIndirect on
+	what write_arguments wrote. Without it, the batch ends after
+	write_arguments, the CPU waits for it and reads the survivor count
+	back, and records process's dispatches itself: the stall indirect
+	dispatch is there to avoid.
+*/
+static void record_indirect_chain(
+	application* app,
+	const kernel_pipeline pipelines[4],
+	ID3D12CommandSignature* command_signature,
+	compute_buffer* const* buffers,
+	const indirect_chain_options* options,
+	const bool indirect
+) {
+	dx12_handler* dx12;
+	dx12_queue* queue;
+	ComPtr<ID3D12GraphicsCommandList> command_list;
+	unsigned int max_commands;
+	unsigned int constants_parameter;
+	unsigned int table_offset;
+	uint32_t constants[4];
+	queue_ticket copy_done;
+	unsigned int slot;
+	uint32_t survivors;
+
+	dx12 = app->dx12;
+	queue = dx12->direct_queue;
+	max_commands = indirect_chain_max_commands(options);
+
+	constants[0] = options->num_items;
+	constants[1] = options->seed;
+	constants[2] = options->keep_per_mille;
+	constants[3] = max_commands;
+
+	command_list = begin_command_batch(queue, NULL);
+
+	ID3D12DescriptorHeap* heaps[] = { dx12->cbv_srv_uav_heap->heap.Get() };
+	command_list->SetDescriptorHeaps(1, heaps);
+
+	bind_chain_pipeline(dx12, command_list.Get(), &pipelines[0], buffers, constants);
+	command_list->Dispatch(1, 1, 1);
+
+	bind_chain_pipeline(dx12, command_list.Get(), &pipelines[1], buffers, constants);
+	command_list->Dispatch((options->num_items + INDIRECT_CHAIN_GROUP_SIZE - 1) / INDIRECT_CHAIN_GROUP_SIZE, 1, 1);
+
+	bind_chain_pipeline(dx12, command_list.Get(), &pipelines[2], buffers, constants);
+	command_list->Dispatch((max_commands + INDIRECT_CHAIN_GROUP_SIZE - 1) / INDIRECT_CHAIN_GROUP_SIZE, 1, 1);
+
+	find_root_binding(&pipelines[3].layout, SHADER_BINDING_CBV, 1, 0, &constants_parameter, &table_offset);
+
+	if (indirect) {
+		bind_chain_pipeline(dx12, command_list.Get(), &pipelines[3], buffers, constants);
+
+		record_execute_indirect(
+			dx12,
+			command_list.Get(),
+			command_signature,
+			max_commands,
+			buffers[2]->buffer.Get(),
+			0,
+			buffers[3]->buffer.Get(),
+			0
+		);
+
+		submit_command_batch(dx12, queue, NULL, 0);
+		return;
+	}
+
+	require_resource_state(&dx12->resource_states, buffers[0]->buffer.Get(), ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_COPY_SOURCE, false);
+	record_resource_barriers(dx12, command_list.Get());
+	record_readback_copy(command_list, buffers[0]);
+
+	copy_done = submit_command_batch(dx12, queue, NULL, 0);
+	commit_readback_copy(buffers[0], dx12, &copy_done);
+	flush_command_batches(queue);
+
+	slot = begin_readback(&buffers[0]->readback_slots);
+	survivors = *(const uint32_t*)readback_slot_data(buffers[0], slot);
+	end_readback(&buffers[0]->readback_slots, slot);
+
+	command_list = begin_command_batch(queue, NULL);
+	command_list->SetDescriptorHeaps(1, heaps);
+
+	bind_chain_pipeline(dx12, command_list.Get(), &pipelines[3], buffers, constants);
+
+	for (uint32_t first = 0; first < survivors; first += INDIRECT_CHAIN_ITEMS_PER_COMMAND) {
+		uint32_t command[INDIRECT_CHAIN_COMMAND_VALUES];
+
+		command[0] = first;
+		command[1] = survivors - first < INDIRECT_CHAIN_ITEMS_PER_COMMAND ? survivors - first : INDIRECT_CHAIN_ITEMS_PER_COMMAND;
+
+		command_list->SetComputeRoot32BitConstants(constants_parameter, INDIRECT_CHAIN_COMMAND_VALUES, command, 0);
+		command_list->Dispatch((command[1] + INDIRECT_CHAIN_GROUP_SIZE - 1) / INDIRECT_CHAIN_GROUP_SIZE, 1, 1);
+	}
+
+	submit_command_batch(dx12, queue, NULL, 0);
+}
+
+bool run_indirect_chain(
+	application* app,
+	const unsigned int num_items,
+	const unsigned int keep_per_mille
+) {
+	const unsigned int rounds = 20;
+	const char* entry_points[] = { "reset", "cull", "write_arguments", "process" };
+	indirect_chain_options options;
+	indirect_chain_buffers cpu_buffers;
+	indirect_chain_buffers gpu_buffers;
+	vector<uint32_t>* readbacks[5];
+	uint64_t sizes[5];
+	kernel_pipeline pipelines[4];
+	compute_buffer* buffers[5];
+	ComPtr<ID3D12CommandSignature> command_signature;
+	indirect_signature signature;
+	unsigned int constants_parameter;
+	unsigned int table_offset;
+	dx12_handler* dx12;
+	dx12_queue* queue;
+	ComPtr<ID3D12GraphicsCommandList> command_list;
+	queue_ticket copy_done;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+	double seconds[2];
+	string error;
+	bool ok;
+
+	ok = true;
+
+	options.num_items = num_items == 0 ? 1 : num_items;
+	options.seed = 1234;
+	options.keep_per_mille = keep_per_mille > 1000 ? 1000 : keep_per_mille;
+
+	//
+	// The whole chain on the CPU, argument buffer and all.
+	//
+
+	initialize_indirect_chain_buffers(&cpu_buffers, &options);
+
+	start = chrono::steady_clock::now();
+
+	if (!run_indirect_chain_on_cpu(&cpu_buffers, &options, &error) || !check_indirect_chain(&cpu_buffers, &options, &error)) {
+		cerr << "The indirect chain went wrong on the CPU: " << error << endl;
+		ok = false;
+	}
+
+	elapsed = chrono::steady_clock::now() - start;
+
+	printf(
+		"Indirect chain: %u items, %u survive in %u commands\n  CPU: %.3f ms\n",
+		options.num_items,
+		cpu_buffers.counter[0],
+		cpu_buffers.command_count[0],
+		elapsed.count() * 1000.0
+	);
+
+	if (app->cpu != NULL) {
+		printf("No hardware adapter, skipping the GPU part.\n");
+		return ok;
+	}
+
+	dx12 = app->dx12;
+	queue = dx12->direct_queue;
+
+	for (unsigned int i = 0; i < 4; i++) {
+		pipelines[i] = build_kernel_pipeline(app, "./indirect_chain.hlsl", entry_points[i], shader_defines());
+	}
+
+	if (!find_root_binding(&pipelines[3].layout, SHADER_BINDING_CBV, 1, 0, &constants_parameter, &table_offset)
+		|| pipelines[3].layout.parameters[constants_parameter].kind != ROOT_PARAMETER_CONSTANTS) {
+		cerr << "process's command_constants aren't root constants." << endl;
+		return false;
+	}
+
+	signature = indirect_chain_signature(constants_parameter);
+	command_signature = create_indirect_command_signature(dx12, &signature, pipelines[3].root_signature.Get());
+
+	//
+	// u0 to u4, in the order indirect_chain_buffers has them.
+	//
+
+	initialize_indirect_chain_buffers(&gpu_buffers, &options);
+
+	readbacks[0] = &gpu_buffers.counter;
+	readbacks[1] = &gpu_buffers.survivors;
+	readbacks[2] = &gpu_buffers.arguments;
+	readbacks[3] = &gpu_buffers.command_count;
+	readbacks[4] = &gpu_buffers.output;
+
+	for (unsigned int i = 0; i < 5; i++) {
+		sizes[i] = readbacks[i]->size() * sizeof(uint32_t);
+
+		buffers[i] = new compute_buffer;
+		initialize_raw_compute_buffer(buffers[i], dx12, sizes[i]);
+	}
+
+	//
+	// Time both ways, the first round of each not counted.
+	//
+
+	for (unsigned int way = 0; way < 2; way++) {
+		seconds[way] = 0.0;
+
+		for (unsigned int r = 0; r <= rounds; r++) {
+			start = chrono::steady_clock::now();
+
+			record_indirect_chain(app, pipelines, command_signature.Get(), buffers, &options, way == 0);
+			flush_command_batches(queue);
+
+			elapsed = chrono::steady_clock::now() - start;
+
+			if (r > 0) {
+				seconds[way] += elapsed.count();
+			}
+		}
+	}
+
+	printf("  GPU, ExecuteIndirect:          %.3f ms\n", seconds[0] * 1000.0 / rounds);
+	printf("  GPU, reading the count back:   %.3f ms\n", seconds[1] * 1000.0 / rounds);
+
+	//
+	// One more indirect run, and everything it wrote read back.
+	//
+
+	record_indirect_chain(app, pipelines, command_signature.Get(), buffers, &options, true);
+
+	command_list = begin_command_batch(queue, NULL);
+
+	for (unsigned int i = 0; i < 5; i++) {
+		require_resource_state(&dx12->resource_states, buffers[i]->buffer.Get(), ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_COPY_SOURCE, false);
+	}
+
+	record_resource_barriers(dx12, command_list.Get());
+
+	for (unsigned int i = 0; i < 5; i++) {
+		record_readback_copy(command_list, buffers[i]);
+	}
+
+	copy_done = submit_command_batch(dx12, queue, NULL, 0);
+
+	for (unsigned int i = 0; i < 5; i++) {
+		commit_readback_copy(buffers[i], dx12, &copy_done);
+	}
+
+	flush_command_batches(queue);
+
+	for (unsigned int i = 0; i < 5; i++) {
+		unsigned int slot = begin_readback(&buffers[i]->readback_slots);
+
+		memcpy(readbacks[i]->data(), readback_slot_data(buffers[i], slot), (size_t)sizes[i]);
+		end_readback(&buffers[i]->readback_slots, slot);
+	}
+
+	if (!check_indirect_chain(&gpu_buffers, &options, &error)) {
+		cerr << "The indirect chain went wrong on the GPU: " << error << endl;
+		ok = false;
+	}
+	else {
+		//
+		// The GPU's own argument buffer and survivors, replayed on the CPU,
+		// have to come out the same as what the GPU did with them.
+		//
+
+		cpu_buffers = gpu_buffers;
+		fill(cpu_buffers.output.begin(), cpu_buffers.output.end(), 0);
+
+		if (!run_indirect_chain_process(&cpu_buffers, &options, &error) || cpu_buffers.output != gpu_buffers.output) {
+			cerr << "The GPU's argument buffer runs differently on the CPU: " << error << endl;
+			ok = false;
+		}
+		else {
+			printf("  The GPU's argument buffer runs the same on the CPU.\n");
+		}
+	}
+
+	for (compute_buffer* cb : buffers) {
+		shutdown_compute_buffer(cb, dx12);
+		delete cb;
+	}
+
+	return ok;
+}
+
+bool run_wave_reduce(application* app, const unsigned int num_items) {
+	const unsigned int rounds = 20;
+	const char* const source_path = "./wave_reduce.hlsl";
+	const char* const variant_names[2] = { "float", "half" };
+	shader_defines variants[2];
+	uint32_t constants[2];
+	unsigned int group_size;
+	unsigned int num_groups;
+	vector<double> expected;
+	vector<float> sums;
+	kernel_pipeline pipeline;
+	const embedded_shader* embedded;
+	compute_buffer partial_sums;
+	unsigned int sums_parameter;
+	unsigned int constants_parameter;
+	unsigned int table_offset;
+	dx12_handler* dx12;
+	dx12_queue* queue;
+	ComPtr<ID3D12GraphicsCommandList> command_list;
+	queue_ticket copy_done;
+	unsigned int slot;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+	double seconds;
+	unsigned int wrong;
+	string reason;
+	bool ok;
+
+	if (app->cpu != NULL) {
+		printf("Wave reduce: no hardware adapter.\n");
+		return false;
+	}
+
+	dx12 = app->dx12;
+	queue = dx12->direct_queue;
+
+	constants[0] = num_items == 0 ? 1 : num_items;
+	constants[1] = 1234;
+
+	variants[1].push_back(make_pair(string("HALF_PRECISION"), string("1")));
+
+	printf("Wave reduce: %u items, shader model %s\n", constants[0], describe_shader_model_support(&app->shader_support).c_str());
+
+	ok = true;
+
+	for (unsigned int v = 0; v < 2; v++) {
+		embedded = find_runnable_dxil(app, source_path, "main", variants[v], &reason);
+
+		if (embedded == NULL) {
+			printf("  %s: skipped, its DXIL %s.\n", variant_names[v], reason.c_str());
+			continue;
+		}
+
+		pipeline = build_kernel_pipeline(app, source_path, "main", variants[v]);
+
+		//
+		// One partial sum per group. The CPU adds up the same values
+		// (see wave_reduce.hlsl) per group, in double.
+		//
+
+		group_size = pipeline.kernel.group_size[0];
+		num_groups = (constants[0] + group_size - 1) / group_size;
+
+		expected.assign(num_groups, 0.0);
+
+		for (uint32_t i = 0; i < constants[0]; i++) {
+			expected[i / group_size] += (indirect_chain_hash(i ^ constants[1]) & 1023) / 1024.0;
+		}
+
+		if (!find_root_binding(&pipeline.layout, SHADER_BINDING_UAV, 0, 0, &sums_parameter, &table_offset)
+			|| pipeline.layout.parameters[sums_parameter].kind != ROOT_PARAMETER_UAV
+			|| !find_root_binding(&pipeline.layout, SHADER_BINDING_CBV, 0, 0, &constants_parameter, &table_offset)) {
+			cerr << "wave_reduce.hlsl doesn't bind u0 as a root UAV and b0." << endl;
+			return false;
+		}
+
+		initialize_raw_compute_buffer(&partial_sums, dx12, num_groups * sizeof(float));
+
+		//
+		// Time it, the first round not counted, then read back what the
+		// last round wrote.
+		//
+
+		seconds = 0.0;
+
+		for (unsigned int r = 0; r <= rounds; r++) {
+			start = chrono::steady_clock::now();
+
+			command_list = begin_command_batch(queue, NULL);
+			command_list->SetComputeRootSignature(pipeline.root_signature.Get());
+			command_list->SetPipelineState(pipeline.pipeline_state.Get());
+
+			require_resource_state(&dx12->resource_states, partial_sums.buffer.Get(), ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+			record_resource_barriers(dx12, command_list.Get());
+
+			command_list->SetComputeRootUnorderedAccessView(sums_parameter, partial_sums.buffer->GetGPUVirtualAddress());
+
+			if (pipeline.layout.parameters[constants_parameter].kind == ROOT_PARAMETER_CONSTANTS) {
+				command_list->SetComputeRoot32BitConstants(constants_parameter, 2, constants, 0);
+			}
+			else {
+				command_list->SetComputeRootConstantBufferView(
+					constants_parameter,
+					upload_dispatch_constants(queue->uploads, constants, sizeof(constants))
+				);
+			}
+
+			command_list->Dispatch(num_groups, 1, 1);
+
+			submit_command_batch(dx12, queue, NULL, 0);
+			flush_command_batches(queue);
+
+			elapsed = chrono::steady_clock::now() - start;
+
+			if (r > 0) {
+				seconds += elapsed.count();
+			}
+		}
+
+		command_list = begin_command_batch(queue, NULL);
+
+		require_resource_state(&dx12->resource_states, partial_sums.buffer.Get(), ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_COPY_SOURCE, false);
+		record_resource_barriers(dx12, command_list.Get());
+		record_readback_copy(command_list, &partial_sums);
+
+		copy_done = submit_command_batch(dx12, queue, NULL, 0);
+		commit_readback_copy(&partial_sums, dx12, &copy_done);
+		flush_command_batches(queue);
+
+		sums.resize(num_groups);
+
+		slot = begin_readback(&partial_sums.readback_slots);
+		memcpy(sums.data(), readback_slot_data(&partial_sums, slot), num_groups * sizeof(float));
+		end_readback(&partial_sums.readback_slots, slot);
+
+		shutdown_compute_buffer(&partial_sums, dx12);
+
+		//
+		// The values are on a 1/1024 grid and a group's sum is under 256,
+		// so a float sum is exact in any order. Half precision rounds each
+		// wave's running sum, so it only has to come close.
+		//
+
+		wrong = 0;
+
+		for (unsigned int g = 0; g < num_groups; g++) {
+			double error = fabs(sums[g] - expected[g]);
+
+			if (v == 0 ? error != 0.0 : error > max(0.02 * expected[g], 1.0 / 16.0)) {
+				if (wrong == 0) {
+					cerr << "  group " << g << " summed to " << sums[g] << ", not " << expected[g] << endl;
+				}
+
+				wrong++;
+			}
+		}
+
+		printf(
+			"  %s (%s, %u bytes of DXIL): %.3f ms, %s\n",
+			variant_names[v],
+			embedded->profile,
+			(unsigned int)embedded->size,
+			seconds * 1000.0 / rounds,
+			wrong == 0 ? "every group's sum matches" : (to_string(wrong) + " of " + to_string(num_groups) + " groups wrong").c_str()
+		);
+
+		ok = ok && wrong == 0;
+	}
+
+	return ok;
+}
+
+bool run_permutations(application* app, const unsigned int num_threads) {
+	const unsigned int num_lookups = 1 << 20;
+	permutation_set set;
+	permutation_table<permutation_pipeline> table;
+	permutation_compile_stats stats;
+	vector<permutation_key> keys;
+	unsigned int tiled_axis;
+	unsigned int shader_hits;
+	unsigned int shader_misses;
+	unsigned int pipeline_hits;
+	unsigned int pipeline_misses;
+	unsigned int found;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+	bool ok;
+
+	if (app->cpu != NULL) {
+		cerr << "--permutations needs a device." << endl;
+		return false;
+	}
+
+	hello_compute_permutations(&set, "cs_5_1");
+
+	shader_hits = app->pipelines->shaders.hits;
+	shader_misses = app->pipelines->shaders.misses;
+	pipeline_hits = app->pipelines->pipeline_hits;
+	pipeline_misses = app->pipelines->pipeline_misses;
+
+	start = chrono::steady_clock::now();
+	ok = build_permutation_pipelines(app, &set, num_threads, &table, &stats);
+	elapsed = chrono::steady_clock::now() - start;
+
+	cout << count_permutations(&set) << " permutations of hello_compute on " << stats.threads << " thread(s): "
+		<< stats.compiled << " compiled, " << stats.failed << " failed" << endl;
+	cout << "  compile: " << stats.seconds * 1000.0 << " ms ("
+		<< stats.compile_seconds * 1000.0 << " ms of compiling, shader cache "
+		<< app->pipelines->shaders.hits - shader_hits << " hits, "
+		<< app->pipelines->shaders.misses - shader_misses << " misses)" << endl;
+	cout << "  pipelines: " << (elapsed.count() - stats.seconds) * 1000.0 << " ms (pipeline library "
+		<< app->pipelines->pipeline_hits - pipeline_hits << " hits, "
+		<< app->pipelines->pipeline_misses - pipeline_misses << " misses)" << endl;
+
+	//
+	// What the dispatch path does: flip an axis on the key it has, and
+	// find the pipeline.
+	//
+
+	keys = enumerate_permutations(&set);
+	tiled_axis = find_permutation_axis(&set, "TILED");
+	found = 0;
+
+	start = chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < num_lookups; i++) {
+		permutation_key key = with_permutation_choice(&set, keys[i % keys.size()], tiled_axis, i & 1);
+
+		if (find_permutation(&table, key) != NULL) {
+			found++;
+		}
+	}
+
+	elapsed = chrono::steady_clock::now() - start;
+
+	cout << "  lookup: " << elapsed.count() * 1.0e9 / num_lookups << " ns ("
+		<< found << " of " << num_lookups << " found)" << endl;
+
+	return ok;
+}
+
+string hello_compute_tuning_key(application* app) {
+	shader_cache_key kernel_key;
+
+	//
+	// Only the source and the format are hashed, not the group size
+	// being tuned.
+	//
+
+	if (!make_shader_cache_key("./hello_compute.hlsl", shader_defines(), "main", "cs_5_1", 0, &kernel_key)) {
+		cerr << "Could not read hello_compute.hlsl." << endl;
+		throw std::exception();
+	}
+
+	return make_tuning_key(
+		app->dx12->vendor_id,
+		app->dx12->device_id,
+		hash_string(cpu_texel_format_name(app->output_format), kernel_key.hash)
+	);
+}
+
+bool tune_threadgroups(
+	application* app,
+	const tuning_options* options,
+	tuning_database* database
+) {
+	gpu_bench_backend backend;
+	tuning_result result;
+	tuning_entry entry;
+	bench_case test;
+	string key;
+
+	if (app->cpu != NULL) {
+		cerr << "--tune needs a device." << endl;
+		return false;
+	}
+
+	test.width = app->buffer->width;
+	test.height = app->buffer->height;
+	test.format = BENCH_FORMAT_R32G32B32A32_FLOAT;
+	test.layout = BENCH_LAYOUT_TEXTURE;
+	test.group_size_x = app->group_size.x;
+	test.group_size_y = app->group_size.y;
+
+	for (unsigned int f = 0; f < BENCH_FORMAT_COUNT; f++) {
+		if (bench_format_to_cpu((bench_format)f) == app->output_format) {
+			test.format = (bench_format)f;
+		}
+	}
+
+	key = hello_compute_tuning_key(app);
+
+	cout << "Tuning hello_compute (" << test.width << "x" << test.height << " "
+		<< bench_format_name(test.format) << ") on " << key << ": "
+		<< options->warmup_iterations << " warmup, " << options->trials << " trials per group size" << endl;
+
+	initialize_gpu_bench_backend(&backend, app);
+	result = tune_group_shape(&backend, &test, options, stderr);
+	shutdown_gpu_bench_backend(&backend);
+
+	print_tuning_result(&result, stdout);
+
+	if (!result.found) {
+		cerr << "No group size could run." << endl;
+		return false;
+	}
+
+	entry.shape = result.candidates[result.best].shape;
+	entry.median_ms = result.candidates[result.best].median_ms;
+	entry.baseline_ms = result.candidates[0].skipped ? 0.0 : result.candidates[0].median_ms;
+
+	store_tuning_entry(database, key, &entry);
+
+	cout << "Picked " << entry.shape.x << "x" << entry.shape.y << "." << endl;
+
+	return true;
+}
+
+void shutdown_app(application* app) {
+	delete app->profile;
+
+	if (app->cpu != NULL) {
+		shutdown_compute_buffer(app->buffer, app->dx12);
+		delete app->cpu;
+		return;
+	}
+
+	shutdown_pipeline_cache(app->pipelines);
+	delete app->pipelines;
+
+	app->pipeline_state.Reset();
+	app->root_signature.Reset();
+	shutdown_root_signature_cache(app->root_signatures);
+	delete app->root_signatures;
+
+	if (app->gpu_profile != NULL) {
+		shutdown_gpu_profiler(app->gpu_profile);
+		delete app->gpu_profile;
+	}
+
+	//
+	// The buffers live in the handler's heaps, so they go first, once
+	// the GPU is done with them.
+	//
+
+	wait_for_previous_frame(app->dx12);
+
+	for (unsigned int i = 0; i < app->num_buffers; i++) {
+		shutdown_compute_buffer(app->buffers[i], app->dx12);
+	}
+
 	shutdown_directx_12(app->dx12);
 }
@@ -11,25 +11,348 @@
 
 #include "dx12_handler.h"
 #include "compute_buffer.h"
+#include "cpu_executor.h"
+#include "result_formatter.h"
+#include "pipeline_cache.h"
+#include "root_signature_builder.h"
+#include "compute_batch.h"
+#include "gpu_profiler.h"
+#include "benchmark_suite.h"
+#include "tiler.h"
+#include "readback_decoder.h"
+#include "job_runner.h"
+#include "compute_graph.h"
+#include "shader_permutations.h"
+#include "threadgroup_tuner.h"
+#include "dxil_container.h"
+#include "embedded_shaders.h"
+
+/*
+	Knobs set from the command line.
+*/
+struct app_options {
+	result_print_mode print_mode;
+	unsigned int frames_in_flight;
+	unsigned int iterations;
+	bool async_queues;
+	bool clear_shader_cache;
+
+	// The format the kernel writes. Anything but float4 is decoded back
+	// to float4 for printing.
+	cpu_texel_format output_format;
+
+	// Where to write a Chrome trace of the run. NULL to not profile.
+	const char* trace_path;
+
+	// Which of the usable adapters to run on, biggest first.
+	unsigned int adapter_index;
+
+	// What is known about the adapters from earlier runs. May be NULL.
+	device_probe_cache* probes;
+
+	// Group sizes tuned on earlier runs. May be NULL.
+	tuning_database* tuning;
+
+	// Whether kernels built into the binary as DXIL are used where the
+	// device can run them. Without, every kernel is compiled with FXC.
+	bool use_dxil;
+};
+
+/*
+	A tiled job: the kernel over an image of image_width by
+	image_height, max_tile texels square at most (halo included), into
+	a raw float4 file at out_path.
+*/
+struct tiled_options {
+	unsigned int image_width;
+	unsigned int image_height;
+	unsigned int max_tile;
+	unsigned int halo;
+	unsigned int tiles_in_flight;
+	const char* out_path;
+};
+
+/*
+	A split job: one dispatch over an image of image_width by
+	image_height, cut between every usable adapter and a CPU device per
+	entry of cpu_slowdowns, iterations times.
+*/
+struct split_options {
+	unsigned int image_width;
+	unsigned int image_height;
+	unsigned int iterations;
+	std::vector<double> cpu_slowdowns;
+};
+
+// How many GPU markers can be recorded between two read backs.
+const unsigned int GPU_PROFILER_MAX_MARKERS = 4096;
+
+// Where compiled shaders and the pipeline library are kept.
+const char* const SHADER_CACHE_DIRECTORY = "./shader_cache";
+
+// Where the device probe cache is kept.
+const char* const DEVICE_PROBE_CACHE_PATH = "./device_probes.txt";
+
+// Where tuned group sizes are kept.
+const char* const TUNING_DATABASE_PATH = "./threadgroup_tuning.txt";
 
 struct application {
 	dx12_handler* dx12;
+
+	// buffer is the one the most recent run wrote to. With async
+	// queues, runs alternate between the two buffers.
 	compute_buffer* buffer;
+	compute_buffer* buffers[2];
+	unsigned int num_buffers;
+	unsigned int next_buffer;
+
+	// Non-NULL when there is no hardware adapter and we run on the CPU.
+	cpu_executor* cpu;
+
+	// What the device can run, and whether embedded DXIL is used on it.
+	shader_model_support shader_support;
+	bool use_dxil;
+
+	// Whether read_back_data prints every element or just a summary.
+	result_print_mode print_mode;
+
+	// The format the buffers are in, and where read_back_data decodes
+	// them to when that isn't float4.
+	cpu_texel_format output_format;
+	std::vector<float> decoded;
 
 	ComPtr<ID3D12RootSignature> root_signature;
 	ComPtr<ID3D12PipelineState> pipeline_state;
-};
 
-struct pipeline_state_stream {
-	CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE root_sig;
-	CD3DX12_PIPELINE_STATE_STREAM_CS bytecode;
+	// The group size hello_compute was built with, and whether it came
+	// from the tuning database.
+	group_shape group_size;
+	bool group_size_tuned;
+
+	// What hello_compute.hlsl binds, and the root signature built from
+	// it. buffer_parameter is the root parameter holding u0.
+	shader_reflection kernel;
+	root_layout layout;
+	unsigned int buffer_parameter;
+	root_signature_cache* root_signatures;
+
+	// Hash of the serialized root signature. Part of the pipeline
+	// cache key.
+	uint64_t root_signature_hash;
+	pipeline_cache* pipelines;
+
+	// NULL unless profiling. gpu_profile is also NULL on the CPU path.
+	profiler* profile;
+	gpu_profiler* gpu_profile;
+	const char* trace_path;
 };
 
-void initialize_application(application* app);
+void default_app_options(app_options* options);
+void default_tiled_options(tiled_options* options);
+void default_split_options(split_options* options);
+void initialize_application(application* app, const app_options* options);
+std::vector<unsigned char> compile_kernel(
+	application* app,
+	const shader_defines& defines,
+	shader_cache_key* key
+);
+
+/*
+	compile_kernel for any kernel file and entry point. If the kernel
+	was built into the binary as DXIL with exactly these defines and the
+	device can run it, that is used and nothing is compiled. Otherwise
+	it is compiled with FXC, through the shader cache.
+*/
+std::vector<unsigned char> compile_kernel_file(
+	application* app,
+	const std::string& source_path,
+	const std::string& entry_point,
+	const shader_defines& defines,
+	shader_cache_key* key
+);
+
+/*
+	The embedded DXIL of source_path's entry_point with defines, if
+	there is some and app's device can run it. Otherwise NULL, with why
+	in reason.
+*/
+const embedded_shader* find_runnable_dxil(
+	application* app,
+	const std::string& source_path,
+	const std::string& entry_point,
+	const shader_defines& defines,
+	std::string* reason
+);
+
 ComPtr<ID3D12RootSignature> create_root_signature(application* app);
-ComPtr<ID3D12PipelineState> initialize_pipeline_state(application* app);
+ComPtr<ID3D12PipelineState> initialize_pipeline_state(
+	application* app,
+	const std::vector<unsigned char>& bytecode,
+	const shader_cache_key* key
+);
 
 void run_compute(application* app);
+void run_compute_async(application* app);
+void run_compute_on_cpu(application* app);
+void record_dispatch(
+	application* app,
+	ComPtr<ID3D12GraphicsCommandList> command_list,
+	compute_buffer* cb
+);
+void record_readback_copy(
+	ComPtr<ID3D12GraphicsCommandList> command_list,
+	compute_buffer* cb
+);
+
+/*
+	record_readback_copy for only the top left width by height texels
+	of cb (elements, for a structured or raw buffer, where height is
+	1). The slot keeps cb's row pitch, so it reads back the same way.
+*/
+void record_readback_region(
+	ComPtr<ID3D12GraphicsCommandList> command_list,
+	compute_buffer* cb,
+	const unsigned int width,
+	const unsigned int height
+);
 void read_back_data(application* app);
+void print_batch_stats(application* app);
+
+// Writes the trace and prints per-phase times, if profiling.
+void write_profile(application* app);
+
+/*
+	Times num_dispatches small dispatches recorded one per command list
+	(like run_compute) against the same dispatches in one compute_batch.
+	Without a device only the planner is measured.
+*/
+void benchmark_dispatch_batching(
+	application* app,
+	const unsigned int num_dispatches,
+	FILE* out
+);
+
+/*
+	Checks and times the recording pool on mock commands, then, with a
+	device, records batches of num_dispatches small dispatches on 1 to
+	8 threads and prints how fast the CPU gets through them.
+*/
+void benchmark_parallel_recording(
+	application* app,
+	const unsigned int num_dispatches,
+	FILE* out
+);
+
+/*
+	Runs the benchmark suite on the device, or on the CPU executor when
+	app is NULL or has no device. Prints the results, and writes them to
+	out_path (CSV or JSON) unless it is NULL.
+*/
+void benchmark_suite(
+	application* app,
+	const bench_suite_options* options,
+	const char* out_path
+);
+
+/*
+	Times the upload ring on a mock fence, then, if there is a device,
+	uploads into compute_buffers of a few sizes through the direct
+	queue's ring. app may be NULL.
+*/
+void benchmark_uploads(application* app, FILE* out);
+
+/*
+	Runs a tiled job on the device, or on the CPU executor without one.
+	Returns false if it couldn't be set up or the output couldn't be
+	written.
+*/
+bool run_tiled(application* app, const tiled_options* options);
+
+/*
+	Runs a split job on app's adapter, the other usable adapters and
+	the CPU devices asked for, and prints how each dispatch was cut.
+	options is what app was made with; the other adapters get the same.
+	The measured throughputs go to options->probes. Returns false if
+	there was nothing to run on or the result didn't match a single
+	dispatch on the CPU.
+*/
+bool run_split(
+	application* app,
+	const app_options* options,
+	const split_options* split
+);
+
+/*
+	Runs every job in the manifest at path, on the device, or on the
+	CPU executor when app is NULL or has no device. Prints each job's
+	times. Returns false if the manifest is bad or any job failed.
+*/
+bool run_manifest(application* app, const char* path);
+
+/*
+	Runs the compute job iterations times as a compute graph: a dispatch
+	pass and a copy pass into the readback buffer, with the queues and
+	barriers left to the graph compiler. Writes the compiled graph to
+	dot_path for Graphviz if it isn't NULL. Returns false without a
+	device or if the graph didn't compile.
+*/
+bool run_compute_graph(
+	application* app,
+	const unsigned int iterations,
+	const char* dot_path
+);
+
+/*
+	Runs the indirect chain (see indirect_dispatch.h) on num_items items,
+	keeping about keep_per_mille in 1000: on the CPU, then, with a
+	device, on the GPU with process run through ExecuteIndirect, timed
+	against reading the survivor count back to size it. Checks both, and
+	replays the GPU's argument buffer on the CPU. Returns false if any of
+	it didn't match.
+*/
+bool run_indirect_chain(
+	application* app,
+	const unsigned int num_items,
+	const unsigned int keep_per_mille
+);
+
+/*
+	Builds every permutation of hello_compute (see
+	hello_compute_permutations) on num_threads threads, 0 for one per
+	hardware thread, and prints how long the compile and the pipelines
+	took and how fast a pipeline is found by key. A warm start only
+	reads the caches. Returns false without a device or if any
+	permutation didn't build.
+*/
+bool run_permutations(application* app, const unsigned int num_threads);
+
+/*
+	Sums num_items made up values with wave_reduce.hlsl, in float and,
+	where the device has native 16-bit ops, in half, and checks every
+	group's sum against the CPU. The kernel needs shader model 6, so it
+	only runs from its embedded DXIL; variants the binary doesn't have
+	or the device can't run are skipped. Returns false without a device
+	or if any sum was wrong.
+*/
+bool run_wave_reduce(application* app, const unsigned int num_items);
+
+/*
+	What the tuning database knows hello_compute by on app's adapter:
+	its vendor and device ID, and a hash of the kernel's source and the
+	format it writes.
+*/
+std::string hello_compute_tuning_key(application* app);
+
+/*
+	Times hello_compute with every candidate group size in options on
+	the device, at the size and format of app's buffer, prints them, and
+	stores the fastest in database. Normal runs pick it up from then on.
+	Returns false without a device or if no candidate could run.
+*/
+bool tune_threadgroups(
+	application* app,
+	const tuning_options* options,
+	tuning_database* database
+);
 
 void shutdown_app(application* app);
@@ -0,0 +1,712 @@
+// Liam Wynn, 12/30/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "benchmark_suite.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace std;
+
+// 1 GiB. Big enough for 16384x16384 at four bytes per texel.
+const uint64_t DEFAULT_BENCH_MAX_BUFFER_BYTES = 1ULL << 30;
+
+/* FORMATS */
+
+const char* bench_format_name(const bench_format format) {
+	switch (format) {
+	case BENCH_FORMAT_R32G32B32A32_FLOAT:
+		return "R32G32B32A32_FLOAT";
+	case BENCH_FORMAT_R16G16B16A16_FLOAT:
+		return "R16G16B16A16_FLOAT";
+	case BENCH_FORMAT_R8G8B8A8_UNORM:
+		return "R8G8B8A8_UNORM";
+	case BENCH_FORMAT_R32_FLOAT:
+		return "R32_FLOAT";
+	case BENCH_FORMAT_R11G11B10_FLOAT:
+		return "R11G11B10_FLOAT";
+	default:
+		return "unknown";
+	}
+}
+
+const char* bench_layout_name(const bench_layout layout) {
+	switch (layout) {
+	case BENCH_LAYOUT_TEXTURE:
+		return "texture";
+	case BENCH_LAYOUT_STRUCTURED:
+		return "structured";
+	case BENCH_LAYOUT_RAW:
+		return "raw";
+	default:
+		return "unknown";
+	}
+}
+
+const char* bench_phase_name(const bench_phase phase) {
+	switch (phase) {
+	case BENCH_PHASE_COMPUTE:
+		return "compute";
+	case BENCH_PHASE_COPY:
+		return "copy";
+	case BENCH_PHASE_READBACK:
+		return "readback";
+	default:
+		return "unknown";
+	}
+}
+
+cpu_texel_format bench_format_to_cpu(const bench_format format) {
+	switch (format) {
+	case BENCH_FORMAT_R16G16B16A16_FLOAT:
+		return CPU_TEXEL_R16G16B16A16_FLOAT;
+	case BENCH_FORMAT_R8G8B8A8_UNORM:
+		return CPU_TEXEL_R8G8B8A8_UNORM;
+	case BENCH_FORMAT_R32_FLOAT:
+		return CPU_TEXEL_R32_FLOAT;
+	case BENCH_FORMAT_R11G11B10_FLOAT:
+		return CPU_TEXEL_R11G11B10_FLOAT;
+	default:
+		return CPU_TEXEL_R32G32B32A32_FLOAT;
+	}
+}
+
+unsigned int bench_format_size(const bench_format format) {
+	return cpu_texel_size(bench_format_to_cpu(format));
+}
+
+/* OPTIONS */
+
+void default_bench_suite_options(bench_suite_options* options) {
+	options->sizes = { 256, 1024, 4096, 16384 };
+	options->formats = {
+		BENCH_FORMAT_R32G32B32A32_FLOAT,
+		BENCH_FORMAT_R16G16B16A16_FLOAT,
+		BENCH_FORMAT_R8G8B8A8_UNORM,
+		BENCH_FORMAT_R32_FLOAT,
+		BENCH_FORMAT_R11G11B10_FLOAT
+	};
+	options->layouts = {
+		BENCH_LAYOUT_TEXTURE,
+		BENCH_LAYOUT_STRUCTURED,
+		BENCH_LAYOUT_RAW
+	};
+	options->group_sizes = { { 8, 8 }, { 16, 16 }, { 32, 8 } };
+	options->warmup_iterations = 2;
+	options->iterations = 10;
+	options->max_buffer_bytes = DEFAULT_BENCH_MAX_BUFFER_BYTES;
+}
+
+/*
+	Splits text on commas. Empty items are an error.
+*/
+static bool split_list(const char* text, vector<string>* items) {
+	string item;
+
+	items->clear();
+
+	for (const char* c = text; ; c++) {
+		if (*c == ',' || *c == '\0') {
+			if (item.empty()) {
+				return false;
+			}
+
+			items->push_back(item);
+			item.clear();
+
+			if (*c == '\0') {
+				break;
+			}
+		}
+		else {
+			item += *c;
+		}
+	}
+
+	return true;
+}
+
+static bool parse_unsigned(const string& text, unsigned int* value) {
+	char* end;
+	unsigned long parsed;
+
+	if (text.empty() || text[0] == '-') {
+		return false;
+	}
+
+	parsed = strtoul(text.c_str(), &end, 10);
+
+	if (*end != '\0' || parsed == 0 || parsed > 0xFFFFFFFFUL) {
+		return false;
+	}
+
+	*value = (unsigned int)parsed;
+
+	return true;
+}
+
+bool parse_bench_sizes(const char* text, vector<unsigned int>* sizes) {
+	vector<string> items;
+	unsigned int size;
+
+	if (!split_list(text, &items)) {
+		return false;
+	}
+
+	sizes->clear();
+
+	for (const string& item : items) {
+		if (!parse_unsigned(item, &size)) {
+			return false;
+		}
+
+		sizes->push_back(size);
+	}
+
+	return true;
+}
+
+bool parse_bench_formats(const char* text, vector<bench_format>* formats) {
+	vector<string> items;
+	bool found;
+
+	if (!split_list(text, &items)) {
+		return false;
+	}
+
+	formats->clear();
+
+	for (const string& item : items) {
+		found = false;
+
+		for (int f = 0; f < BENCH_FORMAT_COUNT; f++) {
+			if (item == bench_format_name((bench_format)f)) {
+				formats->push_back((bench_format)f);
+				found = true;
+				break;
+			}
+		}
+
+		if (!found) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool parse_bench_layouts(const char* text, vector<bench_layout>* layouts) {
+	vector<string> items;
+	bool found;
+
+	if (!split_list(text, &items)) {
+		return false;
+	}
+
+	layouts->clear();
+
+	for (const string& item : items) {
+		found = false;
+
+		for (int l = 0; l < BENCH_LAYOUT_COUNT; l++) {
+			if (item == bench_layout_name((bench_layout)l)) {
+				layouts->push_back((bench_layout)l);
+				found = true;
+				break;
+			}
+		}
+
+		if (!found) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool parse_bench_group_sizes(
+	const char* text,
+	vector<pair<unsigned int, unsigned int>>* group_sizes
+) {
+	vector<string> items;
+	size_t x;
+	unsigned int group_x;
+	unsigned int group_y;
+
+	if (!split_list(text, &items)) {
+		return false;
+	}
+
+	group_sizes->clear();
+
+	for (const string& item : items) {
+		x = item.find('x');
+
+		if (x == string::npos
+			|| !parse_unsigned(item.substr(0, x), &group_x)
+			|| !parse_unsigned(item.substr(x + 1), &group_y)) {
+			return false;
+		}
+
+		//
+		// D3D12 caps a threadgroup at 1024 threads and 1024 along X
+		// or Y.
+		//
+
+		if ((uint64_t)group_x * group_y > 1024) {
+			return false;
+		}
+
+		group_sizes->push_back(make_pair(group_x, group_y));
+	}
+
+	return true;
+}
+
+/* STATISTICS */
+
+bench_phase_stats compute_bench_phase_stats(
+	const vector<double>& seconds,
+	const bench_case* test
+) {
+	bench_phase_stats stats;
+	double sum;
+	double squares;
+	double bytes;
+	double pixels;
+
+	stats = {};
+
+	if (seconds.empty()) {
+		return stats;
+	}
+
+	sum = 0.0;
+	stats.min_ms = seconds[0] * 1000.0;
+	stats.max_ms = seconds[0] * 1000.0;
+
+	for (double s : seconds) {
+		sum += s;
+		stats.min_ms = fmin(stats.min_ms, s * 1000.0);
+		stats.max_ms = fmax(stats.max_ms, s * 1000.0);
+	}
+
+	stats.mean_ms = sum / seconds.size() * 1000.0;
+
+	//
+	// Sample standard deviation.
+	//
+
+	squares = 0.0;
+
+	for (double s : seconds) {
+		squares += (s * 1000.0 - stats.mean_ms) * (s * 1000.0 - stats.mean_ms);
+	}
+
+	stats.stddev_ms = seconds.size() > 1 ? sqrt(squares / (seconds.size() - 1)) : 0.0;
+
+	//
+	// Every phase moves the whole buffer once.
+	//
+
+	pixels = (double)test->width * test->height;
+	bytes = pixels * bench_format_size(test->format);
+
+	if (stats.mean_ms > 0.0) {
+		stats.gb_per_second = bytes / (stats.mean_ms / 1000.0) / 1.0e9;
+		stats.mpixels_per_second = pixels / (stats.mean_ms / 1000.0) / 1.0e6;
+	}
+
+	return stats;
+}
+
+/* SUITE */
+
+vector<bench_result> run_bench_suite(
+	bench_backend* backend,
+	const bench_suite_options* options,
+	FILE* progress
+) {
+	vector<bench_result> results;
+	vector<bench_case> cases;
+	vector<double> samples[BENCH_PHASE_COUNT];
+	double seconds[BENCH_PHASE_COUNT];
+
+	//
+	// Every combination, in the order they're reported.
+	//
+
+	for (unsigned int size : options->sizes) {
+		for (bench_format format : options->formats) {
+			for (bench_layout layout : options->layouts) {
+				for (const pair<unsigned int, unsigned int>& group_size : options->group_sizes) {
+					bench_case test;
+
+					test.width = size;
+					test.height = size;
+					test.format = format;
+					test.layout = layout;
+					test.group_size_x = group_size.first;
+					test.group_size_y = group_size.second;
+
+					cases.push_back(test);
+				}
+			}
+		}
+	}
+
+	for (const bench_case& test : cases) {
+		bench_result result;
+		uint64_t bytes;
+
+		result = {};
+		result.test = test;
+		result.backend = backend->name();
+		result.skipped = false;
+
+		bytes = (uint64_t)test.width * test.height * bench_format_size(test.format);
+
+		if (test.layout != BENCH_LAYOUT_TEXTURE && test.format != BENCH_FORMAT_R32G32B32A32_FLOAT) {
+			result.skipped = true;
+			result.skip_reason = "buffer layouts are float4 only";
+		}
+		else if (bytes > options->max_buffer_bytes) {
+			result.skipped = true;
+			result.skip_reason = "buffer larger than the memory budget";
+		}
+		else if (!backend->prepare(&result.test, &result.skip_reason)) {
+			result.skipped = true;
+		}
+
+		if (result.skipped) {
+			if (progress != NULL) {
+				fprintf(progress, "%ux%u %s %s %ux%u: skipped (%s)\n", test.width, test.height, bench_format_name(test.format), bench_layout_name(test.layout), test.group_size_x, test.group_size_y, result.skip_reason.c_str());
+			}
+
+			results.push_back(result);
+			continue;
+		}
+
+		for (unsigned int i = 0; i < options->warmup_iterations; i++) {
+			backend->run_iteration(seconds);
+		}
+
+		for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+			samples[p].clear();
+		}
+
+		for (unsigned int i = 0; i < options->iterations; i++) {
+			backend->run_iteration(seconds);
+
+			for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+				samples[p].push_back(seconds[p]);
+			}
+		}
+
+		backend->release();
+
+		result.iterations = options->iterations;
+
+		for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+			result.phases[p] = compute_bench_phase_stats(samples[p], &result.test);
+		}
+
+		if (progress != NULL) {
+			fprintf(
+				progress,
+				"%ux%u %s %s %ux%u: compute %.3f ms, copy %.3f ms, readback %.3f ms\n",
+				test.width,
+				test.height,
+				bench_format_name(test.format),
+				bench_layout_name(test.layout),
+				test.group_size_x,
+				test.group_size_y,
+				result.phases[BENCH_PHASE_COMPUTE].mean_ms,
+				result.phases[BENCH_PHASE_COPY].mean_ms,
+				result.phases[BENCH_PHASE_READBACK].mean_ms
+			);
+		}
+
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+/* OUTPUT */
+
+void print_bench_results(const vector<bench_result>& results, FILE* out) {
+	fprintf(out, "%-8s %-12s %-20s %-10s %-6s %-9s %10s %10s %10s %12s\n", "backend", "size", "format", "layout", "group", "phase", "mean ms", "stddev ms", "GB/s", "Mpixel/s");
+
+	for (const bench_result& r : results) {
+		char size[32];
+		char group[32];
+
+		snprintf(size, sizeof(size), "%ux%u", r.test.width, r.test.height);
+		snprintf(group, sizeof(group), "%ux%u", r.test.group_size_x, r.test.group_size_y);
+
+		if (r.skipped) {
+			fprintf(out, "%-8s %-12s %-20s %-10s %-6s skipped: %s\n", r.backend.c_str(), size, bench_format_name(r.test.format), bench_layout_name(r.test.layout), group, r.skip_reason.c_str());
+			continue;
+		}
+
+		for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+			const bench_phase_stats& s = r.phases[p];
+
+			fprintf(
+				out,
+				"%-8s %-12s %-20s %-10s %-6s %-9s %10.3f %10.3f %10.2f %12.1f\n",
+				r.backend.c_str(),
+				size,
+				bench_format_name(r.test.format),
+				bench_layout_name(r.test.layout),
+				group,
+				bench_phase_name((bench_phase)p),
+				s.mean_ms,
+				s.stddev_ms,
+				s.gb_per_second,
+				s.mpixels_per_second
+			);
+		}
+	}
+}
+
+void write_bench_csv(const vector<bench_result>& results, FILE* out) {
+	fputs("backend,width,height,format,layout,group_x,group_y,phase,iterations,mean_ms,stddev_ms,min_ms,max_ms,gb_per_second,mpixels_per_second,skipped\n", out);
+
+	//
+	// One row per phase. Skipped cases get one row with no numbers.
+	//
+
+	for (const bench_result& r : results) {
+		if (r.skipped) {
+			fprintf(out, "%s,%u,%u,%s,%s,%u,%u,,0,,,,,,,1\n", r.backend.c_str(), r.test.width, r.test.height, bench_format_name(r.test.format), bench_layout_name(r.test.layout), r.test.group_size_x, r.test.group_size_y);
+			continue;
+		}
+
+		for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+			const bench_phase_stats& s = r.phases[p];
+
+			fprintf(
+				out,
+				"%s,%u,%u,%s,%s,%u,%u,%s,%u,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,0\n",
+				r.backend.c_str(),
+				r.test.width,
+				r.test.height,
+				bench_format_name(r.test.format),
+				bench_layout_name(r.test.layout),
+				r.test.group_size_x,
+				r.test.group_size_y,
+				bench_phase_name((bench_phase)p),
+				r.iterations,
+				s.mean_ms,
+				s.stddev_ms,
+				s.min_ms,
+				s.max_ms,
+				s.gb_per_second,
+				s.mpixels_per_second
+			);
+		}
+	}
+}
+
+void write_bench_json(const vector<bench_result>& results, FILE* out) {
+	fputs("{\"results\":[", out);
+
+	for (size_t i = 0; i < results.size(); i++) {
+		const bench_result& r = results[i];
+
+		//
+		// Nothing we write needs escaping: backend, format and layout
+		// names and skip reasons are all fixed strings without quotes.
+		//
+
+		fprintf(
+			out,
+			"%s\n{\"backend\":\"%s\",\"width\":%u,\"height\":%u,\"format\":\"%s\",\"layout\":\"%s\",\"group_x\":%u,\"group_y\":%u,\"skipped\":%s",
+			i == 0 ? "" : ",",
+			r.backend.c_str(),
+			r.test.width,
+			r.test.height,
+			bench_format_name(r.test.format),
+			bench_layout_name(r.test.layout),
+			r.test.group_size_x,
+			r.test.group_size_y,
+			r.skipped ? "true" : "false"
+		);
+
+		if (r.skipped) {
+			fprintf(out, ",\"reason\":\"%s\"}", r.skip_reason.c_str());
+			continue;
+		}
+
+		fprintf(out, ",\"iterations\":%u,\"phases\":{", r.iterations);
+
+		for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+			const bench_phase_stats& s = r.phases[p];
+
+			fprintf(
+				out,
+				"%s\"%s\":{\"mean_ms\":%.6f,\"stddev_ms\":%.6f,\"min_ms\":%.6f,\"max_ms\":%.6f,\"gb_per_second\":%.6f,\"mpixels_per_second\":%.6f}",
+				p == 0 ? "" : ",",
+				bench_phase_name((bench_phase)p),
+				s.mean_ms,
+				s.stddev_ms,
+				s.min_ms,
+				s.max_ms,
+				s.gb_per_second,
+				s.mpixels_per_second
+			);
+		}
+
+		fputs("}}", out);
+	}
+
+	fputs("\n]}\n", out);
+}
+
+bool write_bench_results(const vector<bench_result>& results, const string& path) {
+	FILE* out;
+	bool json;
+
+	json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+
+#if defined(_MSC_VER)
+	if (fopen_s(&out, path.c_str(), "w") != 0) {
+		return false;
+	}
+#else
+	out = fopen(path.c_str(), "w");
+#endif
+
+	if (out == NULL) {
+		return false;
+	}
+
+	if (json) {
+		write_bench_json(results, out);
+	}
+	else {
+		write_bench_csv(results, out);
+	}
+
+	fclose(out);
+
+	return true;
+}
+
+/* CPU BACKEND */
+
+void initialize_cpu_bench_backend(cpu_bench_backend* backend, const unsigned int num_threads) {
+	initialize_cpu_executor(&backend->executor, num_threads);
+	backend->checksum = 0;
+}
+
+const char* cpu_bench_backend::name() {
+	return "cpu";
+}
+
+bool cpu_bench_backend::prepare(const bench_case* test, string* reason) {
+	unsigned int texel_size;
+
+	this->test = *test;
+	texel_size = bench_format_size(test->format);
+	footprint = cpu_readback_footprint(test->width, test->height, texel_size);
+
+	//
+	// The "GPU" texture is tightly packed. The readback copy uses the
+	// padded row pitch a real readback buffer has. A structured or raw
+	// buffer is read back as it is, so its readback is packed too.
+	//
+
+	if (test->layout != BENCH_LAYOUT_TEXTURE) {
+		footprint.row_pitch = test->width * texel_size;
+		footprint.total_size = (uint64_t)footprint.row_pitch * test->height;
+	}
+
+	try {
+		texture.assign((size_t)test->width * test->height * texel_size, 0);
+		readback.assign((size_t)footprint.total_size, 0);
+	}
+	catch (const bad_alloc&) {
+		texture.clear();
+		readback.clear();
+		*reason = "out of host memory";
+		return false;
+	}
+
+	return true;
+}
+
+void cpu_bench_backend::run_iteration(double seconds[BENCH_PHASE_COUNT]) {
+	cpu_texture target;
+	cpu_dispatch_desc dispatch;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+	size_t row_size;
+	const uint64_t* words;
+	size_t num_words;
+	uint64_t sum;
+
+	//
+	// Compute.
+	//
+
+	row_size = (size_t)test.width * bench_format_size(test.format);
+
+	target.data = texture.data();
+	target.width = test.width;
+	target.height = test.height;
+	target.row_pitch = (unsigned int)row_size;
+	target.format = bench_format_to_cpu(test.format);
+
+	dispatch = cpu_dispatch_for_group_size(test.width, test.height, test.group_size_x, test.group_size_y);
+	seconds[BENCH_PHASE_COMPUTE] = cpu_dispatch_hello_compute(&executor, &target, &dispatch).seconds;
+
+	//
+	// Copy into the readback layout: row by row for a texture, all at
+	// once for a buffer.
+	//
+
+	start = chrono::steady_clock::now();
+
+	if (test.layout == BENCH_LAYOUT_TEXTURE) {
+		for (unsigned int y = 0; y < test.height; y++) {
+			memcpy(readback.data() + (size_t)y * footprint.row_pitch, texture.data() + y * row_size, row_size);
+		}
+	}
+	else {
+		memcpy(readback.data(), texture.data(), texture.size());
+	}
+
+	elapsed = chrono::steady_clock::now() - start;
+	seconds[BENCH_PHASE_COPY] = elapsed.count();
+
+	//
+	// Read it all back. The sum keeps the reads from being optimized
+	// away.
+	//
+
+	start = chrono::steady_clock::now();
+
+	words = reinterpret_cast<const uint64_t*>(readback.data());
+	num_words = readback.size() / sizeof(uint64_t);
+	sum = 0;
+
+	for (size_t i = 0; i < num_words; i++) {
+		sum += words[i];
+	}
+
+	elapsed = chrono::steady_clock::now() - start;
+	seconds[BENCH_PHASE_READBACK] = elapsed.count();
+
+	checksum += sum;
+}
+
+void cpu_bench_backend::release() {
+	texture.clear();
+	texture.shrink_to_fit();
+	readback.clear();
+	readback.shrink_to_fit();
+}
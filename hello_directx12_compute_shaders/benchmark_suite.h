@@ -0,0 +1,181 @@
+// Liam Wynn, 12/30/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The benchmark suite sweeps the hello_compute job over buffer sizes,
+	texel formats, buffer layouts and threadgroup shapes, and times its
+	three phases:
+
+	compute   The dispatch that fills the buffer.
+	copy      Copying the buffer into the readback layout.
+	readback  Reading the readback memory on the CPU.
+
+	Each case runs some warmup iterations, then the measured ones. Every
+	phase reports mean, standard deviation, min and max, plus GB/s and
+	Mpixel/s for the mean. Results go to CSV or JSON so runs can be
+	compared over time.
+
+	The work itself is done by a bench_backend. The CPU backend in here
+	runs on the cpu_executor, so the suite works on machines without a
+	GPU. gpu_bench_backend runs it on the device.
+
+	The layouts are the compute_buffer kinds: a texture, whose readback
+	rows are padded to the footprint pitch, and structured and raw
+	buffers, which are copied back as they are. Only float4 has buffer
+	layouts; other formats skip them.
+
+	Cases whose buffer would be bigger than max_buffer_bytes are
+	reported as skipped rather than run.
+*/
+
+#pragma once
+
+#include "cpu_executor.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum bench_format {
+	BENCH_FORMAT_R32G32B32A32_FLOAT,
+	BENCH_FORMAT_R16G16B16A16_FLOAT,
+	BENCH_FORMAT_R8G8B8A8_UNORM,
+	BENCH_FORMAT_R32_FLOAT,
+	BENCH_FORMAT_R11G11B10_FLOAT,
+	BENCH_FORMAT_COUNT
+};
+
+enum bench_layout {
+	BENCH_LAYOUT_TEXTURE,
+	BENCH_LAYOUT_STRUCTURED,
+	BENCH_LAYOUT_RAW,
+	BENCH_LAYOUT_COUNT
+};
+
+enum bench_phase {
+	BENCH_PHASE_COMPUTE,
+	BENCH_PHASE_COPY,
+	BENCH_PHASE_READBACK,
+	BENCH_PHASE_COUNT
+};
+
+struct bench_case {
+	unsigned int width;
+	unsigned int height;
+	bench_format format;
+	bench_layout layout;
+	unsigned int group_size_x;
+	unsigned int group_size_y;
+};
+
+struct bench_phase_stats {
+	double mean_ms;
+	double stddev_ms;
+	double min_ms;
+	double max_ms;
+	double gb_per_second;
+	double mpixels_per_second;
+};
+
+struct bench_result {
+	bench_case test;
+	std::string backend;
+
+	bool skipped;
+	std::string skip_reason;
+
+	unsigned int iterations;
+	bench_phase_stats phases[BENCH_PHASE_COUNT];
+};
+
+struct bench_suite_options {
+	std::vector<unsigned int> sizes;
+	std::vector<bench_format> formats;
+	std::vector<bench_layout> layouts;
+	std::vector<std::pair<unsigned int, unsigned int>> group_sizes;
+
+	unsigned int warmup_iterations;
+	unsigned int iterations;
+	uint64_t max_buffer_bytes;
+};
+
+/*
+	Something that can run one benchmark case. prepare sets up for a
+	case (and may refuse it), run_iteration runs every phase once and
+	reports how many seconds each took, release frees the case.
+*/
+struct bench_backend {
+	virtual ~bench_backend() {}
+
+	virtual const char* name() = 0;
+	virtual bool prepare(const bench_case* test, std::string* reason) = 0;
+	virtual void run_iteration(double seconds[BENCH_PHASE_COUNT]) = 0;
+	virtual void release() = 0;
+};
+
+/*
+	Runs the kernel on the cpu_executor into a tightly packed buffer,
+	copies it out to the readback layout, and sums the readback buffer.
+	For a texture that is row by row to a readback-pitched buffer. The
+	buffer layouts are one copy to a buffer of the same size, and look
+	the same to the CPU.
+*/
+struct cpu_bench_backend : bench_backend {
+	cpu_executor executor;
+	bench_case test;
+	cpu_footprint footprint;
+	std::vector<unsigned char> texture;
+	std::vector<unsigned char> readback;
+	uint64_t checksum;
+
+	const char* name() override;
+	bool prepare(const bench_case* test, std::string* reason) override;
+	void run_iteration(double seconds[BENCH_PHASE_COUNT]) override;
+	void release() override;
+};
+
+void initialize_cpu_bench_backend(cpu_bench_backend* backend, const unsigned int num_threads);
+
+const char* bench_format_name(const bench_format format);
+const char* bench_layout_name(const bench_layout layout);
+const char* bench_phase_name(const bench_phase phase);
+unsigned int bench_format_size(const bench_format format);
+cpu_texel_format bench_format_to_cpu(const bench_format format);
+
+void default_bench_suite_options(bench_suite_options* options);
+
+/*
+	Parsers for the command line lists. Sizes are "256,1024", formats
+	are DXGI names without the prefix ("R8G8B8A8_UNORM,..."), layouts
+	are "texture,structured,raw" and group sizes are "8x8,16x16". They
+	return false on anything malformed.
+*/
+bool parse_bench_sizes(const char* text, std::vector<unsigned int>* sizes);
+bool parse_bench_formats(const char* text, std::vector<bench_format>* formats);
+bool parse_bench_layouts(const char* text, std::vector<bench_layout>* layouts);
+bool parse_bench_group_sizes(
+	const char* text,
+	std::vector<std::pair<unsigned int, unsigned int>>* group_sizes
+);
+
+bench_phase_stats compute_bench_phase_stats(
+	const std::vector<double>& seconds,
+	const bench_case* test
+);
+
+/*
+	Runs every combination in options on backend. Progress lines go to
+	progress, which may be NULL.
+*/
+std::vector<bench_result> run_bench_suite(
+	bench_backend* backend,
+	const bench_suite_options* options,
+	FILE* progress
+);
+
+void print_bench_results(const std::vector<bench_result>& results, FILE* out);
+void write_bench_csv(const std::vector<bench_result>& results, FILE* out);
+void write_bench_json(const std::vector<bench_result>& results, FILE* out);
+
+// Picks CSV or JSON from the extension of path.
+bool write_bench_results(const std::vector<bench_result>& results, const std::string& path);
@@ -0,0 +1,204 @@
+// Liam Wynn, 12/21/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "compute_batch.h"
+#include <unordered_map>
+
+using namespace std;
+
+void initialize_compute_batch(compute_batch* batch) {
+	clear_compute_batch(batch);
+}
+
+void add_compute_dispatch(
+	compute_batch* batch,
+	ID3D12RootSignature* root_signature,
+	ID3D12PipelineState* pipeline_state,
+	const compute_binding* bindings,
+	const unsigned int num_bindings,
+	const dispatch_resource_use* resources,
+	const unsigned int num_resources,
+	const UINT group_count_x,
+	const UINT group_count_y,
+	const UINT group_count_z
+) {
+	dispatch_batch_entry entry;
+	D3D12_DISPATCH_ARGUMENTS group_count;
+
+	entry.root_signature = root_signature;
+	entry.pipeline = pipeline_state;
+	entry.resources.assign(resources, resources + num_resources);
+
+	group_count.ThreadGroupCountX = group_count_x;
+	group_count.ThreadGroupCountY = group_count_y;
+	group_count.ThreadGroupCountZ = group_count_z;
+
+	batch->entries.push_back(entry);
+	batch->bindings.push_back(vector<compute_binding>(bindings, bindings + num_bindings));
+	batch->group_counts.push_back(group_count);
+}
+
+void set_compute_batch_final_state(
+	compute_batch* batch,
+	ID3D12Resource* resource,
+	const D3D12_RESOURCE_STATES state
+) {
+	for (pair<const void*, D3D12_RESOURCE_STATES>& final_state : batch->final_states) {
+		if (final_state.first == resource) {
+			final_state.second = state;
+			return;
+		}
+	}
+
+	batch->final_states.push_back(make_pair((const void*)resource, state));
+}
+
+void record_compute_batch(
+	compute_batch* batch,
+	dx12_handler* dx12,
+	ID3D12GraphicsCommandList* command_list
+) {
+	resource_state_tracker* states;
+	unordered_map<const void*, size_t> last_use;
+	vector<D3D12_RESOURCE_BARRIER> barriers;
+	vector<UINT64> bound_tables;
+
+	if (batch->entries.empty()) {
+		return;
+	}
+
+	states = &dx12->resource_states;
+	plan_dispatch_batch(batch->entries, &batch->plan);
+
+	//
+	// Move everything the batch touches into UNORDERED_ACCESS with a
+	// single barrier call. UAV barriers inside the batch come from the
+	// plan, so the tracker isn't told about the writes.
+	//
+
+	for (size_t p = 0; p < batch->plan.order.size(); p++) {
+		const dispatch_batch_entry& entry = batch->entries[batch->plan.order[p].entry];
+
+		for (const dispatch_resource_use& use : entry.resources) {
+			require_resource_state(states, use.resource, ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, false);
+			last_use[use.resource] = p;
+		}
+	}
+
+	record_resource_barriers(dx12, command_list);
+
+	ID3D12DescriptorHeap* heaps[] = { dx12->cbv_srv_uav_heap->heap.Get() };
+	command_list->SetDescriptorHeaps(1, heaps);
+
+	//
+	// Record in planned order. Root signature, pipeline and tables are
+	// only set when they differ from what is already bound.
+	//
+
+	for (size_t p = 0; p < batch->plan.order.size(); p++) {
+		const planned_dispatch& planned = batch->plan.order[p];
+		const dispatch_batch_entry& entry = batch->entries[planned.entry];
+		const D3D12_DISPATCH_ARGUMENTS& group_count = batch->group_counts[planned.entry];
+
+		//
+		// The plan's UAV barriers and any split barriers that were
+		// started after the previous dispatch share one call.
+		//
+
+		barriers.clear();
+
+		for (const void* resource : planned.uav_barriers) {
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV((ID3D12Resource*)resource));
+		}
+
+		append_resource_barriers(dx12, &barriers);
+
+		if (!barriers.empty()) {
+			command_list->ResourceBarrier((UINT)barriers.size(), barriers.data());
+		}
+
+		if (planned.set_root_signature) {
+			command_list->SetComputeRootSignature((ID3D12RootSignature*)entry.root_signature);
+			bound_tables.clear();
+		}
+
+		if (planned.set_pipeline) {
+			command_list->SetPipelineState((ID3D12PipelineState*)entry.pipeline);
+		}
+
+		for (const compute_binding& binding : batch->bindings[planned.entry]) {
+			if (binding.root_parameter >= bound_tables.size()) {
+				bound_tables.resize(binding.root_parameter + 1, 0);
+			}
+
+			if (bound_tables[binding.root_parameter] == binding.table.ptr) {
+				continue;
+			}
+
+			command_list->SetComputeRootDescriptorTable(binding.root_parameter, binding.table);
+			bound_tables[binding.root_parameter] = binding.table.ptr;
+		}
+
+		command_list->Dispatch(
+			group_count.ThreadGroupCountX,
+			group_count.ThreadGroupCountY,
+			group_count.ThreadGroupCountZ
+		);
+
+		//
+		// Resources this was the last dispatch for can start moving to
+		// their final state while the rest of the batch runs.
+		//
+
+		for (const pair<const void*, D3D12_RESOURCE_STATES>& final_state : batch->final_states) {
+			auto it = last_use.find(final_state.first);
+
+			if (it != last_use.end() && it->second == p) {
+				begin_resource_transition(states, final_state.first, ALL_TRACKED_SUBRESOURCES, final_state.second);
+			}
+		}
+	}
+
+	//
+	// End the split barriers (or, for the last dispatch's resources,
+	// just transition) in one call.
+	//
+
+	for (const pair<const void*, D3D12_RESOURCE_STATES>& final_state : batch->final_states) {
+		require_resource_state(states, final_state.first, ALL_TRACKED_SUBRESOURCES, final_state.second, false);
+	}
+
+	record_resource_barriers(dx12, command_list);
+}
+
+queue_ticket submit_compute_batch(
+	compute_batch* batch,
+	dx12_handler* dx12,
+	dx12_queue* queue,
+	const queue_ticket* deps,
+	const unsigned int num_deps
+) {
+	ComPtr<ID3D12GraphicsCommandList> command_list;
+	queue_ticket ticket;
+
+	command_list = begin_command_batch(queue, NULL);
+	record_compute_batch(batch, dx12, command_list.Get());
+	ticket = submit_command_batch(dx12, queue, deps, num_deps);
+
+	batch->entries.clear();
+	batch->bindings.clear();
+	batch->group_counts.clear();
+	batch->final_states.clear();
+
+	return ticket;
+}
+
+void clear_compute_batch(compute_batch* batch) {
+	batch->entries.clear();
+	batch->bindings.clear();
+	batch->group_counts.clear();
+	batch->final_states.clear();
+	batch->plan.order.clear();
+	batch->plan.root_signature_changes = 0;
+	batch->plan.pipeline_changes = 0;
+	batch->plan.uav_barriers = 0;
+}
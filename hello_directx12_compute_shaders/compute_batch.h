@@ -0,0 +1,91 @@
+// Liam Wynn, 12/21/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	A compute batch collects many dispatches and records them into one
+	command list with one submission, instead of one list and one
+	submission per dispatch.
+
+	Each dispatch names its root signature, pipeline, descriptor table
+	bindings, group counts and the resources it reads or writes. The
+	order and the UAV barriers come from plan_dispatch_batch (see
+	dispatch_batch.h), so dispatches that share a pipeline are recorded
+	together and independent dispatches get no barrier between them.
+
+	Every resource in the batch has to be tracked by the dx12_handler's
+	resource_states. The tracker moves them into UNORDERED_ACCESS with
+	one barrier call at the start. A resource given a final state with
+	set_compute_batch_final_state starts a split barrier towards it
+	right after its last dispatch, so the transition overlaps the rest
+	of the batch. Others are left in UNORDERED_ACCESS.
+*/
+
+#pragma once
+
+#include "stdafx.h"
+#include "dx12_handler.h"
+#include "dispatch_batch.h"
+#include <utility>
+#include <vector>
+
+struct compute_binding {
+	UINT root_parameter;
+	D3D12_GPU_DESCRIPTOR_HANDLE table;
+};
+
+struct compute_batch {
+	// Parallel arrays, one element per dispatch in the order added.
+	std::vector<dispatch_batch_entry> entries;
+	std::vector<std::vector<compute_binding>> bindings;
+	std::vector<D3D12_DISPATCH_ARGUMENTS> group_counts;
+
+	// States resources should be left in after the batch.
+	std::vector<std::pair<const void*, D3D12_RESOURCE_STATES>> final_states;
+
+	// The plan used by the last submission.
+	dispatch_batch_plan plan;
+};
+
+void initialize_compute_batch(compute_batch* batch);
+
+void add_compute_dispatch(
+	compute_batch* batch,
+	ID3D12RootSignature* root_signature,
+	ID3D12PipelineState* pipeline_state,
+	const compute_binding* bindings,
+	const unsigned int num_bindings,
+	const dispatch_resource_use* resources,
+	const unsigned int num_resources,
+	const UINT group_count_x,
+	const UINT group_count_y,
+	const UINT group_count_z
+);
+
+void set_compute_batch_final_state(
+	compute_batch* batch,
+	ID3D12Resource* resource,
+	const D3D12_RESOURCE_STATES state
+);
+
+/*
+	Plans the batch and records it into command_list. The list must
+	already be open.
+*/
+void record_compute_batch(
+	compute_batch* batch,
+	dx12_handler* dx12,
+	ID3D12GraphicsCommandList* command_list
+);
+
+/*
+	Records the batch into the queue's next command list, submits it
+	and empties the batch.
+*/
+queue_ticket submit_compute_batch(
+	compute_batch* batch,
+	dx12_handler* dx12,
+	dx12_queue* queue,
+	const queue_ticket* deps,
+	const unsigned int num_deps
+);
+
+void clear_compute_batch(compute_batch* batch);
@@ -1,18 +1,48 @@
 // Liam Wynn, 10/31/2024, Hello DirectX 12: Compute Shader Edition
 
 #include "compute_buffer.h"
+#include "cpu_executor.h"
 #include "utils.h"
 
-void initialize_compute_buffer(
+DXGI_FORMAT cpu_texel_format_to_dxgi(const cpu_texel_format format) {
+	switch (format) {
+	case CPU_TEXEL_R16G16B16A16_FLOAT:
+		return DXGI_FORMAT_R16G16B16A16_FLOAT;
+	case CPU_TEXEL_R8G8B8A8_UNORM:
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	case CPU_TEXEL_R32_FLOAT:
+		return DXGI_FORMAT_R32_FLOAT;
+	case CPU_TEXEL_R11G11B10_FLOAT:
+		return DXGI_FORMAT_R11G11B10_FLOAT;
+	default:
+		return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	}
+}
+
+bool dxgi_to_cpu_texel_format(const DXGI_FORMAT format, cpu_texel_format* texel_format) {
+	for (int f = 0; f < CPU_TEXEL_FORMAT_COUNT; f++) {
+		if (cpu_texel_format_to_dxgi((cpu_texel_format)f) == format) {
+			*texel_format = (cpu_texel_format)f;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+	Everything but the size and layout, which the caller sets.
+*/
+static void initialize_gpu_compute_buffer(
 	compute_buffer* buffer,
-	dx12_handler* dx12,
-	const unsigned int width,
-	const unsigned int height,
-	const DXGI_FORMAT format
+	dx12_handler* dx12
 ) {
-	buffer->width = width;
-	buffer->height = height;
-	buffer->format = format;
+	buffer->cpu_readback_data = NULL;
+	buffer->readback_data = NULL;
+	buffer->buffer_memory = empty_gpu_allocation();
+	buffer->readback_memory = empty_gpu_allocation();
+	buffer->last_read.queue = QUEUE_COPY;
+	buffer->last_read.value = 0;
 
 	//
 	// Allocate an unordered access view buffer on the GPU.
@@ -20,6 +50,9 @@ void initialize_compute_buffer(
 
 	allocate_buffer_on_gpu(buffer, dx12);
 
+	// Created in COMMON. From here on the tracker knows its state.
+	track_resource(&dx12->resource_states, buffer->buffer.Get(), 1, D3D12_RESOURCE_STATE_COMMON);
+
 	//
 	// Now that we have allocated the buffer, create a UAV
 	// descriptor for it.
@@ -35,16 +68,72 @@ void initialize_compute_buffer(
 	initialize_readback_buffer(buffer, dx12);
 }
 
+void initialize_compute_buffer(
+	compute_buffer* buffer,
+	dx12_handler* dx12,
+	const unsigned int width,
+	const unsigned int height,
+	const DXGI_FORMAT format
+) {
+	buffer->layout = COMPUTE_BUFFER_TEXTURE;
+	buffer->width = width;
+	buffer->height = height;
+	buffer->format = format;
+	buffer->element_size = 0;
+	buffer->size_in_bytes = 0;
+
+	initialize_gpu_compute_buffer(buffer, dx12);
+}
+
+void initialize_structured_compute_buffer(
+	compute_buffer* buffer,
+	dx12_handler* dx12,
+	const unsigned int num_elements,
+	const unsigned int element_size
+) {
+	if (num_elements == 0 || element_size == 0 || element_size > D3D12_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES
+		|| (uint64_t)num_elements * element_size > MAX_LINEAR_BUFFER_BYTES) {
+		throw std::exception();
+	}
+
+	buffer->layout = COMPUTE_BUFFER_STRUCTURED;
+	buffer->width = num_elements;
+	buffer->height = 1;
+	buffer->format = DXGI_FORMAT_UNKNOWN;
+	buffer->element_size = element_size;
+	buffer->size_in_bytes = (uint64_t)num_elements * element_size;
+
+	initialize_gpu_compute_buffer(buffer, dx12);
+}
+
+void initialize_raw_compute_buffer(
+	compute_buffer* buffer,
+	dx12_handler* dx12,
+	const uint64_t size_in_bytes
+) {
+	if (size_in_bytes == 0 || size_in_bytes % 4 != 0 || size_in_bytes > MAX_LINEAR_BUFFER_BYTES) {
+		throw std::exception();
+	}
+
+	buffer->layout = COMPUTE_BUFFER_RAW;
+	buffer->width = (unsigned int)(size_in_bytes / 4);
+	buffer->height = 1;
+	buffer->format = DXGI_FORMAT_R32_TYPELESS;
+	buffer->element_size = 4;
+	buffer->size_in_bytes = size_in_bytes;
+
+	initialize_gpu_compute_buffer(buffer, dx12);
+}
+
+bool is_linear_compute_buffer(const compute_buffer* buffer) {
+	return buffer->layout != COMPUTE_BUFFER_TEXTURE;
+}
+
 void allocate_buffer_on_gpu(
 	compute_buffer* buffer,
 	dx12_handler* dx12
 ) {
 	D3D12_RESOURCE_DESC buffer_desc;
-	HRESULT result;
-	CD3DX12_HEAP_PROPERTIES default_heap;
-	ComPtr<ID3D12Device5> dev;
-
-	dev = dx12->device;
 
 	//
 	// Set up the buffer description for the resource.
@@ -52,56 +141,92 @@ void allocate_buffer_on_gpu(
 
 	buffer_desc = {};
 	buffer_desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-	buffer_desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-	buffer_desc.Width = buffer->width;
-	buffer_desc.Height = buffer->height;
-	buffer_desc.Format = buffer->format;
 	buffer_desc.MipLevels = 1;
 	buffer_desc.DepthOrArraySize = 1;
 	buffer_desc.SampleDesc.Count = 1;
-	buffer_desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 
 	//
-	// Allocate the buffer using the resource description.
+	// Structured and raw buffers are plain buffers. The view decides
+	// how the kernel sees them.
 	//
 
-	default_heap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	if (is_linear_compute_buffer(buffer)) {
+		buffer_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		buffer_desc.Width = buffer->size_in_bytes;
+		buffer_desc.Height = 1;
+		buffer_desc.Format = DXGI_FORMAT_UNKNOWN;
+		buffer_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	}
+	else {
+		buffer_desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		buffer_desc.Width = buffer->width;
+		buffer_desc.Height = buffer->height;
+		buffer_desc.Format = buffer->format;
+		buffer_desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	}
+
+	//
+	// Place the buffer in one of the shared default heaps.
+	//
 
-	result = dev->CreateCommittedResource(
-		&default_heap,
-		D3D12_HEAP_FLAG_NONE,
+	create_placed_resource(
+		dx12->memory,
+		D3D12_HEAP_TYPE_DEFAULT,
 		&buffer_desc,
 		D3D12_RESOURCE_STATE_COMMON,
-		NULL,
-		IID_PPV_ARGS(&buffer->buffer)
+		&buffer->buffer_memory,
+		&buffer->buffer
 	);
-
-	throw_if_failed(result);
 }
 
 void create_buffer_descriptor(
 	compute_buffer* buffer,
 	dx12_handler* dx12
 ) {
-	descriptor_heap* desc_heap;
+	descriptor_heap* staging_heap;
 	ComPtr<ID3D12Device5> dev;
 	D3D12_UNORDERED_ACCESS_VIEW_DESC uav_desc;
 
-	desc_heap = dx12->cbv_srv_uav_heap;
+	staging_heap = dx12->staging_heap;
 	dev = dx12->device;
 
 	uav_desc = {};
 	uav_desc.Format = buffer->format;
-	uav_desc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
 
-	buffer->uav_index = next_available_heap_index(desc_heap);
+	switch (buffer->layout) {
+	case COMPUTE_BUFFER_STRUCTURED:
+		uav_desc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+		uav_desc.Buffer.NumElements = buffer->width;
+		uav_desc.Buffer.StructureByteStride = buffer->element_size;
+		uav_desc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+		break;
+	case COMPUTE_BUFFER_RAW:
+		// Raw views are R32_TYPELESS and count 32-bit words.
+		uav_desc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+		uav_desc.Buffer.NumElements = buffer->width;
+		uav_desc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_RAW;
+		break;
+	default:
+		uav_desc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+		break;
+	}
+
+	//
+	// Write the descriptor into the CPU-only staging heap, then copy
+	// it into a persistent slot of the shader visible heap.
+	//
+
+	buffer->staging_uav_index = next_available_heap_index(staging_heap);
 
 	dev->CreateUnorderedAccessView(
 		buffer->buffer.Get(),
 		NULL,
 		&uav_desc,
-		heap_cpu_handle(desc_heap, buffer->uav_index)
+		heap_cpu_handle(staging_heap, buffer->staging_uav_index)
 	);
+
+	buffer->uav_index = next_available_heap_index(dx12->cbv_srv_uav_heap);
+	copy_staged_descriptors(dx12, buffer->staging_uav_index, buffer->uav_index, 1);
 }
 
 void initialize_readback_buffer(
@@ -116,41 +241,70 @@ void initialize_readback_buffer(
 	ComPtr<ID3D12Resource> data_buffer;
 	D3D12_RESOURCE_DESC buffer_desc;
 	D3D12_RESOURCE_DESC readback_desc;
-	D3D12_HEAP_PROPERTIES heap_properties;
+	D3D12_RANGE read_range;
+	void* mapped;
 	HRESULT result;
 
 	device = dx12->device;
 	data_buffer = buffer->buffer;
 	buffer_desc = data_buffer->GetDesc();
 
-	//
-	// Get the footprint and other metadata. The footprint
-	// is used later when we copy the data back into the readback
-	// buffer.
-	//
+	if (is_linear_compute_buffer(buffer)) {
+		if (buffer->size_in_bytes > MAX_LINEAR_BUFFER_BYTES) {
+			throw std::exception();
+		}
 
-	device->GetCopyableFootprints(
-		&buffer_desc,
-		0,
-		1,
-		0,
-		&footprint,
-		&num_rows,
-		&row_size_in_bytes,
-		&total_buffer_size
-	);
+		//
+		// A buffer is copied byte for byte, so a slot is exactly its
+		// size. The footprint describes it as one row for the code
+		// that reads slots by row pitch. Slots stay 16 byte aligned
+		// so any element type can be read in place.
+		//
 
-	buffer->footprint_for_readback = footprint;
+		buffer->footprint_for_readback = {};
+		buffer->footprint_for_readback.Footprint.Format = DXGI_FORMAT_UNKNOWN;
+		buffer->footprint_for_readback.Footprint.Width = (UINT)buffer->size_in_bytes;
+		buffer->footprint_for_readback.Footprint.Height = 1;
+		buffer->footprint_for_readback.Footprint.Depth = 1;
+		buffer->footprint_for_readback.Footprint.RowPitch = (UINT)buffer->size_in_bytes;
 
-	//
-	// Use the result from above to create our readback buffer.
-	// Note: we can hardcode a lot of this I think.
-	//
+		buffer->readback_slot_stride = (buffer->size_in_bytes + D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT - 1)
+			& ~(UINT64)(D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT - 1);
+	}
+	else {
+		//
+		// Get the footprint and other metadata. The footprint
+		// is used later when we copy the data back into the readback
+		// buffer.
+		//
+
+		device->GetCopyableFootprints(
+			&buffer_desc,
+			0,
+			1,
+			0,
+			&footprint,
+			&num_rows,
+			&row_size_in_bytes,
+			&total_buffer_size
+		);
+
+		buffer->footprint_for_readback = footprint;
+
+		//
+		// Use the result from above to create our readback buffer,
+		// with room for every slot. Each slot starts on a placement
+		// boundary so a copy can land in any of them.
+		//
+
+		buffer->readback_slot_stride = (total_buffer_size + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1)
+			& ~(UINT64)(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+	}
 
 	readback_desc = {};
 	readback_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
 	readback_desc.Alignment = 0;
-	readback_desc.Width = total_buffer_size;
+	readback_desc.Width = buffer->readback_slot_stride * READBACK_SLOT_COUNT;
 	readback_desc.Height = 1;
 	readback_desc.DepthOrArraySize = 1;
 	readback_desc.MipLevels = 1;
@@ -160,16 +314,145 @@ void initialize_readback_buffer(
 	readback_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
 	readback_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
 
-	heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
-
-	result = device->CreateCommittedResource(
-		&heap_properties,
-		D3D12_HEAP_FLAG_NONE,
+	create_placed_resource(
+		dx12->memory,
+		D3D12_HEAP_TYPE_READBACK,
 		&readback_desc,
 		D3D12_RESOURCE_STATE_COPY_DEST,
-		NULL,
-		IID_PPV_ARGS(&(buffer->readback_buffer))
+		&buffer->readback_memory,
+		&buffer->readback_buffer
 	);
 
+	//
+	// Map it once. The whole buffer may be read, a slot at a time, so
+	// the read range is all of it.
+	//
+
+	read_range = { 0, (SIZE_T)readback_desc.Width };
+	result = buffer->readback_buffer->Map(0, &read_range, &mapped);
 	throw_if_failed(result);
+
+	buffer->readback_data = (const unsigned char*)mapped;
+	initialize_readback_ring(&buffer->readback_slots, READBACK_SLOT_COUNT);
+	buffer->recording_slot = INVALID_READBACK_SLOT;
+}
+
+D3D12_PLACED_SUBRESOURCE_FOOTPRINT begin_readback_copy(compute_buffer* buffer) {
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+
+	buffer->recording_slot = acquire_readback_slot(&buffer->readback_slots);
+
+	if (buffer->recording_slot == INVALID_READBACK_SLOT) {
+		throw std::exception();
+	}
+
+	footprint = buffer->footprint_for_readback;
+	footprint.Offset += buffer->recording_slot * buffer->readback_slot_stride;
+
+	return footprint;
+}
+
+void commit_readback_copy(
+	compute_buffer* buffer,
+	dx12_handler* dx12,
+	const queue_ticket* ticket
+) {
+	commit_readback_slot(
+		&buffer->readback_slots,
+		buffer->recording_slot,
+		queue_for_kind(dx12, ticket->queue)->timeline,
+		ticket->value
+	);
+
+	buffer->recording_slot = INVALID_READBACK_SLOT;
+}
+
+const unsigned char* readback_slot_data(
+	const compute_buffer* buffer,
+	const unsigned int slot
+) {
+	return buffer->readback_data + slot * buffer->readback_slot_stride;
+}
+
+void initialize_cpu_compute_buffer(
+	compute_buffer* buffer,
+	const unsigned int width,
+	const unsigned int height,
+	const DXGI_FORMAT format
+) {
+	cpu_footprint footprint;
+	cpu_texel_format texel_format;
+
+	// Only the formats the CPU executor can write.
+	if (!dxgi_to_cpu_texel_format(format, &texel_format)) {
+		throw std::exception();
+	}
+
+	buffer->layout = COMPUTE_BUFFER_TEXTURE;
+	buffer->width = width;
+	buffer->height = height;
+	buffer->format = format;
+	buffer->element_size = 0;
+	buffer->size_in_bytes = 0;
+
+	//
+	// Lay the host memory out the way GetCopyableFootprints would
+	// lay out the readback buffer.
+	//
+
+	footprint = cpu_readback_footprint(width, height, cpu_texel_size(texel_format));
+
+	buffer->footprint_for_readback = {};
+	buffer->footprint_for_readback.Offset = footprint.offset;
+	buffer->footprint_for_readback.Footprint.Format = format;
+	buffer->footprint_for_readback.Footprint.Width = footprint.width;
+	buffer->footprint_for_readback.Footprint.Height = footprint.height;
+	buffer->footprint_for_readback.Footprint.Depth = 1;
+	buffer->footprint_for_readback.Footprint.RowPitch = footprint.row_pitch;
+
+	buffer->cpu_readback_data = new BYTE[(size_t)footprint.total_size];
+	buffer->readback_data = buffer->cpu_readback_data;
+	buffer->readback_slot_stride = footprint.total_size;
+	initialize_readback_ring(&buffer->readback_slots, 1);
+	buffer->recording_slot = INVALID_READBACK_SLOT;
+	buffer->buffer_memory = empty_gpu_allocation();
+	buffer->readback_memory = empty_gpu_allocation();
+	buffer->staging_uav_index = INVALID_DESCRIPTOR_INDEX;
+	buffer->uav_index = INVALID_DESCRIPTOR_INDEX;
+}
+
+void shutdown_compute_buffer(compute_buffer* buffer, dx12_handler* dx12) {
+	D3D12_RANGE written_range;
+
+	delete[] buffer->cpu_readback_data;
+	buffer->cpu_readback_data = NULL;
+
+	//
+	// Hand the descriptor slots back. The CPU path never had any.
+	//
+
+	if (buffer->uav_index != INVALID_DESCRIPTOR_INDEX) {
+		free_heap_index(dx12->cbv_srv_uav_heap, buffer->uav_index);
+		free_heap_index(dx12->staging_heap, buffer->staging_uav_index);
+		untrack_resource(&dx12->resource_states, buffer->buffer.Get());
+	}
+
+	//
+	// The resources go before the memory they were placed in.
+	//
+
+	if (buffer->readback_buffer != NULL && buffer->readback_data != NULL) {
+		written_range = { 0, 0 };
+		buffer->readback_buffer->Unmap(0, &written_range);
+	}
+
+	buffer->readback_data = NULL;
+
+	buffer->readback_buffer.Reset();
+	buffer->buffer.Reset();
+
+	if (dx12 != NULL && dx12->memory != NULL) {
+		free_gpu_memory(dx12->memory, &buffer->readback_memory);
+		free_gpu_memory(dx12->memory, &buffer->buffer_memory);
+	}
 }
@@ -7,25 +7,101 @@
 
 	A UAV can be written/read by multiple threads without memory
 	conflicts.
+
+	The buffer is a 2D texture (RWTexture2D) unless it was made with
+	initialize_structured_compute_buffer (RWStructuredBuffer<T>) or
+	initialize_raw_compute_buffer (RWByteAddressBuffer). Those are plain
+	buffer resources: the readback is one CopyBufferRegion with no row
+	padding, and a readback slot can be read as a typed_span of T.
 */
 
 #pragma once
 
 #include "stdafx.h"
 #include "dx12_handler.h"
+#include "readback_ring.h"
+#include "cpu_executor.h"
+
+// Enough for the GPU to fill one slot while the CPU reads the other.
+const unsigned int READBACK_SLOT_COUNT = 2;
+
+enum compute_buffer_layout {
+	COMPUTE_BUFFER_TEXTURE,
+	COMPUTE_BUFFER_STRUCTURED,
+	COMPUTE_BUFFER_RAW
+};
+
+/*
+	count elements of T in host memory. Doesn't own them.
+*/
+template <typename T>
+struct typed_span {
+	T* data;
+	size_t count;
+
+	T& operator[](const size_t i) const { return data[i]; }
+	T* begin() const { return data; }
+	T* end() const { return data + count; }
+	size_t size() const { return count; }
+};
 
 struct compute_buffer {
 	ComPtr<ID3D12Resource> buffer;
 	ComPtr<ID3D12Resource> readback_buffer;
+
+	// Where buffer and readback_buffer were placed.
+	gpu_allocation buffer_memory;
+	gpu_allocation readback_memory;
 	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint_for_readback;
 
+	//
+	// readback_buffer holds READBACK_SLOT_COUNT copies of the
+	// footprint, slot k at k * readback_slot_stride. It is mapped at
+	// readback_data for as long as the buffer lives. readback_slots
+	// says which slot the next copy goes to and which one is safe to
+	// read.
+	//
+
+	const unsigned char* readback_data;
+	uint64_t readback_slot_stride;
+	readback_ring readback_slots;
+
+	// The slot the copy being recorded writes to.
+	unsigned int recording_slot;
+
+	// Only used by the CPU executor. Laid out like readback_buffer.
+	BYTE* cpu_readback_data;
+
+	// Where the UAV was written in the staging heap, and where it was
+	// copied to in the shader visible heap.
+	unsigned int staging_uav_index;
 	unsigned int uav_index;
 
+	compute_buffer_layout layout;
+
+	//
+	// A structured or raw buffer has width elements and a height of 1.
+	// element_size is the stride of a structured buffer, and 4 for a
+	// raw one. size_in_bytes is only set for those two.
+	//
+
 	unsigned int width;
 	unsigned int height;
 	DXGI_FORMAT format;
+	unsigned int element_size;
+	uint64_t size_in_bytes;
+
+	// The last copy that read buffer. Anything that writes buffer on
+	// another queue has to wait for it.
+	queue_ticket last_read;
 };
 
+// The DXGI format a cpu_texel_format mirrors.
+DXGI_FORMAT cpu_texel_format_to_dxgi(const cpu_texel_format format);
+
+// Returns false for formats the CPU side doesn't know.
+bool dxgi_to_cpu_texel_format(const DXGI_FORMAT format, cpu_texel_format* texel_format);
+
 void initialize_compute_buffer(
 	compute_buffer* buffer,
 	dx12_handler* dx12,
@@ -34,6 +110,30 @@ void initialize_compute_buffer(
 	const DXGI_FORMAT format
 );
 
+/*
+	Structured and raw buffers are read back as a single row, and a
+	row's width and pitch are UINTs, so neither can be bigger than this.
+	Anything bigger throws.
+*/
+const uint64_t MAX_LINEAR_BUFFER_BYTES = 0xFFFFFFFF;
+
+// A RWStructuredBuffer of num_elements elements, element_size bytes each.
+void initialize_structured_compute_buffer(
+	compute_buffer* buffer,
+	dx12_handler* dx12,
+	const unsigned int num_elements,
+	const unsigned int element_size
+);
+
+// A RWByteAddressBuffer. size_in_bytes has to be a multiple of 4.
+void initialize_raw_compute_buffer(
+	compute_buffer* buffer,
+	dx12_handler* dx12,
+	const uint64_t size_in_bytes
+);
+
+bool is_linear_compute_buffer(const compute_buffer* buffer);
+
 void allocate_buffer_on_gpu(
 	compute_buffer* buffer,
 	dx12_handler* dx12
@@ -48,3 +148,54 @@ void initialize_readback_buffer(
 	compute_buffer* buffer,
 	dx12_handler* dx12
 );
+
+/*
+	Picks the slot for a copy about to be recorded, and returns where
+	in readback_buffer the copy should go. Throws if every slot is
+	being read.
+*/
+D3D12_PLACED_SUBRESOURCE_FOOTPRINT begin_readback_copy(compute_buffer* buffer);
+
+// The copy was submitted. It is done once ticket is.
+void commit_readback_copy(
+	compute_buffer* buffer,
+	dx12_handler* dx12,
+	const queue_ticket* ticket
+);
+
+// Read-only view of a slot handed out by readback_slots.
+const unsigned char* readback_slot_data(
+	const compute_buffer* buffer,
+	const unsigned int slot
+);
+
+/*
+	A readback slot of a structured or raw buffer as elements of T.
+	Throws for a texture, or if T isn't the structure's size.
+*/
+template <typename T>
+typed_span<const T> readback_span(
+	const compute_buffer* buffer,
+	const unsigned int slot
+) {
+	typed_span<const T> span;
+
+	if (!is_linear_compute_buffer(buffer)
+		|| (buffer->layout == COMPUTE_BUFFER_STRUCTURED && buffer->element_size != sizeof(T))) {
+		throw std::exception();
+	}
+
+	span.data = (const T*)readback_slot_data(buffer, slot);
+	span.count = (size_t)(buffer->size_in_bytes / sizeof(T));
+
+	return span;
+}
+
+void initialize_cpu_compute_buffer(
+	compute_buffer* buffer,
+	const unsigned int width,
+	const unsigned int height,
+	const DXGI_FORMAT format
+);
+
+void shutdown_compute_buffer(compute_buffer* buffer, dx12_handler* dx12);
@@ -0,0 +1,1802 @@
+// Liam Wynn, 01/09/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "compute_graph.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <random>
+
+using namespace std;
+
+void initialize_compute_graph(compute_graph* graph) {
+	graph->resources.clear();
+	graph->passes.clear();
+}
+
+graph_state graph_usage_state(const graph_usage usage) {
+	return (graph_state)1 << usage;
+}
+
+bool graph_usage_writes(const graph_usage usage) {
+	return usage == GRAPH_USAGE_UNORDERED_ACCESS || usage == GRAPH_USAGE_COPY_DEST;
+}
+
+const char* graph_usage_name(const graph_usage usage) {
+	switch (usage) {
+	case GRAPH_USAGE_UNORDERED_ACCESS:
+		return "uav";
+	case GRAPH_USAGE_SHADER_RESOURCE:
+		return "srv";
+	case GRAPH_USAGE_COPY_SOURCE:
+		return "copy source";
+	case GRAPH_USAGE_COPY_DEST:
+		return "copy dest";
+	default:
+		return "unknown";
+	}
+}
+
+bool copy_queue_can_use(const graph_state state) {
+	graph_state copy_states;
+
+	copy_states = graph_usage_state(GRAPH_USAGE_COPY_SOURCE) | graph_usage_state(GRAPH_USAGE_COPY_DEST);
+
+	return (state & ~copy_states) == 0;
+}
+
+unsigned int add_graph_resource(
+	compute_graph* graph,
+	const string& name,
+	const uint64_t size,
+	const uint64_t alignment
+) {
+	graph_resource resource;
+
+	resource.name = name;
+	resource.size = size;
+	resource.alignment = alignment;
+	resource.imported = false;
+	resource.initial_state = 0;
+	resource.fixed_state = false;
+	resource.output = false;
+
+	graph->resources.push_back(resource);
+
+	return (unsigned int)graph->resources.size() - 1;
+}
+
+unsigned int import_graph_resource(
+	compute_graph* graph,
+	const string& name,
+	const graph_state initial_state,
+	const bool fixed_state
+) {
+	graph_resource resource;
+
+	resource.name = name;
+	resource.size = 0;
+	resource.alignment = 0;
+	resource.imported = true;
+	resource.initial_state = initial_state;
+	resource.fixed_state = fixed_state;
+	resource.output = false;
+
+	graph->resources.push_back(resource);
+
+	return (unsigned int)graph->resources.size() - 1;
+}
+
+void mark_graph_output(compute_graph* graph, const unsigned int resource) {
+	graph->resources[resource].output = true;
+}
+
+unsigned int add_graph_pass(
+	compute_graph* graph,
+	const string& name,
+	const graph_pass_kind kind,
+	const double cost
+) {
+	graph_pass pass;
+
+	pass.name = name;
+	pass.kind = kind;
+	pass.cost = cost;
+	pass.side_effects = false;
+
+	graph->passes.push_back(pass);
+
+	return (unsigned int)graph->passes.size() - 1;
+}
+
+void add_graph_access(
+	compute_graph* graph,
+	const unsigned int pass,
+	const unsigned int resource,
+	const graph_usage usage
+) {
+	graph->passes[pass].accesses.push_back({ resource, usage });
+}
+
+/* COMPILING */
+
+/*
+	What the passes need from each other, in pass indices. data are the
+	passes whose results a pass uses, order the ones it only has to
+	come after.
+*/
+struct pass_dependencies {
+	vector<vector<unsigned int>> data;
+	vector<vector<unsigned int>> order;
+};
+
+static bool find_pass_dependencies(
+	const compute_graph* graph,
+	pass_dependencies* deps,
+	string* error
+) {
+	const unsigned int num_passes = (unsigned int)graph->passes.size();
+	const unsigned int num_resources = (unsigned int)graph->resources.size();
+	vector<unsigned int> last_writer(num_resources, GRAPH_NONE);
+	vector<vector<unsigned int>> readers(num_resources);
+
+	deps->data.assign(num_passes, vector<unsigned int>());
+	deps->order.assign(num_passes, vector<unsigned int>());
+
+	for (unsigned int p = 0; p < num_passes; p++) {
+		const graph_pass* pass = &graph->passes[p];
+
+		for (size_t a = 0; a < pass->accesses.size(); a++) {
+			const graph_access* access = &pass->accesses[a];
+			const graph_resource* resource;
+
+			if (access->resource >= num_resources || access->usage >= GRAPH_USAGE_COUNT) {
+				*error = "pass " + pass->name + " uses a resource that isn't in the graph";
+				return false;
+			}
+
+			resource = &graph->resources[access->resource];
+
+			for (size_t b = 0; b < a; b++) {
+				if (pass->accesses[b].resource == access->resource) {
+					*error = "pass " + pass->name + " uses " + resource->name + " twice";
+					return false;
+				}
+			}
+
+			if (pass->kind == GRAPH_PASS_COPY && !copy_queue_can_use(graph_usage_state(access->usage))) {
+				*error = "copy pass " + pass->name + " can't use " + resource->name + " as " + graph_usage_name(access->usage);
+				return false;
+			}
+
+			if (resource->fixed_state && (resource->initial_state & graph_usage_state(access->usage)) == 0) {
+				*error = "pass " + pass->name + " uses " + resource->name + " as " + graph_usage_name(access->usage) + ", but it is fixed in another state";
+				return false;
+			}
+
+			if (!resource->imported && last_writer[access->resource] == GRAPH_NONE && !graph_usage_writes(access->usage)) {
+				*error = "pass " + pass->name + " reads " + resource->name + " before anything writes it";
+				return false;
+			}
+
+			if (last_writer[access->resource] != GRAPH_NONE) {
+				deps->data[p].push_back(last_writer[access->resource]);
+			}
+
+			if (graph_usage_writes(access->usage)) {
+				for (unsigned int reader : readers[access->resource]) {
+					deps->order[p].push_back(reader);
+				}
+			}
+		}
+
+		//
+		// Only now, so a pass's own accesses don't depend on each other.
+		//
+
+		for (const graph_access& access : pass->accesses) {
+			if (graph_usage_writes(access.usage)) {
+				last_writer[access.resource] = p;
+				readers[access.resource].clear();
+			}
+			else {
+				readers[access.resource].push_back(p);
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+	Walks back from the passes with side effects and the last writers
+	of outputs, through the passes they read from.
+*/
+static vector<bool> find_kept_passes(
+	const compute_graph* graph,
+	const pass_dependencies* deps
+) {
+	const unsigned int num_passes = (unsigned int)graph->passes.size();
+	vector<bool> kept(num_passes, false);
+	vector<unsigned int> last_writer(graph->resources.size(), GRAPH_NONE);
+	vector<unsigned int> stack;
+
+	for (unsigned int p = 0; p < num_passes; p++) {
+		for (const graph_access& access : graph->passes[p].accesses) {
+			if (graph_usage_writes(access.usage)) {
+				last_writer[access.resource] = p;
+			}
+		}
+
+		if (graph->passes[p].side_effects) {
+			stack.push_back(p);
+		}
+	}
+
+	for (size_t r = 0; r < graph->resources.size(); r++) {
+		if (graph->resources[r].output && last_writer[r] != GRAPH_NONE) {
+			stack.push_back(last_writer[r]);
+		}
+	}
+
+	while (!stack.empty()) {
+		unsigned int p = stack.back();
+		stack.pop_back();
+
+		if (kept[p]) {
+			continue;
+		}
+
+		kept[p] = true;
+
+		for (unsigned int producer : deps->data[p]) {
+			if (!kept[producer]) {
+				stack.push_back(producer);
+			}
+		}
+	}
+
+	return kept;
+}
+
+/*
+	Topological order of the kept passes. Of the passes that are ready,
+	the ones the last pass made ready go first, so a result is used soon
+	after it is made. Otherwise the earliest added goes first.
+*/
+static vector<unsigned int> order_passes(
+	const compute_graph* graph,
+	const pass_dependencies* deps,
+	const vector<bool>& kept
+) {
+	const unsigned int num_passes = (unsigned int)graph->passes.size();
+	vector<unsigned int> waiting_on(num_passes, 0);
+	vector<vector<unsigned int>> successors(num_passes);
+	priority_queue<unsigned int, vector<unsigned int>, greater<unsigned int>> ready;
+	vector<unsigned int> preferred;
+	vector<unsigned int> order;
+
+	for (unsigned int p = 0; p < num_passes; p++) {
+		vector<unsigned int> all;
+
+		if (!kept[p]) {
+			continue;
+		}
+
+		all = deps->data[p];
+		all.insert(all.end(), deps->order[p].begin(), deps->order[p].end());
+		sort(all.begin(), all.end());
+		all.erase(unique(all.begin(), all.end()), all.end());
+
+		for (unsigned int d : all) {
+			if (kept[d]) {
+				waiting_on[p]++;
+				successors[d].push_back(p);
+			}
+		}
+
+		if (waiting_on[p] == 0) {
+			ready.push(p);
+		}
+	}
+
+	while (!ready.empty() || !preferred.empty()) {
+		unsigned int p;
+		size_t first_new;
+
+		if (!preferred.empty()) {
+			p = preferred.back();
+			preferred.pop_back();
+		}
+		else {
+			p = ready.top();
+			ready.pop();
+		}
+
+		order.push_back(p);
+
+		//
+		// successors are in increasing order, and the stack pops the
+		// last one first, so push them backwards.
+		//
+
+		first_new = preferred.size();
+
+		for (unsigned int s : successors[p]) {
+			if (--waiting_on[s] == 0) {
+				preferred.push_back(s);
+			}
+		}
+
+		reverse(preferred.begin() + first_new, preferred.end());
+	}
+
+	return order;
+}
+
+/*
+	Copy passes that read something in the same run of reads as a
+	compute pass. A resource used on the copy queue decays to COMMON
+	when that batch is done, which could be while the compute pass is
+	still reading it, so these stay on the direct queue.
+*/
+static vector<bool> find_shared_copy_reads(
+	const compute_graph* graph,
+	const vector<unsigned int>& order
+) {
+	vector<bool> shared(graph->passes.size(), false);
+	vector<vector<unsigned int>> readers(graph->resources.size());
+
+	auto end_run = [&](const unsigned int r) {
+		bool copies = false;
+		bool computes = false;
+
+		for (unsigned int p : readers[r]) {
+			copies = copies || graph->passes[p].kind == GRAPH_PASS_COPY;
+			computes = computes || graph->passes[p].kind == GRAPH_PASS_COMPUTE;
+		}
+
+		if (copies && computes) {
+			for (unsigned int p : readers[r]) {
+				shared[p] = shared[p] || graph->passes[p].kind == GRAPH_PASS_COPY;
+			}
+		}
+
+		readers[r].clear();
+	};
+
+	for (unsigned int p : order) {
+		for (const graph_access& access : graph->passes[p].accesses) {
+			if (graph_usage_writes(access.usage)) {
+				end_run(access.resource);
+			}
+			else {
+				readers[access.resource].push_back(p);
+			}
+		}
+	}
+
+	for (unsigned int r = 0; r < graph->resources.size(); r++) {
+		end_run(r);
+	}
+
+	return shared;
+}
+
+static void assign_queues(
+	const compute_graph* graph,
+	const pass_dependencies* deps,
+	const graph_compile_options* options,
+	const vector<unsigned int>& order,
+	vector<queue_kind>* pass_queue
+) {
+	vector<bool> handed_on(graph->passes.size(), false);
+	vector<bool> shared_reads;
+	double load[QUEUE_KIND_COUNT];
+
+	for (int q = 0; q < QUEUE_KIND_COUNT; q++) {
+		load[q] = 0.0;
+	}
+
+	shared_reads = find_shared_copy_reads(graph, order);
+
+	pass_queue->assign(graph->passes.size(), QUEUE_DIRECT);
+
+	for (unsigned int p : order) {
+		const graph_pass* pass = &graph->passes[p];
+		queue_kind queue;
+		bool continued;
+
+		if (pass->kind == GRAPH_PASS_COPY) {
+			queue = options->async_copy && !shared_reads[p] ? QUEUE_COPY : QUEUE_DIRECT;
+		}
+		else if (!options->async_compute) {
+			queue = QUEUE_DIRECT;
+		}
+		else {
+			//
+			// Carry on the queue of the first producer whose queue nothing
+			// else has carried on, so a chain stays on one queue. A branch
+			// off it goes to whichever queue has less work so far.
+			//
+
+			continued = false;
+			queue = QUEUE_DIRECT;
+
+			for (unsigned int producer : deps->data[p]) {
+				if (graph->passes[producer].kind == GRAPH_PASS_COMPUTE && !handed_on[producer]) {
+					handed_on[producer] = true;
+					queue = (*pass_queue)[producer];
+					continued = true;
+					break;
+				}
+			}
+
+			if (!continued) {
+				queue = load[QUEUE_COMPUTE] < load[QUEUE_DIRECT] ? QUEUE_COMPUTE : QUEUE_DIRECT;
+			}
+		}
+
+		(*pass_queue)[p] = queue;
+		load[queue] += pass->cost;
+	}
+}
+
+static bool queue_can_transition(const queue_kind queue, const graph_state before, const graph_state after) {
+	return queue != QUEUE_COPY || (copy_queue_can_use(before) && copy_queue_can_use(after));
+}
+
+/*
+	A step made only for barriers, before step insert_before. Steps
+	refer to it as num_steps + its index until they are renumbered.
+*/
+struct barrier_step {
+	unsigned int insert_before;
+	compiled_step step;
+};
+
+// One access to a resource, in schedule order.
+struct resource_use {
+	unsigned int step;
+	graph_usage usage;
+};
+
+/*
+	Uses of a resource split into runs that need one state: a run of
+	reads, or one write.
+*/
+struct use_segment {
+	vector<unsigned int> steps;
+	graph_state state;
+	bool writes;
+	bool uav;
+};
+
+static vector<use_segment> segment_uses(const vector<resource_use>& uses) {
+	vector<use_segment> segments;
+
+	for (const resource_use& use : uses) {
+		bool writes = graph_usage_writes(use.usage);
+
+		if (writes || segments.empty() || segments.back().writes) {
+			use_segment segment;
+
+			segment.state = 0;
+			segment.writes = writes;
+			segment.uav = use.usage == GRAPH_USAGE_UNORDERED_ACCESS;
+			segments.push_back(segment);
+		}
+
+		segments.back().steps.push_back(use.step);
+		segments.back().state |= graph_usage_state(use.usage);
+	}
+
+	return segments;
+}
+
+/*
+	Puts the transition into segment in the first place that works, and
+	adds the dependencies that keep it away from the accesses on either
+	side of it.
+*/
+static void place_transition(
+	vector<compiled_step>* steps,
+	vector<barrier_step>* barrier_steps,
+	const use_segment* previous,
+	const use_segment* segment,
+	const graph_barrier* barrier,
+	graph_compile_stats* stats
+) {
+	const unsigned int num_steps = (unsigned int)steps->size();
+	unsigned int first;
+	queue_kind queue;
+	bool one_queue;
+
+	first = segment->steps.front();
+	queue = (*steps)[first].queue;
+	one_queue = true;
+
+	for (unsigned int s : segment->steps) {
+		one_queue = one_queue && (*steps)[s].queue == queue;
+	}
+
+	//
+	// Before the segment, if it is all on one queue: the queue then runs
+	// the barrier ahead of every access in the segment, and the first
+	// one already comes after the segment before.
+	//
+
+	if (one_queue && queue_can_transition(queue, barrier->before, barrier->after)) {
+		(*steps)[first].before.push_back(*barrier);
+		return;
+	}
+
+	//
+	// After the last step of the segment before. It has to wait for the
+	// rest of that segment, and the new one has to wait for it.
+	//
+
+	if (previous != NULL) {
+		unsigned int last = previous->steps.back();
+		queue_kind last_queue = (*steps)[last].queue;
+
+		//
+		// Not on the copy queue, though: the resource decays to COMMON
+		// once that batch is done, and the transition with it.
+		//
+
+		if (last_queue != QUEUE_COPY && queue_can_transition(last_queue, barrier->before, barrier->after)) {
+			(*steps)[last].after.push_back(*barrier);
+
+			for (unsigned int s : previous->steps) {
+				if (s != last && (*steps)[s].queue != last_queue) {
+					(*steps)[last].deps.push_back(s);
+				}
+			}
+
+			for (unsigned int s : segment->steps) {
+				(*steps)[s].deps.push_back(last);
+			}
+
+			return;
+		}
+	}
+
+	//
+	// A step of its own on the direct queue, which can do any of them.
+	//
+
+	barrier_step inserted;
+
+	inserted.insert_before = first;
+	inserted.step.pass = GRAPH_NONE;
+	inserted.step.queue = QUEUE_DIRECT;
+	inserted.step.batch = GRAPH_NONE;
+	inserted.step.before.push_back(*barrier);
+
+	if (previous != NULL) {
+		inserted.step.deps = previous->steps;
+	}
+
+	for (unsigned int s : segment->steps) {
+		(*steps)[s].deps.push_back(num_steps + (unsigned int)barrier_steps->size());
+	}
+
+	barrier_steps->push_back(inserted);
+	stats->barrier_steps++;
+}
+
+static void plan_barriers(
+	const compute_graph* graph,
+	compiled_graph* compiled,
+	vector<barrier_step>* barrier_steps
+) {
+	const unsigned int num_resources = (unsigned int)graph->resources.size();
+	vector<vector<resource_use>> uses(num_resources);
+
+	for (unsigned int s = 0; s < compiled->steps.size(); s++) {
+		for (const graph_access& access : graph->passes[compiled->steps[s].pass].accesses) {
+			uses[access.resource].push_back({ s, access.usage });
+		}
+	}
+
+	compiled->first_state.assign(num_resources, 0);
+
+	for (unsigned int r = 0; r < num_resources; r++) {
+		const graph_resource* resource = &graph->resources[r];
+		vector<use_segment> segments;
+		graph_state current;
+
+		if (uses[r].empty()) {
+			continue;
+		}
+
+		segments = segment_uses(uses[r]);
+		compiled->first_state[r] = segments.front().state;
+
+		if (resource->fixed_state) {
+			continue;
+		}
+
+		//
+		// A transient is made in the state of its first use.
+		//
+
+		current = resource->imported ? resource->initial_state : segments.front().state;
+
+		for (size_t i = 0; i < segments.size(); i++) {
+			const use_segment* previous = i > 0 ? &segments[i - 1] : NULL;
+			graph_barrier barrier;
+
+			//
+			// Off the copy queue, the segment waits for the copy batch
+			// before it, so the resource has decayed to COMMON by then.
+			// Between batches on the copy queue it depends on the
+			// batches, which apply_copy_queue_decay sees to.
+			//
+
+			if (previous != NULL
+				&& compiled->steps[previous->steps.back()].queue == QUEUE_COPY
+				&& compiled->steps[segments[i].steps.front()].queue != QUEUE_COPY) {
+				current = 0;
+			}
+
+			if (segments[i].state != current) {
+				barrier.kind = GRAPH_BARRIER_TRANSITION;
+				barrier.resource = r;
+				barrier.before = current;
+				barrier.after = segments[i].state;
+
+				place_transition(&compiled->steps, barrier_steps, previous, &segments[i], &barrier, &compiled->stats);
+				compiled->stats.transitions++;
+
+				current = segments[i].state;
+			}
+			else if (previous != NULL && previous->uav && segments[i].uav) {
+				barrier.kind = GRAPH_BARRIER_UAV;
+				barrier.resource = r;
+				barrier.before = current;
+				barrier.after = current;
+
+				compiled->steps[segments[i].steps.front()].before.push_back(barrier);
+				compiled->stats.uav_barriers++;
+			}
+		}
+	}
+}
+
+/*
+	Finds where each resource is used, plans the transients' memory, and
+	puts an aliasing barrier before the first use of every transient that
+	takes over memory from another. That use waits for every step that
+	used the memory before, on every queue.
+*/
+static void plan_memory(const compute_graph* graph, compiled_graph* compiled) {
+	const unsigned int num_resources = (unsigned int)graph->resources.size();
+	const unsigned int num_steps = (unsigned int)compiled->steps.size();
+	vector<unsigned int> last_on_queue[QUEUE_KIND_COUNT];
+	vector<unsigned int> transients;
+
+	compiled->first_use.assign(num_resources, GRAPH_NONE);
+	compiled->last_use.assign(num_resources, GRAPH_NONE);
+	compiled->transient_index.assign(num_resources, GRAPH_NONE);
+	compiled->transient_requests.clear();
+
+	for (int q = 0; q < QUEUE_KIND_COUNT; q++) {
+		last_on_queue[q].assign(num_resources, GRAPH_NONE);
+	}
+
+	for (unsigned int s = 0; s < num_steps; s++) {
+		for (const graph_access& access : graph->passes[compiled->steps[s].pass].accesses) {
+			if (compiled->first_use[access.resource] == GRAPH_NONE) {
+				compiled->first_use[access.resource] = s;
+			}
+
+			compiled->last_use[access.resource] = s;
+			last_on_queue[compiled->steps[s].queue][access.resource] = s;
+		}
+	}
+
+	for (unsigned int r = 0; r < num_resources; r++) {
+		const graph_resource* resource = &graph->resources[r];
+		transient_request request;
+
+		if (resource->imported || compiled->first_use[r] == GRAPH_NONE) {
+			continue;
+		}
+
+		//
+		// An output has to outlast the graph, so nothing may take its
+		// memory afterwards.
+		//
+
+		request.size = resource->size;
+		request.alignment = resource->alignment;
+		request.first_use = compiled->first_use[r];
+		request.last_use = resource->output ? num_steps - 1 : compiled->last_use[r];
+
+		compiled->transient_index[r] = (unsigned int)compiled->transient_requests.size();
+		compiled->transient_requests.push_back(request);
+		transients.push_back(r);
+	}
+
+	plan_transient_aliasing(compiled->transient_requests.data(), (unsigned int)compiled->transient_requests.size(), &compiled->aliasing);
+
+	for (size_t b = 0; b < transients.size(); b++) {
+		const transient_request* taker = &compiled->transient_requests[b];
+		uint64_t taker_start = compiled->aliasing.offsets[b];
+		uint64_t taker_end = taker_start + taker->size;
+		compiled_step* first = &compiled->steps[taker->first_use];
+		bool aliases = false;
+
+		for (size_t a = 0; a < transients.size(); a++) {
+			const transient_request* owner = &compiled->transient_requests[a];
+			uint64_t owner_start = compiled->aliasing.offsets[a];
+			uint64_t owner_end = owner_start + owner->size;
+
+			if (owner->last_use >= taker->first_use || owner_end <= taker_start || taker_end <= owner_start) {
+				continue;
+			}
+
+			aliases = true;
+
+			for (int q = 0; q < QUEUE_KIND_COUNT; q++) {
+				if (last_on_queue[q][transients[a]] != GRAPH_NONE) {
+					first->deps.push_back(last_on_queue[q][transients[a]]);
+				}
+			}
+		}
+
+		if (aliases) {
+			first->before.push_back({ GRAPH_BARRIER_ALIASING, transients[b], 0, 0 });
+			compiled->stats.aliasing_barriers++;
+		}
+	}
+}
+
+/*
+	Puts the barrier-only steps in place and renumbers everything that
+	refers to a step. Steps only move later, so the order is kept.
+*/
+static void insert_barrier_steps(compiled_graph* compiled, vector<barrier_step>* barrier_steps) {
+	const unsigned int num_steps = (unsigned int)compiled->steps.size();
+	vector<unsigned int> renumber(num_steps + barrier_steps->size());
+	vector<vector<unsigned int>> inserted_before(num_steps);
+	vector<compiled_step> steps;
+
+	if (barrier_steps->empty()) {
+		return;
+	}
+
+	for (unsigned int b = 0; b < barrier_steps->size(); b++) {
+		inserted_before[(*barrier_steps)[b].insert_before].push_back(b);
+	}
+
+	for (unsigned int s = 0; s < num_steps; s++) {
+		for (unsigned int b : inserted_before[s]) {
+			renumber[num_steps + b] = (unsigned int)steps.size();
+			steps.push_back((*barrier_steps)[b].step);
+		}
+
+		renumber[s] = (unsigned int)steps.size();
+		steps.push_back(compiled->steps[s]);
+	}
+
+	for (compiled_step& step : steps) {
+		for (unsigned int& d : step.deps) {
+			d = renumber[d];
+		}
+	}
+
+	for (unsigned int& s : compiled->pass_step) {
+		if (s != GRAPH_NONE) {
+			s = renumber[s];
+		}
+	}
+
+	for (size_t r = 0; r < compiled->first_use.size(); r++) {
+		if (compiled->first_use[r] != GRAPH_NONE) {
+			compiled->first_use[r] = renumber[compiled->first_use[r]];
+			compiled->last_use[r] = renumber[compiled->last_use[r]];
+		}
+	}
+
+	for (transient_request& request : compiled->transient_requests) {
+		request.first_use = renumber[request.first_use];
+		request.last_use = renumber[request.last_use];
+	}
+
+	compiled->steps.swap(steps);
+}
+
+/*
+	A step that waits on another queue starts a batch, and a step that
+	another queue waits on ends one, so every wait is on a whole batch.
+*/
+static void build_batches(compiled_graph* compiled) {
+	const unsigned int num_steps = (unsigned int)compiled->steps.size();
+	vector<bool> waited_on(num_steps, false);
+	unsigned int open[QUEUE_KIND_COUNT];
+	vector<uint64_t> batch_value;
+	vector<unsigned int> batch_of_value[QUEUE_KIND_COUNT];
+	queue_scheduler scheduler;
+
+	compiled->batches.clear();
+
+	for (int q = 0; q < QUEUE_KIND_COUNT; q++) {
+		open[q] = GRAPH_NONE;
+		batch_of_value[q].push_back(GRAPH_NONE);
+	}
+
+	for (const compiled_step& step : compiled->steps) {
+		for (unsigned int d : step.deps) {
+			if (compiled->steps[d].queue != step.queue) {
+				waited_on[d] = true;
+			}
+		}
+	}
+
+	for (unsigned int s = 0; s < num_steps; s++) {
+		compiled_step* step = &compiled->steps[s];
+		bool waits = false;
+
+		for (unsigned int d : step->deps) {
+			waits = waits || compiled->steps[d].queue != step->queue;
+		}
+
+		if (waits || open[step->queue] == GRAPH_NONE) {
+			graph_batch batch;
+
+			batch.queue = step->queue;
+			open[step->queue] = (unsigned int)compiled->batches.size();
+			compiled->batches.push_back(batch);
+		}
+
+		step->batch = open[step->queue];
+		compiled->batches[step->batch].steps.push_back(s);
+
+		if (waited_on[s]) {
+			open[step->queue] = GRAPH_NONE;
+		}
+	}
+
+	//
+	// A batch's value on its queue is its place among that queue's
+	// batches, counting from 1.
+	//
+
+	initialize_queue_scheduler(&scheduler);
+
+	for (unsigned int b = 0; b < compiled->batches.size(); b++) {
+		graph_batch* batch = &compiled->batches[b];
+		vector<queue_ticket> deps;
+		queue_ticket waits[QUEUE_KIND_COUNT];
+		unsigned int num_waits;
+
+		for (unsigned int s : batch->steps) {
+			for (unsigned int d : compiled->steps[s].deps) {
+				unsigned int other = compiled->steps[d].batch;
+
+				if (compiled->batches[other].queue != batch->queue) {
+					deps.push_back({ compiled->batches[other].queue, batch_value[other] });
+				}
+			}
+		}
+
+		num_waits = resolve_queue_waits(&scheduler, batch->queue, deps.data(), (unsigned int)deps.size(), waits);
+
+		for (unsigned int w = 0; w < num_waits; w++) {
+			batch->waits.push_back(batch_of_value[waits[w].queue][waits[w].value]);
+		}
+
+		compiled->stats.waits += num_waits;
+
+		batch_value.push_back(batch_of_value[batch->queue].size());
+		batch_of_value[batch->queue].push_back(b);
+		record_queue_signal(&scheduler, batch->queue, batch_value[b]);
+	}
+}
+
+/*
+	A resource used on the copy queue decays to COMMON once the batch
+	that used it is done. Replays the schedule, starts every transition
+	from the state the resource is really in, and adds a transition
+	where a copy finds it in COMMON but needs it in another state.
+*/
+static void apply_copy_queue_decay(const compute_graph* graph, compiled_graph* compiled) {
+	const unsigned int num_resources = (unsigned int)graph->resources.size();
+	vector<graph_state> state(num_resources);
+	vector<unsigned int> copy_batch(num_resources, GRAPH_NONE);
+
+	for (unsigned int r = 0; r < num_resources; r++) {
+		state[r] = graph->resources[r].imported ? graph->resources[r].initial_state : compiled->first_state[r];
+	}
+
+	auto touch = [&](const compiled_step* step, const unsigned int r) {
+		if (copy_batch[r] != GRAPH_NONE && copy_batch[r] != step->batch) {
+			state[r] = 0;
+			copy_batch[r] = GRAPH_NONE;
+		}
+
+		if (step->queue == QUEUE_COPY) {
+			copy_batch[r] = step->batch;
+		}
+	};
+
+	auto replay = [&](const compiled_step* step, vector<graph_barrier>* barriers) {
+		for (graph_barrier& barrier : *barriers) {
+			if (barrier.kind != GRAPH_BARRIER_TRANSITION) {
+				continue;
+			}
+
+			touch(step, barrier.resource);
+			barrier.before = state[barrier.resource];
+			state[barrier.resource] = barrier.after;
+		}
+	};
+
+	for (compiled_step& step : compiled->steps) {
+		replay(&step, &step.before);
+
+		if (step.pass != GRAPH_NONE) {
+			for (const graph_access& access : graph->passes[step.pass].accesses) {
+				graph_state needed = graph_usage_state(access.usage);
+
+				if (graph->resources[access.resource].fixed_state) {
+					continue;
+				}
+
+				touch(&step, access.resource);
+
+				if ((state[access.resource] & needed) == 0) {
+					step.before.push_back({ GRAPH_BARRIER_TRANSITION, access.resource, state[access.resource], needed });
+					compiled->stats.transitions++;
+					state[access.resource] = needed;
+				}
+			}
+		}
+
+		replay(&step, &step.after);
+	}
+}
+
+bool compile_compute_graph(
+	const compute_graph* graph,
+	const graph_compile_options* options,
+	compiled_graph* compiled,
+	string* error
+) {
+	pass_dependencies deps;
+	vector<bool> kept;
+	vector<unsigned int> order;
+	vector<queue_kind> pass_queue;
+	vector<barrier_step> barrier_steps;
+
+	compiled->steps.clear();
+	compiled->batches.clear();
+	compiled->stats = { 0, 0, 0, 0, 0, 0 };
+
+	if (!find_pass_dependencies(graph, &deps, error)) {
+		return false;
+	}
+
+	kept = find_kept_passes(graph, &deps);
+	order = order_passes(graph, &deps, kept);
+	assign_queues(graph, &deps, options, order, &pass_queue);
+
+	compiled->pass_step.assign(graph->passes.size(), GRAPH_NONE);
+	compiled->stats.culled_passes = (unsigned int)(graph->passes.size() - order.size());
+
+	for (unsigned int p : order) {
+		compiled_step step;
+
+		step.pass = p;
+		step.queue = pass_queue[p];
+		step.batch = GRAPH_NONE;
+
+		compiled->pass_step[p] = (unsigned int)compiled->steps.size();
+		compiled->steps.push_back(step);
+	}
+
+	for (compiled_step& step : compiled->steps) {
+		for (unsigned int d : deps.data[step.pass]) {
+			step.deps.push_back(compiled->pass_step[d]);
+		}
+
+		for (unsigned int d : deps.order[step.pass]) {
+			if (compiled->pass_step[d] != GRAPH_NONE) {
+				step.deps.push_back(compiled->pass_step[d]);
+			}
+		}
+	}
+
+	plan_memory(graph, compiled);
+	plan_barriers(graph, compiled, &barrier_steps);
+	insert_barrier_steps(compiled, &barrier_steps);
+
+	for (unsigned int s = 0; s < compiled->steps.size(); s++) {
+		vector<unsigned int>* step_deps = &compiled->steps[s].deps;
+
+		sort(step_deps->begin(), step_deps->end());
+		step_deps->erase(unique(step_deps->begin(), step_deps->end()), step_deps->end());
+		step_deps->erase(remove(step_deps->begin(), step_deps->end(), s), step_deps->end());
+	}
+
+	build_batches(compiled);
+	apply_copy_queue_decay(graph, compiled);
+
+	return true;
+}
+
+/*
+	Runs the batches on simulated queues, with each step taking
+	duration(pass), and fills in when every step started and finished.
+*/
+static double simulate_steps(
+	const compiled_graph* compiled,
+	const function<double(unsigned int)>& duration,
+	vector<double>* step_start,
+	vector<double>* step_finish
+) {
+	vector<simulated_submission> submissions;
+	uint64_t next_value[QUEUE_KIND_COUNT];
+	vector<uint64_t> batch_value(compiled->batches.size());
+	double makespan;
+
+	for (int q = 0; q < QUEUE_KIND_COUNT; q++) {
+		next_value[q] = 1;
+	}
+
+	for (size_t b = 0; b < compiled->batches.size(); b++) {
+		const graph_batch* batch = &compiled->batches[b];
+		simulated_submission submission;
+
+		submission.queue = batch->queue;
+		submission.signal_value = next_value[batch->queue]++;
+		submission.duration = 0.0;
+
+		for (unsigned int w : batch->waits) {
+			submission.waits.push_back({ compiled->batches[w].queue, batch_value[w] });
+		}
+
+		for (unsigned int s : batch->steps) {
+			if (compiled->steps[s].pass != GRAPH_NONE) {
+				submission.duration += duration(compiled->steps[s].pass);
+			}
+		}
+
+		batch_value[b] = submission.signal_value;
+		submissions.push_back(submission);
+	}
+
+	makespan = simulate_queues(&submissions);
+
+	if (step_start != NULL) {
+		step_start->assign(compiled->steps.size(), 0.0);
+		step_finish->assign(compiled->steps.size(), 0.0);
+
+		for (size_t b = 0; b < compiled->batches.size(); b++) {
+			double time = submissions[b].start;
+
+			for (unsigned int s : compiled->batches[b].steps) {
+				(*step_start)[s] = time;
+
+				if (compiled->steps[s].pass != GRAPH_NONE) {
+					time += duration(compiled->steps[s].pass);
+				}
+
+				(*step_finish)[s] = time;
+			}
+		}
+	}
+
+	return makespan;
+}
+
+double simulate_compiled_graph(
+	const compute_graph* graph,
+	const compiled_graph* compiled
+) {
+	return simulate_steps(
+		compiled,
+		[graph](unsigned int pass) { return graph->passes[pass].cost; },
+		NULL,
+		NULL
+	);
+}
+
+static const char* queue_color(const queue_kind queue) {
+	switch (queue) {
+	case QUEUE_DIRECT:
+		return "lightblue";
+	case QUEUE_COMPUTE:
+		return "palegreen";
+	case QUEUE_COPY:
+		return "khaki";
+	default:
+		return "white";
+	}
+}
+
+void write_compute_graph_dot(
+	const compute_graph* graph,
+	const compiled_graph* compiled,
+	FILE* out
+) {
+	fprintf(out, "digraph compute_graph {\n");
+	fprintf(out, "\trankdir=LR;\n");
+	fprintf(out, "\tnode [shape=box, style=filled, fontname=\"Consolas\"];\n");
+
+	for (unsigned int p = 0; p < graph->passes.size(); p++) {
+		if (compiled->pass_step[p] == GRAPH_NONE) {
+			fprintf(out, "\tp%u [label=\"%s\\nculled\", fillcolor=lightgrey, style=\"filled,dashed\"];\n", p, graph->passes[p].name.c_str());
+		}
+	}
+
+	for (unsigned int s = 0; s < compiled->steps.size(); s++) {
+		const compiled_step* step = &compiled->steps[s];
+		unsigned int num_barriers = (unsigned int)(step->before.size() + step->after.size());
+
+		if (step->pass == GRAPH_NONE) {
+			fprintf(
+				out,
+				"\ts%u [label=\"barriers\\n%s, batch %u\\n%u barrier(s)\", shape=diamond, fillcolor=%s];\n",
+				s,
+				queue_kind_name(step->queue),
+				step->batch,
+				num_barriers,
+				queue_color(step->queue)
+			);
+		}
+		else {
+			fprintf(
+				out,
+				"\ts%u [label=\"%s\\n%s, batch %u\\n%u barrier(s)\", fillcolor=%s];\n",
+				s,
+				graph->passes[step->pass].name.c_str(),
+				queue_kind_name(step->queue),
+				step->batch,
+				num_barriers,
+				queue_color(step->queue)
+			);
+		}
+	}
+
+	for (unsigned int s = 0; s < compiled->steps.size(); s++) {
+		for (unsigned int d : compiled->steps[s].deps) {
+			if (compiled->steps[d].queue != compiled->steps[s].queue) {
+				fprintf(out, "\ts%u -> s%u [penwidth=3];\n", d, s);
+			}
+			else {
+				fprintf(out, "\ts%u -> s%u;\n", d, s);
+			}
+		}
+	}
+
+	fprintf(out, "}\n");
+}
+
+/* CHECKING */
+
+/*
+	Random graphs that look like real ones: most passes are compute
+	passes that read a few recent results and write one, some are
+	copies, and a few results are outputs.
+*/
+static void build_random_graph(compute_graph* graph, const unsigned int num_passes, mt19937* rng) {
+	const unsigned int recent = 32;
+	uniform_real_distribution<double> log_size(16.0, 24.0);
+	vector<unsigned int> written;
+	vector<unsigned int> transients;
+	unsigned int upload;
+	unsigned int readback;
+	unsigned int history;
+
+	initialize_compute_graph(graph);
+
+	upload = import_graph_resource(graph, "upload", graph_usage_state(GRAPH_USAGE_COPY_SOURCE), true);
+	readback = import_graph_resource(graph, "readback", graph_usage_state(GRAPH_USAGE_COPY_DEST), true);
+	history = import_graph_resource(graph, "history", graph_usage_state(GRAPH_USAGE_SHADER_RESOURCE), false);
+
+	mark_graph_output(graph, readback);
+	mark_graph_output(graph, history);
+
+	written.push_back(upload);
+	written.push_back(history);
+
+	auto pick_recent = [&](void) {
+		size_t window = min((size_t)recent, written.size());
+		return written[written.size() - 1 - (*rng)() % window];
+	};
+
+	auto new_transient = [&](void) {
+		unsigned int r = add_graph_resource(
+			graph,
+			"t" + to_string(graph->resources.size()),
+			(uint64_t)pow(2.0, log_size(*rng)),
+			64 * 1024
+		);
+
+		if ((*rng)() % 20 == 0) {
+			mark_graph_output(graph, r);
+		}
+
+		transients.push_back(r);
+		return r;
+	};
+
+	for (unsigned int p = 0; p < num_passes; p++) {
+		unsigned int roll = (*rng)() % 100;
+		unsigned int pass;
+		unsigned int source;
+		unsigned int target;
+
+		if (roll < 15) {
+			pass = add_graph_pass(graph, "copy" + to_string(p), GRAPH_PASS_COPY, 1.0 + (*rng)() % 4);
+			source = pick_recent();
+			roll = (*rng)() % 100;
+
+			if (roll < 15) {
+				target = readback;
+			}
+			else if (roll < 60 || transients.empty()) {
+				target = new_transient();
+			}
+			else {
+				target = transients[transients.size() - 1 - (*rng)() % min((size_t)recent, transients.size())];
+			}
+
+			if (target == source) {
+				target = new_transient();
+			}
+
+			add_graph_access(graph, pass, source, GRAPH_USAGE_COPY_SOURCE);
+			add_graph_access(graph, pass, target, GRAPH_USAGE_COPY_DEST);
+		}
+		else {
+			vector<unsigned int> reads;
+			unsigned int num_reads = (*rng)() % 3;
+
+			pass = add_graph_pass(graph, "pass" + to_string(p), GRAPH_PASS_COMPUTE, 1.0 + (*rng)() % 8);
+
+			for (unsigned int i = 0; i < num_reads; i++) {
+				source = pick_recent();
+
+				if (source != upload && find(reads.begin(), reads.end(), source) == reads.end()) {
+					reads.push_back(source);
+				}
+			}
+
+			roll = (*rng)() % 100;
+
+			if (roll < 10) {
+				target = history;
+			}
+			else if (roll < 65 || transients.empty()) {
+				target = new_transient();
+			}
+			else {
+				target = transients[transients.size() - 1 - (*rng)() % min((size_t)recent, transients.size())];
+			}
+
+			if (find(reads.begin(), reads.end(), target) != reads.end()) {
+				target = new_transient();
+			}
+
+			for (unsigned int r : reads) {
+				add_graph_access(graph, pass, r, GRAPH_USAGE_SHADER_RESOURCE);
+			}
+
+			add_graph_access(graph, pass, target, GRAPH_USAGE_UNORDERED_ACCESS);
+		}
+
+		graph->passes[pass].side_effects = (*rng)() % 50 == 0;
+
+		if (target != readback) {
+			written.push_back(target);
+		}
+	}
+}
+
+struct timed_access {
+	unsigned int pass;
+	graph_usage usage;
+	double start;
+	double finish;
+};
+
+/*
+	Step times are sums in a different order than batch times, so they
+	can be off by rounding.
+*/
+const double TIME_SLACK = 1.0e-9;
+
+static bool intervals_overlap(const double a_start, const double a_finish, const double b_start, const double b_finish) {
+	return a_start + TIME_SLACK < b_finish && b_start + TIME_SLACK < a_finish;
+}
+
+static unsigned int check_compiled_graph(
+	const compute_graph* graph,
+	const compiled_graph* compiled,
+	const char* label,
+	mt19937* rng,
+	FILE* out
+) {
+	const unsigned int num_resources = (unsigned int)graph->resources.size();
+	uniform_real_distribution<double> pass_time(0.5, 4.0);
+	vector<double> durations(graph->passes.size());
+	vector<double> start;
+	vector<double> finish;
+	vector<vector<timed_access>> accesses(num_resources);
+	vector<graph_state> state(num_resources);
+	vector<bool> uav_pending(num_resources, false);
+	vector<unsigned int> last_writer(num_resources, GRAPH_NONE);
+	vector<unsigned int> copy_batch(num_resources, GRAPH_NONE);
+	unsigned int problems;
+
+	problems = 0;
+
+	auto report = [&](const string& what) {
+		if (out != NULL && problems < 10) {
+			fprintf(out, "  %s: %s\n", label, what.c_str());
+		}
+
+		problems++;
+	};
+
+	//
+	// Culling: a kept pass's producers are kept, and so are the last
+	// writers of outputs and passes with side effects.
+	//
+
+	for (unsigned int p = 0; p < graph->passes.size(); p++) {
+		bool is_kept = compiled->pass_step[p] != GRAPH_NONE;
+
+		if (graph->passes[p].side_effects && !is_kept) {
+			report("pass " + graph->passes[p].name + " has side effects but was culled");
+		}
+
+		for (const graph_access& access : graph->passes[p].accesses) {
+			if (is_kept && last_writer[access.resource] != GRAPH_NONE && compiled->pass_step[last_writer[access.resource]] == GRAPH_NONE) {
+				report("pass " + graph->passes[p].name + " was kept, but the pass it reads " + graph->resources[access.resource].name + " from was culled");
+			}
+		}
+
+		for (const graph_access& access : graph->passes[p].accesses) {
+			if (graph_usage_writes(access.usage)) {
+				last_writer[access.resource] = p;
+			}
+		}
+	}
+
+	for (unsigned int r = 0; r < num_resources; r++) {
+		if (graph->resources[r].output && last_writer[r] != GRAPH_NONE && compiled->pass_step[last_writer[r]] == GRAPH_NONE) {
+			report("the last writer of output " + graph->resources[r].name + " was culled");
+		}
+	}
+
+	for (unsigned int s = 0; s < compiled->steps.size(); s++) {
+		const compiled_step* step = &compiled->steps[s];
+
+		for (unsigned int d : step->deps) {
+			if (d >= s) {
+				report("step " + to_string(s) + " depends on a later step");
+			}
+		}
+
+		if (step->queue == QUEUE_COPY && step->pass != GRAPH_NONE && graph->passes[step->pass].kind != GRAPH_PASS_COPY) {
+			report("compute pass " + graph->passes[step->pass].name + " is on the copy queue");
+		}
+	}
+
+	for (size_t b = 0; b < compiled->batches.size(); b++) {
+		for (unsigned int w : compiled->batches[b].waits) {
+			if (w >= b || compiled->batches[w].queue == compiled->batches[b].queue) {
+				report("batch " + to_string(b) + " waits on batch " + to_string(w));
+			}
+		}
+	}
+
+	//
+	// Timing, with random pass times.
+	//
+
+	for (double& d : durations) {
+		d = pass_time(*rng);
+	}
+
+	if (simulate_steps(compiled, [&durations](unsigned int pass) { return durations[pass]; }, &start, &finish) < 0.0) {
+		report("the batches deadlock");
+		return problems;
+	}
+
+	for (unsigned int p = 0; p < graph->passes.size(); p++) {
+		unsigned int s = compiled->pass_step[p];
+
+		if (s == GRAPH_NONE) {
+			continue;
+		}
+
+		for (const graph_access& access : graph->passes[p].accesses) {
+			accesses[access.resource].push_back({ p, access.usage, start[s], finish[s] });
+		}
+	}
+
+	for (unsigned int r = 0; r < num_resources; r++) {
+		const vector<timed_access>* list = &accesses[r];
+
+		for (size_t i = 0; i < list->size(); i++) {
+			for (size_t j = i + 1; j < list->size(); j++) {
+				const timed_access* a = &(*list)[i];
+				const timed_access* b = &(*list)[j];
+
+				if (!graph_usage_writes(a->usage) && !graph_usage_writes(b->usage)) {
+					continue;
+				}
+
+				if (a->finish > b->start + TIME_SLACK) {
+					report(graph->passes[a->pass].name + " and " + graph->passes[b->pass].name + " both use " + graph->resources[r].name + " but run out of order or together");
+				}
+			}
+		}
+	}
+
+	//
+	// Transients that share memory are never live at the same time.
+	//
+
+	for (unsigned int a = 0; a < num_resources; a++) {
+		unsigned int ia = compiled->transient_index[a];
+
+		if (ia == GRAPH_NONE) {
+			continue;
+		}
+
+		for (unsigned int b = a + 1; b < num_resources; b++) {
+			unsigned int ib = compiled->transient_index[b];
+			double a_start = 1.0e300, a_finish = -1.0, b_start = 1.0e300, b_finish = -1.0;
+
+			if (ib == GRAPH_NONE) {
+				continue;
+			}
+
+			if (compiled->aliasing.offsets[ia] + compiled->transient_requests[ia].size <= compiled->aliasing.offsets[ib]
+				|| compiled->aliasing.offsets[ib] + compiled->transient_requests[ib].size <= compiled->aliasing.offsets[ia]) {
+				continue;
+			}
+
+			for (const timed_access& access : accesses[a]) {
+				a_start = min(a_start, access.start);
+				a_finish = max(a_finish, access.finish);
+			}
+
+			for (const timed_access& access : accesses[b]) {
+				b_start = min(b_start, access.start);
+				b_finish = max(b_finish, access.finish);
+			}
+
+			if (graph->resources[a].output) {
+				a_finish = 1.0e300;
+			}
+
+			if (graph->resources[b].output) {
+				b_finish = 1.0e300;
+			}
+
+			if (intervals_overlap(a_start, a_finish, b_start, b_finish)) {
+				report(graph->resources[a].name + " and " + graph->resources[b].name + " share memory while both are live");
+			}
+		}
+	}
+
+	//
+	// States: replay the barriers in schedule order. Every transition has
+	// to start from the state the resource is in, happen while nothing
+	// else is using it, and be one the queue can do. Every access has to
+	// find its state, and UAV accesses in a row need a barrier between.
+	// Whatever a copy batch used is in COMMON once the batch is done.
+	//
+
+	for (unsigned int r = 0; r < num_resources; r++) {
+		state[r] = graph->resources[r].imported ? graph->resources[r].initial_state : compiled->first_state[r];
+	}
+
+	auto touch = [&](const compiled_step* step, const unsigned int r) {
+		if (graph->resources[r].fixed_state) {
+			return;
+		}
+
+		if (copy_batch[r] != GRAPH_NONE && copy_batch[r] != step->batch) {
+			unsigned int last = compiled->batches[copy_batch[r]].steps.back();
+
+			if (finish[last] > start[step - compiled->steps.data()] + TIME_SLACK) {
+				report(graph->resources[r].name + " is used before the copy batch that decays it is done");
+			}
+
+			state[r] = 0;
+			copy_batch[r] = GRAPH_NONE;
+		}
+
+		if (step->queue == QUEUE_COPY) {
+			copy_batch[r] = step->batch;
+		}
+	};
+
+	auto replay = [&](const compiled_step* step, const vector<graph_barrier>& barriers, const double time, const unsigned int holder) {
+		for (const graph_barrier& barrier : barriers) {
+			if (barrier.kind == GRAPH_BARRIER_ALIASING) {
+				continue;
+			}
+
+			if (barrier.kind == GRAPH_BARRIER_UAV) {
+				uav_pending[barrier.resource] = false;
+				continue;
+			}
+
+			touch(step, barrier.resource);
+
+			if (barrier.before != state[barrier.resource]) {
+				report("a transition of " + graph->resources[barrier.resource].name + " starts from the wrong state");
+			}
+
+			if (!queue_can_transition(step->queue, barrier.before, barrier.after)) {
+				report("the copy queue transitions " + graph->resources[barrier.resource].name + " to a shader state");
+			}
+
+			for (const timed_access& access : accesses[barrier.resource]) {
+				if (access.pass != holder && access.start + TIME_SLACK < time && time + TIME_SLACK < access.finish) {
+					report(graph->resources[barrier.resource].name + " changes state while " + graph->passes[access.pass].name + " uses it");
+				}
+			}
+
+			state[barrier.resource] = barrier.after;
+			uav_pending[barrier.resource] = false;
+		}
+	};
+
+	for (unsigned int s = 0; s < compiled->steps.size(); s++) {
+		const compiled_step* step = &compiled->steps[s];
+
+		replay(step, step->before, start[s], step->pass);
+
+		if (step->pass != GRAPH_NONE) {
+			for (const graph_access& access : graph->passes[step->pass].accesses) {
+				touch(step, access.resource);
+
+				if ((state[access.resource] & graph_usage_state(access.usage)) == 0) {
+					report(graph->passes[step->pass].name + " uses " + graph->resources[access.resource].name + " in the wrong state");
+				}
+
+				if (access.usage == GRAPH_USAGE_UNORDERED_ACCESS) {
+					if (uav_pending[access.resource]) {
+						report(graph->passes[step->pass].name + " writes " + graph->resources[access.resource].name + " with no UAV barrier after the last write");
+					}
+
+					uav_pending[access.resource] = true;
+				}
+			}
+		}
+
+		replay(step, step->after, finish[s], step->pass);
+	}
+
+	return problems;
+}
+
+bool verify_compute_graph(FILE* out) {
+	const unsigned int num_graphs = 200;
+	mt19937 rng(2025);
+	compute_graph graph;
+	compiled_graph compiled;
+	graph_compile_options options;
+	string error;
+	unsigned int problems;
+	unsigned int upload;
+	unsigned int r;
+	unsigned int y;
+	unsigned int p;
+
+	problems = 0;
+
+	for (unsigned int g = 0; g < num_graphs; g++) {
+		build_random_graph(&graph, 1 + g, &rng);
+
+		for (unsigned int mode = 0; mode < 4; mode++) {
+			char label[64];
+
+			options.async_compute = (mode & 1) != 0;
+			options.async_copy = (mode & 2) != 0;
+
+			snprintf(label, sizeof(label), "graph %u (%s%s)", g, options.async_compute ? "async compute" : "direct", options.async_copy ? ", async copy" : "");
+
+			if (!compile_compute_graph(&graph, &options, &compiled, &error)) {
+				if (out != NULL) {
+					fprintf(out, "  %s didn't compile: %s\n", label, error.c_str());
+				}
+
+				problems++;
+				continue;
+			}
+
+			problems += check_compiled_graph(&graph, &compiled, label, &rng, out);
+		}
+	}
+
+	//
+	// A copy on the copy queue writes x and a compute pass reads it. By
+	// then x has decayed to COMMON, so that is where its transition
+	// starts.
+	//
+
+	options.async_compute = false;
+	options.async_copy = true;
+
+	initialize_compute_graph(&graph);
+	upload = import_graph_resource(&graph, "upload", graph_usage_state(GRAPH_USAGE_COPY_SOURCE), true);
+	r = add_graph_resource(&graph, "x", 65536, 65536);
+	y = add_graph_resource(&graph, "y", 65536, 65536);
+	mark_graph_output(&graph, y);
+
+	p = add_graph_pass(&graph, "copy", GRAPH_PASS_COPY, 1.0);
+	add_graph_access(&graph, p, upload, GRAPH_USAGE_COPY_SOURCE);
+	add_graph_access(&graph, p, r, GRAPH_USAGE_COPY_DEST);
+
+	p = add_graph_pass(&graph, "reader", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, p, r, GRAPH_USAGE_SHADER_RESOURCE);
+	add_graph_access(&graph, p, y, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	if (!compile_compute_graph(&graph, &options, &compiled, &error)) {
+		if (out != NULL) {
+			fprintf(out, "  copy then read didn't compile: %s\n", error.c_str());
+		}
+
+		problems++;
+	}
+	else {
+		bool from_common = false;
+
+		for (const compiled_step& step : compiled.steps) {
+			for (const graph_barrier& barrier : step.before) {
+				if (barrier.kind == GRAPH_BARRIER_TRANSITION && barrier.resource == r) {
+					from_common = barrier.before == 0 && step.queue != QUEUE_COPY;
+				}
+			}
+		}
+
+		if (compiled.steps[compiled.pass_step[0]].queue != QUEUE_COPY || !from_common) {
+			if (out != NULL) {
+				fprintf(out, "  a read after the copy queue doesn't transition from COMMON\n");
+			}
+
+			problems++;
+		}
+
+		problems += check_compiled_graph(&graph, &compiled, "copy then read", &rng, out);
+	}
+
+	//
+	// Graphs that have to be refused.
+	//
+
+	options.async_compute = true;
+	options.async_copy = true;
+
+	initialize_compute_graph(&graph);
+	r = add_graph_resource(&graph, "unwritten", 65536, 65536);
+	p = add_graph_pass(&graph, "reader", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, p, r, GRAPH_USAGE_SHADER_RESOURCE);
+
+	if (compile_compute_graph(&graph, &options, &compiled, &error)) {
+		if (out != NULL) {
+			fprintf(out, "  reading a transient nothing wrote compiled\n");
+		}
+
+		problems++;
+	}
+
+	add_graph_access(&graph, p, r, GRAPH_USAGE_UNORDERED_ACCESS);
+	graph.passes[p].accesses.erase(graph.passes[p].accesses.begin());
+	add_graph_access(&graph, p, r, GRAPH_USAGE_SHADER_RESOURCE);
+
+	if (compile_compute_graph(&graph, &options, &compiled, &error)) {
+		if (out != NULL) {
+			fprintf(out, "  a pass using a resource twice compiled\n");
+		}
+
+		problems++;
+	}
+
+	initialize_compute_graph(&graph);
+	r = add_graph_resource(&graph, "target", 65536, 65536);
+	p = add_graph_pass(&graph, "copy", GRAPH_PASS_COPY, 1.0);
+	add_graph_access(&graph, p, r, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	if (compile_compute_graph(&graph, &options, &compiled, &error)) {
+		if (out != NULL) {
+			fprintf(out, "  a copy pass using a UAV compiled\n");
+		}
+
+		problems++;
+	}
+
+	initialize_compute_graph(&graph);
+	r = import_graph_resource(&graph, "readback", graph_usage_state(GRAPH_USAGE_COPY_DEST), true);
+	p = add_graph_pass(&graph, "writer", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, p, r, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	if (compile_compute_graph(&graph, &options, &compiled, &error)) {
+		if (out != NULL) {
+			fprintf(out, "  a UAV on readback memory compiled\n");
+		}
+
+		problems++;
+	}
+
+	if (out != NULL) {
+		fprintf(out, "Compute graph: %u random graphs in 4 modes, %s\n", num_graphs, problems == 0 ? "all correct" : (to_string(problems) + " problem(s)").c_str());
+	}
+
+	return problems == 0;
+}
+
+void benchmark_compute_graph(FILE* out) {
+	const unsigned int sizes[] = { 10, 100, 1000, 10000 };
+	mt19937 rng(7);
+	compute_graph graph;
+	compiled_graph compiled;
+	compiled_graph serial;
+	graph_compile_options options;
+	graph_compile_options serial_options;
+	string error;
+
+	options.async_compute = true;
+	options.async_copy = true;
+	serial_options.async_compute = false;
+	serial_options.async_copy = false;
+
+	fprintf(out, "  %6s %10s %7s %7s %7s %6s %6s %6s %7s %17s %17s\n", "passes", "compile", "culled", "trans", "uav", "alias", "waits", "steps", "batches", "memory (MiB)", "time 1 queue/all");
+
+	for (unsigned int size : sizes) {
+		unsigned int repeats = max(1u, 2000u / size);
+		chrono::steady_clock::time_point start;
+		chrono::duration<double> elapsed;
+		double one_queue;
+		double all_queues;
+
+		build_random_graph(&graph, size, &rng);
+
+		start = chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < repeats; i++) {
+			if (!compile_compute_graph(&graph, &options, &compiled, &error)) {
+				fprintf(out, "  %u passes didn't compile: %s\n", size, error.c_str());
+				return;
+			}
+		}
+
+		elapsed = chrono::steady_clock::now() - start;
+
+		compile_compute_graph(&graph, &serial_options, &serial, &error);
+		one_queue = simulate_compiled_graph(&graph, &serial);
+		all_queues = simulate_compiled_graph(&graph, &compiled);
+
+		fprintf(
+			out,
+			"  %6u %8.3fms %7u %7u %7u %6u %6u %6u %7u %7.1f / %7.1f %8.0f / %6.0f\n",
+			size,
+			elapsed.count() * 1000.0 / repeats,
+			compiled.stats.culled_passes,
+			compiled.stats.transitions,
+			compiled.stats.uav_barriers,
+			compiled.stats.aliasing_barriers,
+			compiled.stats.waits,
+			(unsigned int)compiled.steps.size(),
+			(unsigned int)compiled.batches.size(),
+			compiled.aliasing.arena_size / 1048576.0,
+			compiled.aliasing.unaliased_size / 1048576.0,
+			one_queue,
+			all_queues
+		);
+	}
+}
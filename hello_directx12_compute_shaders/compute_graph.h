@@ -0,0 +1,274 @@
+// Liam Wynn, 01/09/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	A compute graph describes a job as passes and the resources they
+	read and write, instead of wiring up the barriers and queues by
+	hand. compile_compute_graph works out the rest:
+
+	Order      Passes depend on the last pass before them (in the order
+	           they were added) that wrote what they read, and writers
+	           also depend on the readers and writer before them. The
+	           schedule is a topological order that runs a pass's
+	           consumers soon after it, which keeps lifetimes short.
+	Culling    Only passes that something needs are kept: passes with
+	           side effects, the last writers of output resources, and
+	           whatever those read from.
+	Queues     Copy passes go to the copy queue and independent compute
+	           branches are spread over the direct and compute queues,
+	           when allowed. A pass continues its first producer's
+	           queue if that producer hasn't handed it on already, and
+	           otherwise takes the least loaded queue. A copy that
+	           reads something alongside a compute pass stays on the
+	           direct queue.
+	Barriers   A run of reads needs one transition, to the union of the
+	           read states. A write needs a transition if the state
+	           changes, or a UAV barrier after another UAV access. A
+	           transition the copy queue can't do goes at the end of the
+	           producer's pass if its queue can, or into a barrier-only
+	           step on the direct queue. Anything used on the copy
+	           queue is in COMMON once that batch is done, so the next
+	           transition starts from there.
+	Memory     Transient resources that are never live at the same time
+	           share memory, planned by plan_transient_aliasing. A
+	           resource that takes over memory gets an aliasing barrier,
+	           and waits for every pass that used the memory before.
+	Batches    Passes are grouped into one batch per run of a queue
+	           between cross-queue waits. The waits go through a
+	           queue_scheduler, so there is at most one per other queue
+	           and none that an earlier wait already covers.
+
+	Imported resources come from outside the graph, in a known state.
+	Fixed-state imports (readback or upload memory) never get barriers.
+
+	Nothing here depends on Windows. gpu_compute_graph runs a compiled
+	graph on the device. verify_compute_graph checks the compiler on
+	random graphs by simulating their queues, and
+	benchmark_compute_graph times it from 10 to 10000 passes.
+*/
+
+#pragma once
+
+#include "queue_scheduler.h"
+#include "suballocator.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+const unsigned int GRAPH_NONE = 0xFFFFFFFF;
+
+enum graph_usage {
+	// Read and written through a UAV. Counts as a write.
+	GRAPH_USAGE_UNORDERED_ACCESS,
+	GRAPH_USAGE_SHADER_RESOURCE,
+	GRAPH_USAGE_COPY_SOURCE,
+	GRAPH_USAGE_COPY_DEST,
+	GRAPH_USAGE_COUNT
+};
+
+// A resource state: a bit per usage. Only reads combine.
+typedef uint32_t graph_state;
+
+enum graph_pass_kind {
+	GRAPH_PASS_COMPUTE,
+	GRAPH_PASS_COPY
+};
+
+struct graph_resource {
+	std::string name;
+
+	// Transients only.
+	uint64_t size;
+	uint64_t alignment;
+
+	bool imported;
+	graph_state initial_state;
+	bool fixed_state;
+
+	// Read after the graph runs.
+	bool output;
+};
+
+struct graph_access {
+	unsigned int resource;
+	graph_usage usage;
+};
+
+struct graph_pass {
+	std::string name;
+	graph_pass_kind kind;
+	std::vector<graph_access> accesses;
+
+	// Relative cost, for spreading work over queues.
+	double cost;
+
+	// Never culled.
+	bool side_effects;
+};
+
+struct compute_graph {
+	std::vector<graph_resource> resources;
+	std::vector<graph_pass> passes;
+};
+
+enum graph_barrier_kind {
+	GRAPH_BARRIER_TRANSITION,
+	GRAPH_BARRIER_UAV,
+	GRAPH_BARRIER_ALIASING
+};
+
+struct graph_barrier {
+	graph_barrier_kind kind;
+	unsigned int resource;
+
+	// Transitions only.
+	graph_state before;
+	graph_state after;
+};
+
+/*
+	A step of the schedule: a pass, or, with pass GRAPH_NONE, only
+	barriers. deps are the steps it has to run after.
+*/
+struct compiled_step {
+	unsigned int pass;
+	queue_kind queue;
+	unsigned int batch;
+	std::vector<unsigned int> deps;
+
+	std::vector<graph_barrier> before;
+	std::vector<graph_barrier> after;
+};
+
+struct graph_batch {
+	queue_kind queue;
+	std::vector<unsigned int> steps;
+
+	// Batches on other queues to wait for first. Always earlier ones.
+	std::vector<unsigned int> waits;
+};
+
+struct graph_compile_options {
+	// Spread compute branches over the compute queue too.
+	bool async_compute;
+
+	// Put copy passes on the copy queue.
+	bool async_copy;
+};
+
+struct graph_compile_stats {
+	unsigned int culled_passes;
+	unsigned int transitions;
+	unsigned int uav_barriers;
+	unsigned int aliasing_barriers;
+	unsigned int barrier_steps;
+	unsigned int waits;
+};
+
+struct compiled_graph {
+	// Execution order. Culled passes aren't in it.
+	std::vector<compiled_step> steps;
+
+	// Per pass, its step, or GRAPH_NONE if it was culled.
+	std::vector<unsigned int> pass_step;
+
+	std::vector<graph_batch> batches;
+
+	// Per resource, the first and last step using it, or GRAPH_NONE.
+	std::vector<unsigned int> first_use;
+	std::vector<unsigned int> last_use;
+
+	// Per resource, the state its first use needs. Transients start
+	// out in it.
+	std::vector<graph_state> first_state;
+
+	// Per resource, its request in the aliasing plan, or GRAPH_NONE for
+	// imports and unused transients. Offsets are in aliasing.offsets.
+	std::vector<unsigned int> transient_index;
+	std::vector<transient_request> transient_requests;
+	transient_plan aliasing;
+
+	graph_compile_stats stats;
+};
+
+void initialize_compute_graph(compute_graph* graph);
+
+graph_state graph_usage_state(const graph_usage usage);
+bool graph_usage_writes(const graph_usage usage);
+const char* graph_usage_name(const graph_usage usage);
+
+// Whether the copy queue can put a resource in state.
+bool copy_queue_can_use(const graph_state state);
+
+unsigned int add_graph_resource(
+	compute_graph* graph,
+	const std::string& name,
+	const uint64_t size,
+	const uint64_t alignment
+);
+unsigned int import_graph_resource(
+	compute_graph* graph,
+	const std::string& name,
+	const graph_state initial_state,
+	const bool fixed_state
+);
+void mark_graph_output(compute_graph* graph, const unsigned int resource);
+
+unsigned int add_graph_pass(
+	compute_graph* graph,
+	const std::string& name,
+	const graph_pass_kind kind,
+	const double cost
+);
+void add_graph_access(
+	compute_graph* graph,
+	const unsigned int pass,
+	const unsigned int resource,
+	const graph_usage usage
+);
+
+/*
+	Returns false, and says why in error, if a pass reads a transient
+	nothing wrote, uses a resource two ways, or a copy pass uses a
+	shader state.
+*/
+bool compile_compute_graph(
+	const compute_graph* graph,
+	const graph_compile_options* options,
+	compiled_graph* compiled,
+	std::string* error
+);
+
+/*
+	Runs the batches on simulated queues, each pass taking its cost.
+	Returns the time the last one finishes.
+*/
+double simulate_compiled_graph(
+	const compute_graph* graph,
+	const compiled_graph* compiled
+);
+
+// Graphviz. Culled passes are grey, edges that cross queues are bold.
+void write_compute_graph_dot(
+	const compute_graph* graph,
+	const compiled_graph* compiled,
+	FILE* out
+);
+
+/*
+	Compiles random graphs and checks the schedules by simulating them
+	with random pass times: conflicting accesses never overlap and keep
+	their order, resources sharing memory are never live together, every
+	access finds its resource in the right state, and culling drops
+	nothing that is read. Problems go to out, which may be NULL. Returns
+	false if there were any.
+*/
+bool verify_compute_graph(FILE* out);
+
+/*
+	Times the compiler on random graphs of 10 to 10000
+	passes and prints what it culled, the barriers and waits, memory
+	with and without aliasing, and the simulated time on one queue
+	against all of them.
+*/
+void benchmark_compute_graph(FILE* out);
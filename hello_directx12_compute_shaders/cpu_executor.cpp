@@ -0,0 +1,818 @@
+// Liam Wynn, 12/02/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "cpu_executor.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_EXECUTOR_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC lets us use any intrinsic anywhere. GCC and Clang need to be
+// told which functions may use AVX.
+#if defined(CPU_EXECUTOR_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CPU_TARGET_AVX __attribute__((target("avx")))
+#else
+#define CPU_TARGET_AVX
+#endif
+
+using namespace std;
+
+/* HELLO_COMPUTE KERNEL */
+
+/*
+	Each of these writes one row of one threadgroup. That is,
+	count pixels starting at (x, y). They all compute the same thing
+	as hello_compute.hlsl:
+
+		uv = dispatch_thread_id.xy / float2(width - 1, height - 1);
+		buffer[dispatch_thread_id.xy] = float4(uv.xy, 0.0f, 1.0f);
+
+	The divisions are IEEE divisions in every path, so the scalar and
+	SIMD paths agree bit for bit.
+*/
+
+static void hello_compute_row_scalar(
+	float* dst,
+	const unsigned int x,
+	const unsigned int count,
+	const float v,
+	const float width_minus_one
+) {
+	for (unsigned int i = 0; i < count; i++) {
+		dst[0] = (float)(x + i) / width_minus_one;
+		dst[1] = v;
+		dst[2] = 0.0f;
+		dst[3] = 1.0f;
+		dst += 4;
+	}
+}
+
+/*
+	The same thing for the narrower formats. These go one texel at a
+	time, converting the way the GPU does on a typed UAV store.
+*/
+static void hello_compute_row_half(
+	uint16_t* dst,
+	const unsigned int x,
+	const unsigned int count,
+	const float v,
+	const float width_minus_one
+) {
+	uint16_t half_v;
+	uint16_t half_zero;
+	uint16_t half_one;
+
+	half_v = float_to_half(v);
+	half_zero = float_to_half(0.0f);
+	half_one = float_to_half(1.0f);
+
+	for (unsigned int i = 0; i < count; i++) {
+		dst[0] = float_to_half((float)(x + i) / width_minus_one);
+		dst[1] = half_v;
+		dst[2] = half_zero;
+		dst[3] = half_one;
+		dst += 4;
+	}
+}
+
+static void hello_compute_row_r32(
+	float* dst,
+	const unsigned int x,
+	const unsigned int count,
+	const float width_minus_one
+) {
+	for (unsigned int i = 0; i < count; i++) {
+		dst[i] = (float)(x + i) / width_minus_one;
+	}
+}
+
+static void hello_compute_row_r11g11b10(
+	uint32_t* dst,
+	const unsigned int x,
+	const unsigned int count,
+	const float v,
+	const float width_minus_one
+) {
+	for (unsigned int i = 0; i < count; i++) {
+		dst[i] = pack_r11g11b10((float)(x + i) / width_minus_one, v, 0.0f);
+	}
+}
+
+static uint8_t float_to_unorm8(const float value) {
+	float clamped;
+
+	// NaN goes to 0, like on the GPU.
+	clamped = value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f;
+
+	return (uint8_t)(clamped * 255.0f + 0.5f);
+}
+
+static void hello_compute_row_unorm8(
+	uint8_t* dst,
+	const unsigned int x,
+	const unsigned int count,
+	const float v,
+	const float width_minus_one
+) {
+	uint8_t unorm_v;
+
+	unorm_v = float_to_unorm8(v);
+
+	for (unsigned int i = 0; i < count; i++) {
+		dst[0] = float_to_unorm8((float)(x + i) / width_minus_one);
+		dst[1] = unorm_v;
+		dst[2] = 0;
+		dst[3] = 255;
+		dst += 4;
+	}
+}
+
+#if defined(CPU_EXECUTOR_X86)
+static unsigned int hello_compute_row_sse(
+	float* dst,
+	const unsigned int x,
+	const unsigned int count,
+	const float v,
+	const float width_minus_one
+) {
+	__m128 lane_offsets;
+	__m128 divisor;
+	__m128 vv;
+	__m128 zero_one;
+	__m128 u;
+	__m128 lo;
+	__m128 hi;
+	unsigned int i;
+
+	lane_offsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	divisor = _mm_set1_ps(width_minus_one);
+	vv = _mm_set1_ps(v);
+	zero_one = _mm_set_ps(1.0f, 0.0f, 1.0f, 0.0f);
+
+	for (i = 0; i + 4 <= count; i += 4) {
+		//
+		// Pixel indices stay well under 2^24, so adding them as floats
+		// is exact and matches the scalar int-to-float conversion.
+		//
+
+		u = _mm_add_ps(_mm_set1_ps((float)(x + i)), lane_offsets);
+		u = _mm_div_ps(u, divisor);
+
+		// lo = (u0, v, u1, v), hi = (u2, v, u3, v)
+		lo = _mm_unpacklo_ps(u, vv);
+		hi = _mm_unpackhi_ps(u, vv);
+
+		_mm_storeu_ps(dst + 0, _mm_movelh_ps(lo, zero_one));
+		_mm_storeu_ps(dst + 4, _mm_movehl_ps(zero_one, lo));
+		_mm_storeu_ps(dst + 8, _mm_movelh_ps(hi, zero_one));
+		_mm_storeu_ps(dst + 12, _mm_movehl_ps(zero_one, hi));
+
+		dst += 16;
+	}
+
+	return i;
+}
+
+CPU_TARGET_AVX
+static unsigned int hello_compute_row_avx(
+	float* dst,
+	const unsigned int x,
+	const unsigned int count,
+	const float v,
+	const float width_minus_one
+) {
+	__m256 lane_offsets;
+	__m256 divisor;
+	__m256 vv;
+	__m256d zero_one;
+	__m256 u;
+	__m256d lo;
+	__m256d hi;
+	__m256d p04;
+	__m256d p15;
+	__m256d p26;
+	__m256d p37;
+	unsigned int i;
+
+	lane_offsets = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+	divisor = _mm256_set1_ps(width_minus_one);
+	vv = _mm256_set1_ps(v);
+	zero_one = _mm256_castps_pd(
+		_mm256_set_ps(1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f)
+	);
+
+	for (i = 0; i + 8 <= count; i += 8) {
+		u = _mm256_add_ps(_mm256_set1_ps((float)(x + i)), lane_offsets);
+		u = _mm256_div_ps(u, divisor);
+
+		//
+		// Interleave (u, v) pairs, then treat each pair as one double so
+		// we can splice in the (0, 1) half of every float4.
+		// lo = (u0 v u1 v | u4 v u5 v), hi = (u2 v u3 v | u6 v u7 v)
+		//
+
+		lo = _mm256_castps_pd(_mm256_unpacklo_ps(u, vv));
+		hi = _mm256_castps_pd(_mm256_unpackhi_ps(u, vv));
+
+		p04 = _mm256_unpacklo_pd(lo, zero_one);
+		p15 = _mm256_unpackhi_pd(lo, zero_one);
+		p26 = _mm256_unpacklo_pd(hi, zero_one);
+		p37 = _mm256_unpackhi_pd(hi, zero_one);
+
+		_mm256_storeu_pd((double*)(dst + 0), _mm256_permute2f128_pd(p04, p15, 0x20));
+		_mm256_storeu_pd((double*)(dst + 8), _mm256_permute2f128_pd(p26, p37, 0x20));
+		_mm256_storeu_pd((double*)(dst + 16), _mm256_permute2f128_pd(p04, p15, 0x31));
+		_mm256_storeu_pd((double*)(dst + 24), _mm256_permute2f128_pd(p26, p37, 0x31));
+
+		dst += 32;
+	}
+
+	return i;
+}
+#endif
+
+static void hello_compute_group(
+	const cpu_texture* target,
+	const cpu_dispatch_desc* dispatch,
+	const cpu_simd_level simd_level,
+	const unsigned int group_x,
+	const unsigned int group_y
+) {
+	unsigned int x0;
+	unsigned int y0;
+	unsigned int count;
+	unsigned int done;
+	unsigned int gx;
+	float width_minus_one;
+	float height_minus_one;
+	float v;
+	float* dst;
+	unsigned char* row;
+
+	x0 = group_x * dispatch->group_size_x;
+	y0 = group_y * dispatch->group_size_y;
+
+	//
+	// Out of bounds UAV writes are dropped on the GPU, so clip the
+	// group against the texture.
+	//
+
+	if (x0 >= target->width || y0 >= target->height) {
+		return;
+	}
+
+	count = dispatch->group_size_x;
+	if (x0 + count > target->width) {
+		count = target->width - x0;
+	}
+
+	//
+	// The kernel works in image coordinates. x and y below are in the
+	// target, gx is where x0 is in the image.
+	//
+
+	width_minus_one = (float)(dispatch->image_width - 1);
+	height_minus_one = (float)(dispatch->image_height - 1);
+	gx = dispatch->origin_x + x0;
+
+	for (unsigned int y = y0; y < y0 + dispatch->group_size_y && y < target->height; y++) {
+		v = (float)(dispatch->origin_y + y) / height_minus_one;
+		row = target->data + (size_t)y * target->row_pitch;
+
+		if (target->format == CPU_TEXEL_R16G16B16A16_FLOAT) {
+			hello_compute_row_half(
+				reinterpret_cast<uint16_t*>(row + (size_t)x0 * 8),
+				gx,
+				count,
+				v,
+				width_minus_one
+			);
+			continue;
+		}
+
+		if (target->format == CPU_TEXEL_R8G8B8A8_UNORM) {
+			hello_compute_row_unorm8(row + (size_t)x0 * 4, gx, count, v, width_minus_one);
+			continue;
+		}
+
+		if (target->format == CPU_TEXEL_R32_FLOAT) {
+			hello_compute_row_r32(reinterpret_cast<float*>(row + (size_t)x0 * 4), gx, count, width_minus_one);
+			continue;
+		}
+
+		if (target->format == CPU_TEXEL_R11G11B10_FLOAT) {
+			hello_compute_row_r11g11b10(reinterpret_cast<uint32_t*>(row + (size_t)x0 * 4), gx, count, v, width_minus_one);
+			continue;
+		}
+
+		dst = reinterpret_cast<float*>(row + (size_t)x0 * CPU_FLOAT4_SIZE);
+		done = 0;
+
+#if defined(CPU_EXECUTOR_X86)
+		if (simd_level >= CPU_SIMD_AVX) {
+			done = hello_compute_row_avx(dst, gx, count, v, width_minus_one);
+		}
+
+		if (simd_level >= CPU_SIMD_SSE) {
+			done += hello_compute_row_sse(
+				dst + done * 4,
+				gx + done,
+				count - done,
+				v,
+				width_minus_one
+			);
+		}
+#endif
+
+		hello_compute_row_scalar(
+			dst + done * 4,
+			gx + done,
+			count - done,
+			v,
+			width_minus_one
+		);
+	}
+}
+
+/*
+	How many pixels along one axis a run of groups actually covers
+	once it is clipped against the texture.
+*/
+static unsigned int covered_pixels(
+	const unsigned int extent,
+	const unsigned int group_size,
+	const unsigned int first_group,
+	const unsigned int group_count
+) {
+	unsigned int begin;
+	unsigned int end;
+
+	begin = first_group * group_size;
+	end = (first_group + group_count) * group_size;
+
+	if (begin >= extent) {
+		return 0;
+	}
+
+	return (end < extent ? end : extent) - begin;
+}
+
+/* CPU_EXECUTOR IMPL */
+
+void initialize_cpu_executor(
+	cpu_executor* executor,
+	const unsigned int num_threads
+) {
+	executor->num_threads = num_threads;
+
+	if (executor->num_threads == 0) {
+		executor->num_threads = thread::hardware_concurrency();
+	}
+
+	if (executor->num_threads == 0) {
+		executor->num_threads = 1;
+	}
+
+	executor->simd_level = detect_cpu_simd_level();
+}
+
+cpu_simd_level detect_cpu_simd_level() {
+#if defined(CPU_EXECUTOR_X86) && defined(_MSC_VER)
+	int info[4];
+	bool has_avx;
+	bool has_osxsave;
+
+	bool has_f16c;
+
+	__cpuid(info, 1);
+	has_osxsave = (info[2] & (1 << 27)) != 0;
+	has_avx = (info[2] & (1 << 28)) != 0;
+	has_f16c = (info[2] & (1 << 29)) != 0;
+
+	//
+	// The OS has to save the YMM registers for AVX to be usable.
+	//
+
+	if (has_avx && has_osxsave && (_xgetbv(0) & 0x6) == 0x6) {
+		__cpuidex(info, 7, 0);
+
+		if (has_f16c && (info[1] & (1 << 5)) != 0) {
+			return CPU_SIMD_AVX2;
+		}
+
+		return CPU_SIMD_AVX;
+	}
+
+	return (info[3] & (1 << 25)) ? CPU_SIMD_SSE : CPU_SIMD_SCALAR;
+#elif defined(CPU_EXECUTOR_X86)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c")) {
+		return CPU_SIMD_AVX2;
+	}
+
+	if (__builtin_cpu_supports("avx")) {
+		return CPU_SIMD_AVX;
+	}
+
+	return __builtin_cpu_supports("sse") ? CPU_SIMD_SSE : CPU_SIMD_SCALAR;
+#else
+	return CPU_SIMD_SCALAR;
+#endif
+}
+
+const char* cpu_simd_level_name(const cpu_simd_level level) {
+	switch (level) {
+	case CPU_SIMD_AVX2:
+		return "AVX2";
+	case CPU_SIMD_AVX:
+		return "AVX";
+	case CPU_SIMD_SSE:
+		return "SSE";
+	default:
+		return "scalar";
+	}
+}
+
+unsigned int cpu_texel_size(const cpu_texel_format format) {
+	switch (format) {
+	case CPU_TEXEL_R16G16B16A16_FLOAT:
+		return 8;
+	case CPU_TEXEL_R8G8B8A8_UNORM:
+	case CPU_TEXEL_R32_FLOAT:
+	case CPU_TEXEL_R11G11B10_FLOAT:
+		return 4;
+	default:
+		return CPU_FLOAT4_SIZE;
+	}
+}
+
+const char* cpu_texel_format_name(const cpu_texel_format format) {
+	switch (format) {
+	case CPU_TEXEL_R32G32B32A32_FLOAT:
+		return "R32G32B32A32_FLOAT";
+	case CPU_TEXEL_R16G16B16A16_FLOAT:
+		return "R16G16B16A16_FLOAT";
+	case CPU_TEXEL_R8G8B8A8_UNORM:
+		return "R8G8B8A8_UNORM";
+	case CPU_TEXEL_R32_FLOAT:
+		return "R32_FLOAT";
+	case CPU_TEXEL_R11G11B10_FLOAT:
+		return "R11G11B10_FLOAT";
+	default:
+		return "unknown";
+	}
+}
+
+bool parse_cpu_texel_format(const char* text, cpu_texel_format* format) {
+	for (int f = 0; f < CPU_TEXEL_FORMAT_COUNT; f++) {
+		if (strcmp(text, cpu_texel_format_name((cpu_texel_format)f)) == 0) {
+			*format = (cpu_texel_format)f;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint16_t float_to_half(const float value) {
+	uint32_t bits;
+	uint32_t sign;
+	uint32_t exponent;
+	uint32_t mantissa;
+	uint32_t shift;
+	uint32_t rounded;
+
+	memcpy(&bits, &value, sizeof(bits));
+
+	sign = (bits >> 16) & 0x8000;
+	exponent = (bits >> 23) & 0xFF;
+	mantissa = bits & 0x7FFFFF;
+
+	//
+	// NaN and infinity.
+	//
+
+	if (exponent == 0xFF) {
+		return (uint16_t)(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+	}
+
+	//
+	// Rebias the exponent from 127 to 15. Past the top of the half
+	// range is infinity.
+	//
+
+	if ((int)exponent - 127 + 15 >= 0x1F) {
+		return (uint16_t)(sign | 0x7C00);
+	}
+
+	if ((int)exponent - 127 + 15 <= 0) {
+		//
+		// Subnormal half (or zero). Shift the mantissa, with its
+		// implicit one, into place and round to nearest even.
+		//
+
+		if ((int)exponent < 127 - 15 - 10) {
+			return (uint16_t)sign;
+		}
+
+		mantissa |= 0x800000;
+		shift = 126 - exponent;
+		rounded = mantissa >> shift;
+
+		if ((mantissa & ((1u << shift) - 1)) > (1u << (shift - 1))
+			|| ((mantissa & ((1u << shift) - 1)) == (1u << (shift - 1)) && (rounded & 1))) {
+			rounded++;
+		}
+
+		return (uint16_t)(sign | rounded);
+	}
+
+	//
+	// Normal half. Drop 13 mantissa bits with round to nearest even. A
+	// carry out of the mantissa correctly bumps the exponent.
+	//
+
+	rounded = ((exponent - 127 + 15) << 10) | (mantissa >> 13);
+
+	if ((mantissa & 0x1FFF) > 0x1000 || ((mantissa & 0x1FFF) == 0x1000 && (rounded & 1))) {
+		rounded++;
+	}
+
+	return (uint16_t)(sign | rounded);
+}
+
+float half_to_float(const uint16_t value) {
+	uint32_t bits;
+	uint32_t sign;
+	uint32_t exponent;
+	uint32_t mantissa;
+	float result;
+
+	sign = (uint32_t)(value & 0x8000) << 16;
+	exponent = (value >> 10) & 0x1F;
+	mantissa = value & 0x3FF;
+
+	if (exponent == 0x1F) {
+		bits = sign | 0x7F800000 | (mantissa << 13) | (mantissa != 0 ? 0x400000 : 0);
+	}
+	else if (exponent == 0) {
+		//
+		// Zero or subnormal: mantissa * 2^-24, which is exact in a
+		// float.
+		//
+
+		result = (float)mantissa * (1.0f / 16777216.0f);
+		return sign != 0 ? -result : result;
+	}
+	else {
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	}
+
+	memcpy(&result, &bits, sizeof(result));
+
+	return result;
+}
+
+/*
+	float_to_half without the sign, for mantissa_bits of mantissa.
+*/
+static uint32_t float_to_unsigned_float(const float value, const uint32_t mantissa_bits) {
+	uint32_t bits;
+	uint32_t exponent;
+	uint32_t mantissa;
+	uint32_t shift;
+	uint32_t rounded;
+
+	memcpy(&bits, &value, sizeof(bits));
+
+	exponent = (bits >> 23) & 0xFF;
+	mantissa = bits & 0x7FFFFF;
+
+	//
+	// NaN, then infinity. Negative infinity is negative, so 0.
+	//
+
+	if (exponent == 0xFF && mantissa != 0) {
+		return (0x1Fu << mantissa_bits) | (1u << (mantissa_bits - 1));
+	}
+
+	if ((bits >> 31) != 0) {
+		return 0;
+	}
+
+	if ((int)exponent - 127 + 15 >= 0x1F) {
+		return 0x1Fu << mantissa_bits;
+	}
+
+	if ((int)exponent - 127 + 15 <= 0) {
+		if ((int)exponent < 127 - 15 - (int)mantissa_bits) {
+			return 0;
+		}
+
+		mantissa |= 0x800000;
+		shift = 127 - 15 + 1 + 23 - mantissa_bits - exponent;
+		rounded = mantissa >> shift;
+
+		if ((mantissa & ((1u << shift) - 1)) > (1u << (shift - 1))
+			|| ((mantissa & ((1u << shift) - 1)) == (1u << (shift - 1)) && (rounded & 1))) {
+			rounded++;
+		}
+
+		return rounded;
+	}
+
+	shift = 23 - mantissa_bits;
+	rounded = ((exponent - 127 + 15) << mantissa_bits) | (mantissa >> shift);
+
+	if ((mantissa & ((1u << shift) - 1)) > (1u << (shift - 1))
+		|| ((mantissa & ((1u << shift) - 1)) == (1u << (shift - 1)) && (rounded & 1))) {
+		rounded++;
+	}
+
+	return rounded;
+}
+
+static float unsigned_float_to_float(const uint32_t value, const uint32_t mantissa_bits) {
+	uint32_t bits;
+	uint32_t exponent;
+	uint32_t mantissa;
+	float result;
+
+	exponent = (value >> mantissa_bits) & 0x1F;
+	mantissa = value & ((1u << mantissa_bits) - 1);
+
+	if (exponent == 0x1F) {
+		bits = 0x7F800000 | (mantissa << (23 - mantissa_bits)) | (mantissa != 0 ? 0x400000 : 0);
+	}
+	else if (exponent == 0) {
+		// mantissa * 2^(-14 - mantissa_bits), exact.
+		return ldexpf((float)mantissa, -14 - (int)mantissa_bits);
+	}
+	else {
+		bits = ((exponent + 127 - 15) << 23) | (mantissa << (23 - mantissa_bits));
+	}
+
+	memcpy(&result, &bits, sizeof(result));
+
+	return result;
+}
+
+uint32_t float_to_float11(const float value) {
+	return float_to_unsigned_float(value, 6);
+}
+
+uint32_t float_to_float10(const float value) {
+	return float_to_unsigned_float(value, 5);
+}
+
+float float11_to_float(const uint32_t value) {
+	return unsigned_float_to_float(value & 0x7FF, 6);
+}
+
+float float10_to_float(const uint32_t value) {
+	return unsigned_float_to_float(value & 0x3FF, 5);
+}
+
+uint32_t pack_r11g11b10(const float r, const float g, const float b) {
+	return float_to_float11(r) | (float_to_float11(g) << 11) | (float_to_float10(b) << 22);
+}
+
+cpu_footprint cpu_readback_footprint(
+	const unsigned int width,
+	const unsigned int height,
+	const unsigned int bytes_per_element
+) {
+	cpu_footprint footprint;
+	unsigned int row_size;
+	unsigned int alignment;
+
+	row_size = width * bytes_per_element;
+	alignment = CPU_TEXTURE_DATA_PITCH_ALIGNMENT;
+
+	footprint.offset = 0;
+	footprint.width = width;
+	footprint.height = height;
+	footprint.row_pitch = (row_size + alignment - 1) / alignment * alignment;
+
+	//
+	// Same as GetCopyableFootprints: the last row is not padded.
+	//
+
+	footprint.total_size = 0;
+	if (height > 0) {
+		footprint.total_size = (uint64_t)footprint.row_pitch * (height - 1) + row_size;
+	}
+
+	return footprint;
+}
+
+cpu_dispatch_desc cpu_hello_compute_dispatch(
+	const unsigned int width,
+	const unsigned int height
+) {
+	//
+	// Matches numthreads(8, 8, 1) in hello_compute.hlsl. For a 256x256
+	// buffer this is the same 32x32 groups the GPU path sizes from the
+	// kernel's reflection.
+	//
+
+	return cpu_dispatch_for_group_size(width, height, 8, 8);
+}
+
+cpu_dispatch_desc cpu_dispatch_for_group_size(
+	const unsigned int width,
+	const unsigned int height,
+	const unsigned int group_size_x,
+	const unsigned int group_size_y
+) {
+	cpu_dispatch_desc dispatch;
+
+	dispatch.group_size_x = group_size_x;
+	dispatch.group_size_y = group_size_y;
+	dispatch.group_count_x = (width + dispatch.group_size_x - 1) / dispatch.group_size_x;
+	dispatch.group_count_y = (height + dispatch.group_size_y - 1) / dispatch.group_size_y;
+	dispatch.first_group_x = 0;
+	dispatch.first_group_y = 0;
+	dispatch.origin_x = 0;
+	dispatch.origin_y = 0;
+	dispatch.image_width = width;
+	dispatch.image_height = height;
+
+	return dispatch;
+}
+
+cpu_dispatch_stats cpu_dispatch_hello_compute(
+	cpu_executor* executor,
+	const cpu_texture* target,
+	const cpu_dispatch_desc* dispatch
+) {
+	cpu_dispatch_stats stats;
+	atomic<unsigned int> next_group;
+	unsigned int total_groups;
+	unsigned int num_workers;
+	vector<thread> workers;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+	double pixels;
+
+	total_groups = dispatch->group_count_x * dispatch->group_count_y;
+	next_group = 0;
+
+	//
+	// Workers pull groups off a shared counter, so faster cores simply
+	// end up running more groups.
+	//
+
+	auto worker = [&]() {
+		unsigned int group;
+		unsigned int gx;
+		unsigned int gy;
+
+		while ((group = next_group.fetch_add(1)) < total_groups) {
+			gx = dispatch->first_group_x + group % dispatch->group_count_x;
+			gy = dispatch->first_group_y + group / dispatch->group_count_x;
+			hello_compute_group(target, dispatch, executor->simd_level, gx, gy);
+		}
+	};
+
+	num_workers = executor->num_threads;
+	if (num_workers > total_groups) {
+		num_workers = total_groups;
+	}
+
+	start = chrono::steady_clock::now();
+
+	for (unsigned int i = 1; i < num_workers; i++) {
+		workers.emplace_back(worker);
+	}
+
+	worker();
+
+	for (thread& t : workers) {
+		t.join();
+	}
+
+	elapsed = chrono::steady_clock::now() - start;
+
+	pixels = (double)covered_pixels(target->width, dispatch->group_size_x, dispatch->first_group_x, dispatch->group_count_x)
+		* covered_pixels(target->height, dispatch->group_size_y, dispatch->first_group_y, dispatch->group_count_y);
+
+	stats.seconds = elapsed.count();
+	stats.groups_executed = total_groups;
+	stats.mpixels_per_second = 0.0;
+	if (stats.seconds > 0.0) {
+		stats.mpixels_per_second = pixels / stats.seconds / 1.0e6;
+	}
+
+	return stats;
+}
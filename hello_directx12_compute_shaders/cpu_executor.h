@@ -0,0 +1,170 @@
+// Liam Wynn, 12/02/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The cpu_executor is a native stand-in for the GPU. It runs the
+	hello_compute.hlsl kernel over host memory using the same
+	threadgroup geometry as the real dispatch: every group is handed
+	to a worker thread, and each row of a group is vectorized with
+	AVX or SSE when the CPU supports it.
+
+	The output is laid out exactly like the readback buffer (rows
+	padded out to the footprint row pitch), so anything that reads
+	the readback buffer can read this memory instead.
+
+	Nothing in here touches Windows or DirectX, so it builds and runs
+	on machines without a GPU.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Mirrors D3D12_TEXTURE_DATA_PITCH_ALIGNMENT.
+const unsigned int CPU_TEXTURE_DATA_PITCH_ALIGNMENT = 256;
+
+// Size of one R32G32B32A32_FLOAT element.
+const unsigned int CPU_FLOAT4_SIZE = 16;
+
+/*
+	Texel formats the kernel can write. They mirror the DXGI formats
+	of the same name. Only the float4 format has SIMD paths, the
+	others are converted one texel at a time. R32_FLOAT keeps only the
+	first channel and R11G11B10_FLOAT drops alpha, like a typed UAV
+	store to those formats does.
+*/
+enum cpu_texel_format {
+	CPU_TEXEL_R32G32B32A32_FLOAT,
+	CPU_TEXEL_R16G16B16A16_FLOAT,
+	CPU_TEXEL_R8G8B8A8_UNORM,
+	CPU_TEXEL_R32_FLOAT,
+	CPU_TEXEL_R11G11B10_FLOAT,
+	CPU_TEXEL_FORMAT_COUNT
+};
+
+// CPU_SIMD_AVX2 also means F16C, which every AVX2 CPU has.
+enum cpu_simd_level {
+	CPU_SIMD_SCALAR,
+	CPU_SIMD_SSE,
+	CPU_SIMD_AVX,
+	CPU_SIMD_AVX2
+};
+
+/*
+	Host-side equivalent of D3D12_PLACED_SUBRESOURCE_FOOTPRINT for a
+	single subresource.
+*/
+struct cpu_footprint {
+	uint64_t offset;
+	unsigned int width;
+	unsigned int height;
+	unsigned int row_pitch;
+	uint64_t total_size;
+};
+
+/*
+	A view of memory laid out like a readback footprint.
+*/
+struct cpu_texture {
+	unsigned char* data;
+	unsigned int width;
+	unsigned int height;
+	unsigned int row_pitch;
+	cpu_texel_format format;
+};
+
+/*
+	Dispatch geometry. The group size mirrors the numthreads attribute
+	and the group counts mirror the arguments of Dispatch. The
+	first_group fields let a caller run only part of the grid.
+*/
+struct cpu_dispatch_desc {
+	unsigned int group_size_x;
+	unsigned int group_size_y;
+
+	unsigned int group_count_x;
+	unsigned int group_count_y;
+
+	unsigned int first_group_x;
+	unsigned int first_group_y;
+
+	//
+	// Where texel (0, 0) of the target is in the whole image, and how
+	// big the image is. uv is relative to the image, so a tile of it
+	// computes its own part. For an untiled target the origin is 0 and
+	// the image is the target.
+	//
+
+	unsigned int origin_x;
+	unsigned int origin_y;
+	unsigned int image_width;
+	unsigned int image_height;
+};
+
+struct cpu_dispatch_stats {
+	double seconds;
+	double mpixels_per_second;
+	unsigned int groups_executed;
+};
+
+struct cpu_executor {
+	unsigned int num_threads;
+	cpu_simd_level simd_level;
+};
+
+void initialize_cpu_executor(
+	cpu_executor* executor,
+	const unsigned int num_threads
+);
+cpu_simd_level detect_cpu_simd_level();
+const char* cpu_simd_level_name(const cpu_simd_level level);
+
+unsigned int cpu_texel_size(const cpu_texel_format format);
+
+// The DXGI name without the DXGI_FORMAT_ prefix.
+const char* cpu_texel_format_name(const cpu_texel_format format);
+bool parse_cpu_texel_format(const char* text, cpu_texel_format* format);
+
+// Round to nearest even, like the GPU's float to half conversion.
+uint16_t float_to_half(const float value);
+
+// Exact. NaNs come back quiet, like F16C does it.
+float half_to_float(const uint16_t value);
+
+/*
+	The unsigned 11 and 10 bit floats of R11G11B10_FLOAT: 5 exponent
+	bits and 6 or 5 mantissa bits, bias 15. Rounds to nearest even.
+	Negative numbers go to 0, like the GPU's conversion.
+*/
+uint32_t float_to_float11(const float value);
+uint32_t float_to_float10(const float value);
+float float11_to_float(const uint32_t value);
+float float10_to_float(const uint32_t value);
+
+// R11G11B10_FLOAT packing of r, g and b.
+uint32_t pack_r11g11b10(const float r, const float g, const float b);
+
+cpu_footprint cpu_readback_footprint(
+	const unsigned int width,
+	const unsigned int height,
+	const unsigned int bytes_per_element
+);
+
+cpu_dispatch_desc cpu_hello_compute_dispatch(
+	const unsigned int width,
+	const unsigned int height
+);
+
+// Enough groups of group_size_x by group_size_y to cover the texture.
+cpu_dispatch_desc cpu_dispatch_for_group_size(
+	const unsigned int width,
+	const unsigned int height,
+	const unsigned int group_size_x,
+	const unsigned int group_size_y
+);
+
+cpu_dispatch_stats cpu_dispatch_hello_compute(
+	cpu_executor* executor,
+	const cpu_texture* target,
+	const cpu_dispatch_desc* dispatch
+);
@@ -0,0 +1,276 @@
+// Liam Wynn, 12/09/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "descriptor_allocator.h"
+#include <chrono>
+
+using namespace std;
+
+void initialize_descriptor_allocator(
+	descriptor_allocator* allocator,
+	const unsigned int persistent_count,
+	const unsigned int transient_count
+) {
+	allocator->persistent_count = persistent_count;
+	allocator->persistent_high_water = 0;
+	allocator->free_list.clear();
+	allocator->free_list.reserve(persistent_count);
+	allocator->persistent_in_use.assign(persistent_count, false);
+
+	allocator->transient_count = transient_count;
+	allocator->transient_head = 0;
+	allocator->transient_tail = 0;
+	allocator->transient_allocated_total = 0;
+	allocator->transient_freed_total = 0;
+	allocator->frame_marks.clear();
+}
+
+/* PERSISTENT SLOTS */
+
+unsigned int allocate_persistent_descriptor(descriptor_allocator* allocator) {
+	unsigned int index;
+
+	//
+	// Reuse a freed slot if there is one. Otherwise take the next slot
+	// that has never been handed out.
+	//
+
+	if (!allocator->free_list.empty()) {
+		index = allocator->free_list.back();
+		allocator->free_list.pop_back();
+	}
+	else if (allocator->persistent_high_water < allocator->persistent_count) {
+		index = allocator->persistent_high_water;
+		allocator->persistent_high_water++;
+	}
+	else {
+		return INVALID_DESCRIPTOR_INDEX;
+	}
+
+	allocator->persistent_in_use[index] = true;
+
+	return index;
+}
+
+bool free_persistent_descriptor(
+	descriptor_allocator* allocator,
+	const unsigned int index
+) {
+	//
+	// Ignore anything that isn't a live persistent slot, so a double
+	// free can't put the same slot on the free list twice.
+	//
+
+	if (index >= allocator->persistent_high_water) {
+		return false;
+	}
+
+	if (!allocator->persistent_in_use[index]) {
+		return false;
+	}
+
+	allocator->persistent_in_use[index] = false;
+	allocator->free_list.push_back(index);
+
+	return true;
+}
+
+unsigned int persistent_descriptors_in_use(const descriptor_allocator* allocator) {
+	return allocator->persistent_high_water - (unsigned int)allocator->free_list.size();
+}
+
+/* TRANSIENT RING */
+
+unsigned int allocate_transient_descriptors(
+	descriptor_allocator* allocator,
+	const unsigned int count
+) {
+	unsigned int ring_size;
+	unsigned int head;
+	unsigned int tail;
+	unsigned int start;
+	unsigned int skipped;
+	uint64_t used;
+
+	ring_size = allocator->transient_count;
+	head = allocator->transient_head;
+	tail = allocator->transient_tail;
+	used = allocator->transient_allocated_total - allocator->transient_freed_total;
+
+	if (count == 0 || count > ring_size) {
+		return INVALID_DESCRIPTOR_INDEX;
+	}
+
+	//
+	// An empty ring can start over from the beginning. Any marks left
+	// over cover no slots at this point.
+	//
+
+	if (used == 0) {
+		allocator->frame_marks.clear();
+		allocator->transient_head = 0;
+		allocator->transient_tail = 0;
+		head = 0;
+		tail = 0;
+	}
+
+	//
+	// The range has to be contiguous. If it doesn't fit between the
+	// head and the end of the ring, skip the leftover slots and start
+	// over at the beginning. The skipped slots come back with the
+	// frame that skipped them.
+	//
+
+	skipped = 0;
+
+	if (used == 0 || head > tail) {
+		if (count <= ring_size - head) {
+			start = head;
+		}
+		else if (count <= tail) {
+			skipped = ring_size - head;
+			start = 0;
+		}
+		else {
+			return INVALID_DESCRIPTOR_INDEX;
+		}
+	}
+	else if (head < tail && count <= tail - head) {
+		start = head;
+	}
+	else {
+		// Either full (head == tail) or not enough room before the tail.
+		return INVALID_DESCRIPTOR_INDEX;
+	}
+
+	allocator->transient_head = start + count;
+	if (allocator->transient_head == ring_size) {
+		allocator->transient_head = 0;
+	}
+
+	allocator->transient_allocated_total += skipped + count;
+
+	return allocator->persistent_count + start;
+}
+
+void end_transient_frame(
+	descriptor_allocator* allocator,
+	const uint64_t fence_value
+) {
+	transient_frame_mark mark;
+
+	//
+	// If nothing was allocated since the last mark, the later fence
+	// simply covers the same slots.
+	//
+
+	if (!allocator->frame_marks.empty()) {
+		transient_frame_mark& last = allocator->frame_marks.back();
+
+		if (last.allocated_total == allocator->transient_allocated_total) {
+			last.fence_value = fence_value;
+			return;
+		}
+	}
+
+	mark.fence_value = fence_value;
+	mark.allocated_total = allocator->transient_allocated_total;
+	mark.head = allocator->transient_head;
+
+	allocator->frame_marks.push_back(mark);
+}
+
+void reclaim_transient_descriptors(
+	descriptor_allocator* allocator,
+	const uint64_t completed_fence_value
+) {
+	while (!allocator->frame_marks.empty()) {
+		const transient_frame_mark& mark = allocator->frame_marks.front();
+
+		if (mark.fence_value > completed_fence_value) {
+			break;
+		}
+
+		allocator->transient_tail = mark.head;
+		allocator->transient_freed_total = mark.allocated_total;
+		allocator->frame_marks.pop_front();
+	}
+}
+
+unsigned int transient_descriptors_in_use(const descriptor_allocator* allocator) {
+	return (unsigned int)(
+		allocator->transient_allocated_total - allocator->transient_freed_total
+	);
+}
+
+/* BENCHMARK */
+
+void benchmark_descriptor_allocator(FILE* out) {
+	const unsigned int persistent_count = 1 << 16;
+	const unsigned int transient_count = 1 << 16;
+	const unsigned int rounds = 200;
+	const unsigned int frames = 200000;
+	descriptor_allocator allocator;
+	vector<unsigned int> indices;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+	uint64_t ops;
+	unsigned int sink;
+
+	initialize_descriptor_allocator(&allocator, persistent_count, transient_count);
+	indices.resize(persistent_count);
+	sink = 0;
+
+	//
+	// Persistent slots: fill the region, then free it in a scattered
+	// order so the free list gets a workout.
+	//
+
+	start = chrono::steady_clock::now();
+
+	for (unsigned int r = 0; r < rounds; r++) {
+		for (unsigned int i = 0; i < persistent_count; i++) {
+			indices[i] = allocate_persistent_descriptor(&allocator);
+		}
+
+		for (unsigned int i = 0; i < persistent_count; i++) {
+			free_persistent_descriptor(&allocator, indices[(i * 7919) % persistent_count]);
+		}
+	}
+
+	elapsed = chrono::steady_clock::now() - start;
+	ops = (uint64_t)rounds * persistent_count * 2;
+
+	fprintf(
+		out,
+		"persistent alloc+free: %.1f M ops/s\n",
+		ops / elapsed.count() / 1.0e6
+	);
+
+	//
+	// Transient ring: a few odd-sized tables per frame, three frames
+	// in flight.
+	//
+
+	start = chrono::steady_clock::now();
+
+	for (unsigned int frame = 1; frame <= frames; frame++) {
+		sink += allocate_transient_descriptors(&allocator, 1);
+		sink += allocate_transient_descriptors(&allocator, 5);
+		sink += allocate_transient_descriptors(&allocator, 17);
+		end_transient_frame(&allocator, frame);
+
+		if (frame > 3) {
+			reclaim_transient_descriptors(&allocator, frame - 3);
+		}
+	}
+
+	elapsed = chrono::steady_clock::now() - start;
+	ops = (uint64_t)frames * 3;
+
+	fprintf(
+		out,
+		"transient alloc (3 per frame, 3 frames in flight): %.1f M ops/s (%u)\n",
+		ops / elapsed.count() / 1.0e6,
+		sink & 1
+	);
+}
@@ -0,0 +1,98 @@
+// Liam Wynn, 12/09/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The descriptor allocator decides which slots of a descriptor heap
+	are in use. It only hands out indices, so it doesn't need a device
+	and can be exercised on any machine. The descriptor_heap in
+	dx12_handler owns one of these.
+
+	A heap is split into two regions:
+
+	[0, persistent_count)
+		Persistent slots. These live until they are explicitly freed.
+		Freed slots go on a free list, so both alloc and free are O(1).
+
+	[persistent_count, persistent_count + transient_count)
+		A ring of transient slots for descriptors that only need to
+		live for one frame (or one submission). Each frame is tagged
+		with the fence value signaled after it, and its slots come back
+		once the GPU has passed that fence. Transient ranges are always
+		contiguous so they can back a descriptor table.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+const unsigned int INVALID_DESCRIPTOR_INDEX = 0xFFFFFFFF;
+
+/*
+	Marks the end of one frame's worth of transient allocations.
+*/
+struct transient_frame_mark {
+	uint64_t fence_value;
+	uint64_t allocated_total;
+	unsigned int head;
+};
+
+struct descriptor_allocator {
+	//
+	// Persistent region.
+	//
+
+	unsigned int persistent_count;
+	unsigned int persistent_high_water;
+	std::vector<unsigned int> free_list;
+	std::vector<bool> persistent_in_use;
+
+	//
+	// Transient ring. head and tail are relative to the start of the
+	// ring. The totals only ever grow (they include slots skipped when
+	// a range has to wrap), so used = allocated - freed.
+	//
+
+	unsigned int transient_count;
+	unsigned int transient_head;
+	unsigned int transient_tail;
+	uint64_t transient_allocated_total;
+	uint64_t transient_freed_total;
+	std::deque<transient_frame_mark> frame_marks;
+};
+
+void initialize_descriptor_allocator(
+	descriptor_allocator* allocator,
+	const unsigned int persistent_count,
+	const unsigned int transient_count
+);
+
+/* PERSISTENT SLOTS */
+unsigned int allocate_persistent_descriptor(descriptor_allocator* allocator);
+bool free_persistent_descriptor(
+	descriptor_allocator* allocator,
+	const unsigned int index
+);
+unsigned int persistent_descriptors_in_use(const descriptor_allocator* allocator);
+
+/* TRANSIENT RING */
+unsigned int allocate_transient_descriptors(
+	descriptor_allocator* allocator,
+	const unsigned int count
+);
+void end_transient_frame(
+	descriptor_allocator* allocator,
+	const uint64_t fence_value
+);
+void reclaim_transient_descriptors(
+	descriptor_allocator* allocator,
+	const uint64_t completed_fence_value
+);
+unsigned int transient_descriptors_in_use(const descriptor_allocator* allocator);
+
+/*
+	Times alloc/free on the persistent slots and alloc/reclaim on the
+	transient ring. Writes a short report to out.
+*/
+void benchmark_descriptor_allocator(FILE* out);
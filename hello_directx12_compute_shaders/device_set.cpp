@@ -0,0 +1,343 @@
+// Liam Wynn, 01/07/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "device_set.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+/* PROBE CACHE */
+
+static bool parse_device_probe(istream& fields, device_probe* probe) {
+	int usable;
+	double throughput;
+
+	if (!(fields >> usable >> throughput) || throughput < 0.0) {
+		return false;
+	}
+
+	probe->usable = usable != 0;
+	probe->throughput = throughput;
+
+	return true;
+}
+
+static void format_device_probe(ostream& out, const device_probe* probe) {
+	out << (probe->usable ? 1 : 0) << " " << probe->throughput;
+}
+
+static bool same_device_probe(const device_probe* a, const device_probe* b) {
+	return a->usable == b->usable && a->throughput == b->throughput;
+}
+
+void load_device_probe_cache(device_probe_cache* cache, const string& path) {
+	load_keyed_store(cache, path, parse_device_probe);
+}
+
+bool find_device_probe(
+	const device_probe_cache* cache,
+	const string& key,
+	device_probe* probe
+) {
+	return find_keyed_entry(cache, key, probe);
+}
+
+void store_device_probe(
+	device_probe_cache* cache,
+	const string& key,
+	const device_probe* probe
+) {
+	store_keyed_entry(cache, key, probe, same_device_probe);
+}
+
+bool save_device_probe_cache(device_probe_cache* cache) {
+	return save_keyed_store(cache, format_device_probe);
+}
+
+/* DEVICE SET */
+
+void initialize_device_set(
+	device_set* set,
+	const vector<compute_device*>& devices,
+	const device_probe_cache* cache
+) {
+	device_probe probe;
+	double known_sum;
+	unsigned int known;
+
+	set->devices = devices;
+	set->throughput.assign(devices.size(), 0.0);
+	set->known.assign(devices.size(), false);
+	set->smoothing = DEFAULT_SPLIT_SMOOTHING;
+	set->dispatches = 0;
+
+	known_sum = 0.0;
+	known = 0;
+
+	for (size_t i = 0; i < devices.size(); i++) {
+		if (cache != NULL
+			&& find_device_probe(cache, devices[i]->probe_key(), &probe)
+			&& probe.throughput > 0.0) {
+			set->throughput[i] = probe.throughput;
+			set->known[i] = true;
+			known_sum += probe.throughput;
+			known++;
+		}
+	}
+
+	//
+	// With nothing to go on, every device is as fast as the average
+	// of the ones we know, or all the same.
+	//
+
+	for (double& throughput : set->throughput) {
+		if (throughput == 0.0) {
+			throughput = known > 0 ? known_sum / known : 1.0;
+		}
+	}
+}
+
+vector<split_band> plan_split(
+	const device_set* set,
+	const unsigned int group_rows
+) {
+	vector<split_band> bands;
+	vector<pair<double, size_t>> remainders;
+	vector<unsigned int> rows;
+	double total;
+	double share;
+	unsigned int floor_rows;
+	unsigned int spare;
+	unsigned int assigned;
+	unsigned int first;
+
+	bands.resize(set->devices.size());
+	rows.assign(set->devices.size(), 0);
+
+	if (set->devices.empty()) {
+		return bands;
+	}
+
+	total = 0.0;
+
+	for (double throughput : set->throughput) {
+		total += throughput;
+	}
+
+	//
+	// A device with no rows would never be measured again, so however
+	// slow it looks, every device gets one if there are enough to go
+	// round.
+	//
+
+	floor_rows = group_rows >= set->devices.size() ? 1 : 0;
+	spare = group_rows - floor_rows * (unsigned int)set->devices.size();
+
+	//
+	// Then whole rows of the rest by share, and the leftovers to the
+	// biggest fractions. Ties go to the earlier device.
+	//
+
+	assigned = 0;
+
+	for (size_t i = 0; i < set->devices.size(); i++) {
+		share = total > 0.0
+			? spare * (set->throughput[i] / total)
+			: (double)spare / set->devices.size();
+
+		rows[i] = floor_rows + (unsigned int)share;
+		assigned += rows[i];
+		remainders.push_back(make_pair(share - (unsigned int)share, i));
+	}
+
+	stable_sort(remainders.begin(), remainders.end(), [](const pair<double, size_t>& a, const pair<double, size_t>& b) {
+		return a.first > b.first;
+	});
+
+	for (size_t k = 0; assigned < group_rows; k = (k + 1) % remainders.size()) {
+		rows[remainders[k].second]++;
+		assigned++;
+	}
+
+	first = 0;
+
+	for (size_t i = 0; i < set->devices.size(); i++) {
+		bands[i].first_group_y = first;
+		bands[i].group_count_y = rows[i];
+		first += rows[i];
+	}
+
+	return bands;
+}
+
+split_dispatch_stats run_split_dispatch(
+	device_set* set,
+	const cpu_dispatch_desc* dispatch,
+	const cpu_texture* output
+) {
+	split_dispatch_stats stats;
+	split_band band;
+	double fastest;
+	double measured;
+
+	stats.bands = plan_split(set, dispatch->group_count_y);
+	stats.seconds.assign(set->devices.size(), 0.0);
+
+	//
+	// Everyone starts before anyone is waited on, so the devices run
+	// at the same time.
+	//
+
+	for (size_t i = 0; i < set->devices.size(); i++) {
+		band = stats.bands[i];
+		band.first_group_y += dispatch->first_group_y;
+
+		if (band.group_count_y > 0) {
+			set->devices[i]->submit_band(dispatch, &band, output);
+		}
+	}
+
+	for (size_t i = 0; i < set->devices.size(); i++) {
+		if (stats.bands[i].group_count_y > 0) {
+			stats.seconds[i] = set->devices[i]->finish_band();
+		}
+	}
+
+	//
+	// Fold each band's rate into its device's throughput. A device
+	// with an empty band learned nothing and keeps its number. The
+	// first measurement replaces a guess, but only blends into a
+	// number from the probe cache: one cold band shouldn't throw away
+	// what earlier runs learned.
+	//
+
+	stats.makespan = 0.0;
+	fastest = 0.0;
+
+	for (size_t i = 0; i < set->devices.size(); i++) {
+		if (stats.bands[i].group_count_y == 0) {
+			continue;
+		}
+
+		stats.makespan = max(stats.makespan, stats.seconds[i]);
+		fastest = fastest == 0.0 ? stats.seconds[i] : min(fastest, stats.seconds[i]);
+
+		if (stats.seconds[i] > 0.0) {
+			measured = stats.bands[i].group_count_y / stats.seconds[i];
+			set->throughput[i] = !set->known[i] && set->smoothing > 0.0
+				? measured
+				: (1.0 - set->smoothing) * set->throughput[i] + set->smoothing * measured;
+			set->known[i] = true;
+		}
+	}
+
+	stats.imbalance = fastest > 0.0 ? stats.makespan / fastest : 1.0;
+	set->dispatches++;
+
+	return stats;
+}
+
+void store_device_set_probes(const device_set* set, device_probe_cache* cache) {
+	device_probe probe;
+
+	for (size_t i = 0; i < set->devices.size(); i++) {
+		probe.usable = true;
+		probe.throughput = set->throughput[i];
+		store_device_probe(cache, set->devices[i]->probe_key(), &probe);
+	}
+}
+
+/* CPU DEVICE */
+
+void initialize_cpu_compute_device(
+	cpu_compute_device* device,
+	const unsigned int num_threads,
+	const double slowdown
+) {
+	char label[64];
+
+	initialize_cpu_executor(&device->executor, num_threads);
+	device->slowdown = slowdown < 1.0 ? 1.0 : slowdown;
+	device->band_seconds = 0.0;
+
+	snprintf(label, sizeof(label), "cpu x%.2f", device->slowdown);
+	device->label = label;
+}
+
+const char* cpu_compute_device::name() {
+	return label.c_str();
+}
+
+string cpu_compute_device::probe_key() {
+	char key[64];
+
+	snprintf(key, sizeof(key), "cpu-%u-%s-x%.2f", executor.num_threads, cpu_simd_level_name(executor.simd_level), slowdown);
+
+	return key;
+}
+
+void cpu_compute_device::submit_band(
+	const cpu_dispatch_desc* dispatch,
+	const split_band* band,
+	const cpu_texture* output
+) {
+	cpu_dispatch_desc part;
+	cpu_texture target;
+
+	part = *dispatch;
+	part.first_group_y = band->first_group_y;
+	part.group_count_y = band->group_count_y;
+	target = *output;
+
+	worker = thread([this, part, target]() {
+		chrono::steady_clock::time_point start;
+		chrono::duration<double> elapsed;
+
+		start = chrono::steady_clock::now();
+		cpu_dispatch_hello_compute(&executor, &target, &part);
+		elapsed = chrono::steady_clock::now() - start;
+
+		if (slowdown > 1.0) {
+			this_thread::sleep_for(elapsed * (slowdown - 1.0));
+		}
+
+		elapsed = chrono::steady_clock::now() - start;
+		band_seconds = elapsed.count();
+	});
+}
+
+double cpu_compute_device::finish_band() {
+	worker.join();
+	return band_seconds;
+}
+
+bool parse_device_speeds(const char* text, vector<double>* slowdowns) {
+	const char* c;
+	char* end;
+	double slowdown;
+
+	slowdowns->clear();
+	c = text;
+
+	while (true) {
+		slowdown = strtod(c, &end);
+
+		if (end == c || slowdown < 1.0) {
+			return false;
+		}
+
+		slowdowns->push_back(slowdown);
+
+		if (*end == '\0') {
+			return true;
+		}
+
+		if (*end != ',') {
+			return false;
+		}
+
+		c = end + 1;
+	}
+}
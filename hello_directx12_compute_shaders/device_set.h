@@ -0,0 +1,202 @@
+// Liam Wynn, 01/07/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	A device set runs one logical dispatch on several compute devices
+	at once.
+
+	The dispatch's threadgroup grid is cut into bands of group rows,
+	one band per device, sized in proportion to how many group rows a
+	second each device has been measured to do. Every device writes its
+	band into the same output, laid out like a readback footprint of
+	the whole image, so the bands gather into one result with no extra
+	pass. The bands are disjoint, so the devices never write the same
+	memory.
+
+	Each device reports how long its band took, submit to finish. That
+	updates its throughput, a moving average, and the next dispatch is
+	split with the new numbers. A device that is slower than its share
+	gets less work next time, so the devices end up finishing together.
+
+	The probe cache remembers, per device, whether it was usable and
+	the throughput it was last measured at. It is a keyed store, so
+	the next run starts balanced and skips probing adapters it has
+	already tried.
+
+	The CPU device here runs its band on the cpu_executor, on a thread
+	of its own. It can be slowed down on purpose, so a set of them
+	stands in for devices of different speeds. gpu_split_device runs
+	bands on an adapter.
+
+	Nothing here depends on Windows.
+*/
+
+#pragma once
+
+#include "cpu_executor.h"
+#include "keyed_store.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+	group_count_y group rows from first_group_y. A device only gets an
+	empty band when there are fewer group rows than devices.
+*/
+struct split_band {
+	unsigned int first_group_y;
+	unsigned int group_count_y;
+};
+
+struct compute_device {
+	virtual ~compute_device() {}
+
+	virtual const char* name() = 0;
+
+	// What the probe cache knows this device by.
+	virtual std::string probe_key() = 0;
+
+	/*
+		Starts band of dispatch. The band's rows of output are written
+		by the time finish_band returns. dispatch covers the whole
+		grid; only band is run.
+	*/
+	virtual void submit_band(
+		const cpu_dispatch_desc* dispatch,
+		const split_band* band,
+		const cpu_texture* output
+	) = 0;
+
+	// Waits for the band and returns how many seconds it took.
+	virtual double finish_band() = 0;
+};
+
+/* PROBE CACHE */
+
+struct device_probe {
+	bool usable;
+
+	// Group rows per second. 0 if never measured.
+	double throughput;
+};
+
+// One device per line: key, usable (0 or 1), throughput.
+typedef keyed_store<device_probe> device_probe_cache;
+
+// A missing or unreadable file is an empty cache.
+void load_device_probe_cache(device_probe_cache* cache, const std::string& path);
+
+// Returns false if key isn't in the cache.
+bool find_device_probe(
+	const device_probe_cache* cache,
+	const std::string& key,
+	device_probe* probe
+);
+
+void store_device_probe(
+	device_probe_cache* cache,
+	const std::string& key,
+	const device_probe* probe
+);
+
+// Only writes if something changed. Returns false if it couldn't.
+bool save_device_probe_cache(device_probe_cache* cache);
+
+/* DEVICE SET */
+
+// The newest measurement's weight in a device's throughput.
+const double DEFAULT_SPLIT_SMOOTHING = 0.5;
+
+struct device_set {
+	std::vector<compute_device*> devices;
+
+	// Group rows per second, per device.
+	std::vector<double> throughput;
+	double smoothing;
+
+	// Whether a device's throughput was loaded from the probe cache or
+	// measured, rather than guessed. Only a guess is replaced outright
+	// by the first measurement.
+	std::vector<bool> known;
+
+	unsigned int dispatches;
+};
+
+struct split_dispatch_stats {
+	std::vector<split_band> bands;
+	std::vector<double> seconds;
+
+	// The slowest band, which is how long the dispatch took.
+	double makespan;
+
+	// Slowest band over fastest, among non-empty bands. 1 is perfect.
+	double imbalance;
+};
+
+/*
+	Throughputs come from cache when it has them. Devices it doesn't
+	know start at the mean of those it does, or all equal. cache may
+	be NULL.
+*/
+void initialize_device_set(
+	device_set* set,
+	const std::vector<compute_device*>& devices,
+	const device_probe_cache* cache
+);
+
+/*
+	Gives every device one row, so even a slow one keeps being
+	measured, then cuts the rest in proportion to their throughput,
+	largest remainder first. The bands are in device order and cover
+	every row.
+*/
+std::vector<split_band> plan_split(
+	const device_set* set,
+	const unsigned int group_rows
+);
+
+/*
+	Runs dispatch on every device, each on its band, into output, and
+	waits for all of them. Then updates the throughputs.
+*/
+split_dispatch_stats run_split_dispatch(
+	device_set* set,
+	const cpu_dispatch_desc* dispatch,
+	const cpu_texture* output
+);
+
+// Writes every device's throughput to cache.
+void store_device_set_probes(const device_set* set, device_probe_cache* cache);
+
+/* CPU DEVICE */
+
+/*
+	Runs bands on a cpu_executor of its own. With slowdown above 1 it
+	sleeps after each band for (slowdown - 1) times as long as the band
+	took, so it looks that many times slower.
+*/
+struct cpu_compute_device : compute_device {
+	cpu_executor executor;
+	double slowdown;
+	std::string label;
+
+	std::thread worker;
+	double band_seconds;
+
+	const char* name() override;
+	std::string probe_key() override;
+	void submit_band(
+		const cpu_dispatch_desc* dispatch,
+		const split_band* band,
+		const cpu_texture* output
+	) override;
+	double finish_band() override;
+};
+
+void initialize_cpu_compute_device(
+	cpu_compute_device* device,
+	const unsigned int num_threads,
+	const double slowdown
+);
+
+// Parses "1,2.5,4" into slowdowns of at least 1.
+bool parse_device_speeds(const char* text, std::vector<double>* slowdowns);
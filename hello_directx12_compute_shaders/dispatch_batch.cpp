@@ -0,0 +1,302 @@
+// Liam Wynn, 12/21/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "dispatch_batch.h"
+#include <chrono>
+#include <unordered_map>
+
+using namespace std;
+
+/*
+	What has happened to a resource since its last UAV barrier.
+*/
+struct pending_access {
+	bool read;
+	bool written;
+};
+
+typedef unordered_map<const void*, pending_access> pending_access_map;
+
+static void build_dependencies(
+	const vector<dispatch_batch_entry>& entries,
+	vector<vector<size_t>>* dependents,
+	vector<unsigned int>* num_dependencies
+) {
+	unordered_map<const void*, size_t> last_writer;
+	unordered_map<const void*, vector<size_t>> readers;
+
+	dependents->assign(entries.size(), vector<size_t>());
+	num_dependencies->assign(entries.size(), 0);
+
+	//
+	// A write depends on the last write and every read since. A read
+	// depends on the last write.
+	//
+
+	for (size_t i = 0; i < entries.size(); i++) {
+		for (const dispatch_resource_use& use : entries[i].resources) {
+			auto writer = last_writer.find(use.resource);
+
+			if (writer != last_writer.end() && writer->second != i) {
+				(*dependents)[writer->second].push_back(i);
+				(*num_dependencies)[i]++;
+			}
+
+			if (!use.writes) {
+				readers[use.resource].push_back(i);
+				continue;
+			}
+
+			for (size_t reader : readers[use.resource]) {
+				if (reader != i) {
+					(*dependents)[reader].push_back(i);
+					(*num_dependencies)[i]++;
+				}
+			}
+
+			readers[use.resource].clear();
+			last_writer[use.resource] = i;
+		}
+	}
+}
+
+static bool needs_barrier(
+	const pending_access_map& pending,
+	const void* resource,
+	bool writes
+) {
+	auto it = pending.find(resource);
+
+	if (it == pending.end()) {
+		return false;
+	}
+
+	return it->second.written || (writes && it->second.read);
+}
+
+static bool entry_needs_barrier(
+	const dispatch_batch_entry& entry,
+	const pending_access_map& pending
+) {
+	for (const dispatch_resource_use& use : entry.resources) {
+		if (needs_barrier(pending, use.resource, use.writes)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void emit_dispatch(
+	const vector<dispatch_batch_entry>& entries,
+	const size_t index,
+	pending_access_map* pending,
+	const void** bound_root_signature,
+	const void** bound_pipeline,
+	dispatch_batch_plan* plan
+) {
+	const dispatch_batch_entry& entry = entries[index];
+	planned_dispatch dispatch;
+
+	dispatch.entry = index;
+	dispatch.set_root_signature = plan->order.empty() || entry.root_signature != *bound_root_signature;
+	dispatch.set_pipeline = plan->order.empty() || entry.pipeline != *bound_pipeline;
+
+	for (const dispatch_resource_use& use : entry.resources) {
+		if (needs_barrier(*pending, use.resource, use.writes)) {
+			dispatch.uav_barriers.push_back(use.resource);
+			pending->erase(use.resource);
+		}
+	}
+
+	for (const dispatch_resource_use& use : entry.resources) {
+		pending_access& access = (*pending)[use.resource];
+
+		access.read = access.read || !use.writes;
+		access.written = access.written || use.writes;
+	}
+
+	if (dispatch.set_root_signature) {
+		plan->root_signature_changes++;
+	}
+
+	if (dispatch.set_pipeline) {
+		plan->pipeline_changes++;
+	}
+
+	plan->uav_barriers += (unsigned int)dispatch.uav_barriers.size();
+
+	*bound_root_signature = entry.root_signature;
+	*bound_pipeline = entry.pipeline;
+
+	plan->order.push_back(dispatch);
+}
+
+static void reset_plan(dispatch_batch_plan* plan, const size_t size) {
+	plan->order.clear();
+	plan->order.reserve(size);
+	plan->root_signature_changes = 0;
+	plan->pipeline_changes = 0;
+	plan->uav_barriers = 0;
+}
+
+void plan_dispatch_batch(
+	const vector<dispatch_batch_entry>& entries,
+	dispatch_batch_plan* plan
+) {
+	vector<vector<size_t>> dependents;
+	vector<unsigned int> num_dependencies;
+	vector<size_t> ready;
+	pending_access_map pending;
+	const void* bound_root_signature;
+	const void* bound_pipeline;
+
+	reset_plan(plan, entries.size());
+	build_dependencies(entries, &dependents, &num_dependencies);
+
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (num_dependencies[i] == 0) {
+			ready.push_back(i);
+		}
+	}
+
+	bound_root_signature = NULL;
+	bound_pipeline = NULL;
+
+	//
+	// List scheduling. Of the dispatches whose dependencies have all
+	// been recorded, take the cheapest one to record next: no barrier
+	// beats no pipeline change beats no root signature change. Ties go
+	// to whichever was added first, so an all-dependent batch comes
+	// out in its original order.
+	//
+
+	while (!ready.empty()) {
+		size_t best;
+		unsigned int best_cost;
+		size_t index;
+
+		best = 0;
+		best_cost = ~0u;
+
+		for (size_t r = 0; r < ready.size(); r++) {
+			const dispatch_batch_entry& entry = entries[ready[r]];
+			unsigned int cost;
+
+			cost = 0;
+
+			if (!plan->order.empty()) {
+				cost += entry_needs_barrier(entry, pending) ? 4 : 0;
+				cost += entry.pipeline != bound_pipeline ? 2 : 0;
+				cost += entry.root_signature != bound_root_signature ? 1 : 0;
+			}
+
+			if (cost < best_cost || (cost == best_cost && ready[r] < ready[best])) {
+				best = r;
+				best_cost = cost;
+			}
+		}
+
+		index = ready[best];
+		ready[best] = ready.back();
+		ready.pop_back();
+
+		emit_dispatch(entries, index, &pending, &bound_root_signature, &bound_pipeline, plan);
+
+		for (size_t dependent : dependents[index]) {
+			if (--num_dependencies[dependent] == 0) {
+				ready.push_back(dependent);
+			}
+		}
+	}
+}
+
+void plan_dispatch_batch_in_order(
+	const vector<dispatch_batch_entry>& entries,
+	dispatch_batch_plan* plan
+) {
+	pending_access_map pending;
+	const void* bound_root_signature;
+	const void* bound_pipeline;
+
+	reset_plan(plan, entries.size());
+
+	bound_root_signature = NULL;
+	bound_pipeline = NULL;
+
+	for (size_t i = 0; i < entries.size(); i++) {
+		emit_dispatch(entries, i, &pending, &bound_root_signature, &bound_pipeline, plan);
+	}
+}
+
+void benchmark_dispatch_planner(FILE* out) {
+	const unsigned int num_dispatches = 4096;
+	const unsigned int num_resources = 64;
+	const unsigned int num_pipelines = 4;
+	const unsigned int rounds = 50;
+	vector<dispatch_batch_entry> entries;
+	vector<char> resources(num_resources);
+	vector<char> pipelines(num_pipelines);
+	char root_signatures[2];
+	dispatch_batch_plan in_order;
+	dispatch_batch_plan sorted;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+
+	//
+	// Every dispatch writes one resource. A quarter of them also read
+	// the resource the one before wrote, which chains them together.
+	// Pipelines and root signatures are interleaved the way a caller
+	// looping over buffers would add them.
+	//
+
+	entries.resize(num_dispatches);
+
+	for (unsigned int i = 0; i < num_dispatches; i++) {
+		dispatch_batch_entry* entry = &entries[i];
+		dispatch_resource_use use;
+
+		entry->pipeline = &pipelines[i % num_pipelines];
+		entry->root_signature = &root_signatures[(i % num_pipelines) / 2];
+
+		use.resource = &resources[i % num_resources];
+		use.writes = true;
+		entry->resources.push_back(use);
+
+		if (i > 0 && i % 4 == 0) {
+			use.resource = &resources[(i - 1) % num_resources];
+			use.writes = false;
+			entry->resources.push_back(use);
+		}
+	}
+
+	plan_dispatch_batch_in_order(entries, &in_order);
+
+	start = chrono::steady_clock::now();
+
+	for (unsigned int r = 0; r < rounds; r++) {
+		plan_dispatch_batch(entries, &sorted);
+	}
+
+	elapsed = chrono::steady_clock::now() - start;
+
+	fprintf(out, "%u dispatches over %u resources, %u pipelines\n", num_dispatches, num_resources, num_pipelines);
+	fprintf(
+		out,
+		"  in order: %u root signature changes, %u pipeline changes, %u UAV barriers\n",
+		in_order.root_signature_changes,
+		in_order.pipeline_changes,
+		in_order.uav_barriers
+	);
+	fprintf(
+		out,
+		"  planned:  %u root signature changes, %u pipeline changes, %u UAV barriers\n",
+		sorted.root_signature_changes,
+		sorted.pipeline_changes,
+		sorted.uav_barriers
+	);
+	fprintf(
+		out,
+		"  planning: %.3f ms per batch\n",
+		elapsed.count() * 1000.0 / rounds
+	);
+}
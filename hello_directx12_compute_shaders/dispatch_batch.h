@@ -0,0 +1,74 @@
+// Liam Wynn, 12/21/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The dispatch batch planner decides what order a batch of dispatches
+	is recorded in, and where the UAV barriers go.
+
+	Two dispatches depend on each other if they touch the same resource
+	and at least one of them writes it. Dependent dispatches keep their
+	order. Everything else is free to move, and the planner uses that
+	freedom to keep dispatches with the same root signature and
+	pipeline next to each other.
+
+	A UAV barrier is only placed in front of a dispatch that touches a
+	resource an earlier dispatch wrote (or reads one it is about to
+	write) since that resource's last barrier, and only on those
+	resources. Independent dispatches run back to back.
+
+	Resources, root signatures and pipelines are plain pointers here,
+	so this part works without a device. compute_batch records the
+	plan into a command list.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+struct dispatch_resource_use {
+	const void* resource;
+	bool writes;
+};
+
+struct dispatch_batch_entry {
+	const void* root_signature;
+	const void* pipeline;
+	std::vector<dispatch_resource_use> resources;
+};
+
+struct planned_dispatch {
+	// Index into the batch's entries.
+	size_t entry;
+
+	bool set_root_signature;
+	bool set_pipeline;
+
+	// Resources that need a UAV barrier right before this dispatch.
+	std::vector<const void*> uav_barriers;
+};
+
+struct dispatch_batch_plan {
+	std::vector<planned_dispatch> order;
+
+	unsigned int root_signature_changes;
+	unsigned int pipeline_changes;
+	unsigned int uav_barriers;
+};
+
+void plan_dispatch_batch(
+	const std::vector<dispatch_batch_entry>& entries,
+	dispatch_batch_plan* plan
+);
+
+/*
+	Same barriers, but in submission order with no sorting. This is what
+	recording the dispatches one after another would cost.
+*/
+void plan_dispatch_batch_in_order(
+	const std::vector<dispatch_batch_entry>& entries,
+	dispatch_batch_plan* plan
+);
+
+// Compares the two plans on a synthetic batch, and times the planner.
+void benchmark_dispatch_planner(FILE* out);
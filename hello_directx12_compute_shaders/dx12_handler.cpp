@@ -1,41 +1,124 @@
 // Liam Wynn, 10/22/2024, Hello DirectX 12: Compute Shader Edition
 
 #include "dx12_handler.h"
+#include "gpu_upload.h"
 #include "utils.h"
+#include <cstdio>
 
 /* DX12_HANDLER IMPL */
 
-void initialize_dx12_handler(dx12_handler* dx12) {
+void initialize_dx12_handler(
+	dx12_handler* dx12,
+	const unsigned int frames_in_flight,
+	const bool async_queues,
+	const unsigned int adapter_index,
+	device_probe_cache* probes
+) {
 	ComPtr<IDXGIFactory4> factory;
 	ComPtr<IDXGIAdapter4> adapter;
+	std::vector<ComPtr<IDXGIAdapter4>> adapters;
+	DXGI_ADAPTER_DESC1 desc;
 
 	enable_dx12_debug_layer();
 
 	factory = create_dx12_factory();
-	adapter = get_valid_adapter(factory);
+	adapters = get_usable_adapters(factory, probes);
+
+	dx12->vendor_id = 0;
+	dx12->device_id = 0;
+
+	if (adapter_index < adapters.size()) {
+		adapter = adapters[adapter_index];
+		dx12->adapter_key = adapter_probe_key(adapter);
+
+		throw_if_failed(adapter->GetDesc1(&desc));
+		dx12->vendor_id = desc.VendorId;
+		dx12->device_id = desc.DeviceId;
+	}
+
+	//
+	// No hardware adapter. Leave the device empty so the application
+	// can fall back on the CPU executor.
+	//
+
+	if (adapter == NULL) {
+		dx12->device = NULL;
+		dx12->memory = NULL;
+		dx12->cbv_srv_uav_heap = NULL;
+		dx12->staging_heap = NULL;
+		return;
+	}
 
 	dx12->device = create_dx12_device(adapter);
-	dx12->command_queue = create_command_queue(dx12);
-	dx12->command_allocator = create_command_allocator(dx12);
-	dx12->command_list = create_command_list(dx12);
+	dx12->frames_in_flight = frames_in_flight == 0 ? 1 : frames_in_flight;
+
+	dx12->memory = new gpu_memory;
+	initialize_gpu_memory(dx12->memory, dx12->device.Get(), DEFAULT_GPU_MEMORY_BLOCK_SIZE);
 
 	dx12->cbv_srv_uav_heap = new descriptor_heap;
 	initialize_descriptor_heap(
 		dx12,
 		dx12->cbv_srv_uav_heap,
 		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
-		1000,
+		PERSISTENT_DESCRIPTOR_COUNT,
+		TRANSIENT_DESCRIPTOR_COUNT,
 		D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE
 	);
 
+	dx12->staging_heap = new descriptor_heap;
+	initialize_descriptor_heap(
+		dx12,
+		dx12->staging_heap,
+		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+		STAGING_DESCRIPTOR_COUNT,
+		0,
+		D3D12_DESCRIPTOR_HEAP_FLAG_NONE
+	);
+
 	//
-	// Finally, create the fence and synchronization objects.
+	// Create the synchronization objects. Every queue gets its own
+	// fence. The event is only used for CPU waits, which all happen on
+	// this thread, so the queues can share it.
 	//
 
 	dx12->frame_index = 0;
-	dx12->fence_value = 1;
-	dx12->fence = create_fence(dx12->device);
 	dx12->fence_event = create_fence_event();
+	initialize_queue_scheduler(&dx12->scheduler);
+
+	initialize_resource_state_tracker(
+		&dx12->resource_states,
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+		D3D12_RESOURCE_STATE_GENERIC_READ
+	);
+
+	//
+	// Finally, the queues themselves. The direct queue does all the
+	// work unless async queues were requested, in which case dispatches
+	// go to the compute queue and readback copies to the copy queue.
+	//
+
+	dx12->direct_queue = create_dx12_queue(
+		dx12,
+		QUEUE_DIRECT,
+		D3D12_COMMAND_LIST_TYPE_DIRECT
+	);
+
+	dx12->compute_queue = NULL;
+	dx12->copy_queue = NULL;
+
+	if (async_queues) {
+		dx12->compute_queue = create_dx12_queue(
+			dx12,
+			QUEUE_COMPUTE,
+			D3D12_COMMAND_LIST_TYPE_COMPUTE
+		);
+
+		dx12->copy_queue = create_dx12_queue(
+			dx12,
+			QUEUE_COPY,
+			D3D12_COMMAND_LIST_TYPE_COPY
+		);
+	}
 }
 
 void enable_dx12_debug_layer() {
@@ -71,21 +154,58 @@ ComPtr<IDXGIFactory4> create_dx12_factory() {
 	return factory;
 }
 
-ComPtr<IDXGIAdapter4> get_valid_adapter(ComPtr<IDXGIFactory4> factory) {
+std::string adapter_probe_key(ComPtr<IDXGIAdapter1> adapter) {
+	DXGI_ADAPTER_DESC1 desc;
+	LARGE_INTEGER driver_version;
+	HRESULT result;
+	char key[128];
+
+	result = adapter->GetDesc1(&desc);
+	throw_if_failed(result);
+
+	//
+	// The driver version is in the key so a driver update probes the
+	// adapter again.
+	//
+
+	result = adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driver_version);
+
+	if (FAILED(result)) {
+		driver_version.QuadPart = 0;
+	}
+
+	snprintf(
+		key,
+		sizeof(key),
+		"gpu-%04x-%04x-%08x-%02x-%llu-%016llx",
+		desc.VendorId,
+		desc.DeviceId,
+		desc.SubSysId,
+		desc.Revision,
+		(unsigned long long)desc.DedicatedVideoMemory,
+		(unsigned long long)driver_version.QuadPart
+	);
+
+	return key;
+}
+
+std::vector<ComPtr<IDXGIAdapter4>> get_usable_adapters(
+	ComPtr<IDXGIFactory4> factory,
+	device_probe_cache* probes
+) {
+	std::vector<ComPtr<IDXGIAdapter4>> adapters;
+	std::vector<SIZE_T> video_mem;
 	ComPtr<IDXGIAdapter4> adapter;
 	HRESULT result;
-	SIZE_T max_dedicated_vid_mem;
 	UINT i;
+	size_t slot;
 	ComPtr<IDXGIAdapter1> next_adapter;
 	DXGI_ADAPTER_DESC1 next_adapter_desc;
-	UINT next_adapter_flags;
 	UINT software_flag;
-	BOOL is_hardware_adapter;
-	BOOL can_create_device;
-	SIZE_T curr_video_mem;
-	BOOL has_more_video_mem;
+	std::string key;
+	device_probe probe;
+	bool known;
 
-	max_dedicated_vid_mem = 0;
 	i = 0;
 
 	while (true) {
@@ -94,35 +214,80 @@ ComPtr<IDXGIAdapter4> get_valid_adapter(ComPtr<IDXGIFactory4> factory) {
 			break;
 		}
 
+		i++;
+
 		result = next_adapter->GetDesc1(&next_adapter_desc);
+		throw_if_failed(result);
 
-		next_adapter_flags = next_adapter_desc.Flags;
-		software_flag = next_adapter_flags & DXGI_ADAPTER_FLAG_SOFTWARE;
-		is_hardware_adapter = software_flag == 0;
+		software_flag = next_adapter_desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE;
 
-		result = D3D12CreateDevice(
-			next_adapter.Get(),
-			D3D_FEATURE_LEVEL_12_1,
-			__uuidof(ID3D12Device),
-			NULL
-		);
+		if (software_flag != 0) {
+			continue;
+		}
+
+		//
+		// Creating a device to see if we can is slow, so the answer is
+		// remembered. Only adapters the cache hasn't seen are probed.
+		//
 
-		can_create_device = SUCCEEDED(result);
+		known = false;
 
-		curr_video_mem = next_adapter_desc.DedicatedVideoMemory;
-		has_more_video_mem = curr_video_mem > max_dedicated_vid_mem;
+		if (probes != NULL) {
+			key = adapter_probe_key(next_adapter);
+			known = find_device_probe(probes, key, &probe);
+		}
+
+		if (!known) {
+			result = D3D12CreateDevice(
+				next_adapter.Get(),
+				D3D_FEATURE_LEVEL_12_1,
+				__uuidof(ID3D12Device),
+				NULL
+			);
 
-		if (is_hardware_adapter && can_create_device && has_more_video_mem) {
-			max_dedicated_vid_mem = curr_video_mem;
+			probe.usable = SUCCEEDED(result);
+			probe.throughput = 0.0;
 
-			result = next_adapter.As(&adapter);
-			throw_if_failed(result);
+			if (probes != NULL) {
+				store_device_probe(probes, key, &probe);
+			}
 		}
 
-		i++;
+		if (!probe.usable) {
+			continue;
+		}
+
+		result = next_adapter.As(&adapter);
+		throw_if_failed(result);
+
+		//
+		// Most dedicated video memory first, so adapter 0 is the one
+		// get_valid_adapter has always picked.
+		//
+
+		slot = 0;
+
+		while (slot < adapters.size() && video_mem[slot] >= next_adapter_desc.DedicatedVideoMemory) {
+			slot++;
+		}
+
+		adapters.insert(adapters.begin() + slot, adapter);
+		video_mem.insert(video_mem.begin() + slot, next_adapter_desc.DedicatedVideoMemory);
+	}
+
+	return adapters;
+}
+
+ComPtr<IDXGIAdapter4> get_valid_adapter(ComPtr<IDXGIFactory4> factory) {
+	std::vector<ComPtr<IDXGIAdapter4>> adapters;
+
+	adapters = get_usable_adapters(factory, NULL);
+
+	if (adapters.empty()) {
+		return NULL;
 	}
 
-	return adapter;
+	return adapters[0];
 }
 
 ComPtr<ID3D12Device5> create_dx12_device(ComPtr<IDXGIAdapter4> adapter) {
@@ -173,7 +338,10 @@ ComPtr<ID3D12Device5> create_dx12_device(ComPtr<IDXGIAdapter4> adapter) {
 	return device;
 }
 
-ComPtr<ID3D12CommandQueue> create_command_queue(dx12_handler* dx12) {
+ComPtr<ID3D12CommandQueue> create_command_queue(
+	dx12_handler* dx12,
+	const D3D12_COMMAND_LIST_TYPE type
+) {
 	ComPtr<ID3D12CommandQueue> command_queue;
 	D3D12_COMMAND_QUEUE_DESC command_queue_desc;
 	ComPtr<ID3D12Device5> dev;
@@ -183,7 +351,7 @@ ComPtr<ID3D12CommandQueue> create_command_queue(dx12_handler* dx12) {
 
 	command_queue_desc = {};
 
-	command_queue_desc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+	command_queue_desc.Type = type;
 	command_queue_desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
 	command_queue_desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
 	command_queue_desc.NodeMask = 0;
@@ -198,7 +366,10 @@ ComPtr<ID3D12CommandQueue> create_command_queue(dx12_handler* dx12) {
 	return command_queue;
 }
 
-ComPtr<ID3D12CommandAllocator> create_command_allocator(dx12_handler* dx12) {
+ComPtr<ID3D12CommandAllocator> create_command_allocator(
+	dx12_handler* dx12,
+	const D3D12_COMMAND_LIST_TYPE type
+) {
 	ComPtr<ID3D12CommandAllocator> command_allocator;
 	ComPtr<ID3D12Device5> dev;
 	HRESULT result;
@@ -206,7 +377,7 @@ ComPtr<ID3D12CommandAllocator> create_command_allocator(dx12_handler* dx12) {
 	dev = dx12->device;
 
 	result = dev->CreateCommandAllocator(
-		D3D12_COMMAND_LIST_TYPE_DIRECT,
+		type,
 		IID_PPV_ARGS(&command_allocator)
 	);
 
@@ -215,18 +386,20 @@ ComPtr<ID3D12CommandAllocator> create_command_allocator(dx12_handler* dx12) {
 	return command_allocator;
 }
 
-ComPtr<ID3D12GraphicsCommandList> create_command_list(dx12_handler* dx12) {
+ComPtr<ID3D12GraphicsCommandList> create_command_list(
+	dx12_handler* dx12,
+	ComPtr<ID3D12CommandAllocator> allocator,
+	const D3D12_COMMAND_LIST_TYPE type
+) {
 	ComPtr<ID3D12GraphicsCommandList> command_list;
 	HRESULT result;
 	ComPtr<ID3D12Device5> dev;
-	ComPtr<ID3D12CommandAllocator> allocator;
 
 	dev = dx12->device;
-	allocator = dx12->command_allocator;
 
 	result = dev->CreateCommandList(
 		0,
-		D3D12_COMMAND_LIST_TYPE_DIRECT,
+		type,
 		allocator.Get(),
 		NULL,
 		IID_PPV_ARGS(&command_list)
@@ -240,11 +413,79 @@ ComPtr<ID3D12GraphicsCommandList> create_command_list(dx12_handler* dx12) {
 	return command_list;
 }
 
+dx12_queue* create_dx12_queue(
+	dx12_handler* dx12,
+	const queue_kind kind,
+	const D3D12_COMMAND_LIST_TYPE type
+) {
+	dx12_queue* queue;
+	ComPtr<ID3D12CommandAllocator> allocator;
+
+	queue = new dx12_queue;
+	queue->kind = kind;
+	queue->type = type;
+	queue->command_queue = create_command_queue(dx12, type);
+
+	for (unsigned int i = 0; i < dx12->frames_in_flight; i++) {
+		allocator = create_command_allocator(dx12, type);
+		queue->command_allocators.push_back(allocator);
+		queue->command_lists.push_back(create_command_list(dx12, allocator, type));
+	}
+
+	queue->timeline = new dx12_fence_timeline;
+	queue->timeline->command_queue = queue->command_queue;
+	queue->timeline->fence = create_fence(dx12->device);
+	queue->timeline->fence_value = 1;
+	queue->timeline->fence_event = dx12->fence_event;
+
+	//
+	// The transient descriptor ring is reclaimed against one fence, so
+	// only the direct queue hands out transient descriptors.
+	//
+
+	queue->timeline->transient_descriptors = NULL;
+	if (kind == QUEUE_DIRECT) {
+		queue->timeline->transient_descriptors = &dx12->cbv_srv_uav_heap->allocator;
+		dx12->cbv_srv_uav_heap->timeline = queue->timeline;
+	}
+
+	//
+	// Every queue that dispatches gets an upload ring of its own, so
+	// each ring is reclaimed against the fence of the queue using it.
+	//
+
+	queue->uploads = NULL;
+	queue->timeline->uploads = NULL;
+
+	if (kind != QUEUE_COPY) {
+		queue->uploads = new gpu_upload_ring;
+		initialize_gpu_upload_ring(queue->uploads, dx12, queue->timeline, UPLOAD_RING_SIZE);
+		queue->timeline->uploads = &queue->uploads->ring;
+	}
+
+	queue->frames = new frame_ring;
+	initialize_frame_ring(queue->frames, queue->timeline, dx12->frames_in_flight);
+
+	return queue;
+}
+
+void shutdown_dx12_queue(dx12_handler* dx12, dx12_queue* queue) {
+	if (queue->uploads != NULL) {
+		shutdown_gpu_upload_ring(queue->uploads, dx12);
+		delete queue->uploads;
+	}
+
+	delete queue->frames;
+	delete queue->timeline;
+	delete queue;
+}
+
 void initialize_descriptor_heap(
 	dx12_handler* dx12,
 	descriptor_heap* heap,
 	const D3D12_DESCRIPTOR_HEAP_TYPE heap_type,
-	const unsigned int num_descriptors,
+	const unsigned int num_persistent_descriptors,
+	const unsigned int num_transient_descriptors,
 	const D3D12_DESCRIPTOR_HEAP_FLAGS flags
 ) {
 	ComPtr<ID3D12Device5> dev;
@@ -256,7 +497,7 @@ void initialize_descriptor_heap(
 
 	desc = {};
 	desc.Type = heap_type;
-	desc.NumDescriptors = num_descriptors;
+	desc.NumDescriptors = num_persistent_descriptors + num_transient_descriptors;
 	desc.Flags = flags;
 
 	result = dev->CreateDescriptorHeap(
@@ -267,9 +508,16 @@ void initialize_descriptor_heap(
 	throw_if_failed(result);
 
 	heap->heap = dx_heap;
-	heap->curr_descriptor_index = 0;
-	heap->descriptor_count = num_descriptors;
+	heap->heap_type = heap_type;
+	heap->descriptor_count = desc.NumDescriptors;
 	heap->descriptor_size = dev->GetDescriptorHandleIncrementSize(heap_type);
+	heap->timeline = NULL;
+
+	initialize_descriptor_allocator(
+		&heap->allocator,
+		num_persistent_descriptors,
+		num_transient_descriptors
+	);
 }
 
 ComPtr<ID3D12Fence> create_fence(ComPtr<ID3D12Device5> device) {
@@ -301,54 +549,404 @@ HANDLE create_fence_event() {
 }
 
 void wait_for_previous_frame(dx12_handler* dx12) {
+	dx12_queue* queues[] = {
+		dx12->direct_queue,
+		dx12->compute_queue,
+		dx12->copy_queue
+	};
 	UINT64 fence_val;
-	ComPtr<ID3D12Fence> fence;
-	HANDLE fence_event;
-	ComPtr<ID3D12CommandQueue> command_queue;
+
+	//
+	// Signal each queue and then wait until the GPU gets there.
+	//
+
+	for (dx12_queue* queue : queues) {
+		if (queue == NULL) {
+			continue;
+		}
+
+		fence_val = queue->timeline->signal();
+		queue->timeline->wait_for(fence_val);
+	}
+
+	// Next we invoke GetCrrentBackBufferIndex, but this program
+	// has no swap chain. Let's see if we can get away with that.
+}
+
+ComPtr<ID3D12GraphicsCommandList> begin_command_batch(
+	dx12_queue* queue,
+	ID3D12PipelineState* initial_state
+) {
+	ComPtr<ID3D12CommandAllocator> allocator;
+	ComPtr<ID3D12GraphicsCommandList> command_list;
+	unsigned int slot;
 	HRESULT result;
 
-	fence_val = dx12->fence_value;
-	fence = dx12->fence;
-	fence_event = dx12->fence_event;
-	command_queue = dx12->command_queue;
+	//
+	// This only blocks if the GPU is still running the last batch
+	// recorded in this slot, i.e. when the ring has wrapped.
+	//
+
+	slot = begin_frame(queue->frames);
+	allocator = queue->command_allocators[slot];
+	command_list = queue->command_lists[slot];
+
+	result = allocator->Reset();
+	throw_if_failed(result);
+
+	result = command_list->Reset(allocator.Get(), initial_state);
+	throw_if_failed(result);
+
+	return command_list;
+}
+
+queue_ticket submit_command_batch(
+	dx12_handler* dx12,
+	dx12_queue* queue,
+	const queue_ticket* deps,
+	const unsigned int num_deps
+) {
+	return submit_command_batch_lists(dx12, queue, NULL, 0, deps, num_deps);
+}
+
+queue_ticket submit_command_batch_lists(
+	dx12_handler* dx12,
+	dx12_queue* queue,
+	ID3D12CommandList* const* extra_lists,
+	const unsigned int num_extra_lists,
+	const queue_ticket* deps,
+	const unsigned int num_deps
+) {
+	ComPtr<ID3D12GraphicsCommandList> command_list;
+	std::vector<ID3D12CommandList*> commands;
+	queue_ticket waits[QUEUE_KIND_COUNT];
+	unsigned int num_waits;
+	dx12_queue* other;
+	uint64_t fence_val;
+	HRESULT result;
+
+	command_list = queue->command_lists[queue->frames->current];
 
 	//
-	// Signal and increment the fence value.
+	// A split barrier can't outlive its command list.
 	//
 
-	result = command_queue->Signal(fence.Get(), fence_val);
+	end_resource_transitions(&dx12->resource_states);
+	record_resource_barriers(dx12, command_list.Get());
+
+	result = command_list->Close();
 	throw_if_failed(result);
-	dx12->fence_value++;
 
 	//
-	// Now wait until the previous frame is finished.
+	// Make this queue wait (on the GPU) for whatever it depends on from
+	// the other queues. The scheduler drops waits that are redundant.
 	//
 
-	if (fence->GetCompletedValue() < fence_val) {
-		result = fence->SetEventOnCompletion(fence_val, fence_event);
+	num_waits = resolve_queue_waits(
+		&dx12->scheduler,
+		queue->kind,
+		deps,
+		num_deps,
+		waits
+	);
+
+	for (unsigned int i = 0; i < num_waits; i++) {
+		other = queue_for_kind(dx12, waits[i].queue);
+
+		result = queue->command_queue->Wait(
+			other->timeline->fence.Get(),
+			waits[i].value
+		);
+
 		throw_if_failed(result);
-		WaitForSingleObject(fence_event, INFINITE);
 	}
 
-	// Next we invoke GetCrrentBackBufferIndex, but this program
-	// has no swap chain. Let's see if we can get away with that.
+	//
+	// One call, so the lists run back to back in the order given.
+	//
+
+	commands.push_back(command_list.Get());
+	commands.insert(commands.end(), extra_lists, extra_lists + num_extra_lists);
+
+	queue->command_queue->ExecuteCommandLists(
+		(UINT)commands.size(),
+		commands.data()
+	);
+
+	//
+	// Tag the slot with the fence value signaled after it. The CPU
+	// moves on to the next slot without waiting.
+	//
+
+	fence_val = end_frame(queue->frames);
+
+	// The next command list starts with its caches flushed.
+	reset_uav_hazards(&dx12->resource_states);
+
+	return record_queue_signal(&dx12->scheduler, queue->kind, fence_val);
+}
+
+void flush_command_batches(dx12_queue* queue) {
+	flush_frame_ring(queue->frames);
+}
+
+void append_resource_barriers(
+	dx12_handler* dx12,
+	std::vector<D3D12_RESOURCE_BARRIER>* barriers
+) {
+	std::vector<tracked_barrier> tracked;
+	D3D12_RESOURCE_BARRIER barrier;
+
+	collect_resource_barriers(&dx12->resource_states, &tracked);
+
+	for (const tracked_barrier& t : tracked) {
+		ID3D12Resource* resource = (ID3D12Resource*)t.resource;
+
+		if (t.kind == TRACKED_BARRIER_UAV) {
+			barrier = CD3DX12_RESOURCE_BARRIER::UAV(resource);
+		}
+		else {
+			barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+				resource,
+				(D3D12_RESOURCE_STATES)t.before,
+				(D3D12_RESOURCE_STATES)t.after,
+				t.subresource == ALL_TRACKED_SUBRESOURCES ? D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES : t.subresource
+			);
+
+			if (t.kind == TRACKED_BARRIER_BEGIN_ONLY) {
+				barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+			}
+			else if (t.kind == TRACKED_BARRIER_END_ONLY) {
+				barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+			}
+		}
+
+		barriers->push_back(barrier);
+	}
+}
+
+void record_resource_barriers(
+	dx12_handler* dx12,
+	ID3D12GraphicsCommandList* command_list
+) {
+	std::vector<D3D12_RESOURCE_BARRIER> barriers;
+
+	//
+	// Everything the tracker asked for goes into one call.
+	//
+
+	append_resource_barriers(dx12, &barriers);
+
+	if (!barriers.empty()) {
+		command_list->ResourceBarrier((UINT)barriers.size(), barriers.data());
+	}
+}
+
+dx12_queue* queue_for_kind(dx12_handler* dx12, const queue_kind kind) {
+	switch (kind) {
+	case QUEUE_COMPUTE:
+		return dx12->compute_queue;
+	case QUEUE_COPY:
+		return dx12->copy_queue;
+	default:
+		return dx12->direct_queue;
+	}
 }
 
 void shutdown_directx_12(dx12_handler* dx12) {
 	wait_for_previous_frame(dx12);
 	CloseHandle(dx12->fence_event);
+
+	shutdown_dx12_queue(dx12, dx12->direct_queue);
+
+	if (dx12->compute_queue != NULL) {
+		shutdown_dx12_queue(dx12, dx12->compute_queue);
+		shutdown_dx12_queue(dx12, dx12->copy_queue);
+	}
+
+	//
+	// Every placed resource has to be gone by now.
+	//
+
+	shutdown_gpu_memory(dx12->memory);
+	delete dx12->memory;
+	dx12->memory = NULL;
+
+	//
+	// The heaps go after the queues, since the direct queue's timeline
+	// points at the shader visible heap's allocator.
+	//
+
+	delete dx12->cbv_srv_uav_heap;
+	dx12->cbv_srv_uav_heap = NULL;
+
+	delete dx12->staging_heap;
+	dx12->staging_heap = NULL;
+}
+
+/* DX12_FENCE_TIMELINE IMPL */
+
+uint64_t dx12_fence_timeline::signal() {
+	UINT64 fence_val;
+	HRESULT result;
+
+	fence_val = fence_value;
+
+	//
+	// Signal and increment the fence value.
+	//
+
+	result = command_queue->Signal(fence.Get(), fence_val);
+	throw_if_failed(result);
+	fence_value++;
+
+	//
+	// Transient descriptors handed out since the last signal are in use
+	// until the GPU reaches this fence value.
+	//
+
+	if (transient_descriptors != NULL) {
+		end_transient_frame(transient_descriptors, fence_val);
+	}
+
+	if (uploads != NULL) {
+		end_upload_frame(uploads, fence_val);
+	}
+
+	return fence_val;
+}
+
+uint64_t dx12_fence_timeline::completed_value() {
+	return fence->GetCompletedValue();
+}
+
+void dx12_fence_timeline::wait_for(const uint64_t value) {
+	HRESULT result;
+
+	if (fence->GetCompletedValue() < value) {
+		result = fence->SetEventOnCompletion(value, fence_event);
+		throw_if_failed(result);
+		WaitForSingleObject(fence_event, INFINITE);
+	}
+
+	if (transient_descriptors != NULL) {
+		reclaim_transient_descriptors(
+			transient_descriptors,
+			fence->GetCompletedValue()
+		);
+	}
+
+	if (uploads != NULL) {
+		reclaim_upload_ring(uploads, fence->GetCompletedValue());
+	}
 }
 
 /* DESCRIPTOR_HEAP IMPL */
 unsigned int next_available_heap_index(descriptor_heap* heap) {
 	unsigned int result;
 
-	result = heap->curr_descriptor_index;
-	heap->curr_descriptor_index += 1;
+	result = allocate_persistent_descriptor(&heap->allocator);
+
+	//
+	// Out of persistent slots.
+	//
+
+	if (result == INVALID_DESCRIPTOR_INDEX) {
+		throw std::exception();
+	}
 
 	return result;
 }
 
+void free_heap_index(descriptor_heap* heap, const unsigned int index) {
+	free_persistent_descriptor(&heap->allocator, index);
+}
+
+unsigned int next_transient_heap_range(
+	descriptor_heap* heap,
+	const unsigned int count
+) {
+	descriptor_allocator* allocator;
+	unsigned int result;
+	uint64_t oldest;
+
+	allocator = &heap->allocator;
+	result = allocate_transient_descriptors(allocator, count);
+
+	if (result != INVALID_DESCRIPTOR_INDEX) {
+		return result;
+	}
+
+	//
+	// Full, and no fence to wait on.
+	//
+
+	if (heap->timeline == NULL) {
+		throw std::exception();
+	}
+
+	//
+	// Take back whatever the GPU is already done with. If that isn't
+	// enough, wait for the oldest frame still holding descriptors, and
+	// so on until the range fits.
+	//
+
+	reclaim_transient_descriptors(allocator, heap->timeline->completed_value());
+	result = allocate_transient_descriptors(allocator, count);
+
+	while (result == INVALID_DESCRIPTOR_INDEX) {
+		//
+		// Nothing left to wait for. The frame being recorded has the
+		// rest of the ring.
+		//
+
+		if (allocator->frame_marks.empty()) {
+			throw std::exception();
+		}
+
+		oldest = allocator->frame_marks.front().fence_value;
+
+		heap->timeline->wait_for(oldest);
+		reclaim_transient_descriptors(allocator, oldest);
+		result = allocate_transient_descriptors(allocator, count);
+	}
+
+	return result;
+}
+
+void copy_staged_descriptors(
+	dx12_handler* dx12,
+	const unsigned int staging_index,
+	const unsigned int dest_index,
+	const unsigned int count
+) {
+	descriptor_heap* staging;
+	descriptor_heap* dest;
+
+	staging = dx12->staging_heap;
+	dest = dx12->cbv_srv_uav_heap;
+
+	dx12->device->CopyDescriptorsSimple(
+		count,
+		heap_cpu_handle(dest, dest_index),
+		heap_cpu_handle(staging, staging_index),
+		dest->heap_type
+	);
+}
+
+unsigned int copy_staged_descriptors_to_transient(
+	dx12_handler* dx12,
+	const unsigned int staging_index,
+	const unsigned int count
+) {
+	unsigned int dest_index;
+
+	dest_index = next_transient_heap_range(dx12->cbv_srv_uav_heap, count);
+	copy_staged_descriptors(dx12, staging_index, dest_index, count);
+
+	return dest_index;
+}
+
 CD3DX12_CPU_DESCRIPTOR_HANDLE heap_cpu_handle(
 	descriptor_heap* heap,
 	const unsigned int index
@@ -8,55 +8,241 @@
 #pragma once
 
 #include "stdafx.h"
+#include "descriptor_allocator.h"
+#include "frame_ring.h"
+#include "queue_scheduler.h"
+#include "resource_state_tracker.h"
+#include "gpu_memory.h"
+#include "upload_ring.h"
+#include "device_set.h"
+#include <string>
+#include <vector>
+
+struct gpu_upload_ring;
+
+//
+// Sizes of the descriptor heaps. The shader visible heap is split into
+// persistent slots followed by a ring of per-frame transient slots.
+// The staging heap is CPU only and entirely persistent.
+//
+
+const unsigned int PERSISTENT_DESCRIPTOR_COUNT = 1000;
+const unsigned int TRANSIENT_DESCRIPTOR_COUNT = 1000;
+const unsigned int STAGING_DESCRIPTOR_COUNT = 1000;
+
+// How many command batches the CPU may record ahead of the GPU.
+const unsigned int DEFAULT_FRAMES_IN_FLIGHT = 3;
 
 struct descriptor_heap {
 	ComPtr<ID3D12DescriptorHeap> heap;
+	D3D12_DESCRIPTOR_HEAP_TYPE heap_type;
 	unsigned int descriptor_size;
 	unsigned int descriptor_count;
-	unsigned int curr_descriptor_index;
+	descriptor_allocator allocator;
+
+	// The fence transient descriptors are reclaimed against, so a full
+	// ring can wait for the GPU. NULL if the heap has no transient slots.
+	fence_timeline* timeline;
+};
+
+/*
+	A command queue and its fence as a fence_timeline, so the frame
+	ring can schedule against the real GPU.
+*/
+struct dx12_fence_timeline : fence_timeline {
+	ComPtr<ID3D12CommandQueue> command_queue;
+	ComPtr<ID3D12Fence> fence;
+	UINT64 fence_value;
+	HANDLE fence_event;
+
+	// Transient descriptors used by work on this queue. NULL if the
+	// queue never binds any (e.g. the copy queue).
+	descriptor_allocator* transient_descriptors;
+
+	// Upload ring used by work on this queue, or NULL.
+	upload_ring* uploads;
+
+	uint64_t signal() override;
+	uint64_t completed_value() override;
+	void wait_for(const uint64_t value) override;
+};
+
+/*
+	One command queue with its own fence and its own ring of command
+	allocators and lists, one pair per frame in flight. frames decides
+	which pair is being recorded and when it is safe to reset.
+*/
+struct dx12_queue {
+	queue_kind kind;
+	D3D12_COMMAND_LIST_TYPE type;
+	ComPtr<ID3D12CommandQueue> command_queue;
+
+	std::vector<ComPtr<ID3D12CommandAllocator>> command_allocators;
+	std::vector<ComPtr<ID3D12GraphicsCommandList>> command_lists;
+	dx12_fence_timeline* timeline;
+	frame_ring* frames;
+
+	// Input data and dispatch constants. NULL on the copy queue.
+	gpu_upload_ring* uploads;
 };
 
 struct dx12_handler {
 	ComPtr<ID3D12Device5> device;
-	ComPtr<ID3D12CommandQueue> command_queue;
-	ComPtr<ID3D12CommandAllocator> command_allocator;
-	ComPtr<ID3D12GraphicsCommandList> command_list;
+
+	// adapter_probe_key of the device's adapter. Empty if there is none.
+	std::string adapter_key;
+
+	// The adapter's PCI vendor and device IDs. 0 if there is none.
+	uint32_t vendor_id;
+	uint32_t device_id;
+
+	//
+	// The direct queue always exists. The compute and copy queues are
+	// only created when asked for, and are NULL otherwise. scheduler
+	// works out the cross-queue waits between them.
+	//
+
+	unsigned int frames_in_flight;
+	dx12_queue* direct_queue;
+	dx12_queue* compute_queue;
+	dx12_queue* copy_queue;
+	queue_scheduler scheduler;
+
+	// What state every tracked resource is in as of the last recorded
+	// command. Barriers it asks for are recorded by
+	// record_resource_barriers, and once more by submit_command_batch.
+	resource_state_tracker resource_states;
+
+	// Where buffers and readback buffers are placed.
+	gpu_memory* memory;
 
 	descriptor_heap* cbv_srv_uav_heap;
 
+	// Non-shader-visible. Descriptors are written here first and then
+	// copied into cbv_srv_uav_heap.
+	descriptor_heap* staging_heap;
+
 	//
 	// Synchronization fence objects.
 	//
 
 	UINT frame_index;
 	HANDLE fence_event;
-	ComPtr<ID3D12Fence> fence;
-	UINT64 fence_value;
 };
 
 /* DX12_HANDLER ROUTINES */
-void initialize_dx12_handler(dx12_handler* dx12);
+void initialize_dx12_handler(
+	dx12_handler* dx12,
+	const unsigned int frames_in_flight,
+	const bool async_queues,
+	const unsigned int adapter_index,
+	device_probe_cache* probes
+);
 void enable_dx12_debug_layer();
 ComPtr<IDXGIFactory4> create_dx12_factory();
+
+// Identifies an adapter and its driver to the probe cache.
+std::string adapter_probe_key(ComPtr<IDXGIAdapter1> adapter);
+
+/*
+	Every hardware adapter that can create a 12_1 device, most dedicated
+	video memory first. probes, which may be NULL, answers for adapters
+	it has seen and learns the rest.
+*/
+std::vector<ComPtr<IDXGIAdapter4>> get_usable_adapters(
+	ComPtr<IDXGIFactory4> factory,
+	device_probe_cache* probes
+);
+
+// The first usable adapter, or NULL.
 ComPtr<IDXGIAdapter4> get_valid_adapter(ComPtr<IDXGIFactory4> factory);
 ComPtr<ID3D12Device5> create_dx12_device(ComPtr<IDXGIAdapter4> adapter);
-ComPtr<ID3D12CommandQueue> create_command_queue(dx12_handler* dx12);
-ComPtr<ID3D12CommandAllocator> create_command_allocator(dx12_handler* dx12);
-ComPtr<ID3D12GraphicsCommandList> create_command_list(dx12_handler* dx12);
+ComPtr<ID3D12CommandQueue> create_command_queue(
+	dx12_handler* dx12,
+	const D3D12_COMMAND_LIST_TYPE type
+);
+ComPtr<ID3D12CommandAllocator> create_command_allocator(
+	dx12_handler* dx12,
+	const D3D12_COMMAND_LIST_TYPE type
+);
+ComPtr<ID3D12GraphicsCommandList> create_command_list(
+	dx12_handler* dx12,
+	ComPtr<ID3D12CommandAllocator> allocator,
+	const D3D12_COMMAND_LIST_TYPE type
+);
+dx12_queue* create_dx12_queue(
+	dx12_handler* dx12,
+	const queue_kind kind,
+	const D3D12_COMMAND_LIST_TYPE type
+);
+void shutdown_dx12_queue(dx12_handler* dx12, dx12_queue* queue);
 void initialize_descriptor_heap(
 	dx12_handler* dx12,
 	descriptor_heap* heap,
 	const D3D12_DESCRIPTOR_HEAP_TYPE heap_type,
-	const unsigned int num_descriptors,
+	const unsigned int num_persistent_descriptors,
+	const unsigned int num_transient_descriptors,
 	const D3D12_DESCRIPTOR_HEAP_FLAGS flags
 );
 ComPtr<ID3D12Fence> create_fence(ComPtr<ID3D12Device5> device);
 HANDLE create_fence_event();
 void wait_for_previous_frame(dx12_handler* dx12);
+ComPtr<ID3D12GraphicsCommandList> begin_command_batch(
+	dx12_queue* queue,
+	ID3D12PipelineState* initial_state
+);
+queue_ticket submit_command_batch(
+	dx12_handler* dx12,
+	dx12_queue* queue,
+	const queue_ticket* deps,
+	const unsigned int num_deps
+);
+
+/*
+	Like submit_command_batch, but the batch's list is followed by
+	extra_lists, closed already and of the queue's type, in the same
+	ExecuteCommandLists. Pending barriers go in the batch's list, so
+	they come before any of the extra lists.
+*/
+queue_ticket submit_command_batch_lists(
+	dx12_handler* dx12,
+	dx12_queue* queue,
+	ID3D12CommandList* const* extra_lists,
+	const unsigned int num_extra_lists,
+	const queue_ticket* deps,
+	const unsigned int num_deps
+);
+
+void flush_command_batches(dx12_queue* queue);
+void append_resource_barriers(
+	dx12_handler* dx12,
+	std::vector<D3D12_RESOURCE_BARRIER>* barriers
+);
+void record_resource_barriers(
+	dx12_handler* dx12,
+	ID3D12GraphicsCommandList* command_list
+);
+dx12_queue* queue_for_kind(dx12_handler* dx12, const queue_kind kind);
 void shutdown_directx_12(dx12_handler* dx12);
 
 /* DESCRIPTOR HEAP ROUTINES */
 unsigned int next_available_heap_index(descriptor_heap* heap);
+void free_heap_index(descriptor_heap* heap, const unsigned int index);
+unsigned int next_transient_heap_range(
+	descriptor_heap* heap,
+	const unsigned int count
+);
+void copy_staged_descriptors(
+	dx12_handler* dx12,
+	const unsigned int staging_index,
+	const unsigned int dest_index,
+	const unsigned int count
+);
+unsigned int copy_staged_descriptors_to_transient(
+	dx12_handler* dx12,
+	const unsigned int staging_index,
+	const unsigned int count
+);
 CD3DX12_CPU_DESCRIPTOR_HANDLE heap_cpu_handle(
 	descriptor_heap* heap,
 	const unsigned int index
@@ -0,0 +1,910 @@
+// Liam Wynn, 01/14/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "dxil_container.h"
+#include "embedded_shaders.h"
+#include "shader_permutations.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+//
+// Sizes of the parts of the formats this reads. PSV0's runtime info
+// and resource records grew over validator versions; the part says
+// how big its own are.
+//
+
+const size_t DXBC_HEADER_SIZE = 32;
+const size_t DXBC_PART_HEADER_SIZE = 8;
+const size_t DXIL_PROGRAM_HEADER_SIZE = 24;
+const size_t PSV_RUNTIME_INFO_0_SIZE = 24;
+const size_t PSV_RUNTIME_INFO_2_SIZE = 48;
+const size_t PSV_RESOURCE_BIND_INFO_0_SIZE = 16;
+const size_t PSV_RESOURCE_BIND_INFO_1_SIZE = 24;
+
+// PSVResourceType.
+enum psv_resource_type {
+	PSV_RESOURCE_SAMPLER = 1,
+	PSV_RESOURCE_CBV = 2,
+	PSV_RESOURCE_SRV_TYPED = 3,
+	PSV_RESOURCE_SRV_RAW = 4,
+	PSV_RESOURCE_SRV_STRUCTURED = 5,
+	PSV_RESOURCE_UAV_TYPED = 6,
+	PSV_RESOURCE_UAV_RAW = 7,
+	PSV_RESOURCE_UAV_STRUCTURED = 8,
+	PSV_RESOURCE_UAV_STRUCTURED_WITH_COUNTER = 9
+};
+
+// The one DXIL::ResourceKind that tells a typed buffer from a texture.
+const uint32_t DXIL_RESOURCE_KIND_TYPED_BUFFER = 10;
+
+const uint32_t PSV_UNBOUNDED = 0xFFFFFFFF;
+
+static uint32_t read_u32(const unsigned char* data) {
+	return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+string shader_model_name(const unsigned int model) {
+	return to_string(model >> 4) + "." + to_string(model & 0xF);
+}
+
+string compute_profile(const unsigned int model) {
+	return "cs_" + to_string(model >> 4) + "_" + to_string(model & 0xF);
+}
+
+unsigned int profile_shader_model(const string& profile) {
+	if (profile.size() != 6 || profile.compare(0, 3, "cs_") != 0 || profile[4] != '_'
+		|| profile[3] < '0' || profile[3] > '9' || profile[5] < '0' || profile[5] > '9') {
+		return 0;
+	}
+
+	return (unsigned int)(profile[3] - '0') << 4 | (unsigned int)(profile[5] - '0');
+}
+
+bool read_dxbc_parts(
+	const unsigned char* data,
+	const size_t size,
+	vector<dxbc_part>* parts,
+	string* error
+) {
+	uint64_t container_size;
+	uint32_t num_parts;
+
+	parts->clear();
+
+	if (data == NULL || size < DXBC_HEADER_SIZE || read_u32(data) != dxbc_fourcc("DXBC")) {
+		*error = "not a shader container";
+		return false;
+	}
+
+	//
+	// magic, 16 byte digest, version 1.0, size, part count, then an
+	// offset per part.
+	//
+
+	container_size = read_u32(data + 24);
+	num_parts = read_u32(data + 28);
+
+	if (data[20] != 1 || data[21] != 0 || container_size > size || container_size < DXBC_HEADER_SIZE) {
+		*error = "bad container header";
+		return false;
+	}
+
+	if (DXBC_HEADER_SIZE + (uint64_t)num_parts * 4 > container_size) {
+		*error = "the part offsets run past the container";
+		return false;
+	}
+
+	for (uint32_t i = 0; i < num_parts; i++) {
+		uint64_t offset = read_u32(data + DXBC_HEADER_SIZE + i * 4);
+		dxbc_part part;
+
+		if (offset + DXBC_PART_HEADER_SIZE > container_size
+			|| offset + DXBC_PART_HEADER_SIZE + read_u32(data + offset + 4) > container_size) {
+			*error = "a part runs past the container";
+			return false;
+		}
+
+		part.fourcc = read_u32(data + offset);
+		part.offset = (size_t)offset + DXBC_PART_HEADER_SIZE;
+		part.size = read_u32(data + offset + 4);
+
+		parts->push_back(part);
+	}
+
+	return true;
+}
+
+static const dxbc_part* find_part(const vector<dxbc_part>& parts, const char name[4]) {
+	for (const dxbc_part& part : parts) {
+		if (part.fourcc == dxbc_fourcc(name)) {
+			return &part;
+		}
+	}
+
+	return NULL;
+}
+
+bool is_dxil_container(const unsigned char* data, const size_t size) {
+	vector<dxbc_part> parts;
+	string error;
+
+	return read_dxbc_parts(data, size, &parts, &error) && find_part(parts, "DXIL") != NULL;
+}
+
+/*
+	Turns one PSV0 resource record into a binding. kind is
+	PSV_UNBOUNDED when the record is too old to have one.
+*/
+static bool psv_binding(
+	const uint32_t type,
+	const uint32_t space,
+	const uint32_t lower_bound,
+	const uint32_t upper_bound,
+	const uint32_t kind,
+	shader_binding* binding
+) {
+	const char* prefix;
+
+	switch (type) {
+	case PSV_RESOURCE_SAMPLER:
+		binding->kind = SHADER_BINDING_SAMPLER;
+		binding->shape = SHADER_RESOURCE_TEXTURE;
+		prefix = "s";
+		break;
+	case PSV_RESOURCE_CBV:
+		binding->kind = SHADER_BINDING_CBV;
+		binding->shape = SHADER_RESOURCE_BUFFER;
+		prefix = "b";
+		break;
+	case PSV_RESOURCE_SRV_TYPED:
+		binding->kind = SHADER_BINDING_SRV;
+		binding->shape = kind == DXIL_RESOURCE_KIND_TYPED_BUFFER ? SHADER_RESOURCE_TYPED_BUFFER : SHADER_RESOURCE_TEXTURE;
+		prefix = "t";
+		break;
+	case PSV_RESOURCE_SRV_RAW:
+	case PSV_RESOURCE_SRV_STRUCTURED:
+		binding->kind = SHADER_BINDING_SRV;
+		binding->shape = SHADER_RESOURCE_BUFFER;
+		prefix = "t";
+		break;
+	case PSV_RESOURCE_UAV_TYPED:
+		binding->kind = SHADER_BINDING_UAV;
+		binding->shape = kind == DXIL_RESOURCE_KIND_TYPED_BUFFER ? SHADER_RESOURCE_TYPED_BUFFER : SHADER_RESOURCE_TEXTURE;
+		prefix = "u";
+		break;
+	case PSV_RESOURCE_UAV_RAW:
+	case PSV_RESOURCE_UAV_STRUCTURED:
+		binding->kind = SHADER_BINDING_UAV;
+		binding->shape = SHADER_RESOURCE_BUFFER;
+		prefix = "u";
+		break;
+	case PSV_RESOURCE_UAV_STRUCTURED_WITH_COUNTER:
+		binding->kind = SHADER_BINDING_UAV;
+		binding->shape = SHADER_RESOURCE_COUNTER_BUFFER;
+		prefix = "u";
+		break;
+	default:
+		return false;
+	}
+
+	if (upper_bound != PSV_UNBOUNDED && upper_bound < lower_bound) {
+		return false;
+	}
+
+	binding->name = prefix + to_string(lower_bound) + (space != 0 ? "_space" + to_string(space) : "");
+	binding->shader_register = lower_bound;
+	binding->space = space;
+	binding->count = upper_bound == PSV_UNBOUNDED ? 0 : upper_bound - lower_bound + 1;
+
+	// PSV0 doesn't say. 0 makes it a root CBV.
+	binding->size_in_bytes = 0;
+
+	return true;
+}
+
+static bool read_psv(
+	const unsigned char* psv,
+	const size_t size,
+	dxil_shader_info* info,
+	string* error
+) {
+	uint64_t runtime_size;
+	uint64_t at;
+	uint32_t num_resources;
+	uint64_t record_size;
+
+	//
+	// Runtime info size, runtime info, resource count, then, if there
+	// are resources, the record size and the records.
+	//
+
+	if (size < 4) {
+		*error = "PSV0 is empty";
+		return false;
+	}
+
+	runtime_size = read_u32(psv);
+	at = 4 + runtime_size;
+
+	if (at + 4 > size) {
+		*error = "PSV0's runtime info runs past it";
+		return false;
+	}
+
+	if (runtime_size >= PSV_RUNTIME_INFO_0_SIZE) {
+		info->wave_lanes_min = read_u32(psv + 4 + 16);
+		info->wave_lanes_max = read_u32(psv + 4 + 20);
+	}
+
+	if (runtime_size >= PSV_RUNTIME_INFO_2_SIZE) {
+		info->reflection.group_size[0] = read_u32(psv + 4 + 36);
+		info->reflection.group_size[1] = read_u32(psv + 4 + 40);
+		info->reflection.group_size[2] = read_u32(psv + 4 + 44);
+
+		info->has_reflection = info->reflection.group_size[0] > 0
+			&& info->reflection.group_size[1] > 0
+			&& info->reflection.group_size[2] > 0;
+	}
+
+	num_resources = read_u32(psv + at);
+	at += 4;
+
+	if (num_resources == 0) {
+		return true;
+	}
+
+	if (at + 4 > size) {
+		*error = "PSV0's resource records run past it";
+		return false;
+	}
+
+	record_size = read_u32(psv + at);
+	at += 4;
+
+	if (record_size < PSV_RESOURCE_BIND_INFO_0_SIZE || at + record_size * num_resources > size) {
+		*error = "PSV0's resource records run past it";
+		return false;
+	}
+
+	for (uint32_t i = 0; i < num_resources; i++) {
+		const unsigned char* record = psv + at + i * record_size;
+		shader_binding binding;
+
+		if (!psv_binding(
+			read_u32(record),
+			read_u32(record + 4),
+			read_u32(record + 8),
+			read_u32(record + 12),
+			record_size >= PSV_RESOURCE_BIND_INFO_1_SIZE ? read_u32(record + 16) : PSV_UNBOUNDED,
+			&binding
+		)) {
+			*error = "PSV0 has a resource of an unknown type";
+			return false;
+		}
+
+		info->reflection.bindings.push_back(binding);
+	}
+
+	return true;
+}
+
+bool read_dxil_shader(
+	const unsigned char* data,
+	const size_t size,
+	dxil_shader_info* info,
+	string* error
+) {
+	vector<dxbc_part> parts;
+	const dxbc_part* program;
+	const dxbc_part* features;
+	const dxbc_part* psv;
+	uint32_t version;
+
+	info->shader_kind = 0;
+	info->shader_model = 0;
+	info->feature_flags = 0;
+	info->wave_lanes_min = 0;
+	info->wave_lanes_max = 0;
+	info->has_reflection = false;
+	info->reflection.group_size[0] = 0;
+	info->reflection.group_size[1] = 0;
+	info->reflection.group_size[2] = 0;
+	info->reflection.bindings.clear();
+
+	if (!read_dxbc_parts(data, size, &parts, error)) {
+		return false;
+	}
+
+	//
+	// The program header: (kind << 16) | (major << 4) | minor, its size,
+	// then the bitcode header, which starts with "DXIL".
+	//
+
+	program = find_part(parts, "DXIL");
+
+	if (program == NULL) {
+		*error = "no DXIL part; FXC bytecode?";
+		return false;
+	}
+
+	if (program->size < DXIL_PROGRAM_HEADER_SIZE || read_u32(data + program->offset + 8) != dxbc_fourcc("DXIL")) {
+		*error = "bad DXIL program header";
+		return false;
+	}
+
+	version = read_u32(data + program->offset);
+	info->shader_kind = version >> 16;
+	info->shader_model = version & 0xFF;
+
+	features = find_part(parts, "SFI0");
+
+	if (features != NULL && features->size >= 8) {
+		info->feature_flags = read_u32(data + features->offset) | (uint64_t)read_u32(data + features->offset + 4) << 32;
+	}
+
+	psv = find_part(parts, "PSV0");
+
+	if (psv != NULL && !read_psv(data + psv->offset, psv->size, info, error)) {
+		info->has_reflection = false;
+		info->reflection.bindings.clear();
+		return false;
+	}
+
+	return true;
+}
+
+string describe_shader_model_support(const shader_model_support* support) {
+	string text;
+
+	text = shader_model_name(support->highest_shader_model);
+
+	if (support->highest_shader_model < 0x60) {
+		return text + " (FXC only)";
+	}
+
+	if (support->wave_ops) {
+		text += ", wave ops (" + to_string(support->wave_lanes_min);
+
+		if (support->wave_lanes_max != support->wave_lanes_min) {
+			text += "-" + to_string(support->wave_lanes_max);
+		}
+
+		text += " lanes)";
+	}
+
+	if (support->int64_ops) {
+		text += ", 64-bit ints";
+	}
+
+	if (support->native_16bit_ops) {
+		text += ", native 16-bit";
+	}
+
+	return text;
+}
+
+bool can_run_dxil(
+	const shader_model_support* support,
+	const dxil_shader_info* info,
+	string* reason
+) {
+	if (info->shader_kind != DXIL_SHADER_KIND_COMPUTE) {
+		*reason = "not a compute shader";
+		return false;
+	}
+
+	if (info->shader_model > support->highest_shader_model) {
+		*reason = "needs shader model " + shader_model_name(info->shader_model)
+			+ ", the device has " + shader_model_name(support->highest_shader_model);
+		return false;
+	}
+
+	if ((info->feature_flags & DXIL_REQUIRES_WAVE_OPS) != 0 && !support->wave_ops) {
+		*reason = "needs wave ops";
+		return false;
+	}
+
+	if (info->wave_lanes_min > 0 && support->wave_ops
+		&& (support->wave_lanes_max < info->wave_lanes_min
+			|| (info->wave_lanes_max > 0 && support->wave_lanes_min > info->wave_lanes_max))) {
+		*reason = "needs waves of " + to_string(info->wave_lanes_min) + " to " + to_string(info->wave_lanes_max) + " lanes";
+		return false;
+	}
+
+	if ((info->feature_flags & DXIL_REQUIRES_INT64_OPS) != 0 && !support->int64_ops) {
+		*reason = "needs 64-bit integer ops";
+		return false;
+	}
+
+	if ((info->feature_flags & DXIL_REQUIRES_NATIVE_16BIT_OPS) != 0 && !support->native_16bit_ops) {
+		*reason = "needs native 16-bit ops";
+		return false;
+	}
+
+	return true;
+}
+
+/* CHECKING */
+
+static void put_u32(vector<unsigned char>* out, const uint32_t value) {
+	for (unsigned int i = 0; i < 4; i++) {
+		out->push_back((unsigned char)(value >> (i * 8)));
+	}
+}
+
+typedef vector<pair<uint32_t, vector<unsigned char>>> test_parts;
+
+// A container the way DXC lays one out, with an all-zero digest.
+static vector<unsigned char> write_dxbc_container(const test_parts& parts) {
+	vector<unsigned char> out;
+	uint32_t offset;
+
+	put_u32(&out, dxbc_fourcc("DXBC"));
+	out.insert(out.end(), 16, 0);
+	out.push_back(1);
+	out.push_back(0);
+	out.push_back(0);
+	out.push_back(0);
+	put_u32(&out, 0);
+	put_u32(&out, (uint32_t)parts.size());
+
+	offset = (uint32_t)(DXBC_HEADER_SIZE + parts.size() * 4);
+
+	for (const pair<uint32_t, vector<unsigned char>>& part : parts) {
+		put_u32(&out, offset);
+		offset += (uint32_t)(DXBC_PART_HEADER_SIZE + part.second.size());
+	}
+
+	for (const pair<uint32_t, vector<unsigned char>>& part : parts) {
+		put_u32(&out, part.first);
+		put_u32(&out, (uint32_t)part.second.size());
+		out.insert(out.end(), part.second.begin(), part.second.end());
+	}
+
+	out[24] = (unsigned char)out.size();
+	out[25] = (unsigned char)(out.size() >> 8);
+	out[26] = (unsigned char)(out.size() >> 16);
+	out[27] = (unsigned char)(out.size() >> 24);
+
+	// So that a read past the end is one past the allocation, too.
+	out.shrink_to_fit();
+
+	return out;
+}
+
+static vector<unsigned char> test_program(const unsigned int kind, const unsigned int model) {
+	vector<unsigned char> program;
+
+	put_u32(&program, kind << 16 | model);
+	put_u32(&program, 7);
+	put_u32(&program, dxbc_fourcc("DXIL"));
+	put_u32(&program, 0x100 | model);
+	put_u32(&program, 16);
+	put_u32(&program, 4);
+
+	// Bitcode magic.
+	program.push_back('B');
+	program.push_back('C');
+	program.push_back(0xC0);
+	program.push_back(0xDE);
+
+	return program;
+}
+
+static vector<unsigned char> test_features(const uint64_t flags) {
+	vector<unsigned char> features;
+
+	put_u32(&features, (uint32_t)flags);
+	put_u32(&features, (uint32_t)(flags >> 32));
+
+	return features;
+}
+
+/*
+	runtime_size 24 is the oldest PSV0 (no numthreads), 52 a current
+	one. resources are type, space, lower and upper bound, and kind,
+	which is left out when record_size is 16.
+*/
+static vector<unsigned char> test_psv(
+	const uint32_t runtime_size,
+	const uint32_t group_size[3],
+	const uint32_t wave_lanes_min,
+	const uint32_t wave_lanes_max,
+	const uint32_t record_size,
+	const vector<vector<uint32_t>>& resources
+) {
+	vector<unsigned char> psv;
+	vector<unsigned char> runtime(runtime_size, 0);
+
+	for (unsigned int i = 0; i < 4; i++) {
+		runtime[16 + i] = (unsigned char)(wave_lanes_min >> (i * 8));
+		runtime[20 + i] = (unsigned char)(wave_lanes_max >> (i * 8));
+
+		if (runtime_size >= PSV_RUNTIME_INFO_2_SIZE) {
+			runtime[36 + i] = (unsigned char)(group_size[0] >> (i * 8));
+			runtime[40 + i] = (unsigned char)(group_size[1] >> (i * 8));
+			runtime[44 + i] = (unsigned char)(group_size[2] >> (i * 8));
+		}
+	}
+
+	// The shader stage, in PSVRuntimeInfo1.
+	if (runtime_size > 24) {
+		runtime[24] = DXIL_SHADER_KIND_COMPUTE;
+	}
+
+	put_u32(&psv, runtime_size);
+	psv.insert(psv.end(), runtime.begin(), runtime.end());
+	put_u32(&psv, (uint32_t)resources.size());
+
+	if (!resources.empty()) {
+		put_u32(&psv, record_size);
+
+		for (const vector<uint32_t>& resource : resources) {
+			for (unsigned int i = 0; i < record_size / 4; i++) {
+				put_u32(&psv, i < resource.size() ? resource[i] : 0);
+			}
+		}
+	}
+
+	return psv;
+}
+
+struct expected_kernel {
+	const char* source_path;
+	unsigned int group_size[3];
+	shader_binding_kind kind;
+	shader_resource_shape shape;
+};
+
+bool verify_dxil_compile_path(FILE* out) {
+	const uint32_t group_size[3] = { 256, 1, 1 };
+	const expected_kernel expected[] = {
+		{ "./hello_compute.hlsl", { 8, 8, 1 }, SHADER_BINDING_UAV, SHADER_RESOURCE_TEXTURE },
+		{ "./wave_reduce.hlsl", { 256, 1, 1 }, SHADER_BINDING_UAV, SHADER_RESOURCE_BUFFER }
+	};
+	vector<unsigned char> container;
+	dxil_shader_info info;
+	root_layout layout;
+	shader_model_support support;
+	string error;
+	string dxc;
+	unsigned int problems;
+
+	problems = 0;
+
+	auto report = [&](const string& what) {
+		if (out != NULL && problems < 10) {
+			fprintf(out, "  %s\n", what.c_str());
+		}
+
+		problems++;
+	};
+
+	//
+	// A 6.2 kernel that uses wave ops and 16-bit types, with one of
+	// each kind of binding.
+	//
+
+	container = write_dxbc_container({
+		{ dxbc_fourcc("SFI0"), test_features(DXIL_REQUIRES_WAVE_OPS | DXIL_REQUIRES_NATIVE_16BIT_OPS) },
+		{ dxbc_fourcc("PSV0"), test_psv(52, group_size, 32, 64, 24, {
+			{ PSV_RESOURCE_UAV_RAW, 0, 0, 0, 11 },
+			{ PSV_RESOURCE_CBV, 0, 0, 0, 13 },
+			{ PSV_RESOURCE_SRV_TYPED, 2, 1, 1, 2 },
+			{ PSV_RESOURCE_UAV_TYPED, 0, 3, 3, DXIL_RESOURCE_KIND_TYPED_BUFFER },
+			{ PSV_RESOURCE_SRV_STRUCTURED, 1, 0, PSV_UNBOUNDED, 12 },
+			{ PSV_RESOURCE_UAV_STRUCTURED_WITH_COUNTER, 0, 4, 5, 12 }
+		}) },
+		{ dxbc_fourcc("DXIL"), test_program(DXIL_SHADER_KIND_COMPUTE, 0x62) }
+	});
+
+	if (!is_dxil_container(container.data(), container.size()) || !read_dxil_shader(container.data(), container.size(), &info, &error)) {
+		report("a good container didn't read: " + error);
+	}
+	else {
+		const vector<shader_binding>& b = info.reflection.bindings;
+
+		if (info.shader_kind != DXIL_SHADER_KIND_COMPUTE || info.shader_model != 0x62
+			|| info.feature_flags != (DXIL_REQUIRES_WAVE_OPS | DXIL_REQUIRES_NATIVE_16BIT_OPS)
+			|| info.wave_lanes_min != 32 || info.wave_lanes_max != 64) {
+			report("the program header, SFI0 or wave sizes read wrong");
+		}
+
+		if (!info.has_reflection || info.reflection.group_size[0] != 256 || info.reflection.group_size[1] != 1 || info.reflection.group_size[2] != 1) {
+			report("numthreads read wrong");
+		}
+
+		if (b.size() != 6
+			|| b[0].kind != SHADER_BINDING_UAV || b[0].shape != SHADER_RESOURCE_BUFFER || b[0].name != "u0" || b[0].count != 1
+			|| b[1].kind != SHADER_BINDING_CBV || b[1].size_in_bytes != 0
+			|| b[2].kind != SHADER_BINDING_SRV || b[2].shape != SHADER_RESOURCE_TEXTURE || b[2].space != 2 || b[2].shader_register != 1 || b[2].name != "t1_space2"
+			|| b[3].kind != SHADER_BINDING_UAV || b[3].shape != SHADER_RESOURCE_TYPED_BUFFER
+			|| b[4].shape != SHADER_RESOURCE_BUFFER || b[4].count != 0
+			|| b[5].shape != SHADER_RESOURCE_COUNTER_BUFFER || b[5].count != 2) {
+			report("the bindings read wrong");
+		}
+
+		if (!build_root_layout(&info.reflection, &layout)) {
+			report("the bindings don't make a root layout");
+		}
+
+		if (parse_shader_reflection(write_shader_reflection(&info.reflection), &info.reflection) == false) {
+			report("the bindings don't survive the text format");
+		}
+	}
+
+	//
+	// Cut anywhere, it doesn't read, and doesn't read past the cut.
+	//
+
+	for (size_t cut = 0; cut < container.size(); cut++) {
+		vector<unsigned char> truncated(container.begin(), container.begin() + cut);
+
+		if (read_dxil_shader(truncated.data(), truncated.size(), &info, &error)) {
+			report("a container cut at " + to_string(cut) + " bytes read");
+			break;
+		}
+	}
+
+	//
+	// Parts and records that point past the end are refused, even when
+	// the container's own size is right.
+	//
+
+	{
+		vector<unsigned char> bad = container;
+
+		bad[DXBC_HEADER_SIZE + 4 + 3] = 0x10;
+
+		if (read_dxil_shader(bad.data(), bad.size(), &info, &error)) {
+			report("a part offset past the end read");
+		}
+
+		bad = write_dxbc_container({
+			{ dxbc_fourcc("DXIL"), test_program(DXIL_SHADER_KIND_COMPUTE, 0x60) },
+			{ dxbc_fourcc("PSV0"), test_psv(52, group_size, 0, 0, 24, { { PSV_RESOURCE_UAV_RAW, 0, 0, 0, 11 } }) }
+		});
+
+		// The PSV0 resource count, before the record size and the one record.
+		bad[bad.size() - 24 - 4 - 4] = 0x40;
+
+		if (read_dxil_shader(bad.data(), bad.size(), &info, &error)) {
+			report("more resource records than PSV0 holds read");
+		}
+
+		bad = write_dxbc_container({
+			{ dxbc_fourcc("PSV0"), test_psv(52, group_size, 0, 0, 24, { { 77, 0, 0, 0, 0 } }) },
+			{ dxbc_fourcc("DXIL"), test_program(DXIL_SHADER_KIND_COMPUTE, 0x60) }
+		});
+
+		if (read_dxil_shader(bad.data(), bad.size(), &info, &error)) {
+			report("a resource of an unknown type read");
+		}
+	}
+
+	//
+	// The oldest PSV0 has no numthreads and no resource kinds: it reads,
+	// but without reflection, and typed resources are taken to be
+	// textures. FXC's bytecode isn't DXIL.
+	//
+
+	container = write_dxbc_container({
+		{ dxbc_fourcc("DXIL"), test_program(DXIL_SHADER_KIND_COMPUTE, 0x60) },
+		{ dxbc_fourcc("PSV0"), test_psv(24, group_size, 0, 0, 16, { { PSV_RESOURCE_UAV_TYPED, 0, 0, 0 } }) }
+	});
+
+	if (!read_dxil_shader(container.data(), container.size(), &info, &error) || info.has_reflection
+		|| info.reflection.bindings.size() != 1 || info.reflection.bindings[0].shape != SHADER_RESOURCE_TEXTURE) {
+		report("an old PSV0 read wrong");
+	}
+
+	container = write_dxbc_container({ { dxbc_fourcc("RDEF"), { 0, 0, 0, 0 } }, { dxbc_fourcc("SHEX"), { 0, 0, 0, 0 } } });
+
+	if (is_dxil_container(container.data(), container.size()) || read_dxil_shader(container.data(), container.size(), &info, &error)) {
+		report("FXC's bytecode was taken for DXIL");
+	}
+
+	if (compute_profile(0x62) != "cs_6_2" || profile_shader_model("cs_6_6") != 0x66 || profile_shader_model("cs_5_1") != 0x51
+		|| profile_shader_model("ps_6_0") != 0 || profile_shader_model("cs_6") != 0) {
+		report("profiles and shader models don't convert");
+	}
+
+	//
+	// What runs where.
+	//
+
+	info.shader_kind = DXIL_SHADER_KIND_COMPUTE;
+	info.shader_model = 0x62;
+	info.feature_flags = DXIL_REQUIRES_WAVE_OPS;
+	info.wave_lanes_min = 0;
+	info.wave_lanes_max = 0;
+
+	support = { 0x66, true, 32, 32, false, false };
+
+	if (!can_run_dxil(&support, &info, &error)) {
+		report("a device with everything couldn't run a wave kernel");
+	}
+
+	info.feature_flags |= DXIL_REQUIRES_NATIVE_16BIT_OPS;
+
+	if (can_run_dxil(&support, &info, &error)) {
+		report("a device without 16-bit ops could run a 16-bit kernel");
+	}
+
+	info.feature_flags = 0;
+	info.wave_lanes_min = 64;
+	info.wave_lanes_max = 64;
+
+	if (can_run_dxil(&support, &info, &error)) {
+		report("a 32 lane device could run a 64 lane kernel");
+	}
+
+	info.wave_lanes_min = 0;
+	info.wave_lanes_max = 0;
+	support.highest_shader_model = 0x60;
+
+	if (can_run_dxil(&support, &info, &error)) {
+		report("a 6.0 device could run a 6.2 kernel");
+	}
+
+	support.highest_shader_model = 0x51;
+	info.shader_model = 0x60;
+
+	if (can_run_dxil(&support, &info, &error)) {
+		report("an FXC only device could run DXIL");
+	}
+
+	//
+	// The DXIL built into the binary, if the build had dxc.
+	//
+
+	for (unsigned int i = 0; i < NUM_EMBEDDED_SHADERS; i++) {
+		const embedded_shader* shader = &EMBEDDED_SHADERS[i];
+
+		if (shader->data == NULL) {
+			continue;
+		}
+
+		if (!read_dxil_shader(shader->data, shader->size, &info, &error)
+			|| info.shader_model != profile_shader_model(shader->profile) || !info.has_reflection) {
+			report(string("the embedded ") + shader->source_path + " " + shader->profile + " doesn't read back: " + error);
+		}
+	}
+
+	//
+	// Real DXIL, where dxc is there to make it.
+	//
+
+	if (!find_dxc_executable(&dxc)) {
+		if (out != NULL) {
+			fprintf(out, "  dxc isn't on the PATH, not compiling the embedded shaders.\n");
+		}
+	}
+	else {
+		dxc_command_compiler compiler;
+
+		initialize_dxc_command_compiler(&compiler, dxc, (fs::temp_directory_path() / "hello_dxil").string());
+
+		for (unsigned int i = 0; i < NUM_EMBEDDED_SHADERS; i++) {
+			const embedded_shader* shader = &EMBEDDED_SHADERS[i];
+			permutation_set set;
+			vector<unsigned char> bytecode;
+			string compile_error;
+
+			initialize_permutation_set(&set, shader->source_path, shader->entry_point, shader->profile);
+			compiler.arguments = embedded_shader_arguments(shader);
+
+			if (!compiler.compile(&set, embedded_shader_defines(shader), &bytecode, &compile_error)) {
+				report(string(shader->source_path) + " " + shader->profile + ": " + compile_error);
+				continue;
+			}
+
+			if (!read_dxil_shader(bytecode.data(), bytecode.size(), &info, &error)) {
+				report(string(shader->source_path) + " " + shader->profile + " doesn't read: " + error);
+				continue;
+			}
+
+			if (info.shader_kind != DXIL_SHADER_KIND_COMPUTE || info.shader_model != profile_shader_model(shader->profile)) {
+				report(string(shader->source_path) + " came out as the wrong kind or model");
+			}
+
+			if (strstr(shader->source_path, "wave") != NULL && (info.feature_flags & DXIL_REQUIRES_WAVE_OPS) == 0) {
+				report(string(shader->source_path) + " doesn't say it needs wave ops");
+			}
+
+			if (strstr(shader->defines, "HALF_PRECISION") != NULL && (info.feature_flags & DXIL_REQUIRES_NATIVE_16BIT_OPS) == 0) {
+				report(string(shader->source_path) + " " + shader->defines + " doesn't say it needs 16-bit ops");
+			}
+
+			for (const expected_kernel& e : expected) {
+				if (strcmp(e.source_path, shader->source_path) != 0) {
+					continue;
+				}
+
+				if (!info.has_reflection
+					|| memcmp(info.reflection.group_size, e.group_size, sizeof(e.group_size)) != 0
+					|| info.reflection.bindings.empty()
+					|| info.reflection.bindings[0].kind != e.kind
+					|| info.reflection.bindings[0].shape != e.shape
+					|| !build_root_layout(&info.reflection, &layout)) {
+					report(string(shader->source_path) + " " + shader->profile + "'s numthreads or u0 read wrong");
+				}
+			}
+		}
+	}
+
+	if (out != NULL) {
+		fprintf(out, "DXIL compile path: %s\n", problems == 0 ? "all correct" : (to_string(problems) + " problem(s)").c_str());
+	}
+
+	return problems == 0;
+}
+
+void benchmark_dxil_compile_path(FILE* out) {
+	const unsigned int num_reads = 100000;
+	const uint32_t group_size[3] = { 8, 8, 1 };
+	vector<unsigned char> container;
+	dxil_shader_info info;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+	unsigned int bindings;
+	string error;
+	string dxc;
+
+	container = write_dxbc_container({
+		{ dxbc_fourcc("SFI0"), test_features(0) },
+		{ dxbc_fourcc("PSV0"), test_psv(52, group_size, 0, 0, 24, { { PSV_RESOURCE_UAV_TYPED, 0, 0, 0, 2 }, { PSV_RESOURCE_CBV, 0, 0, 0, 13 } }) },
+		{ dxbc_fourcc("DXIL"), test_program(DXIL_SHADER_KIND_COMPUTE, 0x60) }
+	});
+
+	bindings = 0;
+	start = chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < num_reads; i++) {
+		read_dxil_shader(container.data(), container.size(), &info, &error);
+		bindings += (unsigned int)info.reflection.bindings.size();
+	}
+
+	elapsed = chrono::steady_clock::now() - start;
+
+	fprintf(out, "  reading a container: %.3f us (%u bindings)\n", elapsed.count() * 1.0e6 / num_reads, bindings / num_reads);
+
+	if (!find_dxc_executable(&dxc)) {
+		fprintf(out, "  dxc isn't on the PATH, skipping the compile times.\n");
+		return;
+	}
+
+	{
+		dxc_command_compiler compiler;
+
+		initialize_dxc_command_compiler(&compiler, dxc, (fs::temp_directory_path() / "hello_dxil").string());
+
+		for (unsigned int i = 0; i < NUM_EMBEDDED_SHADERS; i++) {
+			const embedded_shader* shader = &EMBEDDED_SHADERS[i];
+			permutation_set set;
+			vector<unsigned char> bytecode;
+
+			initialize_permutation_set(&set, shader->source_path, shader->entry_point, shader->profile);
+			compiler.arguments = embedded_shader_arguments(shader);
+			error.clear();
+
+			start = chrono::steady_clock::now();
+			compiler.compile(&set, embedded_shader_defines(shader), &bytecode, &error);
+			elapsed = chrono::steady_clock::now() - start;
+
+			fprintf(
+				out,
+				"  dxc %s %s %s: %.1f ms, %u bytes%s\n",
+				shader->source_path,
+				shader->profile,
+				shader->defines,
+				elapsed.count() * 1000.0,
+				(unsigned int)bytecode.size(),
+				error.empty() ? "" : " (failed)"
+			);
+		}
+	}
+}
@@ -0,0 +1,147 @@
+// Liam Wynn, 01/14/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	DXC writes shader model 6 bytecode in the same container FXC uses
+	(a "DXBC" header, then a list of four character parts), with a DXIL
+	part of LLVM bitcode where FXC has SHEX. This reads what the
+	application needs out of one, without DXC or D3D12:
+
+	- the shader kind and model, from the DXIL part's program header,
+	- the optional features the shader uses (wave ops, native 16-bit
+	  types, 64-bit integers...), from the SFI0 part, and
+	- numthreads and the resource bindings, from the PSV0 part, the
+	  pipeline state validation data the runtime reads itself.
+
+	The last one stands in for reflection, which D3DReflect can't do on
+	DXIL. PSV0 has no names or constant buffer sizes, so bindings are
+	named after their registers ("u0", "b1_space2") and constant
+	buffers have a size of 0, which build_root_layout makes root CBVs.
+	numthreads is only there from validator 1.6 on; older DXIL reads
+	without reflection.
+
+	can_run_dxil checks what a shader needs against what a device has
+	(gpu_dxil asks the device, through CheckFeatureSupport), so the
+	application can build the kernel with FXC instead when the device
+	can't take the DXIL.
+
+	Nothing here depends on Windows.
+*/
+
+#pragma once
+
+#include "shader_layout.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// A four character part name, as it is stored.
+inline uint32_t dxbc_fourcc(const char name[4]) {
+	return (uint32_t)(unsigned char)name[0]
+		| (uint32_t)(unsigned char)name[1] << 8
+		| (uint32_t)(unsigned char)name[2] << 16
+		| (uint32_t)(unsigned char)name[3] << 24;
+}
+
+// The optional features in SFI0 that decide where a shader can run.
+// Same values as D3D_SHADER_REQUIRES_*.
+const uint64_t DXIL_REQUIRES_WAVE_OPS = 0x4000;
+const uint64_t DXIL_REQUIRES_INT64_OPS = 0x8000;
+const uint64_t DXIL_REQUIRES_NATIVE_16BIT_OPS = 0x40000;
+
+const unsigned int DXIL_SHADER_KIND_COMPUTE = 5;
+
+/*
+	Shader models are packed like D3D_SHADER_MODEL: 0x51 is 5.1, 0x62
+	is 6.2.
+*/
+std::string shader_model_name(const unsigned int model);
+
+// e.g. "cs_6_2".
+std::string compute_profile(const unsigned int model);
+
+// The model a profile like "cs_6_2" asks for. 0 if it isn't one.
+unsigned int profile_shader_model(const std::string& profile);
+
+struct dxbc_part {
+	uint32_t fourcc;
+
+	// Of the part's data, past its header, in the container.
+	size_t offset;
+	size_t size;
+};
+
+/*
+	The parts of the container in data. Returns false, with why in
+	error, if it isn't one or anything in it points outside it.
+*/
+bool read_dxbc_parts(
+	const unsigned char* data,
+	const size_t size,
+	std::vector<dxbc_part>* parts,
+	std::string* error
+);
+
+// A container with a DXIL part. FXC's bytecode has none.
+bool is_dxil_container(const unsigned char* data, const size_t size);
+
+struct dxil_shader_info {
+	unsigned int shader_kind;
+	unsigned int shader_model;
+	uint64_t feature_flags;
+
+	// The wave sizes the shader was written for. 0 if any will do.
+	unsigned int wave_lanes_min;
+	unsigned int wave_lanes_max;
+
+	// Whether PSV0 was new enough to have numthreads.
+	bool has_reflection;
+	shader_reflection reflection;
+};
+
+bool read_dxil_shader(
+	const unsigned char* data,
+	const size_t size,
+	dxil_shader_info* info,
+	std::string* error
+);
+
+/*
+	What a device can run. highest_shader_model is 0x51 when it only
+	takes FXC's bytecode.
+*/
+struct shader_model_support {
+	unsigned int highest_shader_model;
+	bool wave_ops;
+	unsigned int wave_lanes_min;
+	unsigned int wave_lanes_max;
+	bool int64_ops;
+	bool native_16bit_ops;
+};
+
+// e.g. "6.6, wave ops (32 lanes), 64-bit ints, native 16-bit".
+std::string describe_shader_model_support(const shader_model_support* support);
+
+// Returns false, with why in reason, if support can't run info.
+bool can_run_dxil(
+	const shader_model_support* support,
+	const dxil_shader_info* info,
+	std::string* reason
+);
+
+/*
+	Checks the reader on containers built here: every field, every
+	truncation, parts that point outside the container, old PSV0
+	layouts, and can_run_dxil. Then, if dxc is on the PATH, compiles
+	every embedded shader with it (see embedded_shaders.h) and checks
+	what it reads back against what the shader asked for, and checks
+	the DXIL embedded in the binary if there is any. Problems go to
+	out, which may be NULL. Returns false if there were any.
+*/
+bool verify_dxil_compile_path(FILE* out);
+
+/*
+	Times reading containers and, if dxc
+	is on the PATH, compiling the embedded shaders with it.
+*/
+void benchmark_dxil_compile_path(FILE* out);
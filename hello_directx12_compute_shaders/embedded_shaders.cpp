@@ -0,0 +1,78 @@
+// Liam Wynn, 01/14/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "embedded_shaders.h"
+#include <sstream>
+
+using namespace std;
+
+//
+// Written by dxc -Fh at build time, into the intermediate directory.
+//
+
+#if defined(HAVE_EMBEDDED_DXIL)
+#include "hello_compute_main_cs_6_0.h"
+#include "wave_reduce_main_cs_6_0.h"
+#include "wave_reduce_half_cs_6_2.h"
+
+#define EMBEDDED_DXIL(name) name, sizeof(name)
+#else
+#define EMBEDDED_DXIL(name) NULL, 0
+#endif
+
+const embedded_shader EMBEDDED_SHADERS[] = {
+	{ "./hello_compute.hlsl", "main", "cs_6_0", "", "", EMBEDDED_DXIL(hello_compute_main_cs_6_0) },
+	{ "./wave_reduce.hlsl", "main", "cs_6_0", "", "", EMBEDDED_DXIL(wave_reduce_main_cs_6_0) },
+	{ "./wave_reduce.hlsl", "main", "cs_6_2", "HALF_PRECISION=1", "-enable-16bit-types", EMBEDDED_DXIL(wave_reduce_half_cs_6_2) }
+};
+
+const unsigned int NUM_EMBEDDED_SHADERS = sizeof(EMBEDDED_SHADERS) / sizeof(EMBEDDED_SHADERS[0]);
+
+shader_defines embedded_shader_defines(const embedded_shader* shader) {
+	istringstream words(shader->defines);
+	shader_defines defines;
+	string word;
+
+	while (words >> word) {
+		size_t equals = word.find('=');
+
+		if (equals == string::npos) {
+			defines.push_back(make_pair(word, string("1")));
+		}
+		else {
+			defines.push_back(make_pair(word.substr(0, equals), word.substr(equals + 1)));
+		}
+	}
+
+	return defines;
+}
+
+vector<string> embedded_shader_arguments(const embedded_shader* shader) {
+	istringstream words(shader->arguments);
+	vector<string> arguments;
+	string word;
+
+	while (words >> word) {
+		arguments.push_back(word);
+	}
+
+	return arguments;
+}
+
+const embedded_shader* find_embedded_shader(
+	const string& source_path,
+	const string& entry_point,
+	const shader_defines& defines
+) {
+	for (unsigned int i = 0; i < NUM_EMBEDDED_SHADERS; i++) {
+		const embedded_shader* shader = &EMBEDDED_SHADERS[i];
+
+		if (shader->data != NULL
+			&& source_path == shader->source_path
+			&& entry_point == shader->entry_point
+			&& defines == embedded_shader_defines(shader)) {
+			return shader;
+		}
+	}
+
+	return NULL;
+}
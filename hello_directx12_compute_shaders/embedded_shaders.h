@@ -0,0 +1,57 @@
+// Liam Wynn, 01/14/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	Kernels whose DXIL is compiled at build time and built into the
+	binary, so a run never compiles them.
+
+	The build runs dxc on each one (see the DxilKernel items in the
+	project) with -Fh, which writes the DXIL as a byte array in a
+	header, and defines HAVE_EMBEDDED_DXIL. Without dxc the build still
+	works: the table is there, but with no data, and the kernels are
+	compiled with FXC at run time like every other one. The table and
+	the DxilKernel items have to list the same kernels.
+
+	dxc signs the DXIL when it finds dxil.dll next to it, as it does in
+	the Windows SDK. D3D12 refuses unsigned DXIL.
+
+	Nothing here depends on Windows.
+*/
+
+#pragma once
+
+#include "shader_cache.h"
+#include <cstddef>
+
+struct embedded_shader {
+	const char* source_path;
+	const char* entry_point;
+	const char* profile;
+
+	// What it was built with, as "NAME=VALUE NAME=VALUE".
+	const char* defines;
+
+	// Arguments to dxc besides the profile, entry point and defines.
+	const char* arguments;
+
+	// NULL when the build didn't have dxc.
+	const unsigned char* data;
+	size_t size;
+};
+
+extern const embedded_shader EMBEDDED_SHADERS[];
+extern const unsigned int NUM_EMBEDDED_SHADERS;
+
+shader_defines embedded_shader_defines(const embedded_shader* shader);
+
+// Splits arguments on spaces.
+std::vector<std::string> embedded_shader_arguments(const embedded_shader* shader);
+
+/*
+	The embedded build of source_path's entry_point with exactly
+	defines, or NULL if there isn't one or it has no data.
+*/
+const embedded_shader* find_embedded_shader(
+	const std::string& source_path,
+	const std::string& entry_point,
+	const shader_defines& defines
+);
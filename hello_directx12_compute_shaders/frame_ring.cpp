@@ -0,0 +1,144 @@
+// Liam Wynn, 12/12/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "frame_ring.h"
+
+using namespace std;
+
+/* MOCK_FENCE_TIMELINE IMPL */
+
+mock_fence_timeline::mock_fence_timeline() {
+	last_signaled = 0;
+	last_completed = 0;
+	blocking_waits = 0;
+}
+
+uint64_t mock_fence_timeline::signal() {
+	last_signaled++;
+	return last_signaled;
+}
+
+uint64_t mock_fence_timeline::completed_value() {
+	return last_completed;
+}
+
+void mock_fence_timeline::wait_for(const uint64_t value) {
+	if (last_completed >= value) {
+		return;
+	}
+
+	blocking_waits++;
+	complete_up_to(value);
+}
+
+void mock_fence_timeline::complete_up_to(const uint64_t value) {
+	if (value > last_signaled) {
+		last_completed = last_signaled;
+		return;
+	}
+
+	if (value > last_completed) {
+		last_completed = value;
+	}
+}
+
+/* FRAME_RING IMPL */
+
+void initialize_frame_ring(
+	frame_ring* ring,
+	fence_timeline* timeline,
+	const unsigned int depth
+) {
+	ring->timeline = timeline;
+	ring->depth = depth == 0 ? 1 : depth;
+	ring->current = 0;
+	ring->recording = false;
+	ring->slot_fences.assign(ring->depth, 0);
+
+	ring->batches = 0;
+	ring->blocking_begins = 0;
+	ring->cpu_wait = chrono::steady_clock::duration::zero();
+}
+
+unsigned int begin_frame(frame_ring* ring) {
+	uint64_t slot_fence;
+	chrono::steady_clock::time_point start;
+
+	start = chrono::steady_clock::now();
+
+	if (ring->batches == 0) {
+		ring->first_begin = start;
+	}
+
+	//
+	// The slot is free once the GPU has passed the fence of the last
+	// batch recorded with it. Only wait if it hasn't.
+	//
+
+	slot_fence = ring->slot_fences[ring->current];
+
+	if (slot_fence != 0 && ring->timeline->completed_value() < slot_fence) {
+		ring->timeline->wait_for(slot_fence);
+		ring->blocking_begins++;
+		ring->cpu_wait += chrono::steady_clock::now() - start;
+	}
+
+	ring->recording = true;
+
+	return ring->current;
+}
+
+uint64_t end_frame(frame_ring* ring) {
+	uint64_t fence_value;
+
+	fence_value = ring->timeline->signal();
+
+	ring->slot_fences[ring->current] = fence_value;
+	ring->current = (ring->current + 1) % ring->depth;
+	ring->recording = false;
+	ring->batches++;
+	ring->last_end = chrono::steady_clock::now();
+
+	return fence_value;
+}
+
+void flush_frame_ring(frame_ring* ring) {
+	uint64_t newest;
+
+	newest = 0;
+	for (uint64_t value : ring->slot_fences) {
+		if (value > newest) {
+			newest = value;
+		}
+	}
+
+	if (newest != 0) {
+		ring->timeline->wait_for(newest);
+	}
+}
+
+frame_ring_stats get_frame_ring_stats(const frame_ring* ring) {
+	frame_ring_stats stats;
+
+	stats.batches = ring->batches;
+	stats.blocking_begins = ring->blocking_begins;
+	stats.cpu_wait_seconds = chrono::duration<double>(ring->cpu_wait).count();
+	stats.elapsed_seconds = 0.0;
+	stats.batches_per_second = 0.0;
+	stats.overlap = 0.0;
+
+	if (ring->batches == 0) {
+		return stats;
+	}
+
+	stats.elapsed_seconds = chrono::duration<double>(
+		ring->last_end - ring->first_begin
+	).count();
+
+	if (stats.elapsed_seconds > 0.0) {
+		stats.batches_per_second = ring->batches / stats.elapsed_seconds;
+	}
+
+	stats.overlap = 1.0 - (double)ring->blocking_begins / (double)ring->batches;
+
+	return stats;
+}
@@ -0,0 +1,95 @@
+// Liam Wynn, 12/12/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The frame ring lets the CPU record batch k + 1 while the GPU is
+	still running batch k. There are N slots, each with its own command
+	allocator and list on the DX12 side. A slot is tagged with the fence
+	value signaled after its batch, and the CPU only blocks when it wraps
+	around to a slot whose batch the GPU hasn't finished yet.
+
+	The ring itself only knows about fence values. It talks to the queue
+	through the fence_timeline interface, so the scheduling can be driven
+	by the real queue (see dx12_handler) or by the mock below.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/*
+	A queue plus a fence, seen only as a timeline of values.
+*/
+struct fence_timeline {
+	virtual ~fence_timeline() {}
+
+	// Signals the next value on the queue and returns it.
+	virtual uint64_t signal() = 0;
+
+	// Highest value the queue has reached.
+	virtual uint64_t completed_value() = 0;
+
+	// Blocks the CPU until the queue reaches value.
+	virtual void wait_for(const uint64_t value) = 0;
+};
+
+/*
+	Stand-in for a queue. Nothing completes on its own. Either the test
+	moves the GPU forward with complete_up_to, or a wait completes
+	everything up to the value waited on (as if the CPU slept until the
+	GPU got there).
+*/
+struct mock_fence_timeline : fence_timeline {
+	uint64_t last_signaled;
+	uint64_t last_completed;
+	unsigned int blocking_waits;
+
+	mock_fence_timeline();
+
+	uint64_t signal() override;
+	uint64_t completed_value() override;
+	void wait_for(const uint64_t value) override;
+
+	void complete_up_to(const uint64_t value);
+};
+
+struct frame_ring_stats {
+	uint64_t batches;
+	uint64_t blocking_begins;
+	double cpu_wait_seconds;
+	double elapsed_seconds;
+	double batches_per_second;
+
+	// Fraction of batches begun without waiting on the GPU.
+	double overlap;
+};
+
+struct frame_ring {
+	fence_timeline* timeline;
+
+	unsigned int depth;
+	unsigned int current;
+	bool recording;
+
+	// Fence value signaled after each slot's last batch. 0 if never used.
+	std::vector<uint64_t> slot_fences;
+
+	uint64_t batches;
+	uint64_t blocking_begins;
+	std::chrono::steady_clock::duration cpu_wait;
+	std::chrono::steady_clock::time_point first_begin;
+	std::chrono::steady_clock::time_point last_end;
+};
+
+void initialize_frame_ring(
+	frame_ring* ring,
+	fence_timeline* timeline,
+	const unsigned int depth
+);
+
+unsigned int begin_frame(frame_ring* ring);
+uint64_t end_frame(frame_ring* ring);
+void flush_frame_ring(frame_ring* ring);
+
+frame_ring_stats get_frame_ring_stats(const frame_ring* ring);
@@ -0,0 +1,316 @@
+// Liam Wynn, 12/30/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "gpu_bench_backend.h"
+#include "gpu_upload.h"
+#include "utils.h"
+#include <chrono>
+#include <string>
+
+using namespace std;
+
+// Two markers per iteration, so this is plenty.
+const unsigned int GPU_BENCH_MAX_MARKERS = 16;
+
+DXGI_FORMAT bench_format_to_dxgi(const bench_format format) {
+	return cpu_texel_format_to_dxgi(bench_format_to_cpu(format));
+}
+
+void initialize_gpu_bench_backend(gpu_bench_backend* backend, application* app) {
+	backend->app = app;
+	backend->target = NULL;
+	backend->pipeline = NULL;
+	backend->checksum = 0;
+
+	initialize_profiler(&backend->prof);
+	initialize_gpu_profiler(&backend->gpu_prof, app->dx12, GPU_BENCH_MAX_MARKERS);
+}
+
+void shutdown_gpu_bench_backend(gpu_bench_backend* backend) {
+	backend->release();
+	backend->pipelines.clear();
+	shutdown_gpu_profiler(&backend->gpu_prof);
+}
+
+const char* gpu_bench_backend::name() {
+	return "gpu";
+}
+
+/*
+	The hello_compute pipeline for one group size and layout. Built
+	once per sweep. The kernel is reflected too, so its dispatch is
+	sized from the numthreads it was really compiled with.
+*/
+static gpu_bench_pipeline* pipeline_for_case(
+	gpu_bench_backend* backend,
+	const bench_case* test
+) {
+	application* app;
+	gpu_bench_pipeline_key key;
+	shader_defines defines;
+	vector<unsigned char> bytecode;
+	shader_cache_key shader_key;
+	gpu_bench_pipeline pipeline;
+	unsigned int table_offset;
+	uint64_t root_signature_hash;
+
+	app = backend->app;
+	key = make_tuple(test->group_size_x, test->group_size_y, test->layout);
+
+	if (backend->pipelines.find(key) != backend->pipelines.end()) {
+		return &backend->pipelines[key];
+	}
+
+	defines.push_back(make_pair(string("GROUP_SIZE_X"), to_string(test->group_size_x)));
+	defines.push_back(make_pair(string("GROUP_SIZE_Y"), to_string(test->group_size_y)));
+
+	if (test->layout == BENCH_LAYOUT_STRUCTURED) {
+		defines.push_back(make_pair(string("LAYOUT_STRUCTURED"), string("1")));
+	}
+	else if (test->layout == BENCH_LAYOUT_RAW) {
+		defines.push_back(make_pair(string("LAYOUT_RAW"), string("1")));
+	}
+
+	bytecode = compile_kernel(app, defines, &shader_key);
+
+	if (!reflect_compute_shader(bytecode, &pipeline.kernel)) {
+		throw exception();
+	}
+
+	if (test->layout == BENCH_LAYOUT_TEXTURE) {
+		//
+		// The group size doesn't change what the kernel binds, so it
+		// shares the application's root signature.
+		//
+
+		pipeline.root_signature = app->root_signature;
+		pipeline.layout = app->layout;
+		pipeline.buffer_parameter = app->buffer_parameter;
+		pipeline.has_constants = false;
+		pipeline.constants_parameter = 0;
+		root_signature_hash = app->root_signature_hash;
+	}
+	else {
+		if (!build_root_layout(&pipeline.kernel, &pipeline.layout)
+			|| !find_root_binding(&pipeline.layout, SHADER_BINDING_UAV, 0, 0, &pipeline.buffer_parameter, &table_offset)
+			|| !find_root_binding(&pipeline.layout, SHADER_BINDING_CBV, 0, 0, &pipeline.constants_parameter, &table_offset)) {
+			throw exception();
+		}
+
+		pipeline.has_constants = true;
+		pipeline.root_signature = get_root_signature(
+			app->root_signatures,
+			app->dx12,
+			&pipeline.layout,
+			&root_signature_hash
+		);
+	}
+
+	pipeline.pipeline_state = load_or_create_compute_pipeline(
+		app->pipelines,
+		app->dx12,
+		pipeline.root_signature.Get(),
+		root_signature_hash,
+		bytecode,
+		&shader_key
+	);
+
+	backend->pipelines[key] = pipeline;
+
+	return &backend->pipelines[key];
+}
+
+bool gpu_bench_backend::prepare(const bench_case* test, string* reason) {
+	this->test = *test;
+
+	try {
+		pipeline = pipeline_for_case(this, test);
+	}
+	catch (const exception&) {
+		*reason = "could not build the pipeline";
+		return false;
+	}
+
+	//
+	// A big case can fail to allocate. Clean up whatever part of the
+	// buffer did get made, and report the case as skipped.
+	//
+
+	if (test->layout != BENCH_LAYOUT_TEXTURE
+		&& (uint64_t)test->width * test->height * bench_format_size(test->format) > MAX_LINEAR_BUFFER_BYTES) {
+		*reason = "too big to read back as one buffer";
+		return false;
+	}
+
+	target = new compute_buffer;
+	target->uav_index = INVALID_DESCRIPTOR_INDEX;
+
+	try {
+		switch (test->layout) {
+		case BENCH_LAYOUT_STRUCTURED:
+			initialize_structured_compute_buffer(
+				target,
+				app->dx12,
+				test->width * test->height,
+				bench_format_size(test->format)
+			);
+			break;
+		case BENCH_LAYOUT_RAW:
+			initialize_raw_compute_buffer(
+				target,
+				app->dx12,
+				(uint64_t)test->width * test->height * bench_format_size(test->format)
+			);
+			break;
+		default:
+			initialize_compute_buffer(
+				target,
+				app->dx12,
+				test->width,
+				test->height,
+				bench_format_to_dxgi(test->format)
+			);
+			break;
+		}
+	}
+	catch (const exception&) {
+		if (target->uav_index != INVALID_DESCRIPTOR_INDEX) {
+			shutdown_compute_buffer(target, app->dx12);
+		}
+
+		delete target;
+		target = NULL;
+
+		*reason = "out of video memory";
+		return false;
+	}
+
+	return true;
+}
+
+void gpu_bench_backend::run_iteration(double seconds[BENCH_PHASE_COUNT]) {
+	dx12_handler* dx12;
+	dx12_queue* queue;
+	ComPtr<ID3D12GraphicsCommandList> command_list;
+	dispatch_group_count groups;
+	uint32_t constants[4];
+	unsigned int marker;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+	queue_ticket copy_done;
+	unsigned int slot;
+	const uint64_t* words;
+	size_t num_words;
+	uint64_t sum;
+
+	dx12 = app->dx12;
+	queue = dx12->direct_queue;
+
+	groups = dispatch_size_for(&pipeline->kernel, test.width, test.height, 1);
+
+	command_list = begin_command_batch(queue, pipeline->pipeline_state.Get());
+
+	require_resource_state(&dx12->resource_states, target->buffer.Get(), ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+	record_resource_barriers(dx12, command_list.Get());
+
+	ID3D12DescriptorHeap* heaps[] = { dx12->cbv_srv_uav_heap->heap.Get() };
+	command_list->SetDescriptorHeaps(1, heaps);
+	command_list->SetComputeRootSignature(pipeline->root_signature.Get());
+
+	if (pipeline->layout.parameters[pipeline->buffer_parameter].kind == ROOT_PARAMETER_UAV) {
+		command_list->SetComputeRootUnorderedAccessView(pipeline->buffer_parameter, target->buffer->GetGPUVirtualAddress());
+	}
+	else {
+		command_list->SetComputeRootDescriptorTable(pipeline->buffer_parameter, heap_gpu_handle(dx12->cbv_srv_uav_heap, target->uav_index));
+	}
+
+	//
+	// The buffer layouts can't ask the buffer for the image size.
+	//
+
+	if (pipeline->has_constants) {
+		constants[0] = 0;
+		constants[1] = 0;
+		constants[2] = test.width;
+		constants[3] = test.height;
+
+		if (pipeline->layout.parameters[pipeline->constants_parameter].kind == ROOT_PARAMETER_CONSTANTS) {
+			command_list->SetComputeRoot32BitConstants(pipeline->constants_parameter, 4, constants, 0);
+		}
+		else {
+			command_list->SetComputeRootConstantBufferView(
+				pipeline->constants_parameter,
+				upload_dispatch_constants(queue->uploads, constants, sizeof(constants))
+			);
+		}
+	}
+
+	marker = begin_gpu_marker(&gpu_prof, queue, command_list.Get(), "compute");
+	command_list->Dispatch(groups.x, groups.y, groups.z);
+	end_gpu_marker(&gpu_prof, command_list.Get(), marker);
+
+	require_resource_state(&dx12->resource_states, target->buffer.Get(), ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_COPY_SOURCE, false);
+	record_resource_barriers(dx12, command_list.Get());
+
+	marker = begin_gpu_marker(&gpu_prof, queue, command_list.Get(), "copy");
+	record_readback_copy(command_list, target);
+	end_gpu_marker(&gpu_prof, command_list.Get(), marker);
+
+	copy_done = submit_command_batch(dx12, queue, NULL, 0);
+	commit_readback_copy(target, dx12, &copy_done);
+	flush_command_batches(queue);
+
+	//
+	// Pull the two GPU times out of the profiler, then forget them so
+	// the next iteration starts clean.
+	//
+
+	collect_gpu_markers(&gpu_prof, &prof);
+
+	seconds[BENCH_PHASE_COMPUTE] = 0.0;
+	seconds[BENCH_PHASE_COPY] = 0.0;
+
+	for (const profile_event& event : prof.events) {
+		if (event.name == "compute") {
+			seconds[BENCH_PHASE_COMPUTE] = event.duration_us / 1.0e6;
+		}
+		else if (event.name == "copy") {
+			seconds[BENCH_PHASE_COPY] = event.duration_us / 1.0e6;
+		}
+	}
+
+	prof.events.clear();
+
+	//
+	// Readback: read all of the slot the copy went to. The buffer stays
+	// mapped, so this is just the reads. The sum keeps them from being
+	// optimized away.
+	//
+
+	start = chrono::steady_clock::now();
+
+	slot = begin_readback(&target->readback_slots);
+	words = (const uint64_t*)readback_slot_data(target, slot);
+	num_words = (size_t)(target->readback_slot_stride / sizeof(uint64_t));
+	sum = 0;
+
+	for (size_t i = 0; i < num_words; i++) {
+		sum += words[i];
+	}
+
+	end_readback(&target->readback_slots, slot);
+
+	elapsed = chrono::steady_clock::now() - start;
+	seconds[BENCH_PHASE_READBACK] = elapsed.count();
+
+	checksum += sum;
+}
+
+void gpu_bench_backend::release() {
+	if (target == NULL) {
+		return;
+	}
+
+	shutdown_compute_buffer(target, app->dx12);
+	delete target;
+	target = NULL;
+}
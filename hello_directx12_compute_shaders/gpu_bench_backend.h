@@ -0,0 +1,70 @@
+// Liam Wynn, 12/30/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	Runs benchmark suite cases on the device.
+
+	Each case gets its own compute_buffer in the case's format and
+	layout, and a pipeline compiled with the case's GROUP_SIZE_X/
+	GROUP_SIZE_Y. Both go through the application's pipeline cache, so
+	a second sweep doesn't recompile anything. The dispatch is sized
+	from the reflected numthreads of that pipeline.
+
+	The structured and raw layouts build the kernel with
+	LAYOUT_STRUCTURED or LAYOUT_RAW. Those take the image size in b0,
+	so they get a root signature of their own from reflection, with the
+	buffer as a root UAV rather than a descriptor table.
+
+	Compute and copy are timed with timestamp queries on the GPU.
+	Readback is timed on the CPU: reading every byte of the readback
+	slot the copy went to. The slot is already mapped.
+*/
+
+#pragma once
+
+#include "application.h"
+#include "benchmark_suite.h"
+#include <map>
+#include <tuple>
+#include <utility>
+
+struct gpu_bench_pipeline {
+	ComPtr<ID3D12PipelineState> pipeline_state;
+	shader_reflection kernel;
+
+	// The application's, for the texture layout.
+	ComPtr<ID3D12RootSignature> root_signature;
+	root_layout layout;
+	unsigned int buffer_parameter;
+
+	// Only the buffer layouts have constants.
+	bool has_constants;
+	unsigned int constants_parameter;
+};
+
+// Group size and layout.
+typedef std::tuple<unsigned int, unsigned int, bench_layout> gpu_bench_pipeline_key;
+
+struct gpu_bench_backend : bench_backend {
+	application* app;
+
+	// One per group size and layout. pipeline is the one for the
+	// current case.
+	std::map<gpu_bench_pipeline_key, gpu_bench_pipeline> pipelines;
+	gpu_bench_pipeline* pipeline;
+	compute_buffer* target;
+	bench_case test;
+
+	profiler prof;
+	gpu_profiler gpu_prof;
+	uint64_t checksum;
+
+	const char* name() override;
+	bool prepare(const bench_case* test, std::string* reason) override;
+	void run_iteration(double seconds[BENCH_PHASE_COUNT]) override;
+	void release() override;
+};
+
+void initialize_gpu_bench_backend(gpu_bench_backend* backend, application* app);
+void shutdown_gpu_bench_backend(gpu_bench_backend* backend);
+
+DXGI_FORMAT bench_format_to_dxgi(const bench_format format);
@@ -0,0 +1,377 @@
+// Liam Wynn, 01/09/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "gpu_compute_graph.h"
+#include "utils.h"
+
+using namespace std;
+
+void initialize_gpu_compute_graph(
+	gpu_compute_graph* executor,
+	dx12_handler* dx12,
+	compute_graph* graph
+) {
+	executor->dx12 = dx12;
+	executor->graph = graph;
+	executor->resources.clear();
+	executor->descs.clear();
+	executor->arena.allocation = empty_gpu_allocation();
+	executor->made_transients = false;
+	executor->batch_tickets.clear();
+
+	initialize_compute_graph(graph);
+}
+
+graph_state graph_state_from_d3d12(const D3D12_RESOURCE_STATES state) {
+	graph_state result;
+
+	result = 0;
+
+	if (state & D3D12_RESOURCE_STATE_UNORDERED_ACCESS) {
+		result |= graph_usage_state(GRAPH_USAGE_UNORDERED_ACCESS);
+	}
+
+	if (state & D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE) {
+		result |= graph_usage_state(GRAPH_USAGE_SHADER_RESOURCE);
+	}
+
+	if (state & D3D12_RESOURCE_STATE_COPY_SOURCE) {
+		result |= graph_usage_state(GRAPH_USAGE_COPY_SOURCE);
+	}
+
+	if (state & D3D12_RESOURCE_STATE_COPY_DEST) {
+		result |= graph_usage_state(GRAPH_USAGE_COPY_DEST);
+	}
+
+	return result;
+}
+
+D3D12_RESOURCE_STATES graph_state_to_d3d12(const graph_state state) {
+	D3D12_RESOURCE_STATES result;
+
+	result = D3D12_RESOURCE_STATE_COMMON;
+
+	if (state & graph_usage_state(GRAPH_USAGE_UNORDERED_ACCESS)) {
+		result |= D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+	}
+
+	if (state & graph_usage_state(GRAPH_USAGE_SHADER_RESOURCE)) {
+		result |= D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	}
+
+	if (state & graph_usage_state(GRAPH_USAGE_COPY_SOURCE)) {
+		result |= D3D12_RESOURCE_STATE_COPY_SOURCE;
+	}
+
+	if (state & graph_usage_state(GRAPH_USAGE_COPY_DEST)) {
+		result |= D3D12_RESOURCE_STATE_COPY_DEST;
+	}
+
+	return result;
+}
+
+unsigned int import_gpu_graph_resource(
+	gpu_compute_graph* executor,
+	const string& name,
+	ID3D12Resource* resource,
+	const D3D12_RESOURCE_STATES state,
+	const bool fixed_state
+) {
+	D3D12_RESOURCE_STATES current;
+	unsigned int index;
+
+	current = state;
+
+	if (!fixed_state) {
+		current = (D3D12_RESOURCE_STATES)tracked_resource_state(&executor->dx12->resource_states, resource, 0);
+	}
+
+	index = import_graph_resource(executor->graph, name, graph_state_from_d3d12(current), fixed_state);
+
+	executor->resources.resize(executor->graph->resources.size(), NULL);
+	executor->descs.resize(executor->graph->resources.size());
+	executor->resources[index] = resource;
+
+	return index;
+}
+
+unsigned int add_gpu_graph_transient(
+	gpu_compute_graph* executor,
+	const string& name,
+	const D3D12_RESOURCE_DESC* desc
+) {
+	D3D12_RESOURCE_ALLOCATION_INFO info;
+	unsigned int index;
+
+	//
+	// The same size and alignment the arena will ask for, so the
+	// compiler plans the memory the way the arena lays it out.
+	//
+
+	info = executor->dx12->device->GetResourceAllocationInfo(0, 1, desc);
+
+	index = add_graph_resource(executor->graph, name, info.SizeInBytes, info.Alignment);
+
+	executor->resources.resize(executor->graph->resources.size(), NULL);
+	executor->descs.resize(executor->graph->resources.size());
+	executor->descs[index] = *desc;
+
+	return index;
+}
+
+bool compile_gpu_compute_graph(gpu_compute_graph* executor, string* error) {
+	graph_compile_options options;
+
+	options.async_compute = executor->dx12->compute_queue != NULL;
+	options.async_copy = executor->dx12->copy_queue != NULL;
+
+	return compile_compute_graph(executor->graph, &options, &executor->compiled, error);
+}
+
+/*
+	Hands the compiled barriers to the tracker and records what it comes
+	up with. UAV barriers aren't passed on: the tracker adds those itself
+	when the pass asks for the UAV again.
+*/
+static void record_graph_barriers(
+	gpu_compute_graph* executor,
+	const vector<graph_barrier>& barriers,
+	vector<graph_state>* states,
+	ID3D12GraphicsCommandList* command_list
+) {
+	vector<D3D12_RESOURCE_BARRIER> aliasing;
+
+	for (const graph_barrier& barrier : barriers) {
+		ID3D12Resource* resource = executor->resources[barrier.resource];
+
+		switch (barrier.kind) {
+		case GRAPH_BARRIER_ALIASING:
+			aliasing.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(NULL, resource));
+			break;
+		case GRAPH_BARRIER_TRANSITION:
+			require_resource_state(&executor->dx12->resource_states, resource, ALL_TRACKED_SUBRESOURCES, graph_state_to_d3d12(barrier.after), false);
+			(*states)[barrier.resource] = barrier.after;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (!aliasing.empty()) {
+		command_list->ResourceBarrier((UINT)aliasing.size(), aliasing.data());
+	}
+
+	record_resource_barriers(executor->dx12, command_list);
+}
+
+static void decay_copy_batch_resources(
+	gpu_compute_graph* executor,
+	const graph_batch* batch,
+	vector<graph_state>* states
+) {
+	const compute_graph* graph = executor->graph;
+	const compiled_graph* compiled = &executor->compiled;
+
+	auto decay = [&](const unsigned int r) {
+		if (!graph->resources[r].fixed_state) {
+			assume_resource_state(&executor->dx12->resource_states, executor->resources[r], D3D12_RESOURCE_STATE_COMMON);
+			(*states)[r] = 0;
+		}
+	};
+
+	for (unsigned int s : batch->steps) {
+		const compiled_step* step = &compiled->steps[s];
+
+		for (const graph_barrier& barrier : step->before) {
+			decay(barrier.resource);
+		}
+
+		if (step->pass != GRAPH_NONE) {
+			for (const graph_access& access : graph->passes[step->pass].accesses) {
+				decay(access.resource);
+			}
+		}
+
+		for (const graph_barrier& barrier : step->after) {
+			decay(barrier.resource);
+		}
+	}
+}
+
+void run_gpu_compute_graph(gpu_compute_graph* executor, graph_pass_recorder* recorder) {
+	const compute_graph* graph = executor->graph;
+	const compiled_graph* compiled = &executor->compiled;
+	vector<transient_resource_desc> transients;
+	vector<unsigned int> transient_resources;
+	vector<graph_state> states(graph->resources.size());
+	queue_ticket previous[QUEUE_KIND_COUNT];
+	bool started[QUEUE_KIND_COUNT];
+	ComPtr<ID3D12GraphicsCommandList> command_list;
+
+	for (int q = 0; q < QUEUE_KIND_COUNT; q++) {
+		previous[q] = { (queue_kind)q, 0 };
+		started[q] = false;
+	}
+
+	//
+	// Transients, in the state their first use needs.
+	//
+
+	for (unsigned int r = 0; r < graph->resources.size(); r++) {
+		unsigned int request = compiled->transient_index[r];
+		transient_resource_desc desc;
+
+		states[r] = graph->resources[r].imported ? graph->resources[r].initial_state : compiled->first_state[r];
+
+		if (request == GRAPH_NONE) {
+			continue;
+		}
+
+		desc.desc = executor->descs[r];
+		desc.initial_state = graph_state_to_d3d12(compiled->first_state[r]);
+		desc.first_use = compiled->transient_requests[request].first_use;
+		desc.last_use = compiled->transient_requests[request].last_use;
+
+		transients.push_back(desc);
+		transient_resources.push_back(r);
+	}
+
+	if (!executor->made_transients) {
+		create_transient_resources(executor->dx12->memory, transients.data(), (unsigned int)transients.size(), &executor->arena);
+
+		for (size_t i = 0; i < transient_resources.size(); i++) {
+			unsigned int r = transient_resources[i];
+
+			executor->resources[r] = executor->arena.resources[i].Get();
+			track_resource(&executor->dx12->resource_states, executor->resources[r], 1, graph_state_to_d3d12(states[r]));
+		}
+
+		executor->made_transients = true;
+	}
+
+	for (unsigned int b = 0; b < executor->batch_tickets.size(); b++) {
+		previous[compiled->batches[b].queue] = executor->batch_tickets[b];
+	}
+
+	//
+	// Every resource has to start in the state the compiler planned from,
+	// and the run before may have left it elsewhere. The direct queue can
+	// do any transition, so a batch there moves them back, after the run
+	// before is done on every queue.
+	//
+
+	command_list = begin_command_batch(executor->dx12->direct_queue, NULL);
+
+	for (unsigned int r = 0; r < graph->resources.size(); r++) {
+		D3D12_RESOURCE_STATES start;
+
+		if (graph->resources[r].fixed_state || compiled->first_use[r] == GRAPH_NONE) {
+			continue;
+		}
+
+		start = graph_state_to_d3d12(states[r]);
+
+		if (tracked_resource_state(&executor->dx12->resource_states, executor->resources[r], 0) != (uint32_t)start) {
+			require_resource_state(&executor->dx12->resource_states, executor->resources[r], ALL_TRACKED_SUBRESOURCES, start, false);
+		}
+	}
+
+	record_resource_barriers(executor->dx12, command_list.Get());
+	previous[QUEUE_DIRECT] = submit_command_batch(executor->dx12, executor->dx12->direct_queue, previous, QUEUE_KIND_COUNT);
+
+	//
+	// Batches go in order, so every wait is on one already submitted.
+	//
+
+	executor->batch_tickets.assign(compiled->batches.size(), { QUEUE_DIRECT, 0 });
+
+	for (unsigned int b = 0; b < compiled->batches.size(); b++) {
+		const graph_batch* batch = &compiled->batches[b];
+		dx12_queue* queue;
+		vector<queue_ticket> waits;
+
+		queue = queue_for_kind(executor->dx12, batch->queue);
+		command_list = begin_command_batch(queue, NULL);
+
+		for (unsigned int s : batch->steps) {
+			const compiled_step* step = &compiled->steps[s];
+
+			record_graph_barriers(executor, step->before, &states, command_list.Get());
+
+			if (step->pass != GRAPH_NONE) {
+				for (const graph_access& access : graph->passes[step->pass].accesses) {
+					if (graph->resources[access.resource].fixed_state) {
+						continue;
+					}
+
+					require_resource_state(
+						&executor->dx12->resource_states,
+						executor->resources[access.resource],
+						ALL_TRACKED_SUBRESOURCES,
+						graph_state_to_d3d12(states[access.resource]),
+						graph_usage_writes(access.usage)
+					);
+				}
+
+				record_resource_barriers(executor->dx12, command_list.Get());
+				recorder->record_pass(executor, step->pass, command_list.Get());
+			}
+
+			record_graph_barriers(executor, step->after, &states, command_list.Get());
+		}
+
+		for (unsigned int w : batch->waits) {
+			waits.push_back(executor->batch_tickets[w]);
+		}
+
+		if (!started[batch->queue]) {
+			for (int q = 0; q < QUEUE_KIND_COUNT; q++) {
+				if (previous[q].value != 0) {
+					waits.push_back(previous[q]);
+				}
+			}
+
+			started[batch->queue] = true;
+		}
+
+		executor->batch_tickets[b] = submit_command_batch(executor->dx12, queue, waits.data(), (unsigned int)waits.size());
+
+		//
+		// Whatever the copy queue used decays to COMMON once the batch
+		// is done. Nothing uses it before then, and the compiler planned
+		// the transitions after it from there.
+		//
+
+		if (batch->queue == QUEUE_COPY) {
+			decay_copy_batch_resources(executor, batch, &states);
+		}
+	}
+}
+
+queue_ticket gpu_graph_pass_ticket(const gpu_compute_graph* executor, const unsigned int pass) {
+	unsigned int step = executor->compiled.pass_step[pass];
+
+	if (step == GRAPH_NONE) {
+		throw exception();
+	}
+
+	return executor->batch_tickets[executor->compiled.steps[step].batch];
+}
+
+void shutdown_gpu_compute_graph(gpu_compute_graph* executor) {
+	dx12_handler* dx12;
+
+	dx12 = executor->dx12;
+
+	flush_command_batches(dx12->direct_queue);
+
+	if (dx12->compute_queue != NULL) {
+		flush_command_batches(dx12->compute_queue);
+		flush_command_batches(dx12->copy_queue);
+	}
+
+	for (ComPtr<ID3D12Resource>& resource : executor->arena.resources) {
+		untrack_resource(&dx12->resource_states, resource.Get());
+	}
+
+	release_transient_arena(dx12->memory, &executor->arena);
+}
@@ -0,0 +1,110 @@
+// Liam Wynn, 01/09/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	Runs a compute graph (see compute_graph.h) on the device.
+
+	Imports are resources the caller already has. Transients are made
+	from a D3D12_RESOURCE_DESC the first time the graph runs, in one
+	transient arena laid out the same way the compiler planned it, and
+	are gone after shutdown_gpu_compute_graph.
+
+	The compiled barriers go through the device's resource state
+	tracker, at the point in the schedule the compiler put them, so the
+	tracker still knows where every import is afterwards. Fixed-state
+	imports aren't tracked. Once a copy queue batch is submitted, the
+	tracker is told that everything it used is in COMMON, which is
+	where it decays to.
+
+	A batch is one command list on its queue, submitted in order with
+	the waits the compiler worked out. Every run starts with a batch on
+	the direct queue that puts the resources back in the states the
+	graph starts from, after the run before is done on every queue, so a
+	graph can run again. The passes record themselves through a
+	graph_pass_recorder.
+*/
+
+#pragma once
+
+#include "compute_graph.h"
+#include "dx12_handler.h"
+#include "gpu_memory.h"
+
+struct gpu_compute_graph;
+
+struct graph_pass_recorder {
+	virtual ~graph_pass_recorder() {}
+
+	// Pipeline state, root signature and heaps are up to the pass.
+	virtual void record_pass(
+		gpu_compute_graph* executor,
+		const unsigned int pass,
+		ID3D12GraphicsCommandList* command_list
+	) = 0;
+};
+
+struct gpu_compute_graph {
+	dx12_handler* dx12;
+	compute_graph* graph;
+	compiled_graph compiled;
+
+	// Per graph resource. Imports are set by
+	// import_gpu_graph_resource, transients when the graph runs.
+	std::vector<ID3D12Resource*> resources;
+	std::vector<D3D12_RESOURCE_DESC> descs;
+
+	transient_arena arena;
+	bool made_transients;
+
+	// Per batch, once it is submitted.
+	std::vector<queue_ticket> batch_tickets;
+};
+
+void initialize_gpu_compute_graph(
+	gpu_compute_graph* executor,
+	dx12_handler* dx12,
+	compute_graph* graph
+);
+
+graph_state graph_state_from_d3d12(const D3D12_RESOURCE_STATES state);
+D3D12_RESOURCE_STATES graph_state_to_d3d12(const graph_state state);
+
+/*
+	Adds resource to the graph as an import. The state it starts in is
+	the one the tracker has for it, unless fixed_state is set, in which
+	case it has to stay in state.
+*/
+unsigned int import_gpu_graph_resource(
+	gpu_compute_graph* executor,
+	const std::string& name,
+	ID3D12Resource* resource,
+	const D3D12_RESOURCE_STATES state,
+	const bool fixed_state
+);
+
+/*
+	Adds a transient made from desc. All of a graph's transients have to
+	be buffers, or all textures.
+*/
+unsigned int add_gpu_graph_transient(
+	gpu_compute_graph* executor,
+	const std::string& name,
+	const D3D12_RESOURCE_DESC* desc
+);
+
+/*
+	Compiles for the queues the device has. Returns false and says why
+	in error if the graph doesn't compile.
+*/
+bool compile_gpu_compute_graph(gpu_compute_graph* executor, std::string* error);
+
+/*
+	Makes the transients if this is the first run, records every batch
+	and submits them. Doesn't wait for any of it.
+*/
+void run_gpu_compute_graph(gpu_compute_graph* executor, graph_pass_recorder* recorder);
+
+// Done when pass is. The pass can't have been culled.
+queue_ticket gpu_graph_pass_ticket(const gpu_compute_graph* executor, const unsigned int pass);
+
+// Waits for the GPU to be done with the transients.
+void shutdown_gpu_compute_graph(gpu_compute_graph* executor);
@@ -0,0 +1,44 @@
+// Liam Wynn, 01/14/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "gpu_dxil.h"
+
+void query_shader_model_support(dx12_handler* dx12, shader_model_support* support) {
+	D3D12_FEATURE_DATA_SHADER_MODEL shader_model;
+	D3D12_FEATURE_DATA_D3D12_OPTIONS1 options1;
+	D3D12_FEATURE_DATA_D3D12_OPTIONS4 options4;
+
+	support->highest_shader_model = 0x51;
+	support->wave_ops = false;
+	support->wave_lanes_min = 0;
+	support->wave_lanes_max = 0;
+	support->int64_ops = false;
+	support->native_16bit_ops = false;
+
+	if (dx12->device == NULL) {
+		return;
+	}
+
+	//
+	// D3D_SHADER_MODEL_6_0 is 0x60, 6_1 is 0x61 and so on.
+	//
+
+	for (unsigned int model = D3D_SHADER_MODEL_6_6; model >= D3D_SHADER_MODEL_6_0; model--) {
+		shader_model.HighestShaderModel = (D3D_SHADER_MODEL)model;
+
+		if (SUCCEEDED(dx12->device->CheckFeatureSupport(D3D12_FEATURE_SHADER_MODEL, &shader_model, sizeof(shader_model)))) {
+			support->highest_shader_model = shader_model.HighestShaderModel;
+			break;
+		}
+	}
+
+	if (SUCCEEDED(dx12->device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS1, &options1, sizeof(options1)))) {
+		support->wave_ops = options1.WaveOps == TRUE;
+		support->wave_lanes_min = options1.WaveLaneCountMin;
+		support->wave_lanes_max = options1.WaveLaneCountMax;
+		support->int64_ops = options1.Int64ShaderOps == TRUE;
+	}
+
+	if (SUCCEEDED(dx12->device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS4, &options4, sizeof(options4)))) {
+		support->native_16bit_ops = options4.Native16BitShaderOpsSupported == TRUE;
+	}
+}
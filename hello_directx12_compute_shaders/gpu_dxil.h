@@ -0,0 +1,19 @@
+// Liam Wynn, 01/14/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The DirectX half of the DXIL compile path (see dxil_container.h):
+	what the device can run, from CheckFeatureSupport.
+
+	The highest shader model is found by asking for the highest one
+	this code knows and stepping down until the runtime accepts one;
+	runtimes older than the model they are asked about fail the call
+	rather than answer. A device that answers nothing gets 5.1, so only
+	FXC's bytecode is used on it.
+*/
+
+#pragma once
+
+#include "dx12_handler.h"
+#include "dxil_container.h"
+
+void query_shader_model_support(dx12_handler* dx12, shader_model_support* support);
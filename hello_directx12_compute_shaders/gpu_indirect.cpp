@@ -0,0 +1,107 @@
+// Liam Wynn, 01/11/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "gpu_indirect.h"
+#include "utils.h"
+
+using namespace std;
+
+ComPtr<ID3D12CommandSignature> create_indirect_command_signature(
+	dx12_handler* dx12,
+	const indirect_signature* signature,
+	ID3D12RootSignature* root_signature
+) {
+	vector<D3D12_INDIRECT_ARGUMENT_DESC> arguments;
+	D3D12_COMMAND_SIGNATURE_DESC desc;
+	ComPtr<ID3D12CommandSignature> command_signature;
+	bool sets_root_arguments;
+	string error;
+	HRESULT result;
+
+	if (!validate_indirect_signature(signature, &error)) {
+		throw exception();
+	}
+
+	sets_root_arguments = false;
+
+	for (const indirect_argument& argument : signature->arguments) {
+		D3D12_INDIRECT_ARGUMENT_DESC d = {};
+
+		if (argument.kind == INDIRECT_ARGUMENT_DISPATCH) {
+			d.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
+		}
+		else {
+			d.Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+			d.Constant.RootParameterIndex = argument.root_parameter;
+			d.Constant.DestOffsetIn32BitValues = argument.dest_offset;
+			d.Constant.Num32BitValuesToSet = argument.num_values;
+
+			sets_root_arguments = true;
+		}
+
+		arguments.push_back(d);
+	}
+
+	//
+	// The root signature is only allowed, and needed, when a command
+	// changes root arguments.
+	//
+
+	if (sets_root_arguments && root_signature == NULL) {
+		throw exception();
+	}
+
+	desc = {};
+	desc.ByteStride = signature->byte_stride;
+	desc.NumArgumentDescs = (UINT)arguments.size();
+	desc.pArgumentDescs = arguments.data();
+	desc.NodeMask = 0;
+
+	result = dx12->device->CreateCommandSignature(
+		&desc,
+		sets_root_arguments ? root_signature : NULL,
+		IID_PPV_ARGS(&command_signature)
+	);
+	throw_if_failed(result);
+
+	return command_signature;
+}
+
+void record_execute_indirect(
+	dx12_handler* dx12,
+	ID3D12GraphicsCommandList* command_list,
+	ID3D12CommandSignature* command_signature,
+	const unsigned int max_commands,
+	ID3D12Resource* argument_buffer,
+	const uint64_t argument_offset,
+	ID3D12Resource* count_buffer,
+	const uint64_t count_offset
+) {
+	require_resource_state(
+		&dx12->resource_states,
+		argument_buffer,
+		ALL_TRACKED_SUBRESOURCES,
+		D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+		false
+	);
+
+	if (count_buffer != NULL && count_buffer != argument_buffer) {
+		require_resource_state(
+			&dx12->resource_states,
+			count_buffer,
+			ALL_TRACKED_SUBRESOURCES,
+			D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+			false
+		);
+	}
+
+	record_resource_barriers(dx12, command_list);
+
+	command_list->ExecuteIndirect(
+		command_signature,
+		max_commands,
+		argument_buffer,
+		argument_offset,
+		count_buffer,
+		count_offset
+	);
+}
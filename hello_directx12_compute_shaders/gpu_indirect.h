@@ -0,0 +1,40 @@
+// Liam Wynn, 01/11/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The DirectX half of indirect dispatch (see indirect_dispatch.h).
+
+	create_indirect_command_signature turns an indirect_signature into
+	an ID3D12CommandSignature. record_execute_indirect moves the
+	argument and count buffers to INDIRECT_ARGUMENT through the device's
+	resource state tracker, then records the ExecuteIndirect. Whatever
+	wrote the arguments is done by then: the transition waits for it.
+*/
+
+#pragma once
+
+#include "stdafx.h"
+#include "dx12_handler.h"
+#include "indirect_dispatch.h"
+
+/*
+	root_signature has to be the one the commands run with if they set
+	root constants, and may be NULL otherwise. Throws if the signature
+	doesn't validate.
+*/
+ComPtr<ID3D12CommandSignature> create_indirect_command_signature(
+	dx12_handler* dx12,
+	const indirect_signature* signature,
+	ID3D12RootSignature* root_signature
+);
+
+// count_buffer may be NULL, for exactly max_commands commands.
+void record_execute_indirect(
+	dx12_handler* dx12,
+	ID3D12GraphicsCommandList* command_list,
+	ID3D12CommandSignature* command_signature,
+	const unsigned int max_commands,
+	ID3D12Resource* argument_buffer,
+	const uint64_t argument_offset,
+	ID3D12Resource* count_buffer,
+	const uint64_t count_offset
+);
@@ -0,0 +1,258 @@
+// Liam Wynn, 01/08/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "gpu_job_backend.h"
+#include "gpu_upload.h"
+#include "utils.h"
+
+using namespace std;
+
+void initialize_gpu_job_backend(gpu_job_backend* backend, application* app) {
+	backend->app = app;
+	backend->buffers.entries.clear();
+	backend->buffers.clock = 0;
+	backend->pipeline = NULL;
+	backend->target = NULL;
+	backend->reading = INVALID_READBACK_SLOT;
+}
+
+void shutdown_gpu_job_backend(gpu_job_backend* backend) {
+	flush_command_batches(backend->app->dx12->direct_queue);
+
+	for (job_buffer_cache<compute_buffer*>::entry& entry : backend->buffers.entries) {
+		shutdown_compute_buffer(entry.buffer, backend->app->dx12);
+		delete entry.buffer;
+	}
+
+	backend->buffers.entries.clear();
+	backend->pipelines.clear();
+}
+
+const char* gpu_job_backend::name() {
+	return "gpu";
+}
+
+/*
+	Reflects the kernel, checks it only binds what a job can give it,
+	and builds its root signature and pipeline. Throws if it can't.
+*/
+static gpu_job_pipeline build_job_pipeline(application* app, const job_desc* job, string* reason) {
+	gpu_job_pipeline pipeline;
+	vector<unsigned char> bytecode;
+	shader_cache_key shader_key;
+	unsigned int table_offset;
+	uint64_t root_signature_hash;
+
+	bytecode = compile_kernel_file(app, job->kernel, job->entry_point, shader_defines(), &shader_key);
+
+	if (!reflect_compute_shader(bytecode, &pipeline.kernel)) {
+		*reason = "could not reflect the kernel";
+		throw exception();
+	}
+
+	for (const shader_binding& binding : pipeline.kernel.bindings) {
+		if (binding.kind == SHADER_BINDING_UAV && binding.shader_register == 0 && binding.space == 0 && binding.shape == SHADER_RESOURCE_TEXTURE) {
+			continue;
+		}
+
+		if (binding.kind == SHADER_BINDING_CBV && binding.shader_register == 0 && binding.space == 0) {
+			continue;
+		}
+
+		*reason = "the kernel binds " + binding.name + ", but a job only has u0 (a texture) and b0";
+		throw exception();
+	}
+
+	if (!build_root_layout(&pipeline.kernel, &pipeline.layout)
+		|| !find_root_binding(&pipeline.layout, SHADER_BINDING_UAV, 0, 0, &pipeline.buffer_parameter, &table_offset)) {
+		*reason = "the kernel doesn't write a texture at u0";
+		throw exception();
+	}
+
+	pipeline.has_constants = find_root_binding(&pipeline.layout, SHADER_BINDING_CBV, 0, 0, &pipeline.constants_parameter, &table_offset);
+
+	pipeline.root_signature = get_root_signature(
+		app->root_signatures,
+		app->dx12,
+		&pipeline.layout,
+		&root_signature_hash
+	);
+
+	pipeline.pipeline_state = load_or_create_compute_pipeline(
+		app->pipelines,
+		app->dx12,
+		pipeline.root_signature.Get(),
+		root_signature_hash,
+		bytecode,
+		&shader_key
+	);
+
+	return pipeline;
+}
+
+bool gpu_job_backend::prepare(
+	const job_desc* job,
+	bool* reused_pipeline,
+	bool* reused_buffer,
+	string* reason
+) {
+	gpu_job_pipeline_key pipeline_key;
+	job_buffer_key buffer_key;
+	compute_buffer* cb;
+	compute_buffer* evicted;
+	compute_buffer** slot;
+	bool did_evict;
+
+	this->job = *job;
+
+	//
+	// The pipeline. A kernel that won't compile is only that job's
+	// problem.
+	//
+
+	pipeline_key = make_pair(job->kernel, job->entry_point);
+	*reused_pipeline = pipelines.find(pipeline_key) != pipelines.end();
+
+	if (!*reused_pipeline) {
+		try {
+			pipelines[pipeline_key] = build_job_pipeline(app, job, reason);
+		}
+		catch (const exception&) {
+			if (reason->empty()) {
+				*reason = "could not build " + job->kernel + ":" + job->entry_point;
+			}
+
+			return false;
+		}
+	}
+
+	pipeline = &pipelines[pipeline_key];
+
+	//
+	// The buffer, if one of this shape is still around.
+	//
+
+	buffer_key = make_tuple(job->width, job->height, job->format);
+	slot = find_job_buffer(&buffers, buffer_key);
+	*reused_buffer = slot != NULL;
+
+	if (slot != NULL) {
+		target = *slot;
+		return true;
+	}
+
+	cb = new compute_buffer;
+	cb->uav_index = INVALID_DESCRIPTOR_INDEX;
+
+	try {
+		initialize_compute_buffer(cb, app->dx12, job->width, job->height, cpu_texel_format_to_dxgi(job->format));
+	}
+	catch (const exception&) {
+		if (cb->uav_index != INVALID_DESCRIPTOR_INDEX) {
+			shutdown_compute_buffer(cb, app->dx12);
+		}
+
+		delete cb;
+
+		*reason = "out of video memory";
+		return false;
+	}
+
+	target = *insert_job_buffer(&buffers, buffer_key, cb, &evicted, &did_evict);
+
+	//
+	// Every job before this one has been read back, so the GPU is done
+	// with the buffer that was pushed out.
+	//
+
+	if (did_evict) {
+		shutdown_compute_buffer(evicted, app->dx12);
+		delete evicted;
+	}
+
+	return true;
+}
+
+void gpu_job_backend::run_iteration() {
+	dx12_handler* dx12;
+	dx12_queue* queue;
+	ComPtr<ID3D12GraphicsCommandList> command_list;
+	dispatch_group_count groups;
+	uint32_t constants[4];
+
+	dx12 = app->dx12;
+	queue = dx12->direct_queue;
+
+	command_list = begin_command_batch(queue, pipeline->pipeline_state.Get());
+
+	require_resource_state(&dx12->resource_states, target->buffer.Get(), ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+	record_resource_barriers(dx12, command_list.Get());
+
+	ID3D12DescriptorHeap* heaps[] = { dx12->cbv_srv_uav_heap->heap.Get() };
+	command_list->SetDescriptorHeaps(1, heaps);
+	command_list->SetComputeRootSignature(pipeline->root_signature.Get());
+	command_list->SetComputeRootDescriptorTable(pipeline->buffer_parameter, heap_gpu_handle(dx12->cbv_srv_uav_heap, target->uav_index));
+
+	if (pipeline->has_constants) {
+		constants[0] = 0;
+		constants[1] = 0;
+		constants[2] = job.width;
+		constants[3] = job.height;
+
+		if (pipeline->layout.parameters[pipeline->constants_parameter].kind == ROOT_PARAMETER_CONSTANTS) {
+			command_list->SetComputeRoot32BitConstants(pipeline->constants_parameter, 4, constants, 0);
+		}
+		else {
+			command_list->SetComputeRootConstantBufferView(
+				pipeline->constants_parameter,
+				upload_dispatch_constants(queue->uploads, constants, sizeof(constants))
+			);
+		}
+	}
+
+	groups = dispatch_size_for(&pipeline->kernel, job.width, job.height, 1);
+	command_list->Dispatch(groups.x, groups.y, groups.z);
+
+	submit_command_batch(dx12, queue, NULL, 0);
+}
+
+texel_rows gpu_job_backend::read_result() {
+	dx12_handler* dx12;
+	dx12_queue* queue;
+	ComPtr<ID3D12GraphicsCommandList> command_list;
+	queue_ticket copy_done;
+
+	dx12 = app->dx12;
+	queue = dx12->direct_queue;
+
+	command_list = begin_command_batch(queue, NULL);
+
+	require_resource_state(&dx12->resource_states, target->buffer.Get(), ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_COPY_SOURCE, false);
+	record_resource_barriers(dx12, command_list.Get());
+	record_readback_copy(command_list, target);
+
+	copy_done = submit_command_batch(dx12, queue, NULL, 0);
+	commit_readback_copy(target, dx12, &copy_done);
+
+	//
+	// Waits for the copy, and so for every iteration before it.
+	//
+
+	reading = begin_readback(&target->readback_slots);
+
+	if (reading == INVALID_READBACK_SLOT) {
+		throw exception();
+	}
+
+	return {
+		readback_slot_data(target, reading),
+		job.width,
+		job.height,
+		target->footprint_for_readback.Footprint.RowPitch,
+		job.format
+	};
+}
+
+void gpu_job_backend::release_result() {
+	end_readback(&target->readback_slots, reading);
+	reading = INVALID_READBACK_SLOT;
+}
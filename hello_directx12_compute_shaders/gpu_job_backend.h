@@ -0,0 +1,70 @@
+// Liam Wynn, 01/08/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	Runs job manifest jobs (see job_runner.h) on the device.
+
+	A job's kernel may bind u0, a texture the size and format of the
+	job, and b0, which gets (0, 0, width, height) the way the TILED
+	build of hello_compute takes its tile origin and image size. It
+	can't bind anything else. The root signature comes from reflecting
+	the kernel, and the dispatch is sized from its numthreads.
+
+	Pipelines are kept per kernel and entry point, and go through the
+	application's pipeline cache, so a warm run doesn't compile either.
+	Buffers are kept by width, height and format, the last
+	JOB_BUFFER_CACHE_SIZE of them.
+
+	Every iteration is a batch on the direct queue. read_result adds the
+	copy into a readback slot and waits for that, and the result is read
+	straight out of the mapped slot.
+*/
+
+#pragma once
+
+#include "application.h"
+#include "job_runner.h"
+#include <map>
+#include <utility>
+
+struct gpu_job_pipeline {
+	ComPtr<ID3D12PipelineState> pipeline_state;
+	shader_reflection kernel;
+	ComPtr<ID3D12RootSignature> root_signature;
+	root_layout layout;
+	unsigned int buffer_parameter;
+
+	bool has_constants;
+	unsigned int constants_parameter;
+};
+
+// Kernel and entry point.
+typedef std::pair<std::string, std::string> gpu_job_pipeline_key;
+
+struct gpu_job_backend : job_backend {
+	application* app;
+	std::map<gpu_job_pipeline_key, gpu_job_pipeline> pipelines;
+	job_buffer_cache<compute_buffer*> buffers;
+
+	// The current job, and the readback slot its result is in while it
+	// is being read.
+	job_desc job;
+	gpu_job_pipeline* pipeline;
+	compute_buffer* target;
+	unsigned int reading;
+
+	const char* name() override;
+	bool prepare(
+		const job_desc* job,
+		bool* reused_pipeline,
+		bool* reused_buffer,
+		std::string* reason
+	) override;
+	void run_iteration() override;
+	texel_rows read_result() override;
+	void release_result() override;
+};
+
+void initialize_gpu_job_backend(gpu_job_backend* backend, application* app);
+
+// The GPU has to be done with every job.
+void shutdown_gpu_job_backend(gpu_job_backend* backend);
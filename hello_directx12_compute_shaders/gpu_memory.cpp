@@ -0,0 +1,368 @@
+// Liam Wynn, 01/02/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "gpu_memory.h"
+#include "utils.h"
+
+using namespace std;
+
+void initialize_gpu_memory(
+	gpu_memory* memory,
+	ID3D12Device5* device,
+	const uint64_t block_size
+) {
+	memory->device = device;
+	memory->block_size = block_size;
+	memory->heaps_created = 0;
+	memory->resources_placed = 0;
+
+	memory->pools[GPU_POOL_DEFAULT_BUFFERS].heap_type = D3D12_HEAP_TYPE_DEFAULT;
+	memory->pools[GPU_POOL_DEFAULT_BUFFERS].heap_flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+
+	memory->pools[GPU_POOL_DEFAULT_TEXTURES].heap_type = D3D12_HEAP_TYPE_DEFAULT;
+	memory->pools[GPU_POOL_DEFAULT_TEXTURES].heap_flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+
+	memory->pools[GPU_POOL_READBACK_BUFFERS].heap_type = D3D12_HEAP_TYPE_READBACK;
+	memory->pools[GPU_POOL_READBACK_BUFFERS].heap_flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+
+	memory->pools[GPU_POOL_UPLOAD_BUFFERS].heap_type = D3D12_HEAP_TYPE_UPLOAD;
+	memory->pools[GPU_POOL_UPLOAD_BUFFERS].heap_flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+}
+
+gpu_allocation empty_gpu_allocation() {
+	gpu_allocation allocation;
+
+	allocation.pool = GPU_POOL_COUNT;
+	allocation.block = 0;
+	allocation.range = {};
+	allocation.range.block = TLSF_INVALID_BLOCK;
+
+	return allocation;
+}
+
+/*
+	Which pool a resource goes in.
+*/
+static gpu_memory_pool_kind pool_for_resource(
+	const D3D12_HEAP_TYPE heap_type,
+	const D3D12_RESOURCE_DESC* desc
+) {
+	if (desc->Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) {
+		throw exception();
+	}
+
+	switch (heap_type) {
+	case D3D12_HEAP_TYPE_DEFAULT:
+		return desc->Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ? GPU_POOL_DEFAULT_BUFFERS : GPU_POOL_DEFAULT_TEXTURES;
+	case D3D12_HEAP_TYPE_READBACK:
+		return GPU_POOL_READBACK_BUFFERS;
+	case D3D12_HEAP_TYPE_UPLOAD:
+		return GPU_POOL_UPLOAD_BUFFERS;
+	default:
+		throw exception();
+	}
+}
+
+/*
+	Adds a block of at least size bytes to pool and returns its index.
+*/
+static unsigned int grow_pool(
+	gpu_memory* memory,
+	gpu_memory_pool* pool,
+	const uint64_t size,
+	const uint64_t alignment
+) {
+	D3D12_HEAP_DESC heap_desc;
+	gpu_heap_block* block;
+	unsigned int index;
+	HRESULT result;
+
+	heap_desc = {};
+	heap_desc.Properties = CD3DX12_HEAP_PROPERTIES(pool->heap_type);
+	heap_desc.Alignment = alignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT
+		? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT
+		: D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	heap_desc.SizeInBytes = size > memory->block_size ? size : memory->block_size;
+	heap_desc.SizeInBytes = (heap_desc.SizeInBytes + heap_desc.Alignment - 1) & ~(heap_desc.Alignment - 1);
+	heap_desc.Flags = pool->heap_flags;
+
+	block = new gpu_heap_block;
+
+	result = memory->device->CreateHeap(&heap_desc, IID_PPV_ARGS(&block->heap));
+
+	if (FAILED(result)) {
+		delete block;
+		throw_if_failed(result);
+	}
+
+	initialize_tlsf(&block->allocator, heap_desc.SizeInBytes, D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT);
+	memory->heaps_created++;
+
+	//
+	// Reuse the slot of a released block if there is one.
+	//
+
+	for (index = 0; index < pool->blocks.size(); index++) {
+		if (pool->blocks[index] == NULL) {
+			pool->blocks[index] = block;
+			return index;
+		}
+	}
+
+	pool->blocks.push_back(block);
+
+	return index;
+}
+
+void allocate_gpu_memory(
+	gpu_memory* memory,
+	const gpu_memory_pool_kind pool_kind,
+	const uint64_t size,
+	const uint64_t alignment,
+	gpu_allocation* allocation
+) {
+	gpu_memory_pool* pool;
+	unsigned int index;
+
+	*allocation = empty_gpu_allocation();
+	pool = &memory->pools[pool_kind];
+
+	for (index = 0; index < pool->blocks.size(); index++) {
+		if (pool->blocks[index] == NULL) {
+			continue;
+		}
+
+		if (tlsf_allocate(&pool->blocks[index]->allocator, size, alignment, &allocation->range)) {
+			allocation->pool = pool_kind;
+			allocation->block = index;
+			return;
+		}
+	}
+
+	//
+	// Nothing had room. A new block always does, as long as it leaves
+	// room for the TLSF search to round up to a size class. size plus
+	// alignment isn't enough for a dedicated block.
+	//
+
+	index = grow_pool(
+		memory,
+		pool,
+		tlsf_block_size_for(size, alignment, D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT),
+		alignment
+	);
+
+	if (!tlsf_allocate(&pool->blocks[index]->allocator, size, alignment, &allocation->range)) {
+		throw exception();
+	}
+
+	allocation->pool = pool_kind;
+	allocation->block = index;
+}
+
+void free_gpu_memory(gpu_memory* memory, gpu_allocation* allocation) {
+	gpu_memory_pool* pool;
+	gpu_heap_block* block;
+	unsigned int live_blocks;
+
+	if (allocation->pool == GPU_POOL_COUNT) {
+		return;
+	}
+
+	pool = &memory->pools[allocation->pool];
+	block = pool->blocks[allocation->block];
+
+	tlsf_free(&block->allocator, &allocation->range);
+
+	//
+	// Give an empty block back to the driver, as long as the pool keeps
+	// one around for the next allocation.
+	//
+
+	if (block->allocator.allocations == 0) {
+		live_blocks = 0;
+
+		for (gpu_heap_block* b : pool->blocks) {
+			live_blocks += b != NULL ? 1 : 0;
+		}
+
+		if (live_blocks > 1) {
+			delete block;
+			pool->blocks[allocation->block] = NULL;
+		}
+	}
+
+	*allocation = empty_gpu_allocation();
+}
+
+static ID3D12Heap* allocation_heap(gpu_memory* memory, const gpu_allocation* allocation) {
+	return memory->pools[allocation->pool].blocks[allocation->block]->heap.Get();
+}
+
+void create_placed_resource(
+	gpu_memory* memory,
+	const D3D12_HEAP_TYPE heap_type,
+	const D3D12_RESOURCE_DESC* desc,
+	const D3D12_RESOURCE_STATES initial_state,
+	gpu_allocation* allocation,
+	ComPtr<ID3D12Resource>* resource
+) {
+	D3D12_RESOURCE_ALLOCATION_INFO info;
+	HRESULT result;
+
+	info = memory->device->GetResourceAllocationInfo(0, 1, desc);
+
+	if (info.SizeInBytes == UINT64_MAX) {
+		throw exception();
+	}
+
+	allocate_gpu_memory(
+		memory,
+		pool_for_resource(heap_type, desc),
+		info.SizeInBytes,
+		info.Alignment,
+		allocation
+	);
+
+	result = memory->device->CreatePlacedResource(
+		allocation_heap(memory, allocation),
+		allocation->range.offset,
+		desc,
+		initial_state,
+		NULL,
+		IID_PPV_ARGS(resource->ReleaseAndGetAddressOf())
+	);
+
+	if (FAILED(result)) {
+		free_gpu_memory(memory, allocation);
+		throw_if_failed(result);
+	}
+
+	memory->resources_placed++;
+}
+
+void create_transient_resources(
+	gpu_memory* memory,
+	const transient_resource_desc* descs,
+	const unsigned int num_descs,
+	transient_arena* arena
+) {
+	D3D12_RESOURCE_ALLOCATION_INFO info;
+	gpu_memory_pool_kind pool_kind;
+	HRESULT result;
+
+	arena->allocation = empty_gpu_allocation();
+	arena->requests.clear();
+	arena->resources.clear();
+
+	if (num_descs == 0) {
+		return;
+	}
+
+	pool_kind = pool_for_resource(D3D12_HEAP_TYPE_DEFAULT, &descs[0].desc);
+
+	for (unsigned int i = 0; i < num_descs; i++) {
+		transient_request request;
+
+		if (pool_for_resource(D3D12_HEAP_TYPE_DEFAULT, &descs[i].desc) != pool_kind) {
+			throw exception();
+		}
+
+		info = memory->device->GetResourceAllocationInfo(0, 1, &descs[i].desc);
+
+		request.size = info.SizeInBytes;
+		request.alignment = info.Alignment;
+		request.first_use = descs[i].first_use;
+		request.last_use = descs[i].last_use;
+
+		arena->requests.push_back(request);
+	}
+
+	//
+	// Work out who shares memory with whom, then allocate the whole
+	// arena at once and place every resource inside it.
+	//
+
+	plan_transient_aliasing(arena->requests.data(), num_descs, &arena->plan);
+
+	allocate_gpu_memory(
+		memory,
+		pool_kind,
+		arena->plan.arena_size,
+		arena->plan.arena_alignment,
+		&arena->allocation
+	);
+
+	arena->resources.resize(num_descs);
+
+	for (unsigned int i = 0; i < num_descs; i++) {
+		result = memory->device->CreatePlacedResource(
+			allocation_heap(memory, &arena->allocation),
+			arena->allocation.range.offset + arena->plan.offsets[i],
+			&descs[i].desc,
+			descs[i].initial_state,
+			NULL,
+			IID_PPV_ARGS(&arena->resources[i])
+		);
+
+		if (FAILED(result)) {
+			release_transient_arena(memory, arena);
+			throw_if_failed(result);
+		}
+
+		memory->resources_placed++;
+	}
+}
+
+void append_aliasing_barriers(
+	const transient_arena* arena,
+	const unsigned int pass,
+	vector<D3D12_RESOURCE_BARRIER>* barriers
+) {
+	for (size_t i = 0; i < arena->requests.size(); i++) {
+		const transient_request* request = &arena->requests[i];
+		bool shares_memory;
+
+		if (request->first_use != pass) {
+			continue;
+		}
+
+		//
+		// Only resources that overlap another one in memory need the
+		// barrier. The "before" resource is left NULL, which covers any
+		// resource that was using the memory.
+		//
+
+		shares_memory = false;
+
+		for (size_t j = 0; j < arena->requests.size() && !shares_memory; j++) {
+			uint64_t begin_i = arena->plan.offsets[i];
+			uint64_t begin_j = arena->plan.offsets[j];
+
+			shares_memory = j != i
+				&& begin_i < begin_j + arena->requests[j].size
+				&& begin_j < begin_i + request->size;
+		}
+
+		if (shares_memory) {
+			barriers->push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(NULL, arena->resources[i].Get()));
+		}
+	}
+}
+
+void release_transient_arena(gpu_memory* memory, transient_arena* arena) {
+	arena->resources.clear();
+	arena->requests.clear();
+	free_gpu_memory(memory, &arena->allocation);
+}
+
+void shutdown_gpu_memory(gpu_memory* memory) {
+	for (unsigned int p = 0; p < GPU_POOL_COUNT; p++) {
+		for (gpu_heap_block* block : memory->pools[p].blocks) {
+			delete block;
+		}
+
+		memory->pools[p].blocks.clear();
+	}
+
+	memory->device.Reset();
+}
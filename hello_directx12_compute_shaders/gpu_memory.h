@@ -0,0 +1,152 @@
+// Liam Wynn, 01/02/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	gpu_memory places resources in large ID3D12Heaps instead of giving
+	each one a committed resource (and so a heap, and a kernel call) of
+	its own.
+
+	There is a pool per kind of heap: default heap buffers, default heap
+	textures, readback buffers and upload buffers. Buffers and textures
+	are kept apart so this works on resource heap tier 1 hardware. Each
+	pool is a list of heap blocks, and each block has a TLSF allocator
+	(see suballocator.h) handing out its ranges. Sizes and alignments
+	come from GetResourceAllocationInfo.
+
+	When no block has room, the pool grows by a block of block_size
+	bytes, or a dedicated one for a resource bigger than that, sized with
+	tlsf_block_size_for so the resource always fits in it. A block
+	that empties out is released, unless it is the pool's only one.
+
+	Transient arenas alias resources. Give create_transient_resources
+	the resources of a job along with the passes each one is used in,
+	and the ones that are never live together are placed on top of each
+	other in one allocation. Before a pass, append_aliasing_barriers
+	adds the aliasing barriers for the resources that become live in
+	it.
+
+	Memory is only handed back by free_gpu_memory, and the caller has to
+	know the GPU is done with it, the same as for a committed resource.
+*/
+
+#pragma once
+
+#include "stdafx.h"
+#include "suballocator.h"
+#include <vector>
+
+// 256 MiB heaps.
+const uint64_t DEFAULT_GPU_MEMORY_BLOCK_SIZE = 256ULL * 1024 * 1024;
+
+enum gpu_memory_pool_kind {
+	GPU_POOL_DEFAULT_BUFFERS,
+	GPU_POOL_DEFAULT_TEXTURES,
+	GPU_POOL_READBACK_BUFFERS,
+	GPU_POOL_UPLOAD_BUFFERS,
+	GPU_POOL_COUNT
+};
+
+struct gpu_heap_block {
+	ComPtr<ID3D12Heap> heap;
+	tlsf_allocator allocator;
+};
+
+struct gpu_memory_pool {
+	D3D12_HEAP_TYPE heap_type;
+	D3D12_HEAP_FLAGS heap_flags;
+
+	// Released blocks leave a NULL behind, so allocations can keep
+	// their block index.
+	std::vector<gpu_heap_block*> blocks;
+};
+
+struct gpu_allocation {
+	// GPU_POOL_COUNT for no allocation.
+	gpu_memory_pool_kind pool;
+	unsigned int block;
+	tlsf_allocation range;
+};
+
+struct gpu_memory {
+	ComPtr<ID3D12Device5> device;
+	uint64_t block_size;
+	gpu_memory_pool pools[GPU_POOL_COUNT];
+
+	unsigned int heaps_created;
+	unsigned int resources_placed;
+};
+
+/*
+	Resources that live on top of each other in one allocation.
+	resources and requests are parallel, in the order they were given.
+*/
+struct transient_arena {
+	gpu_allocation allocation;
+	std::vector<transient_request> requests;
+	transient_plan plan;
+	std::vector<ComPtr<ID3D12Resource>> resources;
+};
+
+struct transient_resource_desc {
+	D3D12_RESOURCE_DESC desc;
+	D3D12_RESOURCE_STATES initial_state;
+	unsigned int first_use;
+	unsigned int last_use;
+};
+
+void initialize_gpu_memory(
+	gpu_memory* memory,
+	ID3D12Device5* device,
+	const uint64_t block_size
+);
+
+gpu_allocation empty_gpu_allocation();
+
+// Throws if the pool can't grow.
+void allocate_gpu_memory(
+	gpu_memory* memory,
+	const gpu_memory_pool_kind pool,
+	const uint64_t size,
+	const uint64_t alignment,
+	gpu_allocation* allocation
+);
+
+void free_gpu_memory(gpu_memory* memory, gpu_allocation* allocation);
+
+/*
+	Allocates memory for desc on a heap of heap_type and creates a
+	placed resource there. Render targets and depth buffers aren't
+	supported.
+*/
+void create_placed_resource(
+	gpu_memory* memory,
+	const D3D12_HEAP_TYPE heap_type,
+	const D3D12_RESOURCE_DESC* desc,
+	const D3D12_RESOURCE_STATES initial_state,
+	gpu_allocation* allocation,
+	ComPtr<ID3D12Resource>* resource
+);
+
+/*
+	Every resource has to go in the same pool: all buffers or all
+	textures.
+*/
+void create_transient_resources(
+	gpu_memory* memory,
+	const transient_resource_desc* descs,
+	const unsigned int num_descs,
+	transient_arena* arena
+);
+
+/*
+	Aliasing barriers for the resources first used in pass that share
+	memory with another resource of the arena.
+*/
+void append_aliasing_barriers(
+	const transient_arena* arena,
+	const unsigned int pass,
+	std::vector<D3D12_RESOURCE_BARRIER>* barriers
+);
+
+void release_transient_arena(gpu_memory* memory, transient_arena* arena);
+
+void shutdown_gpu_memory(gpu_memory* memory);
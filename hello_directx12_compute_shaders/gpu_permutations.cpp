@@ -0,0 +1,121 @@
+// Liam Wynn, 01/12/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "gpu_permutations.h"
+#include <iostream>
+
+using namespace std;
+
+const char* fxc_cached_compiler::name() {
+	return "fxc";
+}
+
+bool fxc_cached_compiler::compile(
+	const permutation_set* set,
+	const shader_defines& defines,
+	vector<unsigned char>* bytecode,
+	string* error
+) {
+	shader_cache_key key;
+
+	if (!make_shader_cache_key(set->source_path, defines, set->entry_point, set->profile, compile_flags, &key)) {
+		*error = "could not read " + set->source_path;
+		return false;
+	}
+
+	{
+		lock_guard<mutex> guard(lock);
+
+		if (load_cached_shader(&cache->shaders, &key, bytecode)) {
+			return true;
+		}
+	}
+
+	if (!compile_shader_uncached(set->source_path, defines, set->entry_point, set->profile, compile_flags, bytecode, error)) {
+		return false;
+	}
+
+	{
+		lock_guard<mutex> guard(lock);
+		store_cached_shader(&cache->shaders, &key, bytecode->data(), bytecode->size());
+	}
+
+	return true;
+}
+
+void initialize_fxc_cached_compiler(fxc_cached_compiler* compiler, application* app) {
+	compiler->cache = app->pipelines;
+	compiler->compile_flags = 0;
+
+#if defined(_DEBUG)
+	compiler->compile_flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+}
+
+bool build_permutation_pipelines(
+	application* app,
+	const permutation_set* set,
+	const unsigned int num_threads,
+	permutation_table<permutation_pipeline>* table,
+	permutation_compile_stats* stats
+) {
+	fxc_cached_compiler compiler;
+	vector<compiled_permutation> results;
+	bool ok;
+
+	initialize_fxc_cached_compiler(&compiler, app);
+	initialize_permutation_table(table, set);
+
+	results = compile_permutations(set, enumerate_permutations(set), &compiler, num_threads, stats);
+	ok = stats->failed == 0;
+
+	for (const compiled_permutation& result : results) {
+		permutation_pipeline pipeline;
+		shader_cache_key shader_key;
+		uint64_t root_signature_hash;
+
+		if (!result.ok) {
+			cerr << permutation_name(set, result.key) << ": " << result.error << endl;
+			continue;
+		}
+
+		//
+		// The pipeline library names pipelines after the shader key,
+		// which is the same key the compile was cached under.
+		//
+
+		make_shader_cache_key(
+			set->source_path,
+			permutation_defines(set, result.key),
+			set->entry_point,
+			set->profile,
+			compiler.compile_flags,
+			&shader_key
+		);
+
+		if (!reflect_compute_shader(result.bytecode, &pipeline.kernel) || !build_root_layout(&pipeline.kernel, &pipeline.layout)) {
+			cerr << permutation_name(set, result.key) << ": could not build a root signature" << endl;
+			ok = false;
+			continue;
+		}
+
+		pipeline.root_signature = get_root_signature(
+			app->root_signatures,
+			app->dx12,
+			&pipeline.layout,
+			&root_signature_hash
+		);
+
+		pipeline.pipeline_state = load_or_create_compute_pipeline(
+			app->pipelines,
+			app->dx12,
+			pipeline.root_signature.Get(),
+			root_signature_hash,
+			result.bytecode,
+			&shader_key
+		);
+
+		set_permutation(table, result.key, pipeline);
+	}
+
+	return ok;
+}
@@ -0,0 +1,59 @@
+// Liam Wynn, 01/12/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The DirectX half of shader permutations (see shader_permutations.h).
+
+	fxc_cached_compiler compiles a permutation with FXC through the
+	application's shader cache. The cache isn't thread-safe, so the
+	lookups and stores take a lock, but the compiles themselves, which
+	are where the time goes, run at the same time.
+
+	build_permutation_pipelines compiles every permutation of a set on a
+	pool of threads, then reflects each one and builds its root
+	signature and pipeline on the calling thread: the root signature
+	cache and the pipeline library aren't thread-safe, and on a warm
+	start they are only lookups anyway. The pipelines go into a
+	permutation_table, so the dispatch path finds one by its key.
+*/
+
+#pragma once
+
+#include "application.h"
+#include "shader_permutations.h"
+#include <mutex>
+
+struct fxc_cached_compiler : permutation_compiler {
+	pipeline_cache* cache;
+	UINT compile_flags;
+	std::mutex lock;
+
+	const char* name() override;
+	bool compile(
+		const permutation_set* set,
+		const shader_defines& defines,
+		std::vector<unsigned char>* bytecode,
+		std::string* error
+	) override;
+};
+
+void initialize_fxc_cached_compiler(fxc_cached_compiler* compiler, application* app);
+
+struct permutation_pipeline {
+	ComPtr<ID3D12PipelineState> pipeline_state;
+	ComPtr<ID3D12RootSignature> root_signature;
+	shader_reflection kernel;
+	root_layout layout;
+};
+
+/*
+	Builds every permutation of set on num_threads threads (0 for one
+	per hardware thread) into table. Permutations that don't compile
+	are printed and left out of the table. Returns false if any didn't.
+*/
+bool build_permutation_pipelines(
+	application* app,
+	const permutation_set* set,
+	const unsigned int num_threads,
+	permutation_table<permutation_pipeline>* table,
+	permutation_compile_stats* stats
+);
@@ -0,0 +1,236 @@
+// Liam Wynn, 12/27/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "gpu_profiler.h"
+#include "utils.h"
+#include <map>
+
+using namespace std;
+
+void initialize_gpu_profiler(
+	gpu_profiler* gpu_prof,
+	dx12_handler* dx12,
+	const unsigned int max_markers
+) {
+	D3D12_QUERY_HEAP_DESC heap_desc;
+	D3D12_FEATURE_DATA_D3D12_OPTIONS3 options;
+	CD3DX12_HEAP_PROPERTIES heap_properties;
+	CD3DX12_RESOURCE_DESC buffer_desc;
+	HRESULT result;
+
+	gpu_prof->max_markers = max_markers;
+	gpu_prof->dropped_markers = 0;
+	gpu_prof->markers.clear();
+	gpu_prof->markers.reserve(max_markers);
+
+	//
+	// Two timestamps per marker.
+	//
+
+	heap_desc = {};
+	heap_desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	heap_desc.Count = max_markers * 2;
+	heap_desc.NodeMask = 0;
+
+	result = dx12->device->CreateQueryHeap(&heap_desc, IID_PPV_ARGS(&gpu_prof->query_heap));
+	throw_if_failed(result);
+
+	//
+	// The copy queue's heap has a slot for every marker too, so a
+	// marker's queries are at the same index whichever heap they are in.
+	//
+
+	options = {};
+	result = dx12->device->CheckFeatureSupport(
+		D3D12_FEATURE_D3D12_OPTIONS3,
+		&options,
+		sizeof(options)
+	);
+
+	gpu_prof->copy_queue_timestamps = SUCCEEDED(result) && options.CopyQueueTimestampQueriesSupported;
+
+	if (gpu_prof->copy_queue_timestamps) {
+		heap_desc.Type = D3D12_QUERY_HEAP_TYPE_COPY_QUEUE_TIMESTAMP;
+
+		result = dx12->device->CreateQueryHeap(&heap_desc, IID_PPV_ARGS(&gpu_prof->copy_query_heap));
+		throw_if_failed(result);
+	}
+
+	heap_properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+	buffer_desc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(UINT64) * max_markers * 2);
+
+	result = dx12->device->CreateCommittedResource(
+		&heap_properties,
+		D3D12_HEAP_FLAG_NONE,
+		&buffer_desc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		NULL,
+		IID_PPV_ARGS(&gpu_prof->readback_buffer)
+	);
+
+	throw_if_failed(result);
+}
+
+// The heap queue's command lists can write timestamps to.
+static ID3D12QueryHeap* marker_query_heap(gpu_profiler* gpu_prof, dx12_queue* queue) {
+	return queue->kind == QUEUE_COPY ? gpu_prof->copy_query_heap.Get() : gpu_prof->query_heap.Get();
+}
+
+unsigned int begin_gpu_marker(
+	gpu_profiler* gpu_prof,
+	dx12_queue* queue,
+	ID3D12GraphicsCommandList* command_list,
+	const char* name
+) {
+	gpu_marker marker;
+
+	if (gpu_prof == NULL) {
+		return INVALID_GPU_MARKER;
+	}
+
+	if (queue->kind == QUEUE_COPY && !gpu_prof->copy_queue_timestamps) {
+		return INVALID_GPU_MARKER;
+	}
+
+	if (gpu_prof->markers.size() == gpu_prof->max_markers) {
+		gpu_prof->dropped_markers++;
+		return INVALID_GPU_MARKER;
+	}
+
+	marker.name = name;
+	marker.queue = queue;
+	marker.first_query = (unsigned int)gpu_prof->markers.size() * 2;
+	marker.ended = false;
+
+	command_list->EndQuery(marker_query_heap(gpu_prof, queue), D3D12_QUERY_TYPE_TIMESTAMP, marker.first_query);
+	gpu_prof->markers.push_back(marker);
+
+	return (unsigned int)gpu_prof->markers.size() - 1;
+}
+
+void end_gpu_marker(
+	gpu_profiler* gpu_prof,
+	ID3D12GraphicsCommandList* command_list,
+	const unsigned int marker
+) {
+	gpu_marker* m;
+
+	if (gpu_prof == NULL || marker == INVALID_GPU_MARKER) {
+		return;
+	}
+
+	m = &gpu_prof->markers[marker];
+
+	command_list->EndQuery(marker_query_heap(gpu_prof, m->queue), D3D12_QUERY_TYPE_TIMESTAMP, m->first_query + 1);
+
+	command_list->ResolveQueryData(
+		marker_query_heap(gpu_prof, m->queue),
+		D3D12_QUERY_TYPE_TIMESTAMP,
+		m->first_query,
+		2,
+		gpu_prof->readback_buffer.Get(),
+		sizeof(UINT64) * m->first_query
+	);
+
+	m->ended = true;
+}
+
+/*
+	How to turn one queue's GPU ticks into profiler microseconds.
+*/
+struct queue_clock {
+	UINT64 frequency;
+	UINT64 gpu_calibration;
+	double cpu_calibration_us;
+};
+
+static queue_clock calibrate_queue_clock(dx12_queue* queue, profiler* prof) {
+	queue_clock clock;
+	UINT64 cpu_ticks;
+	LARGE_INTEGER cpu_frequency;
+	chrono::steady_clock::time_point cpu_now;
+	LARGE_INTEGER cpu_ticks_now;
+	double cpu_offset_us;
+
+	throw_if_failed(queue->command_queue->GetTimestampFrequency(&clock.frequency));
+	throw_if_failed(queue->command_queue->GetClockCalibration(&clock.gpu_calibration, &cpu_ticks));
+
+	//
+	// The calibration's CPU side is in QueryPerformanceCounter ticks.
+	// Sample QPC and steady_clock together to move it onto the
+	// profiler's clock.
+	//
+
+	QueryPerformanceFrequency(&cpu_frequency);
+	QueryPerformanceCounter(&cpu_ticks_now);
+	cpu_now = chrono::steady_clock::now();
+
+	cpu_offset_us = ((double)cpu_ticks - (double)cpu_ticks_now.QuadPart) * 1.0e6 / (double)cpu_frequency.QuadPart;
+	clock.cpu_calibration_us = profiler_time_us(prof, cpu_now) + cpu_offset_us;
+
+	return clock;
+}
+
+void collect_gpu_markers(gpu_profiler* gpu_prof, profiler* prof) {
+	map<dx12_queue*, queue_clock> clocks;
+	D3D12_RANGE read_range;
+	D3D12_RANGE written_range;
+	UINT64* timestamps;
+	HRESULT result;
+
+	if (gpu_prof == NULL || gpu_prof->markers.empty()) {
+		return;
+	}
+
+	read_range = { 0, sizeof(UINT64) * gpu_prof->markers.size() * 2 };
+	written_range = { 0, 0 };
+
+	result = gpu_prof->readback_buffer->Map(0, &read_range, (void**)&timestamps);
+	throw_if_failed(result);
+
+	for (const gpu_marker& marker : gpu_prof->markers) {
+		queue_clock* clock;
+		double start_us;
+		double duration_us;
+		UINT64 begin;
+		UINT64 end;
+
+		if (!marker.ended) {
+			continue;
+		}
+
+		if (clocks.find(marker.queue) == clocks.end()) {
+			clocks[marker.queue] = calibrate_queue_clock(marker.queue, prof);
+		}
+
+		clock = &clocks[marker.queue];
+		begin = timestamps[marker.first_query];
+		end = timestamps[marker.first_query + 1];
+
+		start_us = clock->cpu_calibration_us
+			+ ((double)begin - (double)clock->gpu_calibration) * 1.0e6 / (double)clock->frequency;
+		duration_us = (double)(end - begin) * 1.0e6 / (double)clock->frequency;
+
+		record_profile_event(
+			prof,
+			string("gpu: ") + queue_kind_name(marker.queue->kind),
+			marker.name,
+			start_us,
+			duration_us
+		);
+	}
+
+	gpu_prof->readback_buffer->Unmap(0, &written_range);
+
+	//
+	// Every query is free again.
+	//
+
+	gpu_prof->markers.clear();
+}
+
+void shutdown_gpu_profiler(gpu_profiler* gpu_prof) {
+	gpu_prof->markers.clear();
+	gpu_prof->readback_buffer.Reset();
+	gpu_prof->query_heap.Reset();
+	gpu_prof->copy_query_heap.Reset();
+}
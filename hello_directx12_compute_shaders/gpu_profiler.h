@@ -0,0 +1,84 @@
+// Liam Wynn, 12/27/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The GPU profiler times phases of command lists with timestamp
+	queries.
+
+	begin_gpu_marker and end_gpu_marker each write a timestamp into the
+	query heap. end_gpu_marker also resolves the pair into the readback
+	buffer, so nothing extra has to be recorded before a submission.
+	Once the GPU is done (after a flush), collect_gpu_markers reads the
+	readback buffer, converts ticks to the CPU clock with the queue's
+	clock calibration, and hands the markers to the profiler on a
+	"gpu: <queue>" track.
+
+	Queries are handed out in order and only come back when collected,
+	so markers past max_markers are dropped (and counted) rather than
+	overwriting ones the GPU may not have written yet.
+
+	Timestamps on the copy queue need driver support, and a query heap
+	of their own: copy command lists can only write to a
+	D3D12_QUERY_HEAP_TYPE_COPY_QUEUE_TIMESTAMP heap. Markers on a copy
+	queue go into that one, and are skipped on drivers without it.
+	Either way a marker's timestamps land in the same place in the
+	readback buffer.
+*/
+
+#pragma once
+
+#include "stdafx.h"
+#include "dx12_handler.h"
+#include "profiler.h"
+#include <string>
+#include <vector>
+
+const unsigned int INVALID_GPU_MARKER = 0xFFFFFFFF;
+
+struct gpu_marker {
+	std::string name;
+	dx12_queue* queue;
+	unsigned int first_query;
+	bool ended;
+};
+
+struct gpu_profiler {
+	ComPtr<ID3D12QueryHeap> query_heap;
+
+	// NULL unless copy_queue_timestamps.
+	ComPtr<ID3D12QueryHeap> copy_query_heap;
+	ComPtr<ID3D12Resource> readback_buffer;
+	unsigned int max_markers;
+
+	std::vector<gpu_marker> markers;
+	unsigned int dropped_markers;
+
+	bool copy_queue_timestamps;
+};
+
+void initialize_gpu_profiler(
+	gpu_profiler* gpu_prof,
+	dx12_handler* dx12,
+	const unsigned int max_markers
+);
+
+// Returns INVALID_GPU_MARKER if the marker couldn't be placed.
+unsigned int begin_gpu_marker(
+	gpu_profiler* gpu_prof,
+	dx12_queue* queue,
+	ID3D12GraphicsCommandList* command_list,
+	const char* name
+);
+
+void end_gpu_marker(
+	gpu_profiler* gpu_prof,
+	ID3D12GraphicsCommandList* command_list,
+	const unsigned int marker
+);
+
+/*
+	Reads back every ended marker and records it in prof. Every queue
+	the markers were recorded on has to be flushed first.
+*/
+void collect_gpu_markers(gpu_profiler* gpu_prof, profiler* prof);
+
+void shutdown_gpu_profiler(gpu_profiler* gpu_prof);
@@ -0,0 +1,99 @@
+// Liam Wynn, 01/07/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "gpu_split_device.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+void initialize_gpu_split_device(
+	gpu_split_device* device,
+	application* app,
+	const unsigned int image_width,
+	const unsigned int image_height
+) {
+	tile_grid grid;
+
+	device->app = app;
+	device->label = "gpu " + app->dx12->adapter_key;
+
+	//
+	// One tile, the whole image. Bands are cut out of it by hand.
+	//
+
+	if (!plan_tile_grid(image_width, image_height, image_width, image_height, 0, &grid)) {
+		throw exception();
+	}
+
+	initialize_gpu_tile_backend(&device->tiles, app, &grid, 1);
+}
+
+void shutdown_gpu_split_device(gpu_split_device* device) {
+	shutdown_gpu_tile_backend(&device->tiles);
+}
+
+const char* gpu_split_device::name() {
+	return label.c_str();
+}
+
+string gpu_split_device::probe_key() {
+	return app->dx12->adapter_key;
+}
+
+void gpu_split_device::submit_band(
+	const cpu_dispatch_desc* dispatch,
+	const split_band* band,
+	const cpu_texture* output
+) {
+	unsigned int first_row;
+	unsigned int last_row;
+
+	//
+	// Group rows to texel rows, clipped to the image. The band's groups
+	// are the dispatch's, whatever group size the device's kernel has.
+	//
+
+	first_row = min(band->first_group_y * dispatch->group_size_y, output->height);
+	last_row = min((band->first_group_y + band->group_count_y) * dispatch->group_size_y, output->height);
+
+	this->band.index = 0;
+	this->band.core_x = 0;
+	this->band.core_y = first_row;
+	this->band.core_width = output->width;
+	this->band.core_height = last_row - first_row;
+	this->band.x = 0;
+	this->band.y = first_row;
+	this->band.width = output->width;
+	this->band.height = last_row - first_row;
+	this->output = *output;
+
+	start = chrono::steady_clock::now();
+
+	if (this->band.height > 0) {
+		tiles.submit_tile(&this->band, 0, NULL);
+	}
+}
+
+double gpu_split_device::finish_band() {
+	chrono::duration<double> elapsed;
+	const unsigned char* region;
+	uint64_t row_pitch;
+
+	if (band.height > 0) {
+		region = tiles.finish_tile(0, &row_pitch);
+
+		for (unsigned int y = 0; y < band.height; y++) {
+			memcpy(
+				output.data + (size_t)(band.y + y) * output.row_pitch,
+				region + y * row_pitch,
+				(size_t)band.width * CPU_FLOAT4_SIZE
+			);
+		}
+
+		tiles.release_tile(0);
+	}
+
+	elapsed = chrono::steady_clock::now() - start;
+
+	return elapsed.count();
+}
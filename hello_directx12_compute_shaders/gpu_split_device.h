@@ -0,0 +1,56 @@
+// Liam Wynn, 01/07/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	Runs a device set's bands (see device_set.h) on an adapter.
+
+	A band is a tile of the whole image: full width, the band's rows.
+	It goes through a gpu_tile_backend with one slot, so it is the
+	TILED build of hello_compute and computes its rows from the image
+	size, the same as the CPU would. finish_band waits for the copy and
+	puts the rows where they go in the set's output.
+
+	The slot is big enough for the whole image, since the split can
+	hand one device nearly all of it. Only the band's rows are
+	dispatched and read back, so a band's time is what its own rows
+	cost, not the image's.
+*/
+
+#pragma once
+
+#include "application.h"
+#include "device_set.h"
+#include "gpu_tile_backend.h"
+#include <chrono>
+
+struct gpu_split_device : compute_device {
+	application* app;
+	gpu_tile_backend tiles;
+	std::string label;
+
+	// The band in flight.
+	tile_desc band;
+	cpu_texture output;
+	std::chrono::steady_clock::time_point start;
+
+	const char* name() override;
+	std::string probe_key() override;
+	void submit_band(
+		const cpu_dispatch_desc* dispatch,
+		const split_band* band,
+		const cpu_texture* output
+	) override;
+	double finish_band() override;
+};
+
+/*
+	app has to have a device. Throws if the image is too big for one
+	slot or the kernel can't be set up.
+*/
+void initialize_gpu_split_device(
+	gpu_split_device* device,
+	application* app,
+	const unsigned int image_width,
+	const unsigned int image_height
+);
+
+void shutdown_gpu_split_device(gpu_split_device* device);
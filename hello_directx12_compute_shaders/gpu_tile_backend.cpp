@@ -0,0 +1,205 @@
+// Liam Wynn, 01/05/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "gpu_tile_backend.h"
+#include "gpu_upload.h"
+#include "utils.h"
+#include <string>
+
+using namespace std;
+
+void initialize_gpu_tile_backend(
+	gpu_tile_backend* backend,
+	application* app,
+	const tile_grid* grid,
+	const unsigned int num_slots
+) {
+	vector<unsigned char> bytecode;
+	shader_cache_key shader_key;
+	unsigned int table_offset;
+	uint64_t root_signature_hash;
+
+	backend->app = app;
+	backend->grid = *grid;
+
+	if (grid->max_region_width > GPU_TILE_MAX_REGION || grid->max_region_height > GPU_TILE_MAX_REGION) {
+		throw exception();
+	}
+
+	//
+	// The TILED build binds b0 on top of u0, so it gets a root
+	// signature of its own.
+	//
+
+	bytecode = compile_kernel(app, { { "TILED", "1" } }, &shader_key);
+
+	if (!reflect_compute_shader(bytecode, &backend->kernel)
+		|| !build_root_layout(&backend->kernel, &backend->layout)
+		|| !find_root_binding(&backend->layout, SHADER_BINDING_UAV, 0, 0, &backend->buffer_parameter, &table_offset)
+		|| !find_root_binding(&backend->layout, SHADER_BINDING_CBV, 0, 0, &backend->constants_parameter, &table_offset)) {
+		throw exception();
+	}
+
+	backend->root_signature = get_root_signature(
+		app->root_signatures,
+		app->dx12,
+		&backend->layout,
+		&root_signature_hash
+	);
+
+	backend->pipeline_state = load_or_create_compute_pipeline(
+		app->pipelines,
+		app->dx12,
+		backend->root_signature.Get(),
+		root_signature_hash,
+		bytecode,
+		&shader_key
+	);
+
+	//
+	// One buffer per tile in flight, each big enough for any tile.
+	//
+
+	for (unsigned int i = 0; i < (num_slots == 0 ? 1 : num_slots); i++) {
+		backend->slots.push_back(new compute_buffer);
+		backend->slots[i]->uav_index = INVALID_DESCRIPTOR_INDEX;
+
+		initialize_compute_buffer(
+			backend->slots[i],
+			app->dx12,
+			grid->max_region_width,
+			grid->max_region_height,
+			DXGI_FORMAT_R32G32B32A32_FLOAT
+		);
+	}
+
+	backend->reading.assign(backend->slots.size(), INVALID_READBACK_SLOT);
+}
+
+void shutdown_gpu_tile_backend(gpu_tile_backend* backend) {
+	flush_command_batches(backend->app->dx12->direct_queue);
+
+	//
+	// A slot that failed to initialize may not have its descriptor.
+	//
+
+	for (compute_buffer* cb : backend->slots) {
+		if (cb->uav_index != INVALID_DESCRIPTOR_INDEX) {
+			shutdown_compute_buffer(cb, backend->app->dx12);
+		}
+
+		delete cb;
+	}
+
+	backend->slots.clear();
+	backend->pipeline_state.Reset();
+	backend->root_signature.Reset();
+}
+
+const char* gpu_tile_backend::name() {
+	return "gpu";
+}
+
+void gpu_tile_backend::submit_tile(
+	const tile_desc* tile,
+	const unsigned int slot,
+	tile_input* input
+) {
+	dx12_handler* dx12;
+	dx12_queue* queue;
+	compute_buffer* cb;
+	ComPtr<ID3D12GraphicsCommandList> command_list;
+	uint32_t constants[4];
+	dispatch_group_count groups;
+	uint64_t row_pitch;
+	queue_ticket copy_done;
+
+	dx12 = app->dx12;
+	queue = dx12->direct_queue;
+	cb = slots[slot];
+
+	command_list = begin_command_batch(queue, pipeline_state.Get());
+
+	//
+	// Stage the input, if any, and copy it into the buffer through the
+	// upload ring.
+	//
+
+	if (input != NULL) {
+		row_pitch = (uint64_t)cb->width * CPU_FLOAT4_SIZE;
+		input_staging.resize((size_t)(row_pitch * cb->height));
+
+		input->read_tile(tile, input_staging.data(), row_pitch);
+		record_compute_buffer_upload(dx12, queue, command_list.Get(), cb, input_staging.data(), row_pitch);
+	}
+
+	require_resource_state(&dx12->resource_states, cb->buffer.Get(), ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+	record_resource_barriers(dx12, command_list.Get());
+
+	ID3D12DescriptorHeap* heaps[] = { dx12->cbv_srv_uav_heap->heap.Get() };
+	command_list->SetDescriptorHeaps(1, heaps);
+	command_list->SetComputeRootSignature(root_signature.Get());
+	command_list->SetComputeRootDescriptorTable(buffer_parameter, heap_gpu_handle(dx12->cbv_srv_uav_heap, cb->uav_index));
+
+	//
+	// tile_origin and image_size. They fit in root constants, but a
+	// layout that had to give those up gets them through the ring.
+	//
+
+	constants[0] = tile->x;
+	constants[1] = tile->y;
+	constants[2] = grid.image_width;
+	constants[3] = grid.image_height;
+
+	if (layout.parameters[constants_parameter].kind == ROOT_PARAMETER_CONSTANTS) {
+		command_list->SetComputeRoot32BitConstants(constants_parameter, 4, constants, 0);
+	}
+	else {
+		command_list->SetComputeRootConstantBufferView(
+			constants_parameter,
+			upload_dispatch_constants(queue->uploads, constants, sizeof(constants))
+		);
+	}
+
+	//
+	// Only the tile's region, dispatched and copied back. The rest of
+	// the buffer is left alone.
+	//
+
+	groups = dispatch_size_for(&kernel, tile->width, tile->height, 1);
+	command_list->Dispatch(groups.x, groups.y, groups.z);
+
+	require_resource_state(&dx12->resource_states, cb->buffer.Get(), ALL_TRACKED_SUBRESOURCES, D3D12_RESOURCE_STATE_COPY_SOURCE, false);
+	record_resource_barriers(dx12, command_list.Get());
+	record_readback_region(command_list, cb, tile->width, tile->height);
+
+	copy_done = submit_command_batch(dx12, queue, NULL, 0);
+	commit_readback_copy(cb, dx12, &copy_done);
+}
+
+const unsigned char* gpu_tile_backend::finish_tile(
+	const unsigned int slot,
+	uint64_t* row_pitch
+) {
+	compute_buffer* cb;
+
+	cb = slots[slot];
+
+	//
+	// Waits for this tile's copy only.
+	//
+
+	reading[slot] = begin_readback(&cb->readback_slots);
+
+	if (reading[slot] == INVALID_READBACK_SLOT) {
+		throw exception();
+	}
+
+	*row_pitch = cb->footprint_for_readback.Footprint.RowPitch;
+
+	return readback_slot_data(cb, reading[slot]);
+}
+
+void gpu_tile_backend::release_tile(const unsigned int slot) {
+	end_readback(&slots[slot]->readback_slots, reading[slot]);
+	reading[slot] = INVALID_READBACK_SLOT;
+}
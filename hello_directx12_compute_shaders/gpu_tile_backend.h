@@ -0,0 +1,69 @@
+// Liam Wynn, 01/05/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	Runs tiled jobs (see tiler.h) on the device.
+
+	Every slot is a compute_buffer the size of the biggest tile region,
+	so the memory used is fixed by the number of tiles in flight, not by
+	the image. A tile is one batch on the direct queue: upload its input
+	through the queue's upload ring if there is any, dispatch the TILED
+	build of hello_compute, and copy the result into a readback slot.
+	finish_tile only waits for that tile's copy, so the GPU works on the
+	next tiles while the CPU writes out this one.
+
+	The TILED kernel takes the tile origin and image size in b0. The
+	root signature builder turns those into root constants.
+*/
+
+#pragma once
+
+#include "application.h"
+#include "tiler.h"
+
+// Biggest tile region the device allows.
+const unsigned int GPU_TILE_MAX_REGION = D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION;
+
+struct gpu_tile_backend : tile_backend {
+	application* app;
+	tile_grid grid;
+
+	// The TILED kernel, its layout and where u0 and b0 went.
+	shader_reflection kernel;
+	root_layout layout;
+	unsigned int buffer_parameter;
+	unsigned int constants_parameter;
+	ComPtr<ID3D12RootSignature> root_signature;
+	ComPtr<ID3D12PipelineState> pipeline_state;
+
+	std::vector<compute_buffer*> slots;
+
+	// The readback slot each slot's tile was copied into, while it is
+	// being read.
+	std::vector<unsigned int> reading;
+
+	// Staging for tile input on its way to the upload ring.
+	std::vector<unsigned char> input_staging;
+
+	const char* name() override;
+	void submit_tile(
+		const tile_desc* tile,
+		const unsigned int slot,
+		tile_input* input
+	) override;
+	const unsigned char* finish_tile(
+		const unsigned int slot,
+		uint64_t* row_pitch
+	) override;
+	void release_tile(const unsigned int slot) override;
+};
+
+// Throws if the kernel or a slot can't be created.
+void initialize_gpu_tile_backend(
+	gpu_tile_backend* backend,
+	application* app,
+	const tile_grid* grid,
+	const unsigned int num_slots
+);
+
+// The GPU has to be done with every tile.
+void shutdown_gpu_tile_backend(gpu_tile_backend* backend);
@@ -0,0 +1,198 @@
+// Liam Wynn, 01/03/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "gpu_upload.h"
+#include "utils.h"
+#include <cstring>
+
+void initialize_gpu_upload_ring(
+	gpu_upload_ring* uploads,
+	dx12_handler* dx12,
+	fence_timeline* timeline,
+	const uint64_t size
+) {
+	D3D12_RESOURCE_DESC desc;
+	D3D12_RANGE no_reads;
+	void* mapped;
+	HRESULT result;
+
+	if (size % D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT != 0) {
+		throw std::exception();
+	}
+
+	desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+	//
+	// Upload heap resources have to start, and stay, in GENERIC_READ.
+	//
+
+	create_placed_resource(
+		dx12->memory,
+		D3D12_HEAP_TYPE_UPLOAD,
+		&desc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		&uploads->memory,
+		&uploads->buffer
+	);
+
+	//
+	// Map it once for the life of the ring. The CPU never reads it.
+	//
+
+	no_reads = { 0, 0 };
+	result = uploads->buffer->Map(0, &no_reads, &mapped);
+	throw_if_failed(result);
+
+	uploads->gpu_address = uploads->buffer->GetGPUVirtualAddress();
+	uploads->bytes_uploaded = 0;
+
+	initialize_upload_ring(&uploads->ring, (unsigned char*)mapped, size, timeline);
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS upload_dispatch_constants(
+	gpu_upload_ring* uploads,
+	const void* data,
+	const uint64_t size
+) {
+	upload_allocation allocation;
+
+	if (!allocate_upload(&uploads->ring, size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, &allocation)) {
+		throw std::exception();
+	}
+
+	memcpy(allocation.cpu_address, data, (size_t)size);
+	uploads->bytes_uploaded += size;
+
+	return uploads->gpu_address + allocation.offset;
+}
+
+void record_compute_buffer_upload(
+	dx12_handler* dx12,
+	dx12_queue* queue,
+	ID3D12GraphicsCommandList* command_list,
+	compute_buffer* cb,
+	const void* data,
+	const uint64_t row_pitch
+) {
+	gpu_upload_ring* uploads;
+	D3D12_RESOURCE_DESC desc;
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+	UINT num_rows;
+	UINT64 row_size_in_bytes;
+	UINT64 total_size;
+	upload_allocation allocation;
+	D3D12_TEXTURE_COPY_LOCATION src_location;
+	D3D12_TEXTURE_COPY_LOCATION dst_location;
+
+	uploads = queue->uploads;
+
+	// The copy queue has no ring.
+	if (uploads == NULL) {
+		throw std::exception();
+	}
+
+	//
+	// A structured or raw buffer takes the data as it is.
+	//
+
+	if (is_linear_compute_buffer(cb)) {
+		if (!allocate_upload(&uploads->ring, cb->size_in_bytes, D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT, &allocation)) {
+			throw std::exception();
+		}
+
+		memcpy(allocation.cpu_address, data, (size_t)cb->size_in_bytes);
+		uploads->bytes_uploaded += cb->size_in_bytes;
+
+		require_resource_state(
+			&dx12->resource_states,
+			cb->buffer.Get(),
+			ALL_TRACKED_SUBRESOURCES,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			true
+		);
+		record_resource_barriers(dx12, command_list);
+
+		command_list->CopyBufferRegion(
+			cb->buffer.Get(),
+			0,
+			uploads->buffer.Get(),
+			allocation.offset,
+			cb->size_in_bytes
+		);
+
+		return;
+	}
+
+	//
+	// Ask for the layout the copy expects. Its rows are padded out to
+	// D3D12_TEXTURE_DATA_PITCH_ALIGNMENT, so the source rows are copied
+	// one at a time unless they happen to line up.
+	//
+
+	desc = cb->buffer->GetDesc();
+
+	dx12->device->GetCopyableFootprints(
+		&desc,
+		0,
+		1,
+		0,
+		&footprint,
+		&num_rows,
+		&row_size_in_bytes,
+		&total_size
+	);
+
+	if (!allocate_upload(&uploads->ring, total_size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, &allocation)) {
+		throw std::exception();
+	}
+
+	copy_pitched_rows(
+		allocation.cpu_address + footprint.Offset,
+		footprint.Footprint.RowPitch,
+		(const unsigned char*)data,
+		row_pitch,
+		row_size_in_bytes,
+		num_rows
+	);
+
+	uploads->bytes_uploaded += row_size_in_bytes * num_rows;
+
+	//
+	// The copy overwrites the whole buffer.
+	//
+
+	require_resource_state(
+		&dx12->resource_states,
+		cb->buffer.Get(),
+		ALL_TRACKED_SUBRESOURCES,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		true
+	);
+	record_resource_barriers(dx12, command_list);
+
+	footprint.Offset += allocation.offset;
+
+	src_location = {};
+	src_location.pResource = uploads->buffer.Get();
+	src_location.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+	src_location.PlacedFootprint = footprint;
+
+	dst_location = {};
+	dst_location.pResource = cb->buffer.Get();
+	dst_location.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	dst_location.SubresourceIndex = 0;
+
+	command_list->CopyTextureRegion(
+		&dst_location,
+		0,
+		0,
+		0,
+		&src_location,
+		NULL
+	);
+}
+
+void shutdown_gpu_upload_ring(gpu_upload_ring* uploads, dx12_handler* dx12) {
+	uploads->buffer->Unmap(0, NULL);
+	uploads->buffer.Reset();
+	free_gpu_memory(dx12->memory, &uploads->memory);
+}
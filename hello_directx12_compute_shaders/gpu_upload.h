@@ -0,0 +1,73 @@
+// Liam Wynn, 01/03/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	Puts an upload_ring (see upload_ring.h) on an upload heap buffer.
+
+	Each queue that runs dispatches has one. The buffer is placed in the
+	upload pool of gpu_memory and mapped when it is created, and stays
+	mapped until the queue goes away. Upload heaps are write-combined,
+	so everything here only ever writes through the mapping, front to
+	back, and never reads it.
+
+	The queue's fence_timeline tags and reclaims the ring: whatever was
+	allocated before a signal comes back once the GPU passes it.
+*/
+
+#pragma once
+
+#include "dx12_handler.h"
+#include "compute_buffer.h"
+#include "upload_ring.h"
+
+// 16 MiB per queue.
+const uint64_t UPLOAD_RING_SIZE = 16ULL * 1024 * 1024;
+
+struct gpu_upload_ring {
+	ComPtr<ID3D12Resource> buffer;
+	gpu_allocation memory;
+	D3D12_GPU_VIRTUAL_ADDRESS gpu_address;
+	upload_ring ring;
+
+	uint64_t bytes_uploaded;
+};
+
+/*
+	size must be a multiple of D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT.
+*/
+void initialize_gpu_upload_ring(
+	gpu_upload_ring* uploads,
+	dx12_handler* dx12,
+	fence_timeline* timeline,
+	const uint64_t size
+);
+
+/*
+	Copies size bytes of constants into the ring and returns their GPU
+	address, ready for SetComputeRootConstantBufferView. Throws if they
+	can't fit.
+*/
+D3D12_GPU_VIRTUAL_ADDRESS upload_dispatch_constants(
+	gpu_upload_ring* uploads,
+	const void* data,
+	const uint64_t size
+);
+
+/*
+	Records a copy of width * height texels from data, row_pitch bytes
+	apart, into cb->buffer on queue. The rows are laid out in the ring
+	the way GetCopyableFootprints says the copy wants them. The tracker
+	moves the buffer to COPY_DEST first. Throws if the data can't fit.
+	A structured or raw buffer takes size_in_bytes of data as they are,
+	and row_pitch is ignored.
+*/
+void record_compute_buffer_upload(
+	dx12_handler* dx12,
+	dx12_queue* queue,
+	ID3D12GraphicsCommandList* command_list,
+	compute_buffer* cb,
+	const void* data,
+	const uint64_t row_pitch
+);
+
+// The GPU has to be done with the ring.
+void shutdown_gpu_upload_ring(gpu_upload_ring* uploads, dx12_handler* dx12);
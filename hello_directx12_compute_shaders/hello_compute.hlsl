@@ -1,14 +1,82 @@
+//
+// LAYOUT_STRUCTURED and LAYOUT_RAW write the image into a plain buffer,
+// one float4 per texel in row major order, instead of a texture.
+//
+
+#if defined(LAYOUT_STRUCTURED)
+RWStructuredBuffer<float4> buffer : register(u0);
+#elif defined(LAYOUT_RAW)
+RWByteAddressBuffer buffer : register(u0);
+#else
 RWTexture2D<float4> buffer : register(u0);
+#endif
+
+#if defined(LAYOUT_STRUCTURED) || defined(LAYOUT_RAW)
+#define LINEAR_LAYOUT
+#endif
+
+//
+// The benchmark suite compiles the kernel with other group sizes.
+//
+
+#ifndef GROUP_SIZE_X
+#define GROUP_SIZE_X 8
+#endif
+
+#ifndef GROUP_SIZE_Y
+#define GROUP_SIZE_Y 8
+#endif
+
+//
+// With TILED the buffer is one tile of a bigger image. uv is relative
+// to the whole image, so every tile computes its own part of it. A
+// buffer has no dimensions to ask for, so the buffer layouts take the
+// image size here too, with tile_origin at 0.
+//
 
-[numthreads(8, 8, 1)]
+#if defined(TILED) || defined(LINEAR_LAYOUT)
+cbuffer job_constants : register(b0)
+{
+    uint2 tile_origin;
+    uint2 image_size;
+};
+#endif
+
+[numthreads(GROUP_SIZE_X, GROUP_SIZE_Y, 1)]
 void main( uint3 dispatch_thread_id : SV_DispatchThreadID )
 {
     uint width;
     uint height;
     float2 uv;
+    float4 value;
     
+#if defined(TILED) || defined(LINEAR_LAYOUT)
+    width = image_size.x;
+    height = image_size.y;
+    uv = (tile_origin + dispatch_thread_id.xy) / float2(width - 1, height - 1);
+#else
     buffer.GetDimensions(width, height);
     uv = dispatch_thread_id.xy / float2(width - 1, height - 1);
+#endif
+    
+    value = float4(uv.xy, 0.0f, 1.0f);
+    
+#ifdef LINEAR_LAYOUT
+    //
+    // A texture drops writes past its edge. A buffer would wrap them
+    // onto the next row.
+    //
+    
+    if (dispatch_thread_id.x >= width || dispatch_thread_id.y >= height) {
+        return;
+    }
+#endif
     
-    buffer[dispatch_thread_id.xy] = float4(uv.xy, 0.0f, 1.0f);
-}
\ No newline at end of file
+#if defined(LAYOUT_STRUCTURED)
+    buffer[dispatch_thread_id.y * width + dispatch_thread_id.x] = value;
+#elif defined(LAYOUT_RAW)
+    buffer.Store4((dispatch_thread_id.y * width + dispatch_thread_id.x) * 16, asuint(value));
+#else
+    buffer[dispatch_thread_id.xy] = value;
+#endif
+}
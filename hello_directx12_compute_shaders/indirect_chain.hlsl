@@ -0,0 +1,125 @@
+//
+// Cull, compact, then process only what survived, with no readback in
+// between: write_arguments sizes process's dispatches on the GPU, and
+// process runs through ExecuteIndirect. indirect_dispatch.cpp has the
+// same kernels for the CPU.
+//
+// reset     1 thread. Zeroes the survivor counter.
+// cull      One thread per item. Clears the item's output and appends
+//           the survivors to the survivor list.
+// write_arguments
+//           One thread per command. Writes the process commands, each
+//           covering up to ITEMS_PER_COMMAND survivors, and how many
+//           of them there are.
+// process   One thread per survivor. Run indirectly, with first and
+//           count set by the command.
+//
+
+#define GROUP_SIZE 64
+#define ITEMS_PER_COMMAND 4096
+
+// first, count, then a D3D12_DISPATCH_ARGUMENTS.
+#define COMMAND_STRIDE 20
+
+RWByteAddressBuffer counter : register(u0);
+RWByteAddressBuffer survivors : register(u1);
+RWByteAddressBuffer arguments : register(u2);
+RWByteAddressBuffer command_count : register(u3);
+RWByteAddressBuffer output : register(u4);
+
+cbuffer chain_constants : register(b0)
+{
+    uint num_items;
+    uint seed;
+    uint keep_per_mille;
+    uint max_commands;
+};
+
+cbuffer command_constants : register(b1)
+{
+    uint first;
+    uint count;
+};
+
+uint chain_hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+
+    return x;
+}
+
+[numthreads(1, 1, 1)]
+void reset()
+{
+    counter.Store(0, 0);
+}
+
+[numthreads(GROUP_SIZE, 1, 1)]
+void cull(uint3 dispatch_thread_id : SV_DispatchThreadID)
+{
+    uint item;
+    uint slot;
+
+    item = dispatch_thread_id.x;
+
+    if (item >= num_items) {
+        return;
+    }
+
+    output.Store(item * 4, 0);
+
+    if (chain_hash(item ^ seed) % 1000 < keep_per_mille) {
+        counter.InterlockedAdd(0, 1, slot);
+        survivors.Store(slot * 4, item);
+    }
+}
+
+[numthreads(GROUP_SIZE, 1, 1)]
+void write_arguments(uint3 dispatch_thread_id : SV_DispatchThreadID)
+{
+    uint k;
+    uint total;
+    uint num_commands;
+    uint command_first;
+    uint command_items;
+
+    k = dispatch_thread_id.x;
+
+    if (k >= max_commands) {
+        return;
+    }
+
+    total = counter.Load(0);
+    num_commands = (total + ITEMS_PER_COMMAND - 1) / ITEMS_PER_COMMAND;
+    command_first = k * ITEMS_PER_COMMAND;
+    command_items = k < num_commands ? min(ITEMS_PER_COMMAND, total - command_first) : 0;
+
+    //
+    // The commands past num_commands aren't run, but get written as
+    // empty dispatches anyway.
+    //
+
+    arguments.Store2(k * COMMAND_STRIDE, uint2(command_first, command_items));
+    arguments.Store3(k * COMMAND_STRIDE + 8, uint3((command_items + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1));
+
+    if (k == 0) {
+        command_count.Store(0, num_commands);
+    }
+}
+
+[numthreads(GROUP_SIZE, 1, 1)]
+void process(uint3 dispatch_thread_id : SV_DispatchThreadID)
+{
+    uint item;
+
+    if (dispatch_thread_id.x >= count) {
+        return;
+    }
+
+    item = survivors.Load((first + dispatch_thread_id.x) * 4);
+    output.Store(item * 4, chain_hash(item + seed) | 1);
+}
@@ -0,0 +1,589 @@
+// Liam Wynn, 01/11/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "indirect_dispatch.h"
+#include <cstring>
+
+using namespace std;
+
+unsigned int indirect_arguments_size(const indirect_signature* signature) {
+	unsigned int size;
+
+	size = 0;
+
+	for (const indirect_argument& argument : signature->arguments) {
+		if (argument.kind == INDIRECT_ARGUMENT_DISPATCH) {
+			size += INDIRECT_DISPATCH_ARGUMENTS_SIZE;
+		}
+		else {
+			size += argument.num_values * 4;
+		}
+	}
+
+	return size;
+}
+
+bool validate_indirect_signature(const indirect_signature* signature, string* error) {
+	unsigned int dispatches;
+
+	dispatches = 0;
+
+	for (const indirect_argument& argument : signature->arguments) {
+		if (argument.kind == INDIRECT_ARGUMENT_DISPATCH) {
+			dispatches++;
+		}
+		else if (argument.num_values == 0) {
+			*error = "root constants with no values";
+			return false;
+		}
+	}
+
+	if (dispatches != 1) {
+		*error = "a compute signature needs exactly one dispatch";
+		return false;
+	}
+
+	if (signature->arguments.back().kind != INDIRECT_ARGUMENT_DISPATCH) {
+		*error = "the dispatch has to be the last argument";
+		return false;
+	}
+
+	if (signature->byte_stride % 4 != 0) {
+		*error = "the stride isn't a multiple of 4";
+		return false;
+	}
+
+	if (signature->byte_stride < indirect_arguments_size(signature)) {
+		*error = "the stride is smaller than the arguments";
+		return false;
+	}
+
+	return true;
+}
+
+bool read_indirect_commands(
+	const indirect_signature* signature,
+	const unsigned char* arguments,
+	const uint64_t arguments_size,
+	const uint64_t arguments_offset,
+	const unsigned int max_commands,
+	const uint32_t* count,
+	vector<indirect_command>* commands,
+	string* error
+) {
+	unsigned int num_commands;
+
+	commands->clear();
+
+	if (!validate_indirect_signature(signature, error)) {
+		return false;
+	}
+
+	if (arguments_offset % 4 != 0) {
+		*error = "the argument offset isn't a multiple of 4";
+		return false;
+	}
+
+	//
+	// The last command only needs its arguments, not a whole stride.
+	//
+
+	if (max_commands > 0
+		&& arguments_offset + (uint64_t)signature->byte_stride * (max_commands - 1) + indirect_arguments_size(signature) > arguments_size) {
+		*error = "the argument buffer is too small for max_commands commands";
+		return false;
+	}
+
+	num_commands = max_commands;
+
+	if (count != NULL && *count < num_commands) {
+		num_commands = *count;
+	}
+
+	for (unsigned int c = 0; c < num_commands; c++) {
+		const unsigned char* at = arguments + arguments_offset + (uint64_t)signature->byte_stride * c;
+		indirect_command command;
+
+		for (const indirect_argument& argument : signature->arguments) {
+			if (argument.kind == INDIRECT_ARGUMENT_CONSTANTS) {
+				indirect_constants constants;
+
+				constants.root_parameter = argument.root_parameter;
+				constants.dest_offset = argument.dest_offset;
+				constants.values.resize(argument.num_values);
+				memcpy(constants.values.data(), at, argument.num_values * 4);
+
+				command.constants.push_back(constants);
+				at += argument.num_values * 4;
+				continue;
+			}
+
+			memcpy(&command.groups.x, at, 4);
+			memcpy(&command.groups.y, at + 4, 4);
+			memcpy(&command.groups.z, at + 8, 4);
+			at += INDIRECT_DISPATCH_ARGUMENTS_SIZE;
+		}
+
+		if (command.groups.x > INDIRECT_MAX_GROUPS_PER_DIMENSION
+			|| command.groups.y > INDIRECT_MAX_GROUPS_PER_DIMENSION
+			|| command.groups.z > INDIRECT_MAX_GROUPS_PER_DIMENSION) {
+			*error = "command " + to_string(c) + " dispatches more groups than D3D12 allows";
+			return false;
+		}
+
+		commands->push_back(command);
+	}
+
+	return true;
+}
+
+bool execute_indirect_on_cpu(
+	const indirect_signature* signature,
+	indirect_kernel* kernel,
+	const unsigned char* arguments,
+	const uint64_t arguments_size,
+	const uint64_t arguments_offset,
+	const unsigned int max_commands,
+	const uint32_t* count,
+	string* error
+) {
+	vector<indirect_command> commands;
+
+	if (!read_indirect_commands(signature, arguments, arguments_size, arguments_offset, max_commands, count, &commands, error)) {
+		return false;
+	}
+
+	for (const indirect_command& command : commands) {
+		for (const indirect_constants& constants : command.constants) {
+			kernel->set_constants(constants.root_parameter, constants.dest_offset, constants.values.data(), (unsigned int)constants.values.size());
+		}
+
+		if (command.groups.x == 0 || command.groups.y == 0 || command.groups.z == 0) {
+			continue;
+		}
+
+		kernel->dispatch(&command.groups);
+	}
+
+	return true;
+}
+
+/* INDIRECT CHAIN */
+
+uint32_t indirect_chain_hash(uint32_t x) {
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+
+	return x;
+}
+
+bool indirect_chain_survives(const indirect_chain_options* options, const uint32_t item) {
+	return indirect_chain_hash(item ^ options->seed) % 1000 < options->keep_per_mille;
+}
+
+uint32_t indirect_chain_value(const indirect_chain_options* options, const uint32_t item) {
+	return indirect_chain_hash(item + options->seed) | 1;
+}
+
+unsigned int indirect_chain_max_commands(const indirect_chain_options* options) {
+	return (options->num_items + INDIRECT_CHAIN_ITEMS_PER_COMMAND - 1) / INDIRECT_CHAIN_ITEMS_PER_COMMAND;
+}
+
+indirect_signature indirect_chain_signature(const unsigned int constants_parameter) {
+	indirect_signature signature;
+
+	signature.arguments.push_back({ INDIRECT_ARGUMENT_CONSTANTS, constants_parameter, 0, INDIRECT_CHAIN_COMMAND_VALUES });
+	signature.arguments.push_back({ INDIRECT_ARGUMENT_DISPATCH, 0, 0, 0 });
+	signature.byte_stride = indirect_arguments_size(&signature);
+
+	return signature;
+}
+
+void initialize_indirect_chain_buffers(
+	indirect_chain_buffers* buffers,
+	const indirect_chain_options* options
+) {
+	unsigned int max_commands;
+
+	max_commands = indirect_chain_max_commands(options);
+
+	buffers->counter.assign(1, 0);
+	buffers->survivors.assign(options->num_items, 0);
+	buffers->arguments.assign((size_t)max_commands * (INDIRECT_CHAIN_COMMAND_VALUES + 3), 0);
+	buffers->command_count.assign(1, 0);
+	buffers->output.assign(options->num_items, 0);
+}
+
+void run_indirect_chain_cull(indirect_chain_buffers* buffers, const indirect_chain_options* options) {
+	//
+	// The reset, then the cull. On the GPU the survivors come out in
+	// whatever order the groups get to InterlockedAdd.
+	//
+
+	buffers->counter[0] = 0;
+
+	for (uint32_t i = 0; i < options->num_items; i++) {
+		buffers->output[i] = 0;
+
+		if (indirect_chain_survives(options, i)) {
+			buffers->survivors[buffers->counter[0]++] = i;
+		}
+	}
+}
+
+void run_indirect_chain_write_arguments(indirect_chain_buffers* buffers, const indirect_chain_options* options) {
+	unsigned int max_commands;
+	uint32_t survivors;
+	uint32_t num_commands;
+
+	max_commands = indirect_chain_max_commands(options);
+	survivors = buffers->counter[0];
+	num_commands = (survivors + INDIRECT_CHAIN_ITEMS_PER_COMMAND - 1) / INDIRECT_CHAIN_ITEMS_PER_COMMAND;
+
+	//
+	// Every command gets written, so the ones past the count are empty
+	// dispatches rather than whatever was there before.
+	//
+
+	for (uint32_t k = 0; k < max_commands; k++) {
+		uint32_t* command = &buffers->arguments[(size_t)k * (INDIRECT_CHAIN_COMMAND_VALUES + 3)];
+		uint32_t first = k * INDIRECT_CHAIN_ITEMS_PER_COMMAND;
+		uint32_t count = 0;
+
+		if (k < num_commands) {
+			count = survivors - first < INDIRECT_CHAIN_ITEMS_PER_COMMAND ? survivors - first : INDIRECT_CHAIN_ITEMS_PER_COMMAND;
+		}
+
+		command[0] = first;
+		command[1] = count;
+		command[2] = (count + INDIRECT_CHAIN_GROUP_SIZE - 1) / INDIRECT_CHAIN_GROUP_SIZE;
+		command[3] = 1;
+		command[4] = 1;
+	}
+
+	buffers->command_count[0] = num_commands;
+}
+
+/*
+	process from indirect_chain.hlsl. Out of range loads read 0 and out
+	of range stores are dropped, like a raw buffer on the GPU.
+*/
+struct cpu_chain_process_kernel : indirect_kernel {
+	indirect_chain_buffers* buffers;
+	const indirect_chain_options* options;
+	uint32_t constants[INDIRECT_CHAIN_COMMAND_VALUES];
+
+	void set_constants(
+		const unsigned int,
+		const unsigned int dest_offset,
+		const uint32_t* values,
+		const unsigned int num_values
+	) override {
+		for (unsigned int i = 0; i < num_values && dest_offset + i < INDIRECT_CHAIN_COMMAND_VALUES; i++) {
+			constants[dest_offset + i] = values[i];
+		}
+	}
+
+	void dispatch(const dispatch_group_count* groups) override {
+		uint32_t first = constants[0];
+		uint32_t count = constants[1];
+		uint32_t threads = groups->x * INDIRECT_CHAIN_GROUP_SIZE;
+
+		for (uint32_t i = 0; i < threads && i < count; i++) {
+			uint64_t at = (uint64_t)first + i;
+			uint32_t item = at < buffers->survivors.size() ? buffers->survivors[(size_t)at] : 0;
+
+			if (item < buffers->output.size()) {
+				buffers->output[item] = indirect_chain_value(options, item);
+			}
+		}
+	}
+};
+
+bool run_indirect_chain_process(
+	indirect_chain_buffers* buffers,
+	const indirect_chain_options* options,
+	string* error
+) {
+	indirect_signature signature;
+	cpu_chain_process_kernel kernel;
+
+	signature = indirect_chain_signature(0);
+
+	kernel.buffers = buffers;
+	kernel.options = options;
+	kernel.constants[0] = 0;
+	kernel.constants[1] = 0;
+
+	return execute_indirect_on_cpu(
+		&signature,
+		&kernel,
+		(const unsigned char*)buffers->arguments.data(),
+		buffers->arguments.size() * sizeof(uint32_t),
+		0,
+		indirect_chain_max_commands(options),
+		buffers->command_count.data(),
+		error
+	);
+}
+
+bool run_indirect_chain_on_cpu(
+	indirect_chain_buffers* buffers,
+	const indirect_chain_options* options,
+	string* error
+) {
+	run_indirect_chain_cull(buffers, options);
+	run_indirect_chain_write_arguments(buffers, options);
+
+	return run_indirect_chain_process(buffers, options, error);
+}
+
+bool check_indirect_chain(
+	const indirect_chain_buffers* buffers,
+	const indirect_chain_options* options,
+	string* error
+) {
+	vector<bool> seen(options->num_items, false);
+	uint32_t expected_survivors;
+	uint32_t expected_commands;
+
+	expected_survivors = 0;
+
+	for (uint32_t i = 0; i < options->num_items; i++) {
+		uint32_t expected = 0;
+
+		if (indirect_chain_survives(options, i)) {
+			expected = indirect_chain_value(options, i);
+			expected_survivors++;
+		}
+
+		if (buffers->output[i] != expected) {
+			*error = "item " + to_string(i) + " is " + to_string(buffers->output[i]) + ", not " + to_string(expected);
+			return false;
+		}
+	}
+
+	if (buffers->counter[0] != expected_survivors) {
+		*error = to_string(buffers->counter[0]) + " survivors, not " + to_string(expected_survivors);
+		return false;
+	}
+
+	for (uint32_t s = 0; s < expected_survivors; s++) {
+		uint32_t item = buffers->survivors[s];
+
+		if (item >= options->num_items || seen[item] || !indirect_chain_survives(options, item)) {
+			*error = "survivor " + to_string(s) + " is item " + to_string(item) + ", which is culled or listed twice";
+			return false;
+		}
+
+		seen[item] = true;
+	}
+
+	expected_commands = (expected_survivors + INDIRECT_CHAIN_ITEMS_PER_COMMAND - 1) / INDIRECT_CHAIN_ITEMS_PER_COMMAND;
+
+	if (buffers->command_count[0] != expected_commands) {
+		*error = to_string(buffers->command_count[0]) + " commands, not " + to_string(expected_commands);
+		return false;
+	}
+
+	return true;
+}
+
+/* CHECKING */
+
+/*
+	Remembers what it was asked to do, so the checks can see which
+	dispatches ran with which constants.
+*/
+struct logging_indirect_kernel : indirect_kernel {
+	uint32_t constants[4];
+	vector<string> log;
+
+	void set_constants(
+		const unsigned int,
+		const unsigned int dest_offset,
+		const uint32_t* values,
+		const unsigned int num_values
+	) override {
+		for (unsigned int i = 0; i < num_values; i++) {
+			constants[(dest_offset + i) % 4] = values[i];
+		}
+	}
+
+	void dispatch(const dispatch_group_count* groups) override {
+		log.push_back(
+			to_string(constants[0]) + " " + to_string(constants[1]) + ": "
+			+ to_string(groups->x) + "x" + to_string(groups->y) + "x" + to_string(groups->z)
+		);
+	}
+};
+
+bool verify_indirect_dispatch(FILE* out) {
+	indirect_signature signature;
+	indirect_signature bad;
+	vector<uint32_t> arguments;
+	vector<indirect_command> commands;
+	logging_indirect_kernel kernel;
+	string error;
+	uint32_t count;
+	unsigned int problems;
+
+	problems = 0;
+
+	auto report = [&](const string& what) {
+		if (out != NULL && problems < 10) {
+			fprintf(out, "  %s\n", what.c_str());
+		}
+
+		problems++;
+	};
+
+	//
+	// Signatures D3D12 would turn down.
+	//
+
+	signature = indirect_chain_signature(1);
+
+	if (!validate_indirect_signature(&signature, &error) || signature.byte_stride != 20) {
+		report("the chain's signature didn't validate: " + error);
+	}
+
+	bad = signature;
+	bad.arguments.clear();
+
+	if (validate_indirect_signature(&bad, &error)) {
+		report("a signature with no dispatch validated");
+	}
+
+	bad = signature;
+	swap(bad.arguments[0], bad.arguments[1]);
+
+	if (validate_indirect_signature(&bad, &error)) {
+		report("a signature with the dispatch first validated");
+	}
+
+	bad = signature;
+	bad.arguments.insert(bad.arguments.begin(), bad.arguments[1]);
+
+	if (validate_indirect_signature(&bad, &error)) {
+		report("a signature with two dispatches validated");
+	}
+
+	bad = signature;
+	bad.arguments[0].num_values = 0;
+
+	if (validate_indirect_signature(&bad, &error)) {
+		report("root constants with no values validated");
+	}
+
+	bad = signature;
+	bad.byte_stride = 16;
+
+	if (validate_indirect_signature(&bad, &error)) {
+		report("a stride smaller than the arguments validated");
+	}
+
+	bad = signature;
+	bad.byte_stride = 22;
+
+	if (validate_indirect_signature(&bad, &error)) {
+		report("a stride that isn't a multiple of 4 validated");
+	}
+
+	//
+	// Three commands, the second one empty, after a word of padding.
+	//
+
+	arguments = {
+		0xDEAD,
+		10, 11, 2, 1, 1,
+		20, 21, 0, 1, 1,
+		30, 31, 3, 2, 1
+	};
+
+	count = 2;
+
+	if (!read_indirect_commands(&signature, (const unsigned char*)arguments.data(), arguments.size() * 4, 4, 3, NULL, &commands, &error)
+		|| commands.size() != 3 || commands[2].constants[0].values[1] != 31 || commands[2].groups.y != 2) {
+		report("three commands weren't read back as written");
+	}
+
+	for (uint32_t c : { 0u, 2u, 3u, 1000u }) {
+		count = c;
+
+		if (!read_indirect_commands(&signature, (const unsigned char*)arguments.data(), arguments.size() * 4, 4, 3, &count, &commands, &error)
+			|| commands.size() != (c < 3 ? c : 3)) {
+			report("the count buffer didn't limit the commands to min(count, max_commands)");
+		}
+	}
+
+	if (read_indirect_commands(&signature, (const unsigned char*)arguments.data(), arguments.size() * 4 - 4, 4, 3, NULL, &commands, &error)) {
+		report("an argument buffer too small for max_commands was read");
+	}
+
+	if (read_indirect_commands(&signature, (const unsigned char*)arguments.data(), arguments.size() * 4, 2, 3, NULL, &commands, &error)) {
+		report("an argument offset that isn't a multiple of 4 was read");
+	}
+
+	arguments[13] = INDIRECT_MAX_GROUPS_PER_DIMENSION + 1;
+
+	if (read_indirect_commands(&signature, (const unsigned char*)arguments.data(), arguments.size() * 4, 4, 3, NULL, &commands, &error)) {
+		report("a dispatch bigger than D3D12 allows was read");
+	}
+
+	arguments[13] = 3;
+
+	//
+	// The empty dispatch still sets its constants, but doesn't run.
+	//
+
+	if (!execute_indirect_on_cpu(&signature, &kernel, (const unsigned char*)arguments.data(), arguments.size() * 4, 4, 3, NULL, &error)
+		|| kernel.log.size() != 2 || kernel.log[0] != "10 11: 2x1x1" || kernel.log[1] != "30 31: 3x2x1") {
+		report("the commands didn't run as written");
+	}
+
+	//
+	// The chain on the CPU, around the group and command sizes.
+	//
+
+	for (unsigned int num_items : { 0u, 1u, 63u, 64u, 65u, 4095u, 4096u, 4097u, 50000u }) {
+		for (unsigned int keep : { 0u, 1u, 500u, 1000u }) {
+			indirect_chain_options options;
+			indirect_chain_buffers buffers;
+
+			options.num_items = num_items;
+			options.seed = num_items * 31 + keep;
+			options.keep_per_mille = keep;
+
+			initialize_indirect_chain_buffers(&buffers, &options);
+
+			if (!run_indirect_chain_on_cpu(&buffers, &options, &error) || !check_indirect_chain(&buffers, &options, &error)) {
+				report("the chain on " + to_string(num_items) + " items keeping " + to_string(keep) + " in 1000: " + error);
+			}
+
+			//
+			// The last survivor left out of its command has to be caught.
+			//
+
+			if (buffers.command_count[0] > 0) {
+				initialize_indirect_chain_buffers(&buffers, &options);
+				run_indirect_chain_cull(&buffers, &options);
+				run_indirect_chain_write_arguments(&buffers, &options);
+
+				buffers.arguments[(size_t)(buffers.command_count[0] - 1) * (INDIRECT_CHAIN_COMMAND_VALUES + 3) + 1]--;
+
+				if (run_indirect_chain_process(&buffers, &options, &error) && check_indirect_chain(&buffers, &options, &error)) {
+					report("a survivor left out of the arguments went unnoticed");
+				}
+			}
+		}
+	}
+
+	if (out != NULL) {
+		fprintf(out, "Indirect dispatch: %s\n", problems == 0 ? "all correct" : (to_string(problems) + " problem(s)").c_str());
+	}
+
+	return problems == 0;
+}
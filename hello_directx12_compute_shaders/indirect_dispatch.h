@@ -0,0 +1,234 @@
+// Liam Wynn, 01/11/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	Indirect dispatch lets a kernel size the dispatches that come after
+	it, without the CPU reading anything back in between.
+
+	An indirect_signature mirrors D3D12_COMMAND_SIGNATURE_DESC for
+	compute: every command in the argument buffer is byte_stride bytes,
+	and holds the arguments in order, packed. Root constants are
+	num_values 32 bit values for a root parameter, and the dispatch is
+	a D3D12_DISPATCH_ARGUMENTS, which has to come last. With a count
+	buffer, the number of commands run is the smaller of its first
+	32 bit value and max_commands.
+
+	read_indirect_commands decodes an argument buffer the way
+	ExecuteIndirect does, and execute_indirect_on_cpu replays it on an
+	indirect_kernel, so anything that writes argument buffers can be
+	checked without a GPU. gpu_indirect turns the same signature into
+	an ID3D12CommandSignature.
+
+	The indirect chain is the example: cull items, compact the ones
+	that survive, then process only those. indirect_chain.hlsl does it
+	on the GPU. The chain's kernels are written out here as well, one
+	thread at a time, so the CPU can run the whole chain, or only the
+	last part on argument buffers the GPU wrote.
+
+	Nothing here depends on Windows.
+*/
+
+#pragma once
+
+#include "shader_layout.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// sizeof(D3D12_DISPATCH_ARGUMENTS).
+const unsigned int INDIRECT_DISPATCH_ARGUMENTS_SIZE = 12;
+
+// D3D12_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION.
+const unsigned int INDIRECT_MAX_GROUPS_PER_DIMENSION = 65535;
+
+enum indirect_argument_kind {
+	INDIRECT_ARGUMENT_CONSTANTS,
+	INDIRECT_ARGUMENT_DISPATCH
+};
+
+struct indirect_argument {
+	indirect_argument_kind kind;
+
+	// Only for INDIRECT_ARGUMENT_CONSTANTS. dest_offset is in 32 bit
+	// values, like SetComputeRoot32BitConstants' offset.
+	unsigned int root_parameter;
+	unsigned int dest_offset;
+	unsigned int num_values;
+};
+
+struct indirect_signature {
+	std::vector<indirect_argument> arguments;
+	unsigned int byte_stride;
+};
+
+// Where a command's root constants go, and what they are.
+struct indirect_constants {
+	unsigned int root_parameter;
+	unsigned int dest_offset;
+	std::vector<uint32_t> values;
+};
+
+struct indirect_command {
+	std::vector<indirect_constants> constants;
+	dispatch_group_count groups;
+};
+
+// Bytes the arguments of one command take up, packed.
+unsigned int indirect_arguments_size(const indirect_signature* signature);
+
+/*
+	Returns false and says why in error unless the signature is one
+	D3D12 would take: a dispatch, last and only once, root constants
+	with at least one value, and a stride that is a multiple of 4 and
+	fits the arguments.
+*/
+bool validate_indirect_signature(const indirect_signature* signature, std::string* error);
+
+/*
+	The commands ExecuteIndirect would run. count is the count buffer's
+	value, or NULL without one. The argument buffer has to hold all
+	max_commands commands from arguments_offset, like the debug layer
+	asks. Returns false and says why in error if it doesn't, or if a
+	dispatch is bigger than D3D12 allows.
+*/
+bool read_indirect_commands(
+	const indirect_signature* signature,
+	const unsigned char* arguments,
+	const uint64_t arguments_size,
+	const uint64_t arguments_offset,
+	const unsigned int max_commands,
+	const uint32_t* count,
+	std::vector<indirect_command>* commands,
+	std::string* error
+);
+
+/*
+	Something the CPU can dispatch. set_constants is called with each
+	command's root constants before its dispatch. A dispatch with a
+	zero in it is a no-op, as on the GPU, and dispatch isn't called.
+*/
+struct indirect_kernel {
+	virtual ~indirect_kernel() {}
+
+	virtual void set_constants(
+		const unsigned int root_parameter,
+		const unsigned int dest_offset,
+		const uint32_t* values,
+		const unsigned int num_values
+	) = 0;
+	virtual void dispatch(const dispatch_group_count* groups) = 0;
+};
+
+// Like read_indirect_commands, then runs the commands on kernel.
+bool execute_indirect_on_cpu(
+	const indirect_signature* signature,
+	indirect_kernel* kernel,
+	const unsigned char* arguments,
+	const uint64_t arguments_size,
+	const uint64_t arguments_offset,
+	const unsigned int max_commands,
+	const uint32_t* count,
+	std::string* error
+);
+
+/* INDIRECT CHAIN */
+
+// numthreads of every kernel in indirect_chain.hlsl but the reset.
+const unsigned int INDIRECT_CHAIN_GROUP_SIZE = 64;
+
+const unsigned int INDIRECT_CHAIN_ITEMS_PER_COMMAND = 4096;
+
+// The process kernel's root constants: first survivor and count.
+const unsigned int INDIRECT_CHAIN_COMMAND_VALUES = 2;
+
+struct indirect_chain_options {
+	unsigned int num_items;
+	uint32_t seed;
+
+	// Out of 1000 items, about how many survive the cull.
+	unsigned int keep_per_mille;
+};
+
+/*
+	The chain's buffers, as the GPU has them: u0 to u4 in
+	indirect_chain.hlsl.
+*/
+struct indirect_chain_buffers {
+	// Survivors so far, while culling.
+	std::vector<uint32_t> counter;
+
+	// Indices of the items that survived, in any order.
+	std::vector<uint32_t> survivors;
+
+	// max_commands commands of INDIRECT_CHAIN_COMMAND_VALUES root
+	// constants and a D3D12_DISPATCH_ARGUMENTS each.
+	std::vector<uint32_t> arguments;
+
+	// How many of those to run.
+	std::vector<uint32_t> command_count;
+
+	// Per item. 0 for the ones culled.
+	std::vector<uint32_t> output;
+};
+
+// Same as chain_hash in indirect_chain.hlsl.
+uint32_t indirect_chain_hash(uint32_t x);
+
+bool indirect_chain_survives(const indirect_chain_options* options, const uint32_t item);
+
+// What process writes for an item that survived. Never 0.
+uint32_t indirect_chain_value(const indirect_chain_options* options, const uint32_t item);
+
+// Enough commands for every item to survive.
+unsigned int indirect_chain_max_commands(const indirect_chain_options* options);
+
+/*
+	The process kernel's signature. constants_parameter is the root
+	parameter of its command_constants.
+*/
+indirect_signature indirect_chain_signature(const unsigned int constants_parameter);
+
+// Sized for options, and zeroed.
+void initialize_indirect_chain_buffers(
+	indirect_chain_buffers* buffers,
+	const indirect_chain_options* options
+);
+
+/*
+	The kernels in indirect_chain.hlsl, on the CPU. cull (with the
+	reset before it) and write_arguments take the place of their
+	dispatches, process is run through execute_indirect_on_cpu with the
+	arguments and count in buffers.
+*/
+void run_indirect_chain_cull(indirect_chain_buffers* buffers, const indirect_chain_options* options);
+void run_indirect_chain_write_arguments(indirect_chain_buffers* buffers, const indirect_chain_options* options);
+bool run_indirect_chain_process(
+	indirect_chain_buffers* buffers,
+	const indirect_chain_options* options,
+	std::string* error
+);
+
+// All three.
+bool run_indirect_chain_on_cpu(
+	indirect_chain_buffers* buffers,
+	const indirect_chain_options* options,
+	std::string* error
+);
+
+/*
+	Checks output and the survivor count against the items worked out
+	one at a time. Says what is wrong in error if they don't match.
+*/
+bool check_indirect_chain(
+	const indirect_chain_buffers* buffers,
+	const indirect_chain_options* options,
+	std::string* error
+);
+
+/*
+	Checks signature validation, how argument buffers are read (count
+	buffers, bounds, empty dispatches) and the chain on the CPU for a
+	range of sizes. Problems go to out, which may be NULL. Returns false
+	if there were any.
+*/
+bool verify_indirect_dispatch(FILE* out);
@@ -0,0 +1,611 @@
+// Liam Wynn, 01/08/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "job_runner.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+/* MANIFEST */
+
+/*
+	Just enough JSON for a manifest: objects, arrays, strings without
+	unicode escapes, numbers, true, false and null.
+*/
+enum json_kind {
+	JSON_NULL,
+	JSON_BOOL,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT
+};
+
+struct json_value {
+	json_kind kind;
+	double number;
+	string text;
+	vector<json_value> items;
+
+	// Members of an object, in order, with their keys in keys.
+	vector<string> keys;
+};
+
+struct json_reader {
+	const char* c;
+	const char* end;
+	string error;
+};
+
+static void skip_json_space(json_reader* reader) {
+	while (reader->c < reader->end && strchr(" \t\r\n", *reader->c) != NULL) {
+		reader->c++;
+	}
+}
+
+static bool json_fail(json_reader* reader, const char* what) {
+	if (reader->error.empty()) {
+		reader->error = what;
+	}
+
+	return false;
+}
+
+static bool read_json_value(json_reader* reader, json_value* value, const unsigned int depth);
+
+static bool read_json_string(json_reader* reader, string* text) {
+	text->clear();
+	reader->c++;
+
+	while (reader->c < reader->end && *reader->c != '"') {
+		if (*reader->c == '\\') {
+			if (++reader->c == reader->end) {
+				break;
+			}
+
+			switch (*reader->c) {
+			case '"': text->push_back('"'); break;
+			case '\\': text->push_back('\\'); break;
+			case '/': text->push_back('/'); break;
+			case 'n': text->push_back('\n'); break;
+			case 't': text->push_back('\t'); break;
+			default: return json_fail(reader, "unsupported escape in a string");
+			}
+		}
+		else {
+			text->push_back(*reader->c);
+		}
+
+		reader->c++;
+	}
+
+	if (reader->c == reader->end) {
+		return json_fail(reader, "unterminated string");
+	}
+
+	reader->c++;
+
+	return true;
+}
+
+static bool read_json_value(json_reader* reader, json_value* value, const unsigned int depth) {
+	json_value item;
+	string key;
+	char* number_end;
+
+	if (depth > 32) {
+		return json_fail(reader, "nested too deeply");
+	}
+
+	skip_json_space(reader);
+
+	if (reader->c == reader->end) {
+		return json_fail(reader, "unexpected end");
+	}
+
+	value->items.clear();
+	value->keys.clear();
+
+	if (*reader->c == '{' || *reader->c == '[') {
+		value->kind = *reader->c == '{' ? JSON_OBJECT : JSON_ARRAY;
+		reader->c++;
+		skip_json_space(reader);
+
+		if (reader->c < reader->end && *reader->c == (value->kind == JSON_OBJECT ? '}' : ']')) {
+			reader->c++;
+			return true;
+		}
+
+		while (true) {
+			if (value->kind == JSON_OBJECT) {
+				skip_json_space(reader);
+
+				if (reader->c == reader->end || *reader->c != '"' || !read_json_string(reader, &key)) {
+					return json_fail(reader, "expected a key");
+				}
+
+				skip_json_space(reader);
+
+				if (reader->c == reader->end || *reader->c != ':') {
+					return json_fail(reader, "expected ':'");
+				}
+
+				reader->c++;
+				value->keys.push_back(key);
+			}
+
+			if (!read_json_value(reader, &item, depth + 1)) {
+				return false;
+			}
+
+			value->items.push_back(item);
+			skip_json_space(reader);
+
+			if (reader->c < reader->end && *reader->c == ',') {
+				reader->c++;
+				continue;
+			}
+
+			if (reader->c < reader->end && *reader->c == (value->kind == JSON_OBJECT ? '}' : ']')) {
+				reader->c++;
+				return true;
+			}
+
+			return json_fail(reader, value->kind == JSON_OBJECT ? "expected ',' or '}'" : "expected ',' or ']'");
+		}
+	}
+
+	if (*reader->c == '"') {
+		value->kind = JSON_STRING;
+		return read_json_string(reader, &value->text);
+	}
+
+	if (reader->end - reader->c >= 4 && strncmp(reader->c, "true", 4) == 0) {
+		value->kind = JSON_BOOL;
+		value->number = 1.0;
+		reader->c += 4;
+		return true;
+	}
+
+	if (reader->end - reader->c >= 5 && strncmp(reader->c, "false", 5) == 0) {
+		value->kind = JSON_BOOL;
+		value->number = 0.0;
+		reader->c += 5;
+		return true;
+	}
+
+	if (reader->end - reader->c >= 4 && strncmp(reader->c, "null", 4) == 0) {
+		value->kind = JSON_NULL;
+		reader->c += 4;
+		return true;
+	}
+
+	//
+	// The text is a std::string, so strtod stops at its terminator at
+	// the latest.
+	//
+
+	value->kind = JSON_NUMBER;
+	value->number = strtod(reader->c, &number_end);
+
+	if (number_end == reader->c) {
+		return json_fail(reader, "unexpected character");
+	}
+
+	reader->c = number_end;
+
+	return true;
+}
+
+static bool read_job_count(const json_value* value, const char* key, unsigned int* count, string* error) {
+	if (value->kind != JSON_NUMBER
+		|| !(value->number >= 1.0 && value->number <= 1.0e9)
+		|| value->number != (double)(unsigned int)value->number) {
+		*error = string(key) + " must be a positive whole number";
+		return false;
+	}
+
+	*count = (unsigned int)value->number;
+
+	return true;
+}
+
+static bool read_job(const json_value* object, const size_t index, job_desc* job, string* error) {
+	const string* key;
+	const json_value* value;
+	bool has_width;
+	bool has_height;
+	string reason;
+
+	job->name = "job " + to_string(index);
+	job->kernel = DEFAULT_JOB_KERNEL;
+	job->entry_point = DEFAULT_JOB_ENTRY_POINT;
+	job->width = 0;
+	job->height = 0;
+	job->format = CPU_TEXEL_R32G32B32A32_FLOAT;
+	job->iterations = 1;
+	job->output.clear();
+
+	has_width = false;
+	has_height = false;
+
+	if (object->kind != JSON_OBJECT) {
+		*error = "job " + to_string(index) + " is not an object";
+		return false;
+	}
+
+	for (size_t i = 0; i < object->items.size(); i++) {
+		key = &object->keys[i];
+		value = &object->items[i];
+		reason.clear();
+
+		if (*key == "width") {
+			has_width = read_job_count(value, "width", &job->width, &reason);
+		}
+		else if (*key == "height") {
+			has_height = read_job_count(value, "height", &job->height, &reason);
+		}
+		else if (*key == "iterations") {
+			read_job_count(value, "iterations", &job->iterations, &reason);
+		}
+		else if (*key == "kernel" || *key == "entry" || *key == "output" || *key == "name" || *key == "format") {
+			if (value->kind != JSON_STRING || value->text.empty()) {
+				reason = *key + " must be a non-empty string";
+			}
+			else if (*key == "kernel") {
+				job->kernel = value->text;
+			}
+			else if (*key == "entry") {
+				job->entry_point = value->text;
+			}
+			else if (*key == "output") {
+				job->output = value->text;
+			}
+			else if (*key == "name") {
+				job->name = value->text;
+			}
+			else if (!parse_cpu_texel_format(value->text.c_str(), &job->format)) {
+				reason = "unknown format " + value->text;
+			}
+		}
+		else {
+			reason = "unknown key " + *key;
+		}
+
+		if (!reason.empty()) {
+			*error = "job " + to_string(index) + ": " + reason;
+			return false;
+		}
+	}
+
+	if (!has_width || !has_height) {
+		*error = "job " + to_string(index) + ": width and height are required";
+		return false;
+	}
+
+	return true;
+}
+
+bool parse_job_manifest(
+	const string& text,
+	vector<job_desc>* jobs,
+	string* error
+) {
+	json_reader reader;
+	json_value root;
+	const json_value* list;
+	job_desc job;
+
+	jobs->clear();
+
+	reader.c = text.c_str();
+	reader.end = reader.c + text.size();
+
+	if (!read_json_value(&reader, &root, 0)) {
+		*error = "bad JSON at byte " + to_string(reader.c - text.c_str()) + ": " + reader.error;
+		return false;
+	}
+
+	skip_json_space(&reader);
+
+	if (reader.c != reader.end) {
+		*error = "trailing text after the manifest";
+		return false;
+	}
+
+	//
+	// Either a bare list of jobs or { "jobs": [...] }.
+	//
+
+	list = NULL;
+
+	if (root.kind == JSON_ARRAY) {
+		list = &root;
+	}
+	else if (root.kind == JSON_OBJECT) {
+		for (size_t i = 0; i < root.items.size(); i++) {
+			if (root.keys[i] == "jobs" && root.items[i].kind == JSON_ARRAY) {
+				list = &root.items[i];
+			}
+		}
+	}
+
+	if (list == NULL) {
+		*error = "the manifest has no list of jobs";
+		return false;
+	}
+
+	for (size_t i = 0; i < list->items.size(); i++) {
+		if (!read_job(&list->items[i], i, &job, error)) {
+			jobs->clear();
+			return false;
+		}
+
+		jobs->push_back(job);
+	}
+
+	return true;
+}
+
+bool load_job_manifest(
+	const string& path,
+	vector<job_desc>* jobs,
+	string* error
+) {
+	ifstream file;
+	stringstream text;
+
+	file.open(path, ios::binary);
+
+	if (!file.is_open()) {
+		*error = "could not open " + path;
+		return false;
+	}
+
+	text << file.rdbuf();
+
+	return parse_job_manifest(text.str(), jobs, error);
+}
+
+bool is_hello_compute_kernel(const job_desc* job) {
+	const char* name;
+	size_t slash;
+
+	slash = job->kernel.find_last_of("/\\");
+	name = job->kernel.c_str() + (slash == string::npos ? 0 : slash + 1);
+
+	return strcmp(name, "hello_compute.hlsl") == 0;
+}
+
+/* RUNNER */
+
+static bool write_job_output(const job_desc* job, const texel_rows* rows) {
+	vector<unsigned char> packed;
+	FILE* file;
+	size_t written;
+
+	packed.resize((size_t)rows->width * rows->height * cpu_texel_size(rows->format));
+	pack_texel_rows(rows, packed.data());
+
+#if defined(_MSC_VER)
+	if (fopen_s(&file, job->output.c_str(), "wb") != 0) {
+		return false;
+	}
+#else
+	file = fopen(job->output.c_str(), "wb");
+#endif
+
+	if (file == NULL) {
+		return false;
+	}
+
+	written = fwrite(packed.data(), 1, packed.size(), file);
+
+	return fclose(file) == 0 && written == packed.size();
+}
+
+vector<job_result> run_jobs(
+	job_backend* backend,
+	const vector<job_desc>& jobs,
+	FILE* progress
+) {
+	vector<job_result> results;
+	job_result result;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+	texel_rows rows;
+
+	for (size_t i = 0; i < jobs.size(); i++) {
+		result.job = jobs[i];
+		result.backend = backend->name();
+		result.ok = false;
+		result.error.clear();
+		result.reused_pipeline = false;
+		result.reused_buffer = false;
+
+		for (int p = 0; p < JOB_PHASE_COUNT; p++) {
+			result.seconds[p] = 0.0;
+		}
+
+		if (progress != NULL) {
+			fprintf(progress, "[%zu/%zu] %s: %s:%s %ux%u %s x%u\n", i + 1, jobs.size(), jobs[i].name.c_str(), jobs[i].kernel.c_str(), jobs[i].entry_point.c_str(), jobs[i].width, jobs[i].height, cpu_texel_format_name(jobs[i].format), jobs[i].iterations);
+		}
+
+		start = chrono::steady_clock::now();
+
+		if (!backend->prepare(&jobs[i], &result.reused_pipeline, &result.reused_buffer, &result.error)) {
+			elapsed = chrono::steady_clock::now() - start;
+			result.seconds[JOB_PHASE_SETUP] = elapsed.count();
+			results.push_back(result);
+			continue;
+		}
+
+		elapsed = chrono::steady_clock::now() - start;
+		result.seconds[JOB_PHASE_SETUP] = elapsed.count();
+
+		//
+		// Run is everything up to the result being readable, so on the
+		// GPU it includes the copy back and the wait.
+		//
+
+		start = chrono::steady_clock::now();
+
+		for (unsigned int k = 0; k < jobs[i].iterations; k++) {
+			backend->run_iteration();
+		}
+
+		rows = backend->read_result();
+
+		elapsed = chrono::steady_clock::now() - start;
+		result.seconds[JOB_PHASE_RUN] = elapsed.count();
+
+		start = chrono::steady_clock::now();
+
+		result.ok = jobs[i].output.empty() || write_job_output(&jobs[i], &rows);
+
+		if (!result.ok) {
+			result.error = "could not write " + jobs[i].output;
+		}
+
+		backend->release_result();
+
+		elapsed = chrono::steady_clock::now() - start;
+		result.seconds[JOB_PHASE_OUTPUT] = elapsed.count();
+
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+void print_job_results(const vector<job_result>& results, FILE* out) {
+	double totals[JOB_PHASE_COUNT];
+	unsigned int failed;
+	unsigned int pipelines_reused;
+	unsigned int buffers_reused;
+
+	for (int p = 0; p < JOB_PHASE_COUNT; p++) {
+		totals[p] = 0.0;
+	}
+
+	failed = 0;
+	pipelines_reused = 0;
+	buffers_reused = 0;
+
+	fprintf(out, "%-8s %-20s %-12s %-20s %6s %10s %10s %10s %-8s %-6s\n", "backend", "job", "size", "format", "iters", "setup ms", "run ms", "output ms", "pipeline", "buffer");
+
+	for (const job_result& r : results) {
+		char size[32];
+
+		snprintf(size, sizeof(size), "%ux%u", r.job.width, r.job.height);
+
+		for (int p = 0; p < JOB_PHASE_COUNT; p++) {
+			totals[p] += r.seconds[p];
+		}
+
+		if (!r.ok) {
+			fprintf(out, "%-8s %-20s %-12s %-20s failed: %s\n", r.backend.c_str(), r.job.name.c_str(), size, cpu_texel_format_name(r.job.format), r.error.c_str());
+			failed++;
+			continue;
+		}
+
+		pipelines_reused += r.reused_pipeline ? 1 : 0;
+		buffers_reused += r.reused_buffer ? 1 : 0;
+
+		fprintf(
+			out,
+			"%-8s %-20s %-12s %-20s %6u %10.3f %10.3f %10.3f %-8s %-6s\n",
+			r.backend.c_str(),
+			r.job.name.c_str(),
+			size,
+			cpu_texel_format_name(r.job.format),
+			r.job.iterations,
+			r.seconds[JOB_PHASE_SETUP] * 1000.0,
+			r.seconds[JOB_PHASE_RUN] * 1000.0,
+			r.seconds[JOB_PHASE_OUTPUT] * 1000.0,
+			r.reused_pipeline ? "reused" : "built",
+			r.reused_buffer ? "reused" : "new"
+		);
+	}
+
+	fprintf(
+		out,
+		"%zu jobs, %u failed, %u pipelines and %u buffers reused. Setup %.3f ms, run %.3f ms, output %.3f ms.\n",
+		results.size(),
+		failed,
+		pipelines_reused,
+		buffers_reused,
+		totals[JOB_PHASE_SETUP] * 1000.0,
+		totals[JOB_PHASE_RUN] * 1000.0,
+		totals[JOB_PHASE_OUTPUT] * 1000.0
+	);
+}
+
+/* CPU BACKEND */
+
+void initialize_cpu_job_backend(cpu_job_backend* backend, const unsigned int num_threads) {
+	initialize_cpu_executor(&backend->executor, num_threads);
+	backend->buffers.entries.clear();
+	backend->buffers.clock = 0;
+	backend->target = NULL;
+	backend->jobs_prepared = 0;
+}
+
+const char* cpu_job_backend::name() {
+	return "cpu";
+}
+
+bool cpu_job_backend::prepare(
+	const job_desc* job,
+	bool* reused_pipeline,
+	bool* reused_buffer,
+	string* reason
+) {
+	job_buffer_key key;
+	vector<unsigned char> evicted;
+	bool did_evict;
+
+	//
+	// The CPU only has the one kernel, and nothing to build for it.
+	//
+
+	if (!is_hello_compute_kernel(job) || job->entry_point != DEFAULT_JOB_ENTRY_POINT) {
+		*reason = "the CPU executor only runs hello_compute.hlsl's main";
+		return false;
+	}
+
+	this->job = *job;
+	*reused_pipeline = jobs_prepared > 0;
+	jobs_prepared++;
+
+	footprint = cpu_readback_footprint(job->width, job->height, cpu_texel_size(job->format));
+	key = make_tuple(job->width, job->height, job->format);
+	target = find_job_buffer(&buffers, key);
+	*reused_buffer = target != NULL;
+
+	if (target == NULL) {
+		target = insert_job_buffer(&buffers, key, vector<unsigned char>((size_t)footprint.total_size), &evicted, &did_evict);
+	}
+
+	return true;
+}
+
+void cpu_job_backend::run_iteration() {
+	cpu_texture texture;
+	cpu_dispatch_desc dispatch;
+
+	texture = { target->data(), job.width, job.height, footprint.row_pitch, job.format };
+	dispatch = cpu_hello_compute_dispatch(job.width, job.height);
+
+	cpu_dispatch_hello_compute(&executor, &texture, &dispatch);
+}
+
+texel_rows cpu_job_backend::read_result() {
+	return { target->data(), job.width, job.height, footprint.row_pitch, job.format };
+}
+
+void cpu_job_backend::release_result() {
+}
@@ -0,0 +1,238 @@
+// Liam Wynn, 01/08/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The job runner works through a manifest of compute jobs on one
+	device, instead of bringing a device up and down for every job.
+
+	A manifest is JSON: a list of jobs, or an object with a "jobs" list.
+	Every job is an object with
+
+	kernel      HLSL file. ./hello_compute.hlsl if not given.
+	entry       Entry point. main if not given.
+	width       Image size in texels. Required.
+	height
+	format      What the kernel writes, a cpu_texel_format name.
+	            R32G32B32A32_FLOAT if not given.
+	iterations  Times to run the kernel before reading it back. 1 if
+	            not given.
+	output      Where to write the result, as rows of format with no
+	            padding. Nothing is written if not given.
+	name        For the report. "job N" if not given.
+
+	Keys it doesn't know are an error, so a typo doesn't quietly run
+	the wrong job.
+
+	The work is done by a job_backend. A backend keeps what it built for
+	earlier jobs: a pipeline per kernel and entry point, and the last
+	few buffers by width, height and format, so a job shaped like one
+	before it reuses its buffer. Every job reports how long it spent
+	getting ready, running and writing its output, and whether it
+	reused a pipeline and a buffer.
+
+	The CPU backend here runs hello_compute.hlsl's main on the
+	cpu_executor, so a manifest of those jobs runs end to end without
+	a GPU. gpu_job_backend runs any kernel on the device.
+
+	Nothing here depends on Windows.
+*/
+
+#pragma once
+
+#include "cpu_executor.h"
+#include "readback_decoder.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+const char* const DEFAULT_JOB_KERNEL = "./hello_compute.hlsl";
+const char* const DEFAULT_JOB_ENTRY_POINT = "main";
+
+// How many buffers a backend keeps for later jobs.
+const unsigned int JOB_BUFFER_CACHE_SIZE = 8;
+
+struct job_desc {
+	std::string name;
+	std::string kernel;
+	std::string entry_point;
+	unsigned int width;
+	unsigned int height;
+	cpu_texel_format format;
+	unsigned int iterations;
+
+	// Empty to not write the result.
+	std::string output;
+};
+
+enum job_phase {
+	JOB_PHASE_SETUP,
+	JOB_PHASE_RUN,
+	JOB_PHASE_OUTPUT,
+	JOB_PHASE_COUNT
+};
+
+struct job_result {
+	job_desc job;
+	std::string backend;
+
+	bool ok;
+	std::string error;
+
+	double seconds[JOB_PHASE_COUNT];
+	bool reused_pipeline;
+	bool reused_buffer;
+};
+
+/*
+	Runs jobs one at a time. prepare gets the job's pipeline and buffer
+	ready, run_iteration runs the kernel once, read_result makes the
+	buffer readable on the CPU and release_result is done with it.
+*/
+struct job_backend {
+	virtual ~job_backend() {}
+
+	virtual const char* name() = 0;
+	virtual bool prepare(
+		const job_desc* job,
+		bool* reused_pipeline,
+		bool* reused_buffer,
+		std::string* reason
+	) = 0;
+	virtual void run_iteration() = 0;
+	virtual texel_rows read_result() = 0;
+	virtual void release_result() = 0;
+};
+
+// Width, height and format.
+typedef std::tuple<unsigned int, unsigned int, cpu_texel_format> job_buffer_key;
+
+/*
+	Least recently used first out. Backends keep their buffers in one
+	of these with their own payload.
+*/
+template<typename T>
+struct job_buffer_cache {
+	struct entry {
+		job_buffer_key key;
+		T buffer;
+		uint64_t last_used;
+	};
+
+	std::vector<entry> entries;
+	uint64_t clock;
+};
+
+// The buffer for key, or NULL. Counts as a use.
+template<typename T>
+T* find_job_buffer(job_buffer_cache<T>* cache, const job_buffer_key& key) {
+	for (typename job_buffer_cache<T>::entry& entry : cache->entries) {
+		if (entry.key == key) {
+			entry.last_used = ++cache->clock;
+			return &entry.buffer;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+	Adds buffer under key. When the cache is full, the least recently
+	used buffer is moved to evicted, for the caller to free, and
+	did_evict is set. The pointer returned is good until the next
+	insert.
+*/
+template<typename T>
+T* insert_job_buffer(
+	job_buffer_cache<T>* cache,
+	const job_buffer_key& key,
+	T buffer,
+	T* evicted,
+	bool* did_evict
+) {
+	size_t oldest;
+
+	*did_evict = false;
+
+	if (cache->entries.size() < JOB_BUFFER_CACHE_SIZE) {
+		cache->entries.push_back({ key, std::move(buffer), ++cache->clock });
+		return &cache->entries.back().buffer;
+	}
+
+	oldest = 0;
+
+	for (size_t i = 1; i < cache->entries.size(); i++) {
+		if (cache->entries[i].last_used < cache->entries[oldest].last_used) {
+			oldest = i;
+		}
+	}
+
+	*evicted = std::move(cache->entries[oldest].buffer);
+	*did_evict = true;
+
+	cache->entries[oldest] = { key, std::move(buffer), ++cache->clock };
+
+	return &cache->entries[oldest].buffer;
+}
+
+/*
+	Runs hello_compute on the cpu_executor into a buffer laid out like
+	a readback, so the result is read in place.
+*/
+struct cpu_job_backend : job_backend {
+	cpu_executor executor;
+	job_buffer_cache<std::vector<unsigned char>> buffers;
+
+	// The kernel counts as built after the first job.
+	unsigned int jobs_prepared;
+
+	// The current job and its buffer.
+	job_desc job;
+	cpu_footprint footprint;
+	std::vector<unsigned char>* target;
+
+	const char* name() override;
+	bool prepare(
+		const job_desc* job,
+		bool* reused_pipeline,
+		bool* reused_buffer,
+		std::string* reason
+	) override;
+	void run_iteration() override;
+	texel_rows read_result() override;
+	void release_result() override;
+};
+
+void initialize_cpu_job_backend(cpu_job_backend* backend, const unsigned int num_threads);
+
+/*
+	Returns false and says why in error if the manifest can't be read or
+	a job in it is malformed.
+*/
+bool parse_job_manifest(
+	const std::string& text,
+	std::vector<job_desc>* jobs,
+	std::string* error
+);
+bool load_job_manifest(
+	const std::string& path,
+	std::vector<job_desc>* jobs,
+	std::string* error
+);
+
+// Whether the kernel is hello_compute.hlsl, whatever directory it's in.
+bool is_hello_compute_kernel(const job_desc* job);
+
+/*
+	Runs every job on backend, in order. A job that fails doesn't stop
+	the ones after it. Progress lines go to progress, which may be NULL.
+*/
+std::vector<job_result> run_jobs(
+	job_backend* backend,
+	const std::vector<job_desc>& jobs,
+	FILE* progress
+);
+
+// Per job times and what was reused, then totals.
+void print_job_results(const std::vector<job_result>& results, FILE* out);
@@ -0,0 +1,72 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "keyed_store.h"
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+vector<pair<string, string>> read_keyed_lines(const string& path) {
+	vector<pair<string, string>> lines;
+	ifstream file;
+	string line;
+
+	file.open(path);
+
+	if (!file.is_open()) {
+		return lines;
+	}
+
+	while (getline(file, line)) {
+		istringstream fields(line);
+		string key;
+		string rest;
+
+		if (!(fields >> key)) {
+			continue;
+		}
+
+		getline(fields, rest);
+		lines.push_back(make_pair(key, rest));
+	}
+
+	return lines;
+}
+
+bool replace_text_file(const string& path, const string& text) {
+	string temp_path;
+	error_code err;
+
+	temp_path = path + ".tmp";
+
+	{
+		ofstream file(temp_path, ios::trunc);
+
+		if (!file.is_open()) {
+			return false;
+		}
+
+		file << text;
+
+		//
+		// A full disk can fail the last write only when it is flushed.
+		//
+
+		file.close();
+
+		if (!file.good()) {
+			fs::remove(temp_path, err);
+			return false;
+		}
+	}
+
+	fs::rename(temp_path, path, err);
+
+	if (err) {
+		fs::remove(temp_path, err);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,136 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	A keyed store is a small text file with one entry per line: a key
+	with no spaces, then the entry's fields, separated by spaces. The
+	device probe cache and the threadgroup tuning database are both kept
+	in one.
+
+	The file is read whole into entries. Storing an entry that differs
+	from the one there marks the store dirty, and saving only writes
+	when it is. Doubles are written with 17 digits, so they read back
+	exactly. A save writes a temporary file next to the old one and
+	renames it over it, so a crash or a full disk leaves the old file or
+	the new one, never half of either.
+
+	Each user supplies how its entries are parsed, formatted and
+	compared. Nothing here depends on Windows.
+*/
+
+#pragma once
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+template <typename T>
+struct keyed_store {
+	std::string path;
+	std::map<std::string, T> entries;
+	bool dirty;
+};
+
+// Every line's key and the rest of the line. A missing file has none.
+std::vector<std::pair<std::string, std::string>> read_keyed_lines(const std::string& path);
+
+/*
+	Writes text to path + ".tmp" and renames that over path. Returns
+	false, and leaves path as it was, if either step failed.
+*/
+bool replace_text_file(const std::string& path, const std::string& text);
+
+/*
+	A missing or unreadable file is an empty store. parse reads an
+	entry's fields and returns false if they are no good, in which case
+	the line is dropped.
+*/
+template <typename T>
+void load_keyed_store(
+	keyed_store<T>* store,
+	const std::string& path,
+	bool (*parse)(std::istream& fields, T* entry)
+) {
+	store->path = path;
+	store->entries.clear();
+	store->dirty = false;
+
+	for (const std::pair<std::string, std::string>& line : read_keyed_lines(path)) {
+		std::istringstream fields(line.second);
+		T entry;
+
+		if (parse(fields, &entry)) {
+			store->entries[line.first] = entry;
+		}
+	}
+}
+
+// Returns false if key isn't in the store.
+template <typename T>
+bool find_keyed_entry(
+	const keyed_store<T>* store,
+	const std::string& key,
+	T* entry
+) {
+	typename std::map<std::string, T>::const_iterator found;
+
+	found = store->entries.find(key);
+
+	if (found == store->entries.end()) {
+		return false;
+	}
+
+	*entry = found->second;
+
+	return true;
+}
+
+// Only marks the store dirty if same says the old entry was different.
+template <typename T>
+void store_keyed_entry(
+	keyed_store<T>* store,
+	const std::string& key,
+	const T* entry,
+	bool (*same)(const T* a, const T* b)
+) {
+	T old;
+
+	if (find_keyed_entry(store, key, &old) && same(&old, entry)) {
+		return;
+	}
+
+	store->entries[key] = *entry;
+	store->dirty = true;
+}
+
+/*
+	Only writes if something changed. format writes an entry's fields,
+	which go after its key and a space. Returns false if the file
+	couldn't be written, and the store stays dirty.
+*/
+template <typename T>
+bool save_keyed_store(
+	keyed_store<T>* store,
+	void (*format)(std::ostream& out, const T* entry)
+) {
+	std::ostringstream text;
+
+	if (!store->dirty) {
+		return true;
+	}
+
+	text.precision(17);
+
+	for (const std::pair<const std::string, T>& entry : store->entries) {
+		text << entry.first << " ";
+		format(text, &entry.second);
+		text << "\n";
+	}
+
+	store->dirty = !replace_text_file(store->path, text.str());
+
+	return !store->dirty;
+}
@@ -5,25 +5,503 @@
 	Not sure yet as of writing this. I am following this tutorial here:
 
 	https://www.stefanpijnacker.nl/article/compute-with-directx12-part-1/
+
+	Command line options:
+		--summary          Print per-channel min/max/mean instead of
+		                   every element.
+		--format NAME      Have the kernel write NAME (R32G32B32A32_FLOAT,
+		                   R16G16B16A16_FLOAT, R8G8B8A8_UNORM, R32_FLOAT
+		                   or R11G11B10_FLOAT) and decode it back to
+		                   float4 for printing.
+		--bench-formatter  Time the result formatter against the old
+		                   printf loop, then exit.
+		--bench-descriptors
+		                   Time the descriptor allocator, then exit.
+		--bench-decode     Time the scalar, SIMD and native readback
+		                   decoders for every format, then exit.
+		--bench-allocator  Time the GPU memory suballocator and report
+		                   its fragmentation and aliasing savings, then
+		                   exit.
+		--bench-upload     Time the upload ring, then uploads into
+		                   compute buffers if there is a device, then
+		                   exit.
+		--bench-batch N    Time N dispatches submitted one at a time
+		                   against one compute batch, then exit.
+		--bench-record N   Record mock batches on 1 to 8 threads, then
+		                   N dispatches per batch on the device if
+		                   there is one, then exit.
+		--bench-suite      Sweep the job over sizes, formats, layouts and
+		                   group sizes, print the phase times, then exit.
+		--bench-cpu        Like --bench-suite, but on the CPU executor
+		                   without touching DirectX.
+		--bench-sizes LIST Square sizes to sweep, e.g. 256,1024.
+		--bench-formats LIST
+		                   Formats to sweep, e.g. R8G8B8A8_UNORM.
+		--bench-layouts LIST
+		                   Buffer layouts to sweep, e.g. texture,raw.
+		                   One of texture, structured or raw each.
+		--bench-groups LIST
+		                   Group sizes to sweep, e.g. 8x8,16x16.
+		--bench-warmup N   Unmeasured iterations per case.
+		--bench-iterations N
+		                   Measured iterations per case.
+		--bench-out FILE   Also write the results to FILE, as JSON if
+		                   it ends in .json and CSV otherwise.
+		--tiled WxH        Run the kernel over a W by H image in tiles,
+		                   write it to --tiled-out as raw float4 rows,
+		                   then exit.
+		--tile-size N      Largest tile, halo included. 4096 if not
+		                   given.
+		--tile-halo N      Texels of overlap around every tile.
+		--tiles-in-flight N
+		                   Tiles being worked on at once. Bounds the
+		                   memory the job takes.
+		--tiled-out FILE   Where --tiled writes. tiled.raw if not
+		                   given.
+		--manifest FILE    Run every job in the JSON manifest FILE on one
+		                   device, print each job's times, then exit.
+		                   See job_runner.h for the format.
+		--manifest-cpu FILE
+		                   Like --manifest, but on the CPU executor
+		                   without touching DirectX.
+		--split WxH        Run one W by H dispatch, cut between every
+		                   usable adapter and the --split-cpu-speeds
+		                   devices by how fast each has been, then
+		                   exit.
+		--split-cpu-speeds LIST
+		                   Add a CPU device per entry, that many times
+		                   slower than it really is, e.g. 1,2,4.
+		--split-iterations N
+		                   Dispatches to run, so the split can settle.
+		                   8 if not given.
+		--adapter N        Run on the Nth usable adapter, most video
+		                   memory first.
+		--graph            Run the compute job as a compute graph, which
+		                   works out its queues and barriers itself.
+		--graph-dot FILE   With --graph, write the compiled graph to FILE
+		                   for Graphviz.
+		--indirect N       Cull N items, compact the survivors and process
+		                   them through ExecuteIndirect, on the CPU and
+		                   then the GPU, check both, then exit.
+		--indirect-keep K  With --indirect, keep about K items in 1000.
+		                   250 if not given.
+		--permutations N   Build every permutation of hello_compute on N
+		                   threads (0 for one per hardware thread), as
+		                   an ahead of time cache warm, print the times,
+		                   then exit.
+		--bench-permutations
+		                   Time the compile driver on a mock compiler on
+		                   1 to 8 threads, and dxc if it is on the PATH,
+		                   then exit.
+		--tune             Time the kernel with every candidate group size
+		                   on this adapter, save the fastest to
+		                   threadgroup_tuning.txt, then exit. Later runs
+		                   on the same adapter use it.
+		--tune-groups LIST Group sizes to try, e.g. 8x8,32x8. The first
+		                   one is kept unless another is clearly faster.
+		--tune-warmup N    Unmeasured iterations per group size.
+		--tune-trials N    Measured iterations per group size.
+		--bench-tuner      Tune the CPU executor at a few sizes, print
+		                   what it found, then exit.
+		--wave-reduce N    Sum N values with the wave intrinsic kernel,
+		                   in float and half precision where the
+		                   device can, check the sums, then exit.
+		                   Needs the DXIL built into the binary.
+		--fxc              Compile every kernel with FXC, even those
+		                   built into the binary as DXIL.
+		--bench-dxil       Time the DXIL container reader, and compiling
+		                   the embedded kernels with dxc if it is on
+		                   the PATH, then exit.
+		--bench-graph      Time the compute graph compiler on random
+		                   graphs from 10 to 10000 passes, then exit.
+		--frames-in-flight N
+		                   Let the CPU record up to N batches ahead of
+		                   the GPU.
+		--iterations N     Run the compute job N times before reading
+		                   back the result.
+		--async-queues     Dispatch on a compute queue and copy the
+		                   results back on a copy queue.
+		--clear-shader-cache
+		                   Throw away cached shaders and pipelines
+		                   first, for a cold start.
+		--profile FILE     Time the CPU and GPU phases, write them to
+		                   FILE as a Chrome trace and print p50/p99
+		                   per phase.
 */
 
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
 #include "application.h"
 
 using namespace std;
 
-int main() {
+int main(int argc, char** argv) {
 	application* app;
+	app_options options;
+	FILE* sink;
+	bool ok;
+	unsigned int bench_batch_dispatches;
+	unsigned int bench_record_dispatches;
+	bench_suite_options bench_options;
+	bool bench_suite_on_gpu;
+	bool bench_uploads;
+	bool bench_suite_on_cpu;
+	const char* bench_out_path;
+	tiled_options tiled;
+	bool tiled_requested;
+	split_options split;
+	bool split_requested;
+	device_probe_cache probes;
+	const char* manifest_path;
+	bool manifest_on_cpu;
+	bool graph_requested;
+	const char* graph_dot_path;
+	unsigned int indirect_items;
+	unsigned int indirect_keep;
+	bool permutations_requested;
+	unsigned int permutation_threads;
+	tuning_database tuning;
+	tuning_options tune_options;
+	bool tune_requested;
+	vector<pair<unsigned int, unsigned int>> tune_groups;
+	unsigned int wave_reduce_items;
+
+	default_app_options(&options);
+	bench_batch_dispatches = 0;
+	bench_record_dispatches = 0;
+	bench_uploads = false;
+
+	default_bench_suite_options(&bench_options);
+	bench_suite_on_gpu = false;
+	bench_suite_on_cpu = false;
+	bench_out_path = NULL;
+
+	default_tiled_options(&tiled);
+	tiled_requested = false;
+
+	default_split_options(&split);
+	split_requested = false;
+
+	manifest_path = NULL;
+	manifest_on_cpu = false;
+
+	graph_requested = false;
+	graph_dot_path = NULL;
+
+	indirect_items = 0;
+	indirect_keep = 250;
+
+	permutations_requested = false;
+	permutation_threads = 0;
+
+	default_tuning_options(&tune_options);
+	tune_requested = false;
+
+	wave_reduce_items = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--summary") == 0) {
+			options.print_mode = RESULT_PRINT_SUMMARY;
+		}
+		else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			if (!parse_cpu_texel_format(argv[++i], &options.output_format)) {
+				cerr << "Bad --format: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+			options.frames_in_flight = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+			options.iterations = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--async-queues") == 0) {
+			options.async_queues = true;
+		}
+		else if (strcmp(argv[i], "--clear-shader-cache") == 0) {
+			options.clear_shader_cache = true;
+		}
+		else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+			options.trace_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--tiled") == 0 && i + 1 < argc) {
+			if (!parse_image_size(argv[++i], &tiled.image_width, &tiled.image_height)) {
+				cerr << "Bad --tiled size: " << argv[i] << endl;
+				return 1;
+			}
+
+			tiled_requested = true;
+		}
+		else if (strcmp(argv[i], "--tile-size") == 0 && i + 1 < argc) {
+			tiled.max_tile = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--tile-halo") == 0 && i + 1 < argc) {
+			tiled.halo = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--tiles-in-flight") == 0 && i + 1 < argc) {
+			tiled.tiles_in_flight = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--tiled-out") == 0 && i + 1 < argc) {
+			tiled.out_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--manifest") == 0 && i + 1 < argc) {
+			manifest_path = argv[++i];
+			manifest_on_cpu = false;
+		}
+		else if (strcmp(argv[i], "--manifest-cpu") == 0 && i + 1 < argc) {
+			manifest_path = argv[++i];
+			manifest_on_cpu = true;
+		}
+		else if (strcmp(argv[i], "--split") == 0 && i + 1 < argc) {
+			if (!parse_image_size(argv[++i], &split.image_width, &split.image_height)) {
+				cerr << "Bad --split size: " << argv[i] << endl;
+				return 1;
+			}
+
+			split_requested = true;
+		}
+		else if (strcmp(argv[i], "--split-cpu-speeds") == 0 && i + 1 < argc) {
+			if (!parse_device_speeds(argv[++i], &split.cpu_slowdowns)) {
+				cerr << "Bad --split-cpu-speeds list: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--split-iterations") == 0 && i + 1 < argc) {
+			split.iterations = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--adapter") == 0 && i + 1 < argc) {
+			options.adapter_index = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--graph") == 0) {
+			graph_requested = true;
+		}
+		else if (strcmp(argv[i], "--indirect") == 0 && i + 1 < argc) {
+			indirect_items = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--indirect-keep") == 0 && i + 1 < argc) {
+			indirect_keep = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--permutations") == 0 && i + 1 < argc) {
+			permutations_requested = true;
+			permutation_threads = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--tune") == 0) {
+			tune_requested = true;
+		}
+		else if (strcmp(argv[i], "--tune-groups") == 0 && i + 1 < argc) {
+			if (!parse_bench_group_sizes(argv[++i], &tune_groups)) {
+				cerr << "Bad --tune-groups list: " << argv[i] << endl;
+				return 1;
+			}
+
+			tune_options.candidates.clear();
+
+			for (const pair<unsigned int, unsigned int>& group : tune_groups) {
+				tune_options.candidates.push_back({ group.first, group.second });
+			}
+		}
+		else if (strcmp(argv[i], "--tune-warmup") == 0 && i + 1 < argc) {
+			tune_options.warmup_iterations = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--tune-trials") == 0 && i + 1 < argc) {
+			tune_options.trials = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--wave-reduce") == 0 && i + 1 < argc) {
+			wave_reduce_items = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--fxc") == 0) {
+			options.use_dxil = false;
+		}
+		else if (strcmp(argv[i], "--graph-dot") == 0 && i + 1 < argc) {
+			graph_dot_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--bench-batch") == 0 && i + 1 < argc) {
+			bench_batch_dispatches = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--bench-record") == 0 && i + 1 < argc) {
+			bench_record_dispatches = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--bench-upload") == 0) {
+			bench_uploads = true;
+		}
+		else if (strcmp(argv[i], "--bench-suite") == 0) {
+			bench_suite_on_gpu = true;
+		}
+		else if (strcmp(argv[i], "--bench-cpu") == 0) {
+			bench_suite_on_cpu = true;
+		}
+		else if (strcmp(argv[i], "--bench-sizes") == 0 && i + 1 < argc) {
+			if (!parse_bench_sizes(argv[++i], &bench_options.sizes)) {
+				cerr << "Bad --bench-sizes list: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--bench-formats") == 0 && i + 1 < argc) {
+			if (!parse_bench_formats(argv[++i], &bench_options.formats)) {
+				cerr << "Bad --bench-formats list: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--bench-layouts") == 0 && i + 1 < argc) {
+			if (!parse_bench_layouts(argv[++i], &bench_options.layouts)) {
+				cerr << "Bad --bench-layouts list: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--bench-groups") == 0 && i + 1 < argc) {
+			if (!parse_bench_group_sizes(argv[++i], &bench_options.group_sizes)) {
+				cerr << "Bad --bench-groups list: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--bench-warmup") == 0 && i + 1 < argc) {
+			bench_options.warmup_iterations = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--bench-iterations") == 0 && i + 1 < argc) {
+			bench_options.iterations = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--bench-out") == 0 && i + 1 < argc) {
+			bench_out_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--bench-formatter") == 0) {
+			if (fopen_s(&sink, "NUL", "w") != 0) {
+				cerr << "Could not open NUL for the formatter benchmark." << endl;
+				return 1;
+			}
+
+			benchmark_result_formatter(0, sink, stdout);
+			fclose(sink);
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-descriptors") == 0) {
+			benchmark_descriptor_allocator(stdout);
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-decode") == 0) {
+			benchmark_readback_decoders(stdout);
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-allocator") == 0) {
+			benchmark_suballocator(stdout);
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-graph") == 0) {
+			benchmark_compute_graph(stdout);
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-tuner") == 0) {
+			benchmark_threadgroup_tuner(stdout);
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-permutations") == 0) {
+			benchmark_shader_permutations(stdout);
+			return 0;
+		}
+		else if (strcmp(argv[i], "--bench-dxil") == 0) {
+			benchmark_dxil_compile_path(stdout);
+			return 0;
+		}
+	}
+
+	//
+	// The CPU sweep and CPU manifests don't need a device, so they run
+	// before DirectX is brought up. That keeps them working on machines
+	// without a GPU.
+	//
+
+	if (bench_suite_on_cpu) {
+		benchmark_suite(NULL, &bench_options, bench_out_path);
+		return 0;
+	}
+
+	if (manifest_path != NULL && manifest_on_cpu) {
+		return run_manifest(NULL, manifest_path) ? 0 : 1;
+	}
 
 	cout << "Hello, DirectX 12" << endl;
 
+	//
+	// Adapters seen on an earlier run aren't probed again.
+	//
+
+	load_device_probe_cache(&probes, DEVICE_PROBE_CACHE_PATH);
+	options.probes = &probes;
+
+	//
+	// Group sizes tuned on an earlier run are used again.
+	//
+
+	load_tuning_database(&tuning, TUNING_DATABASE_PATH);
+	options.tuning = &tuning;
+
 	app = new application;
-	initialize_application(app);
-	run_compute(app);
-	read_back_data(app);
+	initialize_application(app, &options);
+
+	//
+	// Each mode runs and falls through to the one teardown below.
+	//
+
+	ok = true;
+
+	if (manifest_path != NULL) {
+		ok = run_manifest(app, manifest_path);
+	}
+	else if (split_requested) {
+		ok = run_split(app, &options, &split);
+	}
+	else if (graph_requested) {
+		ok = run_compute_graph(app, options.iterations, graph_dot_path);
+
+		if (ok) {
+			read_back_data(app);
+		}
+	}
+	else if (indirect_items > 0) {
+		ok = run_indirect_chain(app, indirect_items, indirect_keep);
+	}
+	else if (tune_requested) {
+		ok = tune_threadgroups(app, &tune_options, &tuning);
+	}
+	else if (permutations_requested) {
+		ok = run_permutations(app, permutation_threads);
+	}
+	else if (wave_reduce_items > 0) {
+		ok = run_wave_reduce(app, wave_reduce_items);
+	}
+	else if (bench_batch_dispatches > 0) {
+		benchmark_dispatch_batching(app, bench_batch_dispatches, stdout);
+	}
+	else if (bench_record_dispatches > 0) {
+		benchmark_parallel_recording(app, bench_record_dispatches, stdout);
+	}
+	else if (tiled_requested) {
+		ok = run_tiled(app, &tiled);
+	}
+	else if (bench_uploads) {
+		benchmark_uploads(app, stdout);
+	}
+	else if (bench_suite_on_gpu) {
+		benchmark_suite(app, &bench_options, bench_out_path);
+	}
+	else {
+		for (unsigned int i = 0; i < options.iterations; i++) {
+			run_compute(app);
+		}
+
+		read_back_data(app);
+		print_batch_stats(app);
+		write_profile(app);
+	}
 
 	shutdown_app(app);
 	delete app;
+	save_device_probe_cache(&probes);
+
+	if (tune_requested && ok && !save_tuning_database(&tuning)) {
+		cerr << "Could not write " << TUNING_DATABASE_PATH << endl;
+		ok = false;
+	}
 
-	return 0;
-}
\ No newline at end of file
+	return ok ? 0 : 1;
+}
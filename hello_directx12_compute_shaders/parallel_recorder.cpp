@@ -0,0 +1,170 @@
+// Liam Wynn, 01/10/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "parallel_recorder.h"
+#include "utils.h"
+#include <thread>
+
+using namespace std;
+
+/*
+	Hands each chunk its own list. Close is called on the worker, and
+	its result checked once every thread is done, so nothing throws off
+	the main thread.
+*/
+struct d3d12_chunk_recorder : chunk_recorder {
+	parallel_record_job* job;
+	vector<ID3D12GraphicsCommandList*> lists;
+	vector<HRESULT> results;
+
+	void record_chunk(const unsigned int index, const recording_chunk* chunk) override {
+		job->record_chunk(lists[index], chunk);
+		results[index] = lists[index]->Close();
+	}
+};
+
+void initialize_parallel_recorder(
+	parallel_recorder* recorder,
+	dx12_handler* dx12,
+	dx12_queue* queue,
+	const unsigned int num_threads
+) {
+	recorder->dx12 = dx12;
+	recorder->queue = queue;
+	recorder->num_threads = num_threads;
+
+	if (recorder->num_threads == 0) {
+		recorder->num_threads = thread::hardware_concurrency();
+	}
+
+	if (recorder->num_threads == 0) {
+		recorder->num_threads = 1;
+	}
+
+	recorder->min_chunk_items = DEFAULT_MIN_CHUNK_ITEMS;
+
+	//
+	// One slot per thread per frame in flight, and one more frame's
+	// worth so recording doesn't wait on the batch just submitted.
+	//
+
+	initialize_recording_pool(
+		&recorder->pool,
+		queue->timeline,
+		recorder->num_threads * (dx12->frames_in_flight + 1),
+		DEFAULT_RECYCLE_ITEMS,
+		DEFAULT_IDLE_BATCHES
+	);
+
+	recorder->allocators.clear();
+	recorder->lists.clear();
+}
+
+queue_ticket submit_parallel_batch(
+	parallel_recorder* recorder,
+	parallel_record_job* job,
+	const unsigned int num_items,
+	const queue_ticket* deps,
+	const unsigned int num_deps
+) {
+	ID3D12Device5* device;
+	vector<recording_chunk> chunks;
+	vector<unsigned int> slots;
+	vector<ID3D12CommandList*> extra_lists;
+	vector<unsigned int> released;
+	d3d12_chunk_recorder chunk_recorder;
+	queue_ticket ticket;
+	HRESULT result;
+
+	device = recorder->dx12->device.Get();
+	chunks = plan_recording_chunks(num_items, recorder->num_threads, recorder->min_chunk_items);
+
+	chunk_recorder.job = job;
+	chunk_recorder.results.assign(chunks.size(), S_OK);
+
+	//
+	// Slots are handed out here, on one thread. A fresh one gets a new
+	// allocator and list, the rest are reset.
+	//
+
+	for (size_t c = 0; c < chunks.size(); c++) {
+		bool fresh;
+		unsigned int slot;
+
+		slot = acquire_recording_slot(&recorder->pool, &fresh);
+
+		if (slot >= recorder->allocators.size()) {
+			recorder->allocators.resize(slot + 1);
+			recorder->lists.resize(slot + 1);
+		}
+
+		if (fresh) {
+			recorder->lists[slot].Reset();
+			recorder->allocators[slot].Reset();
+
+			result = device->CreateCommandAllocator(
+				recorder->queue->type,
+				IID_PPV_ARGS(&recorder->allocators[slot])
+			);
+			throw_if_failed(result);
+
+			result = device->CreateCommandList(
+				0,
+				recorder->queue->type,
+				recorder->allocators[slot].Get(),
+				NULL,
+				IID_PPV_ARGS(&recorder->lists[slot])
+			);
+			throw_if_failed(result);
+		}
+		else {
+			result = recorder->allocators[slot]->Reset();
+			throw_if_failed(result);
+
+			result = recorder->lists[slot]->Reset(recorder->allocators[slot].Get(), NULL);
+			throw_if_failed(result);
+		}
+
+		slots.push_back(slot);
+		chunk_recorder.lists.push_back(recorder->lists[slot].Get());
+	}
+
+	record_chunks_in_parallel(chunks, recorder->num_threads, &chunk_recorder);
+
+	for (HRESULT r : chunk_recorder.results) {
+		throw_if_failed(r);
+	}
+
+	for (ID3D12GraphicsCommandList* list : chunk_recorder.lists) {
+		extra_lists.push_back(list);
+	}
+
+	ticket = submit_command_batch_lists(
+		recorder->dx12,
+		recorder->queue,
+		extra_lists.data(),
+		(unsigned int)extra_lists.size(),
+		deps,
+		num_deps
+	);
+
+	for (size_t c = 0; c < chunks.size(); c++) {
+		retire_recording_slot(&recorder->pool, slots[c], chunks[c].num_items, ticket.value);
+	}
+
+	end_recording_batch(&recorder->pool, &released);
+
+	for (unsigned int slot : released) {
+		recorder->lists[slot].Reset();
+		recorder->allocators[slot].Reset();
+	}
+
+	return ticket;
+}
+
+void shutdown_parallel_recorder(parallel_recorder* recorder) {
+	flush_command_batches(recorder->queue);
+
+	recorder->lists.clear();
+	recorder->allocators.clear();
+	recorder->pool.slots.clear();
+}
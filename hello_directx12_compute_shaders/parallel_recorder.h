@@ -0,0 +1,69 @@
+// Liam Wynn, 01/10/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	Records one batch on several threads (see recording_pool.h). The
+	batch's own list, from begin_command_batch, goes first and holds
+	whatever the caller recorded into it, plus the barriers the tracker
+	has pending. Then come the chunk lists, in chunk order, all in one
+	ExecuteCommandLists.
+
+	Chunks are recorded at the same time, so a job mustn't touch the
+	resource state tracker: put everything in the states the batch
+	needs before submitting it. Each chunk list starts with nothing
+	bound, and any UAV barriers between dispatches are up to the job.
+*/
+
+#pragma once
+
+#include "dx12_handler.h"
+#include "recording_pool.h"
+
+struct parallel_record_job {
+	virtual ~parallel_record_job() {}
+
+	virtual void record_chunk(
+		ID3D12GraphicsCommandList* command_list,
+		const recording_chunk* chunk
+	) = 0;
+};
+
+struct parallel_recorder {
+	dx12_handler* dx12;
+	dx12_queue* queue;
+
+	recording_pool pool;
+
+	// Per pool slot. NULL while the slot isn't live.
+	std::vector<ComPtr<ID3D12CommandAllocator>> allocators;
+	std::vector<ComPtr<ID3D12GraphicsCommandList>> lists;
+
+	unsigned int num_threads;
+	unsigned int min_chunk_items;
+};
+
+/*
+	Up to num_threads threads (0 for one per hardware thread), each
+	with an allocator and list per frame in flight.
+*/
+void initialize_parallel_recorder(
+	parallel_recorder* recorder,
+	dx12_handler* dx12,
+	dx12_queue* queue,
+	const unsigned int num_threads
+);
+
+/*
+	Records num_items items of job across the threads and submits them
+	after the batch begun on the recorder's queue. Returns the batch's
+	ticket.
+*/
+queue_ticket submit_parallel_batch(
+	parallel_recorder* recorder,
+	parallel_record_job* job,
+	const unsigned int num_items,
+	const queue_ticket* deps,
+	const unsigned int num_deps
+);
+
+// Waits for the queue, then drops every allocator and list.
+void shutdown_parallel_recorder(parallel_recorder* recorder);
@@ -0,0 +1,284 @@
+// Liam Wynn, 12/19/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "pipeline_cache.h"
+#include "utils.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+struct compute_pipeline_stream {
+	CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE root_sig;
+	CD3DX12_PIPELINE_STATE_STREAM_CS bytecode;
+};
+
+void initialize_pipeline_cache(
+	pipeline_cache* cache,
+	dx12_handler* dx12,
+	const string& directory
+) {
+	ifstream file;
+	stringstream contents;
+	string data;
+	HRESULT result;
+
+	initialize_shader_cache(&cache->shaders, directory);
+
+	cache->library_path = directory + "/pipelines.bin";
+	cache->library_dirty = false;
+	cache->pipeline_hits = 0;
+	cache->pipeline_misses = 0;
+
+	//
+	// Read the serialized library, if there is one.
+	//
+
+	file.open(cache->library_path, ios::binary);
+	if (file) {
+		contents << file.rdbuf();
+		data = contents.str();
+		cache->library_data.assign(data.begin(), data.end());
+	}
+
+	result = E_FAIL;
+
+	if (!cache->library_data.empty()) {
+		result = dx12->device->CreatePipelineLibrary(
+			cache->library_data.data(),
+			cache->library_data.size(),
+			IID_PPV_ARGS(&cache->library)
+		);
+	}
+
+	//
+	// No file, or the driver doesn't accept it (different driver
+	// version, different adapter, corrupt). Start an empty library.
+	//
+
+	if (FAILED(result)) {
+		cache->library_data.clear();
+		cache->library.Reset();
+
+		result = dx12->device->CreatePipelineLibrary(
+			NULL,
+			0,
+			IID_PPV_ARGS(&cache->library)
+		);
+
+		// Some drivers don't support pipeline libraries at all. Then
+		// we just build every pipeline from scratch.
+		if (FAILED(result)) {
+			cache->library.Reset();
+		}
+	}
+}
+
+bool compile_shader_uncached(
+	const string& source_path,
+	const shader_defines& defines,
+	const string& entry_point,
+	const string& profile,
+	const UINT compile_flags,
+	vector<unsigned char>* bytecode,
+	string* error
+) {
+	vector<D3D_SHADER_MACRO> macros;
+	wstring wide_path;
+	ComPtr<ID3DBlob> compute_blob;
+	ComPtr<ID3DBlob> err_blob;
+	const unsigned char* blob_data;
+	HRESULT result;
+
+	for (const pair<string, string>& define : defines) {
+		macros.push_back({ define.first.c_str(), define.second.c_str() });
+	}
+
+	macros.push_back({ NULL, NULL });
+
+	wide_path = wstring(source_path.begin(), source_path.end());
+
+	result = D3DCompileFromFile(
+		wide_path.c_str(),
+		macros.data(),
+		D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		entry_point.c_str(),
+		profile.c_str(),
+		compile_flags,
+		0,
+		&compute_blob,
+		&err_blob
+	);
+
+	if (FAILED(result)) {
+		*error = err_blob != NULL ? (char*)err_blob->GetBufferPointer() : "D3DCompileFromFile failed";
+		return false;
+	}
+
+	blob_data = reinterpret_cast<const unsigned char*>(compute_blob->GetBufferPointer());
+	bytecode->assign(blob_data, blob_data + compute_blob->GetBufferSize());
+
+	return true;
+}
+
+vector<unsigned char> compile_shader_cached(
+	pipeline_cache* cache,
+	const string& source_path,
+	const shader_defines& defines,
+	const string& entry_point,
+	const string& profile,
+	const UINT compile_flags,
+	shader_cache_key* key
+) {
+	vector<unsigned char> bytecode;
+	string error;
+
+	//
+	// Try the disk cache first.
+	//
+
+	if (!make_shader_cache_key(source_path, defines, entry_point, profile, compile_flags, key)) {
+		cerr << "Could not read shader source " << source_path << endl;
+		throw std::exception();
+	}
+
+	if (load_cached_shader(&cache->shaders, key, &bytecode)) {
+		return bytecode;
+	}
+
+	//
+	// Miss. Compile it and remember the result.
+	//
+
+	if (!compile_shader_uncached(source_path, defines, entry_point, profile, compile_flags, &bytecode, &error)) {
+		cerr << error << endl;
+		throw std::exception();
+	}
+
+	store_cached_shader(&cache->shaders, key, bytecode.data(), bytecode.size());
+
+	return bytecode;
+}
+
+ComPtr<ID3D12PipelineState> load_or_create_compute_pipeline(
+	pipeline_cache* cache,
+	dx12_handler* dx12,
+	ID3D12RootSignature* root_signature,
+	const uint64_t root_signature_hash,
+	const vector<unsigned char>& bytecode,
+	const shader_cache_key* shader_key
+) {
+	ComPtr<ID3D12PipelineState> pipeline_state;
+	D3D12_PIPELINE_STATE_STREAM_DESC stream_desc;
+	compute_pipeline_stream pss;
+	string name;
+	wstring wide_name;
+	HRESULT result;
+
+	pss.root_sig = root_signature;
+	pss.bytecode = CD3DX12_SHADER_BYTECODE(bytecode.data(), bytecode.size());
+	stream_desc = { sizeof(pss), &pss };
+
+	name = hash_to_name(hash_bytes(&root_signature_hash, sizeof(root_signature_hash), shader_key->hash));
+	wide_name = wstring(name.begin(), name.end());
+
+	//
+	// LoadPipeline fails if the name isn't there (or was stored with a
+	// different description). Either way, build it and store it.
+	//
+
+	if (cache->library != NULL) {
+		result = cache->library->LoadPipeline(
+			wide_name.c_str(),
+			&stream_desc,
+			IID_PPV_ARGS(&pipeline_state)
+		);
+
+		if (SUCCEEDED(result)) {
+			cache->pipeline_hits++;
+			return pipeline_state;
+		}
+	}
+
+	cache->pipeline_misses++;
+
+	result = dx12->device->CreatePipelineState(
+		&stream_desc,
+		IID_PPV_ARGS(&pipeline_state)
+	);
+
+	throw_if_failed(result);
+
+	if (cache->library != NULL) {
+		result = cache->library->StorePipeline(wide_name.c_str(), pipeline_state.Get());
+
+		if (SUCCEEDED(result)) {
+			cache->library_dirty = true;
+		}
+	}
+
+	return pipeline_state;
+}
+
+void save_pipeline_cache(pipeline_cache* cache) {
+	vector<unsigned char> data;
+	string temp_path;
+	error_code err;
+	HRESULT result;
+
+	if (cache->library == NULL || !cache->library_dirty) {
+		return;
+	}
+
+	data.resize(cache->library->GetSerializedSize());
+
+	result = cache->library->Serialize(data.data(), data.size());
+	throw_if_failed(result);
+
+	//
+	// Same as the shader cache: write it aside and rename it over the
+	// old one in a single step, so a crash or a full disk leaves either
+	// the old library or the new one. If it fails, the library stays
+	// dirty and the next save tries again.
+	//
+
+	temp_path = cache->library_path + ".tmp";
+
+	{
+		ofstream file(temp_path, ios::binary | ios::trunc);
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		file.close();
+
+		if (!file.good()) {
+			cerr << "Could not write the pipeline library to " << temp_path << endl;
+			fs::remove(temp_path, err);
+			return;
+		}
+	}
+
+	fs::rename(temp_path, cache->library_path, err);
+
+	if (err) {
+		cerr << "Could not replace the pipeline library " << cache->library_path << endl;
+		fs::remove(temp_path, err);
+		return;
+	}
+
+	cache->library_dirty = false;
+}
+
+void shutdown_pipeline_cache(pipeline_cache* cache) {
+	save_pipeline_cache(cache);
+
+	cache->library.Reset();
+	cache->library_data.clear();
+}
+
+void clear_pipeline_cache(const string& directory) {
+	shader_cache cache;
+
+	initialize_shader_cache(&cache, directory);
+	clear_shader_cache(&cache);
+}
@@ -0,0 +1,82 @@
+// Liam Wynn, 12/19/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The pipeline cache makes a warm start skip both the shader compile
+	and the driver's pipeline build.
+
+	Compiled bytecode goes through the on-disk shader_cache. Pipeline
+	states go through an ID3D12PipelineLibrary that is serialized to
+	pipelines.bin in the same directory. A pipeline is named after the
+	hash of its shader key and root signature, so changing either one
+	just looks up a different name.
+
+	If the library file was written by another driver or adapter the
+	driver refuses it, and we start over with an empty library.
+*/
+
+#pragma once
+
+#include "stdafx.h"
+#include "dx12_handler.h"
+#include "shader_cache.h"
+#include <string>
+#include <vector>
+
+struct pipeline_cache {
+	shader_cache shaders;
+
+	// library_data backs library, so it has to outlive it.
+	ComPtr<ID3D12PipelineLibrary1> library;
+	std::vector<unsigned char> library_data;
+	std::string library_path;
+	bool library_dirty;
+
+	unsigned int pipeline_hits;
+	unsigned int pipeline_misses;
+};
+
+void initialize_pipeline_cache(
+	pipeline_cache* cache,
+	dx12_handler* dx12,
+	const std::string& directory
+);
+
+/*
+	Just the compile, with no cache. Doesn't touch anything shared, so
+	several threads can compile at once. Returns false with the
+	compiler's messages in error if it fails.
+*/
+bool compile_shader_uncached(
+	const std::string& source_path,
+	const shader_defines& defines,
+	const std::string& entry_point,
+	const std::string& profile,
+	const UINT compile_flags,
+	std::vector<unsigned char>* bytecode,
+	std::string* error
+);
+
+std::vector<unsigned char> compile_shader_cached(
+	pipeline_cache* cache,
+	const std::string& source_path,
+	const shader_defines& defines,
+	const std::string& entry_point,
+	const std::string& profile,
+	const UINT compile_flags,
+	shader_cache_key* key
+);
+
+ComPtr<ID3D12PipelineState> load_or_create_compute_pipeline(
+	pipeline_cache* cache,
+	dx12_handler* dx12,
+	ID3D12RootSignature* root_signature,
+	const uint64_t root_signature_hash,
+	const std::vector<unsigned char>& bytecode,
+	const shader_cache_key* shader_key
+);
+
+void save_pipeline_cache(pipeline_cache* cache);
+void shutdown_pipeline_cache(pipeline_cache* cache);
+
+// Deletes the cached bytecode and pipelines in directory.
+void clear_pipeline_cache(const std::string& directory);
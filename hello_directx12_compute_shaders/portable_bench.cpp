@@ -0,0 +1,349 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The benchmarks that don't need DirectX, as a program of their own so
+	they build and run anywhere (see CMakeLists.txt at the top of the
+	repository). Everything runs on the CPU:
+
+	suite        The benchmark suite on cpu_bench_backend.
+	tiler        A tiled job on cpu_tile_backend, into memory.
+	formatter    The result formatter against the old printf loop.
+	allocator    The GPU memory suballocator's planning and aliasing.
+	descriptors  The descriptor allocator's persistent and transient slots.
+	upload       The upload ring's allocation throughput and blocking waits.
+	decode       The readback decoders, scalar against SIMD.
+	graph        The compute graph compiler on random graphs of 10 to 10000 passes.
+	record       The recording pool on 1 to 8 threads, against a mock fence.
+
+	Each one is timed with a profile_scope, and the profiler's summary
+	is printed at the end.
+
+	Command line options:
+		--only LIST        Run only these, e.g. suite,tiler. All of them
+		                   if not given.
+		--bench-sizes LIST, --bench-formats LIST, --bench-layouts LIST,
+		--bench-groups LIST, --bench-warmup N, --bench-iterations N,
+		--bench-out FILE   As for the main program's --bench-cpu.
+		--tiled WxH        Image size for the tiler. 2048x2048 if not
+		                   given.
+		--tile-size N, --tile-halo N, --tiles-in-flight N
+		                   As for the main program's --tiled.
+		--profile FILE     Also write the phases to FILE as a Chrome
+		                   trace.
+*/
+
+#include "benchmark_suite.h"
+#include "compute_graph.h"
+#include "descriptor_allocator.h"
+#include "profiler.h"
+#include "readback_decoder.h"
+#include "recording_pool.h"
+#include "result_formatter.h"
+#include "suballocator.h"
+#include "tiler.h"
+#include "upload_ring.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+enum portable_bench {
+	PORTABLE_BENCH_SUITE,
+	PORTABLE_BENCH_TILER,
+	PORTABLE_BENCH_FORMATTER,
+	PORTABLE_BENCH_ALLOCATOR,
+	PORTABLE_BENCH_DESCRIPTORS,
+	PORTABLE_BENCH_UPLOAD,
+	PORTABLE_BENCH_DECODE,
+	PORTABLE_BENCH_GRAPH,
+	PORTABLE_BENCH_RECORD,
+	PORTABLE_BENCH_COUNT
+};
+
+static const char* portable_bench_names[PORTABLE_BENCH_COUNT] = {
+	"suite",
+	"tiler",
+	"formatter",
+	"allocator",
+	"descriptors",
+	"upload",
+	"decode",
+	"graph",
+	"record"
+};
+
+static bool parse_portable_benches(const char* text, bool enabled[PORTABLE_BENCH_COUNT]) {
+	string list;
+	size_t start;
+
+	list = text;
+	start = 0;
+
+	for (int b = 0; b < PORTABLE_BENCH_COUNT; b++) {
+		enabled[b] = false;
+	}
+
+	while (start <= list.size()) {
+		size_t end = list.find(',', start);
+		string name;
+		bool found;
+
+		if (end == string::npos) {
+			end = list.size();
+		}
+
+		name = list.substr(start, end - start);
+		found = false;
+
+		for (int b = 0; b < PORTABLE_BENCH_COUNT; b++) {
+			if (name == portable_bench_names[b]) {
+				enabled[b] = true;
+				found = true;
+			}
+		}
+
+		if (!found) {
+			return false;
+		}
+
+		start = end + 1;
+	}
+
+	return true;
+}
+
+static bool run_suite(const bench_suite_options* options, const char* out_path) {
+	cpu_bench_backend cpu;
+	vector<bench_result> results;
+
+	initialize_cpu_bench_backend(&cpu, 0);
+	results = run_bench_suite(&cpu, options, stderr);
+	print_bench_results(results, stdout);
+
+	if (out_path != NULL && !write_bench_results(results, out_path)) {
+		cerr << "Could not write the benchmark results to " << out_path << endl;
+		return false;
+	}
+
+	return true;
+}
+
+static bool run_tiler(
+	const unsigned int width,
+	const unsigned int height,
+	const unsigned int max_tile,
+	const unsigned int halo,
+	const unsigned int tiles_in_flight
+) {
+	tile_grid grid;
+	cpu_tile_backend cpu;
+	memory_tile_output output;
+	tiled_job_stats stats;
+
+	if (!plan_tile_grid(width, height, max_tile, max_tile, halo, &grid)) {
+		cerr << "A halo of " << halo << " leaves no room in a " << max_tile << " texel tile." << endl;
+		return false;
+	}
+
+	initialize_memory_tile_output(&output, &grid, CPU_FLOAT4_SIZE);
+	initialize_cpu_tile_backend(&cpu, &grid, tiles_in_flight, 0);
+
+	stats = run_tiled_job(&grid, &cpu, NULL, &output, tiles_in_flight);
+
+	cout << "Tiled " << grid.image_width << "x" << grid.image_height << " on the "
+		<< cpu.name() << ": " << stats.tiles << " tiles of up to "
+		<< grid.max_region_width << "x" << grid.max_region_height << " (halo "
+		<< grid.halo << "), " << stats.max_in_flight << " in flight, "
+		<< stats.seconds << " s, " << stats.mpixels_per_second << " Mpixel/s" << endl;
+
+	return stats.written;
+}
+
+static bool run_formatter() {
+	FILE* sink;
+
+	//
+	// The text itself isn't interesting, only how long it takes.
+	//
+
+#if defined(_MSC_VER)
+	if (fopen_s(&sink, "NUL", "w") != 0) {
+		sink = NULL;
+	}
+#elif defined(_WIN32)
+	sink = fopen("NUL", "w");
+#else
+	sink = fopen("/dev/null", "w");
+#endif
+
+	if (sink == NULL) {
+		cerr << "Could not open the null device for the formatter benchmark." << endl;
+		return false;
+	}
+
+	benchmark_result_formatter(0, sink, stdout);
+	fclose(sink);
+
+	return true;
+}
+
+int main(int argc, char** argv) {
+	bool enabled[PORTABLE_BENCH_COUNT];
+	bench_suite_options bench_options;
+	const char* bench_out_path;
+	unsigned int tiled_width;
+	unsigned int tiled_height;
+	unsigned int tile_size;
+	unsigned int tile_halo;
+	unsigned int tiles_in_flight;
+	const char* trace_path;
+	profiler prof;
+	bool ok;
+
+	for (int b = 0; b < PORTABLE_BENCH_COUNT; b++) {
+		enabled[b] = true;
+	}
+
+	default_bench_suite_options(&bench_options);
+	bench_out_path = NULL;
+
+	tiled_width = 2048;
+	tiled_height = 2048;
+	tile_size = 1024;
+	tile_halo = 0;
+	tiles_in_flight = 2;
+
+	trace_path = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+			if (!parse_portable_benches(argv[++i], enabled)) {
+				cerr << "Bad --only list: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--bench-sizes") == 0 && i + 1 < argc) {
+			if (!parse_bench_sizes(argv[++i], &bench_options.sizes)) {
+				cerr << "Bad --bench-sizes list: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--bench-formats") == 0 && i + 1 < argc) {
+			if (!parse_bench_formats(argv[++i], &bench_options.formats)) {
+				cerr << "Bad --bench-formats list: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--bench-layouts") == 0 && i + 1 < argc) {
+			if (!parse_bench_layouts(argv[++i], &bench_options.layouts)) {
+				cerr << "Bad --bench-layouts list: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--bench-groups") == 0 && i + 1 < argc) {
+			if (!parse_bench_group_sizes(argv[++i], &bench_options.group_sizes)) {
+				cerr << "Bad --bench-groups list: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--bench-warmup") == 0 && i + 1 < argc) {
+			bench_options.warmup_iterations = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--bench-iterations") == 0 && i + 1 < argc) {
+			bench_options.iterations = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--bench-out") == 0 && i + 1 < argc) {
+			bench_out_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--tiled") == 0 && i + 1 < argc) {
+			if (!parse_image_size(argv[++i], &tiled_width, &tiled_height)) {
+				cerr << "Bad --tiled size: " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--tile-size") == 0 && i + 1 < argc) {
+			tile_size = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--tile-halo") == 0 && i + 1 < argc) {
+			tile_halo = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--tiles-in-flight") == 0 && i + 1 < argc) {
+			tiles_in_flight = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+			trace_path = argv[++i];
+		}
+		else {
+			cerr << "Unknown option: " << argv[i] << endl;
+			return 1;
+		}
+	}
+
+	initialize_profiler(&prof);
+	ok = true;
+
+	if (enabled[PORTABLE_BENCH_SUITE]) {
+		profile_scope scope(&prof, "suite");
+
+		ok = run_suite(&bench_options, bench_out_path) && ok;
+	}
+
+	if (enabled[PORTABLE_BENCH_TILER]) {
+		profile_scope scope(&prof, "tiler");
+
+		ok = run_tiler(tiled_width, tiled_height, tile_size, tile_halo, tiles_in_flight) && ok;
+	}
+
+	if (enabled[PORTABLE_BENCH_FORMATTER]) {
+		profile_scope scope(&prof, "formatter");
+
+		ok = run_formatter() && ok;
+	}
+
+	if (enabled[PORTABLE_BENCH_ALLOCATOR]) {
+		profile_scope scope(&prof, "allocator");
+
+		benchmark_suballocator(stdout);
+	}
+
+	if (enabled[PORTABLE_BENCH_DESCRIPTORS]) {
+		profile_scope scope(&prof, "descriptors");
+
+		benchmark_descriptor_allocator(stdout);
+	}
+
+	if (enabled[PORTABLE_BENCH_UPLOAD]) {
+		profile_scope scope(&prof, "upload");
+
+		benchmark_upload_ring(stdout);
+	}
+
+	if (enabled[PORTABLE_BENCH_DECODE]) {
+		profile_scope scope(&prof, "decode");
+
+		benchmark_readback_decoders(stdout);
+	}
+
+	if (enabled[PORTABLE_BENCH_GRAPH]) {
+		profile_scope scope(&prof, "graph");
+
+		benchmark_compute_graph(stdout);
+	}
+
+	if (enabled[PORTABLE_BENCH_RECORD]) {
+		profile_scope scope(&prof, "record");
+
+		benchmark_recording_pool(stdout);
+	}
+
+	print_profile_summary(&prof, stdout);
+
+	if (trace_path != NULL && !write_chrome_trace_file(&prof, trace_path)) {
+		cerr << "Could not write " << trace_path << endl;
+		ok = false;
+	}
+
+	return ok ? 0 : 1;
+}
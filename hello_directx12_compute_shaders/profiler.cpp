@@ -0,0 +1,258 @@
+// Liam Wynn, 12/27/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <utility>
+
+using namespace std;
+
+static atomic<unsigned int> next_thread_number(1);
+static thread_local string thread_name;
+static thread_local unsigned int thread_number = 0;
+
+void initialize_profiler(profiler* prof) {
+	prof->epoch = chrono::steady_clock::now();
+	prof->main_thread = this_thread::get_id();
+	prof->events.clear();
+}
+
+string profile_thread_track(const profiler* prof) {
+	if (!thread_name.empty()) {
+		return "cpu: " + thread_name;
+	}
+
+	if (this_thread::get_id() == prof->main_thread) {
+		return "cpu";
+	}
+
+	if (thread_number == 0) {
+		thread_number = next_thread_number++;
+	}
+
+	return "cpu " + to_string(thread_number);
+}
+
+void set_profile_thread_name(const string& name) {
+	thread_name = name;
+}
+
+double profiler_now_us(const profiler* prof) {
+	return profiler_time_us(prof, chrono::steady_clock::now());
+}
+
+double profiler_time_us(
+	const profiler* prof,
+	const chrono::steady_clock::time_point time
+) {
+	return chrono::duration<double, micro>(time - prof->epoch).count();
+}
+
+void record_profile_event(
+	profiler* prof,
+	const string& track,
+	const string& name,
+	const double start_us,
+	const double duration_us
+) {
+	profile_event event;
+
+	if (prof == NULL) {
+		return;
+	}
+
+	event.name = name;
+	event.track = track;
+	event.start_us = start_us;
+	event.duration_us = duration_us;
+
+	lock_guard<mutex> guard(prof->lock);
+	prof->events.push_back(event);
+}
+
+profile_scope::profile_scope(profiler* prof, const char* name) {
+	this->prof = prof;
+	this->name = name;
+	this->start_us = prof != NULL ? profiler_now_us(prof) : 0.0;
+}
+
+profile_scope::~profile_scope() {
+	if (prof == NULL) {
+		return;
+	}
+
+	record_profile_event(prof, profile_thread_track(prof), name, start_us, profiler_now_us(prof) - start_us);
+}
+
+double percentile(vector<double>* values, const double p) {
+	size_t rank;
+
+	if (values->empty()) {
+		return 0.0;
+	}
+
+	sort(values->begin(), values->end());
+
+	//
+	// Nearest rank: the smallest value with at least p% of the values
+	// at or below it.
+	//
+
+	rank = (size_t)ceil(p / 100.0 * values->size());
+	rank = max((size_t)1, min(rank, values->size()));
+
+	return (*values)[rank - 1];
+}
+
+vector<profile_phase_summary> summarize_profile(profiler* prof) {
+	map<pair<string, string>, vector<double>> phases;
+	vector<profile_phase_summary> summaries;
+
+	{
+		lock_guard<mutex> guard(prof->lock);
+
+		for (const profile_event& event : prof->events) {
+			phases[make_pair(event.track, event.name)].push_back(event.duration_us);
+		}
+	}
+
+	for (pair<const pair<string, string>, vector<double>>& phase : phases) {
+		profile_phase_summary summary;
+
+		summary.track = phase.first.first;
+		summary.name = phase.first.second;
+		summary.count = phase.second.size();
+		summary.total_us = 0.0;
+
+		for (double d : phase.second) {
+			summary.total_us += d;
+		}
+
+		summary.mean_us = summary.total_us / summary.count;
+		summary.p50_us = percentile(&phase.second, 50.0);
+		summary.p99_us = percentile(&phase.second, 99.0);
+		summary.max_us = phase.second.back();
+
+		summaries.push_back(summary);
+	}
+
+	return summaries;
+}
+
+void print_profile_summary(profiler* prof, FILE* out) {
+	vector<profile_phase_summary> summaries;
+
+	summaries = summarize_profile(prof);
+
+	fprintf(out, "%-16s %-24s %8s %12s %12s %12s %12s\n", "track", "phase", "count", "mean us", "p50 us", "p99 us", "max us");
+
+	for (const profile_phase_summary& s : summaries) {
+		fprintf(
+			out,
+			"%-16s %-24s %8zu %12.1f %12.1f %12.1f %12.1f\n",
+			s.track.c_str(),
+			s.name.c_str(),
+			s.count,
+			s.mean_us,
+			s.p50_us,
+			s.p99_us,
+			s.max_us
+		);
+	}
+}
+
+static void write_json_string(FILE* out, const string& text) {
+	fputc('"', out);
+
+	for (unsigned char c : text) {
+		switch (c) {
+		case '"':
+			fputs("\\\"", out);
+			break;
+		case '\\':
+			fputs("\\\\", out);
+			break;
+		case '\n':
+			fputs("\\n", out);
+			break;
+		case '\t':
+			fputs("\\t", out);
+			break;
+		default:
+			if (c < 0x20) {
+				fprintf(out, "\\u%04x", c);
+			}
+			else {
+				fputc(c, out);
+			}
+		}
+	}
+
+	fputc('"', out);
+}
+
+void write_chrome_trace(profiler* prof, FILE* out) {
+	vector<string> tracks;
+	bool first;
+
+	lock_guard<mutex> guard(prof->lock);
+
+	//
+	// Each track becomes a "thread" of one process. The metadata events
+	// give the threads their names.
+	//
+
+	for (const profile_event& event : prof->events) {
+		if (find(tracks.begin(), tracks.end(), event.track) == tracks.end()) {
+			tracks.push_back(event.track);
+		}
+	}
+
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", out);
+	first = true;
+
+	for (size_t t = 0; t < tracks.size(); t++) {
+		fprintf(out, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"name\":\"thread_name\",\"args\":{\"name\":", first ? "" : ",\n", t + 1);
+		write_json_string(out, tracks[t]);
+		fputs("}}", out);
+		first = false;
+	}
+
+	for (const profile_event& event : prof->events) {
+		size_t tid;
+
+		tid = find(tracks.begin(), tracks.end(), event.track) - tracks.begin() + 1;
+
+		fprintf(out, "%s{\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"cat\":", first ? "" : ",\n", tid);
+		write_json_string(out, event.track);
+		fputs(",\"name\":", out);
+		write_json_string(out, event.name);
+		fprintf(out, ",\"ts\":%.3f,\"dur\":%.3f}", event.start_us, event.duration_us);
+		first = false;
+	}
+
+	fputs("\n]}\n", out);
+}
+
+bool write_chrome_trace_file(profiler* prof, const string& path) {
+	FILE* out;
+
+#if defined(_MSC_VER)
+	if (fopen_s(&out, path.c_str(), "w") != 0) {
+		return false;
+	}
+#else
+	out = fopen(path.c_str(), "w");
+#endif
+
+	if (out == NULL) {
+		return false;
+	}
+
+	write_chrome_trace(prof, out);
+	fclose(out);
+
+	return true;
+}
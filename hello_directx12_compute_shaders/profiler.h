@@ -0,0 +1,108 @@
+// Liam Wynn, 12/27/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The profiler collects timed events on named tracks (one per CPU
+	thread or GPU queue) and writes them out two ways:
+
+	- A Chrome trace_event JSON file. Load it in chrome://tracing or
+	  ui.perfetto.dev to see the CPU and GPU timelines side by side.
+	- A text summary with count, mean, p50, p99 and max per phase.
+
+	CPU phases are timed with profile_scope. GPU phases are timed with
+	timestamp queries by gpu_profiler, which converts them to the same
+	clock and hands them over with record_profile_event.
+
+	Nothing here needs a device. A NULL profiler turns every call into
+	a no-op, so call sites don't have to check.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct profile_event {
+	std::string name;
+	std::string track;
+
+	// Microseconds since the profiler started.
+	double start_us;
+	double duration_us;
+};
+
+struct profiler {
+	std::chrono::steady_clock::time_point epoch;
+
+	// Its events go on the "cpu" track.
+	std::thread::id main_thread;
+
+	std::mutex lock;
+	std::vector<profile_event> events;
+};
+
+struct profile_phase_summary {
+	std::string track;
+	std::string name;
+	size_t count;
+	double total_us;
+	double mean_us;
+	double p50_us;
+	double p99_us;
+	double max_us;
+};
+
+void initialize_profiler(profiler* prof);
+
+// Microseconds since the profiler started.
+double profiler_now_us(const profiler* prof);
+
+// Converts a steady_clock time to the profiler's clock.
+double profiler_time_us(
+	const profiler* prof,
+	const std::chrono::steady_clock::time_point time
+);
+
+void record_profile_event(
+	profiler* prof,
+	const std::string& track,
+	const std::string& name,
+	const double start_us,
+	const double duration_us
+);
+
+/*
+	The calling thread's track: "cpu" for the thread that initialized
+	prof, "cpu: <name>" for a thread named with set_profile_thread_name,
+	and "cpu <n>" for any other, numbered in the order they first ask.
+*/
+std::string profile_thread_track(const profiler* prof);
+
+// Names the calling thread's track from here on.
+void set_profile_thread_name(const std::string& name);
+
+/*
+	Times the enclosing scope on the calling thread's track.
+*/
+struct profile_scope {
+	profiler* prof;
+	const char* name;
+	double start_us;
+
+	profile_scope(profiler* prof, const char* name);
+	~profile_scope();
+};
+
+/*
+	Nearest rank percentile (0 to 100) of values. Sorts values.
+*/
+double percentile(std::vector<double>* values, const double p);
+
+std::vector<profile_phase_summary> summarize_profile(profiler* prof);
+void print_profile_summary(profiler* prof, FILE* out);
+
+void write_chrome_trace(profiler* prof, FILE* out);
+bool write_chrome_trace_file(profiler* prof, const std::string& path);
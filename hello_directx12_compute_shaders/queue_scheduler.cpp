@@ -0,0 +1,205 @@
+// Liam Wynn, 12/16/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "queue_scheduler.h"
+#include <algorithm>
+#include <map>
+#include <utility>
+
+using namespace std;
+
+void initialize_queue_scheduler(queue_scheduler* scheduler) {
+	for (int a = 0; a < QUEUE_KIND_COUNT; a++) {
+		scheduler->signaled[a] = 0;
+
+		for (int b = 0; b < QUEUE_KIND_COUNT; b++) {
+			scheduler->waited[a][b] = 0;
+		}
+	}
+}
+
+unsigned int resolve_queue_waits(
+	queue_scheduler* scheduler,
+	const queue_kind queue,
+	const queue_ticket* deps,
+	const unsigned int num_deps,
+	queue_ticket* waits_out
+) {
+	uint64_t needed[QUEUE_KIND_COUNT];
+	unsigned int num_waits;
+
+	for (int q = 0; q < QUEUE_KIND_COUNT; q++) {
+		needed[q] = 0;
+	}
+
+	//
+	// Keep only the newest value needed from each other queue.
+	//
+
+	for (unsigned int i = 0; i < num_deps; i++) {
+		if (deps[i].queue == queue) {
+			continue;
+		}
+
+		needed[deps[i].queue] = max(needed[deps[i].queue], deps[i].value);
+	}
+
+	num_waits = 0;
+
+	for (int q = 0; q < QUEUE_KIND_COUNT; q++) {
+		if (needed[q] == 0 || needed[q] <= scheduler->waited[queue][q]) {
+			continue;
+		}
+
+		waits_out[num_waits].queue = (queue_kind)q;
+		waits_out[num_waits].value = needed[q];
+		num_waits++;
+
+		scheduler->waited[queue][q] = needed[q];
+	}
+
+	return num_waits;
+}
+
+queue_ticket record_queue_signal(
+	queue_scheduler* scheduler,
+	const queue_kind queue,
+	const uint64_t value
+) {
+	queue_ticket ticket;
+
+	scheduler->signaled[queue] = value;
+
+	ticket.queue = queue;
+	ticket.value = value;
+
+	return ticket;
+}
+
+const char* queue_kind_name(const queue_kind queue) {
+	switch (queue) {
+	case QUEUE_DIRECT:
+		return "direct";
+	case QUEUE_COMPUTE:
+		return "compute";
+	case QUEUE_COPY:
+		return "copy";
+	default:
+		return "unknown";
+	}
+}
+
+/* SIMULATED QUEUES */
+
+double simulate_queues(vector<simulated_submission>* submissions) {
+	vector<size_t> pending[QUEUE_KIND_COUNT];
+	size_t next[QUEUE_KIND_COUNT];
+	double queue_time[QUEUE_KIND_COUNT];
+	map<pair<int, uint64_t>, double> signal_times;
+	size_t remaining;
+	double end_time;
+	bool progressed;
+
+	for (int q = 0; q < QUEUE_KIND_COUNT; q++) {
+		next[q] = 0;
+		queue_time[q] = 0.0;
+	}
+
+	for (size_t i = 0; i < submissions->size(); i++) {
+		pending[(*submissions)[i].queue].push_back(i);
+	}
+
+	remaining = submissions->size();
+	end_time = 0.0;
+
+	//
+	// Keep starting whichever queue's next submission has all of its
+	// waits satisfied. If no queue can move, the waits form a cycle.
+	//
+
+	while (remaining > 0) {
+		progressed = false;
+
+		for (int q = 0; q < QUEUE_KIND_COUNT; q++) {
+			simulated_submission* sub;
+			double start;
+			bool ready;
+
+			if (next[q] == pending[q].size()) {
+				continue;
+			}
+
+			sub = &(*submissions)[pending[q][next[q]]];
+			start = queue_time[q];
+			ready = true;
+
+			for (const queue_ticket& wait : sub->waits) {
+				auto it = signal_times.lower_bound(make_pair((int)wait.queue, wait.value));
+
+				if (it == signal_times.end() || it->first.first != (int)wait.queue) {
+					ready = false;
+					break;
+				}
+
+				start = max(start, it->second);
+			}
+
+			if (!ready) {
+				continue;
+			}
+
+			sub->start = start;
+			sub->finish = start + sub->duration;
+			queue_time[q] = sub->finish;
+			signal_times[make_pair(q, sub->signal_value)] = sub->finish;
+			end_time = max(end_time, sub->finish);
+
+			next[q]++;
+			remaining--;
+			progressed = true;
+		}
+
+		if (!progressed) {
+			return -1.0;
+		}
+	}
+
+	return end_time;
+}
+
+double simulated_overlap(const vector<simulated_submission>* submissions) {
+	vector<pair<double, int>> events;
+	double overlap;
+	double last_time;
+	int busy;
+
+	//
+	// Sweep over start (+1) and finish (-1) events and add up the time
+	// where more than one queue was busy.
+	//
+
+	for (const simulated_submission& sub : *submissions) {
+		if (sub.duration <= 0.0) {
+			continue;
+		}
+
+		events.push_back(make_pair(sub.start, 1));
+		events.push_back(make_pair(sub.finish, -1));
+	}
+
+	sort(events.begin(), events.end());
+
+	overlap = 0.0;
+	last_time = 0.0;
+	busy = 0;
+
+	for (const pair<double, int>& e : events) {
+		if (busy > 1) {
+			overlap += e.first - last_time;
+		}
+
+		busy += e.second;
+		last_time = e.first;
+	}
+
+	return overlap;
+}
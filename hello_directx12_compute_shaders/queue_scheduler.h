@@ -0,0 +1,98 @@
+// Liam Wynn, 12/16/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	With separate DIRECT, COMPUTE and COPY queues, work on one queue
+	often depends on work on another. For example the readback copy of
+	batch k (copy queue) needs the dispatch of batch k (compute queue)
+	to finish first. On the GPU that becomes an ID3D12CommandQueue::Wait
+	on the other queue's fence.
+
+	Every queue has its own fence, so a point on a queue's timeline is
+	just (queue, fence value). That's a queue_ticket. The scheduler takes
+	the tickets a submission depends on and works out the smallest set
+	of cross-queue waits to insert in front of it:
+
+	- Work on the same queue already runs in order, so no wait.
+	- At most one wait per other queue, on the newest value needed.
+	- A wait a queue already did (on that value or a later one) covers
+	  any earlier value.
+
+	Nothing here touches DirectX. The simulated queues at the bottom run
+	the resulting plan against per-submission durations, which is how
+	the scheduling gets checked without a GPU.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum queue_kind {
+	QUEUE_DIRECT,
+	QUEUE_COMPUTE,
+	QUEUE_COPY,
+	QUEUE_KIND_COUNT
+};
+
+struct queue_ticket {
+	queue_kind queue;
+	uint64_t value;
+};
+
+struct queue_scheduler {
+	// waited[a][b] is the newest value of queue b that queue a has
+	// waited on (or is otherwise known to be behind).
+	uint64_t waited[QUEUE_KIND_COUNT][QUEUE_KIND_COUNT];
+
+	// Newest value signaled on each queue.
+	uint64_t signaled[QUEUE_KIND_COUNT];
+};
+
+void initialize_queue_scheduler(queue_scheduler* scheduler);
+
+/*
+	Works out which waits queue must do before running work that
+	depends on deps. Writes at most QUEUE_KIND_COUNT - 1 waits into
+	waits_out and returns how many. The waits are recorded as done.
+*/
+unsigned int resolve_queue_waits(
+	queue_scheduler* scheduler,
+	const queue_kind queue,
+	const queue_ticket* deps,
+	const unsigned int num_deps,
+	queue_ticket* waits_out
+);
+
+queue_ticket record_queue_signal(
+	queue_scheduler* scheduler,
+	const queue_kind queue,
+	const uint64_t value
+);
+
+const char* queue_kind_name(const queue_kind queue);
+
+/* SIMULATED QUEUES */
+
+struct simulated_submission {
+	queue_kind queue;
+	std::vector<queue_ticket> waits;
+	uint64_t signal_value;
+	double duration;
+
+	// Filled in by simulate_queues.
+	double start;
+	double finish;
+};
+
+/*
+	Runs the submissions as the GPU would: each queue executes its own
+	submissions in order, and a submission starts once its queue is idle
+	and every wait has been signaled. Returns the time the last one
+	finishes, or a negative value if the waits deadlock.
+*/
+double simulate_queues(std::vector<simulated_submission>* submissions);
+
+/*
+	Total time two or more queues were busy at once.
+*/
+double simulated_overlap(const std::vector<simulated_submission>* submissions);
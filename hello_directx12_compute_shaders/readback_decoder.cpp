@@ -0,0 +1,480 @@
+// Liam Wynn, 01/06/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "readback_decoder.h"
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define READBACK_DECODER_X86
+#include <immintrin.h>
+#endif
+
+// Like the CPU executor: GCC and Clang need to be told which functions
+// may use AVX2 and F16C.
+#if defined(READBACK_DECODER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define DECODER_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#else
+#define DECODER_TARGET_AVX2
+#endif
+
+using namespace std;
+
+/* SCALAR DECODERS */
+
+static void decode_float4_row(const unsigned char* src, float* dst, const unsigned int count) {
+	memcpy(dst, src, (size_t)count * CPU_FLOAT4_SIZE);
+}
+
+static void decode_half4_row_scalar(const unsigned char* src, float* dst, const unsigned int count) {
+	uint16_t half;
+
+	for (unsigned int i = 0; i < count * 4; i++) {
+		memcpy(&half, src + i * 2, sizeof(half));
+		dst[i] = half_to_float(half);
+	}
+}
+
+static void decode_unorm8_row_scalar(const unsigned char* src, float* dst, const unsigned int count) {
+	for (unsigned int i = 0; i < count * 4; i++) {
+		dst[i] = (float)src[i] / 255.0f;
+	}
+}
+
+static void decode_r32_row_scalar(const unsigned char* src, float* dst, const unsigned int count) {
+	for (unsigned int i = 0; i < count; i++) {
+		memcpy(dst, src + i * 4, sizeof(float));
+		dst[1] = 0.0f;
+		dst[2] = 0.0f;
+		dst[3] = 1.0f;
+		dst += 4;
+	}
+}
+
+static void decode_r11g11b10_row_scalar(const unsigned char* src, float* dst, const unsigned int count) {
+	uint32_t packed;
+
+	for (unsigned int i = 0; i < count; i++) {
+		memcpy(&packed, src + i * 4, sizeof(packed));
+		dst[0] = float11_to_float(packed);
+		dst[1] = float11_to_float(packed >> 11);
+		dst[2] = float10_to_float(packed >> 22);
+		dst[3] = 1.0f;
+		dst += 4;
+	}
+}
+
+/* SIMD DECODERS */
+
+/*
+	Each of these does as many texels as its vectors allow and hands
+	the tail to the scalar decoder.
+*/
+
+#if defined(READBACK_DECODER_X86)
+DECODER_TARGET_AVX2
+static void decode_half4_row_f16c(const unsigned char* src, float* dst, const unsigned int count) {
+	unsigned int i;
+
+	// Eight halves, two texels, per conversion.
+	for (i = 0; i + 2 <= count; i += 2) {
+		__m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 8));
+		_mm256_storeu_ps(dst + i * 4, _mm256_cvtph_ps(halves));
+	}
+
+	decode_half4_row_scalar(src + i * 8, dst + i * 4, count - i);
+}
+
+DECODER_TARGET_AVX2
+static void decode_unorm8_row_avx2(const unsigned char* src, float* dst, const unsigned int count) {
+	__m256 divisor;
+	unsigned int i;
+
+	//
+	// A divide rather than a multiply by 1/255, so every value is the
+	// same as the scalar one.
+	//
+
+	divisor = _mm256_set1_ps(255.0f);
+
+	for (i = 0; i + 2 <= count; i += 2) {
+		__m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i * 4));
+		__m256 values = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+		_mm256_storeu_ps(dst + i * 4, _mm256_div_ps(values, divisor));
+	}
+
+	decode_unorm8_row_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+static void decode_r32_row_sse(const unsigned char* src, float* dst, const unsigned int count) {
+	__m128 zero;
+	__m128 zero_one;
+	unsigned int i;
+
+	zero = _mm_setzero_ps();
+	zero_one = _mm_setr_ps(0.0f, 1.0f, 0.0f, 1.0f);
+
+	for (i = 0; i + 4 <= count; i += 4) {
+		__m128 r = _mm_loadu_ps(reinterpret_cast<const float*>(src + i * 4));
+
+		// (r0, 0, r1, 0) and (r2, 0, r3, 0).
+		__m128 lo = _mm_unpacklo_ps(r, zero);
+		__m128 hi = _mm_unpackhi_ps(r, zero);
+
+		_mm_storeu_ps(dst + i * 4, _mm_movelh_ps(lo, zero_one));
+		_mm_storeu_ps(dst + i * 4 + 4, _mm_shuffle_ps(lo, zero_one, _MM_SHUFFLE(1, 0, 3, 2)));
+		_mm_storeu_ps(dst + i * 4 + 8, _mm_movelh_ps(hi, zero_one));
+		_mm_storeu_ps(dst + i * 4 + 12, _mm_shuffle_ps(hi, zero_one, _MM_SHUFFLE(1, 0, 3, 2)));
+	}
+
+	decode_r32_row_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+DECODER_TARGET_AVX2
+static void decode_r11g11b10_row_avx2(const unsigned char* src, float* dst, const unsigned int count) {
+	__m256i spread;
+	__m256i shift_down;
+	__m256i channel_mask;
+	__m256i shift_up;
+	__m256i exponent_max;
+	__m256i infinity;
+	__m256i quiet;
+	__m256i mantissa_mask;
+	__m256 rebias;
+	__m256 ones;
+	unsigned int i;
+
+	//
+	// Two texels per vector, one channel per lane. Each channel is
+	// shifted down to bit 0 and then up so its exponent lands in the
+	// low bits of a float's exponent and its mantissa at the top of a
+	// float's mantissa. As a float that is the value times 2^-112, so
+	// one exact multiply fixes it, subnormals included. An exponent of
+	// 31 is infinity or NaN and is built by hand.
+	//
+
+	spread = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+	shift_down = _mm256_setr_epi32(0, 11, 22, 0, 0, 11, 22, 0);
+	channel_mask = _mm256_setr_epi32(0x7FF, 0x7FF, 0x3FF, 0, 0x7FF, 0x7FF, 0x3FF, 0);
+	shift_up = _mm256_setr_epi32(17, 17, 18, 0, 17, 17, 18, 0);
+	exponent_max = _mm256_set1_epi32(0x1F << 23);
+	infinity = _mm256_set1_epi32(0x7F800000);
+	quiet = _mm256_set1_epi32(0x400000);
+	mantissa_mask = _mm256_set1_epi32(0x7FFFFF);
+	rebias = _mm256_set1_ps(5.192296858534828e33f); // 2^112
+	ones = _mm256_set1_ps(1.0f);
+
+	for (i = 0; i + 2 <= count; i += 2) {
+		__m256i texels = _mm256_castsi128_si256(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i * 4)));
+		__m256i channels = _mm256_permutevar8x32_epi32(texels, spread);
+		__m256i bits = _mm256_sllv_epi32(
+			_mm256_and_si256(_mm256_srlv_epi32(channels, shift_down), channel_mask),
+			shift_up
+		);
+
+		__m256 finite = _mm256_mul_ps(_mm256_castsi256_ps(bits), rebias);
+
+		__m256i mantissa = _mm256_and_si256(bits, mantissa_mask);
+		__m256i has_mantissa = _mm256_xor_si256(
+			_mm256_cmpeq_epi32(mantissa, _mm256_setzero_si256()),
+			_mm256_set1_epi32(-1)
+		);
+		__m256i special = _mm256_or_si256(
+			_mm256_or_si256(infinity, mantissa),
+			_mm256_and_si256(has_mantissa, quiet)
+		);
+		__m256i is_special = _mm256_cmpeq_epi32(_mm256_and_si256(bits, exponent_max), exponent_max);
+
+		__m256 values = _mm256_blendv_ps(finite, _mm256_castsi256_ps(special), _mm256_castsi256_ps(is_special));
+
+		// Alpha is lanes 3 and 7.
+		_mm256_storeu_ps(dst + i * 4, _mm256_blend_ps(values, ones, 0x88));
+	}
+
+	decode_r11g11b10_row_scalar(src + i * 4, dst + i * 4, count - i);
+}
+#endif
+
+/* DECODER TABLE */
+
+#if defined(READBACK_DECODER_X86)
+static const readback_decoder decoders[CPU_TEXEL_FORMAT_COUNT] = {
+	{ CPU_TEXEL_R32G32B32A32_FLOAT, decode_float4_row, NULL, CPU_SIMD_SCALAR },
+	{ CPU_TEXEL_R16G16B16A16_FLOAT, decode_half4_row_scalar, decode_half4_row_f16c, CPU_SIMD_AVX2 },
+	{ CPU_TEXEL_R8G8B8A8_UNORM, decode_unorm8_row_scalar, decode_unorm8_row_avx2, CPU_SIMD_AVX2 },
+	{ CPU_TEXEL_R32_FLOAT, decode_r32_row_scalar, decode_r32_row_sse, CPU_SIMD_SSE },
+	{ CPU_TEXEL_R11G11B10_FLOAT, decode_r11g11b10_row_scalar, decode_r11g11b10_row_avx2, CPU_SIMD_AVX2 }
+};
+#else
+static const readback_decoder decoders[CPU_TEXEL_FORMAT_COUNT] = {
+	{ CPU_TEXEL_R32G32B32A32_FLOAT, decode_float4_row, NULL, CPU_SIMD_SCALAR },
+	{ CPU_TEXEL_R16G16B16A16_FLOAT, decode_half4_row_scalar, NULL, CPU_SIMD_SCALAR },
+	{ CPU_TEXEL_R8G8B8A8_UNORM, decode_unorm8_row_scalar, NULL, CPU_SIMD_SCALAR },
+	{ CPU_TEXEL_R32_FLOAT, decode_r32_row_scalar, NULL, CPU_SIMD_SCALAR },
+	{ CPU_TEXEL_R11G11B10_FLOAT, decode_r11g11b10_row_scalar, NULL, CPU_SIMD_SCALAR }
+};
+#endif
+
+const readback_decoder* get_readback_decoder(const cpu_texel_format format) {
+	if ((int)format < 0 || format >= CPU_TEXEL_FORMAT_COUNT) {
+		return NULL;
+	}
+
+	return &decoders[format];
+}
+
+decode_row_function select_decode_row(
+	const readback_decoder* decoder,
+	const cpu_simd_level level
+) {
+	if (decoder->simd != NULL && level >= decoder->simd_level) {
+		return decoder->simd;
+	}
+
+	return decoder->scalar;
+}
+
+void decode_texel_rows(
+	const texel_rows* rows,
+	float* dst,
+	const cpu_simd_level level
+) {
+	decode_row_function decode_row;
+
+	decode_row = select_decode_row(get_readback_decoder(rows->format), level);
+
+	for (unsigned int y = 0; y < rows->height; y++) {
+		decode_row(
+			rows->data + (size_t)y * rows->row_pitch,
+			dst + (size_t)y * rows->width * 4,
+			rows->width
+		);
+	}
+}
+
+void pack_texel_rows(const texel_rows* rows, unsigned char* dst) {
+	size_t row_size;
+
+	row_size = (size_t)rows->width * cpu_texel_size(rows->format);
+
+	for (unsigned int y = 0; y < rows->height; y++) {
+		memcpy(dst + y * row_size, rows->data + (size_t)y * rows->row_pitch, row_size);
+	}
+}
+
+/* VERIFICATION */
+
+/*
+	Texels that between them hold every value of every channel, and
+	then some random bit patterns.
+*/
+static vector<unsigned char> exhaustive_texels(const cpu_texel_format format, unsigned int* count) {
+	vector<unsigned char> texels;
+	uint32_t random;
+	uint32_t word;
+	uint16_t half;
+
+	random = 0x12345678;
+
+	auto next_random = [&]() {
+		random ^= random << 13;
+		random ^= random >> 17;
+		random ^= random << 5;
+		return random;
+	};
+
+	switch (format) {
+	case CPU_TEXEL_R16G16B16A16_FLOAT:
+		// Every half, four to a texel.
+		for (uint32_t h = 0; h < 0x10000; h++) {
+			half = (uint16_t)h;
+			texels.insert(texels.end(), (unsigned char*)&half, (unsigned char*)&half + 2);
+		}
+		break;
+	case CPU_TEXEL_R8G8B8A8_UNORM:
+		for (uint32_t b = 0; b < 0x100; b++) {
+			texels.push_back((unsigned char)b);
+		}
+		break;
+	case CPU_TEXEL_R11G11B10_FLOAT:
+		// Every 11 bit red and green, every 10 bit blue.
+		for (uint32_t v = 0; v < 0x800; v++) {
+			word = v | (((v * 7) & 0x7FF) << 11) | ((v & 0x3FF) << 22);
+			texels.insert(texels.end(), (unsigned char*)&word, (unsigned char*)&word + 4);
+		}
+		break;
+	default:
+		break;
+	}
+
+	for (unsigned int i = 0; i < 4096; i++) {
+		word = next_random();
+		texels.insert(texels.end(), (unsigned char*)&word, (unsigned char*)&word + 4);
+	}
+
+	// Whole texels only.
+	texels.resize(texels.size() / cpu_texel_size(format) * cpu_texel_size(format));
+	*count = (unsigned int)(texels.size() / cpu_texel_size(format));
+
+	return texels;
+}
+
+bool verify_readback_decoders(const cpu_simd_level level, FILE* out) {
+	const readback_decoder* decoder;
+	decode_row_function simd;
+	vector<unsigned char> texels;
+	vector<float> expected;
+	vector<float> actual;
+	unsigned int count;
+	unsigned int texel_size;
+	unsigned int mismatches;
+	bool exact;
+
+	exact = true;
+
+	for (int f = 0; f < CPU_TEXEL_FORMAT_COUNT; f++) {
+		decoder = get_readback_decoder((cpu_texel_format)f);
+		simd = select_decode_row(decoder, level);
+
+		if (simd == decoder->scalar) {
+			continue;
+		}
+
+		texels = exhaustive_texels(decoder->format, &count);
+		texel_size = cpu_texel_size(decoder->format);
+
+		expected.assign((size_t)count * 4, 0.0f);
+		decoder->scalar(texels.data(), expected.data(), count);
+
+		//
+		// Also every short run from every start, so the tails and
+		// unaligned loads get checked.
+		//
+
+		mismatches = 0;
+
+		for (unsigned int start = 0; start < 8 && start < count; start++) {
+			for (unsigned int length = 0; start + length <= count && length < 40; length++) {
+				actual.assign((size_t)length * 4, 0.0f);
+				simd(texels.data() + start * texel_size, actual.data(), length);
+
+				if (length > 0 && memcmp(actual.data(), expected.data() + start * 4, (size_t)length * CPU_FLOAT4_SIZE) != 0) {
+					mismatches++;
+				}
+			}
+		}
+
+		actual.assign((size_t)count * 4, 0.0f);
+		simd(texels.data(), actual.data(), count);
+
+		for (unsigned int i = 0; i < count * 4; i++) {
+			if (memcmp(&actual[i], &expected[i], sizeof(float)) != 0) {
+				mismatches++;
+			}
+		}
+
+		if (mismatches > 0) {
+			exact = false;
+
+			if (out != NULL) {
+				fprintf(out, "%s: %u SIMD values differ from the scalar decoder\n", cpu_texel_format_name(decoder->format), mismatches);
+			}
+		}
+	}
+
+	return exact;
+}
+
+/* BENCHMARK */
+
+void benchmark_readback_decoders(FILE* out) {
+	const unsigned int size = 2000;
+	const int runs = 5;
+	cpu_executor executor;
+	cpu_footprint footprint;
+	vector<unsigned char> readback;
+	vector<float> decoded;
+	vector<unsigned char> packed;
+	cpu_texture target;
+	cpu_dispatch_desc dispatch;
+	texel_rows rows;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+	double best[3];
+	const readback_decoder* decoder;
+	decode_row_function simd;
+
+	initialize_cpu_executor(&executor, 0);
+
+	fprintf(out, "Readback decoders, %ux%u, %s\n", size, size, cpu_simd_level_name(executor.simd_level));
+	fprintf(out, "%-20s %10s %12s %12s %12s %14s\n", "format", "MB read", "scalar GB/s", "SIMD GB/s", "native GB/s", "SIMD Mpixel/s");
+
+	decoded.resize((size_t)size * size * 4);
+
+	for (int f = 0; f < CPU_TEXEL_FORMAT_COUNT; f++) {
+		decoder = get_readback_decoder((cpu_texel_format)f);
+		simd = select_decode_row(decoder, executor.simd_level);
+
+		//
+		// 2000 texels is never a multiple of 256 bytes, so the rows
+		// are padded like a real readback.
+		//
+
+		footprint = cpu_readback_footprint(size, size, cpu_texel_size(decoder->format));
+		readback.assign((size_t)footprint.total_size, 0);
+		packed.resize((size_t)size * size * cpu_texel_size(decoder->format));
+
+		target.data = readback.data();
+		target.width = size;
+		target.height = size;
+		target.row_pitch = footprint.row_pitch;
+		target.format = decoder->format;
+
+		dispatch = cpu_hello_compute_dispatch(size, size);
+		cpu_dispatch_hello_compute(&executor, &target, &dispatch);
+
+		rows.data = readback.data();
+		rows.width = size;
+		rows.height = size;
+		rows.row_pitch = footprint.row_pitch;
+		rows.format = decoder->format;
+
+		//
+		// Best of a few runs each: scalar, SIMD (or scalar again if
+		// there is none) and native.
+		//
+
+		for (int k = 0; k < 3; k++) {
+			best[k] = 1.0e9;
+
+			for (int r = 0; r < runs; r++) {
+				start = chrono::steady_clock::now();
+
+				if (k == 2) {
+					pack_texel_rows(&rows, packed.data());
+				}
+				else {
+					decode_texel_rows(&rows, decoded.data(), k == 0 ? CPU_SIMD_SCALAR : executor.simd_level);
+				}
+
+				elapsed = chrono::steady_clock::now() - start;
+
+				if (elapsed.count() < best[k]) {
+					best[k] = elapsed.count();
+				}
+			}
+		}
+
+		fprintf(
+			out,
+			"%-20s %10.1f %12.2f %12.2f %12.2f %14.1f%s\n",
+			cpu_texel_format_name(decoder->format),
+			packed.size() / 1.0e6,
+			packed.size() / best[0] / 1.0e9,
+			packed.size() / best[1] / 1.0e9,
+			packed.size() / best[2] / 1.0e9,
+			(double)size * size / best[1] / 1.0e6,
+			simd == decoder->scalar ? " (no SIMD path)" : ""
+		);
+	}
+}
@@ -0,0 +1,97 @@
+// Liam Wynn, 01/06/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	Readback decoders turn readback rows in any of the cpu_texel_formats
+	into float4s, so the kernel can run at a narrower format and still
+	be printed or summarized as float4 data. R16G16B16A16_FLOAT and
+	R8G8B8A8_UNORM halve and quarter the bytes the copy moves, and
+	R32_FLOAT and R11G11B10_FLOAT quarter them.
+
+	Every format has a scalar decoder, which is the reference. Formats
+	with a SIMD decoder use it when the CPU allows:
+
+	R32G32B32A32_FLOAT  A copy. Nothing to decode.
+	R16G16B16A16_FLOAT  F16C, two texels per conversion (AVX2 level).
+	R8G8B8A8_UNORM      AVX2 widening and an IEEE divide by 255.
+	R32_FLOAT           SSE shuffles into (r, 0, 0, 1).
+	R11G11B10_FLOAT     AVX2 shifts and a power of two multiply.
+
+	The missing channels of R32_FLOAT and R11G11B10_FLOAT decode to 0
+	for green and blue and 1 for alpha, the way the GPU reads them.
+	Every SIMD decoder gives the same bits as its scalar one, NaNs
+	included (they come back quiet), which verify_readback_decoders
+	checks over every half, every 8 bit value and every 11 and 10 bit
+	float.
+
+	pack_texel_rows is the native output: the rows without their
+	padding, still in the texel format.
+
+	Nothing here depends on Windows.
+*/
+
+#pragma once
+
+#include "cpu_executor.h"
+#include <cstdio>
+
+/*
+	Rows of one texel format, laid out like a readback footprint.
+*/
+struct texel_rows {
+	const unsigned char* data;
+	unsigned int width;
+	unsigned int height;
+	unsigned int row_pitch;
+	cpu_texel_format format;
+};
+
+// Decodes count texels at src into count float4s at dst.
+typedef void (*decode_row_function)(
+	const unsigned char* src,
+	float* dst,
+	const unsigned int count
+);
+
+struct readback_decoder {
+	cpu_texel_format format;
+
+	// The reference.
+	decode_row_function scalar;
+
+	// NULL if there is none. Needs a CPU of at least simd_level.
+	decode_row_function simd;
+	cpu_simd_level simd_level;
+};
+
+const readback_decoder* get_readback_decoder(const cpu_texel_format format);
+
+// The fastest row decoder level allows.
+decode_row_function select_decode_row(
+	const readback_decoder* decoder,
+	const cpu_simd_level level
+);
+
+/*
+	Decodes rows into width * height packed float4s at dst.
+*/
+void decode_texel_rows(
+	const texel_rows* rows,
+	float* dst,
+	const cpu_simd_level level
+);
+
+// Copies rows to dst with the row padding taken out.
+void pack_texel_rows(const texel_rows* rows, unsigned char* dst);
+
+/*
+	Runs every SIMD decoder level allows against its scalar decoder.
+	Mismatches are written to out, which may be NULL. Returns false if
+	there were any.
+*/
+bool verify_readback_decoders(const cpu_simd_level level, FILE* out);
+
+/*
+	Times scalar, SIMD and native output for
+	every format over a padded 2000x2000 readback.
+*/
+void benchmark_readback_decoders(FILE* out);
@@ -0,0 +1,191 @@
+// Liam Wynn, 01/04/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "readback_ring.h"
+
+using namespace std;
+
+void initialize_readback_ring(readback_ring* ring, const unsigned int num_slots) {
+	readback_slot slot;
+
+	slot.state = READBACK_SLOT_FREE;
+	slot.timeline = NULL;
+	slot.fence_value = 0;
+	slot.sequence = 0;
+
+	ring->slots.assign(num_slots == 0 ? 1 : num_slots, slot);
+	ring->next = 0;
+	ring->next_sequence = 0;
+	ring->copies = 0;
+	ring->reads = 0;
+	ring->dropped = 0;
+	ring->blocking_waits = 0;
+}
+
+/*
+	The in flight slot with the lowest (or highest) sequence number.
+*/
+static unsigned int find_in_flight_slot(const readback_ring* ring, const bool newest) {
+	unsigned int found;
+
+	found = INVALID_READBACK_SLOT;
+
+	for (unsigned int i = 0; i < ring->slots.size(); i++) {
+		const readback_slot* slot = &ring->slots[i];
+
+		if (slot->state != READBACK_SLOT_IN_FLIGHT) {
+			continue;
+		}
+
+		if (found == INVALID_READBACK_SLOT
+			|| (newest && slot->sequence > ring->slots[found].sequence)
+			|| (!newest && slot->sequence < ring->slots[found].sequence)) {
+			found = i;
+		}
+	}
+
+	return found;
+}
+
+unsigned int acquire_readback_slot(readback_ring* ring) {
+	unsigned int num_slots;
+	unsigned int index;
+
+	num_slots = (unsigned int)ring->slots.size();
+
+	//
+	// Go round from where the last copy went, so the slots take turns.
+	//
+
+	for (unsigned int i = 0; i < num_slots; i++) {
+		index = (ring->next + i) % num_slots;
+
+		if (ring->slots[index].state == READBACK_SLOT_FREE) {
+			ring->slots[index].state = READBACK_SLOT_RECORDING;
+			ring->next = (index + 1) % num_slots;
+			return index;
+		}
+	}
+
+	//
+	// No free slot. Reuse the oldest one nobody has read.
+	//
+
+	index = find_in_flight_slot(ring, false);
+
+	if (index == INVALID_READBACK_SLOT) {
+		return INVALID_READBACK_SLOT;
+	}
+
+	ring->dropped++;
+	ring->slots[index].state = READBACK_SLOT_RECORDING;
+	ring->next = (index + 1) % num_slots;
+
+	return index;
+}
+
+void commit_readback_slot(
+	readback_ring* ring,
+	const unsigned int slot,
+	fence_timeline* timeline,
+	const uint64_t fence_value
+) {
+	readback_slot* s;
+
+	s = &ring->slots[slot];
+	s->state = READBACK_SLOT_IN_FLIGHT;
+	s->timeline = timeline;
+	s->fence_value = fence_value;
+	s->sequence = ring->next_sequence++;
+
+	ring->copies++;
+}
+
+/*
+	Waits for slot's copy if it isn't done, and hands it to the CPU.
+*/
+static unsigned int read_slot(readback_ring* ring, const unsigned int index) {
+	readback_slot* slot;
+
+	slot = &ring->slots[index];
+
+	if (slot->timeline->completed_value() < slot->fence_value) {
+		ring->blocking_waits++;
+		slot->timeline->wait_for(slot->fence_value);
+	}
+
+	slot->state = READBACK_SLOT_READING;
+	ring->reads++;
+
+	return index;
+}
+
+unsigned int try_begin_readback(readback_ring* ring) {
+	unsigned int index;
+	readback_slot* slot;
+
+	index = find_in_flight_slot(ring, false);
+
+	if (index == INVALID_READBACK_SLOT) {
+		return INVALID_READBACK_SLOT;
+	}
+
+	slot = &ring->slots[index];
+
+	if (slot->timeline->completed_value() < slot->fence_value) {
+		return INVALID_READBACK_SLOT;
+	}
+
+	return read_slot(ring, index);
+}
+
+unsigned int begin_readback(readback_ring* ring) {
+	unsigned int index;
+
+	index = find_in_flight_slot(ring, false);
+
+	if (index == INVALID_READBACK_SLOT) {
+		return INVALID_READBACK_SLOT;
+	}
+
+	return read_slot(ring, index);
+}
+
+unsigned int begin_latest_readback(readback_ring* ring) {
+	unsigned int index;
+
+	index = find_in_flight_slot(ring, true);
+
+	if (index == INVALID_READBACK_SLOT) {
+		return INVALID_READBACK_SLOT;
+	}
+
+	//
+	// Everything older is stale. The copies may still be running, but
+	// the next copy into any of those slots is ordered after them.
+	//
+
+	for (unsigned int i = 0; i < ring->slots.size(); i++) {
+		if (i != index && ring->slots[i].state == READBACK_SLOT_IN_FLIGHT) {
+			ring->slots[i].state = READBACK_SLOT_FREE;
+			ring->dropped++;
+		}
+	}
+
+	return read_slot(ring, index);
+}
+
+void end_readback(readback_ring* ring, const unsigned int slot) {
+	ring->slots[slot].state = READBACK_SLOT_FREE;
+}
+
+unsigned int readback_slots_in_flight(const readback_ring* ring) {
+	unsigned int count;
+
+	count = 0;
+
+	for (const readback_slot& slot : ring->slots) {
+		count += slot.state == READBACK_SLOT_IN_FLIGHT ? 1 : 0;
+	}
+
+	return count;
+}
@@ -0,0 +1,101 @@
+// Liam Wynn, 01/04/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The readback ring decides which of a compute_buffer's readback slots
+	the next copy goes to, and when the CPU may look at one. The slots
+	themselves stay mapped for the life of the buffer; this only tracks
+	their state:
+
+	FREE       Nobody is using it.
+	RECORDING  A copy into it is being recorded.
+	IN_FLIGHT  The copy was submitted and is done once its queue
+	           reaches fence_value.
+	READING    The CPU has a view of it. Copies won't touch it until
+	           end_readback.
+
+	Slots are read in the order their copies were submitted, so the GPU
+	can fill slot k + 1 while the CPU works through slot k. If every
+	slot is in flight when another copy comes along, the oldest result
+	nobody read is dropped and its slot reused. Copies on one queue run
+	in order, so that never races the copy that was filling it.
+
+	Only fence values go through here, via the fence_timeline of the
+	queue that did the copy, so a mock_fence_timeline can drive it.
+*/
+
+#pragma once
+
+#include "frame_ring.h"
+#include <cstdint>
+#include <vector>
+
+const unsigned int INVALID_READBACK_SLOT = 0xFFFFFFFF;
+
+enum readback_slot_state {
+	READBACK_SLOT_FREE,
+	READBACK_SLOT_RECORDING,
+	READBACK_SLOT_IN_FLIGHT,
+	READBACK_SLOT_READING
+};
+
+struct readback_slot {
+	readback_slot_state state;
+
+	// The queue that copies into it, and the value it signals after.
+	fence_timeline* timeline;
+	uint64_t fence_value;
+
+	// Order of submission, so the oldest result is read first.
+	uint64_t sequence;
+};
+
+struct readback_ring {
+	std::vector<readback_slot> slots;
+	unsigned int next;
+	uint64_t next_sequence;
+
+	uint64_t copies;
+	uint64_t reads;
+	uint64_t dropped;
+	uint64_t blocking_waits;
+};
+
+void initialize_readback_ring(readback_ring* ring, const unsigned int num_slots);
+
+/*
+	Picks the slot for the next copy, preferring free ones. Returns
+	INVALID_READBACK_SLOT if the CPU is reading every slot, or a copy is
+	already being recorded into each of the others.
+*/
+unsigned int acquire_readback_slot(readback_ring* ring);
+
+// The copy into slot was submitted on timeline, ahead of fence_value.
+void commit_readback_slot(
+	readback_ring* ring,
+	const unsigned int slot,
+	fence_timeline* timeline,
+	const uint64_t fence_value
+);
+
+/*
+	The oldest slot in flight, if its copy is done. Doesn't block.
+	Returns INVALID_READBACK_SLOT otherwise.
+*/
+unsigned int try_begin_readback(readback_ring* ring);
+
+/*
+	The oldest slot in flight, waiting for its copy if need be. Returns
+	INVALID_READBACK_SLOT if nothing is in flight.
+*/
+unsigned int begin_readback(readback_ring* ring);
+
+/*
+	Like begin_readback, but for the newest slot. Older results are
+	dropped without waiting on them.
+*/
+unsigned int begin_latest_readback(readback_ring* ring);
+
+// The CPU is done with slot. It goes back to FREE.
+void end_readback(readback_ring* ring, const unsigned int slot);
+
+unsigned int readback_slots_in_flight(const readback_ring* ring);
@@ -0,0 +1,580 @@
+// Liam Wynn, 01/10/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "recording_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <random>
+#include <thread>
+
+using namespace std;
+
+vector<recording_chunk> plan_recording_chunks(
+	const unsigned int num_items,
+	const unsigned int num_threads,
+	const unsigned int min_items
+) {
+	vector<recording_chunk> chunks;
+	unsigned int num_chunks;
+	unsigned int base;
+	unsigned int extra;
+	unsigned int first;
+
+	if (num_items == 0) {
+		return chunks;
+	}
+
+	num_chunks = num_threads == 0 ? 1 : num_threads;
+
+	if (min_items > 1) {
+		num_chunks = min(num_chunks, max(1u, num_items / min_items));
+	}
+
+	num_chunks = min(num_chunks, num_items);
+
+	//
+	// The first extra chunks take one more item each.
+	//
+
+	base = num_items / num_chunks;
+	extra = num_items % num_chunks;
+	first = 0;
+
+	for (unsigned int i = 0; i < num_chunks; i++) {
+		recording_chunk chunk;
+
+		chunk.first_item = first;
+		chunk.num_items = base + (i < extra ? 1 : 0);
+		chunks.push_back(chunk);
+
+		first += chunk.num_items;
+	}
+
+	return chunks;
+}
+
+void record_chunks_in_parallel(
+	const vector<recording_chunk>& chunks,
+	const unsigned int num_threads,
+	chunk_recorder* recorder
+) {
+	atomic<unsigned int> next_chunk;
+	unsigned int num_workers;
+	vector<thread> workers;
+
+	next_chunk = 0;
+
+	//
+	// Workers pull chunks off a shared counter, the way the CPU executor
+	// hands out groups. Where a chunk ends up doesn't depend on which
+	// worker recorded it.
+	//
+
+	auto worker = [&]() {
+		unsigned int index;
+
+		while ((index = next_chunk.fetch_add(1)) < chunks.size()) {
+			recorder->record_chunk(index, &chunks[index]);
+		}
+	};
+
+	num_workers = num_threads == 0 ? 1 : num_threads;
+
+	if (num_workers > chunks.size()) {
+		num_workers = (unsigned int)chunks.size();
+	}
+
+	for (unsigned int i = 1; i < num_workers; i++) {
+		workers.emplace_back(worker);
+	}
+
+	worker();
+
+	for (thread& t : workers) {
+		t.join();
+	}
+}
+
+/* RECORDING_POOL IMPL */
+
+void initialize_recording_pool(
+	recording_pool* pool,
+	fence_timeline* timeline,
+	const unsigned int max_slots,
+	const uint64_t recycle_items,
+	const unsigned int idle_batches
+) {
+	pool->timeline = timeline;
+	pool->slots.clear();
+	pool->max_slots = max_slots == 0 ? 1 : max_slots;
+	pool->recycle_items = recycle_items;
+	pool->idle_batches = idle_batches;
+	pool->batches = 0;
+	pool->stats = { 0, 0, 0, 0, 0, 0 };
+}
+
+unsigned int acquire_recording_slot(recording_pool* pool, bool* fresh) {
+	uint64_t completed;
+	unsigned int best;
+	recording_slot* slot;
+
+	completed = pool->timeline->completed_value();
+	best = (unsigned int)pool->slots.size();
+
+	for (unsigned int i = 0; i < pool->slots.size(); i++) {
+		const recording_slot* candidate = &pool->slots[i];
+
+		if (!candidate->live || candidate->in_use || candidate->fence > completed) {
+			continue;
+		}
+
+		if (best == pool->slots.size() || candidate->last_batch > pool->slots[best].last_batch) {
+			best = i;
+		}
+	}
+
+	//
+	// Nothing free: bring back a released slot, or make a new one if
+	// there's room. Otherwise wait for the oldest batch.
+	//
+
+	if (best == pool->slots.size()) {
+		for (unsigned int i = 0; i < pool->slots.size() && best == pool->slots.size(); i++) {
+			if (!pool->slots[i].live) {
+				best = i;
+			}
+		}
+
+		if (best == pool->slots.size() && pool->slots.size() < pool->max_slots) {
+			pool->slots.push_back({ 0, false, false, 0, 0 });
+		}
+
+		if (best < pool->slots.size()) {
+			slot = &pool->slots[best];
+			slot->live = true;
+			slot->in_use = true;
+			slot->fence = 0;
+			slot->recorded_items = 0;
+			slot->last_batch = pool->batches;
+
+			pool->stats.created++;
+			*fresh = true;
+
+			return best;
+		}
+
+		for (unsigned int i = 0; i < pool->slots.size(); i++) {
+			if (pool->slots[i].in_use) {
+				continue;
+			}
+
+			if (best == pool->slots.size() || pool->slots[i].fence < pool->slots[best].fence) {
+				best = i;
+			}
+		}
+
+		//
+		// Every slot is out for this batch. Waiting wouldn't help.
+		//
+
+		if (best == pool->slots.size()) {
+			throw exception();
+		}
+
+		pool->timeline->wait_for(pool->slots[best].fence);
+		pool->stats.blocking_waits++;
+	}
+
+	slot = &pool->slots[best];
+	slot->in_use = true;
+	slot->last_batch = pool->batches;
+
+	if (slot->recorded_items > pool->recycle_items) {
+		slot->recorded_items = 0;
+		pool->stats.recycled++;
+		*fresh = true;
+	}
+	else {
+		pool->stats.reused++;
+		*fresh = false;
+	}
+
+	return best;
+}
+
+void retire_recording_slot(
+	recording_pool* pool,
+	const unsigned int slot,
+	const uint64_t recorded_items,
+	const uint64_t fence
+) {
+	pool->slots[slot].in_use = false;
+	pool->slots[slot].fence = fence;
+	pool->slots[slot].recorded_items += recorded_items;
+}
+
+void end_recording_batch(recording_pool* pool, vector<unsigned int>* released) {
+	uint64_t completed;
+
+	pool->batches++;
+	completed = pool->timeline->completed_value();
+
+	for (unsigned int i = 0; i < pool->slots.size(); i++) {
+		recording_slot* slot = &pool->slots[i];
+
+		if (!slot->live || slot->in_use || slot->fence > completed) {
+			continue;
+		}
+
+		if (pool->batches - slot->last_batch > pool->idle_batches) {
+			slot->live = false;
+			pool->stats.released++;
+			released->push_back(i);
+		}
+	}
+}
+
+recording_pool_stats get_recording_pool_stats(const recording_pool* pool) {
+	recording_pool_stats stats;
+
+	stats = pool->stats;
+	stats.live_slots = 0;
+
+	for (const recording_slot& slot : pool->slots) {
+		if (slot.live) {
+			stats.live_slots++;
+		}
+	}
+
+	return stats;
+}
+
+/* CHECKING */
+
+/*
+	Writes each chunk's items into a list of its own, with some
+	scheduling noise, like threads recording command lists.
+*/
+struct mock_chunk_recorder : chunk_recorder {
+	vector<vector<unsigned int>> lists;
+	atomic<unsigned int> yields;
+
+	void record_chunk(const unsigned int index, const recording_chunk* chunk) override {
+		for (unsigned int i = 0; i < chunk->num_items; i++) {
+			lists[index].push_back(chunk->first_item + i);
+
+			if ((chunk->first_item + i) % 97 == index % 7) {
+				yields++;
+				this_thread::yield();
+			}
+		}
+	}
+};
+
+bool verify_recording_pool(FILE* out) {
+	mt19937 rng(2025);
+	mock_fence_timeline timeline;
+	recording_pool pool;
+	vector<unsigned int> released;
+	unsigned int problems;
+
+	problems = 0;
+
+	auto report = [&](const char* what) {
+		if (out != NULL && problems < 10) {
+			fprintf(out, "  %s\n", what);
+		}
+
+		problems++;
+	};
+
+	//
+	// Chunk plans cover every item once, in order, evenly.
+	//
+
+	for (unsigned int items = 0; items <= 600; items += 1 + items / 16) {
+		for (unsigned int threads = 0; threads <= 16; threads++) {
+			for (unsigned int min_items : { 0u, 1u, 64u }) {
+				vector<recording_chunk> chunks = plan_recording_chunks(items, threads, min_items);
+				unsigned int next = 0;
+				unsigned int smallest = 0xFFFFFFFF;
+				unsigned int largest = 0;
+
+				for (const recording_chunk& chunk : chunks) {
+					if (chunk.first_item != next || chunk.num_items == 0) {
+						report("a chunk plan has a gap, an overlap or an empty chunk");
+					}
+
+					next = chunk.first_item + chunk.num_items;
+					smallest = min(smallest, chunk.num_items);
+					largest = max(largest, chunk.num_items);
+				}
+
+				if (next != items || chunks.size() > max(1u, threads)) {
+					report("a chunk plan doesn't cover the items or has too many chunks");
+				}
+
+				if (!chunks.empty() && (largest - smallest > 1 || (chunks.size() > 1 && smallest < min_items))) {
+					report("a chunk plan is uneven or has a chunk below the minimum");
+				}
+			}
+		}
+	}
+
+	//
+	// The lists come out in item order whatever the threads do.
+	//
+
+	for (unsigned int round = 0; round < 50; round++) {
+		unsigned int items = 1 + rng() % 5000;
+		unsigned int threads = 1 + rng() % 8;
+		vector<recording_chunk> chunks = plan_recording_chunks(items, threads, 1 + rng() % 128);
+		mock_chunk_recorder recorder;
+		unsigned int next = 0;
+
+		recorder.lists.assign(chunks.size(), vector<unsigned int>());
+		recorder.yields = 0;
+
+		record_chunks_in_parallel(chunks, threads, &recorder);
+
+		for (const vector<unsigned int>& list : recorder.lists) {
+			for (unsigned int item : list) {
+				if (item != next++) {
+					report("parallel recording put an item out of order");
+				}
+			}
+		}
+
+		if (next != items) {
+			report("parallel recording lost items");
+		}
+	}
+
+	//
+	// The pool, against a GPU that finishes batches at random.
+	//
+
+	initialize_recording_pool(&pool, &timeline, 12, 1000, 8);
+
+	for (unsigned int batch = 0; batch < 2000; batch++) {
+		unsigned int wanted = batch < 1500 ? 1 + rng() % 5 : 1;
+		vector<unsigned int> held;
+		uint64_t fence;
+
+		for (unsigned int i = 0; i < wanted; i++) {
+			bool fresh;
+			unsigned int slot = acquire_recording_slot(&pool, &fresh);
+
+			if (find(held.begin(), held.end(), slot) != held.end()) {
+				report("a slot was handed out twice in one batch");
+			}
+
+			if (pool.slots[slot].fence > timeline.completed_value()) {
+				report("a slot was handed out before the GPU was done with it");
+			}
+
+			if (pool.slots[slot].recorded_items > pool.recycle_items) {
+				report("a slot past recycle_items wasn't recycled");
+			}
+
+			held.push_back(slot);
+		}
+
+		fence = timeline.signal();
+
+		for (unsigned int slot : held) {
+			retire_recording_slot(&pool, slot, rng() % 600, fence);
+		}
+
+		if (batch < 1500) {
+			timeline.complete_up_to(timeline.completed_value() + rng() % 3);
+		}
+		else {
+			timeline.complete_up_to(fence);
+		}
+
+		end_recording_batch(&pool, &released);
+
+		if (get_recording_pool_stats(&pool).live_slots > pool.max_slots) {
+			report("the pool grew past max_slots");
+		}
+	}
+
+	//
+	// The last 500 batches only needed one slot each, so the rest went
+	// idle and were released.
+	//
+
+	timeline.complete_up_to(timeline.last_signaled);
+	end_recording_batch(&pool, &released);
+
+	if (pool.stats.recycled == 0 || pool.stats.released == 0 || get_recording_pool_stats(&pool).live_slots > 2) {
+		report("big slots weren't recycled or idle ones weren't released");
+	}
+
+	//
+	// A full pool with a GPU that never catches up on its own has to
+	// wait, and one that is all out for the current batch can't.
+	//
+
+	initialize_recording_pool(&pool, &timeline, 4, DEFAULT_RECYCLE_ITEMS, DEFAULT_IDLE_BATCHES);
+
+	for (unsigned int batch = 0; batch < 10; batch++) {
+		vector<unsigned int> held;
+		uint64_t fence;
+
+		for (unsigned int i = 0; i < 4; i++) {
+			bool fresh;
+			held.push_back(acquire_recording_slot(&pool, &fresh));
+		}
+
+		if (batch == 9) {
+			bool threw = false;
+			bool fresh;
+
+			try {
+				acquire_recording_slot(&pool, &fresh);
+			}
+			catch (const exception&) {
+				threw = true;
+			}
+
+			if (!threw) {
+				report("a pool with every slot out handed out another");
+			}
+		}
+
+		fence = timeline.signal();
+
+		for (unsigned int slot : held) {
+			retire_recording_slot(&pool, slot, 1, fence);
+		}
+
+		end_recording_batch(&pool, &released);
+	}
+
+	//
+	// One wait per batch: the oldest batch's fence frees all four.
+	//
+
+	if (pool.stats.blocking_waits != 9 || pool.stats.created != 4) {
+		report("a full pool didn't wait for the oldest batch");
+	}
+
+	if (out != NULL) {
+		fprintf(out, "Recording pool: %s\n", problems == 0 ? "all correct" : (to_string(problems) + " problem(s)").c_str());
+	}
+
+	return problems == 0;
+}
+
+/*
+	Stands in for a command list: every command is a few words, about
+	what a D3D12 driver writes for a Dispatch with its bindings.
+*/
+struct mock_command_recorder : chunk_recorder {
+	vector<vector<uint32_t>*> lists;
+
+	void record_chunk(const unsigned int index, const recording_chunk* chunk) override {
+		vector<uint32_t>* list = lists[index];
+		uint32_t hash = index;
+
+		for (unsigned int i = 0; i < chunk->num_items; i++) {
+			uint32_t item = chunk->first_item + i;
+
+			for (unsigned int word = 0; word < 12; word++) {
+				hash = (hash ^ (item + word)) * 16777619u;
+				list->push_back(hash);
+			}
+		}
+	}
+};
+
+void benchmark_recording_pool(FILE* out) {
+	const unsigned int items_per_batch = 16384;
+	const unsigned int batches = 200;
+	const unsigned int frames_in_flight = 3;
+	double one_thread;
+
+	fprintf(out, "  %u mock dispatches per batch, %u batches, %u frames in flight\n", items_per_batch, batches, frames_in_flight);
+	fprintf(out, "  %7s %14s %8s %8s %8s %8s\n", "threads", "dispatches/s", "speedup", "lists", "made", "waits");
+
+	one_thread = 0.0;
+
+	for (unsigned int threads : { 1u, 2u, 4u, 8u }) {
+		mock_fence_timeline timeline;
+		recording_pool pool;
+		vector<vector<uint32_t>> storage;
+		vector<unsigned int> released;
+		chrono::steady_clock::time_point start;
+		chrono::duration<double> elapsed;
+		recording_pool_stats stats;
+		double rate;
+
+		initialize_recording_pool(&pool, &timeline, threads * frames_in_flight, DEFAULT_RECYCLE_ITEMS, DEFAULT_IDLE_BATCHES);
+		storage.resize(pool.max_slots);
+
+		start = chrono::steady_clock::now();
+
+		for (unsigned int b = 0; b < batches; b++) {
+			vector<recording_chunk> chunks = plan_recording_chunks(items_per_batch, threads, DEFAULT_MIN_CHUNK_ITEMS);
+			mock_command_recorder recorder;
+			vector<unsigned int> held;
+			uint64_t fence;
+
+			for (size_t c = 0; c < chunks.size(); c++) {
+				bool fresh;
+				unsigned int slot = acquire_recording_slot(&pool, &fresh);
+
+				if (fresh) {
+					vector<uint32_t>().swap(storage[slot]);
+				}
+
+				storage[slot].clear();
+				recorder.lists.push_back(&storage[slot]);
+				held.push_back(slot);
+			}
+
+			record_chunks_in_parallel(chunks, threads, &recorder);
+
+			//
+			// The GPU keeps frames_in_flight - 1 batches behind the one
+			// being recorded.
+			//
+
+			fence = timeline.signal();
+
+			for (size_t c = 0; c < chunks.size(); c++) {
+				retire_recording_slot(&pool, held[c], chunks[c].num_items, fence);
+			}
+
+			if (fence >= frames_in_flight) {
+				timeline.complete_up_to(fence - frames_in_flight + 1);
+			}
+
+			end_recording_batch(&pool, &released);
+		}
+
+		elapsed = chrono::steady_clock::now() - start;
+		stats = get_recording_pool_stats(&pool);
+		rate = (double)items_per_batch * batches / elapsed.count();
+
+		if (threads == 1) {
+			one_thread = rate;
+		}
+
+		fprintf(
+			out,
+			"  %7u %14.0f %7.2fx %8u %8llu %8llu\n",
+			threads,
+			rate,
+			rate / one_thread,
+			(unsigned int)plan_recording_chunks(items_per_batch, threads, DEFAULT_MIN_CHUNK_ITEMS).size(),
+			(unsigned long long)stats.created,
+			(unsigned long long)stats.blocking_waits
+		);
+	}
+
+	fprintf(out, "  (hardware threads: %u)\n", thread::hardware_concurrency());
+}
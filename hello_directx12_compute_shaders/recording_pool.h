@@ -0,0 +1,160 @@
+// Liam Wynn, 01/10/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The recording pool lets one batch be recorded on several threads.
+	The batch's items (dispatches, usually) are cut into chunks, one
+	per thread at most, and every chunk is recorded into a command list
+	of its own. The lists go to the GPU in chunk order, whichever thread
+	finished first, so the batch is the same however it was recorded.
+
+	Each chunk needs an allocator and list the GPU isn't using. The pool
+	keeps those as slots, tagged like frame_ring's with the fence value
+	of the last batch they went out in, so a slot is per thread and per
+	frame in flight without either being fixed up front. A slot is only
+	handed out again once its fence has passed; when none has and the
+	pool is at max_slots, it waits for the oldest.
+
+	Resetting an allocator keeps the memory it grew to. So that one
+	huge batch doesn't pin that memory for good, a slot that has
+	recorded more than recycle_items items since it was made is handed
+	out fresh (the caller makes a new allocator and list), and slots
+	nobody has needed for idle_batches batches are released.
+
+	The pool only knows slots and fence values, and talks to the queue
+	through a fence_timeline, so it runs against mock_fence_timeline
+	without a device. parallel_recorder puts D3D12 allocators and lists
+	behind the slots.
+*/
+
+#pragma once
+
+#include "frame_ring.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Below this many items a chunk isn't worth a thread of its own.
+const unsigned int DEFAULT_MIN_CHUNK_ITEMS = 64;
+
+const uint64_t DEFAULT_RECYCLE_ITEMS = 1 << 16;
+const unsigned int DEFAULT_IDLE_BATCHES = 64;
+
+struct recording_chunk {
+	unsigned int first_item;
+	unsigned int num_items;
+};
+
+/*
+	Cuts num_items into at most num_threads contiguous chunks, in item
+	order, that differ in size by at most one. No chunk has fewer than
+	min_items items unless there is only one.
+*/
+std::vector<recording_chunk> plan_recording_chunks(
+	const unsigned int num_items,
+	const unsigned int num_threads,
+	const unsigned int min_items
+);
+
+/*
+	Records chunks on up to num_threads threads. record_chunk is called
+	once per chunk, from any thread, and chunks are recorded at the
+	same time, so each has to go somewhere of its own.
+*/
+struct chunk_recorder {
+	virtual ~chunk_recorder() {}
+
+	virtual void record_chunk(const unsigned int index, const recording_chunk* chunk) = 0;
+};
+
+void record_chunks_in_parallel(
+	const std::vector<recording_chunk>& chunks,
+	const unsigned int num_threads,
+	chunk_recorder* recorder
+);
+
+struct recording_slot {
+	// Fence value of the last batch the slot went out in, 0 if none.
+	uint64_t fence;
+
+	// Handed out and not retired yet.
+	bool in_use;
+
+	// Has an allocator and list. False once released.
+	bool live;
+
+	// Items recorded since the allocator was made, as a stand-in for the
+	// memory it holds.
+	uint64_t recorded_items;
+
+	// The batch that last used it.
+	uint64_t last_batch;
+};
+
+struct recording_pool_stats {
+	uint64_t created;
+	uint64_t reused;
+	uint64_t recycled;
+	uint64_t released;
+	uint64_t blocking_waits;
+	unsigned int live_slots;
+};
+
+struct recording_pool {
+	fence_timeline* timeline;
+	std::vector<recording_slot> slots;
+
+	unsigned int max_slots;
+	uint64_t recycle_items;
+	unsigned int idle_batches;
+
+	uint64_t batches;
+	recording_pool_stats stats;
+};
+
+void initialize_recording_pool(
+	recording_pool* pool,
+	fence_timeline* timeline,
+	const unsigned int max_slots,
+	const uint64_t recycle_items,
+	const unsigned int idle_batches
+);
+
+/*
+	A slot the GPU is done with. fresh is set if the caller has to make
+	its allocator and list (a new slot, or one being recycled), and is
+	clear if it only resets them. The most recently used free slot goes
+	first, so the rest can go idle.
+*/
+unsigned int acquire_recording_slot(recording_pool* pool, bool* fresh);
+
+// The slot went out in the batch that signals fence.
+void retire_recording_slot(
+	recording_pool* pool,
+	const unsigned int slot,
+	const uint64_t recorded_items,
+	const uint64_t fence
+);
+
+/*
+	Ends a batch. Slots idle for more than idle_batches batches are
+	released and added to released, for the caller to drop their
+	allocator and list.
+*/
+void end_recording_batch(recording_pool* pool, std::vector<unsigned int>* released);
+
+recording_pool_stats get_recording_pool_stats(const recording_pool* pool);
+
+/*
+	Checks the chunk plans, that the chunks come out in order whatever
+	the threads do, and the pool against a mock timeline: no slot is
+	handed out twice or before its fence, max_slots holds, and big and
+	idle slots are recycled and released. Problems go to out, which may
+	be NULL. Returns false if there were any.
+*/
+bool verify_recording_pool(FILE* out);
+
+/*
+	Records batches of mock commands on 1 to 8
+	threads and prints items per second for each.
+*/
+void benchmark_recording_pool(FILE* out);
@@ -0,0 +1,414 @@
+// Liam Wynn, 12/23/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "resource_state_tracker.h"
+
+using namespace std;
+
+void initialize_resource_state_tracker(
+	resource_state_tracker* tracker,
+	const uint32_t uav_state,
+	const uint32_t read_only_states
+) {
+	tracker->uav_state = uav_state;
+	tracker->read_only_states = read_only_states;
+	tracker->resources.clear();
+	tracker->pending.clear();
+	tracker->dropped_transitions = 0;
+	tracker->merged_transitions = 0;
+}
+
+void track_resource(
+	resource_state_tracker* tracker,
+	const void* resource,
+	const uint32_t num_subresources,
+	const uint32_t initial_state
+) {
+	tracked_subresource sub;
+
+	sub.state = initial_state;
+	sub.uav_written = false;
+	sub.splitting = false;
+	sub.split_state = initial_state;
+
+	tracker->resources[resource].subresources.assign(num_subresources > 0 ? num_subresources : 1, sub);
+}
+
+void untrack_resource(resource_state_tracker* tracker, const void* resource) {
+	size_t kept;
+
+	tracker->resources.erase(resource);
+
+	//
+	// Nothing may be recorded for a resource that's gone.
+	//
+
+	kept = 0;
+
+	for (size_t i = 0; i < tracker->pending.size(); i++) {
+		if (tracker->pending[i].resource != resource) {
+			tracker->pending[kept++] = tracker->pending[i];
+		}
+	}
+
+	tracker->pending.resize(kept);
+}
+
+void assume_resource_state(
+	resource_state_tracker* tracker,
+	const void* resource,
+	const uint32_t state
+) {
+	for (tracked_subresource& sub : tracker->resources.at(resource).subresources) {
+		sub.state = state;
+		sub.uav_written = false;
+		sub.splitting = false;
+		sub.split_state = state;
+	}
+}
+
+uint32_t tracked_resource_state(
+	const resource_state_tracker* tracker,
+	const void* resource,
+	const uint32_t subresource
+) {
+	const tracked_resource* tracked;
+	uint32_t state;
+
+	tracked = &tracker->resources.at(resource);
+
+	if (subresource != ALL_TRACKED_SUBRESOURCES) {
+		return tracked->subresources[subresource].state;
+	}
+
+	state = tracked->subresources[0].state;
+
+	for (const tracked_subresource& sub : tracked->subresources) {
+		if (sub.state != state) {
+			return ALL_TRACKED_SUBRESOURCES;
+		}
+	}
+
+	return state;
+}
+
+static bool is_read_only(const resource_state_tracker* tracker, const uint32_t state) {
+	return state != 0 && (state & ~tracker->read_only_states) == 0;
+}
+
+/*
+	The last pending barrier that touches subresource, or -1. Only that
+	one can be folded into, since anything after it assumed its result.
+*/
+static int last_pending_barrier(
+	const resource_state_tracker* tracker,
+	const void* resource,
+	const uint32_t subresource
+) {
+	for (int i = (int)tracker->pending.size() - 1; i >= 0; i--) {
+		const tracked_barrier* pending = &tracker->pending[i];
+
+		if (pending->resource != resource) {
+			continue;
+		}
+
+		if (pending->subresource == subresource
+			|| pending->subresource == ALL_TRACKED_SUBRESOURCES
+			|| subresource == ALL_TRACKED_SUBRESOURCES) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/*
+	Adds a transition for one subresource, folding it into a transition
+	already pending for the same subresource.
+*/
+static void add_transition(
+	resource_state_tracker* tracker,
+	const void* resource,
+	const uint32_t subresource,
+	const uint32_t before,
+	const uint32_t after
+) {
+	tracked_barrier barrier;
+	int i;
+
+	i = last_pending_barrier(tracker, resource, subresource);
+
+	if (i >= 0
+		&& tracker->pending[i].kind == TRACKED_BARRIER_TRANSITION
+		&& tracker->pending[i].subresource == subresource) {
+		tracked_barrier* pending = &tracker->pending[i];
+
+		tracker->merged_transitions++;
+		pending->after = after;
+
+		//
+		// Back where it started. The transition is a no-op.
+		//
+
+		if (pending->before == pending->after) {
+			tracker->pending.erase(tracker->pending.begin() + i);
+			tracker->dropped_transitions++;
+		}
+
+		return;
+	}
+
+	barrier.kind = TRACKED_BARRIER_TRANSITION;
+	barrier.resource = resource;
+	barrier.subresource = subresource;
+	barrier.before = before;
+	barrier.after = after;
+
+	tracker->pending.push_back(barrier);
+}
+
+static void add_barrier(
+	resource_state_tracker* tracker,
+	const tracked_barrier_kind kind,
+	const void* resource,
+	const uint32_t subresource,
+	const uint32_t before,
+	const uint32_t after
+) {
+	tracked_barrier barrier;
+
+	barrier.kind = kind;
+	barrier.resource = resource;
+	barrier.subresource = subresource;
+	barrier.before = before;
+	barrier.after = after;
+
+	tracker->pending.push_back(barrier);
+}
+
+/*
+	The state a subresource has to move to so it can be used in state.
+	Read-only states combine.
+*/
+static uint32_t target_state(
+	const resource_state_tracker* tracker,
+	const uint32_t current,
+	const uint32_t state
+) {
+	if (is_read_only(tracker, current) && is_read_only(tracker, state)) {
+		return current | state;
+	}
+
+	return state;
+}
+
+static bool subresources_match(const tracked_resource* tracked) {
+	const tracked_subresource& first = tracked->subresources[0];
+
+	for (const tracked_subresource& sub : tracked->subresources) {
+		if (sub.state != first.state
+			|| sub.splitting != first.splitting
+			|| sub.split_state != first.split_state
+			|| sub.uav_written != first.uav_written) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void require_subresource_state(
+	resource_state_tracker* tracker,
+	const void* resource,
+	tracked_subresource* sub,
+	const uint32_t barrier_subresource,
+	const uint32_t state,
+	const bool writes
+) {
+	uint32_t target;
+	int last;
+
+	//
+	// Finish a split barrier first. Then we are in its state, and go
+	// on from there like any other access. If nothing was recorded
+	// since it began, there is nothing to overlap, so it becomes a
+	// plain transition.
+	//
+
+	if (sub->splitting) {
+		last = last_pending_barrier(tracker, resource, barrier_subresource);
+
+		if (last >= 0
+			&& tracker->pending[last].kind == TRACKED_BARRIER_BEGIN_ONLY
+			&& tracker->pending[last].subresource == barrier_subresource) {
+			tracker->pending[last].kind = TRACKED_BARRIER_TRANSITION;
+		}
+		else {
+			add_barrier(tracker, TRACKED_BARRIER_END_ONLY, resource, barrier_subresource, sub->state, sub->split_state);
+		}
+
+		sub->state = sub->split_state;
+		sub->splitting = false;
+		sub->uav_written = false;
+	}
+
+	target = target_state(tracker, sub->state, state);
+
+	if (target != sub->state) {
+		add_transition(tracker, resource, barrier_subresource, sub->state, target);
+		sub->state = target;
+
+		// A transition also orders the writes before it.
+		sub->uav_written = false;
+	}
+	else if ((sub->state & tracker->uav_state) != 0 && sub->uav_written) {
+		add_barrier(tracker, TRACKED_BARRIER_UAV, resource, barrier_subresource, sub->state, sub->state);
+		sub->uav_written = false;
+	}
+
+	if (writes && (state & tracker->uav_state) != 0) {
+		sub->uav_written = true;
+	}
+}
+
+void require_resource_state(
+	resource_state_tracker* tracker,
+	const void* resource,
+	const uint32_t subresource,
+	const uint32_t state,
+	const bool writes
+) {
+	tracked_resource* tracked;
+
+	tracked = &tracker->resources.at(resource);
+
+	if (tracked->subresources.size() == 1) {
+		require_subresource_state(tracker, resource, &tracked->subresources[0], ALL_TRACKED_SUBRESOURCES, state, writes);
+		return;
+	}
+
+	if (subresource != ALL_TRACKED_SUBRESOURCES) {
+		require_subresource_state(tracker, resource, &tracked->subresources[subresource], subresource, state, writes);
+		return;
+	}
+
+	//
+	// If every subresource is in the same place, one barrier on the
+	// whole resource does it. Otherwise each one moves on its own.
+	//
+
+	if (subresources_match(tracked)) {
+		require_subresource_state(tracker, resource, &tracked->subresources[0], ALL_TRACKED_SUBRESOURCES, state, writes);
+
+		for (tracked_subresource& sub : tracked->subresources) {
+			sub = tracked->subresources[0];
+		}
+
+		return;
+	}
+
+	for (uint32_t i = 0; i < (uint32_t)tracked->subresources.size(); i++) {
+		require_subresource_state(tracker, resource, &tracked->subresources[i], i, state, writes);
+	}
+}
+
+static void begin_subresource_transition(
+	resource_state_tracker* tracker,
+	const void* resource,
+	tracked_subresource* sub,
+	const uint32_t barrier_subresource,
+	const uint32_t state
+) {
+	uint32_t target;
+
+	if (sub->splitting) {
+		return;
+	}
+
+	target = target_state(tracker, sub->state, state);
+
+	if (target == sub->state) {
+		return;
+	}
+
+	add_barrier(tracker, TRACKED_BARRIER_BEGIN_ONLY, resource, barrier_subresource, sub->state, target);
+	sub->splitting = true;
+	sub->split_state = target;
+}
+
+void begin_resource_transition(
+	resource_state_tracker* tracker,
+	const void* resource,
+	const uint32_t subresource,
+	const uint32_t state
+) {
+	tracked_resource* tracked;
+
+	tracked = &tracker->resources.at(resource);
+
+	if (tracked->subresources.size() == 1) {
+		begin_subresource_transition(tracker, resource, &tracked->subresources[0], ALL_TRACKED_SUBRESOURCES, state);
+		return;
+	}
+
+	if (subresource != ALL_TRACKED_SUBRESOURCES) {
+		begin_subresource_transition(tracker, resource, &tracked->subresources[subresource], subresource, state);
+		return;
+	}
+
+	if (subresources_match(tracked)) {
+		begin_subresource_transition(tracker, resource, &tracked->subresources[0], ALL_TRACKED_SUBRESOURCES, state);
+
+		for (tracked_subresource& sub : tracked->subresources) {
+			sub = tracked->subresources[0];
+		}
+
+		return;
+	}
+
+	for (uint32_t i = 0; i < (uint32_t)tracked->subresources.size(); i++) {
+		begin_subresource_transition(tracker, resource, &tracked->subresources[i], i, state);
+	}
+}
+
+unsigned int collect_resource_barriers(
+	resource_state_tracker* tracker,
+	vector<tracked_barrier>* out
+) {
+	out->swap(tracker->pending);
+	tracker->pending.clear();
+
+	return (unsigned int)out->size();
+}
+
+void end_resource_transitions(resource_state_tracker* tracker) {
+	for (auto& entry : tracker->resources) {
+		tracked_resource* tracked = &entry.second;
+
+		//
+		// Splits that began on the whole resource end on the whole
+		// resource.
+		//
+
+		if (subresources_match(tracked)) {
+			if (tracked->subresources[0].splitting) {
+				require_resource_state(tracker, entry.first, ALL_TRACKED_SUBRESOURCES, tracked->subresources[0].split_state, false);
+			}
+
+			continue;
+		}
+
+		for (uint32_t i = 0; i < (uint32_t)tracked->subresources.size(); i++) {
+			if (tracked->subresources[i].splitting) {
+				require_resource_state(tracker, entry.first, i, tracked->subresources[i].split_state, false);
+			}
+		}
+	}
+}
+
+void reset_uav_hazards(resource_state_tracker* tracker) {
+	for (auto& entry : tracker->resources) {
+		for (tracked_subresource& sub : entry.second.subresources) {
+			sub.uav_written = false;
+		}
+	}
+}
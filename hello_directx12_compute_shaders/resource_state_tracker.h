@@ -0,0 +1,161 @@
+// Liam Wynn, 12/23/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The resource state tracker remembers what state every resource (and
+	every subresource of it) is in, so callers only say what state the
+	next operation needs and the tracker works out the barriers.
+
+	Requirements pile up until collect_resource_barriers is called, which
+	hands back everything needed so far in one list, so it can go into a
+	single ResourceBarrier call. A subresource that is asked for twice
+	before a collect only gets one transition (from its original state
+	to the last one asked for), and one that ends up where it started
+	gets none.
+
+	Two read-only states are merged instead of transitioned between, the
+	way D3D12 allows. Writes through a UAV followed by another UAV access
+	get a UAV barrier.
+
+	If the caller already knows the next state of a resource but has
+	other work to record first, begin_resource_transition starts a split
+	barrier (BEGIN_ONLY). The matching END_ONLY is produced by the next
+	require_resource_state on that resource, so the GPU can overlap the
+	transition with the work in between.
+
+	States are plain bitmasks and resources plain pointers, so this
+	doesn't need a device. record_resource_barriers in dx12_handler
+	turns the output into D3D12_RESOURCE_BARRIERs.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+const uint32_t ALL_TRACKED_SUBRESOURCES = 0xFFFFFFFF;
+
+enum tracked_barrier_kind {
+	TRACKED_BARRIER_TRANSITION,
+	TRACKED_BARRIER_BEGIN_ONLY,
+	TRACKED_BARRIER_END_ONLY,
+	TRACKED_BARRIER_UAV
+};
+
+struct tracked_barrier {
+	tracked_barrier_kind kind;
+	const void* resource;
+
+	// ALL_TRACKED_SUBRESOURCES when every subresource moves together.
+	uint32_t subresource;
+
+	uint32_t before;
+	uint32_t after;
+};
+
+struct tracked_subresource {
+	uint32_t state;
+
+	// A UAV write hasn't been followed by a UAV barrier yet.
+	bool uav_written;
+
+	// A split barrier to split_state has begun and not ended.
+	bool splitting;
+	uint32_t split_state;
+};
+
+struct tracked_resource {
+	std::vector<tracked_subresource> subresources;
+};
+
+struct resource_state_tracker {
+	// Bit patterns of the UAV state and of the states that only read.
+	uint32_t uav_state;
+	uint32_t read_only_states;
+
+	std::unordered_map<const void*, tracked_resource> resources;
+
+	// Barriers required since the last collect, in the order they were
+	// required. Transitions are merged per subresource.
+	std::vector<tracked_barrier> pending;
+
+	unsigned int dropped_transitions;
+	unsigned int merged_transitions;
+};
+
+void initialize_resource_state_tracker(
+	resource_state_tracker* tracker,
+	const uint32_t uav_state,
+	const uint32_t read_only_states
+);
+
+void track_resource(
+	resource_state_tracker* tracker,
+	const void* resource,
+	const uint32_t num_subresources,
+	const uint32_t initial_state
+);
+void untrack_resource(resource_state_tracker* tracker, const void* resource);
+
+/*
+	Every subresource of resource got to state without a barrier, e.g.
+	by decaying to COMMON after it was used on the copy queue. Nothing
+	is recorded.
+*/
+void assume_resource_state(
+	resource_state_tracker* tracker,
+	const void* resource,
+	const uint32_t state
+);
+
+// ALL_TRACKED_SUBRESOURCES if the subresources are not all in the
+// same state.
+uint32_t tracked_resource_state(
+	const resource_state_tracker* tracker,
+	const void* resource,
+	const uint32_t subresource
+);
+
+/*
+	The next operation accesses subresource (or all of them) in state,
+	and writes it if writes is true.
+*/
+void require_resource_state(
+	resource_state_tracker* tracker,
+	const void* resource,
+	const uint32_t subresource,
+	const uint32_t state,
+	const bool writes
+);
+
+/*
+	The resource will be needed in state later, but not by the next few
+	operations. Starts a split barrier.
+*/
+void begin_resource_transition(
+	resource_state_tracker* tracker,
+	const void* resource,
+	const uint32_t subresource,
+	const uint32_t state
+);
+
+/*
+	Moves every pending barrier into out (replacing its contents).
+	Returns how many there are.
+*/
+unsigned int collect_resource_barriers(
+	resource_state_tracker* tracker,
+	std::vector<tracked_barrier>* out
+);
+
+/*
+	Ends every split barrier still in flight. A command list has to do
+	this before it is closed.
+*/
+void end_resource_transitions(resource_state_tracker* tracker);
+
+/*
+	Work in separate submissions doesn't need UAV barriers between it.
+	Call after a command list is submitted.
+*/
+void reset_uav_hazards(resource_state_tracker* tracker);
@@ -0,0 +1,390 @@
+// Liam Wynn, 12/05/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "result_formatter.h"
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Roughly how much text one worker formats before it is written out.
+// Keeps memory bounded no matter how big the buffer is.
+const size_t FORMAT_CHUNK_BYTES = 4 * 1024 * 1024;
+
+// Upper bound on the text for one element. Six decimal places on a
+// float in fixed notation can be ~48 characters on its own.
+const size_t MAX_ELEMENT_CHARS = 4 * 56 + 48;
+
+/* FORMATTING HELPERS */
+
+static char* append_literal(char* dst, const char* text, const size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		dst[i] = text[i];
+	}
+
+	return dst + length;
+}
+
+static char* append_uint(char* dst, char* end, const unsigned int value) {
+	return to_chars(dst, end, value).ptr;
+}
+
+/*
+	Same text as printf's %f. Both produce the correctly rounded
+	decimal of the value, but they spell NaN and infinity differently
+	between C runtimes, so those go through snprintf.
+*/
+static char* append_float(char* dst, char* end, const float value) {
+	int written;
+
+	if (!isfinite(value)) {
+		written = snprintf(dst, end - dst, "%f", value);
+		return dst + written;
+	}
+
+	return to_chars(dst, end, (double)value, chars_format::fixed, 6).ptr;
+}
+
+static const float* row_at(const float4_rows* rows, const unsigned int row) {
+	return reinterpret_cast<const float*>(rows->data + (size_t)row * rows->row_pitch);
+}
+
+static void format_rows(
+	const float4_rows* rows,
+	const unsigned int first_row,
+	const unsigned int end_row,
+	string* text
+) {
+	const float* element;
+	char* begin;
+	char* dst;
+	char* end;
+	size_t max_size;
+
+	max_size = (size_t)(end_row - first_row) * rows->width * MAX_ELEMENT_CHARS;
+	text->resize(max_size);
+
+	begin = &(*text)[0];
+	dst = begin;
+	end = begin + max_size;
+
+	for (unsigned int row = first_row; row < end_row; row++) {
+		element = row_at(rows, row);
+
+		for (unsigned int col = 0; col < rows->width; col++) {
+			dst = append_literal(dst, "Element (", 9);
+			dst = append_uint(dst, end, row);
+			dst = append_literal(dst, ", ", 2);
+			dst = append_uint(dst, end, col);
+			dst = append_literal(dst, "): (", 4);
+			dst = append_float(dst, end, element[0]);
+			dst = append_literal(dst, ", ", 2);
+			dst = append_float(dst, end, element[1]);
+			dst = append_literal(dst, ", ", 2);
+			dst = append_float(dst, end, element[2]);
+			dst = append_literal(dst, ", ", 2);
+			dst = append_float(dst, end, element[3]);
+			dst = append_literal(dst, ")\n", 2);
+
+			element += 4;
+		}
+	}
+
+	text->resize(dst - begin);
+}
+
+static unsigned int clamp_thread_count(const unsigned int num_threads) {
+	unsigned int count;
+
+	count = num_threads;
+	if (count == 0) {
+		count = thread::hardware_concurrency();
+	}
+
+	return count == 0 ? 1 : count;
+}
+
+/* RESULT_FORMATTER IMPL */
+
+void print_results(
+	const float4_rows* rows,
+	const result_print_mode mode,
+	const unsigned int num_threads,
+	FILE* out
+) {
+	channel_summary summary;
+
+	if (mode == RESULT_PRINT_SUMMARY) {
+		summary = summarize_channels(rows, num_threads);
+		format_channel_summary(&summary, out);
+		return;
+	}
+
+	format_all_elements(rows, num_threads, out);
+}
+
+void format_all_elements(
+	const float4_rows* rows,
+	const unsigned int num_threads,
+	FILE* out
+) {
+	unsigned int workers;
+	unsigned int rows_per_chunk;
+	unsigned int rows_per_round;
+	unsigned int next_row;
+	vector<string> ready;
+	vector<string> pending;
+	vector<thread> threads;
+
+	if (rows->width == 0 || rows->height == 0) {
+		return;
+	}
+
+	workers = clamp_thread_count(num_threads);
+
+	rows_per_chunk = (unsigned int)(FORMAT_CHUNK_BYTES / ((size_t)rows->width * MAX_ELEMENT_CHARS));
+	if (rows_per_chunk == 0) {
+		rows_per_chunk = 1;
+	}
+
+	rows_per_round = rows_per_chunk * workers;
+
+	ready.resize(workers);
+	pending.resize(workers);
+
+	//
+	// Each round gives every worker a contiguous chunk of rows. While
+	// the workers format round k + 1, this thread writes out round k,
+	// one fwrite per chunk, in row order.
+	//
+
+	next_row = 0;
+
+	while (next_row < rows->height || !ready.empty()) {
+		threads.clear();
+
+		for (unsigned int w = 0; w < workers; w++) {
+			unsigned int first;
+			unsigned int last;
+
+			first = next_row + w * rows_per_chunk;
+			last = first + rows_per_chunk;
+
+			if (first >= rows->height) {
+				pending[w].clear();
+				continue;
+			}
+
+			if (last > rows->height) {
+				last = rows->height;
+			}
+
+			threads.emplace_back(format_rows, rows, first, last, &pending[w]);
+		}
+
+		for (const string& text : ready) {
+			if (!text.empty()) {
+				fwrite(text.data(), 1, text.size(), out);
+			}
+		}
+
+		for (thread& t : threads) {
+			t.join();
+		}
+
+		next_row += rows_per_round;
+
+		if (threads.empty()) {
+			ready.clear();
+		}
+		else {
+			ready.swap(pending);
+		}
+	}
+
+	fflush(out);
+}
+
+channel_summary summarize_channels(
+	const float4_rows* rows,
+	const unsigned int num_threads
+) {
+	channel_summary summary;
+	vector<channel_summary> partials;
+	vector<thread> threads;
+	unsigned int workers;
+	unsigned int rows_per_worker;
+	double count;
+
+	for (int c = 0; c < 4; c++) {
+		summary.min[c] = INFINITY;
+		summary.max[c] = -INFINITY;
+		summary.mean[c] = 0.0;
+	}
+
+	if (rows->width == 0 || rows->height == 0) {
+		return summary;
+	}
+
+	workers = clamp_thread_count(num_threads);
+	if (workers > rows->height) {
+		workers = rows->height;
+	}
+
+	rows_per_worker = (rows->height + workers - 1) / workers;
+	partials.assign(workers, summary);
+
+	//
+	// Each worker reduces a band of rows. The mean is accumulated as a
+	// sum here and divided once everything is merged.
+	//
+
+	for (unsigned int w = 0; w < workers; w++) {
+		threads.emplace_back([rows, w, rows_per_worker, &partials]() {
+			channel_summary* part;
+			const float* element;
+			unsigned int first;
+			unsigned int last;
+
+			part = &partials[w];
+			first = w * rows_per_worker;
+			last = first + rows_per_worker;
+			if (last > rows->height) {
+				last = rows->height;
+			}
+
+			for (unsigned int row = first; row < last; row++) {
+				element = row_at(rows, row);
+
+				for (unsigned int col = 0; col < rows->width; col++) {
+					for (int c = 0; c < 4; c++) {
+						part->min[c] = fminf(part->min[c], element[c]);
+						part->max[c] = fmaxf(part->max[c], element[c]);
+						part->mean[c] += element[c];
+					}
+
+					element += 4;
+				}
+			}
+		});
+	}
+
+	for (thread& t : threads) {
+		t.join();
+	}
+
+	for (const channel_summary& part : partials) {
+		for (int c = 0; c < 4; c++) {
+			summary.min[c] = fminf(summary.min[c], part.min[c]);
+			summary.max[c] = fmaxf(summary.max[c], part.max[c]);
+			summary.mean[c] += part.mean[c];
+		}
+	}
+
+	count = (double)rows->width * rows->height;
+	for (int c = 0; c < 4; c++) {
+		summary.mean[c] /= count;
+	}
+
+	return summary;
+}
+
+void format_channel_summary(const channel_summary* summary, FILE* out) {
+	const char* names[] = { "x", "y", "z", "w" };
+
+	for (int c = 0; c < 4; c++) {
+		fprintf(
+			out,
+			"Channel %s: min %f, max %f, mean %f\n",
+			names[c],
+			summary->min[c],
+			summary->max[c],
+			summary->mean[c]
+		);
+	}
+
+	fflush(out);
+}
+
+/* BENCHMARK */
+
+static void print_elements_with_printf(const float4_rows* rows, FILE* out) {
+	const float* element;
+
+	for (unsigned int row = 0; row < rows->height; row++) {
+		element = row_at(rows, row);
+
+		for (unsigned int col = 0; col < rows->width; col++) {
+			fprintf(
+				out,
+				"Element (%u, %u): (%f, %f, %f, %f)\n",
+				row,
+				col,
+				element[0],
+				element[1],
+				element[2],
+				element[3]
+			);
+
+			element += 4;
+		}
+	}
+
+	fflush(out);
+}
+
+void benchmark_result_formatter(
+	const unsigned int num_threads,
+	FILE* sink,
+	FILE* report
+) {
+	const unsigned int sizes[] = { 256, 4096, 16384 };
+	vector<float> row;
+	float4_rows rows;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> printf_time;
+	chrono::duration<double> formatter_time;
+
+	fprintf(report, "size, printf_s, formatter_s, speedup\n");
+
+	for (unsigned int size : sizes) {
+		//
+		// A 16384^2 float4 image is 4 GB. The text only depends on the
+		// values, so every row points at the same UV gradient row.
+		//
+
+		row.resize((size_t)size * 4);
+		for (unsigned int col = 0; col < size; col++) {
+			row[col * 4 + 0] = (float)col / (float)(size - 1);
+			row[col * 4 + 1] = 0.5f;
+			row[col * 4 + 2] = 0.0f;
+			row[col * 4 + 3] = 1.0f;
+		}
+
+		rows.data = reinterpret_cast<const unsigned char*>(row.data());
+		rows.width = size;
+		rows.height = size;
+		rows.row_pitch = 0;
+
+		start = chrono::steady_clock::now();
+		print_elements_with_printf(&rows, sink);
+		printf_time = chrono::steady_clock::now() - start;
+
+		start = chrono::steady_clock::now();
+		format_all_elements(&rows, num_threads, sink);
+		formatter_time = chrono::steady_clock::now() - start;
+
+		fprintf(
+			report,
+			"%u^2, %.3f, %.3f, %.2fx\n",
+			size,
+			printf_time.count(),
+			formatter_time.count(),
+			printf_time.count() / formatter_time.count()
+		);
+		fflush(report);
+	}
+}
@@ -0,0 +1,76 @@
+// Liam Wynn, 12/05/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	Turning the readback buffer into text used to be one printf per
+	element, which at large sizes took longer than the GPU work. The
+	result formatter splits the rows between worker threads. Each
+	worker formats its rows into its own buffer with std::to_chars,
+	and the buffers are written out in row order with a handful of
+	large fwrite calls.
+
+	The text is byte-identical to the old
+
+		printf("Element (%u, %u): (%f, %f, %f, %f)\n", ...)
+
+	output. There is also a summary mode that prints the per-channel
+	min, max and mean instead of every element.
+
+	Like the CPU executor, none of this depends on Windows.
+*/
+
+#pragma once
+
+#include <cstdio>
+
+enum result_print_mode {
+	RESULT_PRINT_ALL,
+	RESULT_PRINT_SUMMARY
+};
+
+/*
+	A float4 image laid out like the readback footprint: height rows
+	of width float4 elements, row_pitch bytes apart.
+*/
+struct float4_rows {
+	const unsigned char* data;
+	unsigned int width;
+	unsigned int height;
+	unsigned int row_pitch;
+};
+
+struct channel_summary {
+	float min[4];
+	float max[4];
+	double mean[4];
+};
+
+void print_results(
+	const float4_rows* rows,
+	const result_print_mode mode,
+	const unsigned int num_threads,
+	FILE* out
+);
+
+void format_all_elements(
+	const float4_rows* rows,
+	const unsigned int num_threads,
+	FILE* out
+);
+
+channel_summary summarize_channels(
+	const float4_rows* rows,
+	const unsigned int num_threads
+);
+
+void format_channel_summary(const channel_summary* summary, FILE* out);
+
+/*
+	Times the old printf loop against format_all_elements at 256^2,
+	4096^2 and 16384^2, writing the text to sink. The report goes to
+	report.
+*/
+void benchmark_result_formatter(
+	const unsigned int num_threads,
+	FILE* sink,
+	FILE* report
+);
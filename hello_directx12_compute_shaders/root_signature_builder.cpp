@@ -0,0 +1,287 @@
+// Liam Wynn, 12/31/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "root_signature_builder.h"
+#include "dxil_container.h"
+#include "shader_cache.h"
+#include "utils.h"
+#include <d3d12shader.h>
+#include <iostream>
+
+using namespace std;
+
+/*
+	Sorts one reflected binding into the kinds and shapes the layout
+	code knows about. Returns false for anything a compute shader
+	shouldn't have.
+*/
+static bool classify_binding(
+	const D3D12_SHADER_INPUT_BIND_DESC* desc,
+	shader_binding* binding
+) {
+	switch (desc->Type) {
+	case D3D_SIT_CBUFFER:
+		binding->kind = SHADER_BINDING_CBV;
+		binding->shape = SHADER_RESOURCE_BUFFER;
+		return true;
+	case D3D_SIT_TBUFFER:
+		binding->kind = SHADER_BINDING_SRV;
+		binding->shape = SHADER_RESOURCE_TYPED_BUFFER;
+		return true;
+	case D3D_SIT_TEXTURE:
+		binding->kind = SHADER_BINDING_SRV;
+		binding->shape = desc->Dimension == D3D_SRV_DIMENSION_BUFFER ? SHADER_RESOURCE_TYPED_BUFFER : SHADER_RESOURCE_TEXTURE;
+		return true;
+	case D3D_SIT_STRUCTURED:
+	case D3D_SIT_BYTEADDRESS:
+		binding->kind = SHADER_BINDING_SRV;
+		binding->shape = SHADER_RESOURCE_BUFFER;
+		return true;
+	case D3D_SIT_UAV_RWTYPED:
+		binding->kind = SHADER_BINDING_UAV;
+		binding->shape = desc->Dimension == D3D_SRV_DIMENSION_BUFFER ? SHADER_RESOURCE_TYPED_BUFFER : SHADER_RESOURCE_TEXTURE;
+		return true;
+	case D3D_SIT_UAV_RWSTRUCTURED:
+	case D3D_SIT_UAV_RWBYTEADDRESS:
+		binding->kind = SHADER_BINDING_UAV;
+		binding->shape = SHADER_RESOURCE_BUFFER;
+		return true;
+	case D3D_SIT_UAV_APPEND_STRUCTURED:
+	case D3D_SIT_UAV_CONSUME_STRUCTURED:
+	case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+		binding->kind = SHADER_BINDING_UAV;
+		binding->shape = SHADER_RESOURCE_COUNTER_BUFFER;
+		return true;
+	case D3D_SIT_SAMPLER:
+		binding->kind = SHADER_BINDING_SAMPLER;
+		binding->shape = SHADER_RESOURCE_TEXTURE;
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool reflect_compute_shader(
+	const vector<unsigned char>& bytecode,
+	shader_reflection* reflection
+) {
+	ComPtr<ID3D12ShaderReflection> reflector;
+	D3D12_SHADER_DESC shader_desc;
+	D3D12_SHADER_INPUT_BIND_DESC bind_desc;
+	D3D12_SHADER_BUFFER_DESC buffer_desc;
+	ID3D12ShaderReflectionConstantBuffer* constant_buffer;
+	dxil_shader_info dxil_info;
+	string error;
+	HRESULT result;
+
+	if (is_dxil_container(bytecode.data(), bytecode.size())) {
+		if (!read_dxil_shader(bytecode.data(), bytecode.size(), &dxil_info, &error) || !dxil_info.has_reflection) {
+			cerr << "Can't reflect DXIL: " << (error.empty() ? "its PSV0 has no numthreads" : error) << endl;
+			return false;
+		}
+
+		*reflection = dxil_info.reflection;
+		return true;
+	}
+
+	result = D3DReflect(bytecode.data(), bytecode.size(), IID_PPV_ARGS(&reflector));
+	if (FAILED(result)) {
+		return false;
+	}
+
+	throw_if_failed(reflector->GetDesc(&shader_desc));
+
+	reflector->GetThreadGroupSize(
+		&reflection->group_size[0],
+		&reflection->group_size[1],
+		&reflection->group_size[2]
+	);
+
+	reflection->bindings.clear();
+
+	for (UINT i = 0; i < shader_desc.BoundResources; i++) {
+		shader_binding binding;
+
+		throw_if_failed(reflector->GetResourceBindingDesc(i, &bind_desc));
+
+		if (!classify_binding(&bind_desc, &binding)) {
+			cerr << "Don't know how to bind " << bind_desc.Name << endl;
+			return false;
+		}
+
+		binding.name = bind_desc.Name;
+		binding.shader_register = bind_desc.BindPoint;
+		binding.space = bind_desc.Space;
+		binding.size_in_bytes = 0;
+
+		// Unbounded arrays are reported with a count of 0 or UINT_MAX.
+		binding.count = bind_desc.BindCount == UINT_MAX ? 0 : bind_desc.BindCount;
+
+		if (binding.kind == SHADER_BINDING_CBV) {
+			constant_buffer = reflector->GetConstantBufferByName(bind_desc.Name);
+
+			if (SUCCEEDED(constant_buffer->GetDesc(&buffer_desc))) {
+				binding.size_in_bytes = buffer_desc.Size;
+			}
+		}
+
+		reflection->bindings.push_back(binding);
+	}
+
+	return true;
+}
+
+void initialize_root_signature_cache(root_signature_cache* cache) {
+	cache->signatures.clear();
+	cache->hits = 0;
+	cache->misses = 0;
+}
+
+static D3D12_DESCRIPTOR_RANGE_TYPE range_type(const shader_binding_kind kind) {
+	switch (kind) {
+	case SHADER_BINDING_CBV:
+		return D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+	case SHADER_BINDING_SRV:
+		return D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	case SHADER_BINDING_UAV:
+		return D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+	default:
+		return D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
+	}
+}
+
+ComPtr<ID3D12RootSignature> get_root_signature(
+	root_signature_cache* cache,
+	dx12_handler* dx12,
+	const root_layout* layout,
+	uint64_t* hash
+) {
+	map<string, cached_root_signature>::iterator found;
+	vector<CD3DX12_ROOT_PARAMETER1> parameters;
+	vector<vector<CD3DX12_DESCRIPTOR_RANGE1>> ranges;
+	D3D12_FEATURE_DATA_ROOT_SIGNATURE feature_data;
+	CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC root_signature_desc;
+	ComPtr<ID3DBlob> root_signature_blob;
+	ComPtr<ID3DBlob> err_blob;
+	cached_root_signature cached;
+	HRESULT result;
+
+	found = cache->signatures.find(layout->canonical);
+
+	if (found != cache->signatures.end()) {
+		cache->hits++;
+		*hash = found->second.hash;
+		return found->second.root_signature;
+	}
+
+	cache->misses++;
+
+	//
+	// The ranges have to stay put until the signature is serialized,
+	// so size the outer vector up front.
+	//
+
+	ranges.resize(layout->parameters.size());
+	parameters.resize(layout->parameters.size());
+
+	for (size_t p = 0; p < layout->parameters.size(); p++) {
+		const root_layout_parameter* param = &layout->parameters[p];
+
+		switch (param->kind) {
+		case ROOT_PARAMETER_CONSTANTS:
+			parameters[p].InitAsConstants(param->num_32bit_values, param->shader_register, param->space);
+			break;
+		case ROOT_PARAMETER_CBV:
+			parameters[p].InitAsConstantBufferView(param->shader_register, param->space);
+			break;
+		case ROOT_PARAMETER_SRV:
+			parameters[p].InitAsShaderResourceView(param->shader_register, param->space);
+			break;
+		case ROOT_PARAMETER_UAV:
+			parameters[p].InitAsUnorderedAccessView(param->shader_register, param->space);
+			break;
+		case ROOT_PARAMETER_TABLE:
+			for (const root_layout_range& r : param->ranges) {
+				CD3DX12_DESCRIPTOR_RANGE1 range;
+
+				//
+				// Unbounded arrays are bindless tables, which get filled
+				// in after the table is bound.
+				//
+
+				range.Init(
+					range_type(r.kind),
+					r.count == 0 ? UINT_MAX : r.count,
+					r.base_register,
+					r.space,
+					r.count == 0 ? D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE : D3D12_DESCRIPTOR_RANGE_FLAG_NONE,
+					r.offset
+				);
+
+				ranges[p].push_back(range);
+			}
+
+			parameters[p].InitAsDescriptorTable((UINT)ranges[p].size(), ranges[p].data());
+			break;
+		}
+	}
+
+	//
+	// Attempt to get version 1.1 support. Fall back on 1.0 if that
+	// fails.
+	//
+
+	feature_data.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+	result = dx12->device->CheckFeatureSupport(
+		D3D12_FEATURE_ROOT_SIGNATURE,
+		&feature_data,
+		sizeof(feature_data)
+	);
+
+	if (result != S_OK) {
+		feature_data.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+	}
+
+	root_signature_desc.Init_1_1(
+		(UINT)parameters.size(),
+		parameters.data(),
+		0,
+		NULL,
+		D3D12_ROOT_SIGNATURE_FLAG_NONE
+	);
+
+	result = D3DX12SerializeVersionedRootSignature(
+		&root_signature_desc,
+		feature_data.HighestVersion,
+		&root_signature_blob,
+		&err_blob
+	);
+
+	if (err_blob != NULL) {
+		cerr << "Failed to load root signature: " << (char*)err_blob->GetBufferPointer() << endl;
+		throw_if_failed(result);
+	}
+
+	result = dx12->device->CreateRootSignature(
+		0,
+		root_signature_blob->GetBufferPointer(),
+		root_signature_blob->GetBufferSize(),
+		IID_PPV_ARGS(&cached.root_signature)
+	);
+
+	throw_if_failed(result);
+
+	cached.hash = hash_bytes(
+		root_signature_blob->GetBufferPointer(),
+		root_signature_blob->GetBufferSize(),
+		0
+	);
+
+	cache->signatures[layout->canonical] = cached;
+	*hash = cached.hash;
+
+	return cached.root_signature;
+}
+
+void shutdown_root_signature_cache(root_signature_cache* cache) {
+	cache->signatures.clear();
+}
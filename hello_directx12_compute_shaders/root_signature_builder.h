@@ -0,0 +1,55 @@
+// Liam Wynn, 12/31/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The DirectX half of shader layouts (see shader_layout.h).
+
+	reflect_compute_shader runs D3DReflect over compiled bytecode and
+	fills in a shader_reflection. get_root_signature turns a root_layout
+	into an ID3D12RootSignature.
+
+	D3DReflect only reads FXC's bytecode. DXIL is reflected from its
+	PSV0 part instead (see dxil_container.h).
+
+	Root signatures are cached by the layout's canonical text. Kernels
+	whose layouts come out the same share one root signature object,
+	and so share one pipeline cache key.
+*/
+
+#pragma once
+
+#include "stdafx.h"
+#include "dx12_handler.h"
+#include "shader_layout.h"
+#include <map>
+#include <string>
+#include <vector>
+
+struct cached_root_signature {
+	ComPtr<ID3D12RootSignature> root_signature;
+
+	// Hash of the serialized root signature.
+	uint64_t hash;
+};
+
+struct root_signature_cache {
+	std::map<std::string, cached_root_signature> signatures;
+
+	unsigned int hits;
+	unsigned int misses;
+};
+
+bool reflect_compute_shader(
+	const std::vector<unsigned char>& bytecode,
+	shader_reflection* reflection
+);
+
+void initialize_root_signature_cache(root_signature_cache* cache);
+
+ComPtr<ID3D12RootSignature> get_root_signature(
+	root_signature_cache* cache,
+	dx12_handler* dx12,
+	const root_layout* layout,
+	uint64_t* hash
+);
+
+void shutdown_root_signature_cache(root_signature_cache* cache);
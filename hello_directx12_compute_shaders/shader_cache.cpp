@@ -0,0 +1,354 @@
+// Liam Wynn, 12/19/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "shader_cache.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+const uint32_t SHADER_CACHE_MAGIC = 0x48534843; // "CHSH"
+const char* SHADER_CACHE_EXTENSION = ".cso";
+
+struct shader_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t hash;
+	uint64_t size;
+};
+
+/* HASHING */
+
+uint64_t hash_bytes(const void* data, const size_t size, const uint64_t seed) {
+	const unsigned char* bytes;
+	uint64_t hash;
+
+	//
+	// 64-bit FNV-1a. Not cryptographic, but plenty to tell shader
+	// builds apart.
+	//
+
+	bytes = reinterpret_cast<const unsigned char*>(data);
+	hash = seed ^ 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+uint64_t hash_string(const string& text, const uint64_t seed) {
+	uint64_t hash;
+	uint64_t length;
+
+	//
+	// Mix in the length too, so ("ab", "c") and ("a", "bc") differ.
+	//
+
+	length = text.size();
+	hash = hash_bytes(&length, sizeof(length), seed);
+
+	return hash_bytes(text.data(), text.size(), hash);
+}
+
+string hash_to_name(const uint64_t hash) {
+	const char* digits = "0123456789abcdef";
+	string name(16, '0');
+
+	for (int i = 0; i < 16; i++) {
+		name[15 - i] = digits[(hash >> (i * 4)) & 0xF];
+	}
+
+	return name;
+}
+
+static bool read_text_file(const string& path, string* contents) {
+	ifstream file(path, ios::binary);
+	stringstream stream;
+
+	if (!file) {
+		return false;
+	}
+
+	stream << file.rdbuf();
+	*contents = stream.str();
+
+	return true;
+}
+
+bool collect_shader_sources(
+	const string& source_path,
+	vector<pair<string, string>>* sources
+) {
+	vector<string> pending;
+	string path;
+	string contents;
+	string line;
+	size_t open_quote;
+	size_t close_quote;
+
+	pending.push_back(source_path);
+
+	while (!pending.empty()) {
+		path = pending.back();
+		pending.pop_back();
+
+		//
+		// Each file only counts once, even if it's included twice.
+		//
+
+		bool seen = false;
+		for (const pair<string, string>& source : *sources) {
+			if (source.first == path) {
+				seen = true;
+				break;
+			}
+		}
+
+		if (seen) {
+			continue;
+		}
+
+		if (!read_text_file(path, &contents)) {
+			if (path == source_path) {
+				return false;
+			}
+
+			sources->push_back(make_pair(path, string("<missing>")));
+			continue;
+		}
+
+		sources->push_back(make_pair(path, contents));
+
+		//
+		// Queue up every #include "file" relative to this file.
+		//
+
+		istringstream lines(contents);
+		while (getline(lines, line)) {
+			size_t first = line.find_first_not_of(" \t");
+
+			if (first == string::npos || line.compare(first, 8, "#include") != 0) {
+				continue;
+			}
+
+			open_quote = line.find('"', first + 8);
+			if (open_quote == string::npos) {
+				continue;
+			}
+
+			close_quote = line.find('"', open_quote + 1);
+			if (close_quote == string::npos) {
+				continue;
+			}
+
+			fs::path included = fs::path(path).parent_path()
+				/ line.substr(open_quote + 1, close_quote - open_quote - 1);
+
+			pending.push_back(included.lexically_normal().generic_string());
+		}
+	}
+
+	return true;
+}
+
+bool make_shader_cache_key(
+	const string& source_path,
+	const shader_defines& defines,
+	const string& entry_point,
+	const string& profile,
+	const uint32_t compile_flags,
+	shader_cache_key* key
+) {
+	vector<pair<string, string>> sources;
+	uint64_t hash;
+
+	if (!collect_shader_sources(source_path, &sources)) {
+		return false;
+	}
+
+	hash = hash_bytes(&SHADER_CACHE_VERSION, sizeof(SHADER_CACHE_VERSION), 0);
+
+	//
+	// Sort the includes by name so the order we happened to find them
+	// in doesn't matter. The root source always goes first.
+	//
+
+	sort(sources.begin() + 1, sources.end());
+
+	for (const pair<string, string>& source : sources) {
+		hash = hash_string(source.first, hash);
+		hash = hash_string(source.second, hash);
+	}
+
+	for (const pair<string, string>& define : defines) {
+		hash = hash_string(define.first, hash);
+		hash = hash_string(define.second, hash);
+	}
+
+	hash = hash_string(entry_point, hash);
+	hash = hash_string(profile, hash);
+	hash = hash_bytes(&compile_flags, sizeof(compile_flags), hash);
+
+	key->hash = hash;
+	key->name = hash_to_name(hash);
+
+	return true;
+}
+
+/* CACHE */
+
+static string entry_path(const shader_cache* cache, const shader_cache_key* key) {
+	return (fs::path(cache->directory) / (key->name + SHADER_CACHE_EXTENSION)).string();
+}
+
+void initialize_shader_cache(shader_cache* cache, const string& directory) {
+	error_code err;
+
+	cache->directory = directory;
+	cache->hits = 0;
+	cache->misses = 0;
+	cache->used.clear();
+
+	// If this fails, every store fails too and we just always compile.
+	fs::create_directories(directory, err);
+}
+
+bool load_cached_shader(
+	shader_cache* cache,
+	const shader_cache_key* key,
+	vector<unsigned char>* bytecode
+) {
+	shader_cache_header header;
+
+	cache->used.push_back(key->name);
+
+	ifstream file(entry_path(cache, key), ios::binary);
+
+	if (file) {
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	}
+
+	//
+	// Anything that doesn't look exactly like what we would have
+	// written counts as a miss.
+	//
+
+	if (!file
+		|| header.magic != SHADER_CACHE_MAGIC
+		|| header.version != SHADER_CACHE_VERSION
+		|| header.hash != key->hash
+		|| header.size == 0) {
+		cache->misses++;
+		return false;
+	}
+
+	bytecode->resize((size_t)header.size);
+	file.read(reinterpret_cast<char*>(bytecode->data()), (streamsize)header.size);
+
+	if ((uint64_t)file.gcount() != header.size) {
+		bytecode->clear();
+		cache->misses++;
+		return false;
+	}
+
+	cache->hits++;
+
+	return true;
+}
+
+bool store_cached_shader(
+	shader_cache* cache,
+	const shader_cache_key* key,
+	const void* bytecode,
+	const size_t size
+) {
+	shader_cache_header header;
+	string path;
+	string temp_path;
+	error_code err;
+
+	path = entry_path(cache, key);
+	temp_path = path + ".tmp";
+
+	header.magic = SHADER_CACHE_MAGIC;
+	header.version = SHADER_CACHE_VERSION;
+	header.hash = key->hash;
+	header.size = size;
+
+	//
+	// Write to a temporary file and rename it into place, so another
+	// process never sees half an entry.
+	//
+
+	{
+		ofstream file(temp_path, ios::binary | ios::trunc);
+
+		if (!file) {
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(bytecode), (streamsize)size);
+
+		//
+		// A full disk can fail the last write only when it is flushed.
+		//
+
+		file.close();
+
+		if (!file.good()) {
+			fs::remove(temp_path, err);
+			return false;
+		}
+	}
+
+	fs::rename(temp_path, path, err);
+
+	if (err) {
+		fs::remove(temp_path, err);
+		return false;
+	}
+
+	return true;
+}
+
+unsigned int prune_shader_cache(shader_cache* cache) {
+	unsigned int removed;
+	error_code err;
+
+	removed = 0;
+
+	for (const fs::directory_entry& entry : fs::directory_iterator(cache->directory, err)) {
+		string name;
+
+		if (entry.path().extension() != SHADER_CACHE_EXTENSION) {
+			continue;
+		}
+
+		name = entry.path().stem().string();
+
+		if (find(cache->used.begin(), cache->used.end(), name) != cache->used.end()) {
+			continue;
+		}
+
+		if (fs::remove(entry.path(), err)) {
+			removed++;
+		}
+	}
+
+	return removed;
+}
+
+void clear_shader_cache(shader_cache* cache) {
+	error_code err;
+
+	for (const fs::directory_entry& entry : fs::directory_iterator(cache->directory, err)) {
+		fs::remove(entry.path(), err);
+	}
+}
@@ -0,0 +1,97 @@
+// Liam Wynn, 12/19/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The shader cache keeps compiled shader bytecode on disk so we only
+	pay for D3DCompileFromFile the first time a kernel is built.
+
+	Entries are keyed by a hash of everything that affects the output:
+	the source, every file it includes (recursively), the defines, the
+	entry point, the target profile, the compile flags and the cache
+	format version. Change any of those and the key changes, so a stale
+	entry is simply never looked up again. prune_shader_cache removes
+	entries nobody asked for.
+
+	Each entry is one file named after its key. The file starts with a
+	small header (magic, version, full key, payload size) that is checked
+	on load, so a truncated or foreign file counts as a miss.
+
+	This part doesn't touch DirectX. pipeline_cache puts it together
+	with the compiler and the ID3D12PipelineLibrary.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Bump this whenever the file format or the compiler changes in a way
+// the key can't see. Every existing entry becomes a miss.
+const uint32_t SHADER_CACHE_VERSION = 1;
+
+typedef std::vector<std::pair<std::string, std::string>> shader_defines;
+
+struct shader_cache_key {
+	uint64_t hash;
+
+	// hash as 16 hex digits. Also the entry's file name.
+	std::string name;
+};
+
+struct shader_cache {
+	std::string directory;
+
+	unsigned int hits;
+	unsigned int misses;
+
+	// Keys looked up this run. Used by prune_shader_cache.
+	std::vector<std::string> used;
+};
+
+/* HASHING */
+uint64_t hash_bytes(const void* data, const size_t size, const uint64_t seed);
+uint64_t hash_string(const std::string& text, const uint64_t seed);
+std::string hash_to_name(const uint64_t hash);
+
+/*
+	Reads source_path and every file it pulls in through
+	#include "..." (relative to the including file). Returns false if
+	source_path can't be read. Missing includes are hashed as missing,
+	so creating one later still changes the key.
+*/
+bool collect_shader_sources(
+	const std::string& source_path,
+	std::vector<std::pair<std::string, std::string>>* sources
+);
+
+bool make_shader_cache_key(
+	const std::string& source_path,
+	const shader_defines& defines,
+	const std::string& entry_point,
+	const std::string& profile,
+	const uint32_t compile_flags,
+	shader_cache_key* key
+);
+
+/* CACHE */
+void initialize_shader_cache(shader_cache* cache, const std::string& directory);
+
+bool load_cached_shader(
+	shader_cache* cache,
+	const shader_cache_key* key,
+	std::vector<unsigned char>* bytecode
+);
+
+bool store_cached_shader(
+	shader_cache* cache,
+	const shader_cache_key* key,
+	const void* bytecode,
+	const size_t size
+);
+
+// Deletes entries that weren't looked up this run. Returns how many.
+unsigned int prune_shader_cache(shader_cache* cache);
+
+// Deletes every entry. Used to force a cold start.
+void clear_shader_cache(shader_cache* cache);
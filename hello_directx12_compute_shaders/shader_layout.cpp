@@ -0,0 +1,548 @@
+// Liam Wynn, 12/31/2024, Hello DirectX 12: Compute Shader Edition
+
+#include "shader_layout.h"
+#include "shader_cache.h"
+#include <algorithm>
+#include <sstream>
+
+using namespace std;
+
+/*
+	Where build_root_layout puts one binding.
+*/
+enum binding_placement {
+	PLACE_CONSTANTS,
+	PLACE_ROOT_DESCRIPTOR,
+	PLACE_TABLE,
+	PLACE_SAMPLER_TABLE
+};
+
+/* NAMES */
+
+const char* shader_binding_kind_name(const shader_binding_kind kind) {
+	switch (kind) {
+	case SHADER_BINDING_CBV:
+		return "cbv";
+	case SHADER_BINDING_SRV:
+		return "srv";
+	case SHADER_BINDING_UAV:
+		return "uav";
+	case SHADER_BINDING_SAMPLER:
+		return "sampler";
+	default:
+		return "unknown";
+	}
+}
+
+const char* shader_resource_shape_name(const shader_resource_shape shape) {
+	switch (shape) {
+	case SHADER_RESOURCE_TEXTURE:
+		return "texture";
+	case SHADER_RESOURCE_TYPED_BUFFER:
+		return "typed_buffer";
+	case SHADER_RESOURCE_BUFFER:
+		return "buffer";
+	case SHADER_RESOURCE_COUNTER_BUFFER:
+		return "counter_buffer";
+	default:
+		return "unknown";
+	}
+}
+
+// The letter HLSL puts in front of the register number.
+static char register_prefix(const shader_binding_kind kind) {
+	switch (kind) {
+	case SHADER_BINDING_CBV:
+		return 'b';
+	case SHADER_BINDING_SRV:
+		return 't';
+	case SHADER_BINDING_UAV:
+		return 'u';
+	default:
+		return 's';
+	}
+}
+
+/* SERIALIZATION */
+
+bool parse_shader_reflection(const string& text, shader_reflection* reflection) {
+	istringstream lines(text);
+	string line;
+	bool found_group_size;
+
+	reflection->group_size[0] = 1;
+	reflection->group_size[1] = 1;
+	reflection->group_size[2] = 1;
+	reflection->bindings.clear();
+	found_group_size = false;
+
+	while (getline(lines, line)) {
+		istringstream words(line);
+		string first;
+		string kind;
+		string shape;
+		shader_binding binding;
+		bool known;
+
+		if (!(words >> first) || first[0] == '#') {
+			continue;
+		}
+
+		if (first == "numthreads") {
+			if (!(words >> reflection->group_size[0] >> reflection->group_size[1] >> reflection->group_size[2])) {
+				return false;
+			}
+
+			found_group_size = true;
+			continue;
+		}
+
+		//
+		// Anything else is a binding.
+		//
+
+		kind = first;
+
+		if (!(words >> shape >> binding.shader_register >> binding.space >> binding.count >> binding.size_in_bytes)) {
+			return false;
+		}
+
+		// The name is optional.
+		words >> binding.name;
+
+		known = false;
+
+		for (int k = SHADER_BINDING_CBV; k <= SHADER_BINDING_SAMPLER; k++) {
+			if (kind == shader_binding_kind_name((shader_binding_kind)k)) {
+				binding.kind = (shader_binding_kind)k;
+				known = true;
+			}
+		}
+
+		if (!known) {
+			return false;
+		}
+
+		known = false;
+
+		for (int s = SHADER_RESOURCE_TEXTURE; s <= SHADER_RESOURCE_COUNTER_BUFFER; s++) {
+			if (shape == shader_resource_shape_name((shader_resource_shape)s)) {
+				binding.shape = (shader_resource_shape)s;
+				known = true;
+			}
+		}
+
+		if (!known) {
+			return false;
+		}
+
+		reflection->bindings.push_back(binding);
+	}
+
+	return found_group_size;
+}
+
+string write_shader_reflection(const shader_reflection* reflection) {
+	ostringstream out;
+
+	out << "numthreads " << reflection->group_size[0] << " "
+		<< reflection->group_size[1] << " " << reflection->group_size[2] << "\n";
+
+	for (const shader_binding& b : reflection->bindings) {
+		out << shader_binding_kind_name(b.kind) << " "
+			<< shader_resource_shape_name(b.shape) << " "
+			<< b.shader_register << " " << b.space << " " << b.count << " "
+			<< b.size_in_bytes;
+
+		if (!b.name.empty()) {
+			out << " " << b.name;
+		}
+
+		out << "\n";
+	}
+
+	return out.str();
+}
+
+/* LAYOUT */
+
+static unsigned int constant_dwords(const shader_binding* binding) {
+	return (binding->size_in_bytes + 3) / 4;
+}
+
+static binding_placement cheapest_placement(const shader_binding* binding) {
+	if (binding->kind == SHADER_BINDING_SAMPLER) {
+		return PLACE_SAMPLER_TABLE;
+	}
+
+	if (binding->count != 1) {
+		return PLACE_TABLE;
+	}
+
+	if (binding->kind == SHADER_BINDING_CBV) {
+		if (binding->size_in_bytes > 0 && constant_dwords(binding) <= ROOT_CONSTANTS_MAX_DWORDS) {
+			return PLACE_CONSTANTS;
+		}
+
+		return PLACE_ROOT_DESCRIPTOR;
+	}
+
+	if (binding->shape == SHADER_RESOURCE_BUFFER) {
+		return PLACE_ROOT_DESCRIPTOR;
+	}
+
+	return PLACE_TABLE;
+}
+
+/*
+	How many DWORDs the root signature takes with these placements.
+	Every unbounded array gets its own table.
+*/
+static unsigned int layout_cost(
+	const vector<shader_binding>& bindings,
+	const vector<binding_placement>& placements
+) {
+	unsigned int cost;
+	bool table;
+	bool sampler_table;
+
+	cost = 0;
+	table = false;
+	sampler_table = false;
+
+	for (size_t i = 0; i < bindings.size(); i++) {
+		switch (placements[i]) {
+		case PLACE_CONSTANTS:
+			cost += constant_dwords(&bindings[i]);
+			break;
+		case PLACE_ROOT_DESCRIPTOR:
+			cost += 2;
+			break;
+		case PLACE_TABLE:
+			if (bindings[i].count == 0) {
+				cost += 1;
+			}
+			else {
+				table = true;
+			}
+			break;
+		case PLACE_SAMPLER_TABLE:
+			if (bindings[i].count == 0) {
+				cost += 1;
+			}
+			else {
+				sampler_table = true;
+			}
+			break;
+		}
+	}
+
+	return cost + (table ? 1 : 0) + (sampler_table ? 1 : 0);
+}
+
+/*
+	Moves one binding to a more expensive kind of parameter that takes
+	less root space. Returns false if there is nothing left to move.
+*/
+static bool demote_one_binding(
+	const vector<shader_binding>& bindings,
+	vector<binding_placement>* placements
+) {
+	size_t largest;
+	unsigned int largest_dwords;
+
+	//
+	// First the biggest root constants that are bigger than a root
+	// descriptor.
+	//
+
+	largest = bindings.size();
+	largest_dwords = 2;
+
+	for (size_t i = 0; i < bindings.size(); i++) {
+		if ((*placements)[i] == PLACE_CONSTANTS && constant_dwords(&bindings[i]) > largest_dwords) {
+			largest = i;
+			largest_dwords = constant_dwords(&bindings[i]);
+		}
+	}
+
+	if (largest < bindings.size()) {
+		(*placements)[largest] = PLACE_ROOT_DESCRIPTOR;
+		return true;
+	}
+
+	//
+	// Then root descriptors into the table, last register first.
+	//
+
+	for (size_t i = bindings.size(); i > 0; i--) {
+		if ((*placements)[i - 1] == PLACE_ROOT_DESCRIPTOR) {
+			(*placements)[i - 1] = PLACE_TABLE;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool binding_order(const shader_binding& a, const shader_binding& b) {
+	if (a.kind != b.kind) {
+		return a.kind < b.kind;
+	}
+
+	if (a.space != b.space) {
+		return a.space < b.space;
+	}
+
+	return a.shader_register < b.shader_register;
+}
+
+/*
+	Adds binding to the end of table, merging it into the last range if
+	it continues it.
+*/
+static void append_table_range(root_layout_parameter* table, const shader_binding* binding) {
+	root_layout_range range;
+	unsigned int offset;
+
+	if (!table->ranges.empty()) {
+		root_layout_range* last = &table->ranges.back();
+
+		if (last->kind == binding->kind
+			&& last->space == binding->space
+			&& last->count != 0
+			&& binding->count != 0
+			&& last->base_register + last->count == binding->shader_register) {
+			last->count += binding->count;
+			return;
+		}
+
+		offset = last->offset + last->count;
+	}
+	else {
+		offset = 0;
+	}
+
+	range.kind = binding->kind;
+	range.base_register = binding->shader_register;
+	range.space = binding->space;
+	range.count = binding->count;
+	range.offset = offset;
+
+	table->ranges.push_back(range);
+}
+
+static root_layout_parameter empty_parameter(const root_parameter_kind kind) {
+	root_layout_parameter parameter;
+
+	parameter.kind = kind;
+	parameter.shader_register = 0;
+	parameter.space = 0;
+	parameter.num_32bit_values = 0;
+
+	return parameter;
+}
+
+static string canonical_layout(const root_layout* layout) {
+	ostringstream out;
+
+	for (const root_layout_parameter& p : layout->parameters) {
+		switch (p.kind) {
+		case ROOT_PARAMETER_CONSTANTS:
+			out << "constants b" << p.shader_register << " space" << p.space << " " << p.num_32bit_values;
+			break;
+		case ROOT_PARAMETER_CBV:
+			out << "cbv b" << p.shader_register << " space" << p.space;
+			break;
+		case ROOT_PARAMETER_SRV:
+			out << "srv t" << p.shader_register << " space" << p.space;
+			break;
+		case ROOT_PARAMETER_UAV:
+			out << "uav u" << p.shader_register << " space" << p.space;
+			break;
+		case ROOT_PARAMETER_TABLE:
+			out << "table";
+
+			for (const root_layout_range& r : p.ranges) {
+				out << " " << shader_binding_kind_name(r.kind) << " "
+					<< register_prefix(r.kind) << r.base_register
+					<< " space" << r.space << " x" << r.count << " @" << r.offset;
+			}
+			break;
+		}
+
+		out << "\n";
+	}
+
+	return out.str();
+}
+
+bool build_root_layout(const shader_reflection* reflection, root_layout* layout) {
+	vector<shader_binding> bindings;
+	vector<binding_placement> placements;
+	root_layout_parameter table;
+	root_layout_parameter sampler_table;
+	root_layout_parameter parameter;
+
+	layout->parameters.clear();
+
+	bindings = reflection->bindings;
+	sort(bindings.begin(), bindings.end(), binding_order);
+
+	for (const shader_binding& b : bindings) {
+		placements.push_back(cheapest_placement(&b));
+	}
+
+	while (layout_cost(bindings, placements) > ROOT_SIGNATURE_MAX_DWORDS) {
+		if (!demote_one_binding(bindings, &placements)) {
+			return false;
+		}
+	}
+
+	//
+	// Root constants first, then root descriptors by kind, then the
+	// tables. Within each group bindings stay in register order, so the
+	// same bindings always give the same layout.
+	//
+
+	for (size_t i = 0; i < bindings.size(); i++) {
+		if (placements[i] != PLACE_CONSTANTS) {
+			continue;
+		}
+
+		parameter = empty_parameter(ROOT_PARAMETER_CONSTANTS);
+		parameter.shader_register = bindings[i].shader_register;
+		parameter.space = bindings[i].space;
+		parameter.num_32bit_values = constant_dwords(&bindings[i]);
+		layout->parameters.push_back(parameter);
+	}
+
+	for (size_t i = 0; i < bindings.size(); i++) {
+		if (placements[i] != PLACE_ROOT_DESCRIPTOR) {
+			continue;
+		}
+
+		switch (bindings[i].kind) {
+		case SHADER_BINDING_CBV:
+			parameter = empty_parameter(ROOT_PARAMETER_CBV);
+			break;
+		case SHADER_BINDING_SRV:
+			parameter = empty_parameter(ROOT_PARAMETER_SRV);
+			break;
+		default:
+			parameter = empty_parameter(ROOT_PARAMETER_UAV);
+			break;
+		}
+
+		parameter.shader_register = bindings[i].shader_register;
+		parameter.space = bindings[i].space;
+		layout->parameters.push_back(parameter);
+	}
+
+	//
+	// Unbounded arrays can only be the last range of a table, so each
+	// one gets a table of its own after the shared ones.
+	//
+
+	table = empty_parameter(ROOT_PARAMETER_TABLE);
+	sampler_table = empty_parameter(ROOT_PARAMETER_TABLE);
+
+	for (size_t i = 0; i < bindings.size(); i++) {
+		if (placements[i] == PLACE_TABLE && bindings[i].count != 0) {
+			append_table_range(&table, &bindings[i]);
+		}
+		else if (placements[i] == PLACE_SAMPLER_TABLE && bindings[i].count != 0) {
+			append_table_range(&sampler_table, &bindings[i]);
+		}
+	}
+
+	if (!table.ranges.empty()) {
+		layout->parameters.push_back(table);
+	}
+
+	if (!sampler_table.ranges.empty()) {
+		layout->parameters.push_back(sampler_table);
+	}
+
+	for (size_t i = 0; i < bindings.size(); i++) {
+		if ((placements[i] == PLACE_TABLE || placements[i] == PLACE_SAMPLER_TABLE) && bindings[i].count == 0) {
+			parameter = empty_parameter(ROOT_PARAMETER_TABLE);
+			append_table_range(&parameter, &bindings[i]);
+			layout->parameters.push_back(parameter);
+		}
+	}
+
+	layout->size_in_dwords = layout_cost(bindings, placements);
+	layout->canonical = canonical_layout(layout);
+	layout->hash = hash_string(layout->canonical, 0);
+
+	return true;
+}
+
+bool find_root_binding(
+	const root_layout* layout,
+	const shader_binding_kind kind,
+	const unsigned int shader_register,
+	const unsigned int space,
+	unsigned int* parameter,
+	unsigned int* table_offset
+) {
+	for (size_t p = 0; p < layout->parameters.size(); p++) {
+		const root_layout_parameter* param = &layout->parameters[p];
+		root_parameter_kind root_kind;
+
+		*parameter = (unsigned int)p;
+		*table_offset = 0;
+
+		if (param->kind == ROOT_PARAMETER_TABLE) {
+			for (const root_layout_range& r : param->ranges) {
+				if (r.kind == kind
+					&& r.space == space
+					&& shader_register >= r.base_register
+					&& (r.count == 0 || shader_register < r.base_register + r.count)) {
+					*table_offset = r.offset + (shader_register - r.base_register);
+					return true;
+				}
+			}
+
+			continue;
+		}
+
+		switch (kind) {
+		case SHADER_BINDING_CBV:
+			root_kind = param->kind == ROOT_PARAMETER_CONSTANTS ? ROOT_PARAMETER_CONSTANTS : ROOT_PARAMETER_CBV;
+			break;
+		case SHADER_BINDING_SRV:
+			root_kind = ROOT_PARAMETER_SRV;
+			break;
+		case SHADER_BINDING_UAV:
+			root_kind = ROOT_PARAMETER_UAV;
+			break;
+		default:
+			continue;
+		}
+
+		if (param->kind == root_kind && param->shader_register == shader_register && param->space == space) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* DISPATCH */
+
+dispatch_group_count dispatch_size_for(
+	const shader_reflection* reflection,
+	const unsigned int width,
+	const unsigned int height,
+	const unsigned int depth
+) {
+	dispatch_group_count count;
+
+	count.x = (width + reflection->group_size[0] - 1) / reflection->group_size[0];
+	count.y = (height + reflection->group_size[1] - 1) / reflection->group_size[1];
+	count.z = (depth + reflection->group_size[2] - 1) / reflection->group_size[2];
+
+	return count;
+}
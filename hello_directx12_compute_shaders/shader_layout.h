@@ -0,0 +1,166 @@
+// Liam Wynn, 12/31/2024, Hello DirectX 12: Compute Shader Edition
+
+/*
+	Shader layouts turn what a kernel declares (its numthreads and the
+	resources it binds) into the smallest root signature that fits it,
+	and into dispatch sizes.
+
+	shader_reflection holds the interesting parts of D3DReflect's output.
+	root_signature_builder fills it in from bytecode. It can also be
+	written to and read from a small text format, so layouts can be
+	built without DirectX:
+
+		numthreads 8 8 1
+		uav texture 0 0 1 0 buffer
+		cbv buffer 0 0 1 16 constants
+
+	Each binding line is: kind (cbv, srv, uav, sampler), shape (texture,
+	typed_buffer, buffer, counter_buffer), register, space, count (0 for
+	unbounded), constant buffer size in bytes, name. Lines starting
+	with # are ignored.
+
+	build_root_layout picks the cheapest root parameter for each
+	binding. Root signatures are limited to 64 DWORDs. A root constant
+	costs one DWORD, a root descriptor two, and a descriptor table one.
+	The rules are:
+
+	- A small constant buffer becomes root constants.
+	- Any other constant buffer becomes a root CBV.
+	- Structured and byte address buffers become root SRVs or UAVs.
+	  These need no descriptor heap slot at all.
+	- Everything else goes into one descriptor table. Samplers get a
+	  table of their own, since they live in another heap.
+
+	If that goes over 64 DWORDs, root constants are turned into root
+	CBVs, and then root descriptors are moved into the table, until it
+	fits.
+
+	Two kernels with the same layout get the same canonical text, and
+	so the same hash. That is what root signatures are shared on.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// D3D12's root signature size limit.
+const unsigned int ROOT_SIGNATURE_MAX_DWORDS = 64;
+
+// Constant buffers up to this many DWORDs become root constants.
+const unsigned int ROOT_CONSTANTS_MAX_DWORDS = 8;
+
+enum shader_binding_kind {
+	SHADER_BINDING_CBV,
+	SHADER_BINDING_SRV,
+	SHADER_BINDING_UAV,
+	SHADER_BINDING_SAMPLER
+};
+
+/*
+	Only SHADER_RESOURCE_BUFFER (structured and byte address buffers)
+	can be bound as a root SRV or UAV. Typed buffers, textures and
+	buffers with a UAV counter need a descriptor.
+*/
+enum shader_resource_shape {
+	SHADER_RESOURCE_TEXTURE,
+	SHADER_RESOURCE_TYPED_BUFFER,
+	SHADER_RESOURCE_BUFFER,
+	SHADER_RESOURCE_COUNTER_BUFFER
+};
+
+struct shader_binding {
+	std::string name;
+	shader_binding_kind kind;
+	shader_resource_shape shape;
+	unsigned int shader_register;
+	unsigned int space;
+
+	// 0 for an unbounded array.
+	unsigned int count;
+
+	// Only for constant buffers.
+	unsigned int size_in_bytes;
+};
+
+struct shader_reflection {
+	unsigned int group_size[3];
+	std::vector<shader_binding> bindings;
+};
+
+enum root_parameter_kind {
+	ROOT_PARAMETER_CONSTANTS,
+	ROOT_PARAMETER_CBV,
+	ROOT_PARAMETER_SRV,
+	ROOT_PARAMETER_UAV,
+	ROOT_PARAMETER_TABLE
+};
+
+/*
+	A run of registers in a descriptor table. offset is where the run
+	starts in the table, in descriptors.
+*/
+struct root_layout_range {
+	shader_binding_kind kind;
+	unsigned int base_register;
+	unsigned int space;
+	unsigned int count;
+	unsigned int offset;
+};
+
+struct root_layout_parameter {
+	root_parameter_kind kind;
+
+	// Root constants and root descriptors.
+	unsigned int shader_register;
+	unsigned int space;
+	unsigned int num_32bit_values;
+
+	// Descriptor tables.
+	std::vector<root_layout_range> ranges;
+};
+
+struct root_layout {
+	std::vector<root_layout_parameter> parameters;
+	unsigned int size_in_dwords;
+
+	std::string canonical;
+	uint64_t hash;
+};
+
+struct dispatch_group_count {
+	unsigned int x;
+	unsigned int y;
+	unsigned int z;
+};
+
+const char* shader_binding_kind_name(const shader_binding_kind kind);
+const char* shader_resource_shape_name(const shader_resource_shape shape);
+
+bool parse_shader_reflection(const std::string& text, shader_reflection* reflection);
+std::string write_shader_reflection(const shader_reflection* reflection);
+
+// Returns false if no layout fits in ROOT_SIGNATURE_MAX_DWORDS.
+bool build_root_layout(const shader_reflection* reflection, root_layout* layout);
+
+/*
+	Where a binding ended up. table_offset is only meaningful when the
+	parameter is a table. Returns false if the layout doesn't have it.
+*/
+bool find_root_binding(
+	const root_layout* layout,
+	const shader_binding_kind kind,
+	const unsigned int shader_register,
+	const unsigned int space,
+	unsigned int* parameter,
+	unsigned int* table_offset
+);
+
+// Enough groups to cover width x height x depth threads.
+dispatch_group_count dispatch_size_for(
+	const shader_reflection* reflection,
+	const unsigned int width,
+	const unsigned int height,
+	const unsigned int depth
+);
@@ -0,0 +1,797 @@
+// Liam Wynn, 01/12/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "shader_permutations.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+void initialize_permutation_set(
+	permutation_set* set,
+	const string& source_path,
+	const string& entry_point,
+	const string& profile
+) {
+	set->source_path = source_path;
+	set->entry_point = entry_point;
+	set->profile = profile;
+	set->base_defines.clear();
+	set->axes.clear();
+	set->key_bits = 0;
+}
+
+unsigned int add_permutation_axis(
+	permutation_set* set,
+	const string& name,
+	const vector<permutation_choice>& choices
+) {
+	permutation_axis axis;
+
+	if (choices.empty()) {
+		return INVALID_PERMUTATION_KEY;
+	}
+
+	axis.name = name;
+	axis.choices = choices;
+	axis.shift = set->key_bits;
+	axis.bits = 0;
+
+	while ((1u << axis.bits) < choices.size()) {
+		axis.bits++;
+	}
+
+	if (set->key_bits + axis.bits > PERMUTATION_MAX_KEY_BITS) {
+		return INVALID_PERMUTATION_KEY;
+	}
+
+	set->key_bits += axis.bits;
+	set->axes.push_back(axis);
+
+	return (unsigned int)set->axes.size() - 1;
+}
+
+unsigned int add_permutation_values(
+	permutation_set* set,
+	const string& define,
+	const vector<string>& values
+) {
+	vector<permutation_choice> choices;
+
+	for (const string& value : values) {
+		choices.push_back({ value, { make_pair(define, value) } });
+	}
+
+	return add_permutation_axis(set, define, choices);
+}
+
+unsigned int add_permutation_toggle(permutation_set* set, const string& define) {
+	vector<permutation_choice> choices;
+
+	choices.push_back({ "", {} });
+	choices.push_back({ "1", { make_pair(define, string("1")) } });
+
+	return add_permutation_axis(set, define, choices);
+}
+
+unsigned int add_permutation_choice(
+	permutation_set* set,
+	const string& name,
+	const vector<string>& defines
+) {
+	vector<permutation_choice> choices;
+
+	choices.push_back({ "", {} });
+
+	for (const string& define : defines) {
+		choices.push_back({ define, { make_pair(define, string("1")) } });
+	}
+
+	return add_permutation_axis(set, name, choices);
+}
+
+unsigned int find_permutation_axis(const permutation_set* set, const string& name) {
+	for (unsigned int a = 0; a < set->axes.size(); a++) {
+		if (set->axes[a].name == name) {
+			return a;
+		}
+	}
+
+	return INVALID_PERMUTATION_KEY;
+}
+
+unsigned int find_permutation_choice(
+	const permutation_set* set,
+	const unsigned int axis,
+	const string& label
+) {
+	for (unsigned int c = 0; c < set->axes[axis].choices.size(); c++) {
+		if (set->axes[axis].choices[c].label == label) {
+			return c;
+		}
+	}
+
+	return INVALID_PERMUTATION_KEY;
+}
+
+bool is_valid_permutation_key(const permutation_set* set, const permutation_key key) {
+	if ((key >> set->key_bits) != 0) {
+		return false;
+	}
+
+	for (unsigned int a = 0; a < set->axes.size(); a++) {
+		if (permutation_choice_of(set, key, a) >= set->axes[a].choices.size()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+unsigned int count_permutations(const permutation_set* set) {
+	unsigned int count;
+
+	count = 1;
+
+	for (const permutation_axis& axis : set->axes) {
+		count *= (unsigned int)axis.choices.size();
+	}
+
+	return count;
+}
+
+vector<permutation_key> enumerate_permutations(const permutation_set* set) {
+	vector<permutation_key> keys;
+
+	for (permutation_key key = 0; key < (1u << set->key_bits); key++) {
+		if (is_valid_permutation_key(set, key)) {
+			keys.push_back(key);
+		}
+	}
+
+	return keys;
+}
+
+shader_defines permutation_defines(const permutation_set* set, const permutation_key key) {
+	shader_defines defines;
+
+	defines = set->base_defines;
+
+	for (unsigned int a = 0; a < set->axes.size(); a++) {
+		const permutation_choice* choice = &set->axes[a].choices[permutation_choice_of(set, key, a)];
+
+		defines.insert(defines.end(), choice->defines.begin(), choice->defines.end());
+	}
+
+	return defines;
+}
+
+string permutation_name(const permutation_set* set, const permutation_key key) {
+	string name;
+
+	for (unsigned int a = 0; a < set->axes.size(); a++) {
+		const permutation_choice* choice = &set->axes[a].choices[permutation_choice_of(set, key, a)];
+
+		if (a > 0) {
+			name += " ";
+		}
+
+		name += set->axes[a].name + "=" + (choice->label.empty() ? "-" : choice->label);
+	}
+
+	return name;
+}
+
+/* COMPILING */
+
+vector<compiled_permutation> compile_permutations(
+	const permutation_set* set,
+	const vector<permutation_key>& keys,
+	permutation_compiler* compiler,
+	const unsigned int num_threads,
+	permutation_compile_stats* stats
+) {
+	vector<compiled_permutation> results(keys.size());
+	atomic<size_t> next_key;
+	unsigned int num_workers;
+	vector<thread> workers;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+
+	next_key = 0;
+
+	//
+	// Each result has its own slot, so the workers only share the
+	// counter.
+	//
+
+	auto worker = [&]() {
+		size_t index;
+
+		while ((index = next_key.fetch_add(1)) < keys.size()) {
+			compiled_permutation* result = &results[index];
+			chrono::steady_clock::time_point compile_start = chrono::steady_clock::now();
+			chrono::duration<double> compile_time;
+
+			result->key = keys[index];
+			result->ok = compiler->compile(set, permutation_defines(set, keys[index]), &result->bytecode, &result->error);
+
+			compile_time = chrono::steady_clock::now() - compile_start;
+			result->seconds = compile_time.count();
+		}
+	};
+
+	num_workers = num_threads;
+
+	if (num_workers == 0) {
+		num_workers = thread::hardware_concurrency();
+	}
+
+	if (num_workers == 0) {
+		num_workers = 1;
+	}
+
+	if (num_workers > keys.size()) {
+		num_workers = keys.empty() ? 1 : (unsigned int)keys.size();
+	}
+
+	start = chrono::steady_clock::now();
+
+	for (unsigned int i = 1; i < num_workers; i++) {
+		workers.emplace_back(worker);
+	}
+
+	worker();
+
+	for (thread& t : workers) {
+		t.join();
+	}
+
+	elapsed = chrono::steady_clock::now() - start;
+
+	stats->compiled = 0;
+	stats->failed = 0;
+	stats->threads = num_workers;
+	stats->seconds = elapsed.count();
+	stats->compile_seconds = 0.0;
+
+	for (const compiled_permutation& result : results) {
+		if (result.ok) {
+			stats->compiled++;
+		}
+		else {
+			stats->failed++;
+		}
+
+		stats->compile_seconds += result.seconds;
+	}
+
+	return results;
+}
+
+/* DXC */
+
+const char* dxc_command_compiler::name() {
+	return "dxc";
+}
+
+static bool read_binary_file(const string& path, vector<unsigned char>* contents) {
+	ifstream file(path, ios::binary);
+	stringstream stream;
+	string text;
+
+	if (!file) {
+		return false;
+	}
+
+	stream << file.rdbuf();
+	text = stream.str();
+	contents->assign(text.begin(), text.end());
+
+	return true;
+}
+
+// Double quotes, for both the Windows and the POSIX shell.
+static string quote_argument(const string& argument) {
+	return "\"" + argument + "\"";
+}
+
+bool dxc_command_compiler::compile(
+	const permutation_set* set,
+	const shader_defines& defines,
+	vector<unsigned char>* bytecode,
+	string* error
+) {
+	string define_text;
+	string base;
+	string output_path;
+	string log_path;
+	string command;
+	vector<unsigned char> log;
+	int status;
+
+	//
+	// The temporary files are named after the permutation, so threads
+	// compiling different ones never share them.
+	//
+
+	for (const pair<string, string>& define : defines) {
+		define_text += define.first + "=" + define.second + ";";
+	}
+
+	base = (fs::path(working_directory) / ("permutation_" + hash_to_name(hash_string(set->source_path + "|" + set->entry_point + "|" + set->profile + "|" + define_text, 0)))).string();
+	output_path = base + ".dxil";
+	log_path = base + ".log";
+
+	command = quote_argument(executable) + " -nologo -T " + set->profile + " -E " + set->entry_point;
+
+	for (const string& argument : arguments) {
+		command += " " + quote_argument(argument);
+	}
+
+	for (const pair<string, string>& define : defines) {
+		command += " -D " + quote_argument(define.first + "=" + define.second);
+	}
+
+	command += " -Fo " + quote_argument(output_path) + " " + quote_argument(set->source_path) + " > " + quote_argument(log_path) + " 2>&1";
+
+	//
+	// cmd.exe strips the first and last quote of the line.
+	//
+
+#if defined(_WIN32)
+	command = "\"" + command + "\"";
+#endif
+
+	status = system(command.c_str());
+
+	if (status != 0 || !read_binary_file(output_path, bytecode) || bytecode->empty()) {
+		read_binary_file(log_path, &log);
+		*error = "dxc failed: " + string(log.begin(), log.end());
+	}
+
+	fs::remove(output_path);
+	fs::remove(log_path);
+
+	return error->empty();
+}
+
+bool find_dxc_executable(string* executable) {
+	string path;
+	size_t begin;
+	char* value;
+	error_code err;
+
+#if defined(_MSC_VER)
+	size_t length;
+
+	if (_dupenv_s(&value, &length, "PATH") != 0) {
+		value = NULL;
+	}
+#else
+	value = getenv("PATH");
+#endif
+
+	if (value == NULL) {
+		return false;
+	}
+
+	path = value;
+
+#if defined(_MSC_VER)
+	free(value);
+	const char separator = ';';
+	const char* name = "dxc.exe";
+#else
+	const char separator = ':';
+	const char* name = "dxc";
+#endif
+
+	begin = 0;
+
+	while (begin <= path.size()) {
+		size_t end = path.find(separator, begin);
+		fs::path candidate;
+
+		if (end == string::npos) {
+			end = path.size();
+		}
+
+		candidate = fs::path(path.substr(begin, end - begin)) / name;
+
+		if (end > begin && fs::is_regular_file(candidate, err)) {
+			*executable = candidate.string();
+			return true;
+		}
+
+		begin = end + 1;
+	}
+
+	return false;
+}
+
+void initialize_dxc_command_compiler(
+	dxc_command_compiler* compiler,
+	const string& executable,
+	const string& working_directory
+) {
+	error_code err;
+
+	compiler->executable = executable;
+	compiler->working_directory = working_directory;
+	compiler->arguments.clear();
+
+	fs::create_directories(working_directory, err);
+}
+
+void hello_compute_permutations(permutation_set* set, const string& profile) {
+	initialize_permutation_set(set, "./hello_compute.hlsl", "main", profile);
+
+	add_permutation_values(set, "GROUP_SIZE_X", { "8", "4", "16", "32" });
+	add_permutation_values(set, "GROUP_SIZE_Y", { "8", "1", "4", "16" });
+	add_permutation_choice(set, "LAYOUT", { "LAYOUT_STRUCTURED", "LAYOUT_RAW" });
+	add_permutation_toggle(set, "TILED");
+}
+
+/* CHECKING */
+
+/*
+	Stands in for a compiler. The bytecode is the defines' hash, some
+	permutations fail, and each compile takes a different amount of
+	time so the threads finish out of order.
+*/
+struct mock_permutation_compiler : permutation_compiler {
+	// Microseconds of busy work per compile, on average.
+	unsigned int work_us;
+	atomic<unsigned int> running;
+	atomic<unsigned int> most_running;
+
+	const char* name() override {
+		return "mock";
+	}
+
+	bool compile(
+		const permutation_set* set,
+		const shader_defines& defines,
+		vector<unsigned char>* bytecode,
+		string* error
+	) override {
+		string text;
+		uint64_t hash;
+		unsigned int now;
+		chrono::steady_clock::time_point until;
+
+		now = ++running;
+
+		while (now > most_running) {
+			unsigned int seen = most_running;
+
+			if (now <= seen || most_running.compare_exchange_weak(seen, now)) {
+				break;
+			}
+		}
+
+		for (const pair<string, string>& define : defines) {
+			text += define.first + "=" + define.second + ";";
+		}
+
+		hash = hash_string(set->entry_point + "|" + text, 0);
+		until = chrono::steady_clock::now() + chrono::microseconds(work_us / 2 + hash % (work_us + 1));
+
+		while (chrono::steady_clock::now() < until) {
+			hash = hash * 6364136223846793005ull + 1442695040888963407ull;
+		}
+
+		running--;
+
+		//
+		// 32 wide groups don't fit TILED, say.
+		//
+
+		if (text.find("GROUP_SIZE_X=32;") != string::npos && text.find("TILED=1;") != string::npos) {
+			*error = "error X3000: mock compile failure";
+			return false;
+		}
+
+		bytecode->assign(text.begin(), text.end());
+		return true;
+	}
+};
+
+bool verify_shader_permutations(FILE* out) {
+	permutation_set set;
+	vector<permutation_key> keys;
+	vector<string> names;
+	permutation_table<unsigned int> table;
+	unsigned int problems;
+
+	problems = 0;
+
+	auto report = [&](const string& what) {
+		if (out != NULL && problems < 10) {
+			fprintf(out, "  %s\n", what.c_str());
+		}
+
+		problems++;
+	};
+
+	//
+	// Axes of 4, 3, 2, 1 and 5 choices take 2, 2, 1, 0 and 3 bits.
+	//
+
+	initialize_permutation_set(&set, "kernel.hlsl", "main", "cs_6_0");
+	set.base_defines.push_back(make_pair(string("BASE"), string("1")));
+
+	add_permutation_values(&set, "A", { "0", "1", "2", "3" });
+	add_permutation_values(&set, "B", { "x", "y", "z" });
+	add_permutation_toggle(&set, "C");
+	add_permutation_values(&set, "D", { "only" });
+	add_permutation_choice(&set, "E", { "E1", "E2", "E3", "E4" });
+
+	if (set.key_bits != 8 || set.axes[4].shift != 5 || set.axes[3].bits != 0) {
+		report("the axes weren't packed into the fewest bits");
+	}
+
+	keys = enumerate_permutations(&set);
+
+	if (keys.size() != 120 || count_permutations(&set) != 120) {
+		report("enumeration didn't find every combination once");
+	}
+
+	for (size_t i = 0; i < keys.size(); i++) {
+		shader_defines defines = permutation_defines(&set, keys[i]);
+
+		if (i > 0 && keys[i] <= keys[i - 1]) {
+			report("enumeration isn't in increasing key order");
+		}
+
+		if (defines.empty() || defines[0].first != "BASE") {
+			report("a permutation lost the base defines");
+		}
+
+		names.push_back(permutation_name(&set, keys[i]));
+
+		for (unsigned int a = 0; a < set.axes.size(); a++) {
+			unsigned int choice = permutation_choice_of(&set, keys[i], a);
+
+			if (with_permutation_choice(&set, keys[i], a, choice) != keys[i]) {
+				report("switching an axis to the choice it has changed the key");
+			}
+
+			for (unsigned int c = 0; c < set.axes[a].choices.size(); c++) {
+				permutation_key other = with_permutation_choice(&set, keys[i], a, c);
+
+				if (permutation_choice_of(&set, other, a) != c || !is_valid_permutation_key(&set, other)) {
+					report("switching an axis didn't land on the choice asked for");
+				}
+
+				for (unsigned int b = 0; b < set.axes.size(); b++) {
+					if (b != a && permutation_choice_of(&set, other, b) != permutation_choice_of(&set, keys[i], b)) {
+						report("switching one axis changed another");
+					}
+				}
+			}
+		}
+	}
+
+	sort(names.begin(), names.end());
+
+	if (unique(names.begin(), names.end()) != names.end()) {
+		report("two permutations have the same name");
+	}
+
+	if (is_valid_permutation_key(&set, with_permutation_choice(&set, 0, 1, 3)) || is_valid_permutation_key(&set, 1u << 8)) {
+		report("a key past an axis's choices or the key bits was valid");
+	}
+
+	if (find_permutation_axis(&set, "E") != 4 || find_permutation_choice(&set, 4, "E3") != 3 || find_permutation_axis(&set, "F") != INVALID_PERMUTATION_KEY) {
+		report("axes or choices weren't found by name");
+	}
+
+	{
+		permutation_set big;
+		vector<string> values(1024, "v");
+
+		initialize_permutation_set(&big, "kernel.hlsl", "main", "cs_6_0");
+		add_permutation_values(&big, "X", values);
+		add_permutation_values(&big, "Y", values);
+
+		if (add_permutation_values(&big, "Z", { "1", "2", "3" }) != INVALID_PERMUTATION_KEY) {
+			report("a set was allowed more than PERMUTATION_MAX_KEY_BITS key bits");
+		}
+	}
+
+	//
+	// The table has what was put in it, and nothing else.
+	//
+
+	initialize_permutation_table(&table, &set);
+
+	for (size_t i = 0; i < keys.size(); i += 2) {
+		set_permutation(&table, keys[i], (unsigned int)i);
+	}
+
+	for (size_t i = 0; i < keys.size(); i++) {
+		const unsigned int* found = find_permutation(&table, keys[i]);
+
+		if ((i % 2 == 0) != (found != NULL) || (found != NULL && *found != i)) {
+			report("the table doesn't have what was put in it");
+		}
+	}
+
+	if (find_permutation(&table, 1u << 8) != NULL || find_permutation(&table, INVALID_PERMUTATION_KEY) != NULL) {
+		report("the table found a key it can't have");
+	}
+
+	//
+	// The driver, on hello_compute's axes: every thread count gives the
+	// same results, in key order, with the same failures.
+	//
+
+	{
+		permutation_set hello;
+		mock_permutation_compiler compiler;
+		vector<compiled_permutation> serial;
+
+		hello_compute_permutations(&hello, "cs_6_0");
+		keys = enumerate_permutations(&hello);
+
+		if (keys.size() != 4 * 4 * 3 * 2) {
+			report("hello_compute doesn't have 96 permutations");
+		}
+
+		compiler.work_us = 200;
+
+		for (unsigned int threads : { 1u, 3u, 8u }) {
+			permutation_compile_stats stats;
+			vector<compiled_permutation> results;
+
+			compiler.running = 0;
+			compiler.most_running = 0;
+
+			results = compile_permutations(&hello, keys, &compiler, threads, &stats);
+
+			if (threads == 1) {
+				serial = results;
+			}
+
+			if (results.size() != keys.size() || stats.compiled + stats.failed != keys.size() || stats.failed != 4 * 3) {
+				report("the driver lost permutations, or didn't report the failures");
+				continue;
+			}
+
+			for (size_t i = 0; i < keys.size(); i++) {
+				if (results[i].key != keys[i] || results[i].ok != serial[i].ok || results[i].bytecode != serial[i].bytecode) {
+					report("results on " + to_string(threads) + " threads don't match one thread");
+					break;
+				}
+
+				if (!results[i].ok && results[i].error.empty()) {
+					report("a failed permutation has no error");
+				}
+			}
+
+			if (threads > 1 && compiler.most_running < 2) {
+				report("compiles on " + to_string(threads) + " threads never overlapped");
+			}
+		}
+	}
+
+	if (out != NULL) {
+		fprintf(out, "Shader permutations: %s\n", problems == 0 ? "all correct" : (to_string(problems) + " problem(s)").c_str());
+	}
+
+	return problems == 0;
+}
+
+void benchmark_shader_permutations(FILE* out) {
+	const unsigned int num_lookups = 1 << 24;
+	permutation_set set;
+	vector<permutation_key> keys;
+	vector<permutation_key> lookups;
+	permutation_table<uint64_t> table;
+	mock_permutation_compiler mock;
+	mt19937 rng(7);
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+	double one_thread;
+	uint64_t sum;
+	string dxc;
+
+	hello_compute_permutations(&set, "cs_6_0");
+	keys = enumerate_permutations(&set);
+
+	//
+	// A compile is mostly the compiler thinking, so the mock keeps a core
+	// busy for about 2 ms.
+	//
+
+	mock.work_us = 2000;
+	one_thread = 0.0;
+
+	fprintf(out, "  %u permutations of hello_compute, mock compiler\n", (unsigned int)keys.size());
+	fprintf(out, "  %7s %10s %8s\n", "threads", "ms", "speedup");
+
+	for (unsigned int threads : { 1u, 2u, 4u, 8u }) {
+		permutation_compile_stats stats;
+
+		compile_permutations(&set, keys, &mock, threads, &stats);
+
+		if (threads == 1) {
+			one_thread = stats.seconds;
+		}
+
+		fprintf(out, "  %7u %10.1f %7.2fx\n", threads, stats.seconds * 1000.0, one_thread / stats.seconds);
+	}
+
+	fprintf(out, "  (hardware threads: %u)\n", thread::hardware_concurrency());
+
+	//
+	// Lookups, the way the dispatch path does them: switch an axis,
+	// find the pipeline.
+	//
+
+	initialize_permutation_table(&table, &set);
+
+	for (permutation_key key : keys) {
+		set_permutation(&table, key, (uint64_t)key * 2654435761u);
+	}
+
+	for (unsigned int i = 0; i < 4096; i++) {
+		lookups.push_back(keys[rng() % keys.size()]);
+	}
+
+	sum = 0;
+	start = chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < num_lookups; i++) {
+		permutation_key key = with_permutation_choice(&set, lookups[i & 4095], 3, i & 1);
+		const uint64_t* found = find_permutation(&table, key);
+
+		sum += found != NULL ? *found : 0;
+	}
+
+	elapsed = chrono::steady_clock::now() - start;
+
+	fprintf(out, "  lookup: %.2f ns (checksum %llu)\n", elapsed.count() * 1.0e9 / num_lookups, (unsigned long long)(sum & 0xFFFF));
+
+	if (!find_dxc_executable(&dxc)) {
+		fprintf(out, "  dxc isn't on the PATH, skipping the real compile.\n");
+		return;
+	}
+
+	{
+		dxc_command_compiler compiler;
+		permutation_compile_stats stats;
+		vector<compiled_permutation> results;
+
+		initialize_dxc_command_compiler(&compiler, dxc, (fs::temp_directory_path() / "hello_permutations").string());
+
+		for (unsigned int threads : { 1u, 0u }) {
+			results = compile_permutations(&set, keys, &compiler, threads, &stats);
+
+			fprintf(
+				out,
+				"  dxc on %u thread(s): %u compiled, %u failed, %.1f ms\n",
+				stats.threads,
+				stats.compiled,
+				stats.failed,
+				stats.seconds * 1000.0
+			);
+		}
+
+		for (const compiled_permutation& result : results) {
+			if (!result.ok) {
+				fprintf(out, "  %s: %s\n", permutation_name(&set, result.key).c_str(), result.error.c_str());
+				break;
+			}
+		}
+	}
+}
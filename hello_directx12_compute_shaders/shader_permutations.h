@@ -0,0 +1,287 @@
+// Liam Wynn, 01/12/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	Shader permutations are every build of a kernel a set of axes
+	asks for. An axis is one thing that varies: a define that takes a
+	few values (GROUP_SIZE_X 4, 8, 16...), a toggle that is defined or
+	not (TILED), or a choice between defines (LAYOUT_STRUCTURED,
+	LAYOUT_RAW or neither). Every combination of one choice per axis
+	is a permutation.
+
+	A permutation is named by a permutation_key: each axis gets just
+	enough bits for its choices, packed one after the other, so a key
+	is built or changed with a shift and a mask. A permutation_table is
+	a flat array over every key, so finding a permutation's pipeline is
+	an index, with no hashing and no allocation, cheap enough for the
+	dispatch path.
+
+	compile_permutations builds every permutation on a pool of threads
+	through a permutation_compiler, which is what actually runs FXC or
+	DXC. dxc_command_compiler runs the dxc executable, so permutations
+	can be built, and the driver checked, wherever dxc runs, Linux
+	included. The D3D12 side (gpu_permutations) compiles with FXC
+	through the shader cache and turns the bytecode into pipelines.
+
+	Nothing here depends on Windows.
+*/
+
+#pragma once
+
+#include "shader_cache.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+typedef uint32_t permutation_key;
+
+// A set of permutations can't need more key bits than this. The table
+// has an entry for every key.
+const unsigned int PERMUTATION_MAX_KEY_BITS = 20;
+
+const permutation_key INVALID_PERMUTATION_KEY = 0xFFFFFFFF;
+
+struct permutation_choice {
+	// For printing, e.g. "8" or "LAYOUT_RAW". Empty for "not defined".
+	std::string label;
+	shader_defines defines;
+};
+
+struct permutation_axis {
+	std::string name;
+	std::vector<permutation_choice> choices;
+
+	// Where the axis is in the key.
+	unsigned int shift;
+	unsigned int bits;
+};
+
+struct permutation_set {
+	std::string source_path;
+	std::string entry_point;
+	std::string profile;
+
+	// Defines every permutation gets.
+	shader_defines base_defines;
+
+	std::vector<permutation_axis> axes;
+	unsigned int key_bits;
+};
+
+void initialize_permutation_set(
+	permutation_set* set,
+	const std::string& source_path,
+	const std::string& entry_point,
+	const std::string& profile
+);
+
+/*
+	Adds an axis and returns its index. Returns INVALID_PERMUTATION_KEY
+	if it has no choices or the key would need more than
+	PERMUTATION_MAX_KEY_BITS bits.
+*/
+unsigned int add_permutation_axis(
+	permutation_set* set,
+	const std::string& name,
+	const std::vector<permutation_choice>& choices
+);
+
+// define set to each of values.
+unsigned int add_permutation_values(
+	permutation_set* set,
+	const std::string& define,
+	const std::vector<std::string>& values
+);
+
+// define left out, or set to 1.
+unsigned int add_permutation_toggle(permutation_set* set, const std::string& define);
+
+// None of defines, or one of them set to 1.
+unsigned int add_permutation_choice(
+	permutation_set* set,
+	const std::string& name,
+	const std::vector<std::string>& defines
+);
+
+// The axis called name, or INVALID_PERMUTATION_KEY.
+unsigned int find_permutation_axis(const permutation_set* set, const std::string& name);
+
+// The choice labelled label on axis, or INVALID_PERMUTATION_KEY.
+unsigned int find_permutation_choice(
+	const permutation_set* set,
+	const unsigned int axis,
+	const std::string& label
+);
+
+// Every axis on its first choice.
+inline permutation_key default_permutation_key() {
+	return 0;
+}
+
+// key with axis switched to choice.
+inline permutation_key with_permutation_choice(
+	const permutation_set* set,
+	const permutation_key key,
+	const unsigned int axis,
+	const unsigned int choice
+) {
+	const permutation_axis* a = &set->axes[axis];
+	permutation_key mask = ((1u << a->bits) - 1) << a->shift;
+
+	return (key & ~mask) | (choice << a->shift);
+}
+
+inline unsigned int permutation_choice_of(
+	const permutation_set* set,
+	const permutation_key key,
+	const unsigned int axis
+) {
+	const permutation_axis* a = &set->axes[axis];
+
+	return (key >> a->shift) & ((1u << a->bits) - 1);
+}
+
+// A key whose every axis is on one of its choices.
+bool is_valid_permutation_key(const permutation_set* set, const permutation_key key);
+
+unsigned int count_permutations(const permutation_set* set);
+
+// Every valid key, in increasing order.
+std::vector<permutation_key> enumerate_permutations(const permutation_set* set);
+
+// The base defines, then each axis's choice, in axis order.
+shader_defines permutation_defines(const permutation_set* set, const permutation_key key);
+
+// e.g. "GROUP_SIZE_X=8 TILED LAYOUT=-".
+std::string permutation_name(const permutation_set* set, const permutation_key key);
+
+/*
+	One entry per possible key of a set. Only the permutations that were
+	built are present.
+*/
+template <typename T>
+struct permutation_table {
+	std::vector<T> entries;
+	std::vector<bool> present;
+};
+
+template <typename T>
+void initialize_permutation_table(permutation_table<T>* table, const permutation_set* set) {
+	table->entries.assign((size_t)1 << set->key_bits, T());
+	table->present.assign((size_t)1 << set->key_bits, false);
+}
+
+template <typename T>
+void set_permutation(permutation_table<T>* table, const permutation_key key, const T& value) {
+	table->entries[key] = value;
+	table->present[key] = true;
+}
+
+// NULL if key isn't in the table. Doesn't allocate.
+template <typename T>
+const T* find_permutation(const permutation_table<T>* table, const permutation_key key) {
+	if (key >= table->entries.size() || !table->present[key]) {
+		return NULL;
+	}
+
+	return &table->entries[key];
+}
+
+/* COMPILING */
+
+/*
+	Compiles one permutation. compile is called from several threads at
+	once, so it can't share anything it doesn't lock.
+*/
+struct permutation_compiler {
+	virtual ~permutation_compiler() {}
+
+	virtual const char* name() = 0;
+	virtual bool compile(
+		const permutation_set* set,
+		const shader_defines& defines,
+		std::vector<unsigned char>* bytecode,
+		std::string* error
+	) = 0;
+};
+
+struct compiled_permutation {
+	permutation_key key;
+	bool ok;
+	std::string error;
+	std::vector<unsigned char> bytecode;
+	double seconds;
+};
+
+struct permutation_compile_stats {
+	unsigned int compiled;
+	unsigned int failed;
+	unsigned int threads;
+
+	// Wall clock, and the compile times added up.
+	double seconds;
+	double compile_seconds;
+};
+
+/*
+	Compiles keys on up to num_threads threads (0 for one per hardware
+	thread). Results come back in the order of keys, whichever thread
+	finished first.
+*/
+std::vector<compiled_permutation> compile_permutations(
+	const permutation_set* set,
+	const std::vector<permutation_key>& keys,
+	permutation_compiler* compiler,
+	const unsigned int num_threads,
+	permutation_compile_stats* stats
+);
+
+/*
+	Runs the dxc executable for each permutation, writing the DXIL to a
+	temporary file next to working_directory. The profile has to be a
+	shader model 6 one. arguments go to dxc as well, e.g.
+	-enable-16bit-types.
+*/
+struct dxc_command_compiler : permutation_compiler {
+	std::string executable;
+	std::string working_directory;
+	std::vector<std::string> arguments;
+
+	const char* name() override;
+	bool compile(
+		const permutation_set* set,
+		const shader_defines& defines,
+		std::vector<unsigned char>* bytecode,
+		std::string* error
+	) override;
+};
+
+// Finds dxc on the PATH. Returns false if it isn't there.
+bool find_dxc_executable(std::string* executable);
+
+void initialize_dxc_command_compiler(
+	dxc_command_compiler* compiler,
+	const std::string& executable,
+	const std::string& working_directory
+);
+
+/*
+	The axes hello_compute.hlsl has: group size, layout and TILED.
+	profile is cs_5_1 for FXC, or a cs_6_x one for DXC.
+*/
+void hello_compute_permutations(permutation_set* set, const std::string& profile);
+
+/*
+	Checks key packing, enumeration, the table and the compile driver
+	(on a mock compiler that fails some permutations, with threads
+	finishing out of order). Problems go to out, which may be NULL.
+	Returns false if there were any.
+*/
+bool verify_shader_permutations(FILE* out);
+
+/*
+	Times a mock compile on 1 to 8
+	threads, table lookups, and a real compile of hello_compute's
+	permutations if dxc is on the PATH.
+*/
+void benchmark_shader_permutations(FILE* out);
@@ -0,0 +1,630 @@
+// Liam Wynn, 01/02/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "suballocator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+/* BIT SCANS */
+
+static unsigned int lowest_set_bit(const uint64_t value) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return (unsigned int)index;
+#else
+	return (unsigned int)__builtin_ctzll(value);
+#endif
+}
+
+static unsigned int highest_set_bit(const uint64_t value) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return (unsigned int)index;
+#else
+	return 63 - (unsigned int)__builtin_clzll(value);
+#endif
+}
+
+static uint64_t align_up(const uint64_t value, const uint64_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/* SIZE CLASSES */
+
+/*
+	The list a free block of exactly size bytes goes in.
+*/
+static void size_class(const uint64_t size, unsigned int* first, unsigned int* second) {
+	*first = highest_set_bit(size);
+	*second = (unsigned int)(size >> (*first - TLSF_SECOND_LEVEL_LOG2)) - TLSF_SECOND_LEVEL_COUNT;
+}
+
+/*
+	The first list where every block is at least size bytes. Rounds size
+	up to the next class boundary before classifying it.
+*/
+static bool search_class(const uint64_t size, unsigned int* first, unsigned int* second) {
+	uint64_t rounded;
+
+	rounded = size + (1ULL << (highest_set_bit(size) - TLSF_SECOND_LEVEL_LOG2)) - 1;
+
+	if (rounded < size) {
+		return false;
+	}
+
+	size_class(rounded, first, second);
+
+	return true;
+}
+
+/* BLOCK RECORDS */
+
+static unsigned int new_block(tlsf_allocator* allocator) {
+	unsigned int index;
+
+	if (allocator->unused_blocks != TLSF_INVALID_BLOCK) {
+		index = allocator->unused_blocks;
+		allocator->unused_blocks = allocator->blocks[index].next_free;
+		return index;
+	}
+
+	allocator->blocks.push_back(tlsf_block());
+
+	return (unsigned int)allocator->blocks.size() - 1;
+}
+
+static void release_block(tlsf_allocator* allocator, const unsigned int index) {
+	allocator->blocks[index].next_free = allocator->unused_blocks;
+	allocator->unused_blocks = index;
+}
+
+static void insert_free_block(tlsf_allocator* allocator, const unsigned int index) {
+	tlsf_block* block;
+	unsigned int first;
+	unsigned int second;
+	unsigned int head;
+
+	block = &allocator->blocks[index];
+	size_class(block->size, &first, &second);
+
+	head = allocator->free_lists[first][second];
+
+	block->free = true;
+	block->prev_free = TLSF_INVALID_BLOCK;
+	block->next_free = head;
+
+	if (head != TLSF_INVALID_BLOCK) {
+		allocator->blocks[head].prev_free = index;
+	}
+
+	allocator->free_lists[first][second] = index;
+	allocator->first_level_bitmap |= 1ULL << first;
+	allocator->second_level_bitmaps[first] |= 1U << second;
+}
+
+static void remove_free_block(tlsf_allocator* allocator, const unsigned int index) {
+	tlsf_block* block;
+	unsigned int first;
+	unsigned int second;
+
+	block = &allocator->blocks[index];
+	size_class(block->size, &first, &second);
+
+	if (block->prev_free != TLSF_INVALID_BLOCK) {
+		allocator->blocks[block->prev_free].next_free = block->next_free;
+	}
+	else {
+		allocator->free_lists[first][second] = block->next_free;
+	}
+
+	if (block->next_free != TLSF_INVALID_BLOCK) {
+		allocator->blocks[block->next_free].prev_free = block->prev_free;
+	}
+
+	//
+	// Clear the bitmap bits once a list runs dry.
+	//
+
+	if (allocator->free_lists[first][second] == TLSF_INVALID_BLOCK) {
+		allocator->second_level_bitmaps[first] &= ~(1U << second);
+
+		if (allocator->second_level_bitmaps[first] == 0) {
+			allocator->first_level_bitmap &= ~(1ULL << first);
+		}
+	}
+
+	block->free = false;
+}
+
+/*
+	A free block of at least size bytes, or TLSF_INVALID_BLOCK.
+*/
+static unsigned int find_free_block(tlsf_allocator* allocator, const uint64_t size) {
+	unsigned int first;
+	unsigned int second;
+	uint64_t first_map;
+	uint32_t second_map;
+
+	if (!search_class(size, &first, &second) || first >= TLSF_FIRST_LEVEL_COUNT) {
+		return TLSF_INVALID_BLOCK;
+	}
+
+	//
+	// Anything in a bigger list of the same first level, and if that's
+	// empty, the smallest non-empty list of a bigger first level.
+	//
+
+	second_map = allocator->second_level_bitmaps[first] & (~0U << second);
+
+	if (second_map == 0) {
+		first_map = first + 1 < TLSF_FIRST_LEVEL_COUNT ? allocator->first_level_bitmap & (~0ULL << (first + 1)) : 0;
+
+		if (first_map == 0) {
+			return TLSF_INVALID_BLOCK;
+		}
+
+		first = lowest_set_bit(first_map);
+		second_map = allocator->second_level_bitmaps[first];
+	}
+
+	second = lowest_set_bit(second_map);
+
+	return allocator->free_lists[first][second];
+}
+
+/*
+	Cuts the first size bytes off block into a block of their own,
+	placed before it in memory. Returns the new block.
+*/
+static unsigned int split_front(tlsf_allocator* allocator, const unsigned int index, const uint64_t size) {
+	unsigned int front;
+	tlsf_block* block;
+
+	front = new_block(allocator);
+	block = &allocator->blocks[index];
+
+	allocator->blocks[front].offset = block->offset;
+	allocator->blocks[front].size = size;
+	allocator->blocks[front].prev_physical = block->prev_physical;
+	allocator->blocks[front].next_physical = index;
+
+	if (block->prev_physical != TLSF_INVALID_BLOCK) {
+		allocator->blocks[block->prev_physical].next_physical = front;
+	}
+
+	block->prev_physical = front;
+	block->offset += size;
+	block->size -= size;
+
+	return front;
+}
+
+/* ALLOCATOR */
+
+void initialize_tlsf(
+	tlsf_allocator* allocator,
+	const uint64_t size,
+	const uint64_t granularity
+) {
+	unsigned int first;
+
+	allocator->granularity = granularity < 16 ? 16 : granularity;
+	allocator->size = size & ~(allocator->granularity - 1);
+	allocator->blocks.clear();
+	allocator->unused_blocks = TLSF_INVALID_BLOCK;
+	allocator->first_level_bitmap = 0;
+	allocator->used_bytes = 0;
+	allocator->allocations = 0;
+
+	for (unsigned int f = 0; f < TLSF_FIRST_LEVEL_COUNT; f++) {
+		allocator->second_level_bitmaps[f] = 0;
+
+		for (unsigned int s = 0; s < TLSF_SECOND_LEVEL_COUNT; s++) {
+			allocator->free_lists[f][s] = TLSF_INVALID_BLOCK;
+		}
+	}
+
+	if (allocator->size == 0) {
+		return;
+	}
+
+	//
+	// Everything starts out as one free block.
+	//
+
+	first = new_block(allocator);
+	allocator->blocks[first].offset = 0;
+	allocator->blocks[first].size = allocator->size;
+	allocator->blocks[first].prev_physical = TLSF_INVALID_BLOCK;
+	allocator->blocks[first].next_physical = TLSF_INVALID_BLOCK;
+
+	insert_free_block(allocator, first);
+}
+
+bool tlsf_allocate(
+	tlsf_allocator* allocator,
+	const uint64_t size,
+	const uint64_t alignment,
+	tlsf_allocation* allocation
+) {
+	uint64_t rounded_size;
+	uint64_t align;
+	uint64_t search_size;
+	uint64_t padding;
+	unsigned int index;
+	unsigned int front;
+	unsigned int back;
+	tlsf_block* block;
+
+	allocation->block = TLSF_INVALID_BLOCK;
+
+	rounded_size = align_up(size == 0 ? 1 : size, allocator->granularity);
+	align = alignment > allocator->granularity ? alignment : allocator->granularity;
+
+	//
+	// Block offsets are multiples of the granularity, so at most
+	// align - granularity bytes of padding are needed in front.
+	//
+
+	search_size = rounded_size + (align - allocator->granularity);
+
+	if (rounded_size < size || search_size > allocator->size) {
+		return false;
+	}
+
+	index = find_free_block(allocator, search_size);
+
+	if (index == TLSF_INVALID_BLOCK) {
+		return false;
+	}
+
+	remove_free_block(allocator, index);
+
+	//
+	// Give the padding back as a free block of its own. The block
+	// before this one is in use (free neighbours are always merged),
+	// so there is nothing to merge it with.
+	//
+
+	padding = align_up(allocator->blocks[index].offset, align) - allocator->blocks[index].offset;
+
+	if (padding > 0) {
+		front = split_front(allocator, index, padding);
+		insert_free_block(allocator, front);
+	}
+
+	//
+	// Same for whatever is left over at the end.
+	//
+
+	if (allocator->blocks[index].size > rounded_size) {
+		back = index;
+		index = split_front(allocator, back, rounded_size);
+		insert_free_block(allocator, back);
+	}
+
+	block = &allocator->blocks[index];
+	block->free = false;
+
+	allocator->used_bytes += block->size;
+	allocator->allocations++;
+
+	allocation->offset = block->offset;
+	allocation->size = block->size;
+	allocation->block = index;
+
+	return true;
+}
+
+void tlsf_free(tlsf_allocator* allocator, tlsf_allocation* allocation) {
+	unsigned int index;
+	unsigned int neighbour;
+	tlsf_block* block;
+
+	if (allocation->block == TLSF_INVALID_BLOCK) {
+		return;
+	}
+
+	index = allocation->block;
+	allocation->block = TLSF_INVALID_BLOCK;
+
+	block = &allocator->blocks[index];
+	allocator->used_bytes -= block->size;
+	allocator->allocations--;
+
+	//
+	// Merge with a free block after this one...
+	//
+
+	neighbour = block->next_physical;
+
+	if (neighbour != TLSF_INVALID_BLOCK && allocator->blocks[neighbour].free) {
+		remove_free_block(allocator, neighbour);
+
+		block->size += allocator->blocks[neighbour].size;
+		block->next_physical = allocator->blocks[neighbour].next_physical;
+
+		if (block->next_physical != TLSF_INVALID_BLOCK) {
+			allocator->blocks[block->next_physical].prev_physical = index;
+		}
+
+		release_block(allocator, neighbour);
+	}
+
+	//
+	// ...and before it.
+	//
+
+	neighbour = block->prev_physical;
+
+	if (neighbour != TLSF_INVALID_BLOCK && allocator->blocks[neighbour].free) {
+		remove_free_block(allocator, neighbour);
+
+		allocator->blocks[neighbour].size += block->size;
+		allocator->blocks[neighbour].next_physical = block->next_physical;
+
+		if (block->next_physical != TLSF_INVALID_BLOCK) {
+			allocator->blocks[block->next_physical].prev_physical = neighbour;
+		}
+
+		release_block(allocator, index);
+		index = neighbour;
+	}
+
+	insert_free_block(allocator, index);
+}
+
+uint64_t tlsf_block_size_for(
+	const uint64_t size,
+	const uint64_t alignment,
+	const uint64_t granularity
+) {
+	uint64_t gran;
+	uint64_t align;
+	uint64_t search_size;
+	uint64_t class_size;
+	unsigned int first;
+	unsigned int second;
+
+	//
+	// The same search size tlsf_allocate asks for.
+	//
+
+	gran = granularity < 16 ? 16 : granularity;
+	align = alignment > gran ? alignment : gran;
+	search_size = align_up(size == 0 ? 1 : size, gran) + (align - gran);
+
+	//
+	// The smallest block in the list the search starts at. An empty
+	// allocator's one block has to be at least that big.
+	//
+
+	if (!search_class(search_size, &first, &second)) {
+		return 0;
+	}
+
+	class_size = (uint64_t)(TLSF_SECOND_LEVEL_COUNT + second) << (first - TLSF_SECOND_LEVEL_LOG2);
+
+	return align_up(class_size > search_size ? class_size : search_size, gran);
+}
+
+tlsf_stats get_tlsf_stats(const tlsf_allocator* allocator) {
+	tlsf_stats stats;
+
+	stats = {};
+	stats.used_bytes = allocator->used_bytes;
+	stats.free_bytes = allocator->size - allocator->used_bytes;
+	stats.allocations = allocator->allocations;
+
+	for (unsigned int f = 0; f < TLSF_FIRST_LEVEL_COUNT; f++) {
+		for (unsigned int s = 0; s < TLSF_SECOND_LEVEL_COUNT; s++) {
+			unsigned int index = allocator->free_lists[f][s];
+
+			while (index != TLSF_INVALID_BLOCK) {
+				stats.free_blocks++;
+				stats.largest_free_block = max(stats.largest_free_block, allocator->blocks[index].size);
+				index = allocator->blocks[index].next_free;
+			}
+		}
+	}
+
+	if (stats.free_bytes > 0) {
+		stats.fragmentation = 1.0 - (double)stats.largest_free_block / (double)stats.free_bytes;
+	}
+
+	return stats;
+}
+
+/* TRANSIENT ALIASING */
+
+bool transient_lifetimes_overlap(
+	const transient_request* a,
+	const transient_request* b
+) {
+	return a->first_use <= b->last_use && b->first_use <= a->last_use;
+}
+
+void plan_transient_aliasing(
+	const transient_request* requests,
+	const unsigned int num_requests,
+	transient_plan* plan
+) {
+	vector<unsigned int> order;
+	vector<unsigned int> placed;
+	vector<pair<uint64_t, uint64_t>> taken;
+	uint64_t offset;
+
+	plan->offsets.assign(num_requests, 0);
+	plan->arena_size = 0;
+	plan->arena_alignment = 1;
+	plan->unaliased_size = 0;
+
+	for (unsigned int i = 0; i < num_requests; i++) {
+		order.push_back(i);
+		plan->arena_alignment = max(plan->arena_alignment, requests[i].alignment);
+		plan->unaliased_size = align_up(plan->unaliased_size, max(requests[i].alignment, (uint64_t)1)) + requests[i].size;
+	}
+
+	//
+	// Placing the big buffers first leaves the small ones to fill the
+	// gaps between them.
+	//
+
+	stable_sort(order.begin(), order.end(), [requests](unsigned int a, unsigned int b) {
+		return requests[a].size > requests[b].size;
+	});
+
+	for (unsigned int i : order) {
+		const transient_request* request = &requests[i];
+		uint64_t alignment = max(request->alignment, (uint64_t)1);
+
+		//
+		// The memory ranges of everything already placed that is live
+		// at the same time, in address order.
+		//
+
+		taken.clear();
+
+		for (unsigned int p : placed) {
+			if (transient_lifetimes_overlap(request, &requests[p])) {
+				taken.push_back(make_pair(plan->offsets[p], plan->offsets[p] + requests[p].size));
+			}
+		}
+
+		sort(taken.begin(), taken.end());
+
+		//
+		// Take the first gap that fits.
+		//
+
+		offset = 0;
+
+		for (const pair<uint64_t, uint64_t>& range : taken) {
+			if (offset + request->size <= range.first) {
+				break;
+			}
+
+			offset = max(offset, align_up(range.second, alignment));
+		}
+
+		plan->offsets[i] = offset;
+		plan->arena_size = max(plan->arena_size, offset + request->size);
+		placed.push_back(i);
+	}
+}
+
+/* BENCHMARK */
+
+void benchmark_suballocator(FILE* out) {
+	const uint64_t heap_size = 1ULL << 30;
+	const uint64_t granularity = 64 * 1024;
+	const unsigned int operations = 200000;
+	const unsigned int max_live = 512;
+	const unsigned int num_transients = 64;
+	const unsigned int num_passes = 32;
+	tlsf_allocator allocator;
+	vector<tlsf_allocation> live;
+	tlsf_allocation allocation;
+	tlsf_stats stats;
+	unsigned int failures;
+	mt19937 rng(12345);
+	uniform_real_distribution<double> log_size(16.0, 23.0);
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+	vector<transient_request> transients;
+	transient_plan plan;
+
+	initialize_tlsf(&allocator, heap_size, granularity);
+
+	//
+	// Churn: sizes from 64 KiB to 8 MiB (log-uniform, like real
+	// buffers), with up to max_live allocations alive and a coin flip
+	// between allocating and freeing a random one.
+	//
+
+	failures = 0;
+	start = chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < operations; i++) {
+		if (live.size() < max_live && (live.empty() || (rng() & 1) == 0)) {
+			uint64_t size = (uint64_t)pow(2.0, log_size(rng));
+			uint64_t alignment = (rng() % 8) == 0 ? 4 * 1024 * 1024 : granularity;
+
+			if (tlsf_allocate(&allocator, size, alignment, &allocation)) {
+				live.push_back(allocation);
+			}
+			else {
+				failures++;
+			}
+		}
+		else {
+			size_t victim = rng() % live.size();
+
+			tlsf_free(&allocator, &live[victim]);
+			live[victim] = live.back();
+			live.pop_back();
+		}
+	}
+
+	elapsed = chrono::steady_clock::now() - start;
+	stats = get_tlsf_stats(&allocator);
+
+	fprintf(out, "TLSF over a %llu MiB heap, %llu KiB granularity\n", (unsigned long long)(heap_size >> 20), (unsigned long long)(granularity >> 10));
+	fprintf(out, "  %u operations: %.1f M ops/s, %u failed\n", operations, operations / elapsed.count() / 1.0e6, failures);
+	fprintf(
+		out,
+		"  after churn: %u live, %.1f MiB used, %u free blocks, largest %.1f MiB, fragmentation %.1f%%\n",
+		stats.allocations,
+		stats.used_bytes / 1048576.0,
+		stats.free_blocks,
+		stats.largest_free_block / 1048576.0,
+		stats.fragmentation * 100.0
+	);
+
+	for (tlsf_allocation& a : live) {
+		tlsf_free(&allocator, &a);
+	}
+
+	stats = get_tlsf_stats(&allocator);
+	fprintf(out, "  after freeing everything: %u free block(s)\n", stats.free_blocks);
+
+	//
+	// Aliasing: random transient buffers, each live for a few passes.
+	//
+
+	for (unsigned int i = 0; i < num_transients; i++) {
+		transient_request request;
+		unsigned int length;
+
+		request.size = align_up((uint64_t)pow(2.0, log_size(rng)), granularity);
+		request.alignment = granularity;
+		request.first_use = rng() % num_passes;
+		length = 1 + rng() % 4;
+		request.last_use = min(request.first_use + length, num_passes - 1);
+
+		transients.push_back(request);
+	}
+
+	start = chrono::steady_clock::now();
+	plan_transient_aliasing(transients.data(), num_transients, &plan);
+	elapsed = chrono::steady_clock::now() - start;
+
+	fprintf(
+		out,
+		"  aliasing %u transient buffers over %u passes: %.1f MiB instead of %.1f MiB (planned in %.3f ms)\n",
+		num_transients,
+		num_passes,
+		plan.arena_size / 1048576.0,
+		plan.unaliased_size / 1048576.0,
+		elapsed.count() * 1000.0
+	);
+}
@@ -0,0 +1,168 @@
+// Liam Wynn, 01/02/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The suballocator hands out ranges of a big block of memory. It only
+	deals in offsets and never touches the memory, so gpu_memory can use
+	it to place resources in an ID3D12Heap, and it builds and runs
+	without DirectX.
+
+	It is a TLSF (two-level segregated fit) allocator. Free blocks are
+	kept in lists by size class: the first level is the power of two
+	below the size, and the second level splits that range into 16
+	steps. Two bitmaps say which lists are non-empty, so finding a block
+	big enough is a couple of bit scans, whatever the number of blocks.
+	Freed blocks merge with free neighbours straight away.
+
+	Every offset and size is a multiple of the granularity. A request
+	with a larger alignment is placed by splitting the padding in front
+	of it back off as a free block.
+
+	The second half plans transient aliasing. Given buffers and the span
+	of passes each is used in, plan_transient_aliasing gives them
+	offsets in one arena so buffers that are never live together share
+	memory.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+const unsigned int TLSF_SECOND_LEVEL_LOG2 = 4;
+const unsigned int TLSF_SECOND_LEVEL_COUNT = 1 << TLSF_SECOND_LEVEL_LOG2;
+const unsigned int TLSF_FIRST_LEVEL_COUNT = 64;
+
+const unsigned int TLSF_INVALID_BLOCK = 0xFFFFFFFF;
+
+struct tlsf_block {
+	uint64_t offset;
+	uint64_t size;
+
+	// Neighbours in memory.
+	unsigned int prev_physical;
+	unsigned int next_physical;
+
+	// Neighbours in the free list. Only used while free.
+	unsigned int prev_free;
+	unsigned int next_free;
+
+	bool free;
+};
+
+struct tlsf_allocator {
+	uint64_t size;
+	uint64_t granularity;
+
+	// Block records. Unused records are chained through next_free
+	// starting at unused_blocks.
+	std::vector<tlsf_block> blocks;
+	unsigned int unused_blocks;
+
+	uint64_t first_level_bitmap;
+	uint32_t second_level_bitmaps[TLSF_FIRST_LEVEL_COUNT];
+	unsigned int free_lists[TLSF_FIRST_LEVEL_COUNT][TLSF_SECOND_LEVEL_COUNT];
+
+	uint64_t used_bytes;
+	unsigned int allocations;
+};
+
+struct tlsf_allocation {
+	uint64_t offset;
+	uint64_t size;
+
+	// TLSF_INVALID_BLOCK for an empty allocation.
+	unsigned int block;
+};
+
+struct tlsf_stats {
+	uint64_t used_bytes;
+	uint64_t free_bytes;
+	uint64_t largest_free_block;
+	unsigned int free_blocks;
+	unsigned int allocations;
+
+	// 1 - largest free block / free bytes. 0 when every free byte is
+	// in one block.
+	double fragmentation;
+};
+
+/*
+	granularity must be a power of two, at least 16. size is rounded
+	down to a multiple of it.
+*/
+void initialize_tlsf(
+	tlsf_allocator* allocator,
+	const uint64_t size,
+	const uint64_t granularity
+);
+
+// alignment must be a power of two. Returns false if nothing fits.
+bool tlsf_allocate(
+	tlsf_allocator* allocator,
+	const uint64_t size,
+	const uint64_t alignment,
+	tlsf_allocation* allocation
+);
+
+void tlsf_free(tlsf_allocator* allocator, tlsf_allocation* allocation);
+
+/*
+	The smallest allocator that can always place one request of size
+	bytes at alignment while it is still empty. This is more than size
+	plus alignment, since the free block search rounds up to the next
+	size class. Used to size a dedicated block.
+*/
+uint64_t tlsf_block_size_for(
+	const uint64_t size,
+	const uint64_t alignment,
+	const uint64_t granularity
+);
+
+tlsf_stats get_tlsf_stats(const tlsf_allocator* allocator);
+
+/* TRANSIENT ALIASING */
+
+/*
+	A buffer that is only needed from pass first_use to pass last_use,
+	inclusive.
+*/
+struct transient_request {
+	uint64_t size;
+	uint64_t alignment;
+	unsigned int first_use;
+	unsigned int last_use;
+};
+
+struct transient_plan {
+	// One per request, relative to the start of the arena.
+	std::vector<uint64_t> offsets;
+	uint64_t arena_size;
+	uint64_t arena_alignment;
+
+	// What the requests would take without aliasing.
+	uint64_t unaliased_size;
+};
+
+/*
+	Biggest buffers first, each at the lowest offset that doesn't
+	overlap a buffer already placed whose passes overlap its own.
+*/
+void plan_transient_aliasing(
+	const transient_request* requests,
+	const unsigned int num_requests,
+	transient_plan* plan
+);
+
+// True if requests a and b may not share memory.
+bool transient_lifetimes_overlap(
+	const transient_request* a,
+	const transient_request* b
+);
+
+/*
+	Random allocate/free workloads against the TLSF allocator. Prints
+	operations per second, the fragmentation it ends with, and how much
+	aliasing saves on random transient lifetimes.
+*/
+void benchmark_suballocator(FILE* out);
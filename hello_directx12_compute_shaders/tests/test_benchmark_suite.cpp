@@ -0,0 +1,316 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "benchmark_suite.h"
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+/*
+	Counts what the suite asks of it, and takes 1, 2, 3, ... ms per
+	phase on the iterations after prepare. Cases wider than refuse_width
+	are refused.
+*/
+struct mock_bench_backend : bench_backend {
+	unsigned int refuse_width;
+	unsigned int prepares;
+	unsigned int releases;
+	unsigned int iterations;
+	unsigned int case_iterations;
+
+	const char* name() override {
+		return "mock";
+	}
+
+	bool prepare(const bench_case* test, string* reason) override {
+		if (test->width > refuse_width) {
+			*reason = "too wide for the mock";
+			return false;
+		}
+
+		prepares++;
+		case_iterations = 0;
+
+		return true;
+	}
+
+	void run_iteration(double seconds[BENCH_PHASE_COUNT]) override {
+		iterations++;
+		case_iterations++;
+
+		for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+			seconds[p] = case_iterations / 1000.0;
+		}
+	}
+
+	void release() override {
+		releases++;
+	}
+};
+
+static bool near(const double a, const double b) {
+	return fabs(a - b) < 1.0e-9;
+}
+
+static string read_file(const string& path) {
+	ifstream file(path);
+	stringstream contents;
+
+	contents << file.rdbuf();
+
+	return contents.str();
+}
+
+static void small_suite_options(bench_suite_options* options) {
+	default_bench_suite_options(options);
+
+	options->sizes = { 16, 32 };
+	options->formats = { BENCH_FORMAT_R32G32B32A32_FLOAT, BENCH_FORMAT_R8G8B8A8_UNORM };
+	options->layouts = { BENCH_LAYOUT_TEXTURE, BENCH_LAYOUT_RAW };
+	options->group_sizes = { { 8, 8 }, { 4, 2 } };
+	options->warmup_iterations = 1;
+	options->iterations = 3;
+
+	// 32x32 float4 is over, 32x32 R8G8B8A8 fits.
+	options->max_buffer_bytes = 32 * 32 * 4;
+}
+
+void test_bench_case_enumeration(test_context* context) {
+	bench_suite_options options;
+	mock_bench_backend backend;
+	vector<bench_result> results;
+	unsigned int run;
+	bool skips_right;
+
+	small_suite_options(&options);
+
+	backend.refuse_width = ~0u;
+	backend.prepares = 0;
+	backend.releases = 0;
+	backend.iterations = 0;
+
+	results = run_bench_suite(&backend, &options, NULL);
+
+	//
+	// Every combination, sizes outermost and group sizes innermost.
+	//
+
+	TEST_CHECK(context, results.size() == 16);
+	TEST_CHECK(context, results[0].test.width == 16 && results[0].test.format == BENCH_FORMAT_R32G32B32A32_FLOAT);
+	TEST_CHECK(context, results[0].test.layout == BENCH_LAYOUT_TEXTURE && results[0].test.group_size_x == 8);
+	TEST_CHECK(context, results[1].test.group_size_x == 4 && results[1].test.group_size_y == 2);
+	TEST_CHECK(context, results[2].test.layout == BENCH_LAYOUT_RAW);
+	TEST_CHECK(context, results[4].test.format == BENCH_FORMAT_R8G8B8A8_UNORM);
+	TEST_CHECK(context, results[8].test.width == 32 && results[8].test.height == 32);
+
+	//
+	// Buffer layouts are float4 only, and 32x32 float4 is over the
+	// budget. Neither reaches the backend.
+	//
+
+	run = 0;
+	skips_right = true;
+
+	for (const bench_result& r : results) {
+		bool buffer_of_other_format;
+		bool over_budget;
+
+		buffer_of_other_format = r.test.layout != BENCH_LAYOUT_TEXTURE && r.test.format != BENCH_FORMAT_R32G32B32A32_FLOAT;
+		over_budget = r.test.width == 32 && r.test.format == BENCH_FORMAT_R32G32B32A32_FLOAT;
+
+		if (buffer_of_other_format) {
+			skips_right = skips_right && r.skipped && r.skip_reason == "buffer layouts are float4 only";
+		}
+		else if (over_budget) {
+			skips_right = skips_right && r.skipped && r.skip_reason == "buffer larger than the memory budget";
+		}
+		else {
+			skips_right = skips_right && !r.skipped && r.backend == "mock";
+			run++;
+		}
+	}
+
+	TEST_CHECK(context, skips_right);
+	TEST_CHECK(context, run == 8);
+	TEST_CHECK(context, backend.prepares == run && backend.releases == run);
+	TEST_CHECK(context, backend.iterations == run * 4);
+
+	//
+	// Warmup is thrown away: the measured iterations took 2, 3 and 4 ms.
+	//
+
+	TEST_CHECK(context, results[0].iterations == 3);
+	TEST_CHECK(context, near(results[0].phases[BENCH_PHASE_COMPUTE].mean_ms, 3.0));
+	TEST_CHECK(context, near(results[0].phases[BENCH_PHASE_COMPUTE].min_ms, 2.0));
+	TEST_CHECK(context, near(results[0].phases[BENCH_PHASE_COMPUTE].max_ms, 4.0));
+	TEST_CHECK(context, near(results[0].phases[BENCH_PHASE_COPY].stddev_ms, 1.0));
+	TEST_CHECK(context, near(results[0].phases[BENCH_PHASE_READBACK].gb_per_second, 16.0 * 16.0 * 16.0 / 0.003 / 1.0e9));
+	TEST_CHECK(context, near(results[0].phases[BENCH_PHASE_READBACK].mpixels_per_second, 16.0 * 16.0 / 0.003 / 1.0e6));
+
+	//
+	// A case the backend refuses is skipped with its reason.
+	//
+
+	backend.refuse_width = 16;
+	results = run_bench_suite(&backend, &options, NULL);
+
+	TEST_CHECK(context, results[12].test.width == 32 && results[12].test.layout == BENCH_LAYOUT_TEXTURE);
+	TEST_CHECK(context, results[12].skipped && results[12].skip_reason == "too wide for the mock");
+}
+
+void test_bench_cpu_backend(test_context* context) {
+	bench_suite_options options;
+	cpu_bench_backend cpu;
+	bench_case test;
+	string reason;
+	double seconds[BENCH_PHASE_COUNT];
+	vector<bench_result> results;
+	const float* texel;
+	bool phases_sane;
+
+	initialize_cpu_bench_backend(&cpu, 2);
+
+	//
+	// A texture's readback rows are padded to the footprint pitch, and
+	// hold what the kernel wrote.
+	//
+
+	test.width = 17;
+	test.height = 9;
+	test.format = BENCH_FORMAT_R32G32B32A32_FLOAT;
+	test.layout = BENCH_LAYOUT_TEXTURE;
+	test.group_size_x = 8;
+	test.group_size_y = 8;
+
+	TEST_CHECK(context, cpu.prepare(&test, &reason));
+	cpu.run_iteration(seconds);
+
+	TEST_CHECK(context, cpu.footprint.row_pitch == 512);
+	TEST_CHECK(context, cpu.readback.size() >= (size_t)cpu.footprint.row_pitch * 8 + 17 * 16);
+
+	texel = reinterpret_cast<const float*>(cpu.readback.data() + (size_t)8 * cpu.footprint.row_pitch + 16 * 16);
+	TEST_CHECK(context, texel[0] == 1.0f && texel[1] == 1.0f && texel[2] == 0.0f && texel[3] == 1.0f);
+
+	texel = reinterpret_cast<const float*>(cpu.readback.data() + (size_t)4 * cpu.footprint.row_pitch + 8 * 16);
+	TEST_CHECK(context, texel[0] == 0.5f && texel[1] == 0.5f);
+
+	cpu.release();
+
+	//
+	// A raw buffer is read back packed.
+	//
+
+	test.layout = BENCH_LAYOUT_RAW;
+
+	TEST_CHECK(context, cpu.prepare(&test, &reason));
+	cpu.run_iteration(seconds);
+
+	TEST_CHECK(context, cpu.footprint.row_pitch == 17 * 16);
+	TEST_CHECK(context, cpu.readback.size() == (size_t)17 * 9 * 16);
+
+	texel = reinterpret_cast<const float*>(cpu.readback.data() + ((size_t)4 * 17 + 8) * 16);
+	TEST_CHECK(context, texel[0] == 0.5f && texel[1] == 0.5f);
+
+	cpu.release();
+
+	//
+	// Through the suite, every format gives numbers that add up.
+	//
+
+	default_bench_suite_options(&options);
+	options.sizes = { 64 };
+	options.layouts = { BENCH_LAYOUT_TEXTURE };
+	options.group_sizes = { { 8, 8 } };
+	options.warmup_iterations = 0;
+	options.iterations = 2;
+
+	results = run_bench_suite(&cpu, &options, NULL);
+	phases_sane = true;
+
+	for (const bench_result& r : results) {
+		phases_sane = phases_sane && !r.skipped && r.backend == "cpu" && r.iterations == 2;
+
+		for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+			const bench_phase_stats& s = r.phases[p];
+
+			phases_sane = phases_sane && s.min_ms >= 0.0 && s.min_ms <= s.mean_ms && s.mean_ms <= s.max_ms;
+		}
+	}
+
+	TEST_CHECK(context, results.size() == BENCH_FORMAT_COUNT);
+	TEST_CHECK(context, phases_sane);
+}
+
+void test_bench_write_results(test_context* context) {
+	bench_suite_options options;
+	mock_bench_backend backend;
+	vector<bench_result> results;
+	string csv_path;
+	string json_path;
+	string csv;
+	string json;
+	unsigned int lines;
+	error_code err;
+
+	small_suite_options(&options);
+	options.sizes = { 16 };
+	options.formats = { BENCH_FORMAT_R8G8B8A8_UNORM };
+	options.group_sizes = { { 8, 8 } };
+
+	backend.refuse_width = ~0u;
+	backend.prepares = 0;
+	backend.releases = 0;
+	backend.iterations = 0;
+
+	// One texture case that runs, one raw case that is skipped.
+	results = run_bench_suite(&backend, &options, NULL);
+	TEST_CHECK(context, results.size() == 2 && !results[0].skipped && results[1].skipped);
+
+	csv_path = (fs::temp_directory_path() / "hello_compute_tests_bench.csv").string();
+	json_path = (fs::temp_directory_path() / "hello_compute_tests_bench.json").string();
+
+	//
+	// The extension picks the format.
+	//
+
+	TEST_CHECK(context, write_bench_results(results, csv_path));
+	TEST_CHECK(context, write_bench_results(results, json_path));
+
+	csv = read_file(csv_path);
+	json = read_file(json_path);
+
+	fs::remove(csv_path, err);
+	fs::remove(json_path, err);
+
+	//
+	// CSV: the header, a row per phase, a row for the skipped case.
+	//
+
+	lines = 0;
+	for (char c : csv) {
+		lines += c == '\n' ? 1 : 0;
+	}
+
+	TEST_CHECK(context, csv.compare(0, 27, "backend,width,height,format") == 0);
+	TEST_CHECK(context, lines == 1 + BENCH_PHASE_COUNT + 1);
+	TEST_CHECK(context, csv.find("mock,16,16,R8G8B8A8_UNORM,texture,8,8,compute,3,3.000000,1.000000,2.000000,4.000000,") != string::npos);
+	TEST_CHECK(context, csv.find("mock,16,16,R8G8B8A8_UNORM,raw,8,8,,0,,,,,,,1\n") != string::npos);
+
+	TEST_CHECK(context, json.compare(0, 13, "{\"results\":[\n") == 0);
+	TEST_CHECK(context, json.find("\"layout\":\"texture\",\"group_x\":8,\"group_y\":8,\"skipped\":false,\"iterations\":3") != string::npos);
+	TEST_CHECK(context, json.find("\"compute\":{\"mean_ms\":3.000000,\"stddev_ms\":1.000000") != string::npos);
+	TEST_CHECK(context, json.find("\"skipped\":true,\"reason\":\"buffer layouts are float4 only\"}") != string::npos);
+	TEST_CHECK(context, json.substr(json.size() - 4) == "\n]}\n");
+
+	//
+	// A file that can't be opened is an error.
+	//
+
+	TEST_CHECK(context, !write_bench_results(results, (fs::temp_directory_path() / "no_such_directory" / "bench.csv").string()));
+}
@@ -0,0 +1,450 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "compute_graph.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static graph_compile_options compile_options(const bool async_compute, const bool async_copy) {
+	graph_compile_options options;
+
+	options.async_compute = async_compute;
+	options.async_copy = async_copy;
+
+	return options;
+}
+
+// Every dependency is on an earlier step.
+static bool deps_come_first(const compiled_graph* compiled) {
+	for (unsigned int s = 0; s < compiled->steps.size(); s++) {
+		for (unsigned int d : compiled->steps[s].deps) {
+			if (d >= s) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static unsigned int count_barriers(
+	const vector<graph_barrier>& barriers,
+	const graph_barrier_kind kind,
+	const unsigned int resource
+) {
+	unsigned int count;
+
+	count = 0;
+
+	for (const graph_barrier& barrier : barriers) {
+		if (barrier.kind == kind && barrier.resource == resource) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/*
+	make a -> use a -> out, with log reading a on the side. unused
+	writes b, and dead read reads it, but nothing needs either.
+*/
+static void build_culling_graph(compute_graph* graph, unsigned int passes[5], unsigned int* b) {
+	unsigned int a;
+	unsigned int out;
+
+	initialize_compute_graph(graph);
+
+	a = add_graph_resource(graph, "a", 1024, 256);
+	*b = add_graph_resource(graph, "b", 1024, 256);
+	out = import_graph_resource(graph, "out", graph_usage_state(GRAPH_USAGE_UNORDERED_ACCESS), false);
+	mark_graph_output(graph, out);
+
+	passes[0] = add_graph_pass(graph, "make a", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(graph, passes[0], a, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	passes[1] = add_graph_pass(graph, "unused", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(graph, passes[1], *b, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	passes[2] = add_graph_pass(graph, "use a", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(graph, passes[2], a, GRAPH_USAGE_SHADER_RESOURCE);
+	add_graph_access(graph, passes[2], out, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	passes[3] = add_graph_pass(graph, "dead read", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(graph, passes[3], *b, GRAPH_USAGE_SHADER_RESOURCE);
+
+	passes[4] = add_graph_pass(graph, "log", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(graph, passes[4], a, GRAPH_USAGE_SHADER_RESOURCE);
+	graph->passes[passes[4]].side_effects = true;
+}
+
+void test_graph_culling(test_context* context) {
+	compute_graph graph;
+	compiled_graph compiled;
+	graph_compile_options options;
+	unsigned int passes[5];
+	unsigned int b;
+	string error;
+
+	build_culling_graph(&graph, passes, &b);
+	options = compile_options(false, false);
+
+	TEST_CHECK(context, compile_compute_graph(&graph, &options, &compiled, &error));
+
+	//
+	// The output's writer and the pass with side effects are kept, with
+	// what they read. Nothing reads b on the way to them.
+	//
+
+	TEST_CHECK(context, compiled.stats.culled_passes == 2);
+	TEST_CHECK(context, compiled.steps.size() == 3);
+	TEST_CHECK(context, compiled.pass_step[passes[0]] != GRAPH_NONE);
+	TEST_CHECK(context, compiled.pass_step[passes[1]] == GRAPH_NONE);
+	TEST_CHECK(context, compiled.pass_step[passes[2]] != GRAPH_NONE);
+	TEST_CHECK(context, compiled.pass_step[passes[3]] == GRAPH_NONE);
+	TEST_CHECK(context, compiled.pass_step[passes[4]] != GRAPH_NONE);
+
+	// A culled pass's resource takes no memory.
+	TEST_CHECK(context, compiled.first_use[b] == GRAPH_NONE);
+	TEST_CHECK(context, compiled.transient_index[b] == GRAPH_NONE);
+
+	//
+	// Reading a transient nothing wrote is an error, not a cull.
+	//
+
+	add_graph_access(&graph, add_graph_pass(&graph, "early", GRAPH_PASS_COMPUTE, 1.0), add_graph_resource(&graph, "never written", 64, 64), GRAPH_USAGE_SHADER_RESOURCE);
+	TEST_CHECK(context, !compile_compute_graph(&graph, &options, &compiled, &error));
+	TEST_CHECK(context, error.find("never written") != string::npos);
+}
+
+void test_graph_topological_order(test_context* context) {
+	compute_graph graph;
+	compiled_graph compiled;
+	graph_compile_options options;
+	unsigned int x;
+	unsigned int y;
+	unsigned int z;
+	unsigned int w;
+	unsigned int passes[4];
+	string error;
+
+	initialize_compute_graph(&graph);
+
+	x = add_graph_resource(&graph, "x", 256, 256);
+	y = add_graph_resource(&graph, "y", 256, 256);
+	z = add_graph_resource(&graph, "z", 256, 256);
+	w = add_graph_resource(&graph, "w", 256, 256);
+	mark_graph_output(&graph, w);
+
+	//
+	// a and b are independent. c only needs a, d needs b and c.
+	//
+
+	passes[0] = add_graph_pass(&graph, "a", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[0], x, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	passes[1] = add_graph_pass(&graph, "b", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[1], y, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	passes[2] = add_graph_pass(&graph, "c", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[2], x, GRAPH_USAGE_SHADER_RESOURCE);
+	add_graph_access(&graph, passes[2], z, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	passes[3] = add_graph_pass(&graph, "d", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[3], y, GRAPH_USAGE_SHADER_RESOURCE);
+	add_graph_access(&graph, passes[3], z, GRAPH_USAGE_SHADER_RESOURCE);
+	add_graph_access(&graph, passes[3], w, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	options = compile_options(false, false);
+	TEST_CHECK(context, compile_compute_graph(&graph, &options, &compiled, &error));
+
+	//
+	// c runs right after a, which made it ready, ahead of b, which was
+	// added first. x is dead by the time y is made.
+	//
+
+	TEST_CHECK(context, compiled.steps.size() == 4);
+	TEST_CHECK(context, compiled.pass_step[passes[0]] == 0);
+	TEST_CHECK(context, compiled.pass_step[passes[2]] == 1);
+	TEST_CHECK(context, compiled.pass_step[passes[1]] == 2);
+	TEST_CHECK(context, compiled.pass_step[passes[3]] == 3);
+	TEST_CHECK(context, deps_come_first(&compiled));
+	TEST_CHECK(context, compiled.steps[3].deps == vector<unsigned int>({ 1, 2 }));
+}
+
+void test_graph_minimal_barriers(test_context* context) {
+	compute_graph graph;
+	compiled_graph compiled;
+	graph_compile_options options;
+	unsigned int r;
+	unsigned int passes[5];
+	string error;
+
+	initialize_compute_graph(&graph);
+
+	r = add_graph_resource(&graph, "r", 4096, 256);
+	mark_graph_output(&graph, r);
+
+	//
+	// Write, two reads, then two writes in a row.
+	//
+
+	passes[0] = add_graph_pass(&graph, "write", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[0], r, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	passes[1] = add_graph_pass(&graph, "read 1", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[1], r, GRAPH_USAGE_SHADER_RESOURCE);
+	graph.passes[passes[1]].side_effects = true;
+
+	passes[2] = add_graph_pass(&graph, "read 2", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[2], r, GRAPH_USAGE_SHADER_RESOURCE);
+	graph.passes[passes[2]].side_effects = true;
+
+	passes[3] = add_graph_pass(&graph, "rewrite 1", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[3], r, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	passes[4] = add_graph_pass(&graph, "rewrite 2", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[4], r, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	options = compile_options(false, false);
+	TEST_CHECK(context, compile_compute_graph(&graph, &options, &compiled, &error));
+	TEST_CHECK(context, compiled.steps.size() == 5);
+
+	//
+	// The transient is made in its first state, so the first write
+	// needs nothing. The run of reads needs one transition, the write
+	// after it another, and the write after that only a UAV barrier.
+	//
+
+	TEST_CHECK(context, compiled.first_state[r] == graph_usage_state(GRAPH_USAGE_UNORDERED_ACCESS));
+	TEST_CHECK(context, compiled.steps[0].before.empty());
+	TEST_CHECK(context, count_barriers(compiled.steps[1].before, GRAPH_BARRIER_TRANSITION, r) == 1);
+	TEST_CHECK(context, compiled.steps[1].before[0].before == graph_usage_state(GRAPH_USAGE_UNORDERED_ACCESS));
+	TEST_CHECK(context, compiled.steps[1].before[0].after == graph_usage_state(GRAPH_USAGE_SHADER_RESOURCE));
+	TEST_CHECK(context, compiled.steps[2].before.empty());
+	TEST_CHECK(context, count_barriers(compiled.steps[3].before, GRAPH_BARRIER_TRANSITION, r) == 1);
+	TEST_CHECK(context, compiled.steps[4].before.size() == 1);
+	TEST_CHECK(context, count_barriers(compiled.steps[4].before, GRAPH_BARRIER_UAV, r) == 1);
+
+	TEST_CHECK(context, compiled.stats.transitions == 2);
+	TEST_CHECK(context, compiled.stats.uav_barriers == 1);
+	TEST_CHECK(context, compiled.stats.barrier_steps == 0);
+
+	// One queue, one batch, nothing to wait for.
+	TEST_CHECK(context, compiled.batches.size() == 1 && compiled.stats.waits == 0);
+}
+
+void test_graph_aliasing(test_context* context) {
+	const uint64_t mib = 1024 * 1024;
+	compute_graph graph;
+	compiled_graph compiled;
+	graph_compile_options options;
+	unsigned int a;
+	unsigned int b;
+	unsigned int c;
+	unsigned int passes[3];
+	uint64_t offset_a;
+	uint64_t offset_b;
+	uint64_t offset_c;
+	string error;
+
+	initialize_compute_graph(&graph);
+
+	a = add_graph_resource(&graph, "a", mib, 65536);
+	b = add_graph_resource(&graph, "b", mib, 65536);
+	c = add_graph_resource(&graph, "c", mib, 65536);
+	mark_graph_output(&graph, c);
+
+	//
+	// a is dead once b is made, so c, made after that, can have its
+	// memory. b is live alongside both.
+	//
+
+	passes[0] = add_graph_pass(&graph, "make a", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[0], a, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	passes[1] = add_graph_pass(&graph, "a to b", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[1], a, GRAPH_USAGE_SHADER_RESOURCE);
+	add_graph_access(&graph, passes[1], b, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	passes[2] = add_graph_pass(&graph, "b to c", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[2], b, GRAPH_USAGE_SHADER_RESOURCE);
+	add_graph_access(&graph, passes[2], c, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	options = compile_options(false, false);
+	TEST_CHECK(context, compile_compute_graph(&graph, &options, &compiled, &error));
+
+	offset_a = compiled.aliasing.offsets[compiled.transient_index[a]];
+	offset_b = compiled.aliasing.offsets[compiled.transient_index[b]];
+	offset_c = compiled.aliasing.offsets[compiled.transient_index[c]];
+
+	TEST_CHECK(context, offset_a == offset_c);
+	TEST_CHECK(context, offset_b + mib <= offset_a || offset_a + mib <= offset_b);
+	TEST_CHECK(context, compiled.aliasing.unaliased_size == 3 * mib);
+	TEST_CHECK(context, compiled.aliasing.arena_size == 2 * mib);
+
+	//
+	// c takes over a's memory with an aliasing barrier, after the last
+	// pass that used a.
+	//
+
+	TEST_CHECK(context, compiled.stats.aliasing_barriers == 1);
+	TEST_CHECK(context, count_barriers(compiled.steps[compiled.pass_step[passes[2]]].before, GRAPH_BARRIER_ALIASING, c) == 1);
+	TEST_CHECK(context, count_barriers(compiled.steps[compiled.pass_step[passes[1]]].before, GRAPH_BARRIER_ALIASING, b) == 0);
+
+	// The output lives to the end, so nothing could take its memory.
+	TEST_CHECK(context, compiled.transient_requests[compiled.transient_index[c]].last_use == compiled.steps.size() - 1);
+}
+
+void test_graph_queue_assignment(test_context* context) {
+	compute_graph graph;
+	compiled_graph compiled;
+	graph_compile_options options;
+	graph_state copy_dest;
+	unsigned int x;
+	unsigned int y;
+	unsigned int z;
+	unsigned int readback;
+	unsigned int snapshot;
+	unsigned int passes[5];
+	bool waits_back;
+	string error;
+
+	initialize_compute_graph(&graph);
+
+	copy_dest = graph_usage_state(GRAPH_USAGE_COPY_DEST);
+
+	x = add_graph_resource(&graph, "x", 256, 256);
+	y = add_graph_resource(&graph, "y", 256, 256);
+	z = add_graph_resource(&graph, "z", 256, 256);
+	readback = import_graph_resource(&graph, "readback", copy_dest, true);
+	snapshot = import_graph_resource(&graph, "snapshot", copy_dest, true);
+	mark_graph_output(&graph, z);
+	mark_graph_output(&graph, readback);
+	mark_graph_output(&graph, snapshot);
+
+	//
+	// root fans out to left and right. left's result is copied out, and
+	// x is copied out alongside the compute passes reading it.
+	//
+
+	passes[0] = add_graph_pass(&graph, "root", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[0], x, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	passes[1] = add_graph_pass(&graph, "left", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[1], x, GRAPH_USAGE_SHADER_RESOURCE);
+	add_graph_access(&graph, passes[1], y, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	passes[2] = add_graph_pass(&graph, "right", GRAPH_PASS_COMPUTE, 1.0);
+	add_graph_access(&graph, passes[2], x, GRAPH_USAGE_SHADER_RESOURCE);
+	add_graph_access(&graph, passes[2], z, GRAPH_USAGE_UNORDERED_ACCESS);
+
+	passes[3] = add_graph_pass(&graph, "copy y", GRAPH_PASS_COPY, 1.0);
+	add_graph_access(&graph, passes[3], y, GRAPH_USAGE_COPY_SOURCE);
+	add_graph_access(&graph, passes[3], readback, GRAPH_USAGE_COPY_DEST);
+
+	passes[4] = add_graph_pass(&graph, "copy x", GRAPH_PASS_COPY, 1.0);
+	add_graph_access(&graph, passes[4], x, GRAPH_USAGE_COPY_SOURCE);
+	add_graph_access(&graph, passes[4], snapshot, GRAPH_USAGE_COPY_DEST);
+
+	//
+	// Without async queues everything is on the direct queue, in one
+	// batch.
+	//
+
+	options = compile_options(false, false);
+	TEST_CHECK(context, compile_compute_graph(&graph, &options, &compiled, &error));
+
+	for (unsigned int p = 0; p < 5; p++) {
+		TEST_CHECK(context, compiled.steps[compiled.pass_step[p]].queue == QUEUE_DIRECT);
+	}
+
+	TEST_CHECK(context, compiled.batches.size() == 1 && compiled.stats.waits == 0);
+
+	//
+	// With them, left carries on root's queue and right branches off to
+	// the idle compute queue. The copy of y goes to the copy queue, but
+	// the copy of x shares its reads with compute passes and stays on
+	// the direct queue.
+	//
+
+	options = compile_options(true, true);
+	TEST_CHECK(context, compile_compute_graph(&graph, &options, &compiled, &error));
+
+	TEST_CHECK(context, compiled.steps[compiled.pass_step[passes[0]]].queue == QUEUE_DIRECT);
+	TEST_CHECK(context, compiled.steps[compiled.pass_step[passes[1]]].queue == QUEUE_DIRECT);
+	TEST_CHECK(context, compiled.steps[compiled.pass_step[passes[2]]].queue == QUEUE_COMPUTE);
+	TEST_CHECK(context, compiled.steps[compiled.pass_step[passes[3]]].queue == QUEUE_COPY);
+	TEST_CHECK(context, compiled.steps[compiled.pass_step[passes[4]]].queue == QUEUE_DIRECT);
+	TEST_CHECK(context, deps_come_first(&compiled));
+
+	//
+	// The compute and copy queues wait on the direct queue, and only on
+	// batches before their own.
+	//
+
+	waits_back = true;
+
+	for (unsigned int b = 0; b < compiled.batches.size(); b++) {
+		for (unsigned int w : compiled.batches[b].waits) {
+			waits_back = waits_back && w < b && compiled.batches[w].queue != compiled.batches[b].queue;
+		}
+	}
+
+	TEST_CHECK(context, waits_back);
+	TEST_CHECK(context, compiled.stats.waits >= 2);
+	TEST_CHECK(context, compiled.batches.size() >= 3);
+}
+
+void test_graph_dot_output(test_context* context) {
+	compute_graph graph;
+	compiled_graph compiled;
+	graph_compile_options options;
+	unsigned int passes[5];
+	unsigned int b;
+	string error;
+	string dot;
+	FILE* file;
+	char buffer[512];
+	size_t read;
+
+	build_culling_graph(&graph, passes, &b);
+	options = compile_options(false, false);
+	TEST_CHECK(context, compile_compute_graph(&graph, &options, &compiled, &error));
+
+	file = tmpfile();
+	TEST_CHECK(context, file != NULL);
+
+	if (file == NULL) {
+		return;
+	}
+
+	write_compute_graph_dot(&graph, &compiled, file);
+	rewind(file);
+
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		dot.append(buffer, read);
+	}
+
+	fclose(file);
+
+	//
+	// Culled passes by pass index, kept ones by step, with their queue
+	// and batch, and an edge per dependency.
+	//
+
+	TEST_CHECK(context, dot.compare(0, 24, "digraph compute_graph {\n") == 0);
+	TEST_CHECK(context, dot.find("\tp1 [label=\"unused\\nculled\", fillcolor=lightgrey") != string::npos);
+	TEST_CHECK(context, dot.find("\tp3 [label=\"dead read\\nculled\"") != string::npos);
+	TEST_CHECK(context, dot.find("\ts0 [label=\"make a\\ndirect, batch 0\\n0 barrier(s)\"") != string::npos);
+	TEST_CHECK(context, dot.find("\\n1 barrier(s)\"") != string::npos);
+	TEST_CHECK(context, dot.find("\ts0 -> s1;\n") != string::npos);
+	TEST_CHECK(context, dot.find("penwidth") == string::npos);
+	TEST_CHECK(context, dot.substr(dot.size() - 2) == "}\n");
+}
+
+void test_compute_graph_self_check(test_context* context) {
+	TEST_CHECK(context, verify_compute_graph(stderr));
+}
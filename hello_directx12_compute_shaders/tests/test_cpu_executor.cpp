@@ -0,0 +1,148 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "cpu_executor.h"
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+/*
+	hello_compute.hlsl for one texel, written the plain way.
+*/
+static void reference_hello_compute(
+	const unsigned int x,
+	const unsigned int y,
+	const unsigned int width,
+	const unsigned int height,
+	float value[4]
+) {
+	value[0] = (float)x / (float)(width - 1);
+	value[1] = (float)y / (float)(height - 1);
+	value[2] = 0.0f;
+	value[3] = 1.0f;
+}
+
+void test_cpu_executor_simd_matches_scalar(test_context* context) {
+	const unsigned int sizes[][2] = { { 3, 5 }, { 13, 7 }, { 37, 19 }, { 127, 9 } };
+	const unsigned int group_sizes[][2] = { { 8, 8 }, { 5, 3 }, { 32, 1 } };
+	const unsigned char padding = 0xCD;
+	cpu_simd_level detected;
+	cpu_executor executor;
+	cpu_footprint footprint;
+	cpu_texture target;
+	cpu_dispatch_desc dispatch;
+	vector<unsigned char> memory;
+	float expected[4];
+	bool texels_match;
+	bool padding_kept;
+
+	detected = detect_cpu_simd_level();
+	initialize_cpu_executor(&executor, 2);
+
+	//
+	// Every level the CPU can run, at sizes that leave a tail the wide
+	// paths can't cover and groups that hang over the edge.
+	//
+
+	for (int level = CPU_SIMD_SCALAR; level <= detected; level++) {
+		executor.simd_level = (cpu_simd_level)level;
+
+		for (const auto& size : sizes) {
+			for (const auto& group : group_sizes) {
+				footprint = cpu_readback_footprint(size[0], size[1], CPU_FLOAT4_SIZE);
+				memory.assign((size_t)footprint.total_size, padding);
+
+				target.data = memory.data();
+				target.width = size[0];
+				target.height = size[1];
+				target.row_pitch = footprint.row_pitch;
+				target.format = CPU_TEXEL_R32G32B32A32_FLOAT;
+
+				dispatch = cpu_dispatch_for_group_size(size[0], size[1], group[0], group[1]);
+				cpu_dispatch_hello_compute(&executor, &target, &dispatch);
+
+				texels_match = true;
+				padding_kept = true;
+
+				for (unsigned int y = 0; y < size[1]; y++) {
+					const unsigned char* row = memory.data() + (size_t)y * footprint.row_pitch;
+
+					for (unsigned int x = 0; x < size[0]; x++) {
+						reference_hello_compute(x, y, size[0], size[1], expected);
+
+						if (memcmp(row + (size_t)x * CPU_FLOAT4_SIZE, expected, CPU_FLOAT4_SIZE) != 0) {
+							texels_match = false;
+						}
+					}
+
+					//
+					// Nothing is written past the end of a row.
+					//
+
+					for (unsigned int b = size[0] * CPU_FLOAT4_SIZE; b < footprint.row_pitch; b++) {
+						if (y + 1 < size[1] && row[b] != padding) {
+							padding_kept = false;
+						}
+					}
+				}
+
+				TEST_CHECK(context, texels_match);
+				TEST_CHECK(context, padding_kept);
+			}
+		}
+	}
+}
+
+void test_cpu_executor_tiled_matches_untiled(test_context* context) {
+	const unsigned int width = 29;
+	const unsigned int height = 11;
+	const unsigned int tile_x = 9;
+	const unsigned int tile_y = 4;
+	const unsigned int tile_width = 13;
+	const unsigned int tile_height = 5;
+	cpu_executor executor;
+	cpu_footprint footprint;
+	cpu_texture target;
+	cpu_dispatch_desc dispatch;
+	vector<unsigned char> memory;
+	float expected[4];
+	bool texels_match;
+
+	initialize_cpu_executor(&executor, 1);
+
+	//
+	// A tile computes its part of the whole image, not an image of its
+	// own size.
+	//
+
+	footprint = cpu_readback_footprint(tile_width, tile_height, CPU_FLOAT4_SIZE);
+	memory.assign((size_t)footprint.total_size, 0);
+
+	target.data = memory.data();
+	target.width = tile_width;
+	target.height = tile_height;
+	target.row_pitch = footprint.row_pitch;
+	target.format = CPU_TEXEL_R32G32B32A32_FLOAT;
+
+	dispatch = cpu_hello_compute_dispatch(tile_width, tile_height);
+	dispatch.origin_x = tile_x;
+	dispatch.origin_y = tile_y;
+	dispatch.image_width = width;
+	dispatch.image_height = height;
+	cpu_dispatch_hello_compute(&executor, &target, &dispatch);
+
+	texels_match = true;
+
+	for (unsigned int y = 0; y < tile_height; y++) {
+		for (unsigned int x = 0; x < tile_width; x++) {
+			reference_hello_compute(tile_x + x, tile_y + y, width, height, expected);
+
+			if (memcmp(memory.data() + (size_t)y * footprint.row_pitch + (size_t)x * CPU_FLOAT4_SIZE, expected, CPU_FLOAT4_SIZE) != 0) {
+				texels_match = false;
+			}
+		}
+	}
+
+	TEST_CHECK(context, texels_match);
+}
@@ -0,0 +1,106 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "descriptor_allocator.h"
+
+void test_descriptor_persistent(test_context* context) {
+	descriptor_allocator allocator;
+	unsigned int a;
+	unsigned int b;
+	unsigned int c;
+
+	initialize_descriptor_allocator(&allocator, 2, 8);
+
+	a = allocate_persistent_descriptor(&allocator);
+	b = allocate_persistent_descriptor(&allocator);
+	TEST_CHECK(context, a == 0 && b == 1);
+	TEST_CHECK(context, allocate_persistent_descriptor(&allocator) == INVALID_DESCRIPTOR_INDEX);
+	TEST_CHECK(context, persistent_descriptors_in_use(&allocator) == 2);
+
+	//
+	// A freed slot comes back, and only once.
+	//
+
+	TEST_CHECK(context, free_persistent_descriptor(&allocator, a));
+	TEST_CHECK(context, !free_persistent_descriptor(&allocator, a));
+	TEST_CHECK(context, !free_persistent_descriptor(&allocator, 5));
+	TEST_CHECK(context, persistent_descriptors_in_use(&allocator) == 1);
+
+	c = allocate_persistent_descriptor(&allocator);
+	TEST_CHECK(context, c == a);
+	TEST_CHECK(context, allocate_persistent_descriptor(&allocator) == INVALID_DESCRIPTOR_INDEX);
+}
+
+void test_descriptor_transient_ring(test_context* context) {
+	descriptor_allocator allocator;
+	unsigned int first;
+	unsigned int second;
+	unsigned int wrapped;
+
+	initialize_descriptor_allocator(&allocator, 4, 8);
+
+	//
+	// Transient indices come after the persistent ones.
+	//
+
+	first = allocate_transient_descriptors(&allocator, 3);
+	TEST_CHECK(context, first == 4);
+	end_transient_frame(&allocator, 1);
+
+	second = allocate_transient_descriptors(&allocator, 3);
+	TEST_CHECK(context, second == 7);
+	end_transient_frame(&allocator, 2);
+	TEST_CHECK(context, transient_descriptors_in_use(&allocator) == 6);
+
+	//
+	// Three more don't fit before the end, and frame 1 still holds the
+	// start.
+	//
+
+	TEST_CHECK(context, allocate_transient_descriptors(&allocator, 3) == INVALID_DESCRIPTOR_INDEX);
+
+	//
+	// Once frame 1 is done, the range wraps to the start and skips the
+	// two slots left at the end.
+	//
+
+	reclaim_transient_descriptors(&allocator, 1);
+	TEST_CHECK(context, transient_descriptors_in_use(&allocator) == 3);
+
+	wrapped = allocate_transient_descriptors(&allocator, 3);
+	TEST_CHECK(context, wrapped == 4);
+	TEST_CHECK(context, transient_descriptors_in_use(&allocator) == 8);
+	end_transient_frame(&allocator, 3);
+
+	reclaim_transient_descriptors(&allocator, 3);
+	TEST_CHECK(context, transient_descriptors_in_use(&allocator) == 0);
+
+	//
+	// More than the ring is never possible.
+	//
+
+	TEST_CHECK(context, allocate_transient_descriptors(&allocator, 9) == INVALID_DESCRIPTOR_INDEX);
+	TEST_CHECK(context, allocate_transient_descriptors(&allocator, 0) == INVALID_DESCRIPTOR_INDEX);
+}
+
+void test_descriptor_empty_frames(test_context* context) {
+	descriptor_allocator allocator;
+
+	initialize_descriptor_allocator(&allocator, 0, 8);
+
+	allocate_transient_descriptors(&allocator, 4);
+	end_transient_frame(&allocator, 1);
+
+	//
+	// Frames that allocated nothing move the mark to their fence.
+	//
+
+	end_transient_frame(&allocator, 2);
+	end_transient_frame(&allocator, 3);
+
+	reclaim_transient_descriptors(&allocator, 2);
+	TEST_CHECK(context, transient_descriptors_in_use(&allocator) == 4);
+
+	reclaim_transient_descriptors(&allocator, 3);
+	TEST_CHECK(context, transient_descriptors_in_use(&allocator) == 0);
+}
@@ -0,0 +1,282 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "device_set.h"
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static bool bands_cover(const vector<split_band>& bands, const unsigned int group_rows) {
+	unsigned int next;
+
+	next = 0;
+
+	for (const split_band& band : bands) {
+		if (band.first_group_y != next) {
+			return false;
+		}
+
+		next += band.group_count_y;
+	}
+
+	return next == group_rows;
+}
+
+void test_device_split_plan(test_context* context) {
+	cpu_compute_device fast;
+	cpu_compute_device slow;
+	vector<compute_device*> devices;
+	device_set set;
+	vector<split_band> bands;
+
+	initialize_cpu_compute_device(&fast, 1, 1.0);
+	initialize_cpu_compute_device(&slow, 1, 3.0);
+	devices.push_back(&fast);
+	devices.push_back(&slow);
+
+	//
+	// Nothing known: an even split.
+	//
+
+	initialize_device_set(&set, devices, NULL);
+	bands = plan_split(&set, 10);
+	TEST_CHECK(context, bands.size() == 2);
+	TEST_CHECK(context, bands_cover(bands, 10));
+	TEST_CHECK(context, bands[0].group_count_y == 5);
+
+	//
+	// 1:3 of 10 rows is 2.5 and 7.5. The tie on the leftover row goes
+	// to the first device.
+	//
+
+	set.throughput[0] = 1.0;
+	set.throughput[1] = 3.0;
+	bands = plan_split(&set, 10);
+	TEST_CHECK(context, bands_cover(bands, 10));
+	TEST_CHECK(context, bands[0].group_count_y == 3 && bands[1].group_count_y == 7);
+
+	//
+	// A device too slow for even one row by share still gets one, so
+	// it keeps being measured. The rest goes by share.
+	//
+
+	set.throughput[0] = 1.0;
+	set.throughput[1] = 1000.0;
+	bands = plan_split(&set, 4);
+	TEST_CHECK(context, bands_cover(bands, 4));
+	TEST_CHECK(context, bands[0].group_count_y == 1 && bands[1].group_count_y == 3);
+
+	//
+	// With fewer rows than devices, someone has to go without.
+	//
+
+	bands = plan_split(&set, 1);
+	TEST_CHECK(context, bands_cover(bands, 1));
+	TEST_CHECK(context, bands[0].group_count_y == 0 && bands[1].group_count_y == 1);
+}
+
+void test_device_split_dispatch(test_context* context) {
+	const unsigned int width = 96;
+	const unsigned int height = 80;
+	cpu_compute_device first;
+	cpu_compute_device second;
+	vector<compute_device*> devices;
+	device_set set;
+	split_dispatch_stats stats;
+	cpu_executor executor;
+	cpu_footprint footprint;
+	cpu_texture target;
+	cpu_dispatch_desc dispatch;
+	vector<unsigned char> split;
+	vector<unsigned char> whole;
+
+	initialize_cpu_compute_device(&first, 1, 1.0);
+	initialize_cpu_compute_device(&second, 1, 2.0);
+	devices.push_back(&first);
+	devices.push_back(&second);
+	initialize_device_set(&set, devices, NULL);
+
+	footprint = cpu_readback_footprint(width, height, CPU_FLOAT4_SIZE);
+	dispatch = cpu_hello_compute_dispatch(width, height);
+
+	target.width = width;
+	target.height = height;
+	target.row_pitch = footprint.row_pitch;
+	target.format = CPU_TEXEL_R32G32B32A32_FLOAT;
+
+	split.assign((size_t)footprint.total_size, 0);
+	target.data = split.data();
+	stats = run_split_dispatch(&set, &dispatch, &target);
+
+	TEST_CHECK(context, bands_cover(stats.bands, dispatch.group_count_y));
+	TEST_CHECK(context, stats.seconds.size() == 2);
+	TEST_CHECK(context, stats.makespan > 0.0);
+	TEST_CHECK(context, set.dispatches == 1);
+
+	//
+	// The bands gather into exactly what one dispatch writes.
+	//
+
+	initialize_cpu_executor(&executor, 1);
+	whole.assign((size_t)footprint.total_size, 0);
+	target.data = whole.data();
+	cpu_dispatch_hello_compute(&executor, &target, &dispatch);
+
+	TEST_CHECK(context, split == whole);
+}
+
+void test_device_cached_throughput(test_context* context) {
+	const unsigned int width = 64;
+	const unsigned int height = 64;
+	cpu_compute_device cached;
+	cpu_compute_device guessed;
+	vector<compute_device*> devices;
+	device_probe_cache cache;
+	device_probe probe;
+	device_set set;
+	split_dispatch_stats stats;
+	cpu_footprint footprint;
+	cpu_texture target;
+	cpu_dispatch_desc dispatch;
+	vector<unsigned char> output;
+	double measured[2];
+	double before;
+
+	initialize_cpu_compute_device(&cached, 1, 1.0);
+	initialize_cpu_compute_device(&guessed, 1, 2.0);
+	devices.push_back(&cached);
+	devices.push_back(&guessed);
+
+	cache.dirty = false;
+	probe.usable = true;
+	probe.throughput = 1.0e6;
+	store_device_probe(&cache, cached.probe_key(), &probe);
+
+	initialize_device_set(&set, devices, &cache);
+	TEST_CHECK(context, set.known[0] && !set.known[1]);
+
+	footprint = cpu_readback_footprint(width, height, CPU_FLOAT4_SIZE);
+	dispatch = cpu_hello_compute_dispatch(width, height);
+	output.assign((size_t)footprint.total_size, 0);
+
+	target.data = output.data();
+	target.width = width;
+	target.height = height;
+	target.row_pitch = footprint.row_pitch;
+	target.format = CPU_TEXEL_R32G32B32A32_FLOAT;
+
+	//
+	// The first dispatch blends into the cached number, but replaces
+	// the guess.
+	//
+
+	stats = run_split_dispatch(&set, &dispatch, &target);
+	TEST_CHECK(context, stats.bands[0].group_count_y > 0 && stats.bands[1].group_count_y > 0);
+
+	for (int i = 0; i < 2; i++) {
+		measured[i] = stats.seconds[i] > 0.0 ? stats.bands[i].group_count_y / stats.seconds[i] : 0.0;
+	}
+
+	TEST_CHECK(context, set.throughput[0] == 0.5 * 1.0e6 + 0.5 * measured[0]);
+	TEST_CHECK(context, set.throughput[1] == measured[1]);
+	TEST_CHECK(context, set.known[0] && set.known[1]);
+
+	//
+	// From then on both blend.
+	//
+
+	before = set.throughput[1];
+	stats = run_split_dispatch(&set, &dispatch, &target);
+	measured[1] = stats.bands[1].group_count_y / stats.seconds[1];
+	TEST_CHECK(context, set.throughput[1] == 0.5 * before + 0.5 * measured[1]);
+}
+
+void test_device_speeds(test_context* context) {
+	vector<double> slowdowns;
+
+	TEST_CHECK(context, parse_device_speeds("1,2.5,4", &slowdowns));
+	TEST_CHECK(context, slowdowns.size() == 3 && slowdowns[1] == 2.5);
+
+	TEST_CHECK(context, parse_device_speeds("1", &slowdowns));
+	TEST_CHECK(context, slowdowns.size() == 1);
+
+	TEST_CHECK(context, !parse_device_speeds("", &slowdowns));
+	TEST_CHECK(context, !parse_device_speeds("0.5", &slowdowns));
+	TEST_CHECK(context, !parse_device_speeds("1,", &slowdowns));
+	TEST_CHECK(context, !parse_device_speeds("1;2", &slowdowns));
+}
+
+void test_device_probe_cache(test_context* context) {
+	string path;
+	device_probe_cache cache;
+	device_probe_cache loaded;
+	device_probe probe;
+	cpu_compute_device first;
+	cpu_compute_device second;
+	vector<compute_device*> devices;
+	device_set set;
+	error_code err;
+
+	path = (fs::temp_directory_path() / "hello_compute_tests_probes.txt").string();
+	fs::remove(path, err);
+
+	//
+	// A missing file is an empty cache.
+	//
+
+	load_device_probe_cache(&cache, path);
+	TEST_CHECK(context, cache.entries.empty());
+	TEST_CHECK(context, !find_device_probe(&cache, "anything", &probe));
+
+	initialize_cpu_compute_device(&first, 1, 1.0);
+	initialize_cpu_compute_device(&second, 1, 2.0);
+
+	probe.usable = true;
+	probe.throughput = 1500.0;
+	store_device_probe(&cache, first.probe_key(), &probe);
+
+	probe.usable = false;
+	probe.throughput = 0.0;
+	store_device_probe(&cache, "adapter-that-failed", &probe);
+
+	TEST_CHECK(context, save_device_probe_cache(&cache));
+	TEST_CHECK(context, !fs::exists(path + ".tmp"));
+
+	load_device_probe_cache(&loaded, path);
+	TEST_CHECK(context, loaded.entries.size() == 2);
+	TEST_CHECK(context, find_device_probe(&loaded, first.probe_key(), &probe));
+	TEST_CHECK(context, probe.usable && probe.throughput == 1500.0);
+	TEST_CHECK(context, find_device_probe(&loaded, "adapter-that-failed", &probe));
+	TEST_CHECK(context, !probe.usable);
+
+	//
+	// A device the cache knows starts at its throughput, and one it
+	// doesn't at the mean of the known ones.
+	//
+
+	devices.push_back(&first);
+	devices.push_back(&second);
+	initialize_device_set(&set, devices, &loaded);
+	TEST_CHECK(context, set.throughput[0] == 1500.0);
+	TEST_CHECK(context, set.throughput[1] == 1500.0);
+
+	//
+	// Saving again replaces the old file whole.
+	//
+
+	probe.usable = true;
+	probe.throughput = 750.0;
+	store_device_probe(&loaded, "adapter-that-failed", &probe);
+	TEST_CHECK(context, save_device_probe_cache(&loaded));
+	TEST_CHECK(context, !fs::exists(path + ".tmp"));
+
+	load_device_probe_cache(&cache, path);
+	TEST_CHECK(context, cache.entries.size() == 2);
+	TEST_CHECK(context, find_device_probe(&cache, "adapter-that-failed", &probe));
+	TEST_CHECK(context, probe.usable && probe.throughput == 750.0);
+
+	fs::remove(path, err);
+}
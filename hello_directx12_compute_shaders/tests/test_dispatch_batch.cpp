@@ -0,0 +1,161 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "dispatch_batch.h"
+#include <vector>
+
+using namespace std;
+
+static dispatch_batch_entry make_entry(
+	const void* root_signature,
+	const void* pipeline,
+	const void* read,
+	const void* written
+) {
+	dispatch_batch_entry entry;
+	dispatch_resource_use use;
+
+	entry.root_signature = root_signature;
+	entry.pipeline = pipeline;
+
+	if (read != NULL) {
+		use.resource = read;
+		use.writes = false;
+		entry.resources.push_back(use);
+	}
+
+	if (written != NULL) {
+		use.resource = written;
+		use.writes = true;
+		entry.resources.push_back(use);
+	}
+
+	return entry;
+}
+
+static vector<size_t> plan_order(const dispatch_batch_plan* plan) {
+	vector<size_t> order;
+
+	for (const planned_dispatch& dispatch : plan->order) {
+		order.push_back(dispatch.entry);
+	}
+
+	return order;
+}
+
+void test_batch_groups_independent_pipelines(test_context* context) {
+	char root_signature;
+	char pipelines[2];
+	char resources[4];
+	vector<dispatch_batch_entry> entries;
+	dispatch_batch_plan plan;
+	dispatch_batch_plan in_order;
+
+	//
+	// Four dispatches on their own resources, alternating pipelines.
+	// Nothing depends on anything, so the planner is free to put the
+	// two pipelines together, and no barriers are needed.
+	//
+
+	for (int i = 0; i < 4; i++) {
+		entries.push_back(make_entry(&root_signature, &pipelines[i % 2], NULL, &resources[i]));
+	}
+
+	plan_dispatch_batch(entries, &plan);
+	plan_dispatch_batch_in_order(entries, &in_order);
+
+	TEST_CHECK(context, plan_order(&plan) == vector<size_t>({ 0, 2, 1, 3 }));
+	TEST_CHECK(context, plan.pipeline_changes == 2);
+	TEST_CHECK(context, plan.root_signature_changes == 1);
+	TEST_CHECK(context, plan.uav_barriers == 0);
+
+	TEST_CHECK(context, plan.order[0].set_pipeline && plan.order[0].set_root_signature);
+	TEST_CHECK(context, !plan.order[1].set_pipeline && !plan.order[1].set_root_signature);
+	TEST_CHECK(context, plan.order[2].set_pipeline && !plan.order[2].set_root_signature);
+
+	TEST_CHECK(context, plan_order(&in_order) == vector<size_t>({ 0, 1, 2, 3 }));
+	TEST_CHECK(context, in_order.pipeline_changes == 4);
+	TEST_CHECK(context, in_order.uav_barriers == 0);
+}
+
+void test_batch_chain_barriers(test_context* context) {
+	char root_signatures[2];
+	char pipelines[2];
+	char resources[2];
+	vector<dispatch_batch_entry> entries;
+	dispatch_batch_plan plan;
+
+	//
+	// 0 writes a, 1 reads a and writes b, 2 reads b. Each one depends
+	// on the one before, so they keep their order even though that
+	// switches pipelines twice, and each waits on exactly the resource
+	// it reads.
+	//
+
+	entries.push_back(make_entry(&root_signatures[0], &pipelines[0], NULL, &resources[0]));
+	entries.push_back(make_entry(&root_signatures[1], &pipelines[1], &resources[0], &resources[1]));
+	entries.push_back(make_entry(&root_signatures[0], &pipelines[0], &resources[1], NULL));
+
+	plan_dispatch_batch(entries, &plan);
+
+	TEST_CHECK(context, plan_order(&plan) == vector<size_t>({ 0, 1, 2 }));
+	TEST_CHECK(context, plan.order[0].uav_barriers.empty());
+	TEST_CHECK(context, plan.order[1].uav_barriers == vector<const void*>({ &resources[0] }));
+	TEST_CHECK(context, plan.order[2].uav_barriers == vector<const void*>({ &resources[1] }));
+	TEST_CHECK(context, plan.uav_barriers == 2);
+	TEST_CHECK(context, plan.pipeline_changes == 3 && plan.root_signature_changes == 3);
+}
+
+void test_batch_read_and_write_hazards(test_context* context) {
+	char root_signature;
+	char pipeline;
+	char resource;
+	vector<dispatch_batch_entry> entries;
+	dispatch_batch_plan plan;
+
+	//
+	// Two reads of the same resource don't need a barrier between them.
+	// A write after them does, and has to come after both.
+	//
+
+	entries.push_back(make_entry(&root_signature, &pipeline, &resource, NULL));
+	entries.push_back(make_entry(&root_signature, &pipeline, &resource, NULL));
+	entries.push_back(make_entry(&root_signature, &pipeline, NULL, &resource));
+
+	plan_dispatch_batch(entries, &plan);
+
+	TEST_CHECK(context, plan_order(&plan) == vector<size_t>({ 0, 1, 2 }));
+	TEST_CHECK(context, plan.order[1].uav_barriers.empty());
+	TEST_CHECK(context, plan.order[2].uav_barriers == vector<const void*>({ &resource }));
+	TEST_CHECK(context, plan.uav_barriers == 1);
+}
+
+void test_batch_moves_independent_work_ahead_of_barriers(test_context* context) {
+	char root_signature;
+	char pipeline;
+	char resources[2];
+	vector<dispatch_batch_entry> entries;
+	dispatch_batch_plan plan;
+	dispatch_batch_plan in_order;
+
+	//
+	// 1 reads what 0 wrote. 2 is on a resource of its own, so it goes
+	// between them, where it runs without a barrier, and the barrier
+	// for 1 is only on the resource 0 wrote.
+	//
+
+	entries.push_back(make_entry(&root_signature, &pipeline, NULL, &resources[0]));
+	entries.push_back(make_entry(&root_signature, &pipeline, &resources[0], NULL));
+	entries.push_back(make_entry(&root_signature, &pipeline, NULL, &resources[1]));
+
+	plan_dispatch_batch(entries, &plan);
+	plan_dispatch_batch_in_order(entries, &in_order);
+
+	TEST_CHECK(context, plan_order(&plan) == vector<size_t>({ 0, 2, 1 }));
+	TEST_CHECK(context, plan.order[1].uav_barriers.empty());
+	TEST_CHECK(context, plan.order[2].uav_barriers == vector<const void*>({ &resources[0] }));
+	TEST_CHECK(context, plan.uav_barriers == 1);
+
+	TEST_CHECK(context, in_order.order[1].uav_barriers == vector<const void*>({ &resources[0] }));
+	TEST_CHECK(context, in_order.order[2].uav_barriers.empty());
+}
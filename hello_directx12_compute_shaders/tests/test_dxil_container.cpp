@@ -0,0 +1,8 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "dxil_container.h"
+
+void test_dxil_container_self_check(test_context* context) {
+	TEST_CHECK(context, verify_dxil_compile_path(stderr));
+}
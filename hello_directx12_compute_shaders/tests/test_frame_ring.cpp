@@ -0,0 +1,98 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "frame_ring.h"
+
+void test_mock_fence_timeline(test_context* context) {
+	mock_fence_timeline timeline;
+
+	TEST_CHECK(context, timeline.signal() == 1);
+	TEST_CHECK(context, timeline.signal() == 2);
+	TEST_CHECK(context, timeline.completed_value() == 0);
+
+	//
+	// Never past what was signaled.
+	//
+
+	timeline.complete_up_to(5);
+	TEST_CHECK(context, timeline.completed_value() == 2);
+
+	timeline.complete_up_to(1);
+	TEST_CHECK(context, timeline.completed_value() == 2);
+
+	//
+	// A wait that is already satisfied doesn't block.
+	//
+
+	timeline.wait_for(2);
+	TEST_CHECK(context, timeline.blocking_waits == 0);
+
+	timeline.signal();
+	timeline.wait_for(3);
+	TEST_CHECK(context, timeline.blocking_waits == 1);
+	TEST_CHECK(context, timeline.completed_value() == 3);
+}
+
+void test_frame_ring_overlap(test_context* context) {
+	mock_fence_timeline timeline;
+	frame_ring ring;
+	frame_ring_stats stats;
+
+	initialize_frame_ring(&ring, &timeline, 3);
+
+	//
+	// The first three batches each get a fresh slot without waiting.
+	//
+
+	for (unsigned int i = 0; i < 3; i++) {
+		TEST_CHECK(context, begin_frame(&ring) == i);
+		TEST_CHECK(context, end_frame(&ring) == i + 1);
+	}
+
+	TEST_CHECK(context, timeline.blocking_waits == 0);
+
+	//
+	// The fourth wraps to slot 0, whose batch the GPU hasn't finished.
+	//
+
+	TEST_CHECK(context, begin_frame(&ring) == 0);
+	TEST_CHECK(context, timeline.blocking_waits == 1);
+	TEST_CHECK(context, timeline.completed_value() == 1);
+	end_frame(&ring);
+
+	//
+	// With the GPU ahead, no more waits.
+	//
+
+	timeline.complete_up_to(4);
+	begin_frame(&ring);
+	end_frame(&ring);
+	TEST_CHECK(context, timeline.blocking_waits == 1);
+
+	stats = get_frame_ring_stats(&ring);
+	TEST_CHECK(context, stats.batches == 5);
+	TEST_CHECK(context, stats.blocking_begins == 1);
+	TEST_CHECK(context, stats.overlap > 0.79 && stats.overlap < 0.81);
+
+	flush_frame_ring(&ring);
+	TEST_CHECK(context, timeline.completed_value() == 5);
+}
+
+void test_frame_ring_depth_one(test_context* context) {
+	mock_fence_timeline timeline;
+	frame_ring ring;
+
+	//
+	// A depth of 0 is taken as 1: every batch waits for the one before.
+	//
+
+	initialize_frame_ring(&ring, &timeline, 0);
+	TEST_CHECK(context, ring.depth == 1);
+
+	for (unsigned int i = 0; i < 4; i++) {
+		TEST_CHECK(context, begin_frame(&ring) == 0);
+		end_frame(&ring);
+	}
+
+	TEST_CHECK(context, timeline.blocking_waits == 3);
+}
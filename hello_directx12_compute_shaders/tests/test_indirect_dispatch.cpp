@@ -0,0 +1,8 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "indirect_dispatch.h"
+
+void test_indirect_dispatch_self_check(test_context* context) {
+	TEST_CHECK(context, verify_indirect_dispatch(stderr));
+}
@@ -0,0 +1,92 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "job_runner.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void test_job_manifest_defaults(test_context* context) {
+	vector<job_desc> jobs;
+	string error;
+
+	TEST_CHECK(context, parse_job_manifest("[ { \"width\": 64, \"height\": 32 } ]", &jobs, &error));
+	TEST_CHECK(context, jobs.size() == 1);
+
+	if (jobs.size() != 1) {
+		return;
+	}
+
+	TEST_CHECK(context, jobs[0].name == "job 0");
+	TEST_CHECK(context, jobs[0].kernel == DEFAULT_JOB_KERNEL);
+	TEST_CHECK(context, jobs[0].entry_point == DEFAULT_JOB_ENTRY_POINT);
+	TEST_CHECK(context, jobs[0].width == 64 && jobs[0].height == 32);
+	TEST_CHECK(context, jobs[0].format == CPU_TEXEL_R32G32B32A32_FLOAT);
+	TEST_CHECK(context, jobs[0].iterations == 1);
+	TEST_CHECK(context, jobs[0].output.empty());
+}
+
+void test_job_manifest_object(test_context* context) {
+	vector<job_desc> jobs;
+	string error;
+	const char* manifest =
+		"{ \"jobs\": [\n"
+		"  { \"name\": \"small\", \"width\": 8, \"height\": 8, \"format\": \"R8G8B8A8_UNORM\",\n"
+		"    \"iterations\": 3, \"output\": \"small.raw\" },\n"
+		"  { \"kernel\": \"kernels/blur.hlsl\", \"entry\": \"blur\", \"width\": 16, \"height\": 4 }\n"
+		"] }";
+
+	TEST_CHECK(context, parse_job_manifest(manifest, &jobs, &error));
+	TEST_CHECK(context, jobs.size() == 2);
+
+	if (jobs.size() != 2) {
+		return;
+	}
+
+	TEST_CHECK(context, jobs[0].name == "small");
+	TEST_CHECK(context, jobs[0].format == CPU_TEXEL_R8G8B8A8_UNORM);
+	TEST_CHECK(context, jobs[0].iterations == 3);
+	TEST_CHECK(context, jobs[0].output == "small.raw");
+	TEST_CHECK(context, jobs[1].name == "job 1");
+	TEST_CHECK(context, jobs[1].kernel == "kernels/blur.hlsl" && jobs[1].entry_point == "blur");
+}
+
+void test_job_manifest_errors(test_context* context) {
+	vector<job_desc> jobs;
+	string error;
+
+	//
+	// A typo is an error, not a default.
+	//
+
+	TEST_CHECK(context, !parse_job_manifest("[ { \"width\": 8, \"height\": 8, \"widht\": 16 } ]", &jobs, &error));
+	TEST_CHECK(context, error.find("unknown key widht") != string::npos);
+	TEST_CHECK(context, jobs.empty());
+
+	TEST_CHECK(context, !parse_job_manifest("[ { \"height\": 8 } ]", &jobs, &error));
+	TEST_CHECK(context, error.find("width and height are required") != string::npos);
+
+	TEST_CHECK(context, !parse_job_manifest("[ { \"width\": 8.5, \"height\": 8 } ]", &jobs, &error));
+	TEST_CHECK(context, !parse_job_manifest("[ { \"width\": 8, \"height\": 8, \"format\": \"R2D2\" } ]", &jobs, &error));
+	TEST_CHECK(context, !parse_job_manifest("[ 5 ]", &jobs, &error));
+	TEST_CHECK(context, !parse_job_manifest("{ \"tasks\": [] }", &jobs, &error));
+	TEST_CHECK(context, !parse_job_manifest("[ { \"width\": 8, \"height\": 8 } ] extra", &jobs, &error));
+	TEST_CHECK(context, !parse_job_manifest("[ { \"width\": 8,", &jobs, &error));
+}
+
+void test_job_hello_compute_kernel(test_context* context) {
+	job_desc job;
+
+	job.kernel = "./hello_compute.hlsl";
+	TEST_CHECK(context, is_hello_compute_kernel(&job));
+
+	job.kernel = "C:\\shaders\\hello_compute.hlsl";
+	TEST_CHECK(context, is_hello_compute_kernel(&job));
+
+	job.kernel = "hello_compute.hlsl";
+	TEST_CHECK(context, is_hello_compute_kernel(&job));
+
+	job.kernel = "kernels/not_hello_compute.hlsl";
+	TEST_CHECK(context, !is_hello_compute_kernel(&job));
+}
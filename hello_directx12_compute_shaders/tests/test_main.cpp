@@ -0,0 +1,189 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+static const test_case TEST_CASES[] = {
+	{ "cpu_executor.simd_matches_scalar", test_cpu_executor_simd_matches_scalar },
+	{ "cpu_executor.tiled_matches_untiled", test_cpu_executor_tiled_matches_untiled },
+	{ "result_formatter.matches_printf", test_formatter_matches_printf },
+	{ "result_formatter.summary", test_formatter_summary },
+	{ "descriptor_allocator.persistent", test_descriptor_persistent },
+	{ "descriptor_allocator.transient_ring", test_descriptor_transient_ring },
+	{ "descriptor_allocator.empty_frames", test_descriptor_empty_frames },
+	{ "frame_ring.mock_fence_timeline", test_mock_fence_timeline },
+	{ "frame_ring.overlap", test_frame_ring_overlap },
+	{ "frame_ring.depth_one", test_frame_ring_depth_one },
+	{ "queue_scheduler.waits", test_queue_waits },
+	{ "queue_scheduler.signals", test_queue_signals },
+	{ "queue_scheduler.simulation", test_queue_simulation },
+	{ "queue_scheduler.deadlock", test_queue_deadlock },
+	{ "shader_cache.hashing", test_cache_hashing },
+	{ "shader_cache.keys", test_cache_keys },
+	{ "shader_cache.round_trip", test_cache_round_trip },
+	{ "dispatch_batch.groups_independent_pipelines", test_batch_groups_independent_pipelines },
+	{ "dispatch_batch.chain_barriers", test_batch_chain_barriers },
+	{ "dispatch_batch.read_and_write_hazards", test_batch_read_and_write_hazards },
+	{ "dispatch_batch.moves_independent_work_ahead_of_barriers", test_batch_moves_independent_work_ahead_of_barriers },
+	{ "resource_state_tracker.transitions", test_tracker_transitions },
+	{ "resource_state_tracker.uav_barriers", test_tracker_uav_barriers },
+	{ "resource_state_tracker.merging", test_tracker_merging },
+	{ "resource_state_tracker.split_barriers", test_tracker_split_barriers },
+	{ "resource_state_tracker.subresources", test_tracker_subresources },
+	{ "resource_state_tracker.untrack_and_assume", test_tracker_untrack_and_assume },
+	{ "profiler.percentile", test_profiler_percentile },
+	{ "profiler.summary", test_profiler_summary },
+	{ "profiler.chrome_trace", test_profiler_chrome_trace },
+	{ "profiler.thread_tracks", test_profiler_thread_tracks },
+	{ "benchmark_suite.case_enumeration", test_bench_case_enumeration },
+	{ "benchmark_suite.cpu_backend", test_bench_cpu_backend },
+	{ "benchmark_suite.write_results", test_bench_write_results },
+	{ "shader_layout.parse", test_layout_parse },
+	{ "shader_layout.build", test_layout_build },
+	{ "shader_layout.overflow", test_layout_overflow },
+	{ "shader_layout.find_binding", test_layout_find_binding },
+	{ "shader_layout.dispatch_size", test_layout_dispatch_size },
+	{ "suballocator.tlsf_allocate_free", test_tlsf_allocate_free },
+	{ "suballocator.tlsf_merging", test_tlsf_merging },
+	{ "suballocator.tlsf_dedicated_block", test_tlsf_dedicated_block },
+	{ "suballocator.transient_aliasing", test_transient_aliasing },
+	{ "upload_ring.frames", test_upload_ring_frames },
+	{ "upload_ring.too_big", test_upload_ring_too_big },
+	{ "upload_ring.pitched_rows", test_upload_pitched_rows },
+	{ "readback_ring.in_order", test_readback_in_order },
+	{ "readback_ring.dropping", test_readback_dropping },
+	{ "tiler.grid", test_tiler_grid },
+	{ "tiler.matches_single_dispatch", test_tiler_matches_single_dispatch },
+	{ "tiler.image_size", test_tiler_image_size },
+	{ "readback_decoder.self_check", test_readback_decoder_self_check },
+	{ "device_set.split_plan", test_device_split_plan },
+	{ "device_set.split_dispatch", test_device_split_dispatch },
+	{ "device_set.cached_throughput", test_device_cached_throughput },
+	{ "device_set.speeds", test_device_speeds },
+	{ "device_set.probe_cache", test_device_probe_cache },
+	{ "job_runner.manifest_defaults", test_job_manifest_defaults },
+	{ "job_runner.manifest_object", test_job_manifest_object },
+	{ "job_runner.manifest_errors", test_job_manifest_errors },
+	{ "job_runner.hello_compute_kernel", test_job_hello_compute_kernel },
+	{ "compute_graph.culling", test_graph_culling },
+	{ "compute_graph.topological_order", test_graph_topological_order },
+	{ "compute_graph.minimal_barriers", test_graph_minimal_barriers },
+	{ "compute_graph.aliasing", test_graph_aliasing },
+	{ "compute_graph.queue_assignment", test_graph_queue_assignment },
+	{ "compute_graph.dot_output", test_graph_dot_output },
+	{ "compute_graph.self_check", test_compute_graph_self_check },
+	{ "recording_pool.self_check", test_recording_pool_self_check },
+	{ "indirect_dispatch.self_check", test_indirect_dispatch_self_check },
+	{ "shader_permutations.self_check", test_shader_permutations_self_check },
+	{ "threadgroup_tuner.self_check", test_threadgroup_tuner_self_check },
+	{ "dxil_container.self_check", test_dxil_container_self_check },
+};
+
+static const size_t NUM_TEST_CASES = sizeof(TEST_CASES) / sizeof(TEST_CASES[0]);
+
+void report_test_check(
+	test_context* context,
+	const bool passed,
+	const char* file,
+	const int line,
+	const char* what
+) {
+	context->checks++;
+
+	if (passed) {
+		return;
+	}
+
+	context->failures++;
+	cerr << file << ":" << line << ": " << context->name << ": failed: " << what << endl;
+}
+
+/*
+	"module" selects every test of that module, "module.test" just the
+	one.
+*/
+static bool test_matches(const char* name, const char* pattern) {
+	size_t length;
+
+	length = strlen(pattern);
+
+	return strncmp(name, pattern, length) == 0
+		&& (name[length] == '\0' || name[length] == '.');
+}
+
+int main(int argc, char** argv) {
+	bool selected[NUM_TEST_CASES];
+	bool any_pattern;
+	unsigned int run;
+	unsigned int failed;
+
+	for (size_t t = 0; t < NUM_TEST_CASES; t++) {
+		selected[t] = false;
+	}
+
+	any_pattern = false;
+
+	for (int i = 1; i < argc; i++) {
+		bool matched;
+
+		if (strcmp(argv[i], "--list") == 0) {
+			for (size_t t = 0; t < NUM_TEST_CASES; t++) {
+				cout << TEST_CASES[t].name << endl;
+			}
+
+			return 0;
+		}
+
+		//
+		// A name that matches nothing is a mistake, not an empty pass.
+		//
+
+		matched = false;
+
+		for (size_t t = 0; t < NUM_TEST_CASES; t++) {
+			if (test_matches(TEST_CASES[t].name, argv[i])) {
+				selected[t] = true;
+				matched = true;
+			}
+		}
+
+		if (!matched) {
+			cerr << "No test matches " << argv[i] << endl;
+			return 1;
+		}
+
+		any_pattern = true;
+	}
+
+	run = 0;
+	failed = 0;
+
+	for (size_t t = 0; t < NUM_TEST_CASES; t++) {
+		test_context context;
+
+		if (any_pattern && !selected[t]) {
+			continue;
+		}
+
+		context.name = TEST_CASES[t].name;
+		context.checks = 0;
+		context.failures = 0;
+
+		TEST_CASES[t].run(&context);
+		run++;
+
+		if (context.failures > 0) {
+			failed++;
+		}
+
+		cout << (context.failures > 0 ? "FAIL " : "ok   ") << context.name
+			<< " (" << context.checks - context.failures << "/" << context.checks << " checks)" << endl;
+	}
+
+	cout << run - failed << " of " << run << " tests passed" << endl;
+
+	return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,127 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "profiler.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+void test_profiler_percentile(test_context* context) {
+	vector<double> values;
+
+	TEST_CHECK(context, percentile(&values, 50.0) == 0.0);
+
+	for (int i = 10; i >= 1; i--) {
+		values.push_back((double)i);
+	}
+
+	TEST_CHECK(context, percentile(&values, 50.0) == 5.0);
+	TEST_CHECK(context, percentile(&values, 99.0) == 10.0);
+	TEST_CHECK(context, percentile(&values, 0.0) == 1.0);
+	TEST_CHECK(context, percentile(&values, 100.0) == 10.0);
+}
+
+void test_profiler_summary(test_context* context) {
+	profiler prof;
+	vector<profile_phase_summary> summaries;
+
+	initialize_profiler(&prof);
+
+	record_profile_event(&prof, "compute", "dispatch", 0.0, 4.0);
+	record_profile_event(&prof, "compute", "dispatch", 10.0, 2.0);
+	record_profile_event(&prof, "compute", "dispatch", 20.0, 6.0);
+	record_profile_event(&prof, "copy", "readback", 5.0, 1.0);
+
+	//
+	// A NULL profiler takes anything and records nothing.
+	//
+
+	record_profile_event(NULL, "compute", "dispatch", 0.0, 1.0);
+
+	{
+		profile_scope scope(NULL, "nothing");
+	}
+
+	summaries = summarize_profile(&prof);
+	TEST_CHECK(context, summaries.size() == 2);
+
+	if (summaries.size() != 2) {
+		return;
+	}
+
+	TEST_CHECK(context, summaries[0].track == "compute" && summaries[0].name == "dispatch");
+	TEST_CHECK(context, summaries[0].count == 3);
+	TEST_CHECK(context, summaries[0].total_us == 12.0);
+	TEST_CHECK(context, summaries[0].mean_us == 4.0);
+	TEST_CHECK(context, summaries[0].p50_us == 4.0);
+	TEST_CHECK(context, summaries[0].max_us == 6.0);
+	TEST_CHECK(context, summaries[1].track == "copy" && summaries[1].count == 1);
+}
+
+void test_profiler_chrome_trace(test_context* context) {
+	profiler prof;
+	string trace;
+	FILE* file;
+	char buffer[512];
+	size_t read;
+
+	initialize_profiler(&prof);
+
+	record_profile_event(&prof, "cpu", "record", 1.0, 2.5);
+	record_profile_event(&prof, "compute", "say \"hi\"", 3.0, 4.0);
+
+	file = tmpfile();
+	TEST_CHECK(context, file != NULL);
+
+	if (file == NULL) {
+		return;
+	}
+
+	write_chrome_trace(&prof, file);
+	rewind(file);
+
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		trace.append(buffer, read);
+	}
+
+	fclose(file);
+
+	//
+	// One named thread per track, then the events on them.
+	//
+
+	TEST_CHECK(context, trace.find("\"tid\":1,\"name\":\"thread_name\",\"args\":{\"name\":\"cpu\"}") != string::npos);
+	TEST_CHECK(context, trace.find("\"tid\":2,\"name\":\"thread_name\",\"args\":{\"name\":\"compute\"}") != string::npos);
+	TEST_CHECK(context, trace.find("\"name\":\"record\",\"ts\":1.000,\"dur\":2.500") != string::npos);
+	TEST_CHECK(context, trace.find("\"name\":\"say \\\"hi\\\"\"") != string::npos);
+	TEST_CHECK(context, trace.substr(trace.size() - 4) == "\n]}\n");
+}
+
+void test_profiler_thread_tracks(test_context* context) {
+	profiler prof;
+	string named;
+	string unnamed;
+
+	initialize_profiler(&prof);
+
+	TEST_CHECK(context, profile_thread_track(&prof) == "cpu");
+
+	thread([&]() {
+		set_profile_thread_name("worker");
+		named = profile_thread_track(&prof);
+
+		{
+			profile_scope scope(&prof, "work");
+		}
+	}).join();
+
+	thread([&]() {
+		unnamed = profile_thread_track(&prof);
+	}).join();
+
+	TEST_CHECK(context, named == "cpu: worker");
+	TEST_CHECK(context, unnamed.compare(0, 4, "cpu ") == 0 && unnamed.size() > 4);
+	TEST_CHECK(context, prof.events.size() == 1 && prof.events[0].track == "cpu: worker");
+}
@@ -0,0 +1,124 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "queue_scheduler.h"
+#include <vector>
+
+using namespace std;
+
+static simulated_submission make_submission(
+	const queue_kind queue,
+	const uint64_t signal_value,
+	const double duration
+) {
+	simulated_submission sub;
+
+	sub.queue = queue;
+	sub.signal_value = signal_value;
+	sub.duration = duration;
+	sub.start = 0.0;
+	sub.finish = 0.0;
+
+	return sub;
+}
+
+static queue_ticket make_ticket(const queue_kind queue, const uint64_t value) {
+	queue_ticket ticket;
+
+	ticket.queue = queue;
+	ticket.value = value;
+
+	return ticket;
+}
+
+void test_queue_waits(test_context* context) {
+	queue_scheduler scheduler;
+	queue_ticket deps[4];
+	queue_ticket waits[QUEUE_KIND_COUNT];
+	unsigned int num_waits;
+
+	initialize_queue_scheduler(&scheduler);
+
+	//
+	// Same-queue deps need nothing, and only the newest value per other
+	// queue is waited on.
+	//
+
+	deps[0] = make_ticket(QUEUE_COPY, 3);
+	deps[1] = make_ticket(QUEUE_DIRECT, 2);
+	deps[2] = make_ticket(QUEUE_COMPUTE, 7);
+	deps[3] = make_ticket(QUEUE_DIRECT, 5);
+
+	num_waits = resolve_queue_waits(&scheduler, QUEUE_COPY, deps, 4, waits);
+	TEST_CHECK(context, num_waits == 2);
+	TEST_CHECK(context, waits[0].queue == QUEUE_DIRECT && waits[0].value == 5);
+	TEST_CHECK(context, waits[1].queue == QUEUE_COMPUTE && waits[1].value == 7);
+
+	//
+	// A wait already done covers any earlier value.
+	//
+
+	deps[0] = make_ticket(QUEUE_DIRECT, 4);
+	TEST_CHECK(context, resolve_queue_waits(&scheduler, QUEUE_COPY, deps, 1, waits) == 0);
+
+	deps[0] = make_ticket(QUEUE_DIRECT, 6);
+	TEST_CHECK(context, resolve_queue_waits(&scheduler, QUEUE_COPY, deps, 1, waits) == 1);
+	TEST_CHECK(context, waits[0].value == 6);
+
+	//
+	// Each queue keeps its own record.
+	//
+
+	deps[0] = make_ticket(QUEUE_DIRECT, 4);
+	TEST_CHECK(context, resolve_queue_waits(&scheduler, QUEUE_COMPUTE, deps, 1, waits) == 1);
+}
+
+void test_queue_signals(test_context* context) {
+	queue_scheduler scheduler;
+	queue_ticket ticket;
+
+	initialize_queue_scheduler(&scheduler);
+
+	ticket = record_queue_signal(&scheduler, QUEUE_COMPUTE, 9);
+	TEST_CHECK(context, ticket.queue == QUEUE_COMPUTE && ticket.value == 9);
+	TEST_CHECK(context, scheduler.signaled[QUEUE_COMPUTE] == 9);
+	TEST_CHECK(context, scheduler.signaled[QUEUE_COPY] == 0);
+}
+
+void test_queue_simulation(test_context* context) {
+	vector<simulated_submission> subs;
+	double end_time;
+
+	//
+	// Two dispatches on compute, each read back on copy. The first
+	// readback overlaps the second dispatch.
+	//
+
+	subs.push_back(make_submission(QUEUE_COMPUTE, 1, 4.0));
+	subs.push_back(make_submission(QUEUE_COMPUTE, 2, 4.0));
+	subs.push_back(make_submission(QUEUE_COPY, 1, 2.0));
+	subs.back().waits.push_back(make_ticket(QUEUE_COMPUTE, 1));
+	subs.push_back(make_submission(QUEUE_COPY, 2, 2.0));
+	subs.back().waits.push_back(make_ticket(QUEUE_COMPUTE, 2));
+
+	end_time = simulate_queues(&subs);
+	TEST_CHECK(context, end_time == 10.0);
+	TEST_CHECK(context, subs[2].start == 4.0 && subs[2].finish == 6.0);
+	TEST_CHECK(context, subs[3].start == 8.0);
+	TEST_CHECK(context, simulated_overlap(&subs) == 2.0);
+}
+
+void test_queue_deadlock(test_context* context) {
+	vector<simulated_submission> subs;
+
+	//
+	// Each queue waits on the other's first signal.
+	//
+
+	subs.push_back(make_submission(QUEUE_COMPUTE, 1, 1.0));
+	subs.back().waits.push_back(make_ticket(QUEUE_COPY, 1));
+	subs.push_back(make_submission(QUEUE_COPY, 1, 1.0));
+	subs.back().waits.push_back(make_ticket(QUEUE_COMPUTE, 1));
+
+	TEST_CHECK(context, simulate_queues(&subs) < 0.0);
+}
@@ -0,0 +1,18 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "readback_decoder.h"
+
+void test_readback_decoder_self_check(test_context* context) {
+	cpu_simd_level supported;
+
+	//
+	// Every level this CPU can run, not just the best one.
+	//
+
+	supported = detect_cpu_simd_level();
+
+	for (int level = CPU_SIMD_SCALAR; level <= supported; level++) {
+		TEST_CHECK(context, verify_readback_decoders((cpu_simd_level)level, stderr));
+	}
+}
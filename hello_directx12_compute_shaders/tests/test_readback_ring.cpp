@@ -0,0 +1,88 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "readback_ring.h"
+
+void test_readback_in_order(test_context* context) {
+	mock_fence_timeline timeline;
+	readback_ring ring;
+	unsigned int a;
+	unsigned int b;
+
+	initialize_readback_ring(&ring, 3);
+
+	TEST_CHECK(context, begin_readback(&ring) == INVALID_READBACK_SLOT);
+
+	a = acquire_readback_slot(&ring);
+	commit_readback_slot(&ring, a, &timeline, timeline.signal());
+	b = acquire_readback_slot(&ring);
+	commit_readback_slot(&ring, b, &timeline, timeline.signal());
+	TEST_CHECK(context, a == 0 && b == 1);
+	TEST_CHECK(context, readback_slots_in_flight(&ring) == 2);
+
+	//
+	// Not done yet, so trying doesn't block and gets nothing.
+	//
+
+	TEST_CHECK(context, try_begin_readback(&ring) == INVALID_READBACK_SLOT);
+
+	timeline.complete_up_to(1);
+	TEST_CHECK(context, try_begin_readback(&ring) == a);
+	TEST_CHECK(context, ring.slots[a].state == READBACK_SLOT_READING);
+	end_readback(&ring, a);
+
+	//
+	// begin_readback waits for the oldest.
+	//
+
+	TEST_CHECK(context, begin_readback(&ring) == b);
+	TEST_CHECK(context, ring.blocking_waits == 1 && timeline.blocking_waits == 1);
+	end_readback(&ring, b);
+
+	TEST_CHECK(context, ring.copies == 2 && ring.reads == 2 && ring.dropped == 0);
+	TEST_CHECK(context, readback_slots_in_flight(&ring) == 0);
+}
+
+void test_readback_dropping(test_context* context) {
+	mock_fence_timeline timeline;
+	readback_ring ring;
+	unsigned int slots[3];
+	unsigned int reused;
+	unsigned int reading;
+
+	initialize_readback_ring(&ring, 3);
+
+	for (int i = 0; i < 3; i++) {
+		slots[i] = acquire_readback_slot(&ring);
+		commit_readback_slot(&ring, slots[i], &timeline, timeline.signal());
+	}
+
+	//
+	// Every slot in flight: the oldest result nobody read is dropped.
+	//
+
+	reused = acquire_readback_slot(&ring);
+	TEST_CHECK(context, reused == slots[0]);
+	TEST_CHECK(context, ring.dropped == 1);
+	commit_readback_slot(&ring, reused, &timeline, timeline.signal());
+
+	//
+	// The newest result drops the others without waiting for them.
+	//
+
+	timeline.complete_up_to(4);
+	reading = begin_latest_readback(&ring);
+	TEST_CHECK(context, reading == reused);
+	TEST_CHECK(context, ring.dropped == 3);
+	TEST_CHECK(context, ring.blocking_waits == 0);
+	TEST_CHECK(context, readback_slots_in_flight(&ring) == 0);
+
+	//
+	// With the CPU reading one slot and copies recorded into the rest,
+	// there is nowhere to go.
+	//
+
+	TEST_CHECK(context, acquire_readback_slot(&ring) != INVALID_READBACK_SLOT);
+	TEST_CHECK(context, acquire_readback_slot(&ring) != INVALID_READBACK_SLOT);
+	TEST_CHECK(context, acquire_readback_slot(&ring) == INVALID_READBACK_SLOT);
+}
@@ -0,0 +1,8 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "recording_pool.h"
+
+void test_recording_pool_self_check(test_context* context) {
+	TEST_CHECK(context, verify_recording_pool(stderr));
+}
@@ -0,0 +1,206 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "resource_state_tracker.h"
+#include <vector>
+
+using namespace std;
+
+//
+// Bit patterns like D3D12's, so the tracker sees what it would on a
+// device.
+//
+
+static const uint32_t STATE_COMMON = 0x0;
+static const uint32_t STATE_UAV = 0x8;
+static const uint32_t STATE_SRV = 0x40;
+static const uint32_t STATE_COPY_DEST = 0x400;
+static const uint32_t STATE_COPY_SOURCE = 0x800;
+
+static void initialize_test_tracker(resource_state_tracker* tracker) {
+	initialize_resource_state_tracker(tracker, STATE_UAV, STATE_SRV | STATE_COPY_SOURCE);
+}
+
+void test_tracker_transitions(test_context* context) {
+	resource_state_tracker tracker;
+	vector<tracked_barrier> barriers;
+	int resource;
+
+	initialize_test_tracker(&tracker);
+	track_resource(&tracker, &resource, 1, STATE_COMMON);
+
+	require_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_UAV, true);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 1);
+	TEST_CHECK(context, barriers[0].kind == TRACKED_BARRIER_TRANSITION);
+	TEST_CHECK(context, barriers[0].before == STATE_COMMON && barriers[0].after == STATE_UAV);
+
+	require_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_SRV, false);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 1);
+	TEST_CHECK(context, barriers[0].before == STATE_UAV && barriers[0].after == STATE_SRV);
+
+	//
+	// Already there. Nothing to do.
+	//
+
+	require_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_SRV, false);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 0);
+	TEST_CHECK(context, tracked_resource_state(&tracker, &resource, 0) == STATE_SRV);
+}
+
+void test_tracker_uav_barriers(test_context* context) {
+	resource_state_tracker tracker;
+	vector<tracked_barrier> barriers;
+	int resource;
+
+	initialize_test_tracker(&tracker);
+	track_resource(&tracker, &resource, 1, STATE_UAV);
+
+	require_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_UAV, true);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 0);
+
+	require_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_UAV, true);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 1);
+	TEST_CHECK(context, barriers[0].kind == TRACKED_BARRIER_UAV);
+
+	//
+	// Separate submissions don't need one.
+	//
+
+	reset_uav_hazards(&tracker);
+	require_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_UAV, true);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 0);
+}
+
+void test_tracker_merging(test_context* context) {
+	resource_state_tracker tracker;
+	vector<tracked_barrier> barriers;
+	int resource;
+
+	initialize_test_tracker(&tracker);
+	track_resource(&tracker, &resource, 1, STATE_UAV);
+
+	//
+	// Two reads before a collect make one transition to both.
+	//
+
+	require_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_SRV, false);
+	require_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_COPY_SOURCE, false);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 1);
+	TEST_CHECK(context, barriers[0].before == STATE_UAV);
+	TEST_CHECK(context, barriers[0].after == (STATE_SRV | STATE_COPY_SOURCE));
+	TEST_CHECK(context, tracker.merged_transitions == 1);
+
+	//
+	// There and back again before a collect is nothing at all.
+	//
+
+	require_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_COPY_DEST, true);
+	require_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_SRV | STATE_COPY_SOURCE, false);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 0);
+	TEST_CHECK(context, tracker.dropped_transitions == 1);
+}
+
+void test_tracker_split_barriers(test_context* context) {
+	resource_state_tracker tracker;
+	vector<tracked_barrier> barriers;
+	int resource;
+
+	initialize_test_tracker(&tracker);
+	track_resource(&tracker, &resource, 1, STATE_UAV);
+
+	//
+	// Work recorded in between: the split stays split.
+	//
+
+	begin_resource_transition(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_COPY_SOURCE);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 1);
+	TEST_CHECK(context, barriers[0].kind == TRACKED_BARRIER_BEGIN_ONLY);
+
+	require_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_COPY_SOURCE, false);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 1);
+	TEST_CHECK(context, barriers[0].kind == TRACKED_BARRIER_END_ONLY);
+	TEST_CHECK(context, barriers[0].after == STATE_COPY_SOURCE);
+
+	//
+	// Nothing in between: it is a plain transition.
+	//
+
+	begin_resource_transition(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_UAV);
+	require_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_UAV, true);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 1);
+	TEST_CHECK(context, barriers[0].kind == TRACKED_BARRIER_TRANSITION);
+
+	//
+	// A split still open when the list closes is ended.
+	//
+
+	begin_resource_transition(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_SRV);
+	collect_resource_barriers(&tracker, &barriers);
+	end_resource_transitions(&tracker);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 1);
+	TEST_CHECK(context, barriers[0].kind == TRACKED_BARRIER_END_ONLY);
+	TEST_CHECK(context, tracked_resource_state(&tracker, &resource, 0) == STATE_SRV);
+}
+
+void test_tracker_subresources(test_context* context) {
+	resource_state_tracker tracker;
+	vector<tracked_barrier> barriers;
+	int resource;
+
+	initialize_test_tracker(&tracker);
+	track_resource(&tracker, &resource, 4, STATE_COMMON);
+
+	require_resource_state(&tracker, &resource, 2, STATE_UAV, true);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 1);
+	TEST_CHECK(context, barriers[0].subresource == 2);
+	TEST_CHECK(context, tracked_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES) == ALL_TRACKED_SUBRESOURCES);
+
+	//
+	// Out of step, so each subresource that has to move gets its own.
+	//
+
+	require_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_SRV, false);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 4);
+	TEST_CHECK(context, tracked_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES) == STATE_SRV);
+
+	//
+	// In step again, so one barrier covers them all.
+	//
+
+	require_resource_state(&tracker, &resource, ALL_TRACKED_SUBRESOURCES, STATE_UAV, true);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 1);
+	TEST_CHECK(context, barriers[0].subresource == ALL_TRACKED_SUBRESOURCES);
+}
+
+void test_tracker_untrack_and_assume(test_context* context) {
+	resource_state_tracker tracker;
+	vector<tracked_barrier> barriers;
+	int a;
+	int b;
+
+	initialize_test_tracker(&tracker);
+	track_resource(&tracker, &a, 1, STATE_COMMON);
+	track_resource(&tracker, &b, 1, STATE_COMMON);
+
+	//
+	// Nothing is recorded for a resource that is gone.
+	//
+
+	require_resource_state(&tracker, &a, ALL_TRACKED_SUBRESOURCES, STATE_UAV, true);
+	require_resource_state(&tracker, &b, ALL_TRACKED_SUBRESOURCES, STATE_UAV, true);
+	untrack_resource(&tracker, &a);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 1);
+	TEST_CHECK(context, barriers[0].resource == &b);
+
+	//
+	// A decay to COMMON records nothing, and the next transition starts
+	// from there.
+	//
+
+	assume_resource_state(&tracker, &b, STATE_COMMON);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 0);
+
+	require_resource_state(&tracker, &b, ALL_TRACKED_SUBRESOURCES, STATE_SRV, false);
+	TEST_CHECK(context, collect_resource_barriers(&tracker, &barriers) == 1);
+	TEST_CHECK(context, barriers[0].before == STATE_COMMON && barriers[0].after == STATE_SRV);
+}
@@ -0,0 +1,136 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "result_formatter.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static string read_back(FILE* file) {
+	string text;
+	char buffer[4096];
+	size_t read;
+
+	rewind(file);
+
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		text.append(buffer, read);
+	}
+
+	return text;
+}
+
+void test_formatter_matches_printf(test_context* context) {
+	const unsigned int width = 5;
+	const unsigned int height = 7;
+	const unsigned int row_pitch = 256;
+	const float values[] = {
+		0.0f, -0.0f, 1.0f / 3.0f, 0.5f, 1.0f, -1.0f, 1.0e-7f, 5.0e-7f,
+		0.0000015f, 123456.789f, -98765.4321f, 16777217.0f, 3.0e38f,
+		-3.0e38f, 1.0e-38f, 0.1f, 0.999999f, 0.9999995f,
+		numeric_limits<float>::infinity(),
+		-numeric_limits<float>::infinity(),
+		numeric_limits<float>::quiet_NaN()
+	};
+	const unsigned int num_values = sizeof(values) / sizeof(values[0]);
+	vector<unsigned char> memory;
+	float4_rows rows;
+	FILE* file;
+	string expected;
+	string formatted;
+	char line[256];
+	unsigned int next;
+
+	//
+	// A padded buffer of values that are easy to round wrong: halfway
+	// cases, denormals, the float limits and the non-finite values.
+	//
+
+	memory.assign((size_t)row_pitch * height, 0xCD);
+	next = 0;
+
+	for (unsigned int row = 0; row < height; row++) {
+		float* element = reinterpret_cast<float*>(memory.data() + (size_t)row * row_pitch);
+
+		for (unsigned int i = 0; i < width * 4; i++) {
+			element[i] = values[next++ % num_values];
+		}
+	}
+
+	rows.data = memory.data();
+	rows.width = width;
+	rows.height = height;
+	rows.row_pitch = row_pitch;
+
+	//
+	// The old per-element printf.
+	//
+
+	for (unsigned int row = 0; row < height; row++) {
+		const float* element = reinterpret_cast<const float*>(memory.data() + (size_t)row * row_pitch);
+
+		for (unsigned int col = 0; col < width; col++) {
+			snprintf(
+				line,
+				sizeof(line),
+				"Element (%u, %u): (%f, %f, %f, %f)\n",
+				row,
+				col,
+				element[0],
+				element[1],
+				element[2],
+				element[3]
+			);
+
+			expected += line;
+			element += 4;
+		}
+	}
+
+	//
+	// More threads than rows as well, so some workers get nothing.
+	//
+
+	for (unsigned int threads : { 1u, 3u, 16u }) {
+		file = tmpfile();
+		TEST_CHECK(context, file != NULL);
+
+		if (file == NULL) {
+			return;
+		}
+
+		format_all_elements(&rows, threads, file);
+		formatted = read_back(file);
+		fclose(file);
+
+		TEST_CHECK(context, formatted.size() == expected.size());
+		TEST_CHECK(context, formatted == expected);
+	}
+}
+
+void test_formatter_summary(test_context* context) {
+	const float data[] = {
+		0.0f, 1.0f, -2.0f, 4.0f,
+		1.0f, 3.0f, 2.0f, 4.0f,
+		0.5f, -1.0f, 0.0f, 4.0f
+	};
+	float4_rows rows;
+	channel_summary summary;
+
+	rows.data = reinterpret_cast<const unsigned char*>(data);
+	rows.width = 1;
+	rows.height = 3;
+	rows.row_pitch = sizeof(float) * 4;
+
+	summary = summarize_channels(&rows, 2);
+
+	TEST_CHECK(context, summary.min[0] == 0.0f && summary.max[0] == 1.0f);
+	TEST_CHECK(context, summary.min[1] == -1.0f && summary.max[1] == 3.0f);
+	TEST_CHECK(context, summary.min[2] == -2.0f && summary.max[2] == 2.0f);
+	TEST_CHECK(context, summary.mean[0] == 0.5 && summary.mean[1] == 1.0);
+	TEST_CHECK(context, summary.mean[2] == 0.0 && summary.mean[3] == 4.0);
+}
@@ -0,0 +1,40 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	A small test runner for the parts that build without DirectX (see
+	CMakeLists.txt at the top of the repository).
+
+	A test is a function that checks things with TEST_CHECK. Tests are
+	listed in test_main.cpp as "module.test". The runner takes names or
+	module prefixes on the command line and runs the tests that match,
+	or every test without any. It exits with 1 if a check failed, so
+	ctest (and CI) fails with it.
+*/
+
+#pragma once
+
+#include <cstdio>
+
+struct test_context {
+	const char* name;
+	unsigned int checks;
+	unsigned int failures;
+};
+
+void report_test_check(
+	test_context* context,
+	const bool passed,
+	const char* file,
+	const int line,
+	const char* what
+);
+
+#define TEST_CHECK(context, condition) \
+	report_test_check((context), (condition), __FILE__, __LINE__, #condition)
+
+typedef void (*test_function)(test_context* context);
+
+struct test_case {
+	const char* name;
+	test_function run;
+};
@@ -0,0 +1,139 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "shader_cache.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static fs::path test_directory(const char* name) {
+	fs::path path;
+	error_code err;
+
+	path = fs::temp_directory_path() / name;
+	fs::remove_all(path, err);
+	fs::create_directories(path, err);
+
+	return path;
+}
+
+static void write_text(const fs::path& path, const string& text) {
+	ofstream file(path, ios::binary | ios::trunc);
+
+	file << text;
+}
+
+void test_cache_hashing(test_context* context) {
+	const char bytes[] = "hello compute";
+	string name;
+
+	TEST_CHECK(context, hash_bytes(bytes, sizeof(bytes), 1) == hash_bytes(bytes, sizeof(bytes), 1));
+	TEST_CHECK(context, hash_bytes(bytes, sizeof(bytes), 1) != hash_bytes(bytes, sizeof(bytes), 2));
+	TEST_CHECK(context, hash_bytes(bytes, sizeof(bytes), 1) != hash_bytes(bytes, sizeof(bytes) - 1, 1));
+	TEST_CHECK(context, hash_string("a", 0) != hash_string("b", 0));
+
+	name = hash_to_name(0x0123456789abcdefULL);
+	TEST_CHECK(context, name == "0123456789abcdef");
+	TEST_CHECK(context, hash_to_name(0) == "0000000000000000");
+}
+
+void test_cache_keys(test_context* context) {
+	fs::path dir;
+	string source;
+	shader_defines defines;
+	shader_defines other_defines;
+	shader_cache_key base;
+	shader_cache_key key;
+
+	dir = test_directory("hello_compute_tests_keys");
+	source = (dir / "kernel.hlsl").string();
+
+	write_text(dir / "kernel.hlsl", "#include \"common.hlsli\"\nvoid main() {}\n");
+	write_text(dir / "common.hlsli", "// one\n");
+
+	defines.push_back(make_pair(string("TILE"), string("8")));
+	other_defines.push_back(make_pair(string("TILE"), string("16")));
+
+	TEST_CHECK(context, make_shader_cache_key(source, defines, "main", "cs_5_0", 0, &base));
+	TEST_CHECK(context, base.name == hash_to_name(base.hash));
+
+	TEST_CHECK(context, make_shader_cache_key(source, defines, "main", "cs_5_0", 0, &key));
+	TEST_CHECK(context, key.hash == base.hash);
+
+	//
+	// Everything that affects the output changes the key.
+	//
+
+	make_shader_cache_key(source, other_defines, "main", "cs_5_0", 0, &key);
+	TEST_CHECK(context, key.hash != base.hash);
+
+	make_shader_cache_key(source, defines, "other", "cs_5_0", 0, &key);
+	TEST_CHECK(context, key.hash != base.hash);
+
+	make_shader_cache_key(source, defines, "main", "cs_5_1", 0, &key);
+	TEST_CHECK(context, key.hash != base.hash);
+
+	make_shader_cache_key(source, defines, "main", "cs_5_0", 1, &key);
+	TEST_CHECK(context, key.hash != base.hash);
+
+	//
+	// So does a change to a file the source includes.
+	//
+
+	write_text(dir / "common.hlsli", "// two\n");
+	make_shader_cache_key(source, defines, "main", "cs_5_0", 0, &key);
+	TEST_CHECK(context, key.hash != base.hash);
+
+	TEST_CHECK(context, !make_shader_cache_key((dir / "missing.hlsl").string(), defines, "main", "cs_5_0", 0, &key));
+}
+
+void test_cache_round_trip(test_context* context) {
+	fs::path dir;
+	shader_cache cache;
+	shader_cache_key key;
+	shader_cache_key other;
+	vector<unsigned char> bytecode;
+	vector<unsigned char> loaded;
+
+	dir = test_directory("hello_compute_tests_cache");
+	initialize_shader_cache(&cache, dir.string());
+
+	for (unsigned int i = 0; i < 64; i++) {
+		bytecode.push_back((unsigned char)(i * 7));
+	}
+
+	key.hash = 0x1234;
+	key.name = hash_to_name(key.hash);
+	other.hash = 0x5678;
+	other.name = hash_to_name(other.hash);
+
+	TEST_CHECK(context, !load_cached_shader(&cache, &key, &loaded));
+	TEST_CHECK(context, store_cached_shader(&cache, &key, bytecode.data(), bytecode.size()));
+	TEST_CHECK(context, load_cached_shader(&cache, &key, &loaded));
+	TEST_CHECK(context, loaded == bytecode);
+	TEST_CHECK(context, cache.hits == 1 && cache.misses == 1);
+
+	//
+	// A truncated entry is a miss, not half a shader.
+	//
+
+	TEST_CHECK(context, store_cached_shader(&cache, &other, bytecode.data(), bytecode.size()));
+	fs::resize_file(dir / (other.name + ".cso"), fs::file_size(dir / (other.name + ".cso")) - 8);
+	TEST_CHECK(context, !load_cached_shader(&cache, &other, &loaded));
+	TEST_CHECK(context, loaded.empty());
+
+	//
+	// Only entries looked up this run survive a prune.
+	//
+
+	cache.used.clear();
+	load_cached_shader(&cache, &key, &loaded);
+	TEST_CHECK(context, prune_shader_cache(&cache) == 1);
+
+	clear_shader_cache(&cache);
+	TEST_CHECK(context, !load_cached_shader(&cache, &key, &loaded));
+}
@@ -0,0 +1,153 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "shader_layout.h"
+#include <string>
+
+using namespace std;
+
+static const char* TEST_LAYOUT =
+	"# A kernel with one of everything\n"
+	"numthreads 8 8 1\n"
+	"cbv buffer 0 0 1 16 constants\n"
+	"cbv buffer 1 0 1 256 big_constants\n"
+	"uav buffer 0 0 1 0 particles\n"
+	"srv texture 0 0 1 0 input\n"
+	"srv texture 1 0 1 0 input_two\n"
+	"uav texture 1 0 1 0 output\n";
+
+void test_layout_parse(test_context* context) {
+	shader_reflection reflection;
+	shader_reflection again;
+
+	TEST_CHECK(context, parse_shader_reflection(TEST_LAYOUT, &reflection));
+	TEST_CHECK(context, reflection.group_size[0] == 8 && reflection.group_size[1] == 8 && reflection.group_size[2] == 1);
+	TEST_CHECK(context, reflection.bindings.size() == 6);
+
+	if (reflection.bindings.size() != 6) {
+		return;
+	}
+
+	TEST_CHECK(context, reflection.bindings[0].kind == SHADER_BINDING_CBV);
+	TEST_CHECK(context, reflection.bindings[0].size_in_bytes == 16);
+	TEST_CHECK(context, reflection.bindings[0].name == "constants");
+	TEST_CHECK(context, reflection.bindings[2].shape == SHADER_RESOURCE_BUFFER);
+
+	//
+	// Writing it out and reading it back gives the same thing.
+	//
+
+	TEST_CHECK(context, parse_shader_reflection(write_shader_reflection(&reflection), &again));
+	TEST_CHECK(context, write_shader_reflection(&again) == write_shader_reflection(&reflection));
+
+	//
+	// Bad input is refused.
+	//
+
+	TEST_CHECK(context, !parse_shader_reflection("cbv buffer 0 0 1 16\n", &again));
+	TEST_CHECK(context, !parse_shader_reflection("numthreads 8 8\n", &again));
+	TEST_CHECK(context, !parse_shader_reflection("numthreads 8 8 1\nrtv texture 0 0 1 0\n", &again));
+	TEST_CHECK(context, !parse_shader_reflection("numthreads 8 8 1\nsrv cube 0 0 1 0\n", &again));
+}
+
+void test_layout_build(test_context* context) {
+	shader_reflection reflection;
+	root_layout layout;
+	root_layout same;
+
+	parse_shader_reflection(TEST_LAYOUT, &reflection);
+	TEST_CHECK(context, build_root_layout(&reflection, &layout));
+	TEST_CHECK(context, layout.parameters.size() == 4);
+
+	if (layout.parameters.size() != 4) {
+		return;
+	}
+
+	//
+	// Small constants go in the root, the large constant buffer and the
+	// structured buffer as root descriptors, and the textures share a
+	// table with SRVs first.
+	//
+
+	TEST_CHECK(context, layout.parameters[0].kind == ROOT_PARAMETER_CONSTANTS);
+	TEST_CHECK(context, layout.parameters[0].num_32bit_values == 4);
+	TEST_CHECK(context, layout.parameters[1].kind == ROOT_PARAMETER_CBV);
+	TEST_CHECK(context, layout.parameters[1].shader_register == 1);
+	TEST_CHECK(context, layout.parameters[2].kind == ROOT_PARAMETER_UAV);
+	TEST_CHECK(context, layout.parameters[3].kind == ROOT_PARAMETER_TABLE);
+	TEST_CHECK(context, layout.parameters[3].ranges.size() == 2);
+	TEST_CHECK(context, layout.size_in_dwords == 4 + 2 + 2 + 1);
+
+	if (layout.parameters[3].ranges.size() == 2) {
+		TEST_CHECK(context, layout.parameters[3].ranges[0].kind == SHADER_BINDING_SRV);
+		TEST_CHECK(context, layout.parameters[3].ranges[0].count == 2);
+		TEST_CHECK(context, layout.parameters[3].ranges[1].offset == 2);
+	}
+
+	//
+	// The order bindings are declared in doesn't matter.
+	//
+
+	swap(reflection.bindings[0], reflection.bindings[5]);
+	TEST_CHECK(context, build_root_layout(&reflection, &same));
+	TEST_CHECK(context, same.canonical == layout.canonical && same.hash == layout.hash);
+}
+
+void test_layout_overflow(test_context* context) {
+	shader_reflection reflection;
+	root_layout layout;
+	string text;
+
+	//
+	// 40 structured buffers would take 80 DWORDs as root descriptors.
+	//
+
+	text = "numthreads 64 1 1\n";
+
+	for (unsigned int i = 0; i < 40; i++) {
+		text += "uav buffer " + to_string(i) + " 0 1 0\n";
+	}
+
+	TEST_CHECK(context, parse_shader_reflection(text, &reflection));
+	TEST_CHECK(context, build_root_layout(&reflection, &layout));
+	TEST_CHECK(context, layout.size_in_dwords <= ROOT_SIGNATURE_MAX_DWORDS);
+	TEST_CHECK(context, layout.parameters.back().kind == ROOT_PARAMETER_TABLE);
+}
+
+void test_layout_find_binding(test_context* context) {
+	shader_reflection reflection;
+	root_layout layout;
+	unsigned int parameter;
+	unsigned int offset;
+
+	parse_shader_reflection(TEST_LAYOUT, &reflection);
+	build_root_layout(&reflection, &layout);
+
+	TEST_CHECK(context, find_root_binding(&layout, SHADER_BINDING_CBV, 0, 0, &parameter, &offset));
+	TEST_CHECK(context, parameter == 0);
+
+	TEST_CHECK(context, find_root_binding(&layout, SHADER_BINDING_UAV, 0, 0, &parameter, &offset));
+	TEST_CHECK(context, parameter == 2);
+
+	TEST_CHECK(context, find_root_binding(&layout, SHADER_BINDING_SRV, 1, 0, &parameter, &offset));
+	TEST_CHECK(context, parameter == 3 && offset == 1);
+
+	TEST_CHECK(context, find_root_binding(&layout, SHADER_BINDING_UAV, 1, 0, &parameter, &offset));
+	TEST_CHECK(context, parameter == 3 && offset == 2);
+
+	TEST_CHECK(context, !find_root_binding(&layout, SHADER_BINDING_SRV, 5, 0, &parameter, &offset));
+	TEST_CHECK(context, !find_root_binding(&layout, SHADER_BINDING_UAV, 0, 1, &parameter, &offset));
+}
+
+void test_layout_dispatch_size(test_context* context) {
+	shader_reflection reflection;
+	dispatch_group_count groups;
+
+	parse_shader_reflection(TEST_LAYOUT, &reflection);
+
+	groups = dispatch_size_for(&reflection, 64, 64, 1);
+	TEST_CHECK(context, groups.x == 8 && groups.y == 8 && groups.z == 1);
+
+	groups = dispatch_size_for(&reflection, 65, 1, 1);
+	TEST_CHECK(context, groups.x == 9 && groups.y == 1 && groups.z == 1);
+}
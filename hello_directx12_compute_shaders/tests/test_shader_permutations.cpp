@@ -0,0 +1,8 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "shader_permutations.h"
+
+void test_shader_permutations_self_check(test_context* context) {
+	TEST_CHECK(context, verify_shader_permutations(stderr));
+}
@@ -0,0 +1,182 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "suballocator.h"
+#include <vector>
+
+using namespace std;
+
+static bool allocations_overlap(const tlsf_allocation* a, const tlsf_allocation* b) {
+	return a->offset < b->offset + b->size && b->offset < a->offset + a->size;
+}
+
+void test_tlsf_allocate_free(test_context* context) {
+	tlsf_allocator allocator;
+	tlsf_allocation a;
+	tlsf_allocation b;
+	tlsf_allocation c;
+	tlsf_allocation huge;
+	tlsf_stats stats;
+
+	initialize_tlsf(&allocator, 64 * 1024, 256);
+
+	//
+	// Sizes round up to the granularity.
+	//
+
+	TEST_CHECK(context, tlsf_allocate(&allocator, 1000, 1, &a));
+	TEST_CHECK(context, a.size == 1024 && a.offset % 256 == 0);
+
+	TEST_CHECK(context, tlsf_allocate(&allocator, 4096, 1, &b));
+	TEST_CHECK(context, !allocations_overlap(&a, &b));
+
+	//
+	// A larger alignment is honoured.
+	//
+
+	TEST_CHECK(context, tlsf_allocate(&allocator, 256, 4096, &c));
+	TEST_CHECK(context, c.offset % 4096 == 0);
+	TEST_CHECK(context, !allocations_overlap(&a, &c) && !allocations_overlap(&b, &c));
+
+	TEST_CHECK(context, !tlsf_allocate(&allocator, 128 * 1024, 1, &huge));
+	TEST_CHECK(context, huge.block == TLSF_INVALID_BLOCK);
+
+	stats = get_tlsf_stats(&allocator);
+	TEST_CHECK(context, stats.allocations == 3);
+	TEST_CHECK(context, stats.used_bytes == a.size + b.size + c.size);
+	TEST_CHECK(context, stats.used_bytes + stats.free_bytes == 64 * 1024);
+
+	//
+	// Freeing twice is harmless: the first free empties the handle.
+	//
+
+	tlsf_free(&allocator, &b);
+	TEST_CHECK(context, b.block == TLSF_INVALID_BLOCK);
+	tlsf_free(&allocator, &b);
+	TEST_CHECK(context, get_tlsf_stats(&allocator).allocations == 2);
+}
+
+void test_tlsf_merging(test_context* context) {
+	tlsf_allocator allocator;
+	tlsf_allocation allocations[8];
+	tlsf_stats stats;
+
+	initialize_tlsf(&allocator, 64 * 1024, 256);
+
+	for (int i = 0; i < 8; i++) {
+		TEST_CHECK(context, tlsf_allocate(&allocator, 2048, 1, &allocations[i]));
+	}
+
+	//
+	// Every other block free: the holes can't merge.
+	//
+
+	for (int i = 0; i < 8; i += 2) {
+		tlsf_free(&allocator, &allocations[i]);
+	}
+
+	stats = get_tlsf_stats(&allocator);
+	TEST_CHECK(context, stats.free_blocks >= 4);
+	TEST_CHECK(context, stats.fragmentation > 0.0);
+
+	//
+	// Once the rest go, everything merges back into one block.
+	//
+
+	for (int i = 1; i < 8; i += 2) {
+		tlsf_free(&allocator, &allocations[i]);
+	}
+
+	stats = get_tlsf_stats(&allocator);
+	TEST_CHECK(context, stats.free_blocks == 1);
+	TEST_CHECK(context, stats.free_bytes == 64 * 1024);
+	TEST_CHECK(context, stats.largest_free_block == 64 * 1024);
+	TEST_CHECK(context, stats.fragmentation == 0.0);
+	TEST_CHECK(context, stats.used_bytes == 0 && stats.allocations == 0);
+}
+
+void test_tlsf_dedicated_block(test_context* context) {
+	const uint64_t mib = 1024 * 1024;
+	const uint64_t sizes[] = { 4096, 12345, 256 * mib, 256 * mib + 65536, 300 * mib, 1000 * mib };
+	const uint64_t alignments[] = { 4096, 65536, 4 * mib };
+	tlsf_allocator allocator;
+	tlsf_allocation allocation;
+	uint64_t block_size;
+	bool all_fit;
+	bool too_small;
+
+	//
+	// A fresh block of exactly the size asked for fits the request, at
+	// sizes past the default 256 MiB heap and at every alignment.
+	//
+
+	all_fit = true;
+
+	for (uint64_t size : sizes) {
+		for (uint64_t alignment : alignments) {
+			block_size = tlsf_block_size_for(size, alignment, 4096);
+			initialize_tlsf(&allocator, block_size, 4096);
+
+			if (block_size < size
+				|| !tlsf_allocate(&allocator, size, alignment, &allocation)
+				|| allocation.offset % alignment != 0) {
+				all_fit = false;
+			}
+		}
+	}
+
+	TEST_CHECK(context, all_fit);
+
+	//
+	// size plus alignment alone is not enough once the size class
+	// rounding kicks in.
+	//
+
+	initialize_tlsf(&allocator, 300 * mib + 65536, 4096);
+	too_small = !tlsf_allocate(&allocator, 300 * mib, 65536, &allocation);
+	TEST_CHECK(context, too_small);
+	TEST_CHECK(context, tlsf_block_size_for(300 * mib, 65536, 4096) > 300 * mib + 65536);
+}
+
+void test_transient_aliasing(test_context* context) {
+	transient_request requests[4];
+	transient_plan plan;
+
+	//
+	// 0 and 1 are live together. 2 starts after both end, and 3 spans
+	// everything.
+	//
+
+	requests[0] = { 4096, 256, 0, 1 };
+	requests[1] = { 2048, 256, 1, 2 };
+	requests[2] = { 4096, 256, 3, 4 };
+	requests[3] = { 1024, 1024, 0, 4 };
+
+	TEST_CHECK(context, transient_lifetimes_overlap(&requests[0], &requests[1]));
+	TEST_CHECK(context, !transient_lifetimes_overlap(&requests[0], &requests[2]));
+
+	plan_transient_aliasing(requests, 4, &plan);
+	TEST_CHECK(context, plan.offsets.size() == 4);
+
+	if (plan.offsets.size() != 4) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < 4; i++) {
+		TEST_CHECK(context, plan.offsets[i] % requests[i].alignment == 0);
+		TEST_CHECK(context, plan.offsets[i] + requests[i].size <= plan.arena_size);
+
+		for (unsigned int j = i + 1; j < 4; j++) {
+			if (transient_lifetimes_overlap(&requests[i], &requests[j])) {
+				TEST_CHECK(
+					context,
+					plan.offsets[i] + requests[i].size <= plan.offsets[j]
+						|| plan.offsets[j] + requests[j].size <= plan.offsets[i]
+				);
+			}
+		}
+	}
+
+	TEST_CHECK(context, plan.unaliased_size == 4096 + 2048 + 4096 + 1024);
+	TEST_CHECK(context, plan.arena_size < plan.unaliased_size);
+}
@@ -0,0 +1,8 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "threadgroup_tuner.h"
+
+void test_threadgroup_tuner_self_check(test_context* context) {
+	TEST_CHECK(context, verify_threadgroup_tuner(stderr));
+}
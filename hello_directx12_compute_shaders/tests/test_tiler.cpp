@@ -0,0 +1,149 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "tiler.h"
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+void test_tiler_grid(test_context* context) {
+	tile_grid grid;
+	tile_desc tile;
+	vector<unsigned int> covered;
+	bool covered_once;
+	bool inside_region;
+
+	//
+	// 40 texel regions with a halo of 4 leave 32 texel cores.
+	//
+
+	TEST_CHECK(context, plan_tile_grid(100, 70, 40, 40, 4, &grid));
+	TEST_CHECK(context, grid.tile_width == 32 && grid.tile_height == 32);
+	TEST_CHECK(context, grid.tiles_x == 4 && grid.tiles_y == 3);
+	TEST_CHECK(context, tile_count(&grid) == 12);
+
+	tile = get_tile(&grid, 5);
+	TEST_CHECK(context, tile.core_x == 32 && tile.core_y == 32);
+	TEST_CHECK(context, tile.x == 28 && tile.y == 28);
+	TEST_CHECK(context, tile.width == 40 && tile.height == 40);
+
+	//
+	// The halo is clipped at the edges, and the last cores are smaller.
+	//
+
+	tile = get_tile(&grid, 11);
+	TEST_CHECK(context, tile.core_width == 4 && tile.core_height == 6);
+	TEST_CHECK(context, tile.x + tile.width == 100 && tile.y + tile.height == 70);
+
+	tile = get_tile(&grid, 0);
+	TEST_CHECK(context, tile.x == 0 && tile.y == 0 && tile.width == 36);
+
+	//
+	// Together the cores cover every texel exactly once.
+	//
+
+	covered.assign(100 * 70, 0);
+	inside_region = true;
+
+	for (unsigned int i = 0; i < tile_count(&grid); i++) {
+		tile = get_tile(&grid, i);
+
+		if (tile.width > grid.max_region_width || tile.height > grid.max_region_height) {
+			inside_region = false;
+		}
+
+		for (unsigned int y = tile.core_y; y < tile.core_y + tile.core_height; y++) {
+			for (unsigned int x = tile.core_x; x < tile.core_x + tile.core_width; x++) {
+				covered[y * 100 + x]++;
+			}
+		}
+	}
+
+	covered_once = true;
+
+	for (unsigned int c : covered) {
+		covered_once = covered_once && c == 1;
+	}
+
+	TEST_CHECK(context, covered_once);
+	TEST_CHECK(context, inside_region);
+
+	//
+	// An image that fits needs no halo, and a halo that eats the region
+	// is refused.
+	//
+
+	TEST_CHECK(context, plan_tile_grid(30, 30, 40, 40, 4, &grid));
+	TEST_CHECK(context, tile_count(&grid) == 1 && grid.tile_width == 30);
+	TEST_CHECK(context, !plan_tile_grid(100, 100, 8, 8, 4, &grid));
+	TEST_CHECK(context, !plan_tile_grid(0, 100, 40, 40, 0, &grid));
+}
+
+void test_tiler_matches_single_dispatch(test_context* context) {
+	const unsigned int width = 100;
+	const unsigned int height = 70;
+	tile_grid grid;
+	cpu_tile_backend backend;
+	memory_tile_output output;
+	tiled_job_stats stats;
+	cpu_executor executor;
+	cpu_footprint footprint;
+	cpu_texture target;
+	cpu_dispatch_desc dispatch;
+	vector<unsigned char> whole;
+	bool same;
+
+	plan_tile_grid(width, height, 40, 40, 4, &grid);
+	initialize_cpu_tile_backend(&backend, &grid, 2, 2);
+	initialize_memory_tile_output(&output, &grid, CPU_FLOAT4_SIZE);
+
+	stats = run_tiled_job(&grid, &backend, NULL, &output, 2);
+	TEST_CHECK(context, stats.written);
+	TEST_CHECK(context, stats.tiles == tile_count(&grid));
+	TEST_CHECK(context, stats.max_in_flight <= 2);
+
+	//
+	// The same image in one dispatch.
+	//
+
+	initialize_cpu_executor(&executor, 2);
+	footprint = cpu_readback_footprint(width, height, CPU_FLOAT4_SIZE);
+	whole.assign((size_t)footprint.total_size, 0);
+
+	target.data = whole.data();
+	target.width = width;
+	target.height = height;
+	target.row_pitch = footprint.row_pitch;
+	target.format = CPU_TEXEL_R32G32B32A32_FLOAT;
+
+	dispatch = cpu_hello_compute_dispatch(width, height);
+	cpu_dispatch_hello_compute(&executor, &target, &dispatch);
+
+	same = output.pixels.size() == (size_t)width * height * CPU_FLOAT4_SIZE;
+
+	for (unsigned int y = 0; same && y < height; y++) {
+		same = memcmp(
+			&output.pixels[(size_t)y * width * CPU_FLOAT4_SIZE],
+			&whole[(size_t)y * footprint.row_pitch],
+			width * CPU_FLOAT4_SIZE
+		) == 0;
+	}
+
+	TEST_CHECK(context, same);
+}
+
+void test_tiler_image_size(test_context* context) {
+	unsigned int width;
+	unsigned int height;
+
+	TEST_CHECK(context, parse_image_size("65536x32768", &width, &height));
+	TEST_CHECK(context, width == 65536 && height == 32768);
+	TEST_CHECK(context, parse_image_size("8X4", &width, &height));
+	TEST_CHECK(context, width == 8 && height == 4);
+
+	TEST_CHECK(context, !parse_image_size("100", &width, &height));
+	TEST_CHECK(context, !parse_image_size("0x100", &width, &height));
+	TEST_CHECK(context, !parse_image_size("100x", &width, &height));
+	TEST_CHECK(context, !parse_image_size("100x50y", &width, &height));
+}
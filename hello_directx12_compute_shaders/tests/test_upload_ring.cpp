@@ -0,0 +1,104 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tests.h"
+#include "upload_ring.h"
+#include <vector>
+
+using namespace std;
+
+void test_upload_ring_frames(test_context* context) {
+	vector<unsigned char> memory(1024);
+	mock_fence_timeline timeline;
+	upload_ring ring;
+	upload_allocation allocation;
+
+	initialize_upload_ring(&ring, memory.data(), memory.size(), &timeline);
+
+	TEST_CHECK(context, allocate_upload(&ring, 400, 16, &allocation));
+	TEST_CHECK(context, allocation.offset == 0 && allocation.cpu_address == memory.data());
+	end_upload_frame(&ring, timeline.signal());
+
+	TEST_CHECK(context, allocate_upload(&ring, 400, 16, &allocation));
+	TEST_CHECK(context, allocation.offset == 400);
+	end_upload_frame(&ring, timeline.signal());
+	TEST_CHECK(context, upload_ring_bytes_in_use(&ring) == 800);
+
+	//
+	// The third doesn't fit before the end, so it wraps, and has to
+	// wait for the GPU to finish frame 1.
+	//
+
+	TEST_CHECK(context, allocate_upload(&ring, 400, 16, &allocation));
+	TEST_CHECK(context, allocation.offset == 0);
+	TEST_CHECK(context, ring.blocking_waits == 1 && timeline.blocking_waits == 1);
+	TEST_CHECK(context, timeline.completed_value() == 1);
+	end_upload_frame(&ring, timeline.signal());
+
+	//
+	// Once the GPU is done, everything comes back without waiting.
+	//
+
+	timeline.complete_up_to(3);
+	reclaim_upload_ring(&ring, timeline.completed_value());
+	TEST_CHECK(context, upload_ring_bytes_in_use(&ring) == 0);
+
+	TEST_CHECK(context, allocate_upload(&ring, 256, 256, &allocation));
+	TEST_CHECK(context, allocation.offset % 256 == 0);
+	TEST_CHECK(context, ring.blocking_waits == 1);
+}
+
+void test_upload_ring_too_big(test_context* context) {
+	vector<unsigned char> memory(1024);
+	mock_fence_timeline timeline;
+	upload_ring ring;
+	upload_allocation allocation;
+
+	initialize_upload_ring(&ring, memory.data(), memory.size(), &timeline);
+
+	TEST_CHECK(context, !allocate_upload(&ring, 2048, 16, &allocation));
+	TEST_CHECK(context, !allocate_upload(&ring, 0, 16, &allocation));
+
+	//
+	// The frame being recorded already holds most of the ring, and there
+	// is nothing to wait for.
+	//
+
+	TEST_CHECK(context, allocate_upload(&ring, 800, 16, &allocation));
+	TEST_CHECK(context, !allocate_upload(&ring, 400, 16, &allocation));
+	TEST_CHECK(context, timeline.blocking_waits == 0);
+}
+
+void test_upload_pitched_rows(test_context* context) {
+	unsigned char src[3 * 4];
+	unsigned char dst[3 * 8];
+	bool rows_match;
+	bool padding_kept;
+
+	for (unsigned int i = 0; i < sizeof(src); i++) {
+		src[i] = (unsigned char)(i + 1);
+	}
+
+	for (unsigned int i = 0; i < sizeof(dst); i++) {
+		dst[i] = 0xEE;
+	}
+
+	copy_pitched_rows(dst, 8, src, 4, 4, 3);
+
+	rows_match = true;
+	padding_kept = true;
+
+	for (unsigned int row = 0; row < 3; row++) {
+		for (unsigned int b = 0; b < 8; b++) {
+			if (b < 4 && dst[row * 8 + b] != src[row * 4 + b]) {
+				rows_match = false;
+			}
+
+			if (b >= 4 && dst[row * 8 + b] != 0xEE) {
+				padding_kept = false;
+			}
+		}
+	}
+
+	TEST_CHECK(context, rows_match);
+	TEST_CHECK(context, padding_kept);
+}
@@ -0,0 +1,154 @@
+// Liam Wynn, 01/20/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	Every test, by the module it covers. test_main.cpp lists them.
+*/
+
+#pragma once
+
+#include "test_runner.h"
+
+/* CPU EXECUTOR */
+
+void test_cpu_executor_simd_matches_scalar(test_context* context);
+void test_cpu_executor_tiled_matches_untiled(test_context* context);
+
+/* RESULT FORMATTER */
+
+void test_formatter_matches_printf(test_context* context);
+void test_formatter_summary(test_context* context);
+
+/* DESCRIPTOR ALLOCATOR */
+
+void test_descriptor_persistent(test_context* context);
+void test_descriptor_transient_ring(test_context* context);
+void test_descriptor_empty_frames(test_context* context);
+
+/* FRAME RING */
+
+void test_mock_fence_timeline(test_context* context);
+void test_frame_ring_overlap(test_context* context);
+void test_frame_ring_depth_one(test_context* context);
+
+/* QUEUE SCHEDULER */
+
+void test_queue_waits(test_context* context);
+void test_queue_signals(test_context* context);
+void test_queue_simulation(test_context* context);
+void test_queue_deadlock(test_context* context);
+
+/* SHADER CACHE */
+
+void test_cache_hashing(test_context* context);
+void test_cache_keys(test_context* context);
+void test_cache_round_trip(test_context* context);
+
+/* DISPATCH BATCH */
+
+void test_batch_groups_independent_pipelines(test_context* context);
+void test_batch_chain_barriers(test_context* context);
+void test_batch_read_and_write_hazards(test_context* context);
+void test_batch_moves_independent_work_ahead_of_barriers(test_context* context);
+
+/* RESOURCE STATE TRACKER */
+
+void test_tracker_transitions(test_context* context);
+void test_tracker_uav_barriers(test_context* context);
+void test_tracker_merging(test_context* context);
+void test_tracker_split_barriers(test_context* context);
+void test_tracker_subresources(test_context* context);
+void test_tracker_untrack_and_assume(test_context* context);
+
+/* PROFILER */
+
+void test_profiler_percentile(test_context* context);
+void test_profiler_summary(test_context* context);
+void test_profiler_chrome_trace(test_context* context);
+void test_profiler_thread_tracks(test_context* context);
+
+/* BENCHMARK SUITE */
+
+void test_bench_case_enumeration(test_context* context);
+void test_bench_cpu_backend(test_context* context);
+void test_bench_write_results(test_context* context);
+
+/* SHADER LAYOUT */
+
+void test_layout_parse(test_context* context);
+void test_layout_build(test_context* context);
+void test_layout_overflow(test_context* context);
+void test_layout_find_binding(test_context* context);
+void test_layout_dispatch_size(test_context* context);
+
+/* SUBALLOCATOR */
+
+void test_tlsf_allocate_free(test_context* context);
+void test_tlsf_merging(test_context* context);
+void test_tlsf_dedicated_block(test_context* context);
+void test_transient_aliasing(test_context* context);
+
+/* UPLOAD RING */
+
+void test_upload_ring_frames(test_context* context);
+void test_upload_ring_too_big(test_context* context);
+void test_upload_pitched_rows(test_context* context);
+
+/* READBACK RING */
+
+void test_readback_in_order(test_context* context);
+void test_readback_dropping(test_context* context);
+
+/* TILER */
+
+void test_tiler_grid(test_context* context);
+void test_tiler_matches_single_dispatch(test_context* context);
+void test_tiler_image_size(test_context* context);
+
+/* READBACK DECODER */
+
+void test_readback_decoder_self_check(test_context* context);
+
+/* DEVICE SET */
+
+void test_device_split_plan(test_context* context);
+void test_device_split_dispatch(test_context* context);
+void test_device_cached_throughput(test_context* context);
+void test_device_speeds(test_context* context);
+void test_device_probe_cache(test_context* context);
+
+/* JOB RUNNER */
+
+void test_job_manifest_defaults(test_context* context);
+void test_job_manifest_object(test_context* context);
+void test_job_manifest_errors(test_context* context);
+void test_job_hello_compute_kernel(test_context* context);
+
+/* COMPUTE GRAPH */
+
+void test_graph_culling(test_context* context);
+void test_graph_topological_order(test_context* context);
+void test_graph_minimal_barriers(test_context* context);
+void test_graph_aliasing(test_context* context);
+void test_graph_queue_assignment(test_context* context);
+void test_graph_dot_output(test_context* context);
+void test_compute_graph_self_check(test_context* context);
+
+/* RECORDING POOL */
+
+void test_recording_pool_self_check(test_context* context);
+
+/* INDIRECT DISPATCH */
+
+void test_indirect_dispatch_self_check(test_context* context);
+
+/* SHADER PERMUTATIONS */
+
+void test_shader_permutations_self_check(test_context* context);
+
+/* THREADGROUP TUNER */
+
+void test_threadgroup_tuner_self_check(test_context* context);
+
+/* DXIL CONTAINER */
+
+void test_dxil_container_self_check(test_context* context);
@@ -0,0 +1,548 @@
+// Liam Wynn, 01/13/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "threadgroup_tuner.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+using namespace std;
+
+bool is_valid_group_shape(const group_shape shape) {
+	return shape.x > 0 && shape.y > 0 && shape.x <= MAX_GROUP_THREADS && shape.x * shape.y <= MAX_GROUP_THREADS;
+}
+
+vector<group_shape> default_group_candidates() {
+	return {
+		{ 8, 8 },
+		{ 16, 16 },
+		{ 32, 8 },
+		{ 8, 32 },
+		{ 16, 8 },
+		{ 8, 16 },
+		{ 32, 4 },
+		{ 64, 1 },
+		{ 64, 4 },
+		{ 128, 1 },
+		{ 256, 1 },
+		{ 32, 32 }
+	};
+}
+
+void default_tuning_options(tuning_options* options) {
+	options->candidates = default_group_candidates();
+	options->warmup_iterations = 3;
+	options->trials = 9;
+	options->keep_margin = 0.02;
+}
+
+bool pick_fastest_candidate(
+	const vector<candidate_timing>& candidates,
+	const double keep_margin,
+	unsigned int* best
+) {
+	bool found;
+
+	found = false;
+
+	for (unsigned int i = 0; i < candidates.size(); i++) {
+		if (candidates[i].skipped) {
+			continue;
+		}
+
+		if (!found || candidates[i].median_ms < candidates[*best].median_ms) {
+			*best = i;
+			found = true;
+		}
+	}
+
+	//
+	// The first candidate is what the kernel already runs with. Keep it
+	// unless the winner clearly beats it.
+	//
+
+	if (found && *best != 0 && !candidates[0].skipped
+		&& candidates[*best].median_ms >= candidates[0].median_ms * (1.0 - keep_margin)) {
+		*best = 0;
+	}
+
+	return found;
+}
+
+tuning_result tune_group_shape(
+	bench_backend* backend,
+	const bench_case* test,
+	const tuning_options* options,
+	FILE* progress
+) {
+	tuning_result result;
+	double seconds[BENCH_PHASE_COUNT];
+
+	for (const group_shape& shape : options->candidates) {
+		candidate_timing timing;
+		bench_case candidate;
+		vector<double> sorted;
+
+		timing.shape = shape;
+		timing.skipped = false;
+		timing.median_ms = 0.0;
+		timing.min_ms = 0.0;
+
+		candidate = *test;
+		candidate.group_size_x = shape.x;
+		candidate.group_size_y = shape.y;
+
+		if (!is_valid_group_shape(shape)) {
+			timing.skipped = true;
+			timing.skip_reason = "more than " + to_string(MAX_GROUP_THREADS) + " threads";
+		}
+		else if (options->trials == 0) {
+			timing.skipped = true;
+			timing.skip_reason = "no trials";
+		}
+		else if (!backend->prepare(&candidate, &timing.skip_reason)) {
+			timing.skipped = true;
+		}
+
+		if (timing.skipped) {
+			if (progress != NULL) {
+				fprintf(progress, "%ux%u: skipped (%s)\n", shape.x, shape.y, timing.skip_reason.c_str());
+			}
+
+			result.candidates.push_back(timing);
+			continue;
+		}
+
+		for (unsigned int i = 0; i < options->warmup_iterations; i++) {
+			backend->run_iteration(seconds);
+		}
+
+		for (unsigned int i = 0; i < options->trials; i++) {
+			backend->run_iteration(seconds);
+			timing.trials.push_back(seconds[BENCH_PHASE_COMPUTE]);
+		}
+
+		backend->release();
+
+		sorted = timing.trials;
+		sort(sorted.begin(), sorted.end());
+
+		timing.median_ms = sorted.size() % 2 == 1
+			? sorted[sorted.size() / 2] * 1000.0
+			: (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]) * 500.0;
+		timing.min_ms = sorted[0] * 1000.0;
+
+		if (progress != NULL) {
+			fprintf(progress, "%ux%u: %.4f ms median\n", shape.x, shape.y, timing.median_ms);
+		}
+
+		result.candidates.push_back(timing);
+	}
+
+	result.best = 0;
+	result.found = pick_fastest_candidate(result.candidates, options->keep_margin, &result.best);
+
+	return result;
+}
+
+void print_tuning_result(const tuning_result* result, FILE* out) {
+	double baseline;
+
+	baseline = result->candidates.empty() || result->candidates[0].skipped ? 0.0 : result->candidates[0].median_ms;
+
+	fprintf(out, "  %-9s %12s %12s %9s\n", "group", "median ms", "min ms", "vs first");
+
+	for (unsigned int i = 0; i < result->candidates.size(); i++) {
+		const candidate_timing* timing = &result->candidates[i];
+		char group[32];
+
+		snprintf(group, sizeof(group), "%ux%u%s", timing->shape.x, timing->shape.y, result->found && i == result->best ? " *" : "");
+
+		if (timing->skipped) {
+			fprintf(out, "  %-9s skipped (%s)\n", group, timing->skip_reason.c_str());
+			continue;
+		}
+
+		if (baseline > 0.0) {
+			fprintf(out, "  %-9s %12.4f %12.4f %8.2fx\n", group, timing->median_ms, timing->min_ms, baseline / timing->median_ms);
+		}
+		else {
+			fprintf(out, "  %-9s %12.4f %12.4f %9s\n", group, timing->median_ms, timing->min_ms, "-");
+		}
+	}
+}
+
+/* TUNING DATABASE */
+
+string make_tuning_key(
+	const uint32_t vendor_id,
+	const uint32_t device_id,
+	const uint64_t kernel_hash
+) {
+	char key[64];
+
+	snprintf(key, sizeof(key), "%04x-%04x-%016llx", vendor_id, device_id, (unsigned long long)kernel_hash);
+
+	return key;
+}
+
+static bool parse_tuning_entry(istream& fields, tuning_entry* entry) {
+	return (fields >> entry->shape.x >> entry->shape.y >> entry->median_ms >> entry->baseline_ms)
+		&& is_valid_group_shape(entry->shape);
+}
+
+static void format_tuning_entry(ostream& out, const tuning_entry* entry) {
+	out << entry->shape.x << " " << entry->shape.y << " " << entry->median_ms << " " << entry->baseline_ms;
+}
+
+static bool same_tuning_entry(const tuning_entry* a, const tuning_entry* b) {
+	return a->shape.x == b->shape.x
+		&& a->shape.y == b->shape.y
+		&& a->median_ms == b->median_ms
+		&& a->baseline_ms == b->baseline_ms;
+}
+
+void load_tuning_database(tuning_database* database, const string& path) {
+	load_keyed_store(database, path, parse_tuning_entry);
+}
+
+bool find_tuning_entry(
+	const tuning_database* database,
+	const string& key,
+	tuning_entry* entry
+) {
+	return find_keyed_entry(database, key, entry);
+}
+
+void store_tuning_entry(
+	tuning_database* database,
+	const string& key,
+	const tuning_entry* entry
+) {
+	store_keyed_entry(database, key, entry, same_tuning_entry);
+}
+
+bool save_tuning_database(tuning_database* database) {
+	return save_keyed_store(database, format_tuning_entry);
+}
+
+/* SYNTHETIC BACKEND */
+
+const char* synthetic_bench_backend::name() {
+	return "synthetic";
+}
+
+bool synthetic_bench_backend::prepare(const bench_case* test, string* reason) {
+	for (const pair<group_shape, double>& entry : costs) {
+		if (entry.first.x == test->group_size_x && entry.first.y == test->group_size_y) {
+			cost = entry.second;
+			iterations = 0;
+			return true;
+		}
+	}
+
+	*reason = "no cost for this shape";
+	return false;
+}
+
+void synthetic_bench_backend::run_iteration(double seconds[BENCH_PHASE_COUNT]) {
+	uniform_real_distribution<double> jitter(-1.0, 1.0);
+	double ms;
+
+	iterations++;
+	total_iterations++;
+	ms = cost * (1.0 + noise * jitter(rng));
+
+	if (iterations <= cold_iterations) {
+		ms *= cold_factor;
+	}
+	else if (outlier_every > 0 && total_iterations % outlier_every == 0) {
+		ms *= outlier_factor;
+	}
+
+	seconds[BENCH_PHASE_COMPUTE] = ms / 1000.0;
+	seconds[BENCH_PHASE_COPY] = 0.0;
+	seconds[BENCH_PHASE_READBACK] = 0.0;
+}
+
+void synthetic_bench_backend::release() {
+	cost = 0.0;
+}
+
+void initialize_synthetic_bench_backend(
+	synthetic_bench_backend* backend,
+	const vector<pair<group_shape, double>>& costs,
+	const unsigned int seed
+) {
+	backend->costs = costs;
+	backend->noise = 0.0;
+	backend->outlier_every = 0;
+	backend->outlier_factor = 1.0;
+	backend->cold_iterations = 0;
+	backend->cold_factor = 1.0;
+	backend->rng.seed(seed);
+	backend->cost = 0.0;
+	backend->iterations = 0;
+	backend->total_iterations = 0;
+}
+
+/* CHECKING */
+
+static bool same_shape(const group_shape a, const group_shape b) {
+	return a.x == b.x && a.y == b.y;
+}
+
+bool verify_threadgroup_tuner(FILE* out) {
+	vector<pair<group_shape, double>> costs;
+	tuning_options options;
+	bench_case test;
+	tuning_result result;
+	unsigned int problems;
+
+	problems = 0;
+
+	auto report = [&](const string& what) {
+		if (out != NULL && problems < 10) {
+			fprintf(out, "  %s\n", what.c_str());
+		}
+
+		problems++;
+	};
+
+	test.width = 256;
+	test.height = 256;
+	test.format = BENCH_FORMAT_R32G32B32A32_FLOAT;
+	test.layout = BENCH_LAYOUT_TEXTURE;
+	test.group_size_x = 8;
+	test.group_size_y = 8;
+
+	//
+	// 32x8 is fastest by 10%. With 5% noise, every fifth iteration ten
+	// times as long and the first two twenty times, it still wins, on
+	// every seed. The outliers don't land evenly, so a mean would pick
+	// whichever shape got the fewest. 64x64 is too big and 128x1 isn't in the table, so both
+	// are skipped.
+	//
+
+	costs = {
+		{ { 8, 8 }, 1.0 },
+		{ { 16, 16 }, 0.95 },
+		{ { 32, 8 }, 0.8 },
+		{ { 64, 1 }, 0.9 },
+		{ { 8, 32 }, 1.2 }
+	};
+
+	default_tuning_options(&options);
+	options.candidates = { { 8, 8 }, { 16, 16 }, { 32, 8 }, { 64, 1 }, { 8, 32 }, { 64, 64 }, { 128, 1 } };
+	options.warmup_iterations = 2;
+	options.trials = 9;
+
+	for (unsigned int seed = 1; seed <= 20; seed++) {
+		synthetic_bench_backend backend;
+
+		initialize_synthetic_bench_backend(&backend, costs, seed);
+		backend.noise = 0.05;
+		backend.outlier_every = 5;
+		backend.outlier_factor = 10.0;
+		backend.cold_iterations = 2;
+		backend.cold_factor = 20.0;
+
+		result = tune_group_shape(&backend, &test, &options, NULL);
+
+		if (!result.found || !same_shape(result.candidates[result.best].shape, { 32, 8 })) {
+			report("seed " + to_string(seed) + ": noise or outliers picked the wrong shape");
+		}
+
+		if (!result.candidates[5].skipped || !result.candidates[6].skipped || result.candidates[2].skipped) {
+			report("the wrong candidates were skipped");
+		}
+
+		if (result.candidates[2].trials.size() != options.trials) {
+			report("a candidate didn't get every trial");
+		}
+	}
+
+	//
+	// Warmup isn't counted: with no noise, and the cold iterations all
+	// in the warmup, every trial is the cost.
+	//
+
+	{
+		synthetic_bench_backend backend;
+
+		initialize_synthetic_bench_backend(&backend, costs, 1);
+		backend.cold_iterations = 2;
+		backend.cold_factor = 20.0;
+
+		result = tune_group_shape(&backend, &test, &options, NULL);
+
+		if (result.candidates[0].median_ms != 1.0 || result.candidates[0].min_ms != 1.0 || result.candidates[3].median_ms != 0.9) {
+			report("the warmup iterations were counted");
+		}
+	}
+
+	//
+	// 1% faster isn't enough to leave 8x8, with the default margin. With
+	// no margin it is.
+	//
+
+	{
+		synthetic_bench_backend backend;
+
+		initialize_synthetic_bench_backend(&backend, { { { 8, 8 }, 1.0 }, { { 16, 16 }, 0.99 } }, 1);
+		options.candidates = { { 8, 8 }, { 16, 16 } };
+
+		result = tune_group_shape(&backend, &test, &options, NULL);
+
+		if (!result.found || result.best != 0) {
+			report("a shape within the margin replaced the first one");
+		}
+
+		options.keep_margin = 0.0;
+		result = tune_group_shape(&backend, &test, &options, NULL);
+
+		if (!result.found || result.best != 1) {
+			report("with no margin the faster shape wasn't picked");
+		}
+
+		options.keep_margin = 0.02;
+	}
+
+	//
+	// The first candidate refused: the fastest of the rest wins. All of
+	// them refused: nothing is found.
+	//
+
+	{
+		synthetic_bench_backend backend;
+
+		initialize_synthetic_bench_backend(&backend, { { { 16, 16 }, 2.0 }, { { 64, 1 }, 1.5 } }, 1);
+		options.candidates = { { 8, 8 }, { 16, 16 }, { 64, 1 } };
+
+		result = tune_group_shape(&backend, &test, &options, NULL);
+
+		if (!result.found || result.best != 2) {
+			report("with the first candidate skipped, the fastest other wasn't picked");
+		}
+
+		options.candidates = { { 4, 4 }, { 2048, 1 } };
+		result = tune_group_shape(&backend, &test, &options, NULL);
+
+		if (result.found) {
+			report("a shape was picked when every candidate was skipped");
+		}
+	}
+
+	//
+	// The database survives a save and load, skips lines it can't read,
+	// and only writes when something changed.
+	//
+
+	{
+		tuning_database database;
+		tuning_database loaded;
+		tuning_entry entry;
+		string path;
+		string key_a;
+		string key_b;
+		ofstream append;
+		error_code err;
+
+		path = (fs::temp_directory_path() / "hello_tuning_check.txt").string();
+		fs::remove(path, err);
+
+		key_a = make_tuning_key(0x10de, 0x2684, 0x7a3c9e01d5f2b846ull);
+		key_b = make_tuning_key(0x10de, 0x2685, 0x7a3c9e01d5f2b846ull);
+
+		if (key_a == key_b || key_a != "10de-2684-7a3c9e01d5f2b846") {
+			report("tuning keys don't tell devices apart");
+		}
+
+		load_tuning_database(&database, path);
+
+		entry ={ { 32, 8 }, 0.125, 0.25 };
+		store_tuning_entry(&database, key_a, &entry);
+		entry = { { 64, 1 }, 1.0 / 3.0, 0.5 };
+		store_tuning_entry(&database, key_b, &entry);
+
+		if (!save_tuning_database(&database)) {
+			report("the database couldn't be written");
+		}
+
+		append.open(path, ios::app);
+		append << "garbage line\n" << "1002-0001-0000000000000000 2048 1 1 1\n";
+		append.close();
+
+		load_tuning_database(&loaded, path);
+
+		if (loaded.entries.size() != 2 || !find_tuning_entry(&loaded, key_b, &entry)
+			|| !same_shape(entry.shape, { 64, 1 }) || entry.median_ms != 1.0 / 3.0 || entry.baseline_ms != 0.5) {
+			report("the database didn't load back what was saved");
+		}
+
+		if (find_tuning_entry(&loaded, make_tuning_key(0x8086, 0x2684, 0x7a3c9e01d5f2b846ull), &entry)) {
+			report("the database found an adapter it hasn't seen");
+		}
+
+		entry = { { 32, 8 }, 0.125, 0.25 };
+		store_tuning_entry(&loaded, key_a, &entry);
+
+		if (loaded.dirty) {
+			report("storing what was already there dirtied the database");
+		}
+
+		fs::remove(path, err);
+	}
+
+	//
+	// The CPU backend can be tuned. Which shape wins depends on the
+	// machine.
+	//
+
+	{
+		cpu_bench_backend backend;
+
+		initialize_cpu_bench_backend(&backend, 2);
+
+		test.width = 128;
+		test.height = 128;
+		options.candidates = { { 8, 8 }, { 16, 16 }, { 64, 1 } };
+		options.warmup_iterations = 1;
+		options.trials = 3;
+
+		result = tune_group_shape(&backend, &test, &options, NULL);
+
+		if (!result.found || result.candidates[0].skipped || result.candidates[2].median_ms <= 0.0) {
+			report("the CPU backend couldn't be tuned");
+		}
+	}
+
+	if (out != NULL) {
+		fprintf(out, "Threadgroup tuner: %s\n", problems == 0 ? "all correct" : (to_string(problems) + " problem(s)").c_str());
+	}
+
+	return problems == 0;
+}
+
+void benchmark_threadgroup_tuner(FILE* out) {
+	cpu_bench_backend backend;
+	tuning_options options;
+	tuning_result result;
+	bench_case test;
+
+	initialize_cpu_bench_backend(&backend, 0);
+	default_tuning_options(&options);
+
+	test.format = BENCH_FORMAT_R32G32B32A32_FLOAT;
+	test.layout = BENCH_LAYOUT_TEXTURE;
+
+	for (unsigned int size : { 256u, 1024u }) {
+		test.width = size;
+		test.height = size;
+
+		fprintf(out, "CPU executor, %ux%u %s:\n", size, size, bench_format_name(test.format));
+
+		result = tune_group_shape(&backend, &test, &options, NULL);
+		print_tuning_result(&result, out);
+	}
+}
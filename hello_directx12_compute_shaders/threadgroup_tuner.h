@@ -0,0 +1,201 @@
+// Liam Wynn, 01/13/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The threadgroup tuner finds the numthreads a kernel runs fastest
+	with on one adapter, and remembers it.
+
+	It runs the kernel through a bench_backend once per candidate group
+	shape (8x8, 16x16, 32x8, 64x1...): some warmup iterations that
+	aren't counted, then the trials. A candidate's time is the median of
+	its trials' compute phase, so one trial that got preempted doesn't
+	decide anything. The first candidate is the kernel's own shape, and
+	another one only replaces it if it is faster by more than a margin,
+	so noise alone doesn't switch shapes from run to run.
+
+	What was picked goes in the tuning database, a keyed store keyed
+	by the adapter's vendor and device ID and a hash of the kernel (its
+	source and the defines it was tuned with). Normal runs look their
+	adapter and kernel up at startup and compile with that shape. A
+	different GPU, or an edit to the kernel, is a different key, and
+	runs with the kernel's own shape until it is tuned.
+
+	Everything here works on any bench_backend: gpu_bench_backend on the
+	device, cpu_bench_backend, or synthetic_bench_backend, whose times
+	come from a table, for checking the search itself.
+
+	Nothing here depends on Windows.
+*/
+
+#pragma once
+
+#include "benchmark_suite.h"
+#include "keyed_store.h"
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// D3D12's limit on threads in a group.
+const unsigned int MAX_GROUP_THREADS = 1024;
+
+struct group_shape {
+	unsigned int x;
+	unsigned int y;
+};
+
+bool is_valid_group_shape(const group_shape shape);
+
+// 8x8 first, then shapes of 64 to 1024 threads, wide and tall.
+std::vector<group_shape> default_group_candidates();
+
+struct tuning_options {
+	// The first is the shape to keep unless another beats it.
+	std::vector<group_shape> candidates;
+
+	unsigned int warmup_iterations;
+	unsigned int trials;
+
+	// How much faster, as a fraction, a shape has to be than the first
+	// candidate to replace it.
+	double keep_margin;
+};
+
+void default_tuning_options(tuning_options* options);
+
+struct candidate_timing {
+	group_shape shape;
+
+	bool skipped;
+	std::string skip_reason;
+
+	// Compute phase seconds of each trial.
+	std::vector<double> trials;
+	double median_ms;
+	double min_ms;
+};
+
+struct tuning_result {
+	std::vector<candidate_timing> candidates;
+
+	// Index into candidates. Only meaningful if found.
+	unsigned int best;
+	bool found;
+};
+
+/*
+	The fastest candidate by median, or the first one if nothing beats
+	it by more than keep_margin. Skipped candidates are never picked.
+	Returns false if every one was skipped.
+*/
+bool pick_fastest_candidate(
+	const std::vector<candidate_timing>& candidates,
+	const double keep_margin,
+	unsigned int* best
+);
+
+/*
+	Times every candidate on backend, on test with its group size
+	replaced, and picks one. Progress lines go to progress, which may be
+	NULL.
+*/
+tuning_result tune_group_shape(
+	bench_backend* backend,
+	const bench_case* test,
+	const tuning_options* options,
+	FILE* progress
+);
+
+void print_tuning_result(const tuning_result* result, FILE* out);
+
+/* TUNING DATABASE */
+
+struct tuning_entry {
+	group_shape shape;
+
+	// The shape's median, and the first candidate's, when it was tuned.
+	double median_ms;
+	double baseline_ms;
+};
+
+/*
+	One kernel per line: key, group x, group y, median and baseline in
+	ms. Shapes D3D12 wouldn't take are dropped on load.
+*/
+typedef keyed_store<tuning_entry> tuning_database;
+
+// e.g. "10de-2684-7a3c9e01d5f2b846".
+std::string make_tuning_key(
+	const uint32_t vendor_id,
+	const uint32_t device_id,
+	const uint64_t kernel_hash
+);
+
+// A missing or unreadable file is an empty database.
+void load_tuning_database(tuning_database* database, const std::string& path);
+
+// Returns false if key isn't in the database.
+bool find_tuning_entry(
+	const tuning_database* database,
+	const std::string& key,
+	tuning_entry* entry
+);
+
+void store_tuning_entry(
+	tuning_database* database,
+	const std::string& key,
+	const tuning_entry* entry
+);
+
+// Only writes if something changed. Returns false if it couldn't.
+bool save_tuning_database(tuning_database* database);
+
+/* SYNTHETIC BACKEND */
+
+/*
+	Times come from costs, a compute phase time per shape, with noise
+	added: each trial is off by up to noise (a fraction) either way, one
+	in outlier_every iterations (counting across shapes) takes
+	outlier_factor times as long, and the first cold_iterations after
+	prepare take cold_factor times as long. Shapes not in costs are
+	refused. Copy and readback take no time.
+*/
+struct synthetic_bench_backend : bench_backend {
+	std::vector<std::pair<group_shape, double>> costs;
+	double noise;
+	unsigned int outlier_every;
+	double outlier_factor;
+	unsigned int cold_iterations;
+	double cold_factor;
+
+	std::mt19937 rng;
+	double cost;
+	unsigned int iterations;
+	unsigned int total_iterations;
+
+	const char* name() override;
+	bool prepare(const bench_case* test, std::string* reason) override;
+	void run_iteration(double seconds[BENCH_PHASE_COUNT]) override;
+	void release() override;
+};
+
+// No noise, outliers or cold iterations until they are set.
+void initialize_synthetic_bench_backend(
+	synthetic_bench_backend* backend,
+	const std::vector<std::pair<group_shape, double>>& costs,
+	const unsigned int seed
+);
+
+/*
+	Checks the search on synthetic timings (noise, outliers, cold
+	starts, refused shapes, the keep margin), the database round trip,
+	and that the CPU backend can be tuned. Problems go to out, which may
+	be NULL. Returns false if there were any.
+*/
+bool verify_threadgroup_tuner(FILE* out);
+
+/*
+	Tunes the kernel on the CPU executor at a few
+	sizes and prints what it found.
+*/
+void benchmark_threadgroup_tuner(FILE* out);
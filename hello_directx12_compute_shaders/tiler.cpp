@@ -0,0 +1,383 @@
+// Liam Wynn, 01/05/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "tiler.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+
+using namespace std;
+
+bool plan_tile_grid(
+	const unsigned int image_width,
+	const unsigned int image_height,
+	const unsigned int max_region_width,
+	const unsigned int max_region_height,
+	const unsigned int halo,
+	tile_grid* grid
+) {
+	if (image_width == 0 || image_height == 0) {
+		return false;
+	}
+
+	//
+	// An axis that fits in one region needs no halo on it: the halo
+	// would be clipped to the image anyway.
+	//
+
+	if ((image_width > max_region_width && max_region_width <= 2 * halo)
+		|| (image_height > max_region_height && max_region_height <= 2 * halo)) {
+		return false;
+	}
+
+	grid->image_width = image_width;
+	grid->image_height = image_height;
+	grid->halo = halo;
+
+	grid->tile_width = image_width <= max_region_width ? image_width : max_region_width - 2 * halo;
+	grid->tile_height = image_height <= max_region_height ? image_height : max_region_height - 2 * halo;
+
+	grid->tiles_x = (image_width + grid->tile_width - 1) / grid->tile_width;
+	grid->tiles_y = (image_height + grid->tile_height - 1) / grid->tile_height;
+
+	grid->max_region_width = image_width <= max_region_width ? image_width : max_region_width;
+	grid->max_region_height = image_height <= max_region_height ? image_height : max_region_height;
+
+	return true;
+}
+
+unsigned int tile_count(const tile_grid* grid) {
+	return grid->tiles_x * grid->tiles_y;
+}
+
+tile_desc get_tile(const tile_grid* grid, const unsigned int index) {
+	tile_desc tile;
+	uint64_t end;
+
+	tile.index = index;
+
+	tile.core_x = (index % grid->tiles_x) * grid->tile_width;
+	tile.core_y = (index / grid->tiles_x) * grid->tile_height;
+	tile.core_width = grid->image_width - tile.core_x < grid->tile_width
+		? grid->image_width - tile.core_x
+		: grid->tile_width;
+	tile.core_height = grid->image_height - tile.core_y < grid->tile_height
+		? grid->image_height - tile.core_y
+		: grid->tile_height;
+
+	//
+	// Grow the core by the halo, but not past the image.
+	//
+
+	tile.x = tile.core_x >= grid->halo ? tile.core_x - grid->halo : 0;
+	tile.y = tile.core_y >= grid->halo ? tile.core_y - grid->halo : 0;
+
+	end = (uint64_t)tile.core_x + tile.core_width + grid->halo;
+	tile.width = (unsigned int)((end < grid->image_width ? end : grid->image_width) - tile.x);
+
+	end = (uint64_t)tile.core_y + tile.core_height + grid->halo;
+	tile.height = (unsigned int)((end < grid->image_height ? end : grid->image_height) - tile.y);
+
+	return tile;
+}
+
+/* TILE OUTPUTS */
+
+/*
+	Start of the core in a tile's region.
+*/
+static const unsigned char* core_start(
+	const tile_desc* tile,
+	const unsigned char* region,
+	const uint64_t row_pitch,
+	const unsigned int texel_size
+) {
+	return region
+		+ (tile->core_y - tile->y) * row_pitch
+		+ (uint64_t)(tile->core_x - tile->x) * texel_size;
+}
+
+void initialize_memory_tile_output(
+	memory_tile_output* output,
+	const tile_grid* grid,
+	const unsigned int texel_size
+) {
+	output->width = grid->image_width;
+	output->height = grid->image_height;
+	output->texel_size = texel_size;
+	output->pixels.assign((size_t)grid->image_width * grid->image_height * texel_size, 0);
+}
+
+bool memory_tile_output::write_tile(
+	const tile_desc* tile,
+	const unsigned char* region,
+	const uint64_t row_pitch
+) {
+	const unsigned char* src;
+	size_t row_size;
+
+	src = core_start(tile, region, row_pitch, texel_size);
+	row_size = (size_t)tile->core_width * texel_size;
+
+	for (unsigned int row = 0; row < tile->core_height; row++) {
+		memcpy(
+			pixels.data() + ((size_t)(tile->core_y + row) * width + tile->core_x) * texel_size,
+			src + row * row_pitch,
+			row_size
+		);
+	}
+
+	return true;
+}
+
+static bool seek_file(FILE* file, const uint64_t offset) {
+#if defined(_MSC_VER)
+	return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+bool open_file_tile_output(
+	file_tile_output* output,
+	const char* path,
+	const tile_grid* grid,
+	const unsigned int texel_size
+) {
+	output->width = grid->image_width;
+	output->texel_size = texel_size;
+
+#if defined(_MSC_VER)
+	if (fopen_s(&output->file, path, "wb") != 0) {
+		output->file = NULL;
+	}
+#else
+	output->file = fopen(path, "wb");
+#endif
+
+	return output->file != NULL;
+}
+
+bool file_tile_output::write_tile(
+	const tile_desc* tile,
+	const unsigned char* region,
+	const uint64_t row_pitch
+) {
+	const unsigned char* src;
+	size_t row_size;
+	uint64_t offset;
+
+	src = core_start(tile, region, row_pitch, texel_size);
+	row_size = (size_t)tile->core_width * texel_size;
+
+	//
+	// Rows of a tile aren't next to each other in the file unless the
+	// tile is the full width of the image. Seeking past the end just
+	// grows the file.
+	//
+
+	for (unsigned int row = 0; row < tile->core_height; row++) {
+		offset = ((uint64_t)(tile->core_y + row) * width + tile->core_x) * texel_size;
+
+		if (!seek_file(file, offset) || fwrite(src + row * row_pitch, 1, row_size, file) != row_size) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void close_file_tile_output(file_tile_output* output) {
+	if (output->file != NULL) {
+		fclose(output->file);
+		output->file = NULL;
+	}
+}
+
+/* TILED JOBS */
+
+tiled_job_stats run_tiled_job(
+	const tile_grid* grid,
+	tile_backend* backend,
+	tile_input* input,
+	tile_output* output,
+	const unsigned int tiles_in_flight
+) {
+	struct tile_in_flight {
+		tile_desc tile;
+		unsigned int slot;
+	};
+
+	tiled_job_stats stats;
+	deque<tile_in_flight> in_flight;
+	vector<unsigned int> free_slots;
+	unsigned int num_tiles;
+	unsigned int depth;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+
+	depth = tiles_in_flight == 0 ? 1 : tiles_in_flight;
+	num_tiles = tile_count(grid);
+
+	for (unsigned int slot = depth; slot > 0; slot--) {
+		free_slots.push_back(slot - 1);
+	}
+
+	stats.tiles = 0;
+	stats.max_in_flight = 0;
+	stats.written = true;
+
+	//
+	// Writes out the oldest tile and frees its slot. After a failed
+	// write the rest are only waited on, not written.
+	//
+
+	auto retire_oldest = [&]() {
+		tile_in_flight oldest;
+		const unsigned char* region;
+		uint64_t row_pitch;
+
+		oldest = in_flight.front();
+		in_flight.pop_front();
+
+		region = backend->finish_tile(oldest.slot, &row_pitch);
+
+		if (stats.written) {
+			stats.written = output->write_tile(&oldest.tile, region, row_pitch);
+		}
+
+		backend->release_tile(oldest.slot);
+		free_slots.push_back(oldest.slot);
+	};
+
+	start = chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < num_tiles && stats.written; i++) {
+		tile_in_flight next;
+
+		if (free_slots.empty()) {
+			retire_oldest();
+		}
+
+		next.tile = get_tile(grid, i);
+		next.slot = free_slots.back();
+		free_slots.pop_back();
+
+		backend->submit_tile(&next.tile, next.slot, input);
+		in_flight.push_back(next);
+
+		stats.tiles++;
+		if (in_flight.size() > stats.max_in_flight) {
+			stats.max_in_flight = (unsigned int)in_flight.size();
+		}
+	}
+
+	while (!in_flight.empty()) {
+		retire_oldest();
+	}
+
+	elapsed = chrono::steady_clock::now() - start;
+
+	stats.seconds = elapsed.count();
+	stats.mpixels_per_second = 0.0;
+	if (stats.seconds > 0.0) {
+		stats.mpixels_per_second = (double)grid->image_width * grid->image_height / stats.seconds / 1.0e6;
+	}
+
+	return stats;
+}
+
+/* CPU_TILE_BACKEND IMPL */
+
+void initialize_cpu_tile_backend(
+	cpu_tile_backend* backend,
+	const tile_grid* grid,
+	const unsigned int num_slots,
+	const unsigned int num_threads
+) {
+	initialize_cpu_executor(&backend->executor, num_threads);
+
+	backend->grid = *grid;
+	backend->footprint = cpu_readback_footprint(
+		grid->max_region_width,
+		grid->max_region_height,
+		CPU_FLOAT4_SIZE
+	);
+
+	backend->slots.resize(num_slots == 0 ? 1 : num_slots);
+
+	for (vector<unsigned char>& slot : backend->slots) {
+		slot.resize((size_t)backend->footprint.total_size);
+	}
+}
+
+const char* cpu_tile_backend::name() {
+	return "cpu";
+}
+
+void cpu_tile_backend::submit_tile(
+	const tile_desc* tile,
+	const unsigned int slot,
+	tile_input* input
+) {
+	cpu_texture target;
+	cpu_dispatch_desc dispatch;
+
+	target.data = slots[slot].data();
+	target.width = tile->width;
+	target.height = tile->height;
+	target.row_pitch = footprint.row_pitch;
+	target.format = CPU_TEXEL_R32G32B32A32_FLOAT;
+
+	if (input != NULL) {
+		input->read_tile(tile, target.data, target.row_pitch);
+	}
+
+	//
+	// The kernel sees the tile at its place in the image.
+	//
+
+	dispatch = cpu_hello_compute_dispatch(tile->width, tile->height);
+	dispatch.origin_x = tile->x;
+	dispatch.origin_y = tile->y;
+	dispatch.image_width = grid.image_width;
+	dispatch.image_height = grid.image_height;
+
+	cpu_dispatch_hello_compute(&executor, &target, &dispatch);
+}
+
+const unsigned char* cpu_tile_backend::finish_tile(
+	const unsigned int slot,
+	uint64_t* row_pitch
+) {
+	// The dispatch already ran in submit_tile.
+	*row_pitch = footprint.row_pitch;
+	return slots[slot].data();
+}
+
+void cpu_tile_backend::release_tile(const unsigned int) {
+}
+
+bool parse_image_size(const char* text, unsigned int* width, unsigned int* height) {
+	char* end;
+	unsigned long w;
+	unsigned long h;
+
+	w = strtoul(text, &end, 10);
+
+	if (end == text || (*end != 'x' && *end != 'X')) {
+		return false;
+	}
+
+	text = end + 1;
+	h = strtoul(text, &end, 10);
+
+	if (end == text || *end != '\0' || w == 0 || h == 0 || w > 0xFFFFFFFFUL || h > 0xFFFFFFFFUL) {
+		return false;
+	}
+
+	*width = (unsigned int)w;
+	*height = (unsigned int)h;
+
+	return true;
+}
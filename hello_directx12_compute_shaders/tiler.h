@@ -0,0 +1,236 @@
+// Liam Wynn, 01/05/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The tiler runs the kernel over an image too big for one texture (or
+	for memory) a tile at a time.
+
+	plan_tile_grid cuts the image into a grid of core tiles. Each tile
+	is responsible for writing its core, but computes a region with a
+	halo of extra texels on every side, clipped to the image, so a
+	stencil kernel has the neighbours it needs at the seams. Only the
+	core is kept.
+
+	run_tiled_job streams the tiles through a tile_backend, in row major
+	order, with at most tiles_in_flight of them submitted and not yet
+	written out. Each tile goes:
+
+		input (optional) -> upload -> dispatch -> readback -> output
+
+	and the backend is free to overlap the stages of different tiles.
+	The oldest tile is always written out first, so the backend only
+	ever needs tiles_in_flight tiles worth of memory, whatever the size
+	of the image. tile_output puts the cores where they go: in memory
+	for small images, or in a raw file, seeking to each row.
+
+	The CPU backend here runs the cpu_executor. gpu_tile_backend runs
+	the same jobs on the device.
+*/
+
+#pragma once
+
+#include "cpu_executor.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+struct tile_grid {
+	unsigned int image_width;
+	unsigned int image_height;
+
+	// Core size. Tiles on the right and bottom edges may be smaller.
+	unsigned int tile_width;
+	unsigned int tile_height;
+	unsigned int halo;
+
+	unsigned int tiles_x;
+	unsigned int tiles_y;
+
+	// The biggest region a tile computes. Size staging for this.
+	unsigned int max_region_width;
+	unsigned int max_region_height;
+};
+
+struct tile_desc {
+	unsigned int index;
+
+	// The part of the image this tile writes.
+	unsigned int core_x;
+	unsigned int core_y;
+	unsigned int core_width;
+	unsigned int core_height;
+
+	// The part it computes: the core and its halo, clipped to the
+	// image. Tile data always starts at (x, y).
+	unsigned int x;
+	unsigned int y;
+	unsigned int width;
+	unsigned int height;
+};
+
+/*
+	Tiles of at most max_region_width by max_region_height, halo
+	included. Returns false if the halo leaves no room for a core.
+*/
+bool plan_tile_grid(
+	const unsigned int image_width,
+	const unsigned int image_height,
+	const unsigned int max_region_width,
+	const unsigned int max_region_height,
+	const unsigned int halo,
+	tile_grid* grid
+);
+
+unsigned int tile_count(const tile_grid* grid);
+tile_desc get_tile(const tile_grid* grid, const unsigned int index);
+
+/*
+	Fills a tile's region before the kernel runs, for kernels that read
+	what they write.
+*/
+struct tile_input {
+	virtual ~tile_input() {}
+
+	virtual void read_tile(
+		const tile_desc* tile,
+		unsigned char* region,
+		const uint64_t row_pitch
+	) = 0;
+};
+
+/*
+	Takes the core out of a finished tile. region points at texel
+	(tile->x, tile->y).
+*/
+struct tile_output {
+	virtual ~tile_output() {}
+
+	// Returns false if the data couldn't be written.
+	virtual bool write_tile(
+		const tile_desc* tile,
+		const unsigned char* region,
+		const uint64_t row_pitch
+	) = 0;
+};
+
+/*
+	The whole image in memory, rows packed tightly.
+*/
+struct memory_tile_output : tile_output {
+	unsigned int width;
+	unsigned int height;
+	unsigned int texel_size;
+	std::vector<unsigned char> pixels;
+
+	bool write_tile(
+		const tile_desc* tile,
+		const unsigned char* region,
+		const uint64_t row_pitch
+	) override;
+};
+
+void initialize_memory_tile_output(
+	memory_tile_output* output,
+	const tile_grid* grid,
+	const unsigned int texel_size
+);
+
+/*
+	A raw file of the whole image, rows packed tightly. Only the rows of
+	the tile being written are ever in memory.
+*/
+struct file_tile_output : tile_output {
+	FILE* file;
+	unsigned int width;
+	unsigned int texel_size;
+
+	bool write_tile(
+		const tile_desc* tile,
+		const unsigned char* region,
+		const uint64_t row_pitch
+	) override;
+};
+
+bool open_file_tile_output(
+	file_tile_output* output,
+	const char* path,
+	const tile_grid* grid,
+	const unsigned int texel_size
+);
+void close_file_tile_output(file_tile_output* output);
+
+/*
+	Runs tiles. Each tile in flight has a slot of its own, numbered
+	from 0, so the backend can keep per slot staging.
+*/
+struct tile_backend {
+	virtual ~tile_backend() {}
+
+	virtual const char* name() = 0;
+
+	// Starts tile in slot. input may be NULL.
+	virtual void submit_tile(
+		const tile_desc* tile,
+		const unsigned int slot,
+		tile_input* input
+	) = 0;
+
+	// Waits for the tile in slot and returns its region.
+	virtual const unsigned char* finish_tile(
+		const unsigned int slot,
+		uint64_t* row_pitch
+	) = 0;
+
+	// The region returned by finish_tile may be reused.
+	virtual void release_tile(const unsigned int slot) = 0;
+};
+
+struct tiled_job_stats {
+	unsigned int tiles;
+	unsigned int max_in_flight;
+	double seconds;
+	double mpixels_per_second;
+
+	// false if the output failed. The job stops at the first failure.
+	bool written;
+};
+
+tiled_job_stats run_tiled_job(
+	const tile_grid* grid,
+	tile_backend* backend,
+	tile_input* input,
+	tile_output* output,
+	const unsigned int tiles_in_flight
+);
+
+/*
+	Runs tiles on the CPU executor, float4 only. Each slot is a host
+	buffer laid out like a readback footprint of the biggest region.
+*/
+struct cpu_tile_backend : tile_backend {
+	cpu_executor executor;
+	tile_grid grid;
+	cpu_footprint footprint;
+	std::vector<std::vector<unsigned char>> slots;
+
+	const char* name() override;
+	void submit_tile(
+		const tile_desc* tile,
+		const unsigned int slot,
+		tile_input* input
+	) override;
+	const unsigned char* finish_tile(
+		const unsigned int slot,
+		uint64_t* row_pitch
+	) override;
+	void release_tile(const unsigned int slot) override;
+};
+
+void initialize_cpu_tile_backend(
+	cpu_tile_backend* backend,
+	const tile_grid* grid,
+	const unsigned int num_slots,
+	const unsigned int num_threads
+);
+
+// Parses "WxH", e.g. 65536x32768.
+bool parse_image_size(const char* text, unsigned int* width, unsigned int* height);
@@ -0,0 +1,226 @@
+// Liam Wynn, 01/03/2025, Hello DirectX 12: Compute Shader Edition
+
+#include "upload_ring.h"
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+void initialize_upload_ring(
+	upload_ring* ring,
+	unsigned char* base,
+	const uint64_t size,
+	fence_timeline* timeline
+) {
+	ring->base = base;
+	ring->size = size;
+	ring->timeline = timeline;
+	ring->allocated_total = 0;
+	ring->freed_total = 0;
+	ring->frame_marks.clear();
+	ring->allocations = 0;
+	ring->blocking_waits = 0;
+}
+
+/*
+	Where an allocation of size bytes would start if it were made now,
+	as a running total. Skips to the next multiple of alignment, and to
+	the start of the ring if it would run off the end.
+*/
+static uint64_t next_upload_start(
+	const upload_ring* ring,
+	const uint64_t size,
+	const uint64_t alignment
+) {
+	uint64_t start;
+
+	start = (ring->allocated_total + alignment - 1) & ~(alignment - 1);
+
+	if (start % ring->size + size > ring->size) {
+		start = (start / ring->size + 1) * ring->size;
+	}
+
+	return start;
+}
+
+bool allocate_upload(
+	upload_ring* ring,
+	const uint64_t size,
+	const uint64_t alignment,
+	upload_allocation* allocation
+) {
+	uint64_t start;
+	uint64_t oldest;
+
+	if (size == 0 || size > ring->size) {
+		return false;
+	}
+
+	start = next_upload_start(ring, size, alignment);
+
+	//
+	// Take back whatever the GPU is already done with. If that isn't
+	// enough, wait for the oldest frame still holding memory, and so on
+	// until it fits.
+	//
+
+	if (start + size - ring->freed_total > ring->size) {
+		reclaim_upload_ring(ring, ring->timeline->completed_value());
+	}
+
+	while (start + size - ring->freed_total > ring->size) {
+		//
+		// Nothing left to wait for. The frame being recorded has the
+		// rest of the ring.
+		//
+
+		if (ring->frame_marks.empty()) {
+			return false;
+		}
+
+		oldest = ring->frame_marks.front().fence_value;
+
+		ring->blocking_waits++;
+		ring->timeline->wait_for(oldest);
+		reclaim_upload_ring(ring, oldest);
+	}
+
+	ring->allocated_total = start + size;
+	ring->allocations++;
+
+	allocation->offset = start % ring->size;
+	allocation->cpu_address = ring->base + allocation->offset;
+	allocation->size = size;
+
+	return true;
+}
+
+void end_upload_frame(upload_ring* ring, const uint64_t fence_value) {
+	uint64_t marked;
+
+	marked = ring->frame_marks.empty()
+		? ring->freed_total
+		: ring->frame_marks.back().allocated_total;
+
+	//
+	// A frame that uploaded nothing has nothing to give back.
+	//
+
+	if (ring->allocated_total == marked) {
+		return;
+	}
+
+	ring->frame_marks.push_back({ fence_value, ring->allocated_total });
+}
+
+void reclaim_upload_ring(upload_ring* ring, const uint64_t completed) {
+	while (!ring->frame_marks.empty() && ring->frame_marks.front().fence_value <= completed) {
+		ring->freed_total = ring->frame_marks.front().allocated_total;
+		ring->frame_marks.pop_front();
+	}
+}
+
+uint64_t upload_ring_bytes_in_use(const upload_ring* ring) {
+	return ring->allocated_total - ring->freed_total;
+}
+
+void copy_pitched_rows(
+	unsigned char* dst,
+	const uint64_t dst_row_pitch,
+	const unsigned char* src,
+	const uint64_t src_row_pitch,
+	const uint64_t row_size,
+	const unsigned int num_rows
+) {
+	//
+	// Tightly packed on both ends is one copy.
+	//
+
+	if (dst_row_pitch == row_size && src_row_pitch == row_size) {
+		memcpy(dst, src, (size_t)(row_size * num_rows));
+		return;
+	}
+
+	for (unsigned int row = 0; row < num_rows; row++) {
+		memcpy(dst + row * dst_row_pitch, src + row * src_row_pitch, (size_t)row_size);
+	}
+}
+
+void benchmark_upload_ring(FILE* out) {
+	const uint64_t ring_size = 32ULL * 1024 * 1024;
+	const uint64_t bytes_per_frame = 8ULL * 1024 * 1024;
+	const uint64_t frames_in_flight = 2;
+	const unsigned int frames = 64;
+	const uint64_t payload_sizes[] = { 256, 4096, 65536, 1024 * 1024, 4 * 1024 * 1024 };
+	vector<unsigned char> memory;
+	vector<unsigned char> source;
+	chrono::steady_clock::time_point start;
+	chrono::duration<double> elapsed;
+
+	memory.resize((size_t)ring_size);
+	source.resize((size_t)payload_sizes[4]);
+
+	for (size_t i = 0; i < source.size(); i++) {
+		source[i] = (unsigned char)(i * 31);
+	}
+
+	for (uint64_t payload : payload_sizes) {
+		mock_fence_timeline timeline;
+		upload_ring ring;
+		upload_allocation allocation;
+		uint64_t fence;
+		uint64_t bytes;
+		bool failed;
+
+		initialize_upload_ring(&ring, memory.data(), ring_size, &timeline);
+		bytes = 0;
+		failed = false;
+
+		//
+		// Constants want 256 byte alignment and texture data 512. Small
+		// payloads stand in for the former, big ones for the latter.
+		//
+
+		start = chrono::steady_clock::now();
+
+		for (unsigned int frame = 0; frame < frames && !failed; frame++) {
+			for (uint64_t written = 0; written < bytes_per_frame; written += payload) {
+				if (!allocate_upload(&ring, payload, payload < 65536 ? 256 : 512, &allocation)) {
+					failed = true;
+					break;
+				}
+
+				memcpy(allocation.cpu_address, source.data(), (size_t)payload);
+				bytes += payload;
+			}
+
+			//
+			// The GPU is frames_in_flight frames behind.
+			//
+
+			fence = timeline.signal();
+			end_upload_frame(&ring, fence);
+
+			if (fence > frames_in_flight) {
+				timeline.complete_up_to(fence - frames_in_flight);
+			}
+		}
+
+		elapsed = chrono::steady_clock::now() - start;
+
+		if (failed) {
+			fprintf(out, "%8llu byte payloads: ring too small\n", (unsigned long long)payload);
+			continue;
+		}
+
+		fprintf(
+			out,
+			"%8llu byte payloads: %.2f GB/s, %.1f M allocs/s, %llu blocking waits\n",
+			(unsigned long long)payload,
+			bytes / elapsed.count() / 1.0e9,
+			ring.allocations / elapsed.count() / 1.0e6,
+			(unsigned long long)ring.blocking_waits
+		);
+	}
+}
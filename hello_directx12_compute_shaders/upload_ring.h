@@ -0,0 +1,118 @@
+// Liam Wynn, 01/03/2025, Hello DirectX 12: Compute Shader Edition
+
+/*
+	The upload ring is how data gets from the CPU to the GPU. It is one
+	big upload heap buffer, mapped once and left mapped, that is handed
+	out front to back: input for a texture copy, constants for a
+	dispatch, anything the GPU reads once and then forgets.
+
+	Like the transient descriptors (see descriptor_allocator.h), every
+	allocation made between two signals of the queue belongs to the
+	fence value of the second one. end_upload_frame tags them, and
+	reclaim_upload_ring hands back everything up to a completed value.
+	An allocation that doesn't fit waits on the timeline for the oldest
+	frame still holding memory, so the CPU only blocks when it gets a
+	whole ring ahead of the GPU.
+
+	This file only knows about offsets and a CPU pointer, so it runs on
+	host memory and a mock_fence_timeline without DirectX. gpu_upload
+	puts it on top of an upload heap.
+*/
+
+#pragma once
+
+#include "frame_ring.h"
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+
+/*
+	Marks the end of one frame's worth of uploads.
+*/
+struct upload_frame_mark {
+	uint64_t fence_value;
+	uint64_t allocated_total;
+};
+
+struct upload_ring {
+	// Where the ring is mapped, and how big it is.
+	unsigned char* base;
+	uint64_t size;
+
+	// Waited on when the ring is full.
+	fence_timeline* timeline;
+
+	//
+	// Both totals only ever grow. They include bytes skipped for
+	// alignment and at the end of the ring, so the head is at
+	// allocated_total % size and used = allocated - freed.
+	//
+
+	uint64_t allocated_total;
+	uint64_t freed_total;
+
+	// Oldest first. Only frames that allocated something get a mark.
+	std::deque<upload_frame_mark> frame_marks;
+
+	uint64_t allocations;
+	uint64_t blocking_waits;
+};
+
+struct upload_allocation {
+	// From the start of the ring.
+	uint64_t offset;
+	unsigned char* cpu_address;
+	uint64_t size;
+};
+
+/*
+	size must be a multiple of every alignment asked for later.
+*/
+void initialize_upload_ring(
+	upload_ring* ring,
+	unsigned char* base,
+	const uint64_t size,
+	fence_timeline* timeline
+);
+
+/*
+	alignment must be a power of two. Blocks on the timeline if the GPU
+	still has the memory. Returns false only if size can never fit: it
+	is bigger than the ring, or the uploads of the current frame
+	already take up the rest of it.
+*/
+bool allocate_upload(
+	upload_ring* ring,
+	const uint64_t size,
+	const uint64_t alignment,
+	upload_allocation* allocation
+);
+
+// Everything allocated since the last mark is in use until fence_value.
+void end_upload_frame(upload_ring* ring, const uint64_t fence_value);
+
+// Frees every frame whose fence value is at or below completed.
+void reclaim_upload_ring(upload_ring* ring, const uint64_t completed);
+
+uint64_t upload_ring_bytes_in_use(const upload_ring* ring);
+
+/*
+	Copies num_rows rows of row_size bytes, each starting dst_row_pitch
+	apart in dst and src_row_pitch apart in src. Used to fill a
+	GetCopyableFootprints layout, whose row pitch is padded.
+*/
+void copy_pitched_rows(
+	unsigned char* dst,
+	const uint64_t dst_row_pitch,
+	const unsigned char* src,
+	const uint64_t src_row_pitch,
+	const uint64_t row_size,
+	const unsigned int num_rows
+);
+
+/*
+	Pushes payloads of a range of sizes through a ring on a mock fence
+	with two frames in flight, and prints the throughput and how often
+	it had to wait.
+*/
+void benchmark_upload_ring(FILE* out);
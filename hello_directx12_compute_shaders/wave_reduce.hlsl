@@ -0,0 +1,88 @@
+//
+// Sums num_items values into one partial sum per group, with wave
+// intrinsics: every wave adds its lanes up with WaveActiveSum, and the
+// group's first thread adds up the waves. That needs shader model 6.0,
+// so this kernel only builds with DXC.
+//
+// With HALF_PRECISION the values are float16_t and the waves sum them
+// as float16_t, which needs 6.2, native 16-bit ops on the device and
+// -enable-16bit-types. The waves' sums are added as float either way.
+//
+// value(i) is made up from i and seed, so there is nothing to upload.
+// application.cpp adds the same values up on the CPU.
+//
+
+#define GROUP_SIZE 256
+
+// Waves are at least 4 lanes wide.
+#define MAX_WAVES (GROUP_SIZE / 4)
+
+RWByteAddressBuffer partial_sums : register(u0);
+
+cbuffer reduce_constants : register(b0)
+{
+    uint num_items;
+    uint seed;
+};
+
+groupshared float wave_sums[MAX_WAVES];
+
+// indirect_chain_hash, which the CPU uses to check the sums.
+uint reduce_hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+
+    return x;
+}
+
+// In [0, 1), on a 1/1024 grid so it is exact in half precision.
+float value(uint i)
+{
+    return (reduce_hash(i ^ seed) & 1023) / 1024.0f;
+}
+
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(
+    uint3 dispatch_thread_id : SV_DispatchThreadID,
+    uint3 group_id : SV_GroupID,
+    uint group_index : SV_GroupIndex
+)
+{
+    uint lanes;
+    uint num_waves;
+    float wave_sum;
+    float sum;
+
+    lanes = WaveGetLaneCount();
+    num_waves = (GROUP_SIZE + lanes - 1) / lanes;
+
+#if defined(HALF_PRECISION)
+    float16_t x = dispatch_thread_id.x < num_items ? (float16_t)value(dispatch_thread_id.x) : (float16_t)0;
+
+    wave_sum = (float)WaveActiveSum(x);
+#else
+    float x = dispatch_thread_id.x < num_items ? value(dispatch_thread_id.x) : 0.0f;
+
+    wave_sum = WaveActiveSum(x);
+#endif
+
+    if (WaveIsFirstLane()) {
+        wave_sums[group_index / lanes] = wave_sum;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (group_index == 0) {
+        sum = 0.0f;
+
+        for (uint w = 0; w < num_waves; w++) {
+            sum += wave_sums[w];
+        }
+
+        partial_sums.Store(group_id.x * 4, asuint(sum));
+    }
+}